@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+# Read the event trace from a RepRapFirmware build with SUPPORT_EVENT_TRACE enabled, using the rr_trace HTTP request,
+# and write it as a Chrome trace event JSON file that can be opened in a timeline viewer such as https://ui.perfetto.dev.
+# The record format is described in Developer-documentation/EventTraceFormat.md.
+
+import argparse
+import base64
+import json
+import struct
+import time
+import urllib.parse
+import urllib.request
+
+RECORD_FORMAT = "<IBBHII"
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+
+# Event ID: (name, True if arg1 is the duration in step clocks, names of the arguments)
+EVENTS = {
+    1: ("Move prepare", True, ("clocks", "moveClocks")),
+    2: ("Step timer late", False, ("lateClocks", "callback")),
+    3: ("File read", True, ("clocks", "bytes")),
+    4: ("Network send", False, ("offered", "sent")),
+    5: ("CAN send", True, ("clocks", "typeAndLength")),
+    6: ("CAN receive", False, ("type", "srcAndLength")),
+}
+
+
+def get(host, request, params):
+    url = "http://%s/%s?%s" % (host, request, urllib.parse.urlencode(params))
+    with urllib.request.urlopen(url, timeout=5) as f:
+        return json.loads(f.read().decode("utf-8"))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Capture the RepRapFirmware event trace in Chrome trace event format")
+    parser.add_argument("host", help="IP address or host name of the board")
+    parser.add_argument("-p", "--password", default="", help="board password")
+    parser.add_argument("-t", "--time", type=float, default=10.0, help="how many seconds to capture for")
+    parser.add_argument("-o", "--output", default="trace.json", help="output file")
+    args = parser.parse_args()
+
+    get(args.host, "rr_connect", {"password": args.password, "time": time.strftime("%Y-%m-%dT%H:%M:%S")})
+
+    events = []
+    dropped = 0
+    rate = None
+    base = None                 # the unwrapped timestamp of the first record
+    last = 0
+    end = time.time() + args.time
+    while time.time() < end:
+        resp = get(args.host, "rr_trace", {})
+        if resp.get("err", 1) != 0:
+            raise SystemExit("rr_trace failed, check that the firmware was built with SUPPORT_EVENT_TRACE")
+        rate = resp["rate"]
+        dropped += resp["dropped"]
+        data = base64.b64decode(resp["data"])
+        for offset in range(0, len(data) - RECORD_SIZE + 1, RECORD_SIZE):
+            timestamp, event_id, context, sequence, arg1, arg2 = struct.unpack_from(RECORD_FORMAT, data, offset)
+
+            # Unwrap the 32-bit step clock. Timestamps can be slightly out of order, so use the signed difference from the previous one.
+            if base is None:
+                base = last = timestamp
+            diff = (timestamp - (last & 0xFFFFFFFF)) & 0xFFFFFFFF
+            if diff >= 0x80000000:
+                diff -= 0x100000000
+            last += diff
+
+            name, has_duration, arg_names = EVENTS.get(event_id, ("Event %d" % event_id, False, ("arg1", "arg2")))
+            ts = (last - base) * 1e6 / rate
+            event = {"name": name, "pid": 0, "tid": event_id, "args": {arg_names[0]: arg1, arg_names[1]: arg2, "context": context}}
+            if has_duration:
+                dur = arg1 * 1e6 / rate
+                event.update({"ph": "X", "ts": ts - dur, "dur": dur})
+            else:
+                event.update({"ph": "i", "ts": ts, "s": "t"})
+            events.append(event)
+        if len(data) == 0:
+            time.sleep(0.05)
+
+    for event_id, (name, _, _) in EVENTS.items():
+        events.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": event_id, "args": {"name": name}})
+
+    with open(args.output, "w") as f:
+        json.dump({"traceEvents": events, "displayTimeUnit": "ms"}, f)
+    print("%d events written to %s, %d records dropped" % (len(events) - len(EVENTS), args.output, dropped))
+
+
+if __name__ == "__main__":
+    main()
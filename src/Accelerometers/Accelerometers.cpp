@@ -9,6 +9,8 @@
 
 #if SUPPORT_ACCELEROMETERS
 
+#include "ResonanceAnalyser.h"
+#include <Storage/CaptureFileWriter.h>
 #include <Storage/MassStorage.h>
 #include <Platform/Platform.h>
 #include <Platform/RepRap.h>
@@ -16,6 +18,8 @@
 #include <RTOSIface/RTOSIface.h>
 #include <Platform/TaskPriorities.h>
 #include <Hardware/SharedSpi/SharedSpiDevice.h>
+#include <Platform/OutputMemory.h>
+#include <Platform/Base64Encoder.h>
 
 #if SUPPORT_CAN_EXPANSION
 # include <CanMessageFormats.h>
@@ -68,7 +72,8 @@ static volatile uint32_t numSamplesRequested;
 static uint8_t resolution = DefaultResolution;
 static uint8_t orientation = 20;							// +Z -> +Z, +X -> +X
 static volatile uint8_t axesRequested;
-static FileStore* volatile accelerometerFile = nullptr;		// this is non-null when the accelerometer is running, null otherwise
+static FileStore* volatile accelerometerFile = nullptr;		// the file we are writing the data to, or null if we are not writing to a file
+static volatile bool running = false;						// true when the accelerometer is collecting data
 static unsigned int numLocalRunsCompleted = 0;
 static unsigned int lastRunNumSamplesReceived = 0;
 static uint8_t axisLookup[3];
@@ -79,6 +84,88 @@ static volatile bool failedStart = false;
 static IoPort spiCsPort;
 static IoPort irqPort;
 
+static ResonanceAnalyser *analyser = nullptr;				// created the first time that M956 D1 is used
+static volatile bool analysing = false;						// true if the current run is being analysed
+
+// Streaming of samples to the network. The ring buffer absorbs bursts of samples from the producer (the accelerometer task, or the CAN receiver
+// for a remote accelerometer) until the consumer (the HTTP responder processing rr_accelerometer) takes them.
+struct StreamedSample
+{
+	uint16_t sampleNumber;									// the low 16 bits of the sample number
+	int16_t values[3];										// the raw right-justified values of the axes being collected, in XYZ order
+};
+
+constexpr size_t StreamBufferSamples = 1536;				// 12Kb, more than one second of data at 1344Hz
+constexpr size_t MaxStreamBytesPerResponse = 1950;			// 2600 characters after base64 encoding, about two TCP messages
+
+static StreamedSample *streamBuffer = nullptr;				// allocated the first time that M956 K1 is used
+static volatile size_t streamPutIndex = 0;
+static volatile size_t streamGetIndex = 0;
+static volatile uint32_t streamSamplesDropped = 0;
+static volatile uint32_t streamRunNumber = 0;				// incremented when a new stream is started
+static volatile uint16_t streamSampleRate = 0;
+static uint8_t streamAxes = 0;
+static uint8_t streamResolution = 0;
+static volatile bool streaming = false;						// true if the current or last run was streamed instead of being written to a file
+
+// Add a sample to the stream buffer, or count it as dropped if the buffer is full
+static void PutStreamSample(unsigned int sampleNumber, const int16_t *values, unsigned int numValues) noexcept
+{
+	const size_t putIndex = streamPutIndex;
+	const size_t nextPutIndex = (putIndex + 1) % StreamBufferSamples;
+	if (nextPutIndex == streamGetIndex)
+	{
+		++streamSamplesDropped;
+	}
+	else
+	{
+		StreamedSample& sample = streamBuffer[putIndex];
+		sample.sampleNumber = (uint16_t)sampleNumber;
+		memcpy(sample.values, values, numValues * sizeof(int16_t));
+		streamPutIndex = nextPutIndex;
+	}
+}
+
+static CaptureFileWriter *captureWriter = nullptr;			// created the first time that M956 B1 is used
+static bool useBinaryFormat = false;						// true if the current run is being written to file in binary format
+
+// Write the end of run information to the data file. If 'message' is null then we write the sample rate and the number of overflows.
+static void WriteEndOfRun(FileStore *f, CaptureFileTrailer::Status status, const char *message, unsigned int rate, unsigned int numOverflows, unsigned int bits) noexcept
+{
+	if (useBinaryFormat)
+	{
+		captureWriter->Finish(status, rate, numOverflows, bits);
+	}
+	else if (message != nullptr)
+	{
+		f->Write(message);
+	}
+	else
+	{
+		String<StringLength50> temp;
+		temp.printf("Rate %u, overflows %u\n", rate, numOverflows);
+		f->Write(temp.c_str());
+	}
+}
+
+// Finish analysing a run and report the results
+static void FinishAnalysis(FileStore *f, unsigned int sampleRate) noexcept
+{
+	if (analysing)
+	{
+		analyser->Finish(sampleRate);
+		analysing = false;
+		String<StringLength256> temp;
+		analyser->AppendResults(temp.GetRef());
+		if (f != nullptr)
+		{
+			f->Write(temp.c_str());
+			f->Write('\n');
+		}
+		reprap.GetPlatform().MessageF(LoggedGenericMessage, "%s\n", temp.c_str());
+	}
+}
+
 // Add a local accelerometer run
 static void AddLocalAccelerometerRun(unsigned int numDataPoints) noexcept
 {
@@ -105,16 +192,17 @@ static uint8_t TranslateAxes(uint8_t axes) noexcept
 	for (;;)
 	{
 		TaskBase::Take();
-		FileStore * f = accelerometerFile;			// capture volatile variable
-		if (f != nullptr)
+		if (running)
 		{
-			// Collect and write the samples
+			// Collect and write or stream the samples
+			FileStore * f = accelerometerFile;		// capture volatile variable, this is null if we are streaming
 			unsigned int samplesWritten = 0;
 			unsigned int samplesWanted = numSamplesRequested;
 			unsigned int numOverflows = 0;
 			const uint16_t mask = (1u << resolution) - 1;
 			const int decimalPlaces = GetDecimalPlaces(resolution);
 			bool recordFailedStart = false;
+			bool collectionFailed = false;
 
 			if (accelerometer->StartCollecting(TranslateAxes(axesRequested)))
 			{
@@ -129,10 +217,15 @@ static uint8_t TranslateAxes(uint8_t axes) noexcept
 					{
 						// samplesRead == 0 indicates an error, e.g. no interrupt
 						samplesWanted = 0;
-						f->Write("Failed to collect data from accelerometer\n");
-						f->Truncate();				// truncate the file in case we didn't write all the preallocated space
-						f->Close();
-						f = nullptr;
+						collectionFailed = true;
+						if (f != nullptr)
+						{
+							WriteEndOfRun(f, CaptureFileTrailer::Status::collectionFailed, "Failed to collect data from accelerometer\n", dataRate, numOverflows, resolution);
+							f->Truncate();				// truncate the file in case we didn't write all the preallocated space
+							f->Close();
+							f = nullptr;
+						}
+						analysing = false;
 						AddLocalAccelerometerRun(0);
 					}
 					else
@@ -151,12 +244,14 @@ static uint8_t TranslateAxes(uint8_t axes) noexcept
 						{
 							samplesRead = samplesWanted;
 						}
+						streamSampleRate = dataRate;
 
 						while (samplesRead != 0)
 						{
-							// Write a row of data
-							String<StringLength50> temp;
-							temp.printf("%u", samplesWritten);
+							// Convert a row of data
+							float values[3];
+							int16_t rawValues[3];
+							unsigned int numValues = 0;
 
 							for (unsigned int axis = 0; axis < 3; ++axis)
 							{
@@ -176,18 +271,38 @@ static uint8_t TranslateAxes(uint8_t axes) noexcept
 									}
 
 									// Convert it to a float number of g
-									const float fVal = (float)(int16_t)dataVal/(float)(1u << GetBitsAfterPoint(resolution));
+									rawValues[numValues] = (int16_t)dataVal;
+									values[numValues] = (float)(int16_t)dataVal/(float)(1u << GetBitsAfterPoint(resolution));
+									++numValues;
+								}
+							}
 
-									// Append it to the buffer
-									temp.catf(",%.*f", decimalPlaces, (double)fVal);
+							if (analysing)
+							{
+								analyser->AddSample(values);
+							}
+							if (useBinaryFormat)
+							{
+								captureWriter->AddRecord(samplesWritten, rawValues);
+							}
+							else if (f != nullptr)
+							{
+								// Write a row of data
+								String<StringLength50> temp;
+								temp.printf("%u", samplesWritten);
+								for (unsigned int i = 0; i < numValues; ++i)
+								{
+									temp.catf(",%.*f", decimalPlaces, (double)values[i]);
 								}
+								temp.cat('\n');
+								f->Write(temp.c_str());
+							}
+							else
+							{
+								PutStreamSample(samplesWritten, rawValues, numValues);
 							}
 
 							data += 3;
-
-							temp.cat('\n');
-							f->Write(temp.c_str());
-
 							--samplesRead;
 							--samplesWanted;
 							++samplesWritten;
@@ -197,9 +312,11 @@ static uint8_t TranslateAxes(uint8_t axes) noexcept
 
 				if (f != nullptr)
 				{
-					String<StringLength50> temp;
-					temp.printf("Rate %u, overflows %u\n", dataRate, numOverflows);
-					f->Write(temp.c_str());
+					WriteEndOfRun(f, CaptureFileTrailer::Status::ok, nullptr, dataRate, numOverflows, resolution);
+				}
+				if (!collectionFailed)
+				{
+					FinishAnalysis((useBinaryFormat) ? nullptr : f, dataRate);
 				}
 			}
 			else
@@ -207,21 +324,26 @@ static uint8_t TranslateAxes(uint8_t axes) noexcept
 				recordFailedStart = true;
 				if (f != nullptr)
 				{
-					f->Write("Failed to start accelerometer\n");
+					WriteEndOfRun(f, CaptureFileTrailer::Status::failedToStart, "Failed to start accelerometer\n", 0, 0, resolution);
 				}
 			}
 
-			if (f != nullptr)
+			if (!collectionFailed)
 			{
-				f->Truncate();				// truncate the file in case we didn't write all the preallocated space
-				f->Close();
+				if (f != nullptr)
+				{
+					f->Truncate();				// truncate the file in case we didn't write all the preallocated space
+					f->Close();
+				}
 				AddLocalAccelerometerRun(samplesWritten);
 			}
 
 			accelerometer->StopCollecting();
+			analysing = false;							// in case we failed to start
 
 			// Wait for another command
 			accelerometerFile = nullptr;
+			running = false;
 			if (recordFailedStart)
 			{
 				failedStart = true;
@@ -285,7 +407,7 @@ GCodeResult Accelerometers::ConfigureAccelerometer(GCodeBuffer& gb, const String
 	}
 
 	// No need for task lock here because this function and the M956 function are called only by the MAIN task
-	if (accelerometerFile != nullptr)
+	if (running)
 	{
 		reply.copy("Cannot reconfigure accelerometer while it is collecting data");
 		return GCodeResult::error;
@@ -382,6 +504,33 @@ GCodeResult Accelerometers::ConfigureAccelerometer(GCodeBuffer& gb, const String
 	return GCodeResult::ok;
 }
 
+// Wake up the accelerometer task to collect data from the local accelerometer and wait for it to start. 'running' is already set.
+static GCodeResult StartLocalCollection(const StringRef& reply) noexcept
+{
+	successfulStart = false;
+	failedStart = false;
+	accelerometerTask->Give();
+	const uint32_t startTime = millis();
+	do
+	{
+		delay(5);
+		if (successfulStart)
+		{
+			return GCodeResult::ok;
+		}
+	} while (!failedStart && millis() - startTime < 1000);
+
+	reply.copy("Failed to start accelerometer data collection");
+	if (accelerometer->HasInterruptError())
+	{
+		reply.cat(": INT1 error");
+	}
+	analysing = false;
+	streaming = false;
+	running = false;
+	return GCodeResult::error;
+}
+
 // Deal with M956
 GCodeResult Accelerometers::StartAccelerometer(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
 {
@@ -415,7 +564,7 @@ GCodeResult Accelerometers::StartAccelerometer(GCodeBuffer& gb, const StringRef&
 	}
 
 	// No need for task lock here because this function and the M955 function are called only by the MAIN task
-	if (accelerometerFile != nullptr)
+	if (running)
 	{
 		reply.copy("Accelerometer is already collecting data");
 		return GCodeResult::error;
@@ -426,9 +575,81 @@ GCodeResult Accelerometers::StartAccelerometer(GCodeBuffer& gb, const StringRef&
 	numSamplesRequested = numSamples;
 	(void)mode;									// TODO implement mode
 
+	// D1 means analyse the data as it is collected and report the resonant frequencies at the end of the run
+	if (gb.Seen('D') && gb.GetUIValue() != 0)
+	{
+		if (analyser == nullptr)
+		{
+			analyser = new ResonanceAnalyser;
+		}
+# if SUPPORT_CAN_EXPANSION
+		analyser->Start(axes, device.boardAddress);
+# else
+		analyser->Start(axes, 0);
+# endif
+		analysing = true;
+	}
+	else
+	{
+		analysing = false;
+	}
+
+# if SUPPORT_CAN_EXPANSION
+	if (device.IsRemote())
+	{
+		expectedRemoteSampleNumber = 0;
+		expectedRemoteBoardAddress = device.boardAddress;
+		expectedRemoteAxes = axes;
+		numRemoteOverflows = 0;
+	}
+# endif
+
+	// K1 means stream the samples to the network instead of writing them to a file
+	if (gb.Seen('K') && gb.GetUIValue() != 0)
+	{
+		if (streamBuffer == nullptr)
+		{
+			streamBuffer = new StreamedSample[StreamBufferSamples];
+		}
+		{
+			TaskCriticalSectionLocker lock;					// stop the network task seeing a partly-reset stream
+			streamPutIndex = streamGetIndex = 0;
+			++streamRunNumber;
+		}
+		streamSamplesDropped = 0;
+		streamSampleRate = 0;
+		streamAxes = axes;
+		streamResolution = resolution;
+		streaming = true;
+		useBinaryFormat = false;
+		accelerometerFile = nullptr;
+		running = true;
+
+# if SUPPORT_CAN_EXPANSION
+		if (device.IsRemote())
+		{
+			const GCodeResult rslt = CanInterface::StartAccelerometer(device, axes, numSamples, mode, gb, reply);
+			if (rslt > GCodeResult::warning)
+			{
+				analysing = false;
+				running = streaming = false;
+				reprap.GetExpansion().AddAccelerometerRun(device.boardAddress, 0);
+			}
+			return rslt;
+		}
+# endif
+		return StartLocalCollection(reply);
+	}
+	streaming = false;
+
+	// B1 means write the file in binary format instead of CSV
+	useBinaryFormat = gb.Seen('B') && gb.GetUIValue() != 0;
+
 	// Create the file for saving the data. First calculate the approximate file size so that we can preallocate storage to reduce the risk of overflow.
 	const unsigned int numAxes = (axesRequested & 1u) + ((axesRequested >> 1) & 1u) + ((axesRequested >> 2) & 1u);
-	const uint32_t preallocSize = numSamplesRequested * ((numAxes * (3 + GetDecimalPlaces(resolution))) + 4);
+	const uint32_t preallocSize = (useBinaryFormat)
+									? sizeof(CaptureFileHeader) + numSamplesRequested * (sizeof(uint32_t) + numAxes * sizeof(int16_t)) + sizeof(CaptureFileTrailer)
+										: numSamplesRequested * ((numAxes * (3 + GetDecimalPlaces(resolution))) + 4);
 
 	String<MaxFilenameLength> accelerometerFileName;
 	if (gb.Seen('F'))
@@ -442,18 +663,20 @@ GCodeResult Accelerometers::StartAccelerometer(GCodeBuffer& gb, const StringRef&
 		const time_t time = reprap.GetPlatform().GetDateTime();
 		tm timeInfo;
 		gmtime_r(&time, &timeInfo);
-		accelerometerFileName.printf("0:/sys/accelerometer/%u_%04u-%02u-%02u_%02u.%02u.%02u.csv",
+		accelerometerFileName.printf("0:/sys/accelerometer/%u_%04u-%02u-%02u_%02u.%02u.%02u.%s",
 # if SUPPORT_CAN_EXPANSION
 										(unsigned int)device.boardAddress,
 # else
 										0,
 # endif
-										timeInfo.tm_year + 1900, timeInfo.tm_mon + 1, timeInfo.tm_mday, timeInfo.tm_hour, timeInfo.tm_min, timeInfo.tm_sec);
+										timeInfo.tm_year + 1900, timeInfo.tm_mon + 1, timeInfo.tm_mday, timeInfo.tm_hour, timeInfo.tm_min, timeInfo.tm_sec,
+										(useBinaryFormat) ? "bin" : "csv");
 	}
 	FileStore * const f = MassStorage::OpenFile(accelerometerFileName.c_str(), OpenMode::write, preallocSize);
 	if (f == nullptr)
 	{
 		reply.copy("Failed to create accelerometer data file");
+		analysing = false;
 # if SUPPORT_CAN_EXPANSION
 		if (device.IsRemote())
 		{
@@ -467,7 +690,26 @@ GCodeResult Accelerometers::StartAccelerometer(GCodeBuffer& gb, const StringRef&
 		return GCodeResult::error;
 	}
 
-	// Write the header line to the file
+	// Write the header to the file
+	if (useBinaryFormat)
+	{
+		if (captureWriter == nullptr)
+		{
+			captureWriter = new CaptureFileWriter;
+		}
+		// We don't know the sampling rate or resolution used by a remote accelerometer, but the trailer includes the resolution
+# if SUPPORT_CAN_EXPANSION
+		const bool isRemote = device.IsRemote();
+		const unsigned int boardAddress = device.boardAddress;
+# else
+		const bool isRemote = false;
+		const unsigned int boardAddress = 0;
+# endif
+		const CaptureFileHeader header(CaptureFileHeader::Source::accelerometer, CaptureFileHeader::ValueType::int16, numAxes, axes,
+										(isRemote) ? 0 : samplingRate, boardAddress, (isRemote) ? 0 : resolution, numSamples);
+		captureWriter->Start(f, header);
+	}
+	else
 	{
 		String<StringLength50> temp;
 		temp.printf("Sample");
@@ -478,18 +720,17 @@ GCodeResult Accelerometers::StartAccelerometer(GCodeBuffer& gb, const StringRef&
 		f->Write(temp.c_str());
 	}
 
+	accelerometerFile = f;
+	running = true;
+
 # if SUPPORT_CAN_EXPANSION
 	if (device.IsRemote())
 	{
-		expectedRemoteSampleNumber = 0;
-		expectedRemoteBoardAddress = device.boardAddress;
-		expectedRemoteAxes = axes;
-		numRemoteOverflows = 0;
-
-		accelerometerFile = f;
 		const GCodeResult rslt = CanInterface::StartAccelerometer(device, axes, numSamples, mode, gb, reply);
 		if (rslt > GCodeResult::warning)
 		{
+			analysing = false;
+			running = false;
 			accelerometerFile->Close();
 			accelerometerFile = nullptr;
 			MassStorage::Delete(accelerometerFileName.c_str(), false);
@@ -499,32 +740,14 @@ GCodeResult Accelerometers::StartAccelerometer(GCodeBuffer& gb, const StringRef&
 	}
 # endif
 
-	successfulStart = false;
-	failedStart = false;
-	accelerometerFile = f;
-	accelerometerTask->Give();
-	const uint32_t startTime = millis();
-	do
-	{
-		delay(5);
-		if (successfulStart)
-		{
-			return GCodeResult::ok;
-		}
-	} while (!failedStart && millis() - startTime < 1000);
-
-	reply.copy("Failed to start accelerometer data collection");
-	if (accelerometer->HasInterruptError())
-	{
-		reply.cat(": INT1 error");
-	}
-	if (accelerometerFile != nullptr)
+	const GCodeResult rslt = StartLocalCollection(reply);
+	if (rslt != GCodeResult::ok && accelerometerFile != nullptr)
 	{
 		accelerometerFile->Close();
 		accelerometerFile = nullptr;
 		MassStorage::Delete(accelerometerFileName.c_str(), false);
 	}
-	return GCodeResult::error;
+	return rslt;
 }
 
 bool Accelerometers::HasLocalAccelerometer() noexcept
@@ -542,6 +765,79 @@ unsigned int Accelerometers::GetLocalAccelerometerRuns() noexcept
 	return numLocalRunsCompleted;
 }
 
+// Get the results of the last analysis if it was of data from the specified board and is complete, else return null
+const ResonanceAnalyser *Accelerometers::GetAnalysis(uint8_t boardAddress) noexcept
+{
+	return (analyser != nullptr && !analysing && analyser->IsValid() && analyser->GetBoardAddress() == boardAddress) ? analyser : nullptr;
+}
+
+const ResonanceAnalyser *Accelerometers::GetLocalAnalysis() noexcept
+{
+# if SUPPORT_CAN_EXPANSION
+	return GetAnalysis(CanInterface::GetCanAddress());
+# else
+	return GetAnalysis(0);
+# endif
+}
+
+// Build the response to rr_accelerometer, which returns the next batch of streamed samples. The data is base64-encoded and comprises, for each sample,
+// the low 16 bits of the sample number followed by the value of each axis collected as a signed integer, all little-endian 16-bit values.
+// A value in g is the integer value divided by 2^(bits - 2). A jump in the sample number indicates that samples were dropped because the buffer was full.
+// When 'running' is false and no data is returned, the run has finished and all its data has been returned.
+OutputBuffer *Accelerometers::GetStreamResponse() noexcept
+{
+	OutputBuffer *response;
+	if (!OutputBuffer::Allocate(response))
+	{
+		return nullptr;
+	}
+
+	if (streamBuffer == nullptr || !streaming)
+	{
+		response->copy("{\"err\":1}");
+		return response;
+	}
+
+	const bool isRunning = running;						// read this first so that if it's false we know that all the data is already in the buffer
+	const uint32_t runNumber = streamRunNumber;
+	response->catf("{\"err\":0,\"run\":%" PRIu32 ",\"running\":%s,\"axes\":\"", runNumber, (isRunning) ? "true" : "false");
+	unsigned int numAxes = 0;
+	for (unsigned int axis = 0; axis < 3; ++axis)
+	{
+		if (streamAxes & (1u << axis))
+		{
+			response->cat((char)('X' + axis));
+			++numAxes;
+		}
+	}
+	response->catf("\",\"bits\":%u,\"rate\":%u,\"dropped\":%" PRIu32 ",\"data\":\"", streamResolution, streamSampleRate, streamSamplesDropped);
+
+	Base64Encoder encoder(response);
+	const size_t bytesPerSample = (numAxes + 1) * sizeof(uint16_t);
+	size_t getIndex = streamGetIndex;
+	for (size_t bytesDone = 0; getIndex != streamPutIndex && bytesDone + bytesPerSample <= MaxStreamBytesPerResponse; bytesDone += bytesPerSample)
+	{
+		const StreamedSample& sample = streamBuffer[getIndex];
+		encoder.Add16(sample.sampleNumber);
+		for (size_t i = 0; i < numAxes; ++i)
+		{
+			encoder.Add16((uint16_t)sample.values[i]);
+		}
+		getIndex = (getIndex + 1) % StreamBufferSamples;
+	}
+	encoder.Flush();
+	response->cat("\"}");
+
+	{
+		TaskCriticalSectionLocker lock;
+		if (streamRunNumber == runNumber)				// if a new stream was started while we were building the response then it has reset the indices
+		{
+			streamGetIndex = getIndex;
+		}
+	}
+	return response;
+}
+
 void Accelerometers::Exit() noexcept
 {
 	if (accelerometerTask != nullptr)
@@ -563,23 +859,33 @@ void Accelerometers::ProcessReceivedData(CanAddress src, const CanMessageAcceler
 	}
 # endif
 
-	FileStore * const f = accelerometerFile;
-	if (f != nullptr)
+	if (running)
 	{
+		FileStore * const f = accelerometerFile;		// this is null if we are streaming the data
 		if (msgLen < msg.GetActualDataLength())
 		{
-			f->Write("Received bad data\n");
-			f->Truncate();				// truncate the file in case we didn't write all the preallocated space
-			f->Close();
+			if (f != nullptr)
+			{
+				WriteEndOfRun(f, CaptureFileTrailer::Status::badData, "Received bad data\n", 0, numRemoteOverflows, 0);
+				f->Truncate();				// truncate the file in case we didn't write all the preallocated space
+				f->Close();
+			}
 			accelerometerFile = nullptr;
+			running = false;
+			analysing = false;
 			reprap.GetExpansion().AddAccelerometerRun(src, 0);
 		}
 		else if (msg.axes != expectedRemoteAxes || msg.firstSampleNumber != expectedRemoteSampleNumber || src != expectedRemoteBoardAddress)
 		{
-			f->Write("Received mismatched data\n");
-			f->Truncate();				// truncate the file in case we didn't write all the preallocated space
-			f->Close();
+			if (f != nullptr)
+			{
+				WriteEndOfRun(f, CaptureFileTrailer::Status::dataLost, "Received mismatched data\n", 0, numRemoteOverflows, 0);
+				f->Truncate();				// truncate the file in case we didn't write all the preallocated space
+				f->Close();
+			}
 			accelerometerFile = nullptr;
+			running = false;
+			analysing = false;
 			reprap.GetExpansion().AddAccelerometerRun(src, 0);
 		}
 		else
@@ -596,12 +902,12 @@ void Accelerometers::ProcessReceivedData(CanAddress src, const CanMessageAcceler
 			{
 				++numRemoteOverflows;
 			}
+			streamResolution = receivedResolution;
 
 			while (numSamples != 0)
 			{
-				String<StringLength50> temp;
-				temp.printf("%u", expectedRemoteSampleNumber);
-				++expectedRemoteSampleNumber;
+				float values[3];
+				int16_t rawValues[3];
 
 				for (unsigned int axis = 0; axis < numAxes; ++axis)
 				{
@@ -628,25 +934,52 @@ void Accelerometers::ProcessReceivedData(CanAddress src, const CanMessageAcceler
 					}
 
 					// Convert it to a float number of g
-					const float fVal = (float)(int16_t)val/(float)(1u << GetBitsAfterPoint(receivedResolution));
-
-					// Append it to the buffer
-					temp.catf(",%.*f", decimalPlaces, (double)fVal);
+					rawValues[axis] = (int16_t)val;
+					values[axis] = (float)(int16_t)val/(float)(1u << GetBitsAfterPoint(receivedResolution));
 				}
 
-				temp.cat('\n');
-				f->Write(temp.c_str());
+				if (analysing)
+				{
+					analyser->AddSample(values);
+				}
+				if (useBinaryFormat)
+				{
+					captureWriter->AddRecord(expectedRemoteSampleNumber, rawValues);
+				}
+				else if (f != nullptr)
+				{
+					String<StringLength50> temp;
+					temp.printf("%u", expectedRemoteSampleNumber);
+					for (unsigned int axis = 0; axis < numAxes; ++axis)
+					{
+						temp.catf(",%.*f", decimalPlaces, (double)values[axis]);
+					}
+					temp.cat('\n');
+					f->Write(temp.c_str());
+				}
+				else
+				{
+					PutStreamSample(expectedRemoteSampleNumber, rawValues, numAxes);
+				}
+				++expectedRemoteSampleNumber;
 				--numSamples;
 			}
 
 			if (msg.lastPacket)
 			{
-				String<StringLength50> temp;
-				temp.printf("Rate %u, overflows %u\n", (unsigned int)msg.actualSampleRate, numRemoteOverflows);
-				f->Write(temp.c_str());
-				f->Truncate();				// truncate the file in case we didn't write all the preallocated space
-				f->Close();
+				streamSampleRate = msg.actualSampleRate;
+				if (f != nullptr)
+				{
+					WriteEndOfRun(f, CaptureFileTrailer::Status::ok, nullptr, msg.actualSampleRate, numRemoteOverflows, receivedResolution);
+				}
+				FinishAnalysis((useBinaryFormat) ? nullptr : f, msg.actualSampleRate);
+				if (f != nullptr)
+				{
+					f->Truncate();				// truncate the file in case we didn't write all the preallocated space
+					f->Close();
+				}
 				accelerometerFile = nullptr;
+				running = false;
 				reprap.GetExpansion().AddAccelerometerRun(src, expectedRemoteSampleNumber);
 			}
 		}
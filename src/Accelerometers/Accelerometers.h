@@ -19,12 +19,16 @@
 #endif
 
 class CanMessageAccelerometerData;
+class ResonanceAnalyser;
 
 namespace Accelerometers
 {
 	bool HasLocalAccelerometer() noexcept;
 	unsigned int GetLocalAccelerometerRuns() noexcept;
 	unsigned int GetLocalAccelerometerDataPoints() noexcept;
+	const ResonanceAnalyser *GetAnalysis(uint8_t boardAddress) noexcept;
+	const ResonanceAnalyser *GetLocalAnalysis() noexcept;
+	OutputBuffer *GetStreamResponse() noexcept;
 	GCodeResult ConfigureAccelerometer(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);
 	GCodeResult StartAccelerometer(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);
 	void Exit() noexcept;
@@ -14,7 +14,10 @@
 
 constexpr uint32_t Lis3dSpiTimeout = 25;							// timeout while waiting for the SPI bus
 constexpr uint32_t DataCollectionTimeout = (1000 * 32)/400 + 2;		// timeout whole collecting data, enough to fill the FIFO at 400Hz
-constexpr uint8_t FifoInterruptLevel = 20;							// how full the FIFO must get before we want an interrupt
+constexpr unsigned int FifoSize = 32;								// the number of samples that the FIFO holds
+constexpr unsigned int FifoHeadroomMillis = 8;						// how long the FIFO must be able to go on collecting after the watermark interrupt before it overflows
+constexpr unsigned int MinFifoWatermark = 8;						// the lowest FIFO watermark we use, to limit the interrupt rate and the number of short SPI transfers
+constexpr unsigned int MaxFifoWatermark = 28;						// the highest FIFO watermark we use
 const SpiMode lisMode = SpiMode::mode3;
 
 static constexpr uint8_t WhoAmIValue_3DH = 0x33;
@@ -98,7 +101,7 @@ bool LIS3DH::Configure(uint16_t& samplingRate, uint8_t& resolution) noexcept
 		if (ok)
 		{
 			// Set the fifo mode
-			ok = WriteRegister(LisRegister::FifoControl, (2u << 5) | (FifoInterruptLevel - 1));
+			ok = WriteRegister(LisRegister::FifoControl, (2u << 5) | (GetFifoWatermark(samplingRate) - 1));
 		}
 	}
 	else
@@ -159,12 +162,20 @@ bool LIS3DH::Configure(uint16_t& samplingRate, uint8_t& resolution) noexcept
 		if (ok)
 		{
 			// Set the fifo mode
-			ok = WriteRegister(LisRegister::FifoControl, (2u << 6) | (FifoInterruptLevel - 1));
+			ok = WriteRegister(LisRegister::FifoControl, (2u << 6) | (GetFifoWatermark(samplingRate) - 1));
 		}
 	}
 	return ok;
 }
 
+// Choose the FIFO watermark for the sampling rate. We want as few interrupts and SPI transfers as possible, but the FIFO must still have room for
+// FifoHeadroomMillis of data when the watermark interrupt occurs, so that we don't lose samples if this task is slow to respond.
+/*static*/ uint8_t LIS3DH::GetFifoWatermark(uint16_t samplingRate) noexcept
+{
+	const unsigned int headroom = (samplingRate * FifoHeadroomMillis + 999)/1000;
+	return (uint8_t)constrain<unsigned int>((headroom >= FifoSize) ? 0 : FifoSize - headroom, MinFifoWatermark, MaxFifoWatermark);
+}
+
 void Int1Interrupt(CallbackParameter p) noexcept;						// forward declaration
 
 // Start collecting data, returning true if successful
@@ -219,7 +230,7 @@ unsigned int LIS3DH::CollectData(const uint16_t **collectedData, uint16_t &dataR
 	uint8_t numToRead = fifoStatus & 0x1F;
 	if (numToRead == 0 && (fifoStatus & 0x20) == 0)
 	{
-		numToRead = 32;
+		numToRead = FifoSize;
 	}
 
 	if (numToRead != 0)
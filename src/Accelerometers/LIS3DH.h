@@ -58,6 +58,8 @@ private:
 		FifoSource = 0x2F
 	};
 
+	static uint8_t GetFifoWatermark(uint16_t samplingRate) noexcept;
+
 	bool ReadRegisters(LisRegister reg, size_t numToRead) noexcept;
 	bool WriteRegisters(LisRegister reg, size_t numToWrite) noexcept;
 	bool ReadRegister(LisRegister reg, uint8_t& val) noexcept;
@@ -0,0 +1,245 @@
+/*
+ * ResonanceAnalyser.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "ResonanceAnalyser.h"
+
+#if SUPPORT_ACCELEROMETERS
+
+// Object model table and functions
+// Note: if using GCC version 7.3.1 20180622 and lambda functions are used in this table, you must compile this file with option -std=gnu++17.
+// Otherwise the table will be allocated in RAM instead of flash, which wastes too much RAM.
+
+// Macro to build a standard lambda function that includes the necessary type conversions
+#define OBJECT_MODEL_FUNC(...) OBJECT_MODEL_FUNC_BODY(ResonanceAnalyser, __VA_ARGS__)
+#define OBJECT_MODEL_FUNC_IF(...) OBJECT_MODEL_FUNC_IF_BODY(ResonanceAnalyser, __VA_ARGS__)
+
+constexpr ObjectModelArrayDescriptor ResonanceAnalyser::axesArrayDescriptor =
+{
+	nullptr,					// no lock needed
+	[] (const ObjectModel *self, const ObjectExplorationContext& context) noexcept -> size_t { return ((const ResonanceAnalyser*)self)->numAxes; },
+	[] (const ObjectModel *self, ObjectExplorationContext& context) noexcept -> ExpressionValue { return ExpressionValue(self, 1); }
+};
+
+constexpr ObjectModelTableEntry ResonanceAnalyser::objectModelTable[] =
+{
+	// Within each group, these entries must be in alphabetical order
+	// 0. ResonanceAnalyser members
+	{ "axes",				OBJECT_MODEL_FUNC_NOSELF(&axesArrayDescriptor),													ObjectModelEntryFlags::none },
+	{ "rate",				OBJECT_MODEL_FUNC((int32_t)self->sampleRate),														ObjectModelEntryFlags::none },
+	{ "windows",			OBJECT_MODEL_FUNC((int32_t)self->numWindows),														ObjectModelEntryFlags::none },
+
+	// 1. ResonanceAnalyser.axes[] members
+	{ "axis",				OBJECT_MODEL_FUNC(self->results[context.GetLastIndex()].letter),									ObjectModelEntryFlags::none },
+	{ "damping",			OBJECT_MODEL_FUNC(self->results[context.GetLastIndex()].dampingRatio, 3),							ObjectModelEntryFlags::none },
+	{ "frequency",			OBJECT_MODEL_FUNC(self->results[context.GetLastIndex()].frequency, 1),								ObjectModelEntryFlags::none },
+};
+
+constexpr uint8_t ResonanceAnalyser::objectModelTableDescriptor[] = { 2, 3, 3 };
+
+DEFINE_GET_OBJECT_MODEL_TABLE(ResonanceAnalyser)
+
+ResonanceAnalyser::ResonanceAnalyser() noexcept
+	: numSamplesInWindow(0), numWindows(0), sampleRate(0), numAxes(0), boardAddress(0), valid(false)
+{
+	for (size_t k = 0; k <= NumBins; ++k)
+	{
+		cosTable[k] = cosf((2 * Pi * k)/FftSize);
+	}
+}
+
+// Start a new analysis. Bits 0, 1 and 2 of p_axes say whether X, Y and Z data will be supplied.
+void ResonanceAnalyser::Start(uint8_t p_axes, uint8_t p_boardAddress) noexcept
+{
+	valid = false;
+	boardAddress = p_boardAddress;
+	numAxes = 0;
+	for (size_t axis = 0; axis < MaxAxes; ++axis)
+	{
+		if (p_axes & (1u << axis))
+		{
+			results[numAxes].letter = 'X' + axis;
+			++numAxes;
+		}
+	}
+	memset(powerSpectra, 0, sizeof(powerSpectra));
+	numSamplesInWindow = 0;
+	numWindows = 0;
+	sampleRate = 0;
+}
+
+// Add one sample. Any partial window at the end of the run is discarded.
+void ResonanceAnalyser::AddSample(const float *values) noexcept
+{
+	for (size_t i = 0; i < numAxes; ++i)
+	{
+		samples[i][numSamplesInWindow] = values[i];
+	}
+	++numSamplesInWindow;
+	if (numSamplesInWindow == FftSize)
+	{
+		ProcessWindow();
+		numSamplesInWindow = 0;
+	}
+}
+
+// Transform the current window for each axis and add its power spectrum to the totals
+void ResonanceAnalyser::ProcessWindow() noexcept
+{
+	for (size_t i = 0; i < numAxes; ++i)
+	{
+		float * const re = samples[i];
+
+		// Remove the mean, which includes gravity, then apply a Hann window
+		float sum = 0.0;
+		for (size_t n = 0; n < FftSize; ++n)
+		{
+			sum += re[n];
+		}
+		const float mean = sum/FftSize;
+		for (size_t n = 0; n < FftSize; ++n)
+		{
+			const float cosVal = (n <= NumBins) ? cosTable[n] : cosTable[FftSize - n];
+			re[n] = (re[n] - mean) * (0.5 - 0.5 * cosVal);
+			workIm[n] = 0.0;
+		}
+
+		Fft(re, workIm);
+
+		float * const spectrum = powerSpectra[i];
+		for (size_t k = 0; k < NumBins; ++k)
+		{
+			spectrum[k] += fsquare(re[k]) + fsquare(workIm[k]);
+		}
+	}
+	++numWindows;
+}
+
+// In-place iterative radix-2 decimation-in-time FFT
+void ResonanceAnalyser::Fft(float *re, float *im) const noexcept
+{
+	// Put the data in bit-reversed order
+	for (size_t i = 1, j = 0; i < FftSize; ++i)
+	{
+		size_t bit = FftSize >> 1;
+		while (j & bit)
+		{
+			j ^= bit;
+			bit >>= 1;
+		}
+		j ^= bit;
+		if (i < j)
+		{
+			std::swap(re[i], re[j]);
+			std::swap(im[i], im[j]);
+		}
+	}
+
+	// Do the butterflies
+	for (size_t len = 2; len <= FftSize; len <<= 1)
+	{
+		const size_t halfLen = len >> 1;
+		const size_t tableStep = FftSize/len;
+		for (size_t start = 0; start < FftSize; start += len)
+		{
+			for (size_t k = 0; k < halfLen; ++k)
+			{
+				const float wr = cosTable[k * tableStep];
+				const float wi = -GetSin(k * tableStep);
+				const size_t top = start + k;
+				const size_t bottom = top + halfLen;
+				const float xr = re[bottom] * wr - im[bottom] * wi;
+				const float xi = re[bottom] * wi + im[bottom] * wr;
+				re[bottom] = re[top] - xr;
+				im[bottom] = im[top] - xi;
+				re[top] += xr;
+				im[top] += xi;
+			}
+		}
+	}
+}
+
+// Finish the analysis and find the resonant peak for each axis
+void ResonanceAnalyser::Finish(unsigned int p_sampleRate) noexcept
+{
+	sampleRate = p_sampleRate;
+	if (numWindows == 0 || sampleRate == 0)
+	{
+		return;										// not enough data, so leave the results invalid
+	}
+
+	const float binWidth = (float)sampleRate/FftSize;
+	for (size_t i = 0; i < numAxes; ++i)
+	{
+		const float *spectrum = powerSpectra[i];
+		AxisResult& result = results[i];
+
+		// Find the highest bin, ignoring low frequencies
+		const size_t minBin = max<size_t>(lrintf(ceilf(MinPeakFrequency/binWidth)), 2);
+		size_t peakBin = minBin;
+		for (size_t k = minBin + 1; k < NumBins - 1; ++k)
+		{
+			if (spectrum[k] > spectrum[peakBin])
+			{
+				peakBin = k;
+			}
+		}
+
+		// Refine the peak frequency by fitting a parabola through the highest bin and its neighbours
+		const float peakPower = spectrum[peakBin];
+		const float denominator = spectrum[peakBin - 1] - 2 * peakPower + spectrum[peakBin + 1];
+		const float offset = (denominator < 0.0) ? 0.5 * (spectrum[peakBin - 1] - spectrum[peakBin + 1])/denominator : 0.0;
+		result.frequency = (peakBin + offset) * binWidth;
+
+		// Find the half-power points by interpolating between the bins either side of where the power crosses half the peak value
+		const float halfPower = 0.5 * peakPower;
+		size_t lowBin = peakBin;
+		while (lowBin > 1 && spectrum[lowBin - 1] > halfPower)
+		{
+			--lowBin;
+		}
+		const float lowFraction = (spectrum[lowBin - 1] < halfPower) ? (spectrum[lowBin] - halfPower)/(spectrum[lowBin] - spectrum[lowBin - 1]) : 0.0;
+		const float lowFreq = (lowBin - lowFraction) * binWidth;
+		size_t highBin = peakBin;
+		while (highBin < NumBins - 2 && spectrum[highBin + 1] > halfPower)
+		{
+			++highBin;
+		}
+		const float highFraction = (spectrum[highBin + 1] < halfPower) ? (spectrum[highBin] - halfPower)/(spectrum[highBin] - spectrum[highBin + 1]) : 0.0;
+		const float highFreq = (highBin + highFraction) * binWidth;
+
+		// The Hann window alone gives a half-power bandwidth of about 1.44 bins, so remove that before estimating the damping ratio as bandwidth/(2 * centre frequency)
+		const float windowBandwidth = 1.44 * binWidth;
+		const float measuredBandwidth = highFreq - lowFreq;
+		const float bandwidth = (measuredBandwidth > windowBandwidth) ? fastSqrtf(fsquare(measuredBandwidth) - fsquare(windowBandwidth)) : 0.0;
+		result.dampingRatio = constrain<float>(bandwidth/(2 * result.frequency), MinDampingRatio, 0.99);
+	}
+	valid = true;
+}
+
+// Append a summary of the results to 'reply', including the M593 parameters we suggest
+void ResonanceAnalyser::AppendResults(const StringRef& reply) const noexcept
+{
+	if (!valid)
+	{
+		reply.catf("Resonance analysis needs at least %u samples", (unsigned int)FftSize);
+		return;
+	}
+
+	reply.catf("Resonance analysis of %u windows at %uHz:", numWindows, sampleRate);
+	for (size_t i = 0; i < numAxes; ++i)
+	{
+		reply.catf(" %c %.1fHz damping %.3f", results[i].letter, (double)results[i].frequency, (double)results[i].dampingRatio);
+		if (results[i].letter != 'Z')
+		{
+			reply.catf(" (M593%s F%.1f S%.3f)", (results[i].letter == 'Y') ? " Y1" : "", (double)results[i].frequency, (double)results[i].dampingRatio);
+		}
+	}
+}
+
+#endif	// SUPPORT_ACCELEROMETERS
+
+// End
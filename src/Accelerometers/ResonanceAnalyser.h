@@ -0,0 +1,72 @@
+/*
+ * ResonanceAnalyser.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  This class analyses accelerometer data as it is collected, so that resonant frequencies can be found without downloading the CSV file.
+ *  Samples for each axis are split into consecutive windows of FftSize samples. Each window has its mean removed, a Hann window applied,
+ *  and is transformed using a radix-2 FFT. The power spectra of all windows are summed, and at the end of the run we find the highest peak
+ *  above MinPeakFrequency for each axis and estimate its damping ratio from the half-power bandwidth.
+ */
+
+#ifndef SRC_ACCELEROMETERS_RESONANCEANALYSER_H_
+#define SRC_ACCELEROMETERS_RESONANCEANALYSER_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_ACCELEROMETERS
+
+#include <ObjectModel/ObjectModel.h>
+
+class ResonanceAnalyser INHERIT_OBJECT_MODEL
+{
+public:
+	static constexpr size_t FftSize = 512;								// must be a power of 2
+	static constexpr size_t NumBins = FftSize/2;
+	static constexpr size_t MaxAxes = 3;
+	static constexpr float MinPeakFrequency = 10.0;						// we ignore peaks below this frequency
+	static constexpr float MinDampingRatio = 0.01;						// the damping ratio we report if the peak is too narrow to measure
+
+	ResonanceAnalyser() noexcept;
+
+	void Start(uint8_t p_axes, uint8_t p_boardAddress) noexcept;		// start a new analysis, discarding any previous results
+	void AddSample(const float *values) noexcept;						// add one sample, comprising a value in g for each axis being analysed, in XYZ order
+	void Finish(unsigned int p_sampleRate) noexcept;					// finish the analysis given the actual sampling rate
+
+	bool IsValid() const noexcept { return valid; }
+	uint8_t GetBoardAddress() const noexcept { return boardAddress; }
+	void AppendResults(const StringRef& reply) const noexcept;
+
+protected:
+	DECLARE_OBJECT_MODEL
+	OBJECT_MODEL_ARRAY(axes)
+
+private:
+	struct AxisResult
+	{
+		float frequency;
+		float dampingRatio;
+		char letter;
+	};
+
+	void ProcessWindow() noexcept;
+	void Fft(float *re, float *im) const noexcept;
+	float GetSin(size_t index) const noexcept { return cosTable[(index <= NumBins/2) ? NumBins/2 - index : index - NumBins/2]; }	// sin(2*pi*index/FftSize) for index <= NumBins
+
+	float samples[MaxAxes][FftSize];									// the samples in the current window, transformed in place
+	float workIm[FftSize];												// the imaginary parts during the FFT
+	float powerSpectra[MaxAxes][NumBins];								// the summed power spectra
+	float cosTable[NumBins + 1];										// cos(2*pi*k/FftSize) for k = 0..NumBins
+	AxisResult results[MaxAxes];
+	size_t numSamplesInWindow;
+	unsigned int numWindows;
+	unsigned int sampleRate;
+	uint8_t numAxes;
+	uint8_t boardAddress;
+	bool valid;
+};
+
+#endif	// SUPPORT_ACCELEROMETERS
+
+#endif /* SRC_ACCELEROMETERS_RESONANCEANALYSER_H_ */
@@ -11,6 +11,7 @@
 
 #include "CanMotion.h"
 #include "CommandProcessor.h"
+#include "ExpansionManager.h"
 #include "CanMessageGenericConstructor.h"
 #include <CanMessageBuffer.h>
 #include <CanMessageGenericTables.h>
@@ -24,6 +25,7 @@
 #include <GCodes/GCodeException.h>
 #include <GCodes/GCodeBuffer/GCodeBuffer.h>
 #include <ClosedLoop/ClosedLoop.h>
+#include <Platform/EventTrace.h>
 
 #if HAS_SBC_INTERFACE
 # include "SBC/SbcInterface.h"
@@ -138,6 +140,31 @@ static CanDevice *can0dev = nullptr;
 static unsigned int txTimeouts[Can0Config.numTxBuffers + 1] = { 0 };
 static uint32_t lastCancelledId = 0;
 
+// Statistics for each transmit buffer. The message, byte and bit counts are cumulative so that users of the object model can work out rates from them.
+// Diagnostics reports the changes since the previous report and resets the wait times.
+struct TxBufferStats
+{
+	uint32_t messagesSent;
+	uint32_t bytesSent;
+	uint32_t bitsSent;										// estimated, see EstimateFrameBits
+	uint32_t messagesAtLastReport;
+	uint32_t bytesAtLastReport;
+	uint32_t bitsAtLastReport;
+	uint32_t totalWaitTicks;								// time spent waiting to send messages since the last report
+	uint32_t maxWaitTicks;
+};
+
+static TxBufferStats txStats[Can0Config.numTxBuffers + 1] = { };
+static uint32_t whenStatsLastReported = 0;
+
+// Statistics for requests that expect a reply
+static uint32_t requestsSent = 0;
+static uint32_t replyTimeouts = 0;
+static uint32_t requestsAtLastReport = 0;
+static uint32_t replyTimeoutsAtLastReport = 0;
+static uint32_t repliesSinceLastReport = 0;
+static uint32_t totalReplyTimeSinceLastReport = 0;			// in milliseconds
+
 #if DUAL_CAN
 
 constexpr CanDevice::Config Can1Config =
@@ -175,6 +202,23 @@ constexpr auto TxBufferIndexMotion = CanDevice::TxBufferNumber::fifo;				// we s
 constexpr auto TxBufferIndexMotion = CanDevice::TxBufferNumber::buffer5;
 #endif
 
+struct TxBufferName
+{
+	CanDevice::TxBufferNumber buffer;
+	const char *_ecv_array name;
+};
+
+// The transmit buffers in the order that we report them
+constexpr TxBufferName TxBufferNames[] =
+{
+	{ TxBufferIndexMotion, "motion" },
+	{ TxBufferIndexRequest, "request" },
+	{ TxBufferIndexResponse, "response" },
+	{ TxBufferIndexBroadcast, "broadcast" },
+	{ TxBufferIndexTimeSync, "timeSync" },
+	{ TxBufferIndexUrgent, "urgent" },
+};
+
 // Receive buffer/FIFO usage. All dedicated buffer numbers must be < Can0Config.numRxBuffers.
 constexpr auto RxBufferIndexBroadcast = CanDevice::RxBufferNumber::fifo0;
 constexpr auto RxBufferIndexRequest = CanDevice::RxBufferNumber::fifo0;
@@ -195,9 +239,41 @@ static Task<CanSenderTaskStackWords> canClockTask;
 static CanMessageBuffer * volatile pendingMotionBuffers = nullptr;
 static CanMessageBuffer * volatile lastMotionBuffer;			// only valid when pendingBuffers != nullptr
 
-#if 0	//unused
 static unsigned int numPendingMotionBuffers = 0;
-#endif
+static unsigned int maxPendingMotionBuffers = 0;				// the largest number of motion messages waiting to be sent since the last diagnostics report
+
+// Motion message latency measurement. The pending motion buffers are sent in the order they were queued, so we keep the times at which they were queued in a ring.
+static uint32_t motionQueuedTimes[NumCanBuffers];
+static unsigned int motionQueuedTimesHead = 0;						// index of the time for the buffer at the head of pendingMotionBuffers
+
+constexpr unsigned int NumMotionLatencyBuckets = 8;
+constexpr uint32_t MotionLatencyBucketMicroseconds = 250;			// the upper limit of the first bucket, doubled for each subsequent bucket
+static unsigned int motionLatencyCounts[NumMotionLatencyBuckets] = { 0 };		// histogram of the times from queueing a motion message to handing it to the CAN controller
+static int32_t minMotionLeadTicks = std::numeric_limits<int32_t>::max();		// the smallest time between sending a movement message and when it is due to be executed
+static unsigned int lateMovementMessages = 0;					// how many movement messages were sent after they were due to be executed
+
+// Estimate the number of bits on the bus in a CAN-FD frame with an extended ID and no bit rate switch, ignoring stuff bits.
+// The data is padded to the next size that the DLC can represent.
+static uint32_t EstimateFrameBits(size_t dataLength) noexcept
+{
+	constexpr size_t FdDataSizes[] = { 8, 12, 16, 20, 24, 32, 48, 64 };
+	size_t paddedLength = 64;
+	for (size_t sz : FdDataSizes)
+	{
+		if (dataLength <= sz)
+		{
+			paddedLength = sz;
+			break;
+		}
+	}
+	constexpr uint32_t FrameOverheadBits = 67;						// SOF, arbitration field, control field, CRC field, ACK, EOF and interframe space
+	return FrameOverheadBits + (((paddedLength > 16) ? 4 : 0) + paddedLength * 8);		// the CRC is 4 bits longer for more than 16 bytes of data
+}
+
+static inline uint32_t StepClocksToMicroseconds(uint32_t ticks) noexcept
+{
+	return (uint32_t)(((uint64_t)ticks * 1000000u)/StepClockRate);
+}
 
 extern "C" [[noreturn]] void CanSenderLoop(void *) noexcept;
 extern "C" [[noreturn]] void CanClockLoop(void *) noexcept;
@@ -292,6 +368,8 @@ void CanInterface::Init() noexcept
 {
 	CanMessageBuffer::Init(NumCanBuffers);
 	pendingMotionBuffers = nullptr;
+	numPendingMotionBuffers = motionQueuedTimesHead = 0;
+	whenStatsLastReported = millis();
 
 	transactionMutex.Create("CanTrans");
 
@@ -469,12 +547,74 @@ uint16_t CanInterface::GetTimeStampPeriod() noexcept
 // Send a message on the CAN FD channel and record any errors
 static void SendCanMessage(CanDevice::TxBufferNumber whichBuffer, uint32_t timeout, CanMessageBuffer *buffer) noexcept
 {
+	const uint32_t startTicks = StepTimer::GetTimerTicks();
 	const uint32_t cancelledId = can0dev->SendMessage(whichBuffer, timeout, buffer);
+	const uint32_t waitTicks = StepTimer::GetTimerTicks() - startTicks;
+#if SUPPORT_EVENT_TRACE
+	EventTrace::Record(EventTrace::EventId::canSend, waitTicks, ((uint32_t)buffer->id.MsgType() << 16) | buffer->dataLength);
+#endif
+
+	TxBufferStats& stats = txStats[(unsigned int)whichBuffer];
+	stats.totalWaitTicks += waitTicks;
+	if (waitTicks > stats.maxWaitTicks)
+	{
+		stats.maxWaitTicks = waitTicks;
+	}
+
 	if (cancelledId != 0)
 	{
 		++txTimeouts[(unsigned int)whichBuffer];
 		lastCancelledId = cancelledId;
 	}
+	else
+	{
+		++stats.messagesSent;
+		stats.bytesSent += buffer->dataLength;
+		stats.bitsSent += EstimateFrameBits(buffer->dataLength);
+	}
+}
+
+// Record how long we waited for the reply to a request
+static void RecordReplyTime(uint32_t waitedFor, CanMessageType msgType) noexcept
+{
+	++repliesSinceLastReport;
+	totalReplyTimeSinceLastReport += waitedFor;
+	if (waitedFor > longestWaitTime)
+	{
+		longestWaitTime = waitedFor;
+		longestWaitMessageType = (uint16_t)msgType;
+	}
+}
+
+// Record how long a motion message waited to be sent and, if it was a movement message, how long before it was due to be executed it was sent
+static void RecordMotionLatency(const CanMessageBuffer *buf, uint32_t whenQueued) noexcept
+{
+	const uint32_t now = StepTimer::GetTimerTicks();
+	const uint32_t latency = StepClocksToMicroseconds(now - whenQueued);
+	unsigned int bucket = 0;
+	while (bucket + 1 < NumMotionLatencyBuckets && latency >= MotionLatencyBucketMicroseconds << bucket)
+	{
+		++bucket;
+	}
+	++motionLatencyCounts[bucket];
+
+	const CanMessageType msgType = buf->id.MsgType();
+	if (msgType == CanMessageType::movementLinear || msgType == CanMessageType::movementLinearShaped)
+	{
+#if USE_REMOTE_INPUT_SHAPING
+		const int32_t leadTicks = (int32_t)(buf->msg.moveLinearShaped.whenToExecute - now);
+#else
+		const int32_t leadTicks = (int32_t)(buf->msg.moveLinear.whenToExecute - now);
+#endif
+		if (leadTicks < minMotionLeadTicks)
+		{
+			minMotionLeadTicks = leadTicks;
+		}
+		if (leadTicks < 0)
+		{
+			++lateMovementMessages;
+		}
+	}
 }
 
 //TODO can we get rid of the CanSender task if we send movement messages via the Tx FIFO?
@@ -516,18 +656,20 @@ extern "C" [[noreturn]] void CanSenderLoop(void *) noexcept
 				else if (pendingMotionBuffers != nullptr)
 				{
 					CanMessageBuffer *buf;
+					uint32_t whenQueued;
 					{
 						TaskCriticalSectionLocker lock;
 						buf = pendingMotionBuffers;
 						pendingMotionBuffers = buf->next;
-#if 0	//unused
 						--numPendingMotionBuffers;
-#endif
+						whenQueued = motionQueuedTimes[motionQueuedTimesHead];
+						motionQueuedTimesHead = (motionQueuedTimesHead + 1) % NumCanBuffers;
 					}
 
 					// Send the message
 					SendCanMessage(TxBufferIndexMotion, MaxMotionSendWait, buf);
 					reprap.GetPlatform().OnProcessingCanMessage();
+					RecordMotionLatency(buf, whenQueued);
 
 #ifdef CAN_DEBUG
 					// Display a debug message too
@@ -644,9 +786,278 @@ extern "C" [[noreturn]] void CanClockLoop(void *) noexcept
 
 // Members of namespace CanInterface, and associated local functions
 
-template<class T> static GCodeResult SetRemoteDriverValues(const CanDriversData<T>& data, const StringRef& reply, CanMessageType mt) noexcept
+// A request that has been sent as part of a batch and the state of its reply
+struct BatchedRequest
+{
+	CanMessageBuffer *buf;
+	CanAddress dest;
+	CanRequestId rid;
+	CanMessageType msgType;
+	uint8_t fragmentsReceived;
+	bool done;
+};
+
+constexpr size_t MaxBatchedRequests = 4;		// the most requests we send before waiting for their replies. Must be small enough to leave CAN buffers for motion.
+
+// A request whose standard reply we don't wait for. Any reply is collected by the next transaction or by PollDeferredReplies, and errors are reported as messages.
+struct DeferredRequest
+{
+	uint32_t whenSent;
+	CanAddress dest;
+	CanRequestId rid;
+	CanMessageType msgType;
+};
+
+constexpr size_t MaxDeferredRequests = 8;		// the most requests that can be waiting for replies that we don't wait for
+
+static DeferredRequest deferredRequests[MaxDeferredRequests];
+static volatile size_t numDeferredRequests = 0;	// only changed while holding transactionMutex
+
+// If this message is a standard reply to a deferred request, report any text in it and return true. Must be called while holding transactionMutex.
+static bool CheckDeferredReply(const CanMessageBuffer *buf) noexcept
+{
+	if (buf->id.MsgType() == CanMessageType::standardReply)
+	{
+		for (size_t i = 0; i < numDeferredRequests; ++i)
+		{
+			DeferredRequest& req = deferredRequests[i];
+			if (buf->id.Src() == req.dest && buf->msg.standardReply.requestId == req.rid)
+			{
+				const GCodeResult rslt = (GCodeResult)buf->msg.standardReply.resultCode;
+				const size_t textLength = buf->msg.standardReply.GetTextLength(buf->dataLength);
+				if (textLength != 0)
+				{
+					reprap.GetPlatform().MessageF((rslt > GCodeResult::warning) ? ErrorMessage : (rslt == GCodeResult::warning) ? WarningMessage : GenericMessage,
+													"CAN addr %u: %.*s\n", req.dest, textLength, buf->msg.standardReply.text);
+				}
+				if (buf->msg.standardReply.fragmentNumber == 0)
+				{
+					RecordReplyTime(millis() - req.whenSent, req.msgType);
+				}
+				if (!buf->msg.standardReply.moreFollows)
+				{
+					deferredRequests[i] = deferredRequests[numDeferredRequests - 1];
+					--numDeferredRequests;
+				}
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+// Collect any replies to deferred requests that have already arrived, and report the requests that have timed out. Must be called while holding transactionMutex.
+static void CollectDeferredReplies() noexcept
+{
+	if (numDeferredRequests != 0 && can0dev != nullptr)
+	{
+		CanMessageBuffer buf(nullptr);
+		while (numDeferredRequests != 0 && can0dev->ReceiveMessage(RxBufferIndexResponse, 0, &buf))
+		{
+			if (reprap.Debug(moduleCan))
+			{
+				buf.DebugPrint("Rx1:");
+			}
+			if (!CheckDeferredReply(&buf))
+			{
+				reprap.GetPlatform().MessageF(WarningMessage, "Discarded msg src=%u typ=%u RID=%u\n",
+												buf.id.Src(), (unsigned int)buf.id.MsgType(), (unsigned int)buf.msg.standardReply.requestId);
+			}
+		}
+
+		const uint32_t now = millis();
+		for (size_t i = 0; i < numDeferredRequests; )
+		{
+			const DeferredRequest& req = deferredRequests[i];
+			if (now - req.whenSent >= CanInterface::UsualResponseTimeout)
+			{
+				++replyTimeouts;
+				reprap.GetPlatform().MessageF(WarningMessage, "Response timeout: CAN addr %u, req type %u, RID=%u\n", req.dest, (unsigned int)req.msgType, (unsigned int)req.rid);
+				deferredRequests[i] = deferredRequests[numDeferredRequests - 1];
+				--numDeferredRequests;
+			}
+			else
+			{
+				++i;
+			}
+		}
+	}
+}
+
+// Collect the replies to deferred requests if no transaction is in progress. Called from Platform::Spin so that errors are reported even if there are no more transactions.
+void CanInterface::PollDeferredReplies() noexcept
+{
+	if (numDeferredRequests != 0)
+	{
+		MutexLocker lock(transactionMutex, 0);
+		if (lock.IsAcquired())
+		{
+			CollectDeferredReplies();
+		}
+	}
+}
+
+// Send several requests, each of them to a different expansion board, then wait for all the standard replies and append them to 'reply'.
+// The boards process the requests in parallel, so a command that affects drivers on several boards needs only one round trip.
+// The buffers are all freed.
+static GCodeResult SendRequestsAndGetStandardReplies(BatchedRequest requests[], size_t numRequests, const StringRef& reply) noexcept
+{
+	if (can0dev == nullptr)
+	{
+		for (size_t i = 0; i < numRequests; ++i)
+		{
+			CanMessageBuffer::Free(requests[i].buf);
+		}
+		return GCodeResult::error;
+	}
+
+	GCodeResult rslt = GCodeResult::ok;
+	size_t numOutstanding = numRequests;
+	CanMessageBuffer *rxBuf;
+	{
+		MutexLocker lock(transactionMutex);
+		CollectDeferredReplies();
+
+		for (size_t i = 0; i < numRequests; ++i)
+		{
+			BatchedRequest& req = requests[i];
+			req.dest = req.buf->id.Dst();
+			req.msgType = req.buf->id.MsgType();
+			req.fragmentsReceived = 0;
+			req.done = false;
+			SendCanMessage(TxBufferIndexRequest, MaxRequestSendWait, req.buf);
+			++requestsSent;
+			if (i != 0)
+			{
+				CanMessageBuffer::Free(req.buf);			// we only need one buffer to receive the replies into
+			}
+		}
+		reprap.GetPlatform().OnProcessingCanMessage();
+
+		rxBuf = requests[0].buf;
+		const uint32_t whenStartedWaiting = millis();
+		while (numOutstanding != 0)
+		{
+			const uint32_t timeWaiting = millis() - whenStartedWaiting;
+			if (timeWaiting >= CanInterface::UsualResponseTimeout || !can0dev->ReceiveMessage(RxBufferIndexResponse, CanInterface::UsualResponseTimeout - timeWaiting, rxBuf))
+			{
+				break;
+			}
+
+			if (reprap.Debug(moduleCan))
+			{
+				rxBuf->DebugPrint("Rx1:");
+			}
+
+			BatchedRequest *req = nullptr;
+			if (rxBuf->id.MsgType() == CanMessageType::standardReply)
+			{
+				for (size_t i = 0; i < numRequests; ++i)
+				{
+					BatchedRequest& r = requests[i];
+					if (   !r.done && rxBuf->id.Src() == r.dest
+						&& (rxBuf->msg.standardReply.requestId == r.rid || rxBuf->msg.standardReply.requestId == CanRequestIdAcceptAlways)
+						&& rxBuf->msg.standardReply.fragmentNumber == r.fragmentsReceived
+					   )
+					{
+						req = &r;
+						break;
+					}
+				}
+			}
+
+			if (req == nullptr)
+			{
+				if (CheckDeferredReply(rxBuf))
+				{
+					continue;
+				}
+				reprap.GetPlatform().MessageF(WarningMessage, "Discarded msg src=%u typ=%u RID=%u\n",
+												rxBuf->id.Src(), (unsigned int)rxBuf->id.MsgType(), (unsigned int)rxBuf->msg.standardReply.requestId);
+				continue;
+			}
+
+			const size_t textLength = rxBuf->msg.standardReply.GetTextLength(rxBuf->dataLength);
+			if (req->fragmentsReceived == 0)
+			{
+				if (textLength != 0)
+				{
+					reply.lcatn(rxBuf->msg.standardReply.text, textLength);
+				}
+				RecordReplyTime(millis() - whenStartedWaiting, req->msgType);
+			}
+			else
+			{
+				reply.catn(rxBuf->msg.standardReply.text, textLength);
+			}
+
+			if (rxBuf->msg.standardReply.moreFollows)
+			{
+				++req->fragmentsReceived;
+			}
+			else
+			{
+				rslt = max(rslt, (GCodeResult)rxBuf->msg.standardReply.resultCode);
+				req->done = true;
+				--numOutstanding;
+			}
+		}
+	}
+
+	CanMessageBuffer::Free(rxBuf);
+	if (numOutstanding != 0)
+	{
+		for (size_t i = 0; i < numRequests; ++i)
+		{
+			const BatchedRequest& req = requests[i];
+			if (!req.done)
+			{
+				++replyTimeouts;
+				reply.lcatf("Response timeout: CAN addr %u, req type %u, RID=%u", req.dest, (unsigned int)req.msgType, (unsigned int)req.rid);
+			}
+		}
+		rslt = GCodeResult::error;
+	}
+	return rslt;
+}
+
+// Send several requests, each of them to a different expansion board, without waiting for the replies. The buffers are all freed.
+// If too many earlier requests are still waiting for replies, wait for the replies to these ones instead.
+static GCodeResult SendRequestsWithoutWaiting(BatchedRequest requests[], size_t numRequests, const StringRef& reply) noexcept
+{
+	if (can0dev != nullptr)
+	{
+		MutexLocker lock(transactionMutex);
+		CollectDeferredReplies();
+		if (numDeferredRequests + numRequests <= MaxDeferredRequests)
+		{
+			const uint32_t now = millis();
+			for (size_t i = 0; i < numRequests; ++i)
+			{
+				CanMessageBuffer * const buf = requests[i].buf;
+				DeferredRequest& req = deferredRequests[numDeferredRequests];
+				req.whenSent = now;
+				req.dest = buf->id.Dst();
+				req.rid = requests[i].rid;
+				req.msgType = buf->id.MsgType();
+				++numDeferredRequests;
+				SendCanMessage(TxBufferIndexRequest, MaxRequestSendWait, buf);
+				++requestsSent;
+				CanMessageBuffer::Free(buf);
+			}
+			reprap.GetPlatform().OnProcessingCanMessage();
+			return GCodeResult::ok;
+		}
+	}
+	return SendRequestsAndGetStandardReplies(requests, numRequests, reply);
+}
+
+// Send the values to the remote drivers, batching the requests to different boards. If waitForReplies is false then the replies are collected later.
+template<class T> static GCodeResult SetRemoteDriverValues(const CanDriversData<T>& data, const StringRef& reply, CanMessageType mt, bool waitForReplies = true) noexcept
 {
 	GCodeResult rslt = GCodeResult::ok;
+	BatchedRequest requests[MaxBatchedRequests];
+	size_t numRequests = 0;
 	size_t start = 0;
 	for (;;)
 	{
@@ -661,7 +1072,8 @@ template<class T> static GCodeResult SetRemoteDriverValues(const CanDriversData<
 		if (buf == nullptr)
 		{
 			reply.lcat(NoCanBufferMessage);
-			return GCodeResult::error;
+			rslt = GCodeResult::error;
+			break;
 		}
 		const CanRequestId rid = CanInterface::AllocateRequestId(boardAddress, buf);
 		CanMessageMultipleDrivesRequest<T> * const msg = buf->SetupRequestMessage<CanMessageMultipleDrivesRequest<T>>(rid, CanInterface::GetCanAddress(), boardAddress, mt);
@@ -672,7 +1084,19 @@ template<class T> static GCodeResult SetRemoteDriverValues(const CanDriversData<
 			msg->values[i] = data.GetElement(savedStart + i);
 		}
 		buf->dataLength = msg->GetActualDataLength(numDrivers);
-		rslt = max(rslt, CanInterface::SendRequestAndGetStandardReply(buf, rid, reply));
+		requests[numRequests].buf = buf;
+		requests[numRequests].rid = rid;
+		++numRequests;
+		if (numRequests == MaxBatchedRequests)
+		{
+			rslt = max(rslt, (waitForReplies) ? SendRequestsAndGetStandardReplies(requests, numRequests, reply) : SendRequestsWithoutWaiting(requests, numRequests, reply));
+			numRequests = 0;
+		}
+	}
+
+	if (numRequests != 0)
+	{
+		rslt = max(rslt, (waitForReplies) ? SendRequestsAndGetStandardReplies(requests, numRequests, reply) : SendRequestsWithoutWaiting(requests, numRequests, reply));
 	}
 	return rslt;
 }
@@ -685,6 +1109,8 @@ static GCodeResult SetRemoteDriverStates(const CanDriversList& drivers, const St
 {
 	GCodeResult rslt = GCodeResult::ok;
 	const bool fromMoveTask = TaskBase::GetCallerTaskHandle() == Move::GetMoveTaskHandle();
+	BatchedRequest requests[MaxBatchedRequests];
+	size_t numRequests = 0;
 	size_t start = 0;
 	for (;;)
 	{
@@ -698,7 +1124,8 @@ static GCodeResult SetRemoteDriverStates(const CanDriversList& drivers, const St
 		if (buf == nullptr)
 		{
 			reply.lcat(NoCanBufferMessage);
-			return GCodeResult::error;
+			rslt = GCodeResult::error;
+			break;
 		}
 		const CanRequestId rid = (fromMoveTask) ? CanRequestIdNoReplyNeeded : CanInterface::AllocateRequestId(boardAddress, buf);
 		const auto msg = buf->SetupRequestMessage<CanMessageMultipleDrivesRequest<DriverStateControl>>(rid, CanInterface::GetCanAddress(), boardAddress, CanMessageType::setDriverStates);
@@ -715,9 +1142,22 @@ static GCodeResult SetRemoteDriverStates(const CanDriversList& drivers, const St
 		}
 		else
 		{
-			rslt = max(rslt, CanInterface::SendRequestAndGetStandardReply(buf, rid, reply));	// send the command via the usual mechanism
+			// Send the command via the usual mechanism, batched with the commands to other boards
+			requests[numRequests].buf = buf;
+			requests[numRequests].rid = rid;
+			++numRequests;
+			if (numRequests == MaxBatchedRequests)
+			{
+				rslt = max(rslt, SendRequestsAndGetStandardReplies(requests, numRequests, reply));
+				numRequests = 0;
+			}
 		}
 	}
+
+	if (numRequests != 0)
+	{
+		rslt = max(rslt, SendRequestsAndGetStandardReplies(requests, numRequests, reply));
+	}
 	return rslt;
 }
 
@@ -740,9 +1180,12 @@ void CanInterface::SendMotion(CanMessageBuffer *buf) noexcept
 			lastMotionBuffer->next = buf;
 		}
 		lastMotionBuffer = buf;
-#if 0	//unused
+		motionQueuedTimes[(motionQueuedTimesHead + numPendingMotionBuffers) % NumCanBuffers] = StepTimer::GetTimerTicks();
 		++numPendingMotionBuffers;
-#endif
+		if (numPendingMotionBuffers > maxPendingMotionBuffers)
+		{
+			maxPendingMotionBuffers = numPendingMotionBuffers;
+		}
 	}
 
 	canSenderTask.Give();
@@ -780,9 +1223,11 @@ GCodeResult CanInterface::SendRequestAndGetCustomReply(CanMessageBuffer *buf, Ca
 	{
 		// This code isn't re-entrant and it can get called from a task other than Main to shut the system down, so we need to use a mutex
 		MutexLocker lock(transactionMutex);
+		CollectDeferredReplies();
 
 		SendCanMessage(TxBufferIndexRequest, MaxRequestSendWait, buf);
 		reprap.GetPlatform().OnProcessingCanMessage();
+		++requestsSent;
 
 		const uint32_t whenStartedWaiting = millis();
 		unsigned int fragmentsReceived = 0;
@@ -813,12 +1258,7 @@ GCodeResult CanInterface::SendRequestAndGetCustomReply(CanMessageBuffer *buf, Ca
 					{
 						*extra = buf->msg.standardReply.extra;
 					}
-					uint32_t waitedFor = millis() - whenStartedWaiting;
-					if (waitedFor > longestWaitTime)
-					{
-						longestWaitTime = waitedFor;
-						longestWaitMessageType = (uint16_t)msgType;
-					}
+					RecordReplyTime(millis() - whenStartedWaiting, msgType);
 				}
 				else
 				{
@@ -834,11 +1274,12 @@ GCodeResult CanInterface::SendRequestAndGetCustomReply(CanMessageBuffer *buf, Ca
 			}
 			else if (matchesRequest && buf->id.MsgType() == replyType && fragmentsReceived == 0)
 			{
+				RecordReplyTime(millis() - whenStartedWaiting, msgType);
 				callback(buf);
 				CanMessageBuffer::Free(buf);
 				return GCodeResult::ok;
 			}
-			else
+			else if (!CheckDeferredReply(buf))
 			{
 				// We received an unexpected message. Don't tack it on to 'reply' because some replies contain important data, e.g. request for board short name.
 				if (buf->id.MsgType() == CanMessageType::standardReply)
@@ -856,6 +1297,7 @@ GCodeResult CanInterface::SendRequestAndGetCustomReply(CanMessageBuffer *buf, Ca
 	}
 
 	CanMessageBuffer::Free(buf);
+	++replyTimeouts;
 	reply.lcatf("Response timeout: CAN addr %u, req type %u, RID=%u", dest, (unsigned int)msgType, (unsigned int)rid);
 	return GCodeResult::error;
 }
@@ -906,6 +1348,9 @@ extern "C" [[noreturn]] void CanReceiverLoop(void *) noexcept
 	{
 		if (can0dev->ReceiveMessage(RxBufferIndexRequest, TaskBase::TimeoutUnlimited, &buf))
 		{
+#if SUPPORT_EVENT_TRACE
+			EventTrace::Record(EventTrace::EventId::canReceive, (uint32_t)buf.id.MsgType(), ((uint32_t)buf.id.Src() << 16) | buf.dataLength);
+#endif
 			if (reprap.Debug(moduleCan))
 			{
 				buf.DebugPrint("Rx0:");
@@ -963,10 +1408,11 @@ GCodeResult CanInterface::SetRemoteDriverStepsPerMmAndMicrostepping(const CanDri
 	return SetRemoteDriverValues(data, reply, CanMessageType::setStepsPerMmAndMicrostepping);
 }
 
-// Set the pressure advance on remote drivers, returning true if successful
+// Set the pressure advance on remote drivers. We don't wait for the replies, so that a pressure advance change sent by the slicer during a print doesn't hold up
+// the input channel for a round trip. Errors reported by the boards are sent as messages when the replies arrive.
 GCodeResult CanInterface::SetRemotePressureAdvance(const CanDriversData<float>& data, const StringRef& reply) noexcept
 {
-	return SetRemoteDriverValues(data, reply, CanMessageType::setPressureAdvance);
+	return SetRemoteDriverValues(data, reply, CanMessageType::setPressureAdvance, false);
 }
 
 // Handle M569 for a remote driver
@@ -1304,6 +1750,27 @@ GCodeResult CanInterface::ReadRemoteHandles(CanAddress boardAddress, RemoteInput
 	return rslt;
 }
 
+// Get the CAN statistics for the object model
+CanInterface::Statistics CanInterface::GetStatistics() noexcept
+{
+	Statistics stats;
+	stats.messagesSent = stats.bytesSent = 0;
+	uint32_t maxWaitTicks = 0;
+	for (const TxBufferStats& ts : txStats)
+	{
+		stats.messagesSent += ts.messagesSent;
+		stats.bytesSent += ts.bytesSent;
+		maxWaitTicks = max<uint32_t>(maxWaitTicks, ts.maxWaitTicks);
+	}
+	stats.motionMessagesSent = txStats[(unsigned int)TxBufferIndexMotion].messagesSent;
+	stats.requestsSent = requestsSent;
+	stats.replyTimeouts = replyTimeouts;
+	stats.maxTxWait = StepClocksToMicroseconds(maxWaitTicks);
+	stats.maxReplyTime = longestWaitTime;
+	stats.meanReplyTime = (repliesSinceLastReport == 0) ? 0.0 : (float)totalReplyTimeSinceLastReport/(float)repliesSinceLastReport;
+	return stats;
+}
+
 void CanInterface::Diagnostics(MessageType mtype) noexcept
 {
 	Platform& p = reprap.GetPlatform();
@@ -1318,6 +1785,67 @@ void CanInterface::Diagnostics(MessageType mtype) noexcept
 		unsigned int messagesQueuedForSending, messagesReceived, messagesLost, busOffCount;
 		can0dev->GetAndClearStats(messagesQueuedForSending, messagesReceived, messagesLost, busOffCount);
 		p.MessageF(mtype, "Messages queued %u, received %u, lost %u, boc %u\n", messagesQueuedForSending, messagesReceived, messagesLost, busOffCount);
+
+		// Report the messages sent from each transmit buffer since the last report and estimate the proportion of the bus time that they used
+		CanTiming timing;
+		can0dev->GetLocalCanTiming(timing);
+		const uint32_t now = millis();
+		const float interval = (float)(now - whenStatsLastReported) * 0.001;
+		const float bitRate = (float)CanTiming::ClockFrequency/(float)timing.period;
+		whenStatsLastReported = now;
+
+		uint32_t totalBits = 0, totalBytes = 0;
+		String<StringLength256> str;
+		for (const TxBufferName& tb : TxBufferNames)
+		{
+			TxBufferStats& stats = txStats[(unsigned int)tb.buffer];
+			const uint32_t messages = stats.messagesSent - stats.messagesAtLastReport;
+			totalBits += stats.bitsSent - stats.bitsAtLastReport;
+			totalBytes += stats.bytesSent - stats.bytesAtLastReport;
+			str.catf(" %s %" PRIu32 " %" PRIu32 "/%" PRIu32 "us", tb.name, messages,
+						(messages == 0) ? 0 : StepClocksToMicroseconds(stats.totalWaitTicks/messages), StepClocksToMicroseconds(stats.maxWaitTicks));
+			stats.messagesAtLastReport = stats.messagesSent;
+			stats.bytesAtLastReport = stats.bytesSent;
+			stats.bitsAtLastReport = stats.bitsSent;
+			stats.totalWaitTicks = stats.maxWaitTicks = 0;
+		}
+		p.MessageF(mtype, "Messages sent, mean/max wait:%s\n", str.c_str());
+
+		unsigned int queued, maxQueued;
+		{
+			TaskCriticalSectionLocker lock;
+			queued = numPendingMotionBuffers;
+			maxQueued = maxPendingMotionBuffers;
+			maxPendingMotionBuffers = numPendingMotionBuffers;
+		}
+		p.MessageF(mtype, "Bus load %.1f%%, data %.2fKb/sec, motion messages queued %u (max %u)\n",
+					(double)((interval > 0.0) ? (float)totalBits * 100.0/(bitRate * interval) : 0.0),
+					(double)((interval > 0.0) ? (float)totalBytes/(1024.0 * interval) : 0.0),
+					queued, maxQueued);
+
+		// Report the motion message latency histogram and the movement message lead time
+		str.Clear();
+		char sep = ' ';
+		for (unsigned int& count : motionLatencyCounts)
+		{
+			str.catf("%c%u", sep, count);
+			count = 0;
+			sep = ',';
+		}
+		p.MessageF(mtype, "Motion message latency (<%" PRIu32 "us, doubling):%s, min lead time %.1fms, late %u\n",
+					MotionLatencyBucketMicroseconds, str.c_str(),
+					(double)((minMotionLeadTicks == std::numeric_limits<int32_t>::max()) ? 0.0 : (float)minMotionLeadTicks * (1000.0/StepClockRate)),
+					lateMovementMessages);
+		minMotionLeadTicks = std::numeric_limits<int32_t>::max();
+		lateMovementMessages = 0;
+
+		p.MessageF(mtype, "Requests %" PRIu32 ", replies %" PRIu32 " mean time %.1fms, timeouts %" PRIu32 "\n",
+					requestsSent - requestsAtLastReport, repliesSinceLastReport,
+					(double)((repliesSinceLastReport == 0) ? 0.0 : (float)totalReplyTimeSinceLastReport/(float)repliesSinceLastReport),
+					replyTimeouts - replyTimeoutsAtLastReport);
+		requestsAtLastReport = requestsSent;
+		replyTimeoutsAtLastReport = replyTimeouts;
+		repliesSinceLastReport = totalReplyTimeSinceLastReport = 0;
 	}
 
 	p.MessageF(mtype,
@@ -1351,6 +1879,7 @@ void CanInterface::Diagnostics(MessageType mtype) noexcept
 	}
 
 	reprap.GetPlatform().MessageF(mtype, "Tx timeouts%s\n", str.c_str());
+	reprap.GetExpansion().ConfigDiagnostics(mtype);
 	longestWaitTime = 0;
 	longestWaitMessageType = 0;
 	peakTimeSyncTxDelay = 0;
@@ -49,6 +49,21 @@ namespace CanInterface
 	void SendBroadcastNoFree(CanMessageBuffer *buf) noexcept;
 	void SendMessageNoReplyNoFree(CanMessageBuffer *buf) noexcept;
 	void Diagnostics(MessageType mtype) noexcept;
+
+	// Bus statistics for the object model. The counts are totals since startup; the maximum and mean times are since the last diagnostics report.
+	struct Statistics
+	{
+		uint32_t messagesSent;
+		uint32_t bytesSent;
+		uint32_t motionMessagesSent;
+		uint32_t requestsSent;
+		uint32_t replyTimeouts;
+		uint32_t maxTxWait;								// in microseconds
+		uint32_t maxReplyTime;							// in milliseconds
+		float meanReplyTime;							// in milliseconds
+	};
+	Statistics GetStatistics() noexcept;
+
 	CanMessageBuffer *AllocateBuffer(const GCodeBuffer* gb) THROWS(GCodeException);
 	void CheckCanAddress(uint32_t address, const GCodeBuffer& gb) THROWS(GCodeException);
 
@@ -70,6 +85,7 @@ namespace CanInterface
 
 	// Motor control functions
 	void SendMotion(CanMessageBuffer *buf) noexcept;
+	void PollDeferredReplies() noexcept;
 	GCodeResult EnableRemoteDrivers(const CanDriversList& drivers, const StringRef& reply) noexcept;
 	void EnableRemoteDrivers(const CanDriversList& drivers) noexcept;
 	GCodeResult DisableRemoteDrivers(const CanDriversList& drivers, const StringRef& reply) noexcept;
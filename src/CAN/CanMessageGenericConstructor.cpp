@@ -13,6 +13,8 @@
 #include "CanMessageBuffer.h"
 #include "CanInterface.h"
 #include "GCodes/GCodeBuffer/GCodeBuffer.h"
+#include "ExpansionManager.h"
+#include <Platform/RepRap.h>
 
 #define STRINGIZE(_v) #_v
 
@@ -356,7 +358,12 @@ GCodeResult CanMessageGenericConstructor::SendAndGetResponse(CanMessageType msgT
 	CanMessageGeneric *m2 = buf->SetupGenericRequestMessage(rid, CanInterface::GetCanAddress(), dest, msgType, actualMessageLength);
 	memcpy(m2, &msg, actualMessageLength);
 	m2->requestId = rid;
-	return CanInterface::SendRequestAndGetStandardReply(buf, rid, reply);
+	const GCodeResult rslt = CanInterface::SendRequestAndGetStandardReply(buf, rid, reply);
+	if (rslt == GCodeResult::ok || rslt == GCodeResult::warning)
+	{
+		reprap.GetExpansion().RecordConfigMessage(dest, msgType, &msg, actualMessageLength);
+	}
+	return rslt;
 }
 
 #endif
@@ -45,6 +45,44 @@ constexpr size_t MaxFileChunkSize = 448;	// Maximum size of file chunks for read
 char sbcFirmwareChunk[MaxFileChunkSize];
 #endif
 
+#if HAS_MASS_STORAGE
+
+// While expansion boards are being updated from the SD card we keep the firmware file open between block requests.
+// This means that boards of the same type that are updated at the same time share the open file, and we don't search the directory for every block.
+static FileStore *firmwareFile = nullptr;
+static String<MaxFilenameLength> firmwareFileName;
+
+static FileStore *OpenFirmwareFile(const char *_ecv_array fname) noexcept
+{
+	if (firmwareFile != nullptr && !firmwareFileName.EqualsIgnoreCase(fname))
+	{
+		firmwareFile->Close();
+		firmwareFile = nullptr;
+	}
+
+	if (firmwareFile == nullptr)
+	{
+		firmwareFile = reprap.GetPlatform().OpenFile(FIRMWARE_DIRECTORY, fname, OpenMode::read);
+		if (firmwareFile != nullptr)
+		{
+			firmwareFileName.copy(fname);
+		}
+	}
+	return firmwareFile;
+}
+
+// Close the firmware file, unless keepIfFlashing is true and some expansion boards are still being updated
+static void ReleaseFirmwareFile(bool keepIfFlashing) noexcept
+{
+	if (firmwareFile != nullptr && !(keepIfFlashing && reprap.GetExpansion().IsFlashing()))
+	{
+		firmwareFile->Close();
+		firmwareFile = nullptr;
+	}
+}
+
+#endif
+
 // Handle a firmware update request
 static void HandleFirmwareBlockRequest(CanMessageBuffer *buf) noexcept
 pre(buf->id.MsgType() == CanMessageType::firmwareBlockRequest)
@@ -153,7 +191,7 @@ pre(buf->id.MsgType() == CanMessageType::firmwareBlockRequest)
 		{
 #if HAS_MASS_STORAGE
 			// Fetch the firmware file from the local SD card
-			FileStore * const f = reprap.GetPlatform().OpenFile(FIRMWARE_DIRECTORY, fname.c_str(), OpenMode::read);
+			FileStore * const f = OpenFirmwareFile(fname.c_str());
 			if (f != nullptr)
 			{
 				fileLength = f->Length();
@@ -194,6 +232,7 @@ pre(buf->id.MsgType() == CanMessageType::firmwareBlockRequest)
 
 							reprap.GetPlatform().MessageF(ErrorMessage, "Error reading firmware update file '%s'\n", fname.c_str());
 							reprap.GetExpansion().UpdateFailed(src);
+							ReleaseFirmwareFile(false);
 							return;
 						}
 
@@ -211,7 +250,6 @@ pre(buf->id.MsgType() == CanMessageType::firmwareBlockRequest)
 						}
 					}
 				}
-				f->Close();
 			}
 #endif
 		}
@@ -233,6 +271,9 @@ pre(buf->id.MsgType() == CanMessageType::firmwareBlockRequest)
 		{
 			reprap.GetExpansion().UpdateFinished(src);
 		}
+#if HAS_MASS_STORAGE
+		ReleaseFirmwareFile(true);
+#endif
 	}
 	else
 	{
@@ -12,8 +12,14 @@
 #include <CAN/CanInterface.h>
 #include <Platform/RepRap.h>
 #include <Platform/Platform.h>
+#include <Storage/CRC32.h>
 #include <GCodes/GCodeBuffer/GCodeBuffer.h>
 
+#if SUPPORT_ACCELEROMETERS
+# include <Accelerometers/Accelerometers.h>
+# include <Accelerometers/ResonanceAnalyser.h>
+#endif
+
 #if SUPPORT_OBJECT_MODEL
 
 // Object model table and functions
@@ -59,6 +65,9 @@ constexpr ObjectModelTableEntry ExpansionManager::objectModelTable[] =
 	{ "min",				OBJECT_MODEL_FUNC(self->FindIndexedBoard(context.GetLastIndex()).v12.minimum, 1),								ObjectModelEntryFlags::none },
 
 	// 4. accelerometer members
+#if SUPPORT_ACCELEROMETERS
+	{ "analysis",			OBJECT_MODEL_FUNC(Accelerometers::GetAnalysis((uint8_t)(&(self->FindIndexedBoard(context.GetLastIndex())) - self->boards)), 0),		ObjectModelEntryFlags::none },
+#endif
 	{ "points",				OBJECT_MODEL_FUNC((int32_t)self->FindIndexedBoard(context.GetLastIndex()).accelerometerLastRunDataPoints),		ObjectModelEntryFlags::none },
 	{ "runs",				OBJECT_MODEL_FUNC((int32_t)self->FindIndexedBoard(context.GetLastIndex()).accelerometerRuns),					ObjectModelEntryFlags::none },
 
@@ -74,7 +83,7 @@ constexpr uint8_t ExpansionManager::objectModelTableDescriptor[] =
 	3,				// section 1: mcuTemp
 	3,				// section 2: vIn
 	3,				// section 3: v12
-	2,				// section 4: accelerometer
+	2 + SUPPORT_ACCELEROMETERS,	// section 4: accelerometer
 	2				// section 5: closed loop
 };
 
@@ -84,7 +93,7 @@ DEFINE_GET_OBJECT_MODEL_TABLE(ExpansionManager)
 
 ExpansionBoardData::ExpansionBoardData() noexcept
 	: typeName(nullptr),
-	  accelerometerLastRunDataPoints(0), closedLoopLastRunDataPoints(0),
+	  accelerometerLastRunDataPoints(0), closedLoopLastRunDataPoints(0), configCrcState(0xFFFFFFFF), configMessages(0),
 	  accelerometerRuns(0), closedLoopRuns(0),
 	  hasMcuTemp(false), hasVin(false), hasV12(false), hasAccelerometer(false),
 	  state(BoardState::unknown), numDrivers(0)
@@ -137,6 +146,8 @@ void ExpansionManager::ProcessAnnouncement(CanMessageBuffer *buf, bool isNewForm
 	{
 		ExpansionBoardData& board = boards[src];
 		board.hasVin = board.hasV12 = board.hasMcuTemp = false;
+		board.configCrcState = 0xFFFFFFFF;				// the board has started up, so it has lost any configuration we sent it
+		board.configMessages = 0;
 		String<StringLength100> boardTypeAndFirmwareVersion;
 		if (isNewFormat)
 		{
@@ -221,6 +232,40 @@ void ExpansionManager::ProcessBoardStatusReport(const CanMessageBuffer *buf) noe
 	board.hasClosedLoop = msg.hasClosedLoop;
 }
 
+// Add a configuration message that the board accepted to the board's configuration hash.
+// The hash identifies the sequence of configuration messages that the board has been sent since it started, which is what determines its configuration.
+void ExpansionManager::RecordConfigMessage(CanAddress address, CanMessageType msgType, const void *data, size_t length) noexcept
+{
+	if (address < ARRAY_SIZE(boards))
+	{
+		ExpansionBoardData& board = boards[address];
+		CRC32 crc;
+		crc.Reset(board.configCrcState);
+		const uint16_t type = (uint16_t)msgType;
+		crc.Update(reinterpret_cast<const char *>(&type), sizeof(type));
+		crc.Update(reinterpret_cast<const char *>(data), length);
+		board.configCrcState = ~crc.Get();
+		++board.configMessages;
+	}
+}
+
+// Report the configuration hash of each board that has been sent any configuration
+void ExpansionManager::ConfigDiagnostics(MessageType mtype) const noexcept
+{
+	String<StringLength256> str;
+	for (size_t address = 1; address < ARRAY_SIZE(boards); ++address)
+	{
+		if (boards[address].configMessages != 0)
+		{
+			str.catf(" %u:%08" PRIx32 "/%u", address, ~boards[address].configCrcState, boards[address].configMessages);
+		}
+	}
+	if (!str.IsEmpty())
+	{
+		reprap.GetPlatform().MessageF(mtype, "Expansion board configuration (board:hash/messages):%s\n", str.c_str());
+	}
+}
+
 // Return a pointer to the expansion board, if it is present
 const ExpansionBoardData *ExpansionManager::GetBoardDetails(uint8_t address) const noexcept
 {
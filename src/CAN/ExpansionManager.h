@@ -28,6 +28,8 @@ struct ExpansionBoardData
 	MinCurMax mcuTemp, vin, v12;
 	uint32_t accelerometerLastRunDataPoints;
 	uint32_t closedLoopLastRunDataPoints;
+	uint32_t configCrcState;						// the CRC state of the configuration messages sent to the board since it last announced itself
+	uint16_t configMessages;						// how many configuration messages have been sent to the board since it last announced itself
 	UniqueId uniqueId;
 	uint16_t accelerometerRuns;
 	uint16_t closedLoopRuns;
@@ -64,6 +66,9 @@ public:
 
 	void EmergencyStop() noexcept;
 
+	void RecordConfigMessage(CanAddress address, CanMessageType msgType, const void *data, size_t length) noexcept;
+	void ConfigDiagnostics(MessageType mtype) const noexcept;
+
 protected:
 	DECLARE_OBJECT_MODEL
 
@@ -17,10 +17,13 @@
 # include <CAN/ExpansionManager.h>
 # include <GCodes/GCodeBuffer/GCodeBuffer.h>
 # include <CAN/CanMessageGenericConstructor.h>
+# include <Storage/CaptureFileWriter.h>
+# include <Platform/Tasks.h>
 # include <atomic>
 
 constexpr unsigned int MaxSamples = 65535;				// This comes from the fact CanMessageClosedLoopData->firstSampleNumber has a max value of 65535
 constexpr uint32_t DataReceiveTimeout = 5000;			// Data receive timeout in milliseconds
+constexpr unsigned int MaxWindowSamples = 1000;			// The maximum number of samples in a summary window
 
 static uint16_t rateRequested;							// The sampling rate
 static uint8_t modeRequested;							// The sampling mode(immediate or on next move)
@@ -34,29 +37,77 @@ static std::atomic<FileStore*> closedLoopFile = nullptr;	// This is non-null whe
 static unsigned int expectedRemoteSampleNumber = 0;
 static CanAddress expectedRemoteBoardAddress = CanId::NoAddress;
 
+static CaptureFileWriter *captureWriter = nullptr;			// created the first time that M569.5 B1 is used
+static bool useBinaryFormat = false;						// true if the current file is in binary format
+
+// Summary windows. When M569.5 W is used, each row of the CSV file summarises a window of samples by giving the mean, minimum, maximum and RMS value
+// of each variable, so that long runs can be recorded with far less data written to the file. If an error threshold is given with the T parameter as well,
+// the samples in each window are buffered, and the window in which the absolute value of the current error reaches the threshold and the following
+// window are written at full rate instead, one sample per row with a count of 1.
+static unsigned int windowRequested = 0;					// the number of samples per window, or 0 to write every sample
+static float errorThreshold = 0.0;							// the error threshold, if errorVariableIndex >= 0
+static int errorVariableIndex = -1;							// the index of the current error in the sample data, or -1 if not using a threshold
+static unsigned int windowVariableCount = 0;				// the number of variables in each sample including the timestamp
+static float *_ecv_array null windowData = nullptr;			// the sum, minimum, maximum and sum of squares of each variable, then the buffered samples if using a threshold
+static unsigned int windowCount = 0;						// the number of samples in the current window
+static unsigned int windowFirstSample = 0;					// the number of the first sample in the current window
+static bool windowTriggered = false;						// true if the error threshold was reached in the current window
+static bool lastWindowTriggered = false;					// true if the error threshold was reached in the previous window
+
+// The names of the variables that can be recorded, used in the header of CSV files
+static const struct { uint32_t bit; const char *_ecv_array name; } variableNames[] =
+{
+	{ CL_RECORD_RAW_ENCODER_READING,	"Raw Encoder Reading" },
+	{ CL_RECORD_CURRENT_MOTOR_STEPS,	"Measured Motor Steps" },
+	{ CL_RECORD_TARGET_MOTOR_STEPS,		"Target Motor Steps" },
+	{ CL_RECORD_CURRENT_ERROR,			"Current Error" },
+	{ CL_RECORD_PID_CONTROL_SIGNAL,		"PID Control Signal" },
+	{ CL_RECORD_PID_P_TERM,				"PID P Term" },
+	{ CL_RECORD_PID_I_TERM,				"PID I Term" },
+	{ CL_RECORD_PID_D_TERM,				"PID D Term" },
+	{ CL_RECORD_STEP_PHASE,				"Measured Step Phase" },
+	{ CL_RECORD_DESIRED_STEP_PHASE,		"Desired Step Phase" },
+	{ CL_RECORD_PHASE_SHIFT,			"Phase Shift" },
+	{ CL_RECORD_COIL_A_CURRENT,			"Coil A Current" },
+	{ CL_RECORD_COIL_B_CURRENT,			"Coil B Current" },
+};
+
 static bool OpenDataCollectionFile(String<MaxFilenameLength> filename, unsigned int size) noexcept
 {
 	// Create the file
 	FileStore * const f = MassStorage::OpenFile(filename.c_str(), OpenMode::write, size);
 	if (f == nullptr) { return false; }
 
-	// Write the header line
+	// Write the header
+	if (useBinaryFormat)
+	{
+		if (captureWriter == nullptr)
+		{
+			captureWriter = new CaptureFileWriter;
+		}
+		const unsigned int numVariables = Bitmap<uint32_t>(filterRequested).CountSetBits() + 1;		// 1 extra for time stamp
+		const CaptureFileHeader header(CaptureFileHeader::Source::closedLoop, CaptureFileHeader::ValueType::float32, numVariables, filterRequested,
+										rateRequested, deviceRequested.boardAddress, 0, numSamplesRequested);
+		captureWriter->Start(f, header);
+	}
+	else
 	{
 		String<StringLength500> temp;
-		temp.copy("Sample,Timestamp");
-		if (filterRequested & CL_RECORD_RAW_ENCODER_READING)	{temp.cat(",Raw Encoder Reading");}
-		if (filterRequested & CL_RECORD_CURRENT_MOTOR_STEPS)  	{temp.cat(",Measured Motor Steps");}
-		if (filterRequested & CL_RECORD_TARGET_MOTOR_STEPS)  	{temp.cat(",Target Motor Steps");}
-		if (filterRequested & CL_RECORD_CURRENT_ERROR) 			{temp.cat(",Current Error");}
-		if (filterRequested & CL_RECORD_PID_CONTROL_SIGNAL)  	{temp.cat(",PID Control Signal");}
-		if (filterRequested & CL_RECORD_PID_P_TERM)  			{temp.cat(",PID P Term");}
-		if (filterRequested & CL_RECORD_PID_I_TERM)  			{temp.cat(",PID I Term");}
-		if (filterRequested & CL_RECORD_PID_D_TERM)  			{temp.cat(",PID D Term");}
-		if (filterRequested & CL_RECORD_STEP_PHASE)  			{temp.cat(",Measured Step Phase");}
-		if (filterRequested & CL_RECORD_DESIRED_STEP_PHASE)  	{temp.cat(",Desired Step Phase");}
-		if (filterRequested & CL_RECORD_PHASE_SHIFT)  			{temp.cat(",Phase Shift");}
-		if (filterRequested & CL_RECORD_COIL_A_CURRENT) 		{temp.cat(",Coil A Current");}
-		if (filterRequested & CL_RECORD_COIL_B_CURRENT) 		{temp.cat(",Coil B Current");}
+		temp.copy((windowRequested != 0) ? "Sample,Timestamp,Count" : "Sample,Timestamp");
+		for (const auto& v : variableNames)
+		{
+			if (filterRequested & v.bit)
+			{
+				if (windowRequested != 0)
+				{
+					temp.catf(",%s,%s Min,%s Max,%s RMS", v.name, v.name, v.name, v.name);
+				}
+				else
+				{
+					temp.catf(",%s", v.name);
+				}
+			}
+		}
 
 		temp.cat("\n");
 		f->Write(temp.c_str());							// this call could result in the file becoming invalidated
@@ -67,12 +118,124 @@ static bool OpenDataCollectionFile(String<MaxFilenameLength> filename, unsigned
 	return true;
 }
 
+// Write a row of the CSV file that summarises the samples in the current window. The minimum timestamp is the timestamp of the first sample.
+static void WriteSummaryRow(FileStore *f) noexcept
+{
+	const float *_ecv_array const sums = windowData;
+	const float *_ecv_array const mins = windowData + windowVariableCount;
+	const float *_ecv_array const maxs = windowData + 2 * windowVariableCount;
+	const float *_ecv_array const sumsOfSquares = windowData + 3 * windowVariableCount;
+	String<StringLength500> currentLine;
+	currentLine.printf("%u,%.2f,%u", windowFirstSample, (double)mins[0], windowCount);
+	for (size_t i = 1; i < windowVariableCount; ++i)
+	{
+		currentLine.catf(",%.2f,%.2f,%.2f,%.2f", (double)(sums[i]/windowCount), (double)mins[i], (double)maxs[i], (double)fastSqrtf(sumsOfSquares[i]/windowCount));
+	}
+	currentLine.cat("\n");
+	f->Write(currentLine.c_str());
+}
+
+// Write a row of the CSV file that holds a single sample, in the same columns as a summary row
+static void WriteSampleRow(FileStore *f, unsigned int sampleNumber, const float *_ecv_array values) noexcept
+{
+	String<StringLength500> currentLine;
+	currentLine.printf("%u,%.2f,1", sampleNumber, (double)values[0]);
+	for (size_t i = 1; i < windowVariableCount; ++i)
+	{
+		currentLine.catf(",%.2f,%.2f,%.2f,%.2f", (double)values[i], (double)values[i], (double)values[i], (double)fabsf(values[i]));
+	}
+	currentLine.cat("\n");
+	f->Write(currentLine.c_str());
+}
+
+// Write the current window to the file, either as a summary row or, if it or the previous window reached the error threshold, one row per sample
+static void FlushWindow(FileStore *f) noexcept
+{
+	if (windowCount != 0)
+	{
+		if (windowTriggered || lastWindowTriggered)
+		{
+			for (unsigned int sample = 0; sample < windowCount; ++sample)
+			{
+				WriteSampleRow(f, windowFirstSample + sample, windowData + (4 + sample) * windowVariableCount);
+			}
+		}
+		else
+		{
+			WriteSummaryRow(f);
+		}
+		lastWindowTriggered = windowTriggered;
+		windowTriggered = false;
+		windowCount = 0;
+	}
+}
+
+// Add a sample to the current window and write the window to the file if it is full
+static void AddToWindow(FileStore *f, unsigned int sampleNumber, const float *_ecv_array values) noexcept
+{
+	float *_ecv_array const sums = windowData;
+	float *_ecv_array const mins = windowData + windowVariableCount;
+	float *_ecv_array const maxs = windowData + 2 * windowVariableCount;
+	float *_ecv_array const sumsOfSquares = windowData + 3 * windowVariableCount;
+	if (windowCount == 0)
+	{
+		windowFirstSample = sampleNumber;
+		for (size_t i = 0; i < windowVariableCount; ++i)
+		{
+			sums[i] = mins[i] = maxs[i] = values[i];
+			sumsOfSquares[i] = fsquare(values[i]);
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < windowVariableCount; ++i)
+		{
+			sums[i] += values[i];
+			mins[i] = min<float>(mins[i], values[i]);
+			maxs[i] = max<float>(maxs[i], values[i]);
+			sumsOfSquares[i] += fsquare(values[i]);
+		}
+	}
+
+	// If we are using a threshold, keep the samples in case we need to write them at full rate
+	if (errorVariableIndex >= 0)
+	{
+		memcpy(windowData + (4 + windowCount) * windowVariableCount, values, windowVariableCount * sizeof(float));
+		if (fabsf(values[errorVariableIndex]) >= errorThreshold)
+		{
+			windowTriggered = true;
+		}
+	}
+
+	++windowCount;
+	if (windowCount == windowRequested)
+	{
+		FlushWindow(f);
+	}
+}
+
+static void ReleaseWindowData() noexcept
+{
+	delete[] windowData;
+	windowData = nullptr;
+	windowRequested = 0;
+	errorVariableIndex = -1;
+}
+
 // Close the data collection file. Avoid a race between the two tasks that access it.
-static void CloseDataCollectionFile() noexcept
+static void CloseDataCollectionFile(CaptureFileTrailer::Status status) noexcept
 {
 	FileStore *const f = closedLoopFile.exchange(nullptr);
 	if (f != nullptr)
 	{
+		if (useBinaryFormat)
+		{
+			captureWriter->Finish(status, rateRequested, (status == CaptureFileTrailer::Status::overflowed) ? 1 : 0, 0);
+		}
+		else if (windowData != nullptr)
+		{
+			FlushWindow(f);
+		}
 		f->Truncate();				// truncate the file in case we didn't write all the preallocated space
 		f->Close();
 		reprap.GetExpansion().AddClosedLoopRun(expectedRemoteBoardAddress, expectedRemoteSampleNumber);
@@ -109,7 +272,7 @@ GCodeResult ClosedLoop::StartDataCollection(DriverId driverId, GCodeBuffer& gb,
 		const uint32_t wlr = whenDataLastReceived;					// load this volatile variable before calling millis()
 		if (millis() - wlr >= DataReceiveTimeout)
 		{
-			CloseDataCollectionFile();								// this case is to allow us to reset if data collection stalls
+			CloseDataCollectionFile(CaptureFileTrailer::Status::timedOut);	// this case is to allow us to reset if data collection stalls
 			reply.copy("Closed loop data collection timed out, closing file");
 		}
 		else
@@ -127,6 +290,31 @@ GCodeResult ClosedLoop::StartDataCollection(DriverId driverId, GCodeBuffer& gb,
 	gb.TryGetUIValue('D', parsedD, seen);
 	gb.TryGetLimitedUIValue('R', parsedR, seen, std::numeric_limits<uint16_t>::max() + 1);
 	gb.TryGetUIValue('V', parsedV, seen);
+	useBinaryFormat = gb.Seen('B') && gb.GetUIValue() != 0;		// B1 selects binary file format
+
+	uint32_t parsedW = 0;
+	bool seenW = false;
+	gb.TryGetLimitedUIValue('W', parsedW, seenW, MaxWindowSamples + 1);
+	const bool seenT = gb.Seen('T');
+	const float parsedT = (seenT) ? gb.GetNonNegativeFValue() : 0.0;
+	if (parsedW != 0 || seenT)
+	{
+		if (useBinaryFormat)
+		{
+			reply.copy("summary windows are not supported in binary format");
+			return GCodeResult::error;
+		}
+		if (parsedW == 0)
+		{
+			reply.copy("T parameter needs a W parameter");
+			return GCodeResult::error;
+		}
+		if (seenT && (parsedD & CL_RECORD_CURRENT_ERROR) == 0)
+		{
+			reply.copy("T parameter needs the current error to be recorded");
+			return GCodeResult::error;
+		}
+	}
 
 	// Validation passed - store the values
 	modeRequested = parsedA;
@@ -136,9 +324,35 @@ GCodeResult ClosedLoop::StartDataCollection(DriverId driverId, GCodeBuffer& gb,
 	movementRequested = parsedV;
 	numSamplesRequested = parsedS;
 
+	// Set up the summary window. The buffer is kept after the run finishes, because the CAN receiving task may still be using it while the file is closed.
+	ReleaseWindowData();
+	if (parsedW != 0)
+	{
+		windowVariableCount = Bitmap<uint32_t>(filterRequested).CountSetBits() + 1;		// 1 extra for time stamp
+		const size_t numValues = (4 + ((seenT) ? parsedW : 0)) * windowVariableCount;
+		if (Tasks::GetNeverUsedRam() < (ptrdiff_t)(MinFreeRamForPoolGrowth + numValues * sizeof(float)))
+		{
+			reply.copy("not enough free RAM for that window size");
+			return GCodeResult::error;
+		}
+		windowData = new float[numValues];
+		windowRequested = parsedW;
+		windowCount = 0;
+		windowTriggered = lastWindowTriggered = false;
+		if (seenT)
+		{
+			errorThreshold = parsedT;
+			errorVariableIndex = Bitmap<uint32_t>(filterRequested & (CL_RECORD_CURRENT_ERROR - 1)).CountSetBits() + 1;
+		}
+	}
+
 	// Estimate how large the file will be
 	const unsigned int numVariables = Bitmap<uint32_t>(filterRequested).CountSetBits() + 1;		// 1 extra for time stamp
-	const uint32_t preallocSize = numSamplesRequested * ((numVariables * 8) + 4);				// assume format "xxx.xxx," for most samples
+	const uint32_t preallocSize = (useBinaryFormat)
+									? sizeof(CaptureFileHeader) + numSamplesRequested * (sizeof(uint32_t) + numVariables * sizeof(float)) + sizeof(CaptureFileTrailer)
+									: (windowRequested != 0 && errorVariableIndex < 0)
+										? (numSamplesRequested/windowRequested + 1) * ((numVariables * 32) + 8)		// four values per variable in each row
+											: numSamplesRequested * ((numVariables * 8) + 4);		// assume format "xxx.xxx," for most samples
 
 	// Create the file
 	String<StringLength50> tempFilename;
@@ -152,9 +366,10 @@ GCodeResult ClosedLoop::StartDataCollection(DriverId driverId, GCodeBuffer& gb,
 		const time_t time = reprap.GetPlatform().GetDateTime();
 		tm timeInfo;
 		gmtime_r(&time, &timeInfo);
-		tempFilename.printf("0:/sys/closed-loop/%u_%04u-%02u-%02u_%02u.%02u.%02u.csv",
+		tempFilename.printf("0:/sys/closed-loop/%u_%04u-%02u-%02u_%02u.%02u.%02u.%s",
 						(unsigned int) deviceRequested.boardAddress,
-						timeInfo.tm_year + 1900, timeInfo.tm_mon + 1, timeInfo.tm_mday, timeInfo.tm_hour, timeInfo.tm_min, timeInfo.tm_sec);
+						timeInfo.tm_year + 1900, timeInfo.tm_mon + 1, timeInfo.tm_mday, timeInfo.tm_hour, timeInfo.tm_min, timeInfo.tm_sec,
+						(useBinaryFormat) ? "bin" : "csv");
 	}
 
 	String<MaxFilenameLength> closedLoopFileName;
@@ -172,7 +387,7 @@ GCodeResult ClosedLoop::StartDataCollection(DriverId driverId, GCodeBuffer& gb,
 	// If no samples have been requested, return with an info message
 	if (numSamplesRequested == 0)
 	{
-		CloseDataCollectionFile();
+		CloseDataCollectionFile(CaptureFileTrailer::Status::ok);
 		reply.copy("no samples recorded");
 		return GCodeResult::warning;
 	}
@@ -181,7 +396,7 @@ GCodeResult ClosedLoop::StartDataCollection(DriverId driverId, GCodeBuffer& gb,
 	const GCodeResult rslt = CanInterface::StartClosedLoopDataCollection(deviceRequested, filterRequested, numSamplesRequested, rateRequested, movementRequested, modeRequested, gb, reply);
 	if (rslt > GCodeResult::warning)
 	{
-		CloseDataCollectionFile();
+		CloseDataCollectionFile(CaptureFileTrailer::Status::failedToStart);
 		MassStorage::Delete(closedLoopFileName.c_str(), false);
 	}
 	return rslt;
@@ -196,14 +411,36 @@ void ClosedLoop::ProcessReceivedData(CanAddress src, const CanMessageClosedLoopD
 		whenDataLastReceived = millis();
 		if (msg.firstSampleNumber != expectedRemoteSampleNumber)
 		{
-			f->Write("Data lost\n");
-			CloseDataCollectionFile();
+			if (!useBinaryFormat)
+			{
+				f->Write("Data lost\n");
+			}
+			CloseDataCollectionFile(CaptureFileTrailer::Status::dataLost);
 		}
 		else
 		{
 			unsigned int numSamples = msg.numSamples;
 			const size_t variableCount = msg.GetVariableCount();
 
+			if (useBinaryFormat)
+			{
+				for (size_t sampleIndex = 0; sampleIndex < numSamples; ++sampleIndex)
+				{
+					captureWriter->AddRecord(msg.firstSampleNumber + sampleIndex, &msg.data[sampleIndex * variableCount]);
+				}
+				expectedRemoteSampleNumber += numSamples;
+				numSamples = 0;
+			}
+			else if (windowData != nullptr)
+			{
+				for (size_t sampleIndex = 0; sampleIndex < numSamples; ++sampleIndex)
+				{
+					AddToWindow(f, msg.firstSampleNumber + sampleIndex, &msg.data[sampleIndex * variableCount]);
+				}
+				expectedRemoteSampleNumber += numSamples;
+				numSamples = 0;
+			}
+
 			while (numSamples != 0)
 			{
 				// Compile the data
@@ -227,11 +464,11 @@ void ClosedLoop::ProcessReceivedData(CanAddress src, const CanMessageClosedLoopD
 
 			if (msg.lastPacket)
 			{
-				if (msg.overflowed)
+				if (msg.overflowed && !useBinaryFormat)
 				{
 					f->Write("Buffer overflowed\n");
 				}
-				CloseDataCollectionFile();
+				CloseDataCollectionFile((msg.overflowed) ? CaptureFileTrailer::Status::overflowed : CaptureFileTrailer::Status::ok);
 			}
 		}
 	}
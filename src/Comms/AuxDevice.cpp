@@ -10,8 +10,11 @@
 #if HAS_AUX_DEVICES
 #include <Platform/RepRap.h>
 #include <Platform/Platform.h>
+#include <Storage/CRC32.h>
 
-AuxDevice::AuxDevice() noexcept : uart(nullptr), seq(0), enabled(false), raw(true)
+AuxDevice::AuxDevice() noexcept
+	: uart(nullptr), seq(0), lastStatusReportCrc(0), whenStatusReportSent(0), statusReportsSent(0), statusReportsSkipped(0),
+	  statusReportSent(false), enabled(false), raw(true)
 {
 }
 
@@ -31,6 +34,7 @@ void AuxDevice::Enable(uint32_t baudRate) noexcept
 	if (uart != nullptr)
 	{
 		uart->begin(baudRate);
+		statusReportSent = false;			// make sure that whatever is connected now gets a full status report
 		enabled = true;
 	}
 }
@@ -115,6 +119,64 @@ void AuxDevice::AppendAuxReply(OutputBuffer *reply, bool rawMessage) noexcept
 	}
 }
 
+// Calculate the CRC of a status report, leaving out the values of the up time fields because they change in every report.
+// These are "upTime" and "msUpTime" in the object model report and "time" in the M408 S2 report.
+/*static*/ uint32_t AuxDevice::GetStatusReportCrc(const OutputBuffer *report) noexcept
+{
+	constexpr uint64_t WindowMask = (1ull << (7 * 8)) - 1;
+	constexpr uint64_t UpTimeKey = ((uint64_t)'p' << 48) | ((uint64_t)'T' << 40) | ((uint64_t)'i' << 32) | ((uint64_t)'m' << 24) | ((uint64_t)'e' << 16) | ((uint64_t)'"' << 8) | (uint64_t)':';
+	constexpr uint64_t TimeKey = ((uint64_t)'"' << 48) | ((uint64_t)'t' << 40) | ((uint64_t)'i' << 32) | ((uint64_t)'m' << 24) | ((uint64_t)'e' << 16) | ((uint64_t)'"' << 8) | (uint64_t)':';
+
+	CRC32 crc;
+	uint64_t window = 0;						// the last 7 characters
+	bool skipping = false;
+	for (const OutputBuffer *buf = report; buf != nullptr; buf = buf->Next())
+	{
+		const char *_ecv_array data = buf->Data();
+		for (size_t i = 0; i < buf->DataLength(); ++i)
+		{
+			const char c = data[i];
+			if (skipping && (isDigit(c) || c == '.'))
+			{
+				continue;
+			}
+			crc.Update(c);
+			window = ((window << 8) | (uint8_t)c) & WindowMask;
+			skipping = (window == UpTimeKey || window == TimeKey);
+		}
+	}
+	return crc.Get();
+}
+
+// Send an unsolicited status report. PanelDue asks for status reports often but the status rarely changes while the machine is idle,
+// so if the report is the same as the last one we sent then we only send it every AuxStatusRepeatMillis.
+// This saves UART time and PanelDue processing time, and frees the output buffers sooner.
+void AuxDevice::AppendStatusReport(OutputBuffer *report) noexcept
+{
+	if (report == nullptr || report->Length() == 0 || !enabled)
+	{
+		OutputBuffer::ReleaseAll(report);
+		return;
+	}
+
+	const uint32_t crc = GetStatusReportCrc(report);
+	MutexLocker lock(mutex);
+	const uint32_t now = millis();
+	if (statusReportSent && crc == lastStatusReportCrc && now - whenStatusReportSent < AuxStatusRepeatMillis)
+	{
+		++statusReportsSkipped;
+		OutputBuffer::ReleaseAll(report);
+	}
+	else
+	{
+		lastStatusReportCrc = crc;
+		whenStatusReportSent = now;
+		statusReportSent = true;
+		++statusReportsSent;
+		outStack.Push(report);
+	}
+}
+
 bool AuxDevice::Flush() noexcept
 {
 	bool hasMore = !outStack.IsEmpty();
@@ -154,7 +216,10 @@ void AuxDevice::Diagnostics(MessageType mt, unsigned int index) noexcept
 	if (enabled)
 	{
 		const AsyncSerial::Errors errs = uart->GetAndClearErrors();
-		reprap.GetPlatform().MessageF(mt, "Aux%u errors %u,%u,%u\n", index, (unsigned int)errs.uartOverrun, (unsigned int)errs.bufferOverrun, (unsigned int)errs.framing);
+		reprap.GetPlatform().MessageF(mt, "Aux%u errors %u,%u,%u, status reports sent %" PRIu32 " skipped %" PRIu32 "\n",
+										index, (unsigned int)errs.uartOverrun, (unsigned int)errs.bufferOverrun, (unsigned int)errs.framing,
+										statusReportsSent, statusReportsSkipped);
+		statusReportsSent = statusReportsSkipped = 0;
 	}
 }
 
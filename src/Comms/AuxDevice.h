@@ -29,15 +29,23 @@ public:
 	void SendPanelDueMessage(const char* msg) noexcept;
 	void AppendAuxReply(const char *msg, bool rawMessage) noexcept;
 	void AppendAuxReply(OutputBuffer *reply, bool rawMessage) noexcept;
+	void AppendStatusReport(OutputBuffer *report) noexcept;
 	bool Flush() noexcept;
 
 	void Diagnostics(MessageType mt, unsigned int index) noexcept;
 
 private:
+	static uint32_t GetStatusReportCrc(const OutputBuffer *report) noexcept;
+
 	AsyncSerial *uart;
 	volatile OutputStack outStack;
 	Mutex mutex;
 	uint32_t seq;							// sequence number for output
+	uint32_t lastStatusReportCrc;			// CRC of the last unsolicited status report that we sent
+	uint32_t whenStatusReportSent;			// when we sent it
+	uint32_t statusReportsSent;				// statistics for diagnostics
+	uint32_t statusReportsSkipped;
+	bool statusReportSent;					// true if lastStatusReportCrc and whenStatusReportSent are valid
 	bool enabled;							// is it initialised and running?
 	bool raw;								// true if device is in raw mode
 };
@@ -66,21 +66,38 @@ constexpr unsigned int AUX_BAUD_RATE = 57600;			// Ditto - for auxiliary UART de
 constexpr unsigned int AUX2_BAUD_RATE = 115200;			// Ditto - for second auxiliary UART device
 constexpr uint32_t SERIAL_MAIN_TIMEOUT = 2000;			// timeout in ms for sending data to the main serial/USB port
 constexpr uint32_t AuxTimeout = 2000;					// timeout in ms for PanelDue replies
+constexpr uint32_t AuxStatusRepeatMillis = 5000;		// an unsolicited status report that is the same as the last one is only sent this often
 
 #define PANEL_DUE_FIRMWARE_FILE "PanelDueFirmware.bin"
 
 // Conditional GCode support
 constexpr unsigned int MaxBlockIndent = 10;				// maximum indentation of GCode. Each level of indentation introduced a new block.
 
+constexpr unsigned int MaxDeltaCalibrationIterations = 5;	// the maximum number of iterations when doing delta auto calibration
+constexpr float DeltaCalibrationConvergenceRatio = 0.95;	// after two iterations we stop when an iteration doesn't reduce the expected deviation to below this proportion
+constexpr uint32_t DefaultMaxLevellingPasses = 5;		// the default maximum number of probing passes when levelling the bed using leadscrews to a target deviation
+constexpr uint32_t MaxLevellingPasses = 20;				// the largest number of levelling passes that M671 accepts
+
 // Default Z probe values
 
 // The maximum number of probe points is constrained by RAM usage:
 // - Each probe point uses 12 bytes of static RAM. So 16 points use 192 bytes
-// - The delta calibration points use the same static ram, but when auto-calibrating we temporarily need more to hold the matrices etc. as follows:
-//     Using single-precision maths and up to 9-factor calibration: (9 + 5) * 4 bytes per point
-//     Using double-precision maths and up to 9-factor calibration: (9 + 5) * 8 bytes per point
-//   So 32 points using double precision arithmetic need 3584 bytes of stack space.
-#if SAM4E || SAM4S || SAME70 || SAME5x
+// - The delta calibration points use the same static ram, but when auto-calibrating we temporarily need more to hold the motor positions and residuals as follows:
+//     Using single-precision maths: 5 * 4 bytes per point
+//     Using double-precision maths: 5 * 8 bytes per point
+//   So 64 points using double precision arithmetic need 2560 bytes of stack space. Leadscrew calibration needs the same for up to 4 leadscrews.
+//   Each grid point needs 2 bytes for the height and another 6 bytes for the slopes if bicubic interpolation is supported.
+#if SAME70
+constexpr size_t MaxGridProbePoints = 1764;				// 1764 allows us to probe e.g. 400x400 at 10mm intervals
+constexpr size_t MaxAxis0GridPoints = 81;				// Maximum number of grid points in one X row
+constexpr size_t MaxProbePoints = 64;					// Maximum number of G30 probe points
+constexpr size_t MaxCalibrationPoints = 64;				// Should a power of 2 for speed
+#elif SAME5x
+constexpr size_t MaxGridProbePoints = 882;				// 882 allows us to probe e.g. 400x200 at 10mm intervals
+constexpr size_t MaxAxis0GridPoints = 61;				// Maximum number of grid points in one X row
+constexpr size_t MaxProbePoints = 64;					// Maximum number of G30 probe points
+constexpr size_t MaxCalibrationPoints = 64;				// Should a power of 2 for speed
+#elif SAM4E || SAM4S
 constexpr size_t MaxGridProbePoints = 441;				// 441 allows us to probe e.g. 400x400 at 20mm intervals
 constexpr size_t MaxAxis0GridPoints = 41;				// Maximum number of grid points in one X row
 constexpr size_t MaxProbePoints = 32;					// Maximum number of G30 probe points
@@ -185,20 +202,34 @@ constexpr size_t ShortGCodeLength = 64;
 #if SAME70 || SAME5x
 constexpr size_t OUTPUT_BUFFER_SIZE = 256;				// How many bytes does each OutputBuffer hold?
 constexpr size_t OUTPUT_BUFFER_COUNT = 40;				// How many OutputBuffer instances do we have?
+constexpr size_t MaxOutputBufferCount = 80;				// How many OutputBuffer instances may we have after creating more on demand?
 constexpr size_t RESERVED_OUTPUT_BUFFERS = 4;			// Number of reserved output buffers after long responses, enough to hold a status response
 #elif SAM4E || SAM4S
 constexpr size_t OUTPUT_BUFFER_SIZE = 256;				// How many bytes does each OutputBuffer hold?
 constexpr size_t OUTPUT_BUFFER_COUNT = 26;				// How many OutputBuffer instances do we have?
+constexpr size_t MaxOutputBufferCount = 40;				// How many OutputBuffer instances may we have after creating more on demand?
 constexpr size_t RESERVED_OUTPUT_BUFFERS = 4;			// Number of reserved output buffers after long responses, enough to hold a status response
 #elif __LPC17xx__
 constexpr uint16_t OUTPUT_BUFFER_SIZE = 256;            // How many bytes does each OutputBuffer hold?
 constexpr size_t OUTPUT_BUFFER_COUNT = 16;              // How many OutputBuffer instances do we have?
+constexpr size_t MaxOutputBufferCount = 16;             // How many OutputBuffer instances may we have after creating more on demand?
 constexpr size_t RESERVED_OUTPUT_BUFFERS = 2;           // Number of reserved output buffers after long responses. Must be enough for an HTTP header
 #else
 # error
 #endif
 
-constexpr size_t maxQueuedCodes = 16;					// How many codes can be queued?
+constexpr unsigned int ThumbnailStreamChunkChars = 2048;	// How many characters of base64 thumbnail data rr_thumbnail decodes at a time when sending a thumbnail in binary. Must be a multiple of 4.
+constexpr unsigned int OutputBufferQuotaPercent = 75;	// The percentage of the output buffers that each of HTTP, Telnet, FTP, USB and the SBC interface may hold
+constexpr size_t ObjectModelPageReserveBytes = 32;		// When reporting part of a large object model array, how many bytes to leave for the end of the response
+constexpr size_t DeferredMessageQueueLength = 16;		// How many messages from tasks other than the main task can wait to be sent. Must be a power of 2.
+
+constexpr size_t maxQueuedCodes = 16;					// How many codes can be queued initially?
+constexpr size_t MaxQueuedCodesLimit = 64;				// The code queue grows up to this size when it fills, if enough RAM is free
+constexpr size_t ToolPreheatReadChunkSize = 256;		// How many bytes of the print file the tool preheater reads at a time
+constexpr uint32_t ToolPreheatRateIntervalMillis = 2000;	// How often the tool preheater measures the rate at which the print file is being read
+constexpr uint32_t MaxToolPreheatSeconds = 600;			// The maximum tool preheat lookahead time that M568.1 accepts
+constexpr unsigned int UsbStreamingWindowLines = 32;	// In USB streaming mode, how many lines the host may send before it has had them acknowledged
+constexpr unsigned int UsbStreamingAckLines = UsbStreamingWindowLines/4;	// In USB streaming mode, we acknowledge lines in batches of this size unless the input is idle
 
 // These two definitions are only used if TRACK_OBJECT_NAMES is defined, however that definition isn't available in this file
 #if SAME70 || SAME5x
@@ -216,6 +247,110 @@ constexpr unsigned int MaxFilaments = 20;
 constexpr unsigned int MaxFilaments = 8;
 #endif
 
+// Size of the buffer used to read G-code files. This must be a multiple of FileGCodeInputReadAlignment, and should be a multiple of twice that value.
+#if SAME70 || SAME5x
+constexpr size_t FileGCodeInputBufferSize = 4096;
+#elif SAM4E || SAM4S
+constexpr size_t FileGCodeInputBufferSize = 2048;
+#else
+constexpr size_t FileGCodeInputBufferSize = 1024;
+#endif
+constexpr size_t FileGCodeInputReadAlignment = 512;		// the sector size of SD cards
+
+// The SD card read latency test (M122 P104 L) records latencies in a histogram with this many buckets of this width. Longer latencies go in the last bucket.
+constexpr size_t SdLatencyBuckets = 250;
+constexpr uint32_t SdLatencyBucketMicroseconds = 100;
+constexpr unsigned int SdLatencySeekOneIn = 16;			// how often the latency test seeks to a random position instead of reading on from where it was
+constexpr size_t MaxSkippedMoveLineLength = 100;		// moves of cancelled objects in lines longer than this are left for the parser instead of being skipped directly
+constexpr uint32_t ResumeSnapshotIntervalMillis = 10000;	// how often we save a resume snapshot while printing
+constexpr size_t ResumeSnapshotSlotSize = 1024;			// the size of each of the two records in the resume snapshot file, a multiple of the SD card sector size
+
+// The size of the RAM buffer that holds event log messages until the logger task writes them to the SD card
+#if SAME70 || SAME5x
+constexpr size_t LogRingBufferSize = 4096;
+#else
+constexpr size_t LogRingBufferSize = 2048;
+#endif
+constexpr size_t LogWriteBatchSize = 512;				// the logger task is woken up when at least this many bytes are waiting to be written
+
+// How many directory listings we cache and the number of bytes of RAM used to store each one. Each file needs 12 bytes plus the length of its name rounded up to a multiple of 4.
+#if SAME70 || SAME5x
+constexpr size_t DirectoryCacheSlots = 2;
+constexpr size_t DirectoryCacheSlotSize = 3072;
+#else
+constexpr size_t DirectoryCacheSlots = 1;
+constexpr size_t DirectoryCacheSlotSize = 2048;
+#endif
+
+// How many macro files we can hold in RAM and the maximum size of each one. Tool change files and pause.g are usually much smaller than this.
+constexpr size_t MacroCacheSlots = 4;
+constexpr size_t MacroCacheSlotSize = 2048;
+
+// How many web files we remember the details of, and how many of them we can hold in RAM. Each file held in RAM must fit in one network buffer.
+#if SAME70 || SAME5x
+constexpr size_t WebFileCacheEntries = 12;
+constexpr size_t WebFileCacheDataSlots = 4;
+#else
+constexpr size_t WebFileCacheEntries = 6;
+constexpr size_t WebFileCacheDataSlots = 1;
+#endif
+constexpr size_t WebFileCacheSlotSize = 2048;
+
+// Object model responses that we keep briefly so that several HTTP clients asking for the same thing at about the same time can share one
+#if SAME70 || SAME5x
+constexpr size_t ModelResponseCacheEntries = 4;
+#else
+constexpr size_t ModelResponseCacheEntries = 2;
+#endif
+constexpr uint32_t ModelResponseCacheLifetime = 100;		// milliseconds
+
+// The maximum size in 32-bit words of the cluster map that we allocate to allow fast seeking in a print file. A file in N fragments needs 2N + 2 words.
+#if SAME70 || SAME5x
+constexpr size_t MaxClusterMapWords = 258;
+#elif SAM4E || SAM4S
+constexpr size_t MaxClusterMapWords = 66;
+#else
+constexpr size_t MaxClusterMapWords = 18;
+#endif
+
+// The largest sliding window that we support in compressed G-code files, as a power of 2. The window is allocated from the heap when a compressed file is opened.
+#if SAME70 || SAME5x
+constexpr unsigned int MaxCompressedWindowBits = 11;
+#else
+constexpr unsigned int MaxCompressedWindowBits = 10;
+#endif
+
+// How often the filament monitor task checks the filament monitors against the commanded extrusion. This must be well below the 50ms minimum interval
+// between the extrusion readings taken by the pulsed filament monitor ISR, because a reading that has not been processed is overwritten by the next one.
+constexpr uint32_t FilamentMonitorCheckInterval = 5;	// milliseconds
+
+// How many StallGuard values M915.1 can capture before it starts to overwrite the oldest ones. Each one uses 12 bytes of statically-allocated RAM.
+#if SAME70 || SAME5x
+constexpr size_t StallGuardLogEntries = 1024;
+#else
+constexpr size_t StallGuardLogEntries = 256;
+#endif
+
+// How many of the hiccups since the last M122 each DDA ring records the cause of. Each one uses 16 bytes of statically-allocated RAM.
+constexpr size_t HiccupLogEntries = 8;
+
+// How many completed layers the job accounting keeps the print time and filament usage of. Each one uses 16 bytes of statically-allocated RAM.
+constexpr size_t JobAccountingRecentLayers = 16;
+
+// How many compiled meta command expressions we cache. Each one uses about 220 bytes of statically-allocated RAM.
+#if SAME70 || SAME5x
+constexpr size_t ExpressionCacheEntries = 16;
+#else
+constexpr size_t ExpressionCacheEntries = 4;
+#endif
+
+// How many resolved object model table entries we cache, which must be a power of 2. Each one uses 20 bytes of statically-allocated RAM.
+#if SAME70 || SAME5x
+constexpr size_t ObjectModelPathCacheEntries = 64;
+#else
+constexpr size_t ObjectModelPathCacheEntries = 16;
+#endif
+
 // Move system
 constexpr float DefaultFeedRate = 3000.0;				// The initial requested feed rate after resetting the printer, in mm/min
 constexpr float MaximumG0FeedRate = 60000.0;			// The maximum feed rate for G0 commands in mm/min, if the M203 settings permit
@@ -223,15 +358,45 @@ constexpr float MinRetractSpeed = 60.0;					// The minimum firmware retraction/u
 constexpr float DefaultRetractSpeed = 1000.0;			// The default firmware retraction and un-retraction speed, in mm/min
 constexpr float DefaultRetractLength = 2.0;
 
-constexpr float MaxArcDeviation = 0.005;				// maximum deviation from ideal arc due to segmentation
+constexpr float MaxArcDeviation = 0.005;				// default maximum deviation from ideal arc due to segmentation
+constexpr float MinArcDeviation = 0.0005;				// the lowest maximum arc deviation that M595 D accepts
 constexpr float MinArcSegmentLength = 0.1;				// G2 and G3 arc movement commands get split into segments at least this long
-constexpr float MaxArcSegmentLength = 1.0;				// G2 and G3 arc movement commands get split into segments at most this long
+constexpr float MaxArcSegmentLength = 1.0;				// by default G2 and G3 arc movement commands get split into segments at most this long
 constexpr float MinArcSegmentsPerSec = 200.0;
 constexpr float SegmentsPerFulArcCalculation = 8.0;		// we do the full sine/cosine calculation every this number of segments
 
 constexpr uint32_t DefaultIdleTimeout = 30000;			// Milliseconds
 constexpr float DefaultIdleCurrentFactor = 0.3;			// Proportion of normal motor current that we use for idle hold
 
+constexpr size_t FanTachoEdgeBufferSize = 16;			// how many of the most recent tacho edge times each local fan keeps, must be a power of 2
+constexpr uint32_t FanRpmWindowMillis = 1000;			// the fan RPM is averaged over the tacho edges in this window, or over the last two edges if they are further apart
+constexpr uint32_t FanTachoTimeoutMillis = 3000;		// if there has been no tacho edge for this long then we report zero RPM
+constexpr float FanRpmControlGain = 0.5;				// how fast the fan RPM controller changes the PWM, per second per unit of speed error as a fraction of the maximum RPM
+
+constexpr size_t MinFreeRamForPoolGrowth = 4096;		// the Move task only adds to the MoveSegment and DriveMovement pools if at least this much never-used RAM would remain
+
+constexpr size_t MaxCpuUsageTasks = 20;					// the maximum number of tasks that we collect CPU usage figures for
+constexpr uint32_t DefaultCpuUsageWindowSeconds = 5;	// the default length of the window over which we measure the CPU usage of each task
+constexpr uint32_t MaxCpuUsageWindowSeconds = 60;		// the maximum window length, which must be short enough that the step clock doesn't wrap round
+constexpr size_t SlowLoopTraceLength = 8;				// how many of the most recent slow main loops we report in M122
+constexpr uint32_t SlowLoopThresholdMillis = 100;		// main loops that take at least this long are recorded in the slow loop trace
+
+constexpr size_t EventTraceRecords = 1024;				// the number of 16-byte records in the event trace buffer, must be a power of 2
+constexpr size_t MaxEventTraceRecordsPerResponse = 120;	// 2560 characters after base64 encoding, about two TCP messages
+constexpr uint32_t EventTraceLateTimerMicroseconds = 20;	// step timer callbacks that run later than this are recorded in the event trace
+
+constexpr unsigned int MaxQueuedEvents = 8;				// the maximum number of events (heater faults, driver warnings etc.) waiting to be processed
+constexpr uint32_t EventRepeatSuppressMillis = 10000;	// a warning event that repeats one that finished processing less than this long ago is not queued again
+
+constexpr size_t DefaultMoveLogRecords = 500;			// how many completed moves M595.1 records if the N parameter is not given
+constexpr size_t MaxMoveLogRecords = 4000;				// the most completed moves that M595.1 can be asked to record
+
+constexpr size_t ParserBenchmarkBufferSize = 512;		// how much of the file the parser benchmark reads at a time
+constexpr size_t ParserBenchmarkMaxLineLength = 256;	// longer lines are truncated by the parser benchmark
+constexpr uint32_t ParserBenchmarkMaxMillis = 5000;		// the parser benchmark stops after this long, to keep well within the main task lockup timeout
+
+constexpr uint32_t SimulationFileBurstMillis = 10;		// when simulating a file, how long GCodes may spend executing commands from it on each pass through the main loop
+
 constexpr uint32_t DefaultGracePeriod = 10;				// how long we wait for more moves to become available before starting movement
 
 constexpr float DefaultNonlinearExtrusionLimit = 0.2;	// Maximum additional commanded extrusion to compensate for nonlinearity
@@ -244,12 +409,17 @@ constexpr float NOZZLE_DIAMETER = 0.5;					// Millimetres
 constexpr float FILAMENT_WIDTH = 1.75;					// Millimetres
 
 constexpr unsigned int MaxStackDepth = 10;				// Maximum depth of stack (was 5 in 3.01-RC2, increased to 7 for 3.01-RC3, 10 for 3.4.0beta6)
+constexpr unsigned int StartupProfileCommands = 40;		// How many distinct commands in config.g we record the total times of
+constexpr unsigned int StartupProfileSlowestLines = 8;	// How many of the slowest lines in config.g we record
+constexpr unsigned int StartupProfileReportedCommands = 12;	// How many of the slowest commands in config.g we report in M122
+constexpr unsigned int PreallocatedMachineStates = 8;	// Number of GCode machine states allocated at startup, so that macro calls and blocks normally reuse them
 
 // CNC and laser support
 constexpr int32_t DefaultMinSpindleRpm = 60;			// Default minimum available spindle RPM
 constexpr int32_t DefaultMaxSpindleRpm = 10000;			// Default spindle RPM at full PWM
 constexpr float DefaultMaxLaserPower = 255.0;			// Power setting in M3 command for full power
 constexpr uint32_t LaserPwmIntervalMillis = 5;			// Interval (ms) between adjusting the laser PWM during acceleration or deceleration
+constexpr uint32_t LaserPwmSyncIntervalMicroseconds = 200;	// Interval (us) between adjusting the laser PWM during acceleration or deceleration when it is synchronised to the step timer
 
 // I2C
 // A note on the i2C clock frequency.
@@ -260,6 +430,11 @@ constexpr uint32_t LaserPwmIntervalMillis = 5;			// Interval (ms) between adjust
 // At 100kHz I2C clock frequency, these issues are rare.
 constexpr uint32_t I2cClockFreq = 100000;				// clock frequency in Hz. 100kHz is 10us per bit, so about 90us per byte if there is no clock stretching
 constexpr size_t MaxI2cBytes = 32;						// max bytes in M260 or M261 command
+constexpr uint32_t I2cByteTimeoutMillis = 2;			// time allowed per byte when waiting for an interrupt-driven I2C transfer to complete
+
+// Shared SPI
+constexpr size_t SharedSpiDmaMinBytes = 32;				// transfers of at least this many bytes are done by DMA if supported, shorter ones are quicker to do by polling
+constexpr uint32_t SharedSpiDmaTimeoutMillis = 50;		// timeout when waiting for a DMA transfer on the shared SPI bus to complete
 
 // File handling
 #if defined(__LPC17xx__)
@@ -307,6 +482,7 @@ static_assert(MaxExpectedWebDirFilenameLength + strlen(WEB_DIR) + strlen(".gz")
 #define UPLOAD_EXTENSION ".part"					// Extension to a filename for a file being uploaded
 
 #define DEFAULT_LOG_FILE "eventlog.txt"
+#define FILE_INFO_INDEX_FILE "fileinfo.idx"		// in the system directory
 
 #define EOF_STRING "<!-- **EoF** -->"
 
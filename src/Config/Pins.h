@@ -126,6 +126,30 @@
 # define TRACK_OBJECT_NAMES		0
 #endif
 
+#ifndef SUPPORT_DYNAMIC_DDA_RING
+# define SUPPORT_DYNAMIC_DDA_RING	0				// set nonzero to make the main DDA ring longer at startup if there is enough free RAM
+#endif
+
+#ifndef SUPPORT_STEP_ISR_PROFILING
+# define SUPPORT_STEP_ISR_PROFILING	0				// set nonzero to record cycle counts of the step ISR for M122 and the object model
+#endif
+
+#ifndef SUPPORT_PREPARE_PROFILING
+# define SUPPORT_PREPARE_PROFILING	0				// set nonzero to record cycle counts of the phases of move preparation for M122
+#endif
+
+#ifndef SUPPORT_MOTION_BENCHMARK
+# define SUPPORT_MOTION_BENCHMARK	0				// set nonzero to benchmark move preparation and step generation when simulating a file in debug mode
+#endif
+
+#ifndef SUPPORT_MOVE_LOG
+# define SUPPORT_MOVE_LOG			(HAS_MASS_STORAGE && (SAME70 || SAME5x || SAM4E))	// set nonzero to support M595.1, which records the planned parameters of each completed move
+#endif
+
+#ifndef SUPPORT_PARSER_BENCHMARK
+# define SUPPORT_PARSER_BENCHMARK	0				// set nonzero to support M122 P110, which times the G-code parser and expression evaluator on a file
+#endif
+
 #define HAS_SMART_DRIVERS		(SUPPORT_TMC2660 || SUPPORT_TMC22xx || SUPPORT_TMC51xx)
 #ifndef HAS_STALL_DETECT
 # define HAS_STALL_DETECT		(SUPPORT_TMC2660 || SUPPORT_TMC51xx)
@@ -199,6 +223,92 @@
 # define HAS_EMBEDDED_FILES		0
 #endif
 
+#ifndef SUPPORT_BINARY_GCODE_FILES
+# define SUPPORT_BINARY_GCODE_FILES	(HAS_MASS_STORAGE && !defined(__LPC17xx__))	// set nonzero to allow print files to be in the pre-parsed binary format
+#endif
+
+#define HAS_BINARY_PARSER		(HAS_SBC_INTERFACE || SUPPORT_BINARY_GCODE_FILES)
+
+#ifndef SUPPORT_ASYNC_LOGGING
+# define SUPPORT_ASYNC_LOGGING		(HAS_MASS_STORAGE && (SAME70 || SAME5x || SAM4E || SAM4S))	// set nonzero to write the event log from a separate task
+#endif
+
+#ifndef SUPPORT_DIRECTORY_CACHE
+# define SUPPORT_DIRECTORY_CACHE	(HAS_MASS_STORAGE && (SAME70 || SAME5x || SAM4E || SAM4S))	// set nonzero to cache directory listings in RAM
+#endif
+
+#ifndef SUPPORT_MACRO_CACHE
+# define SUPPORT_MACRO_CACHE		(HAS_MASS_STORAGE && (SAME70 || SAME5x))	// set nonzero to hold the contents of small, frequently run macro files in RAM
+#endif
+
+#ifndef SUPPORT_WEB_FILE_CACHE
+# define SUPPORT_WEB_FILE_CACHE		(SUPPORT_HTTP && HAS_MASS_STORAGE && (SAME70 || SAME5x || SAM4E || SAM4S))	// set nonzero to cache web file details and small web files in RAM
+#endif
+
+#ifndef SUPPORT_METRICS
+# define SUPPORT_METRICS			(SUPPORT_HTTP)				// set nonzero to support the HTTP /metrics request, which reports counters and gauges in plain text for a monitoring system
+#endif
+
+#ifndef SUPPORT_BICUBIC_MESH
+# define SUPPORT_BICUBIC_MESH		(SAME70 || SAME5x || SAM4E)	// set nonzero to allow smooth bicubic interpolation of the height map, which needs 12 bytes of extra RAM per grid point
+#endif
+
+#ifndef SUPPORT_MODEL_RESPONSE_CACHE
+# define SUPPORT_MODEL_RESPONSE_CACHE	(SUPPORT_HTTP && SUPPORT_OBJECT_MODEL)	// set nonzero to share object model responses between HTTP clients that make the same request
+#endif
+
+#ifndef SUPPORT_WEBSOCKETS
+# define SUPPORT_WEBSOCKETS			(SUPPORT_HTTP && SUPPORT_OBJECT_MODEL)	// set nonzero to let HTTP clients subscribe to object model updates over a WebSocket
+#endif
+
+#ifndef SUPPORT_FILE_INFO_INDEX
+# define SUPPORT_FILE_INFO_INDEX	HAS_MASS_STORAGE	// set nonzero to keep an index of G-code file information on the SD card
+#endif
+
+#ifndef SUPPORT_COMPRESSED_GCODE_FILES
+# define SUPPORT_COMPRESSED_GCODE_FILES	(HAS_MASS_STORAGE && !defined(__LPC17xx__))	// set nonzero to allow print files to be compressed
+#endif
+
+#ifndef FILAMENT_MONITORS_AS_SEPARATE_TASK
+# define FILAMENT_MONITORS_AS_SEPARATE_TASK	(SAME70 || SAME5x || SAM4E)	// set nonzero to check the filament monitors at a fixed rate in their own task instead of in the main loop
+#endif
+
+#ifndef SUPPORT_STALLGUARD_LOG
+# define SUPPORT_STALLGUARD_LOG		(HAS_STALL_DETECT && HAS_MASS_STORAGE && (SUPPORT_TMC51xx || SUPPORT_TMC22xx))	// set nonzero to support capturing StallGuard values using M915.1
+#endif
+
+#ifndef SUPPORT_JOB_ACCOUNTING
+# define SUPPORT_JOB_ACCOUNTING		(SAME70 || SAME5x || SAM4E)	// set nonzero to add up the print time and filament used by each layer and each build plate object
+#endif
+
+#ifndef SUPPORT_TOOL_PREHEAT
+# define SUPPORT_TOOL_PREHEAT		(HAS_MASS_STORAGE && (SAME70 || SAME5x || SAM4E))	// set nonzero to read ahead in the print file and preheat the next tool (M568.1)
+#endif
+
+#ifndef SUPPORT_RESUME_SNAPSHOT
+# define SUPPORT_RESUME_SNAPSHOT	(HAS_MASS_STORAGE && (SAME70 || SAME5x || SAM4E))	// set nonzero to save binary resume snapshots periodically and on power failure
+#endif
+
+#ifndef SUPPORT_STARTUP_PROFILE
+# define SUPPORT_STARTUP_PROFILE	(SAME70 || SAME5x || SAM4E)	// set nonzero to record how long each command in config.g takes and report it in M122
+#endif
+
+#ifndef SUPPORT_SHARED_SPI_DMA
+# define SUPPORT_SHARED_SPI_DMA		((SAM4E || SAM4S) && USART_SPI)	// set nonzero to use the PDC for long transfers on the shared SPI bus
+#endif
+
+#ifndef SUPPORT_CPU_USAGE_STATS
+# define SUPPORT_CPU_USAGE_STATS	(SAME70 || SAME5x || SAM4E)	// set nonzero to collect per-task and ISR CPU usage over a fixed window for M122 and the object model
+#endif
+
+#ifndef SUPPORT_SPIN_TIMING_STATS
+# define SUPPORT_SPIN_TIMING_STATS	(SAME70 || SAME5x || SAM4E)	// set nonzero to keep histograms of how long each module takes to spin in the main loop, and a trace of slow loops
+#endif
+
+#ifndef SUPPORT_EVENT_TRACE
+# define SUPPORT_EVENT_TRACE		0			// set nonzero to record move, timer, file, network and CAN events in a RAM ring buffer that can be read using rr_trace
+#endif
+
 #if !HAS_MASS_STORAGE && !HAS_SBC_INTERFACE
 # if SUPPORT_12864_LCD
 #  error "12864 LCD support requires mass storage or SBC interface"
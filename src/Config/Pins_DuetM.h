@@ -202,6 +202,8 @@ constexpr Pin EncoderPinSw = PortAPin(7);
 #define USART_SPI		1
 #define USART_SSPI		USART0
 #define ID_SSPI			ID_USART0
+#define SSPI_IRQn		USART0_IRQn
+#define SSPI_Handler	USART0_Handler
 
 constexpr PinDescription PinTable[] =
 {	//	TC					PWM					ADC				Capability				PinNames
@@ -252,6 +252,8 @@ constexpr Pin LcdBeepPin = PortDPin(21);		// connlcd.10	-> exp1.10
 #define USART_SPI		1
 #define USART_SSPI		USART0
 #define ID_SSPI			ID_USART0
+#define SSPI_IRQn		USART0_IRQn
+#define SSPI_Handler	USART0_Handler
 
 // List of assignable pins and their mapping from names to MPU ports. This is indexed by logical pin number.
 // The names must match user input that has been concerted to lowercase and had _ and - characters stripped out.
@@ -11,9 +11,10 @@
 
 constexpr unsigned int TILE_WIDTH = 8;
 constexpr unsigned int TILE_HEIGHT = 8;
+constexpr PixelNumber NumColumns = 128;
 
 Lcd7567::Lcd7567(const LcdFont * const fnts[], size_t nFonts) noexcept
-	: Lcd(64, 128, fnts, nFonts, SpiMode::mode3)
+	: Lcd(64, NumColumns, fnts, nFonts, SpiMode::mode3)
 {
 }
 
@@ -72,13 +73,9 @@ bool Lcd7567::FlushSome() noexcept
 			startRow = nextFlushRow + TILE_HEIGHT;			// flag this row as flushed because it will be soon
 		}
 
-		// Flush that row (which is 8 pixels high)
-		SelectDevice();
-		SetGraphicsAddress(nextFlushRow, startCol & (~7));
-		StartDataTransaction();
-
-		// Send tiles of 1x8 for the desired (quantized) width of the dirty rectangle
-		//TODO should we limit how many tiles we send on each call?
+		// Build the tiles of 1x8 for the desired (quantized) width of the dirty rectangle, so that we can send the whole row in one transfer
+		uint32_t buffer[2 * (NumColumns/TILE_WIDTH)];
+		size_t bufferWords = 0;
 		for (PixelNumber x = startCol & (~7); x < endCol; x += TILE_WIDTH)
 		{
 			// Gather the bits for 8 vertical lines of 8 pixels (LSB is the top pixel)
@@ -96,10 +93,15 @@ bool Lcd7567::FlushSome() noexcept
 				p += numCols/8;
 			}
 
-			const uint32_t buffer[2] = { data0, data1 };
-			device.TransceivePacket((const uint8_t*)buffer, nullptr, 8);
+			buffer[bufferWords++] = data0;
+			buffer[bufferWords++] = data1;
 		}
 
+		// Flush that row (which is 8 pixels high)
+		SelectDevice();
+		SetGraphicsAddress(nextFlushRow, startCol & (~7));
+		StartDataTransaction();
+		device.TransceivePacket((const uint8_t*)buffer, nullptr, bufferWords * sizeof(buffer[0]));
 		EndDataTransaction();
 		DeselectDevice();
 
@@ -159,10 +161,13 @@ void Lcd7567::SendByte(uint8_t byteToSend) noexcept
 // The display memory is organized in 8+1 pages (of horizontal rows) and 0-131 columns
 void Lcd7567::SetGraphicsAddress(unsigned int r, unsigned int c) noexcept
 {
-	// TODO can we send these in one transaction instead of 3?
-	SendByte(0x10 | ((c >> 4) & 0b00001111));	// 0001#### Set Column Address MSB
-	SendByte(0x00 | (c & 0b00001111));			// 0000#### Set Column Address LSB
-	SendByte(0xB0 | ((r >> 3) & 0b00001111));	// 1011#### Set Page Address
+	const uint8_t data[3] =
+	{
+		(uint8_t)(0x10 | ((c >> 4) & 0b00001111)),	// 0001#### Set Column Address MSB
+		(uint8_t)(0x00 | (c & 0b00001111)),			// 0000#### Set Column Address LSB
+		(uint8_t)(0xB0 | ((r >> 3) & 0b00001111))	// 1011#### Set Page Address
+	};
+	device.TransceivePacket(data, nullptr, sizeof(data));
 
 	CommandDelay();
 }
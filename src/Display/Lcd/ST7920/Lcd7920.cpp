@@ -101,8 +101,8 @@ bool Lcd7920::FlushSome() noexcept
 			uint8_t *ptr = image + (((numCols/8) * nextFlushRow) + (2 * startColNum));
 			while (startColNum < endColNum)
 			{
-				SendLcdData(*ptr++);
-				SendLcdData(*ptr++);
+				SendLcdData(ptr[0], ptr[1]);
+				ptr += 2;
 				++startColNum;
 				DataDelay();
 			}
@@ -137,10 +137,11 @@ void Lcd7920::SendLcdCommand(uint8_t byteToSend) noexcept
 	device.TransceivePacket(data, nullptr, 3);
 }
 
-void Lcd7920::SendLcdData(uint8_t byteToSend) noexcept
+// Send a 16-bit word of graphics data in one SPI transfer
+void Lcd7920::SendLcdData(uint8_t byte1, uint8_t byte2) noexcept
 {
-	uint8_t data[3] = { (uint8_t)0xFA, (uint8_t)(byteToSend & 0xF0), (uint8_t)(byteToSend << 4) };
-	device.TransceivePacket(data, nullptr, 3);
+	uint8_t data[6] = { (uint8_t)0xFA, (uint8_t)(byte1 & 0xF0), (uint8_t)(byte1 << 4), (uint8_t)0xFA, (uint8_t)(byte2 & 0xF0), (uint8_t)(byte2 << 4) };
+	device.TransceivePacket(data, nullptr, 6);
 }
 
 #endif
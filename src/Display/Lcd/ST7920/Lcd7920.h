@@ -30,7 +30,7 @@ private:
 	void CommandDelay() noexcept;
 	void DataDelay() noexcept;
 	void SendLcdCommand(uint8_t byteToSend) noexcept;
-	void SendLcdData(uint8_t byteToSend) noexcept;
+	void SendLcdData(uint8_t byte1, uint8_t byte2) noexcept;
 	void SetGraphicsAddress(unsigned int r, unsigned int c) noexcept;
 };
 
@@ -318,6 +318,13 @@ void ValueMenuItem::CorePrint(Lcd& lcd) noexcept
 	}
 }
 
+// Return the factor to multiply a value by so that rounding it gives the least significant digit that we display
+/*static*/ float ValueMenuItem::DecimalScale(uint8_t decimals) noexcept
+{
+	static constexpr float Scales[] = { 1.0, 10.0, 100.0, 1000.0, 10000.0 };
+	return Scales[min<size_t>(decimals, ARRAY_SIZE(Scales) - 1)];
+}
+
 void ValueMenuItem::Draw(Lcd& lcd, PixelNumber rightMargin, bool highlight) noexcept
 {
 	if (IsVisible())
@@ -464,7 +471,9 @@ void ValueMenuItem::Draw(Lcd& lcd, PixelNumber rightMargin, bool highlight) noex
 					break;
 
 				case PrintFormat::asFloat:
-					if (currentValue.f != oldValue.f)
+				case PrintFormat::asPercent:
+					// Only redraw if the value as displayed has changed, so that small fluctuations in temperatures etc. don't cause the item to be redrawn
+					if (lrintf(currentValue.f * DecimalScale(decimals)) != lrintf(oldValue.f * DecimalScale(decimals)))
 					{
 						itemChanged = true;
 					}
@@ -158,6 +158,8 @@ private:
 	enum class AdjustMode : uint8_t { displaying, adjusting, liveAdjusting };
 	enum class PrintFormat : uint8_t { undefined, asFloat, asUnsigned, asSigned, asPercent, asText, asIpAddress, asTime };
 
+	static float DecimalScale(uint8_t decimals) noexcept;
+
 	bool Adjust_SelectHelper() noexcept;
 	bool Adjust_AlterHelper(int clicks) noexcept;
 
@@ -95,6 +95,7 @@ public:
 	virtual bool Prime(const Kinematics& kin, const AxisDriversConfig& axisDrivers) noexcept = 0;
 	virtual void AppendDetails(const StringRef& str) noexcept = 0;
 	virtual bool ShouldReduceAcceleration() const noexcept { return false; }
+	virtual bool IsInterruptDriven() const noexcept { return false; }	// true if every input of this endstop calls EndstopsManager::OnLocalInputChanged when it changes
 
 #if SUPPORT_CAN_EXPANSION
 	// Process a remote endstop input change that relates to this endstop
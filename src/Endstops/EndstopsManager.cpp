@@ -20,6 +20,7 @@
 #include <GCodes/GCodeBuffer/GCodeBuffer.h>
 #include <GCodes/GCodes.h>
 #include <Movement/Move.h>
+#include <Movement/StepTimer.h>
 #include <Platform/OutputMemory.h>
 #include <Heating/Heat.h>
 #include <Heating/Sensors/TemperatureSensor.h>
@@ -31,6 +32,9 @@
 ReadWriteLock EndstopsManager::endstopsLock;
 ReadWriteLock EndstopsManager::zProbesLock;
 
+volatile bool EndstopsManager::localInputChanged = false;
+volatile uint32_t EndstopsManager::whenLocalInputChanged = 0;
+
 #if SUPPORT_OBJECT_MODEL
 
 // Object model table and functions
@@ -103,7 +107,8 @@ EndstopsManager::EndstopsManager() noexcept
 #if HAS_STALL_DETECT
 		  extrudersEndstop(nullptr),
 #endif
-		  isHomingMove(false)
+		  maxInterruptLatency(0), numInterruptHits(0),
+		  isHomingMove(false), allActiveInterruptDriven(false)
 {
 	for (Endstop *& es : axisEndstops)
 	{
@@ -185,6 +190,8 @@ bool EndstopsManager::EnableAxisEndstops(AxesBitmap axes, bool forHoming, bool&
 	activeEndstops = nullptr;
 	reduceAcceleration = false;
 	isHomingMove = forHoming && axes.IsNonEmpty();
+	allActiveInterruptDriven = true;
+	localInputChanged = true;							// make sure that the first call to CheckEndstops checks them all
 	const Kinematics& kin = reprap.GetMove().GetKinematics();
 	while (axes.IsNonEmpty())
 	{
@@ -194,6 +201,7 @@ bool EndstopsManager::EnableAxisEndstops(AxesBitmap axes, bool forHoming, bool&
 		if (es != nullptr && es->Prime(kin, reprap.GetPlatform().GetAxisDriversConfig(axis)))
 		{
 			AddToActive(*es);
+			allActiveInterruptDriven = allActiveInterruptDriven && es->IsInterruptDriven();
 			if (es->ShouldReduceAcceleration())
 			{
 				reduceAcceleration = true;
@@ -213,6 +221,7 @@ bool EndstopsManager::EnableZProbe(size_t probeNumber, bool probingAway) noexcep
 {
 	activeEndstops = nullptr;
 	isHomingMove = false;
+	allActiveInterruptDriven = false;
 	if (probeNumber < MaxZProbes && zProbes[probeNumber] != nullptr)
 	{
 		zProbes[probeNumber]->SetProbingAway(probingAway);
@@ -254,6 +263,7 @@ bool EndstopsManager::EnableExtruderEndstops(ExtrudersBitmap extruders) noexcept
 
 		extrudersEndstop->SetDrivers(drivers);
 		AddToActive(*extrudersEndstop);
+		allActiveInterruptDriven = false;
 #else
 		return false;
 #endif
@@ -261,17 +271,54 @@ bool EndstopsManager::EnableExtruderEndstops(ExtrudersBitmap extruders) noexcept
 	return true;
 }
 
+// Record that an interrupt-driven input may have changed state. This is called from the pin change ISR, which has a higher priority than the step ISR,
+// so we mustn't stop the motors here. We just record the change so that the next call to CheckEndstops from the step ISR acts on it.
+/*static*/ void EndstopsManager::OnLocalInputChanged() noexcept
+{
+	if (!localInputChanged)
+	{
+		whenLocalInputChanged = StepTimer::GetTimerTicks();
+		localInputChanged = true;
+	}
+}
+
+// Record how long it took us to act on an input change that caused an interrupt-driven endstop to trigger
+void EndstopsManager::RecordInterruptLatency(uint32_t whenChanged) noexcept
+{
+	const uint32_t latency = StepTimer::GetTimerTicks() - whenChanged;
+	if (latency > maxInterruptLatency)
+	{
+		maxInterruptLatency = latency;
+	}
+	++numInterruptHits;
+}
+
 // Check the endstops.
 // If an endstop has triggered, remove it from the active list and return its details
 EndstopHitDetails EndstopsManager::CheckEndstops() noexcept
 {
 	EndstopHitDetails ret;									// the default constructor will clear all fields
+	const bool checkingBecauseInputChanged = allActiveInterruptDriven;
+	if (checkingBecauseInputChanged)
+	{
+		if (!localInputChanged)
+		{
+			return ret;										// none of the inputs has changed since we last looked, so nothing can have triggered
+		}
+		localInputChanged = false;							// clear this before we read the inputs, so that we don't miss a change that happens while we check them
+	}
+
+	const uint32_t whenChanged = whenLocalInputChanged;
 	EndstopOrZProbe *actioned = nullptr;
 	for (EndstopOrZProbe *esp = activeEndstops; esp != nullptr; esp = esp->GetNext())
 	{
 		EndstopHitDetails hd = esp->CheckTriggered();
 		if (hd.GetAction() == EndstopHitAction::stopAll)
 		{
+			if (checkingBecauseInputChanged)
+			{
+				RecordInterruptLatency(whenChanged);
+			}
 			activeEndstops = nullptr;						// no need to do anything else
 			if (!isHomingMove)
 			{
@@ -289,6 +336,10 @@ EndstopHitDetails EndstopsManager::CheckEndstops() noexcept
 
 	if (ret.GetAction() != EndstopHitAction::none)
 	{
+		if (checkingBecauseInputChanged)
+		{
+			RecordInterruptLatency(whenChanged);
+		}
 		if (actioned->Acknowledge(ret))
 		{
 			// The actioned endstop has completed so remove it from the active list
@@ -501,6 +552,16 @@ bool EndstopsManager::Stopped(size_t axis) const noexcept
 	return (axisEndstops[axis] != nullptr) && axisEndstops[axis]->Stopped();
 }
 
+void EndstopsManager::Diagnostics(MessageType mtype) noexcept
+{
+	const uint32_t maxLatency = maxInterruptLatency;
+	const unsigned int numHits = numInterruptHits;
+	maxInterruptLatency = 0;
+	numInterruptHits = 0;
+	reprap.GetPlatform().MessageF(mtype, "Interrupt-driven endstop hits %u, max latency %" PRIu32 "us\n",
+									numHits, (uint32_t)(((uint64_t)maxLatency * 1000000u)/StepClockRate));
+}
+
 void EndstopsManager::GetM119report(const StringRef& reply) noexcept
 {
 	reply.copy("Endstops - ");
@@ -728,6 +789,21 @@ GCodeResult EndstopsManager::HandleG31(GCodeBuffer& gb, const StringRef& reply)
 	return zp->HandleG31(gb, reply);
 }
 
+// Set or print the parameters used to scan the bed with a Z probe. Called by M558.1.
+GCodeResult EndstopsManager::HandleM558Point1(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
+{
+	const unsigned int probeNumber = (gb.Seen('K')) ? gb.GetLimitedUIValue('K', MaxZProbes) : 0;
+	ReadLocker lock(zProbesLock);
+	ZProbe * const zp = zProbes[probeNumber];
+	if (zp == nullptr)
+	{
+		reply.copy("Invalid Z probe index");
+		return GCodeResult::error;
+	}
+
+	return zp->HandleM558Point1(gb, reply);
+}
+
 #if SUPPORT_OBJECT_MODEL
 
 size_t EndstopsManager::GetNumProbesToReport() const noexcept
@@ -772,7 +848,7 @@ void EndstopsManager::HandleRemoteZProbeChange(CanAddress src, uint8_t handleMaj
 }
 
 // This is called when we update endstop states because of a message from a remote board.
-// In time we may use it to help implement interrupt-driven local endstops too, but for now those are checked in the step ISR by a direct call to DDA::CheckEndstops().
+// Interrupt-driven local endstops are still checked in the step ISR by DDA::CheckEndstops(), because the pin change ISR has a higher priority than the step ISR.
 void EndstopsManager::OnEndstopOrZProbeStatesChanged() noexcept
 {
 	const uint32_t oldPrio = ChangeBasePriority(NvicPriorityStep);		// shut out the step interrupt
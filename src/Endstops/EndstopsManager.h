@@ -41,6 +41,11 @@ public:
 	// Get the first endstop that has triggered and remove it from the active list if appropriate
 	EndstopHitDetails CheckEndstops() noexcept;
 
+	// Record that the state of an interrupt-driven local endstop input may have changed. Called from the pin change ISR.
+	static void OnLocalInputChanged() noexcept;
+
+	void Diagnostics(MessageType mtype) noexcept;
+
 	// Configure the endstops in response to M574
 	GCodeResult HandleM574(GCodeBuffer& gb, const StringRef& reply, OutputBuffer*& outbuf) THROWS(GCodeException);
 
@@ -54,6 +59,7 @@ public:
 	// Z probe
 	GCodeResult HandleM558(GCodeBuffer& gb, const StringRef &reply) THROWS(GCodeException);		// M558
 	GCodeResult HandleG31(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);		// G31
+	GCodeResult HandleM558Point1(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);	// M558.1
 
 	ReadLockedPointer<ZProbe> GetZProbe(size_t index) const noexcept;
 	ReadLockedPointer<ZProbe> GetZProbeOrDefault(size_t index) const noexcept;
@@ -84,6 +90,8 @@ private:
 	// Add an endstop to the active list
 	void AddToActive(EndstopOrZProbe& e) noexcept;
 
+	void RecordInterruptLatency(uint32_t whenChanged) noexcept;
+
 #if SUPPORT_OBJECT_MODEL
 	size_t GetNumProbesToReport() const noexcept;
 #endif
@@ -97,6 +105,9 @@ private:
 	static ReadWriteLock endstopsLock;
 	static ReadWriteLock zProbesLock;
 
+	static volatile bool localInputChanged;				// true if an interrupt-driven input has changed since we last checked the endstops
+	static volatile uint32_t whenLocalInputChanged;		// the step clock when localInputChanged was set
+
 	EndstopOrZProbe * volatile activeEndstops;			// linked list of endstops and Z probes that are active for the current move
 
 	Endstop *axisEndstops[MaxAxes];						// the endstops assigned to each axis (each one may have several switches), each may be null
@@ -106,7 +117,11 @@ private:
 	ZProbe *zProbes[MaxZProbes];						// the Z probes used. The first one is always non-null.
 	ZProbe *defaultZProbe;
 
+	uint32_t maxInterruptLatency;						// the longest time in step clocks from an endstop input changing to us acting on it
+	unsigned int numInterruptHits;						// how many interrupt-driven endstop hits we have acted on
+
 	bool isHomingMove;									// true if calls to CheckEndstops are for the purpose of homing
+	bool allActiveInterruptDriven;						// true if all the active endstops only need to be checked when an input has changed
 };
 
 #endif /* SRC_ENDSTOPS_ENDSTOPMANAGER_H_ */
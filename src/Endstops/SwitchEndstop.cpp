@@ -11,6 +11,7 @@
 #include <Platform/Platform.h>
 #include <Movement/Kinematics/Kinematics.h>
 #include <GCodes/GCodeBuffer/GCodeBuffer.h>
+#include "EndstopsManager.h"
 
 #if SUPPORT_CAN_EXPANSION
 # include <CanId.h>
@@ -20,7 +21,7 @@
 #endif
 
 // Switch endstop
-SwitchEndstop::SwitchEndstop(uint8_t p_axis, EndStopPosition pos) noexcept : Endstop(p_axis, pos), numPortsUsed(0)
+SwitchEndstop::SwitchEndstop(uint8_t p_axis, EndStopPosition pos) noexcept : Endstop(p_axis, pos), numPortsUsed(0), interruptDriven(false)
 {
 	// ports will be initialised automatically by the IoPort default constructor
 }
@@ -33,6 +34,10 @@ SwitchEndstop::~SwitchEndstop() noexcept
 // Release any local and remote ports we have allocated and set numPortsUsed to zero
 void SwitchEndstop::ReleasePorts() noexcept
 {
+	interruptsAttached.Iterate([this](unsigned int i, unsigned int) noexcept { ports[i].DetachInterrupt(); });
+	interruptsAttached.Clear();
+	interruptDriven = false;
+
 	while (numPortsUsed != 0)
 	{
 		--numPortsUsed;
@@ -67,6 +72,7 @@ GCodeResult SwitchEndstop::Configure(const char *pinNames, const StringRef& repl
 
 	// Parse the string into individual port names
 	size_t index = 0;
+	bool allPortsInterruptDriven = true;
 	while (numPortsUsed < MaxDriversPerAxis)
 	{
 		// Get the next port name
@@ -100,7 +106,21 @@ GCodeResult SwitchEndstop::Configure(const char *pinNames, const StringRef& repl
 				ReleasePorts();
 				return GCodeResult::error;
 			}
+			if (ports[numPortsUsed].AttachInterrupt(InputInterrupt, InterruptMode::change, CallbackParameter(this)))
+			{
+				interruptsAttached.SetBit(numPortsUsed);
+			}
+			else
+			{
+				allPortsInterruptDriven = false;				// e.g. the pin is shared or has no interrupt channel free, so we will poll this endstop
+			}
+		}
+#if SUPPORT_CAN_EXPANSION
+		if (boardAddress != CanInterface::GetCanAddress())
+		{
+			allPortsInterruptDriven = false;
 		}
+#endif
 
 		++numPortsUsed;
 		if (c != '+')
@@ -109,9 +129,26 @@ GCodeResult SwitchEndstop::Configure(const char *pinNames, const StringRef& repl
 		}
 		++index;					// skip the "+"
 	}
+
+	if (allPortsInterruptDriven)
+	{
+		interruptDriven = true;
+	}
+	else
+	{
+		// Don't leave any interrupts attached, because we poll either all the inputs of an endstop or none of them
+		interruptsAttached.Iterate([this](unsigned int i, unsigned int) noexcept { ports[i].DetachInterrupt(); });
+		interruptsAttached.Clear();
+	}
 	return GCodeResult::ok;
 }
 
+// Interrupt service routine called when one of our local inputs changes state
+/*static*/ void SwitchEndstop::InputInterrupt(CallbackParameter p) noexcept
+{
+	EndstopsManager::OnLocalInputChanged();
+}
+
 EndStopType SwitchEndstop::GetEndstopType() const noexcept
 {
 	return EndStopType::inputPin;
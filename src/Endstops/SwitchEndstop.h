@@ -25,6 +25,7 @@ public:
 	EndstopHitDetails CheckTriggered() noexcept override;
 	bool Acknowledge(EndstopHitDetails what) noexcept override;
 	void AppendDetails(const StringRef& str) noexcept override;
+	bool IsInterruptDriven() const noexcept override { return interruptDriven; }
 
 #if SUPPORT_CAN_EXPANSION
 	// Process a remote endstop input change that relates to this endstop. Return true if the buffer has been freed.
@@ -38,6 +39,7 @@ private:
 	typedef Bitmap<uint16_t> PortsBitmap;
 
 	void ReleasePorts() noexcept;
+	static void InputInterrupt(CallbackParameter p) noexcept;
 
 	inline bool IsTriggered(size_t index) const noexcept
 	{
@@ -61,6 +63,8 @@ private:
 	PortsBitmap portsLeftToTrigger;
 	size_t numPortsLeftToTrigger;
 	bool stopAll;
+	bool interruptDriven;					// true if all the ports are local and we attached interrupts to them
+	PortsBitmap interruptsAttached;			// which ports we have attached interrupts to
 };
 
 #endif /* SRC_ENDSTOPS_SWITCHENDSTOP_H_ */
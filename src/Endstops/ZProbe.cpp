@@ -59,6 +59,14 @@ constexpr ObjectModelArrayDescriptor ZProbe::speedsArrayDescriptor =
 				{ return ExpressionValue(InverseConvertSpeedToMmPerMin(((const ZProbe*)self)->probeSpeeds[context.GetLastIndex()]), 1); }
 };
 
+constexpr ObjectModelArrayDescriptor ZProbe::diveHeightsArrayDescriptor =
+{
+	nullptr,
+	[] (const ObjectModel *self, const ObjectExplorationContext&) noexcept -> size_t { return ARRAY_SIZE(ZProbe::diveHeights); },
+	[] (const ObjectModel *self, ObjectExplorationContext& context) noexcept -> ExpressionValue
+				{ return ExpressionValue(((const ZProbe*)self)->diveHeights[context.GetLastIndex()], 1); }
+};
+
 constexpr ObjectModelTableEntry ZProbe::objectModelTable[] =
 {
 	// Within each group, these entries must be in alphabetical order
@@ -66,7 +74,8 @@ constexpr ObjectModelTableEntry ZProbe::objectModelTable[] =
 	{ "calibrationTemperature",		OBJECT_MODEL_FUNC(self->calibTemperature, 1), 												ObjectModelEntryFlags::none },
 	{ "deployedByUser",				OBJECT_MODEL_FUNC(self->isDeployedByUser), 													ObjectModelEntryFlags::none },
 	{ "disablesHeaters",			OBJECT_MODEL_FUNC((bool)self->misc.parts.turnHeatersOff), 									ObjectModelEntryFlags::none },
-	{ "diveHeight",					OBJECT_MODEL_FUNC(self->diveHeight, 1), 													ObjectModelEntryFlags::none },
+	{ "diveHeight",					OBJECT_MODEL_FUNC(self->diveHeights[0], 1), 												ObjectModelEntryFlags::none },
+	{ "diveHeights",				OBJECT_MODEL_FUNC_NOSELF(&diveHeightsArrayDescriptor), 										ObjectModelEntryFlags::none },
 	{ "lastStopHeight",				OBJECT_MODEL_FUNC(self->lastStopHeight, 3), 												ObjectModelEntryFlags::none },
 	{ "maxProbeCount",				OBJECT_MODEL_FUNC((int32_t)self->misc.parts.maxTaps), 										ObjectModelEntryFlags::none },
 	{ "offsets",					OBJECT_MODEL_FUNC_NOSELF(&offsetsArrayDescriptor), 											ObjectModelEntryFlags::none },
@@ -83,7 +92,7 @@ constexpr ObjectModelTableEntry ZProbe::objectModelTable[] =
 	{ "value",						OBJECT_MODEL_FUNC_NOSELF(&valueArrayDescriptor), 											ObjectModelEntryFlags::live },
 };
 
-constexpr uint8_t ZProbe::objectModelTableDescriptor[] = { 1, 18 };
+constexpr uint8_t ZProbe::objectModelTableDescriptor[] = { 1, 19 };
 
 DEFINE_GET_OBJECT_MODEL_TABLE(ZProbe)
 
@@ -108,12 +117,14 @@ void ZProbe::SetDefaults() noexcept
 	{
 		tc = 0.0;
 	}
-	diveHeight = DefaultZDive;
+	diveHeights[0] = diveHeights[1] = DefaultZDive;
 	probeSpeeds[0] = probeSpeeds[1] = ConvertSpeedFromMmPerSec(DefaultProbingSpeed);
 	travelSpeed = ConvertSpeedFromMmPerSec(DefaultZProbeTravelSpeed);
 	recoveryTime = 0.0;
 	tolerance = DefaultZProbeTolerance;
 	misc.parts.maxTaps = DefaultZProbeTaps;
+	scanCoefficients[0] = scanCoefficients[1] = 0.0;
+	scanSpeed = ConvertSpeedFromMmPerSec(DefaultZProbeTravelSpeed);
 	misc.parts.turnHeatersOff = misc.parts.saveToConfigOverride = misc.parts.probingAway = false;
 	type = ZProbeType::none;
 	sensor = -1;
@@ -150,6 +161,10 @@ bool ZProbe::WriteParameters(FileStore *f, unsigned int probeNumber) const noexc
 		}
 	}
 	scratchString.catf(" Z%.2f\n", (double)-offsets[Z_AXIS]);
+	if (scanCoefficients[0] != 0.0)
+	{
+		scratchString.catf("M558.1 K%u S%.6f:%.8f\n", probeNumber, (double)scanCoefficients[0], (double)scanCoefficients[1]);
+	}
 	return f->Write(scratchString.c_str());
 }
 
@@ -216,6 +231,19 @@ int ZProbe::GetSecondaryValues(int& v1) const noexcept
 	return 0;
 }
 
+// Return true if this probe can be used to scan the bed, which needs a probe that gives a reading that varies with height and a calibration for it
+bool ZProbe::CanScan() const noexcept
+{
+	return (type == ZProbeType::analog || type == ZProbeType::alternateAnalog || type == ZProbeType::dumbModulated) && scanCoefficients[0] != 0.0;
+}
+
+// Convert a reading to the height of the probe above the height at which it would trigger
+float ZProbe::GetScanHeightOffset(int reading) const noexcept
+{
+	const float diff = (float)(reading - adcValue);
+	return (diff * scanCoefficients[0]) + (fsquare(diff) * scanCoefficients[1]);
+}
+
 // Test whether we are at or near the stop
 bool ZProbe::Stopped() const noexcept
 {
@@ -380,7 +408,16 @@ GCodeResult ZProbe::HandleG31(GCodeBuffer& gb, const StringRef& reply) THROWS(GC
 
 GCodeResult ZProbe::Configure(GCodeBuffer& gb, const StringRef &reply, bool& seen) THROWS(GCodeException)
 {
-	gb.TryGetFValue('H', diveHeight, seen);					// dive height
+	if (gb.Seen('H'))										// dive height, optionally followed by the height to raise the probe to between taps at the same point
+	{
+		size_t numHeights = 2;
+		gb.GetFloatArray(diveHeights, numHeights, true);
+		if (diveHeights[1] <= 0.0 || diveHeights[1] > diveHeights[0])
+		{
+			diveHeights[1] = diveHeights[0];
+		}
+		seen = true;
+	}
 	if (gb.Seen('F'))										// feed rate i.e. probing speed
 	{
 		float userProbeSpeeds[2];
@@ -420,8 +457,12 @@ GCodeResult ZProbe::Configure(GCodeBuffer& gb, const StringRef &reply, bool& see
 
 	reply.printf("Z Probe %u: type %u", number, (unsigned int)type);
 	const GCodeResult rslt = AppendPinNames(reply);
-	reply.catf(", dive height %.1fmm, probe speeds %d,%dmm/min, travel speed %dmm/min, recovery time %.2f sec, heaters %s, max taps %u, max diff %.2f",
-					(double)diveHeight,
+	reply.catf(", dive height %.1fmm", (double)diveHeights[0]);
+	if (HasShortRetap())
+	{
+		reply.catf(" (%.1fmm between taps)", (double)diveHeights[1]);
+	}
+	reply.catf(", probe speeds %d,%dmm/min, travel speed %dmm/min, recovery time %.2f sec, heaters %s, max taps %u, max diff %.2f",
 					(int)InverseConvertSpeedToMmPerMin(probeSpeeds[0]),
 					(int)InverseConvertSpeedToMmPerMin(probeSpeeds[1]),
 					(int)InverseConvertSpeedToMmPerMin(travelSpeed),
@@ -431,6 +472,51 @@ GCodeResult ZProbe::Configure(GCodeBuffer& gb, const StringRef &reply, bool& see
 	return rslt;
 }
 
+// Set or report the parameters used when scanning the bed with this probe. Called by M558.1.
+GCodeResult ZProbe::HandleM558Point1(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
+{
+	bool seen = false;
+	if (gb.Seen('S'))
+	{
+		float coefficients[2] = { 0.0, 0.0 };
+		size_t numCoefficients = ARRAY_SIZE(coefficients);
+		gb.GetFloatArray(coefficients, numCoefficients, false);
+		scanCoefficients[0] = coefficients[0];
+		scanCoefficients[1] = (numCoefficients > 1) ? coefficients[1] : 0.0;
+		seen = true;
+	}
+
+	if (gb.Seen('F'))
+	{
+		scanSpeed = gb.GetSpeedFromMm(false);
+		seen = true;
+	}
+
+	if (seen)
+	{
+		if (gb.LatestMachineState().runningM501)
+		{
+			misc.parts.saveToConfigOverride = true;
+		}
+		return GCodeResult::ok;
+	}
+
+	if (scanCoefficients[0] == 0.0)
+	{
+		reply.printf("Z probe %u is not calibrated for scanning", number);
+	}
+	else
+	{
+		reply.printf("Z probe %u: scanning coefficients %.6f, %.8f, scan speed %dmm/min",
+						number, (double)scanCoefficients[0], (double)scanCoefficients[1], (int)InverseConvertSpeedToMmPerMin(scanSpeed));
+		if (!CanScan())
+		{
+			reply.cat(", but this probe type cannot be used to scan");
+		}
+	}
+	return GCodeResult::ok;
+}
+
 // Default implementation of SendProgram, overridden in some classes
 GCodeResult ZProbe::SendProgram(const uint32_t zProbeProgram[], size_t len, const StringRef& reply) noexcept
 {
@@ -37,8 +37,10 @@ public:
 	float GetOffset(size_t axisNumber) const noexcept { return offsets[axisNumber]; }
 	float GetConfiguredTriggerHeight() const noexcept { return -offsets[Z_AXIS]; }
 	float GetActualTriggerHeight() const noexcept;
-	float GetDiveHeight() const noexcept { return diveHeight; }
-	float GetStartingHeight() const noexcept { return diveHeight + GetActualTriggerHeight(); }
+	float GetDiveHeight() const noexcept { return diveHeights[0]; }
+	float GetStartingHeight() const noexcept { return diveHeights[0] + GetActualTriggerHeight(); }
+	float GetRetapHeight() const noexcept { return diveHeights[1]; }		// how far we raise the probe above the point where it stopped before tapping again at the same point
+	bool HasShortRetap() const noexcept { return diveHeights[1] < diveHeights[0]; }
 	float GetProbingSpeed(int tapsDone) const noexcept { return probeSpeeds[(tapsDone < 0) ? 0 : 1]; }
 	float HasTwoProbingSpeeds() const noexcept { return probeSpeeds[1] != probeSpeeds[0]; }
 	float GetTravelSpeed() const noexcept { return travelSpeed; }
@@ -52,9 +54,13 @@ public:
 	int GetReading() const noexcept;
 	int GetSecondaryValues(int& v1) const noexcept;
 	bool IsDeployedByUser() const noexcept { return isDeployedByUser; }
+	bool CanScan() const noexcept;
+	float GetScanSpeed() const noexcept { return scanSpeed; }
+	float GetScanHeightOffset(int reading) const noexcept;
 
 	void SetProbingAway(const bool probingAway) noexcept { misc.parts.probingAway = probingAway; }
 	GCodeResult HandleG31(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);
+	GCodeResult HandleM558Point1(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);
 	void SetTriggerHeight(float height) noexcept { offsets[Z_AXIS] = -height; }
 	void SetSaveToConfigOverride() noexcept { misc.parts.saveToConfigOverride = true; }
 	void SetDeployedByUser(bool b) noexcept { isDeployedByUser = b; }
@@ -72,6 +78,7 @@ protected:
 	OBJECT_MODEL_ARRAY(value)
 	OBJECT_MODEL_ARRAY(temperatureCoefficients)
 	OBJECT_MODEL_ARRAY(speeds)
+	OBJECT_MODEL_ARRAY(diveHeights)
 
 	uint8_t number;
 	ZProbeType type;
@@ -91,12 +98,14 @@ protected:
 	float offsets[MaxAxes];				// the offset of the probe relative to the print head. The Z offset is the negation of the trigger height.
 	float calibTemperature;				// the temperature at which we did the calibration
 	float temperatureCoefficients[2];	// the variation of height with bed temperature and with the square of temperature
-	float diveHeight;					// the dive height we use when probing
+	float diveHeights[2];				// the dive height we use when probing, and the height above the stopped position that we raise the probe to between taps
 	float probeSpeeds[2];				// the initial speed of probing in mm per step clock
 	float travelSpeed;					// the speed at which we travel to the probe point ni mm per step clock
 	float recoveryTime;					// Z probe recovery time
 	float tolerance;					// maximum difference between probe heights when doing >1 taps
 	float lastStopHeight;				// the height at which the last G30 probe move stopped
+	float scanCoefficients[2];			// the linear and quadratic coefficients that convert the difference between the reading and the threshold to a height
+	float scanSpeed;					// the speed at which we move when scanning the bed in mm per step clock
 
 	bool isDeployedByUser;				// true if the user has used the M401 command to deploy this probe and not sent M402 to retract it
 };
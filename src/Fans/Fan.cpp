@@ -50,7 +50,8 @@ Fan::Fan(unsigned int fanNum) noexcept
 	  val(0.0),
 	  minVal(DefaultMinFanPwm),
 	  maxVal(1.0),										// 100% maximum fan speed
-	  blipTime(DefaultFanBlipTime)
+	  blipTime(DefaultFanBlipTime),
+	  maxRpm(0.0)
 {
 	triggerTemperatures[0] = triggerTemperatures[1] = DefaultHotEndFanTemperature;
 }
@@ -138,6 +139,21 @@ bool Fan::Configure(unsigned int mcode, size_t fanNum, GCodeBuffer& gb, const St
 			gb.GetQuotedString(name.GetRef());
 		}
 
+		if (gb.Seen('Q'))		// Set the RPM at full speed for closed-loop control, or Q0 for open loop
+		{
+			seen = true;
+			const float newMaxRpm = max<float>(gb.GetFValue(), 0.0);
+			if (newMaxRpm != 0.0 && !CanControlRpm())
+			{
+				reply.printf("Fan %u has no tacho, so its RPM can't be controlled", fanNum);
+				error = true;
+			}
+			else
+			{
+				maxRpm = newMaxRpm;
+			}
+		}
+
 		if (seen)
 		{
 			// We only act on the 'S' parameter here if we have processed other parameters
@@ -169,6 +185,10 @@ bool Fan::Configure(unsigned int mcode, size_t fanNum, GCodeBuffer& gb, const St
 						(int)(maxVal * 100.0),
 						(double)(blipTime * MillisToSeconds)
 					  );
+			if (maxRpm > 0.0)
+			{
+				reply.catf(", RPM controlled, %.0fRPM at full speed", (double)maxRpm);
+			}
 			if (sensorsMonitored.IsNonEmpty())
 			{
 				reply.catf(", temperature: %.1f:%.1fC, sensors:", (double)triggerTemperatures[0], (double)triggerTemperatures[1]);
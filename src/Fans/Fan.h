@@ -32,6 +32,8 @@ public:
 	virtual float GetPwm() const noexcept = 0;
 	virtual PwmFrequency GetPwmFrequency() const noexcept = 0;
 	virtual GCodeResult ReportPortDetails(const StringRef& str) const noexcept = 0;
+	virtual bool CanControlRpm() const noexcept { return false; }			// return true if this fan can be run at a target RPM
+	virtual void UpdateRpm(uint32_t intervalMillis) noexcept { }			// called by the heater task to update the RPM reading and run the RPM controller
 #if SUPPORT_CAN_EXPANSION
 	virtual void UpdateFromRemote(CanAddress src, const FanReport& report) noexcept = 0;
 #endif
@@ -78,6 +80,7 @@ protected:
 	float maxVal;
 	float triggerTemperatures[2];
 	uint32_t blipTime;										// how long we blip the fan for, in milliseconds
+	float maxRpm;											// if nonzero, the RPM at full speed, and the fan is run at the requested fraction of it using the tacho
 	SensorsBitmap sensorsMonitored;
 
 	String<MaxFanNameLength> name;
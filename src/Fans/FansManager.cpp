@@ -69,6 +69,19 @@ bool FansManager::CheckFans(bool checkSensors) noexcept
 	return thermostaticFanRunning;
 }
 
+// Update the fan RPM readings and RPM control. Called by the heater task, so that the control loop runs at a steady rate even if the main loop is held up.
+void FansManager::UpdateFanRpms(uint32_t intervalMillis) noexcept
+{
+	ReadLocker lock(fansLock);
+	for (Fan* fan : fans)
+	{
+		if (fan != nullptr)
+		{
+			fan->UpdateRpm(intervalMillis);
+		}
+	}
+}
+
 // Return the number of fans to report on. Used by RepRap.cpp to shorten responses by omitting unused trailing fan numbers.
 size_t FansManager::GetNumFansToReport() const noexcept
 {
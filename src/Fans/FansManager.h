@@ -29,6 +29,7 @@ public:
 	void Init() noexcept;
 	void Exit() noexcept;
 	bool CheckFans(bool checkSensors) noexcept;
+	void UpdateFanRpms(uint32_t intervalMillis) noexcept;
 	GCodeResult ConfigureFanPort(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);
 	bool ConfigureFan(unsigned int mcode, size_t fanNum, GCodeBuffer& gb, const StringRef& reply, bool& error) THROWS(GCodeException);
 	float GetFanValue(size_t fanNum) const noexcept;
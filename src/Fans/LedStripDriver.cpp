@@ -54,6 +54,8 @@ namespace LedStripDriver
 	constexpr uint32_t DefaultDotStarSpiClockFrequency = 1000000;		// 1MHz default
 	constexpr uint32_t DefaultNeoPixelSpiClockFrequency = 2500000;		// must be between about 2MHz and about 4MHz
 	constexpr uint32_t MinNeoPixelResetTicks = (250 * StepClockRate)/1000000;	// 250us minimum Neopixel reset time on later chips
+	constexpr uint32_t MinThreeBitNeoPixelFrequency = 2200000;			// between these frequencies we can meet the NeoPixel timing using 3 SPI bits per NeoPixel bit
+	constexpr uint32_t MaxThreeBitNeoPixelFrequency = 3000000;
 
 	// Define the size of the buffer used to accumulate a sequence of colours to send to the string
 #if defined(DUET3_MB6HC) || defined(DUET3_MB6XD)
@@ -121,6 +123,7 @@ namespace LedStripDriver
 	static bool needStartFrame;											// true if we need to send a start frame with the next command
 	static bool busy;													// true if DMA was started and is not known to have finished
 	static bool needInit;
+	static bool threeBitEncoding = false;								// true if we send NeoPixel data using 3 SPI bits per bit instead of 4 (DMA NeoPixel only)
 
 #if SAME70
 	alignas(4) static __nocache uint8_t chunkBuffer[ChunkBufferSize];	// buffer for sending data to LEDs
@@ -137,14 +140,14 @@ namespace LedStripDriver
 			return ChunkBufferSize/4;
 
 		case LedType::neopixelRGBW:
-			return ChunkBufferSize/16;
+			return ChunkBufferSize/((threeBitEncoding) ? 12 : 16);
 
 		case LedType::neopixelRGBBitBang:
 			return ChunkBufferSize/3;
 
 		case LedType::neopixelRGB:
 		default:
-			return ChunkBufferSize/12;
+			return ChunkBufferSize/((threeBitEncoding) ? 9 : 12);
 		}
 	}
 
@@ -228,6 +231,16 @@ namespace LedStripDriver
 	// Setup the SPI peripheral. Only call this when the busy flag is not set.
 	static void SetupSpi() noexcept
 	{
+# if SUPPORT_DMA_NEOPIXEL
+		// Use the more compact NeoPixel encoding if the frequency allows it, so that longer strips fit in the buffer
+		const bool newThreeBitEncoding = currentFrequency >= MinThreeBitNeoPixelFrequency && currentFrequency <= MaxThreeBitNeoPixelFrequency;
+		if (newThreeBitEncoding != threeBitEncoding)
+		{
+			threeBitEncoding = newThreeBitEncoding;
+			numAlreadyInBuffer = 0;												// any data already in the buffer used the other encoding
+		}
+# endif
+
 # if LEDSTRIP_USES_USART
 		// Set the USART in SPI mode, with the clock high when inactive, data changing on the falling edge of the clock
 		DotStarUsart->US_IDR = ~0u;
@@ -350,31 +363,76 @@ namespace LedStripDriver
 		}
 	}
 
+	// Encode one NeoPixel byte into the buffer using 3 SPI bits per NeoPixel bit, so that it occupies 3 bytes starting at byte 'index' of the data.
+	// A 0 bit is encoded as 100
+	// A 1 bit is encoded as 110
+	// All encoding is MSB first
+	static void EncodeNeoPixelByteThreeBit(size_t index, uint8_t val) noexcept
+	{
+		static constexpr uint16_t EncodedNibble[16] =
+		{
+			0x924, 0x926, 0x934, 0x936, 0x9A4, 0x9A6, 0x9B4, 0x9B6, 0xD24, 0xD26, 0xD34, 0xD36, 0xDA4, 0xDA6, 0xDB4, 0xDB6
+		};
+
+# if USE_16BIT_SPI
+		constexpr size_t swap = 1;										// swap bytes for 16-bit DMA
+# else
+		constexpr size_t swap = 0;
+# endif
+		const uint32_t encoded = ((uint32_t)EncodedNibble[val >> 4] << 12) | EncodedNibble[val & 0x0F];
+		chunkBuffer[index ^ swap] = (uint8_t)(encoded >> 16);
+		chunkBuffer[(index + 1) ^ swap] = (uint8_t)(encoded >> 8);
+		chunkBuffer[(index + 2) ^ swap] = (uint8_t)encoded;
+	}
+
 	// Send data to NeoPixel LEDs by DMA to SPI
 	static GCodeResult SpiSendNeoPixelData(uint8_t red, uint8_t green, uint8_t blue, uint8_t white, uint32_t numLeds, bool includeWhite, bool following) noexcept
 	{
-		const unsigned int bytesPerLed = (includeWhite) ? 16 : 12;
-		uint8_t *p = chunkBuffer + (bytesPerLed * numAlreadyInBuffer);
-		while (numLeds != 0 && p + bytesPerLed <= chunkBuffer + ARRAY_SIZE(chunkBuffer))
+		const unsigned int bytesPerColour = (threeBitEncoding) ? 3 : 4;
+		const unsigned int bytesPerLed = ((includeWhite) ? 4 : 3) * bytesPerColour;
+		size_t index = bytesPerLed * numAlreadyInBuffer;
+		while (numLeds != 0 && index + bytesPerLed <= ARRAY_SIZE(chunkBuffer))
 		{
-			EncodeNeoPixelByte(p, green);
-			p += 4;
-			EncodeNeoPixelByte(p, red);
-			p += 4;
-			EncodeNeoPixelByte(p, blue);
-			p += 4;
-			if (includeWhite)
+			if (threeBitEncoding)
 			{
-				EncodeNeoPixelByte(p, white);
+				EncodeNeoPixelByteThreeBit(index, green);
+				EncodeNeoPixelByteThreeBit(index + 3, red);
+				EncodeNeoPixelByteThreeBit(index + 6, blue);
+				if (includeWhite)
+				{
+					EncodeNeoPixelByteThreeBit(index + 9, white);
+				}
+			}
+			else
+			{
+				uint8_t *p = chunkBuffer + index;
+				EncodeNeoPixelByte(p, green);
 				p += 4;
+				EncodeNeoPixelByte(p, red);
+				p += 4;
+				EncodeNeoPixelByte(p, blue);
+				if (includeWhite)
+				{
+					p += 4;
+					EncodeNeoPixelByte(p, white);
+				}
 			}
+			index += bytesPerLed;
 			--numLeds;
 			++numAlreadyInBuffer;
 		}
 
 		if (!following)
 		{
-			DmaSendChunkBuffer(bytesPerLed * numAlreadyInBuffer);		// send data by DMA to SPI
+			size_t numBytes = bytesPerLed * numAlreadyInBuffer;
+# if USE_16BIT_SPI
+			if (numBytes & 1)
+			{
+				chunkBuffer[numBytes ^ 1] = 0;							// pad to a whole number of 16-bit words, which leaves the data line low
+				++numBytes;
+			}
+# endif
+			DmaSendChunkBuffer(numBytes);								// send data by DMA to SPI
 			numAlreadyInBuffer = 0;
 			needStartFrame = true;
 		}
@@ -619,6 +677,12 @@ GCodeResult LedStripDriver::SetColours(GCodeBuffer& gb, const StringRef& reply)
 		{
 			// Report the current configuration
 			reply.printf("Led type is %s, frequency %.2fMHz", LedTypeNames[(unsigned int)ledType], (double)((float)currentFrequency * 0.000001));
+#if SUPPORT_DMA_NEOPIXEL
+			if (ledType == LedType::neopixelRGB || ledType == LedType::neopixelRGBW)
+			{
+				reply.catf(", %u SPI bits per bit, up to %u LEDs", (threeBitEncoding) ? 3 : 4, MaxLedsPerBuffer());
+			}
+#endif
 		}
 		return GCodeResult::ok;
 	}
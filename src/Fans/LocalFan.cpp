@@ -23,7 +23,7 @@ LocalFan::LocalFan(unsigned int fanNum) noexcept
 	: Fan(fanNum),
 	  lastPwm(-1.0),									// force a refresh
 	  lastVal(-1.0),
-	  fanInterruptCount(0), fanLastResetTime(0), fanInterval(0),
+	  numTachoEdges(0), rpm(0), rpmCorrection(0.0),
 	  blipping(false)
 {
 }
@@ -145,7 +145,18 @@ void LocalFan::InternalRefresh(bool checkSensors) noexcept
 	}
 
 	lastVal = reqVal;
-	SetHardwarePwm((blipping) ? 1.0 : reqVal);
+	if (blipping)
+	{
+		SetHardwarePwm(1.0);
+	}
+	else if (maxRpm > 0.0 && reqVal > 0.0)
+	{
+		SetHardwarePwm(constrain<float>(reqVal + rpmCorrection, 0.0, 1.0));	// the heater task adjusts the correction to get the requested RPM
+	}
+	else
+	{
+		SetHardwarePwm(reqVal);
+	}
 }
 
 GCodeResult LocalFan::Refresh(const StringRef& reply) noexcept
@@ -194,26 +205,75 @@ bool LocalFan::AssignPorts(const char *pinNames, const StringRef& reply) noexcep
 // Tacho support
 int32_t LocalFan::GetRPM() const noexcept
 {
-	// The ISR sets fanInterval to the number of step interrupt clocks it took to get fanMaxInterruptCount interrupts.
-	// We get 2 tacho pulses per revolution, hence 2 interrupts per revolution.
-	// When the fan stops, we get no interrupts and fanInterval stops getting updated. We must recognise this and return zero.
-	return (!tachoPort.IsValid())
-			? -1																			// we return -1 if there is no tacho configured
-			: (fanInterval != 0 && StepTimer::GetTimerTicks() - fanLastResetTime < 3 * StepClockRate)	// if we have a reading and it is less than 3 seconds old
-			  ? (StepClockRate * fanMaxInterruptCount * (60/2))/fanInterval					// then calculate RPM assuming 2 interrupts per rev
-			  : 0;																			// else assume fan is off or tacho not connected
+	return (tachoPort.IsValid()) ? rpm : -1;						// we return -1 if there is no tacho configured
 }
 
-void LocalFan::Interrupt() noexcept
+// Calculate the RPM from the times of the recent tacho edges. We get 2 tacho pulses per revolution, hence 2 interrupts per revolution.
+// We average over the edges in the last FanRpmWindowMillis, so fast fans give a steady reading and slow ones still respond quickly to changes.
+int32_t LocalFan::CalcRpm() const noexcept
 {
-	++fanInterruptCount;
-	if (fanInterruptCount == fanMaxInterruptCount)
+	uint32_t edgeTimes[FanTachoEdgeBufferSize];
+	uint32_t edgeCount;
 	{
-		const uint32_t now = StepTimer::GetTimerTicks();
-		fanInterval = now - fanLastResetTime;
-		fanLastResetTime = now;
-		fanInterruptCount = 0;
+		AtomicCriticalSectionLocker lock;
+		edgeCount = numTachoEdges;
+		for (size_t i = 0; i < FanTachoEdgeBufferSize; ++i)
+		{
+			edgeTimes[i] = tachoEdgeTimes[i];
+		}
+	}
+
+	const uint32_t now = StepTimer::GetTimerTicks();
+	const uint32_t edgesKept = min<uint32_t>(edgeCount, FanTachoEdgeBufferSize);
+	const uint32_t newest = edgeTimes[(edgeCount - 1) & (FanTachoEdgeBufferSize - 1)];
+	if (edgesKept < 2 || now - newest >= FanTachoTimeoutMillis * (StepClockRate/1000))
+	{
+		return 0;													// the fan is off or the tacho is not connected
 	}
+
+	// Use the oldest edge in the window, but at least one interval
+	constexpr uint32_t WindowTicks = FanRpmWindowMillis * (StepClockRate/1000);
+	uint32_t intervals = 1;
+	while (intervals + 1 < edgesKept && newest - edgeTimes[(edgeCount - 2 - intervals) & (FanTachoEdgeBufferSize - 1)] <= WindowTicks)
+	{
+		++intervals;
+	}
+	uint32_t span = newest - edgeTimes[(edgeCount - 1 - intervals) & (FanTachoEdgeBufferSize - 1)];
+
+	// If the fan is slowing down or has stopped, the time since the last edge may be longer than the average interval. In that case it gives a better estimate.
+	const uint32_t sinceNewest = now - newest;
+	if ((uint64_t)sinceNewest * intervals > span)
+	{
+		span = sinceNewest * intervals;
+	}
+	return (int32_t)(((uint64_t)StepClockRate * intervals * (60/2))/span);
+}
+
+// Update the RPM reading, and if we are controlling the RPM then update the PWM correction. Called by the heater task.
+void LocalFan::UpdateRpm(uint32_t intervalMillis) noexcept
+{
+	if (tachoPort.IsValid())
+	{
+		const int32_t newRpm = CalcRpm();
+		rpm = newRpm;
+		if (maxRpm > 0.0 && lastVal > 0.0 && !blipping)
+		{
+			// Integral control with the requested PWM as the feedforward term. The correction is limited so that it doesn't wind up when the fan can't reach the requested speed.
+			const float speedError = (lastVal * maxRpm - (float)newRpm)/maxRpm;
+			rpmCorrection = constrain<float>(rpmCorrection + FanRpmControlGain * speedError * (float)intervalMillis * MillisToSeconds, -lastVal, 1.0 - lastVal);
+		}
+		else if (lastVal <= 0.0)
+		{
+			rpmCorrection = 0.0;									// start again from the feedforward value next time the fan is turned on
+		}
+	}
+}
+
+void LocalFan::Interrupt() noexcept
+{
+	const uint32_t count = numTachoEdges;
+	tachoEdgeTimes[count & (FanTachoEdgeBufferSize - 1)] = StepTimer::GetTimerTicks();
+	numTachoEdges = count + 1;
 }
 
 // End
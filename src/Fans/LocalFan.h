@@ -19,6 +19,8 @@ public:
 	bool Check(bool checkSensors) noexcept override;						// update the fan PWM returning true if it is a thermostatic fan that is on
 	bool IsEnabled() const noexcept override { return port.IsValid(); }
 	int32_t GetRPM() const noexcept override;
+	bool CanControlRpm() const noexcept override { return tachoPort.IsValid(); }
+	void UpdateRpm(uint32_t intervalMillis) noexcept override;
 	float GetPwm() const noexcept override { return lastVal; }
 	PwmFrequency GetPwmFrequency() const noexcept override { return port.GetFrequency(); }
 	GCodeResult SetPwmFrequency(PwmFrequency freq, const StringRef& reply) noexcept override;
@@ -42,6 +44,7 @@ protected:
 private:
 	void SetHardwarePwm(float pwmVal) noexcept;
 	void InternalRefresh(bool checkSensors) noexcept;
+	int32_t CalcRpm() const noexcept;
 
 	PwmPort port;											// port used to control the fan
 	IoPort tachoPort;										// port used to read the tacho
@@ -49,11 +52,12 @@ private:
 	float lastPwm;											// the last PWM value we wrote to the hardware
 	float lastVal;											// the last PWM value we sent to the fan, not allowing for blipping, or -1 if we don't know it
 
-	// Variables used to read the tacho
-	static constexpr uint32_t fanMaxInterruptCount = 16;	// number of fan interrupts that we average over. We time out after 3 seconds, so a count of 16 allows us to read rpm down to (16/3) * (60/2) = 160.
-	uint32_t fanInterruptCount;								// accessed only in ISR, so no need to declare it volatile
-	volatile uint32_t fanLastResetTime;						// time (in step clocks) at which we last reset the interrupt count, accessed inside and outside ISR
-	volatile uint32_t fanInterval;							// written by ISR, read outside the ISR
+	// Variables used to read the tacho. The ISR records the step clock time of each tacho edge and the heater task works out the RPM from them.
+	static_assert((FanTachoEdgeBufferSize & (FanTachoEdgeBufferSize - 1)) == 0, "FanTachoEdgeBufferSize must be a power of 2");
+	volatile uint32_t tachoEdgeTimes[FanTachoEdgeBufferSize];	// written by ISR, read outside the ISR
+	volatile uint32_t numTachoEdges;						// the total number of edges recorded, written by ISR, read outside the ISR
+	volatile int32_t rpm;									// the latest RPM reading, written by the heater task
+	volatile float rpmCorrection;							// the amount that the RPM controller adds to the requested PWM, written by the heater task
 
 	uint32_t blipStartTime;
 	bool blipping;
@@ -131,9 +131,53 @@ bool FilamentMonitor::IsValid(size_t extruderNumber) const noexcept
 }
 
 // Static initialisation
+#if FILAMENT_MONITORS_AS_SEPARATE_TASK
+
+# include <Platform/TaskPriorities.h>
+
+constexpr size_t FilamentMonitorTaskStackWords = 400;		// task stack size in dwords, must be enough for a local CAN buffer and debug messages
+static Task<FilamentMonitorTaskStackWords> filamentMonitorTask;
+
+uint32_t FilamentMonitor::maxCheckLateness = 0;
+
+extern "C" [[noreturn]] void FilamentMonitorTaskStart(void *) noexcept
+{
+	FilamentMonitor::TaskLoop();
+}
+
+// Check the filament monitors at a fixed rate, so that the comparison with the commanded extrusion doesn't depend on how busy the main task is
+/*static*/ [[noreturn]] void FilamentMonitor::TaskLoop() noexcept
+{
+	uint32_t nextWakeTime = millis();
+	for (;;)
+	{
+		Spin();
+
+		nextWakeTime += FilamentMonitorCheckInterval;
+		const int32_t delayTime = (int32_t)(nextWakeTime - millis());
+		if (delayTime > 0)
+		{
+			TaskBase::Take((uint32_t)delayTime);
+		}
+		else
+		{
+			// We are running late. Record by how much and start the schedule again from now, rather than trying to catch up.
+			if ((uint32_t)(-delayTime) > maxCheckLateness)
+			{
+				maxCheckLateness = (uint32_t)(-delayTime);
+			}
+			nextWakeTime = millis();
+		}
+	}
+}
+
+#endif
+
 /*static*/ void FilamentMonitor::InitStatic() noexcept
 {
-	// Nothing needed here yet
+#if FILAMENT_MONITORS_AS_SEPARATE_TASK
+	filamentMonitorTask.Create(FilamentMonitorTaskStart, "FMON", nullptr, TaskPriority::FilamentMonitorPriority);
+#endif
 }
 
 // Handle M591
@@ -390,6 +434,9 @@ bool FilamentMonitor::IsValid(size_t extruderNumber) const noexcept
 /*static*/ void FilamentMonitor::Exit() noexcept
 {
 	WriteLocker lock(filamentMonitorsLock);
+#if FILAMENT_MONITORS_AS_SEPARATE_TASK
+	filamentMonitorTask.Suspend();
+#endif
 
 	for (FilamentMonitor *&f : filamentSensors)
 	{
@@ -413,6 +460,13 @@ bool FilamentMonitor::IsValid(size_t extruderNumber) const noexcept
 			filamentSensors[i]->Diagnostics(mtype, i);
 		}
 	}
+#if FILAMENT_MONITORS_AS_SEPARATE_TASK
+	if (!first)
+	{
+		reprap.GetPlatform().MessageF(mtype, "Max check lateness %" PRIu32 "ms\n", maxCheckLateness);
+		maxCheckLateness = 0;
+	}
+#endif
 }
 
 // Check whether the drivers that filament monitor are attached to are still valid. If any are invalid, delete them, append a warning to 'reply', and return true.
@@ -69,9 +69,13 @@ public:
 	// Static initialisation
 	static void InitStatic() noexcept;
 
-	// Poll the filament sensors
+	// Poll the filament sensors. If FILAMENT_MONITORS_AS_SEPARATE_TASK is set then this is called by the filament monitor task, otherwise by the main loop.
 	static void Spin() noexcept;
 
+#if FILAMENT_MONITORS_AS_SEPARATE_TASK
+	[[noreturn]] static void TaskLoop() noexcept;
+#endif
+
 	// Check the drive assignments. Called when M584 may have been used to remap extruder drives. Return true if we need to output the warning appended to 'reply'.
 	static bool CheckDriveAssignments(const StringRef& reply) noexcept;
 
@@ -153,6 +157,10 @@ private:
 	static uint32_t whenStatusLastSent;
 #endif
 
+#if FILAMENT_MONITORS_AS_SEPARATE_TASK
+	static uint32_t maxCheckLateness;									// the longest time in milliseconds that a check was later than scheduled
+#endif
+
 	int32_t isrExtruderStepsCommanded;
 	uint32_t lastIsrMillis;
 	unsigned int driveNumber;
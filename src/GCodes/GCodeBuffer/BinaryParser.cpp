@@ -7,7 +7,7 @@
 
 #include "BinaryParser.h"
 
-#if HAS_SBC_INTERFACE
+#if HAS_BINARY_PARSER
 
 #include "GCodeBuffer.h"
 #include "ExpressionParser.h"
@@ -26,6 +26,7 @@ void BinaryParser::Init() noexcept
 	gb.bufferState = GCodeBufferState::parseNotStarted;
 	seenParameter = nullptr;
 	seenParameterValue = nullptr;
+	hasParameterIndex = false;
 }
 
 // Add an entire binary G-Code, overwriting any existing content
@@ -37,8 +38,72 @@ void BinaryParser::Put(const uint32_t *data, size_t len) noexcept
 	gb.bufferState = GCodeBufferState::parsingGCode;
 	gb.LatestMachineState().g53Active = (header->flags & CodeFlags::EnforceAbsolutePosition) != 0;
 	gb.CurrentFileMachineState().lineNumber = header->lineNumber;
+	IndexParameters();
 }
 
+// Index the parameters of a plain G0 or G1 command, so that Seen doesn't need to search the parameter list for each one.
+// DoStraightMove asks about many more letters than a typical move has parameters, so this saves a lot of time when printing from the SBC.
+// We only do this if every parameter has an upper case letter that appears once and a numeric value, so that no value data follows the parameter list.
+// Otherwise we leave hasParameterIndex false and the parameters are found in the normal way.
+// This is called from Put, so it must be fast.
+void BinaryParser::IndexParameters() noexcept
+{
+	hasParameterIndex = false;
+	if (   bufferLength < sizeof(CodeHeader)
+		|| header->letter != 'G'
+		|| (header->flags & (CodeFlags::HasMajorCommandNumber | CodeFlags::HasMinorCommandNumber)) != CodeFlags::HasMajorCommandNumber
+		|| header->majorCode > 1
+		|| header->numParameters > MaxIndexedParameters
+	   )
+	{
+		return;
+	}
+
+	const CodeParameter *const params = reinterpret_cast<const CodeParameter*>(reinterpret_cast<const char*>(gb.buffer) + sizeof(CodeHeader));
+	Bitmap<uint32_t> lettersFound;
+	uint8_t positions[26];
+	for (size_t i = 0; i < header->numParameters; ++i)
+	{
+		const char letter = params[i].letter;
+		const DataType type = params[i].type;
+		if (   letter < 'A' || letter > 'Z' || lettersFound.IsBitSet(letter - 'A')
+			|| (type != DataType::Float && type != DataType::Int && type != DataType::UInt)
+		   )
+		{
+			return;
+		}
+		lettersFound.SetBit(letter - 'A');
+		positions[letter - 'A'] = (uint8_t)i;
+	}
+
+	lettersFound.Iterate([this, &positions](unsigned int letterIndex, unsigned int slot) noexcept
+							{
+								parameterIndex[slot] = positions[letterIndex];
+							}
+						);
+	parametersPresent = lettersFound;
+	hasParameterIndex = true;
+}
+
+#if SUPPORT_BINARY_GCODE_FILES
+
+// Record the position of a code that was read from a local binary G-code file, replacing any position that the code contains
+void BinaryParser::SetFilePosition(FilePosition pos) noexcept
+{
+	CodeHeader * const writableHeader = reinterpret_cast<CodeHeader *>(gb.buffer);
+	if (pos == noFilePosition)
+	{
+		writableHeader->flags = (CodeFlags)(writableHeader->flags & ~CodeFlags::HasFilePosition);
+	}
+	else
+	{
+		writableHeader->filePosition = pos;
+		writableHeader->flags = (CodeFlags)(writableHeader->flags | CodeFlags::HasFilePosition);
+	}
+}
+
+#endif
+
 void BinaryParser::DecodeCommand() noexcept
 {
 	if (gb.bufferState == GCodeBufferState::parsingGCode)
@@ -55,6 +120,21 @@ void BinaryParser::DecodeCommand() noexcept
 
 bool BinaryParser::Seen(char c) noexcept
 {
+	if (hasParameterIndex)
+	{
+		// The parameters have been indexed and none of them has value data after the parameter list, so we just need to find the slot for this one
+		seenParameterValue = nullptr;
+		if (c < 'A' || c > 'Z' || !parametersPresent.IsBitSet(c - 'A'))
+		{
+			seenParameter = nullptr;
+			return false;
+		}
+		const unsigned int slot = Bitmap<uint32_t>::MakeFromRaw(parametersPresent.GetRaw() & ((1u << (c - 'A')) - 1)).CountSetBits();
+		seenParameter = reinterpret_cast<const CodeParameter*>(reinterpret_cast<const char*>(gb.buffer) + sizeof(CodeHeader)) + parameterIndex[slot];
+		reducedBytesRead = 0;
+		return true;
+	}
+
 	if (bufferLength != 0 && header->numParameters != 0)
 	{
 		const char *parameterStart = reinterpret_cast<const char*>(gb.buffer) + sizeof(CodeHeader);
@@ -91,6 +171,11 @@ bool BinaryParser::Seen(char c) noexcept
 // Return true if any of the parameter letters in the bitmap were seen
 bool BinaryParser::SeenAny(Bitmap<uint32_t> bm) const noexcept
 {
+	if (hasParameterIndex)
+	{
+		return (parametersPresent.GetRaw() & bm.GetRaw()) != 0;
+	}
+
 	if (bufferLength != 0 && header->numParameters != 0)
 	{
 		const char *parameterStart = reinterpret_cast<const char*>(gb.buffer) + sizeof(CodeHeader);
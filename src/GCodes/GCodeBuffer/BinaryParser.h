@@ -10,7 +10,7 @@
 
 #include <RepRapFirmware.h>
 
-#if HAS_SBC_INTERFACE
+#if HAS_BINARY_PARSER
 
 #include <SBC/SbcMessageFormats.h>
 #include <GCodes/GCodeException.h>
@@ -26,6 +26,9 @@ public:
 	BinaryParser(GCodeBuffer& gcodeBuffer) noexcept;
 	void Init() noexcept; 														// Set it up to parse another G-code
 	void Put(const uint32_t *data, size_t len) noexcept;						// Add an entire binary code, overwriting any existing content
+#if SUPPORT_BINARY_GCODE_FILES
+	void SetFilePosition(FilePosition pos) noexcept;							// Record the position in the file of a code read from a local file
+#endif
 	void DecodeCommand() noexcept;												// Print the buffer content in debug mode and prepare for execution
 	bool Seen(char c) noexcept SPEED_CRITICAL;									// Is a character present?
 	bool SeenAny(Bitmap<uint32_t> bm) const noexcept;							// Return true if any of the parameter letters in the bitmap were seen
@@ -75,6 +78,7 @@ private:
 	size_t AddPadding(size_t bytesRead) const noexcept { return (bytesRead + 3u) & (~3u); }
 	template<typename T> void GetArray(T arr[], size_t& length) THROWS(GCodeException) SPEED_CRITICAL;
 	void WriteParameters(const StringRef& s, bool quoteStrings) const noexcept;
+	void IndexParameters() noexcept;
 
 	size_t bufferLength;
 	const CodeHeader *header;
@@ -82,6 +86,11 @@ private:
 	int reducedBytesRead;
 	const CodeParameter *seenParameter;
 	const char *seenParameterValue;
+
+	static constexpr size_t MaxIndexedParameters = 12;		// the maximum number of parameters in a G0 or G1 command that we index
+	Bitmap<uint32_t> parametersPresent;						// which parameters are present in an indexed command
+	uint8_t parameterIndex[MaxIndexedParameters];			// the position in the code of each indexed parameter, in alphabetical order of letter
+	bool hasParameterIndex;									// true if the parameters of the current command have been indexed
 };
 
 // Get the complete parameter string. Used by the Q0 command to process comments.
@@ -0,0 +1,151 @@
+/*
+ * ExpressionCache.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "ExpressionCache.h"
+#include <Platform/RepRap.h>
+#include <Platform/Platform.h>
+
+void CompiledExpression::Init(FilePosition p_filePosition, uint32_t p_textHash, uint16_t p_textLength) noexcept
+{
+	filePosition = p_filePosition;
+	textHash = p_textHash;
+	textLength = p_textLength;
+	endOffset = 0;
+	numOperations = 0;
+	stackDepth = 0;
+	valid = true;
+}
+
+// Add an operation and return a pointer to it, or nullptr if the expression is too complex to record
+CompiledExpression::Operation *CompiledExpression::AddOperation(OpCode op, uint8_t arg, uint16_t textOffset) noexcept
+{
+	if (!valid)
+	{
+		return nullptr;
+	}
+
+	switch (op)
+	{
+	case OpCode::pushInt:
+	case OpCode::pushFloat:
+	case OpCode::pushIdentifier:
+	case OpCode::pushString:
+		++stackDepth;
+		if (stackDepth > MaxStackDepth)
+		{
+			valid = false;
+			return nullptr;
+		}
+		break;
+
+	case OpCode::binary:
+	case OpCode::andJump:
+	case OpCode::orJump:
+	case OpCode::condJump:
+	case OpCode::jump:
+		// For andJump and orJump the operand is either retained or replaced by the second operand.
+		// For condJump and jump, only one of the two following operands is evaluated.
+		--stackDepth;
+		break;
+
+	default:
+		break;
+	}
+
+	if (numOperations == MaxOperations)
+	{
+		valid = false;
+		return nullptr;
+	}
+
+	Operation& rslt = operations[numOperations++];
+	rslt.opCode = op;
+	rslt.arg = arg;
+	rslt.textOffset = textOffset;
+	rslt.iVal = 0;
+	return &rslt;
+}
+
+namespace ExpressionCache
+{
+	static CompiledExpression entries[ExpressionCacheEntries];
+	static CompiledExpression recorder;
+	static size_t numEntriesUsed = 0;
+	static uint32_t useCounter = 0;
+	static unsigned int numHits = 0, numMisses = 0, numUncacheable = 0;
+
+	// Return the FNV-1a hash of some text
+	uint32_t HashText(const char *text, size_t length) noexcept
+	{
+		uint32_t hash = 2166136261u;
+		while (length != 0)
+		{
+			hash = (hash ^ (uint8_t)*text++) * 16777619u;
+			--length;
+		}
+		return hash;
+	}
+
+	const CompiledExpression *Find(FilePosition filePosition, uint32_t textHash, uint16_t textLength) noexcept
+	{
+		for (size_t i = 0; i < numEntriesUsed; ++i)
+		{
+			if (entries[i].Matches(filePosition, textHash, textLength))
+			{
+				entries[i].whenLastUsed = ++useCounter;
+				++numHits;
+				return &entries[i];
+			}
+		}
+		++numMisses;
+		return nullptr;
+	}
+
+	// Return the object to record an expression into. Expressions are only evaluated by the Main task, so a single one is sufficient.
+	CompiledExpression& GetRecorder() noexcept
+	{
+		return recorder;
+	}
+
+	// Store a recorded expression in the cache, replacing the least recently used entry if the cache is full
+	void Store(const CompiledExpression& recorded) noexcept
+	{
+		if (!recorded.IsValid())
+		{
+			++numUncacheable;
+			return;
+		}
+
+		size_t slot;
+		if (numEntriesUsed < ExpressionCacheEntries)
+		{
+			slot = numEntriesUsed++;
+		}
+		else
+		{
+			slot = 0;
+			for (size_t i = 1; i < ExpressionCacheEntries; ++i)
+			{
+				if (entries[i].whenLastUsed < entries[slot].whenLastUsed)
+				{
+					slot = i;
+				}
+			}
+		}
+		entries[slot] = recorded;
+		entries[slot].whenLastUsed = ++useCounter;
+	}
+
+	void Diagnostics(MessageType mtype) noexcept
+	{
+		reprap.GetPlatform().MessageF(mtype, "Expression cache: %u/%u entries used, hits %u, misses %u, uncacheable %u\n",
+										(unsigned int)numEntriesUsed, (unsigned int)ExpressionCacheEntries, numHits, numMisses, numUncacheable);
+		numHits = numMisses = numUncacheable = 0;
+	}
+}
+
+// End
@@ -0,0 +1,96 @@
+/*
+ * ExpressionCache.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  When ExpressionParser evaluates the expression in an if, elif, while, var or set command that was read from a file, it records the structure of
+ *  the expression as a short sequence of operations in postfix order. The sequence is cached, keyed by the file position of the expression and a hash
+ *  of its text. When the same command is executed again, for example on the next iteration of a while-loop, the parser evaluates the cached operations
+ *  instead of parsing the operators, brackets and numeric literals again.
+ *  Identifiers and quoted strings are still evaluated from the text of the command, at the offsets recorded in the operations.
+ */
+
+#ifndef SRC_GCODES_GCODEBUFFER_EXPRESSIONCACHE_H_
+#define SRC_GCODES_GCODEBUFFER_EXPRESSIONCACHE_H_
+
+#include <RepRapFirmware.h>
+
+class CompiledExpression
+{
+public:
+	static constexpr size_t MaxOperations = 24;
+	static constexpr size_t MaxStackDepth = 8;
+
+	enum class OpCode : uint8_t
+	{
+		pushInt,					// push iVal
+		pushFloat,					// push fVal with 'arg' decimal places
+		pushIdentifier,				// evaluate the identifier expression at textOffset and push it, applying the # operator if 'arg' is nonzero
+		pushString,					// evaluate the quoted string at textOffset and push it
+		negate,						// unary -
+		unaryPlus,					// unary +
+		length,						// unary # applied to a value other than an identifier expression
+		logicalNot,					// unary !
+		binary,						// binary operator 'arg' with both operands on the stack, inverted if the top bit of 'arg' is set
+		andJump,					// convert the top value to Boolean, if false then jump to target else pop it
+		orJump,						// convert the top value to Boolean, if true then jump to target else pop it
+		toBool,						// convert the top value to Boolean
+		condJump,					// convert the top value to Boolean and pop it, if false then jump to target
+		jump						// jump to target
+	};
+
+	static constexpr uint8_t InvertFlag = 0x80;
+
+	struct Operation
+	{
+		OpCode opCode;
+		uint8_t arg;
+		uint16_t textOffset;		// offset of the corresponding text from the start of the expression, used to evaluate identifiers and to report errors
+		union
+		{
+			int32_t iVal;
+			float fVal;
+			uint32_t target;		// the index of the operation to jump to
+		};
+	};
+
+	void Init(FilePosition p_filePosition, uint32_t p_textHash, uint16_t p_textLength) noexcept;
+	bool Matches(FilePosition p_filePosition, uint32_t p_textHash, uint16_t p_textLength) const noexcept
+	{
+		return filePosition == p_filePosition && textHash == p_textHash && textLength == p_textLength;
+	}
+
+	size_t GetNumOperations() const noexcept { return numOperations; }
+	const Operation& GetOperation(size_t n) const noexcept { return operations[n]; }
+	uint16_t GetEndOffset() const noexcept { return endOffset; }
+
+	// Functions used while recording
+	Operation *AddOperation(OpCode op, uint8_t arg, uint16_t textOffset) noexcept;
+	void SetTarget(size_t opIndex) noexcept { if (opIndex < numOperations) { operations[opIndex].target = numOperations; } }
+	void Finish(uint16_t p_endOffset) noexcept { endOffset = p_endOffset; }
+	bool IsValid() const noexcept { return valid; }
+
+	uint32_t whenLastUsed;			// used to choose which entry to replace
+
+private:
+	FilePosition filePosition;
+	uint32_t textHash;
+	uint16_t textLength;
+	uint16_t endOffset;				// offset of the end of the expression from the start of the text
+	uint8_t numOperations;
+	uint8_t stackDepth;
+	bool valid;						// false if the expression was too complex to record
+	Operation operations[MaxOperations];
+};
+
+namespace ExpressionCache
+{
+	uint32_t HashText(const char *text, size_t length) noexcept;
+	const CompiledExpression *Find(FilePosition filePosition, uint32_t textHash, uint16_t textLength) noexcept;
+	CompiledExpression& GetRecorder() noexcept;
+	void Store(const CompiledExpression& recorded) noexcept;
+	void Diagnostics(MessageType mtype) noexcept;
+}
+
+#endif /* SRC_GCODES_GCODEBUFFER_EXPRESSIONCACHE_H_ */
@@ -8,6 +8,7 @@
 #include "ExpressionParser.h"
 
 #include "GCodeBuffer.h"
+#include "ExpressionCache.h"
 #include <Platform/RepRap.h>
 #include <Platform/Platform.h>
 #include <General/NamedEnum.h>
@@ -26,7 +27,7 @@ namespace StackUsage
 {
 	// The following values are the number of bytes of stack space needed by the corresponding functions and functions they call,
 	// not counting other called functions that call CheckStack. They are obtained from file ExpressionParser.su generated by the compiler.
-	constexpr uint32_t ParseInternal = 80;
+	constexpr uint32_t ParseInternal = 96;
 	constexpr uint32_t ParseIdentifierExpression = 240;
 	constexpr uint32_t GetObjectValueUsingTableNumber = 48;
 }
@@ -38,7 +39,7 @@ NamedEnum(Function, unsigned int, abs, acos, asin, atan, atan2, cos, datetime, d
 const char * const InvalidExistsMessage = "invalid 'exists' expression";
 
 ExpressionParser::ExpressionParser(const GCodeBuffer& p_gb, const char *text, const char *textLimit, int p_column) noexcept
-	: currentp(text), startp(text), endp(textLimit), gb(p_gb), column(p_column)
+	: currentp(text), startp(text), endp(textLimit), gb(p_gb), column(p_column), recorder(nullptr), cacheBase(text), cachePosition(noFilePosition)
 {
 }
 
@@ -59,7 +60,32 @@ ExpressionValue ExpressionParser::Parse(bool evaluate) THROWS(GCodeException)
 {
 	obsoleteField.Clear();
 	ExpressionValue result;
-	ParseInternal(result, evaluate, 0);
+	if (evaluate && cachePosition != noFilePosition)
+	{
+		// Look for a compiled version of this expression, or record one if we don't have it
+		cacheBase = currentp;
+		const size_t textLength = strnlen(currentp, endp - currentp);
+		const FilePosition pos = cachePosition + (currentp - startp);
+		const uint32_t hash = ExpressionCache::HashText(currentp, textLength);
+		const CompiledExpression * const compiled = ExpressionCache::Find(pos, hash, textLength);
+		if (compiled != nullptr)
+		{
+			EvaluateCompiled(*compiled, result);
+		}
+		else
+		{
+			recorder = &ExpressionCache::GetRecorder();
+			recorder->Init(pos, hash, textLength);
+			ParseInternal(result, evaluate, 0);
+			recorder->Finish(currentp - cacheBase);
+			ExpressionCache::Store(*recorder);
+			recorder = nullptr;
+		}
+	}
+	else
+	{
+		ParseInternal(result, evaluate, 0);
+	}
 	if (!obsoleteField.IsEmpty())
 	{
 		reprap.GetPlatform().MessageF(WarningMessage, "obsolete object model field %s queried\n", obsoleteField.c_str());
@@ -67,6 +93,142 @@ ExpressionValue ExpressionParser::Parse(bool evaluate) THROWS(GCodeException)
 	return result;
 }
 
+// Evaluate a compiled expression. This is not recursive, except that identifier expressions may contain nested expressions.
+void ExpressionParser::EvaluateCompiled(const CompiledExpression& compiled, ExpressionValue& result) THROWS(GCodeException)
+{
+	ExpressionValue stack[CompiledExpression::MaxStackDepth];
+	size_t sp = 0;
+	size_t pc = 0;
+	while (pc < compiled.GetNumOperations())
+	{
+		const CompiledExpression::Operation& op = compiled.GetOperation(pc++);
+		currentp = cacheBase + op.textOffset;					// so that identifiers are read from the right place and errors report the right column
+		switch (op.opCode)
+		{
+		case CompiledExpression::OpCode::pushInt:
+			stack[sp++].SetInt(op.iVal);
+			break;
+
+		case CompiledExpression::OpCode::pushFloat:
+			stack[sp++].SetFloat(op.fVal, op.arg);
+			break;
+
+		case CompiledExpression::OpCode::pushIdentifier:
+			CheckStack(StackUsage::ParseIdentifierExpression);
+			ParseIdentifierExpression(stack[sp++], true, op.arg != 0, false);
+			break;
+
+		case CompiledExpression::OpCode::pushString:
+			ParseQuotedString(stack[sp++]);
+			break;
+
+		case CompiledExpression::OpCode::negate:
+			ApplyUnaryMinus(stack[sp - 1]);
+			break;
+
+		case CompiledExpression::OpCode::unaryPlus:
+			ApplyUnaryPlus(stack[sp - 1]);
+			break;
+
+		case CompiledExpression::OpCode::length:
+			ApplyLength(stack[sp - 1]);
+			break;
+
+		case CompiledExpression::OpCode::logicalNot:
+			ConvertToBool(stack[sp - 1], true);
+			stack[sp - 1].bVal = !stack[sp - 1].bVal;
+			break;
+
+		case CompiledExpression::OpCode::binary:
+			--sp;
+			ApplyBinaryOperator((char)(op.arg & ~CompiledExpression::InvertFlag), (op.arg & CompiledExpression::InvertFlag) != 0, stack[sp - 1], stack[sp], true);
+			break;
+
+		case CompiledExpression::OpCode::andJump:
+			ConvertToBool(stack[sp - 1], true);
+			if (stack[sp - 1].bVal)
+			{
+				--sp;											// the result is the second operand
+			}
+			else
+			{
+				pc = op.target;									// the result is false
+			}
+			break;
+
+		case CompiledExpression::OpCode::orJump:
+			ConvertToBool(stack[sp - 1], true);
+			if (stack[sp - 1].bVal)
+			{
+				pc = op.target;									// the result is true
+			}
+			else
+			{
+				--sp;											// the result is the second operand
+			}
+			break;
+
+		case CompiledExpression::OpCode::toBool:
+			ConvertToBool(stack[sp - 1], true);
+			break;
+
+		case CompiledExpression::OpCode::condJump:
+			ConvertToBool(stack[sp - 1], true);
+			--sp;
+			if (!stack[sp].bVal)
+			{
+				pc = op.target;
+			}
+			break;
+
+		case CompiledExpression::OpCode::jump:
+			pc = op.target;
+			break;
+		}
+	}
+	result = stack[0];
+	currentp = cacheBase + compiled.GetEndOffset();
+}
+
+// Record an operation if we are compiling the expression
+CompiledExpression::Operation *ExpressionParser::RecordOperation(CompiledExpression::OpCode op, uint8_t arg, const char *where) noexcept
+{
+	return (recorder == nullptr) ? nullptr : recorder->AddOperation(op, arg, where - cacheBase);
+}
+
+// Record a jump operation and return its index so that the target can be set later
+size_t ExpressionParser::RecordJump(CompiledExpression::OpCode op, const char *where) noexcept
+{
+	if (recorder == nullptr)
+	{
+		return 0;
+	}
+	const size_t index = recorder->GetNumOperations();
+	(void)recorder->AddOperation(op, 0, where - cacheBase);
+	return index;
+}
+
+// Set the target of a recorded jump operation to be the next operation
+void ExpressionParser::SetJumpTarget(size_t jumpIndex) noexcept
+{
+	if (recorder != nullptr)
+	{
+		recorder->SetTarget(jumpIndex);
+	}
+}
+
+// Parse an identifier expression as an operand. If we are compiling the expression then we record it as a single operation,
+// so we must not record any expressions nested within it.
+inline void ExpressionParser::ParseIdentifierOperand(ExpressionValue& val, bool evaluate, bool applyLengthOperator) THROWS(GCodeException)
+{
+	const char * const operandStart = currentp;
+	CompiledExpression * const savedRecorder = recorder;
+	recorder = nullptr;
+	ParseIdentifierExpression(val, evaluate, applyLengthOperator, false);
+	recorder = savedRecorder;
+	(void)RecordOperation(CompiledExpression::OpCode::pushIdentifier, (applyLengthOperator) ? 1 : 0, operandStart);
+}
+
 // Evaluate an expression internally, stopping before any binary operators with priority 'priority' or lower
 // This is recursive, so avoid allocating large amounts of data on the stack
 void ExpressionParser::ParseInternal(ExpressionValue& val, bool evaluate, uint8_t priority) THROWS(GCodeException)
@@ -79,54 +241,29 @@ void ExpressionParser::ParseInternal(ExpressionValue& val, bool evaluate, uint8_
 
 	// Start by looking for a unary operator or opening bracket
 	SkipWhiteSpace();
+	const char * const operandStart = currentp;
 	const char c = CurrentCharacter();
 	switch (c)
 	{
 	case '"':
 		ParseQuotedString(val);
+		RecordOperation(CompiledExpression::OpCode::pushString, 0, operandStart);
 		break;
 
 	case '-':
 		AdvancePointer();
 		CheckStack(StackUsage::ParseInternal);
 		ParseInternal(val, evaluate, UnaryPriority);
-		switch (val.GetType())
-		{
-		case TypeCode::Int32:
-			val.iVal = -val.iVal;		//TODO overflow check
-			break;
-
-		case TypeCode::Float:
-			val.fVal = -val.fVal;
-			break;
-
-		default:
-			ThrowParseException("expected numeric value after '-'");
-		}
+		RecordOperation(CompiledExpression::OpCode::negate, 0, operandStart);
+		ApplyUnaryMinus(val);
 		break;
 
 	case '+':
 		AdvancePointer();
 		CheckStack(StackUsage::ParseInternal);
 		ParseInternal(val, evaluate, UnaryPriority);
-		switch (val.GetType())
-		{
-		case TypeCode::Uint32:
-			// Convert enumeration to integer
-			val.SetInt((int32_t)val.uVal);
-			break;
-
-		case TypeCode::Int32:
-		case TypeCode::Float:
-			break;
-
-		case TypeCode::DateTime_tc:					// unary + converts a DateTime to a seconds count
-			val.SetInt((uint32_t)val.Get56BitValue());
-			break;
-
-		default:
-			ThrowParseException("expected numeric or enumeration value after '+'");
-		}
+		RecordOperation(CompiledExpression::OpCode::unaryPlus, 0, operandStart);
+		ApplyUnaryPlus(val);
 		break;
 
 	case '#':
@@ -136,24 +273,14 @@ void ExpressionParser::ParseInternal(ExpressionValue& val, bool evaluate, uint8_
 		{
 			// Probably applying # to an object model array, so optimise by asking the OM for just the length
 			CheckStack(StackUsage::ParseIdentifierExpression);
-			ParseIdentifierExpression(val, evaluate, true, false);
+			ParseIdentifierOperand(val, evaluate, true);
 		}
 		else
 		{
 			CheckStack(StackUsage::ParseInternal);
 			ParseInternal(val, evaluate, UnaryPriority);
-			if (val.GetType() == TypeCode::CString)
-			{
-				val.SetInt((int32_t)strlen(val.sVal));
-			}
-			else if (val.GetType() == TypeCode::HeapString)
-			{
-				val.SetInt((int32_t)val.shVal.GetLength());
-			}
-			else
-			{
-				ThrowParseException("expected object model value or string after '#");
-			}
+			RecordOperation(CompiledExpression::OpCode::length, 0, operandStart);
+			ApplyLength(val);
 		}
 		break;
 
@@ -171,6 +298,7 @@ void ExpressionParser::ParseInternal(ExpressionValue& val, bool evaluate, uint8_
 		AdvancePointer();
 		CheckStack(StackUsage::ParseInternal);
 		ParseInternal(val, evaluate, UnaryPriority);
+		RecordOperation(CompiledExpression::OpCode::logicalNot, 0, operandStart);
 		ConvertToBool(val, evaluate);
 		val.bVal = !val.bVal;
 		break;
@@ -179,11 +307,27 @@ void ExpressionParser::ParseInternal(ExpressionValue& val, bool evaluate, uint8_
 		if (isdigit(c))						// looks like a number
 		{
 			ParseNumber(val);
+			if (val.GetType() == TypeCode::Int32)
+			{
+				CompiledExpression::Operation * const op = RecordOperation(CompiledExpression::OpCode::pushInt, 0, operandStart);
+				if (op != nullptr)
+				{
+					op->iVal = val.iVal;
+				}
+			}
+			else
+			{
+				CompiledExpression::Operation * const op = RecordOperation(CompiledExpression::OpCode::pushFloat, val.param, operandStart);
+				if (op != nullptr)
+				{
+					op->fVal = val.fVal;
+				}
+			}
 		}
 		else if (isalpha(c))				// looks like a variable name
 		{
 			CheckStack(StackUsage::ParseIdentifierExpression);
-			ParseIdentifierExpression(val, evaluate, false, false);
+			ParseIdentifierOperand(val, evaluate, false);
 		}
 		else
 		{
@@ -207,6 +351,7 @@ void ExpressionParser::ParseInternal(ExpressionValue& val, bool evaluate, uint8_
 		{
 			return;
 		}
+		const char * const opStart = currentp;
 		const size_t index = q - operators;
 		const uint8_t opPrio = priorities[index];
 		if (opPrio <= priority)
@@ -247,9 +392,12 @@ void ExpressionParser::ParseInternal(ExpressionValue& val, bool evaluate, uint8_
 		case '&':
 			ConvertToBool(val, evaluate);
 			{
+				const size_t jumpIndex = RecordJump(CompiledExpression::OpCode::andJump, opStart);
 				ExpressionValue val2;
 				CheckStack(StackUsage::ParseInternal);
 				ParseInternal(val2, evaluate && val.bVal, opPrio);		// get the next operand
+				RecordOperation(CompiledExpression::OpCode::toBool, 0, opStart);
+				SetJumpTarget(jumpIndex);
 				if (val.bVal)
 				{
 					ConvertToBool(val2, evaluate);
@@ -261,9 +409,12 @@ void ExpressionParser::ParseInternal(ExpressionValue& val, bool evaluate, uint8_
 		case '|':
 			ConvertToBool(val, evaluate);
 			{
+				const size_t jumpIndex = RecordJump(CompiledExpression::OpCode::orJump, opStart);
 				ExpressionValue val2;
 				CheckStack(StackUsage::ParseInternal);
 				ParseInternal(val2, evaluate && !val.bVal, opPrio);		// get the next operand
+				RecordOperation(CompiledExpression::OpCode::toBool, 0, opStart);
+				SetJumpTarget(jumpIndex);
 				if (!val.bVal)
 				{
 					ConvertToBool(val2, evaluate);
@@ -276,6 +427,7 @@ void ExpressionParser::ParseInternal(ExpressionValue& val, bool evaluate, uint8_
 			ConvertToBool(val, evaluate);
 			{
 				const bool b = val.bVal;
+				const size_t condJumpIndex = RecordJump(CompiledExpression::OpCode::condJump, opStart);
 				ExpressionValue val2;
 				CheckStack(StackUsage::ParseInternal);
 				ParseInternal(((b) ? val : val2), evaluate && b, opPrio);		// get the second operand
@@ -283,9 +435,12 @@ void ExpressionParser::ParseInternal(ExpressionValue& val, bool evaluate, uint8_
 				{
 					ThrowParseException("expected ':'");
 				}
+				const size_t jumpIndex = RecordJump(CompiledExpression::OpCode::jump, currentp);
+				SetJumpTarget(condJumpIndex);
 				AdvancePointer();
 				// We recently checked the stack for a call to ParseInternal, no need to do it again
 				ParseInternal(((b) ? val2 : val), evaluate && !b, opPrio - 1);	// get the third operand, which may be a further conditional expression
+				SetJumpTarget(jumpIndex);
 				return;
 			}
 
@@ -295,231 +450,296 @@ void ExpressionParser::ParseInternal(ExpressionValue& val, bool evaluate, uint8_
 				ExpressionValue val2;
 				CheckStack(StackUsage::ParseInternal);
 				ParseInternal(val2, evaluate, opPrio);	// get the next operand
-				switch(opChar)
+				RecordOperation(CompiledExpression::OpCode::binary, (uint8_t)opChar | ((invert) ? CompiledExpression::InvertFlag : 0), opStart);
+				ApplyBinaryOperator(opChar, invert, val, val2, evaluate);
+			}
+		}
+	} while (true);
+}
+
+// Apply unary minus to val
+void ExpressionParser::ApplyUnaryMinus(ExpressionValue& val) const THROWS(GCodeException)
+{
+	switch (val.GetType())
+	{
+	case TypeCode::Int32:
+		val.iVal = -val.iVal;		//TODO overflow check
+		break;
+
+	case TypeCode::Float:
+		val.fVal = -val.fVal;
+		break;
+
+	default:
+		ThrowParseException("expected numeric value after '-'");
+	}
+}
+
+// Apply unary plus to val
+void ExpressionParser::ApplyUnaryPlus(ExpressionValue& val) const THROWS(GCodeException)
+{
+	switch (val.GetType())
+	{
+	case TypeCode::Uint32:
+		// Convert enumeration to integer
+		val.SetInt((int32_t)val.uVal);
+		break;
+
+	case TypeCode::Int32:
+	case TypeCode::Float:
+		break;
+
+	case TypeCode::DateTime_tc:					// unary + converts a DateTime to a seconds count
+		val.SetInt((uint32_t)val.Get56BitValue());
+		break;
+
+	default:
+		ThrowParseException("expected numeric or enumeration value after '+'");
+	}
+}
+
+// Apply the # operator to a value that is not an identifier expression
+void ExpressionParser::ApplyLength(ExpressionValue& val) const THROWS(GCodeException)
+{
+	if (val.GetType() == TypeCode::CString)
+	{
+		val.SetInt((int32_t)strlen(val.sVal));
+	}
+	else if (val.GetType() == TypeCode::HeapString)
+	{
+		val.SetInt((int32_t)val.shVal.GetLength());
+	}
+	else
+	{
+		ThrowParseException("expected object model value or string after '#");
+	}
+}
+
+// Apply a binary operator that always evaluates both operands, leaving the result in val
+void ExpressionParser::ApplyBinaryOperator(char opChar, bool invert, ExpressionValue& val, ExpressionValue& val2, bool evaluate) THROWS(GCodeException)
+{
+	switch(opChar)
+	{
+	case '+':
+		if (val.GetType() == TypeCode::DateTime_tc)
+		{
+			if (val2.GetType() == TypeCode::Uint32)
+			{
+				val.Set56BitValue(val.Get56BitValue() + val2.uVal);
+			}
+			else if (val2.GetType() == TypeCode::Int32)
+			{
+				val.Set56BitValue((int64_t)val.Get56BitValue() + val2.iVal);
+			}
+			else if (evaluate)
+			{
+				ThrowParseException("invalid operand types");
+			}
+		}
+		else
+		{
+			BalanceNumericTypes(val, val2, evaluate);
+			if (val.GetType() == TypeCode::Float)
+			{
+				val.fVal += val2.fVal;
+				val.param = max(val.param, val2.param);
+			}
+			else
+			{
+				val.iVal += val2.iVal;
+			}
+		}
+		break;
+
+	case '-':
+		if (val.GetType() == TypeCode::DateTime_tc)
+		{
+			if (val2.GetType() == TypeCode::DateTime_tc)
+			{
+				// Difference of two data/times
+				val.SetInt((int32_t)(val.Get56BitValue() - val2.Get56BitValue()));
+			}
+			else if (val2.GetType() == TypeCode::Uint32)
+			{
+				val.Set56BitValue(val.Get56BitValue() - val2.uVal);
+			}
+			else if (val2.GetType() == TypeCode::Int32)
+			{
+				val.Set56BitValue((int64_t)val.Get56BitValue() - val2.iVal);
+			}
+			else if (evaluate)
+			{
+				ThrowParseException("invalid operand types");
+			}
+		}
+		else
+		{
+			BalanceNumericTypes(val, val2, evaluate);
+			if (val.GetType() == TypeCode::Float)
+			{
+				val.fVal -= val2.fVal;
+				val.param = max(val.param, val2.param);
+			}
+			else
+			{
+				val.iVal -= val2.iVal;
+			}
+		}
+		break;
+
+	case '*':
+		BalanceNumericTypes(val, val2, evaluate);
+		if (val.GetType() == TypeCode::Float)
+		{
+			val.fVal *= val2.fVal;
+			val.param = max(val.param, val2.param);
+		}
+		else
+		{
+			val.iVal *= val2.iVal;
+		}
+		break;
+
+	case '/':
+		ConvertToFloat(val, evaluate);
+		ConvertToFloat(val2, evaluate);
+		val.fVal /= val2.fVal;
+		val.param = MaxFloatDigitsDisplayedAfterPoint;
+		break;
+
+	case '>':
+		BalanceTypes(val, val2, evaluate);
+		{
+			bool bResult;
+			switch (val.GetType())
+			{
+			case TypeCode::Int32:
+				bResult = (val.iVal > val2.iVal);
+				break;
+
+			case TypeCode::Float:
+				bResult = (val.fVal > val2.fVal);
+				break;
+
+			case TypeCode::DateTime_tc:
+				bResult = val.Get56BitValue() > val2.Get56BitValue();
+				break;
+
+			case TypeCode::Bool:
+				bResult = (val.bVal && !val2.bVal);
+				break;
+
+			default:
+				if (evaluate)
 				{
-				case '+':
-					if (val.GetType() == TypeCode::DateTime_tc)
-					{
-						if (val2.GetType() == TypeCode::Uint32)
-						{
-							val.Set56BitValue(val.Get56BitValue() + val2.uVal);
-						}
-						else if (val2.GetType() == TypeCode::Int32)
-						{
-							val.Set56BitValue((int64_t)val.Get56BitValue() + val2.iVal);
-						}
-						else if (evaluate)
-						{
-							ThrowParseException("invalid operand types");
-						}
-					}
-					else
-					{
-						BalanceNumericTypes(val, val2, evaluate);
-						if (val.GetType() == TypeCode::Float)
-						{
-							val.fVal += val2.fVal;
-							val.param = max(val.param, val2.param);
-						}
-						else
-						{
-							val.iVal += val2.iVal;
-						}
-					}
+					ThrowParseException("expected numeric or Boolean operands to comparison operator");
+				}
+				bResult = false;
+				break;
+			}
+			val.SetBool((invert) ? !bResult : bResult);
+		}
+		break;
+
+	case '<':
+		BalanceTypes(val, val2, evaluate);
+		{
+			bool bResult;
+			switch (val.GetType())
+			{
+			case TypeCode::Int32:
+				bResult = (val.iVal < val2.iVal);
+				break;
+
+			case TypeCode::Float:
+				bResult = (val.fVal < val2.fVal);
+				break;
+
+			case TypeCode::DateTime_tc:
+				bResult = val.Get56BitValue() < val2.Get56BitValue();
+				break;
+
+			case TypeCode::Bool:
+				bResult = (!val.bVal && val2.bVal);
+				break;
+
+			default:
+				if (evaluate)
+				{
+					ThrowParseException("expected numeric or Boolean operands to comparison operator");
+				}
+				bResult = false;
+				break;
+			}
+			val.SetBool((invert) ? !bResult : bResult);
+		}
+		break;
+
+	case '=':
+		{
+			bool bResult;
+			// Before balancing, handle comparisons with null
+			if (val.GetType() == TypeCode::None)
+			{
+				bResult = (val2.GetType() == TypeCode::None);
+			}
+			else if (val2.GetType() == TypeCode::None)
+			{
+				bResult = false;
+			}
+			else
+			{
+				BalanceTypes(val, val2, evaluate);
+				switch (val.GetType())
+				{
+				case TypeCode::ObjectModel_tc:
+					ThrowParseException("cannot compare objects");
+
+				case TypeCode::Int32:
+					bResult = (val.iVal == val2.iVal);
 					break;
 
-				case '-':
-					if (val.GetType() == TypeCode::DateTime_tc)
-					{
-						if (val2.GetType() == TypeCode::DateTime_tc)
-						{
-							// Difference of two data/times
-							val.SetInt((int32_t)(val.Get56BitValue() - val2.Get56BitValue()));
-						}
-						else if (val2.GetType() == TypeCode::Uint32)
-						{
-							val.Set56BitValue(val.Get56BitValue() - val2.uVal);
-						}
-						else if (val2.GetType() == TypeCode::Int32)
-						{
-							val.Set56BitValue((int64_t)val.Get56BitValue() - val2.iVal);
-						}
-						else if (evaluate)
-						{
-							ThrowParseException("invalid operand types");
-						}
-					}
-					else
-					{
-						BalanceNumericTypes(val, val2, evaluate);
-						if (val.GetType() == TypeCode::Float)
-						{
-							val.fVal -= val2.fVal;
-							val.param = max(val.param, val2.param);
-						}
-						else
-						{
-							val.iVal -= val2.iVal;
-						}
-					}
+				case TypeCode::Uint32:
+					bResult = (val.uVal == val2.uVal);
 					break;
 
-				case '*':
-					BalanceNumericTypes(val, val2, evaluate);
-					if (val.GetType() == TypeCode::Float)
-					{
-						val.fVal *= val2.fVal;
-						val.param = max(val.param, val2.param);
-					}
-					else
-					{
-						val.iVal *= val2.iVal;
-					}
+				case TypeCode::Float:
+					bResult = (val.fVal == val2.fVal);
 					break;
 
-				case '/':
-					ConvertToFloat(val, evaluate);
-					ConvertToFloat(val2, evaluate);
-					val.fVal /= val2.fVal;
-					val.param = MaxFloatDigitsDisplayedAfterPoint;
+				case TypeCode::DateTime_tc:
+					bResult = val.Get56BitValue() == val2.Get56BitValue();
 					break;
 
-				case '>':
-					BalanceTypes(val, val2, evaluate);
-					{
-						bool bResult;
-						switch (val.GetType())
-						{
-						case TypeCode::Int32:
-							bResult = (val.iVal > val2.iVal);
-							break;
-
-						case TypeCode::Float:
-							bResult = (val.fVal > val2.fVal);
-							break;
-
-						case TypeCode::DateTime_tc:
-							bResult = val.Get56BitValue() > val2.Get56BitValue();
-							break;
-
-						case TypeCode::Bool:
-							bResult = (val.bVal && !val2.bVal);
-							break;
-
-						default:
-							if (evaluate)
-							{
-								ThrowParseException("expected numeric or Boolean operands to comparison operator");
-							}
-							bResult = false;
-							break;
-						}
-						val.SetBool((invert) ? !bResult : bResult);
-					}
+				case TypeCode::Bool:
+					bResult = (val.bVal == val2.bVal);
 					break;
 
-				case '<':
-					BalanceTypes(val, val2, evaluate);
-					{
-						bool bResult;
-						switch (val.GetType())
-						{
-						case TypeCode::Int32:
-							bResult = (val.iVal < val2.iVal);
-							break;
-
-						case TypeCode::Float:
-							bResult = (val.fVal < val2.fVal);
-							break;
-
-						case TypeCode::DateTime_tc:
-							bResult = val.Get56BitValue() < val2.Get56BitValue();
-							break;
-
-						case TypeCode::Bool:
-							bResult = (!val.bVal && val2.bVal);
-							break;
-
-						default:
-							if (evaluate)
-							{
-								ThrowParseException("expected numeric or Boolean operands to comparison operator");
-							}
-							bResult = false;
-							break;
-						}
-						val.SetBool((invert) ? !bResult : bResult);
-					}
+				case TypeCode::CString:
+					bResult = (strcmp(val.sVal, (val2.GetType() == TypeCode::HeapString) ? val2.shVal.Get().Ptr() : val2.sVal) == 0);
 					break;
 
-				case '=':
-					{
-						bool bResult;
-						// Before balancing, handle comparisons with null
-						if (val.GetType() == TypeCode::None)
-						{
-							bResult = (val2.GetType() == TypeCode::None);
-						}
-						else if (val2.GetType() == TypeCode::None)
-						{
-							bResult = false;
-						}
-						else
-						{
-							BalanceTypes(val, val2, evaluate);
-							switch (val.GetType())
-							{
-							case TypeCode::ObjectModel_tc:
-								ThrowParseException("cannot compare objects");
-
-							case TypeCode::Int32:
-								bResult = (val.iVal == val2.iVal);
-								break;
-
-							case TypeCode::Uint32:
-								bResult = (val.uVal == val2.uVal);
-								break;
-
-							case TypeCode::Float:
-								bResult = (val.fVal == val2.fVal);
-								break;
-
-							case TypeCode::DateTime_tc:
-								bResult = val.Get56BitValue() == val2.Get56BitValue();
-								break;
-
-							case TypeCode::Bool:
-								bResult = (val.bVal == val2.bVal);
-								break;
-
-							case TypeCode::CString:
-								bResult = (strcmp(val.sVal, (val2.GetType() == TypeCode::HeapString) ? val2.shVal.Get().Ptr() : val2.sVal) == 0);
-								break;
-
-							case TypeCode::HeapString:
-								bResult = (strcmp(val.shVal.Get().Ptr(), (val2.GetType() == TypeCode::HeapString) ? val2.shVal.Get().Ptr() : val2.sVal) == 0);
-								break;
-
-							default:
-								if (evaluate)
-								{
-									ThrowParseException("unexpected operand type to equality operator");
-								}
-								bResult = false;
-								break;
-							}
-						}
-						val.SetBool((invert) ? !bResult : bResult);
-					}
+				case TypeCode::HeapString:
+					bResult = (strcmp(val.shVal.Get().Ptr(), (val2.GetType() == TypeCode::HeapString) ? val2.shVal.Get().Ptr() : val2.sVal) == 0);
 					break;
 
-				case '^':
-					StringConcat(val, val2);
+				default:
+					if (evaluate)
+					{
+						ThrowParseException("unexpected operand type to equality operator");
+					}
+					bResult = false;
 					break;
 				}
 			}
+			val.SetBool((invert) ? !bResult : bResult);
 		}
-	} while (true);
+		break;
+
+	case '^':
+		StringConcat(val, val2);
+		break;
+	}
 }
 
 // Concatenate val1 and val2 and assign the result to val1
@@ -1310,6 +1530,7 @@ void ExpressionParser::ParseIdentifierExpression(ExpressionValue& rslt, bool eva
 
 		// Else assume an object model value
 		CheckStack(StackUsage::GetObjectValueUsingTableNumber);
+		context.SetCachePath(id.c_str(), ExpressionCache::HashText(id.c_str(), id.strlen()));
 		rslt = reprap.GetObjectValueUsingTableNumber(context, nullptr, id.c_str(), 0);
 		if (context.ObsoleteFieldQueried() && obsoleteField.IsEmpty())
 		{
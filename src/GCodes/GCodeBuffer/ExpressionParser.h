@@ -11,6 +11,7 @@
 #include <RepRapFirmware.h>
 #include <ObjectModel/ObjectModel.h>
 #include <GCodes/GCodeException.h>
+#include "ExpressionCache.h"
 
 class VariableSet;
 
@@ -34,6 +35,7 @@ public:
 
 	void SkipWhiteSpace() noexcept;
 	void CheckForExtraCharacters() THROWS(GCodeException);
+	void EnableCaching(FilePosition pos) noexcept { cachePosition = pos; }	// cache the compiled expression, keyed by its file position and text
 	const char *GetEndptr() const noexcept { return currentp; }
 
 private:
@@ -42,6 +44,11 @@ private:
 	[[noreturn]] void __attribute__((noinline)) ThrowParseException(const char *str, uint32_t param) const THROWS(GCodeException);
 
 	void ParseInternal(ExpressionValue& val, bool evaluate, uint8_t priority) THROWS(GCodeException);
+	void EvaluateCompiled(const CompiledExpression& compiled, ExpressionValue& result) THROWS(GCodeException);
+	CompiledExpression::Operation *RecordOperation(CompiledExpression::OpCode op, uint8_t arg, const char *where) noexcept;
+	size_t RecordJump(CompiledExpression::OpCode op, const char *where) noexcept;
+	void SetJumpTarget(size_t jumpIndex) noexcept;
+	void ParseIdentifierOperand(ExpressionValue& val, bool evaluate, bool applyLengthOperator) THROWS(GCodeException);
 	void ParseExpectKet(ExpressionValue& rslt, bool evaluate, char expectedKet) THROWS(GCodeException);
 	void __attribute__((noinline)) ParseNumber(ExpressionValue& rslt) noexcept
 		pre(readPointer >= 0; isdigit(gb.buffer[readPointer]));
@@ -64,6 +71,10 @@ private:
 	// The following must be declared 'noinline' because it allocates a large buffer on the stack and its caller is recursive
 	static void __attribute__((noinline)) StringConcat(ExpressionValue &val, ExpressionValue &val2) noexcept;
 
+	void ApplyUnaryMinus(ExpressionValue& val) const THROWS(GCodeException);
+	void ApplyUnaryPlus(ExpressionValue& val) const THROWS(GCodeException);
+	void ApplyLength(ExpressionValue& val) const THROWS(GCodeException);
+	void __attribute__((noinline)) ApplyBinaryOperator(char opChar, bool invert, ExpressionValue& val, ExpressionValue& val2, bool evaluate) THROWS(GCodeException);
 	void BalanceNumericTypes(ExpressionValue& val1, ExpressionValue& val2, bool evaluate) const THROWS(GCodeException);
 	void BalanceTypes(ExpressionValue& val1, ExpressionValue& val2, bool evaluate) THROWS(GCodeException);
 	static bool TypeHasNoLiterals(TypeCode t) noexcept;
@@ -77,6 +88,9 @@ private:
 	const char * const endp;
 	const GCodeBuffer& gb;
 	int column;
+	CompiledExpression *recorder;						// if not null, the compiled expression we are recording
+	const char *cacheBase;								// the start of the expression being compiled or evaluated from the cache
+	FilePosition cachePosition;							// the file position of the text, or noFilePosition if we don't cache the compiled expression
 	String<MaxVariableNameLength> obsoleteField;
 };
 
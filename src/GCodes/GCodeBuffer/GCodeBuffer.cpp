@@ -22,7 +22,7 @@
 #include <Movement/StepTimer.h>
 
 // Macros to reduce the amount of explicit conditional compilation in this file
-#if HAS_SBC_INTERFACE
+#if HAS_BINARY_PARSER
 
 # define PARSER_OPERATION(_x)	((isBinaryBuffer) ? (binaryParser._x) : (stringParser._x))
 # define IS_BINARY_OR(_x)		((isBinaryBuffer) || (_x))
@@ -93,12 +93,12 @@ GCodeBuffer::GCodeBuffer(GCodeChannel::RawType channel, GCodeInput *normalIn, Fi
 	  fileInput(fileIn),
 #endif
 	  responseMessageType(mt), lastResult(GCodeResult::ok),
-#if HAS_SBC_INTERFACE
+#if HAS_BINARY_PARSER
 	  binaryParser(*this),
 #endif
 	  stringParser(*this),
 	  machineState(new GCodeMachineState()), whenReportDueTimerStarted(millis()),
-#if HAS_SBC_INTERFACE
+#if HAS_BINARY_PARSER
 	  isBinaryBuffer(false),
 #endif
 	  timerRunning(false), motionCommanded(false)
@@ -123,8 +123,10 @@ void GCodeBuffer::Reset() noexcept
 
 	while (PopState(false)) { }
 
-#if HAS_SBC_INTERFACE
+#if HAS_BINARY_PARSER
 	isBinaryBuffer = false;
+#endif
+#if HAS_SBC_INTERFACE
 	requestedMacroFile.Clear();
 	isWaitingForMacro = macroFileClosed = false;
 	macroJustStarted = macroFileError = macroFileEmpty = abortFile = abortAllFiles = sendToSbc = messagePromptPending = messageAcknowledged = false;
@@ -138,6 +140,8 @@ void GCodeBuffer::Init() noexcept
 {
 #if HAS_SBC_INTERFACE
 	sendToSbc = false;
+#endif
+#if HAS_BINARY_PARSER
 	binaryParser.Init();
 #endif
 	stringParser.Init();
@@ -190,7 +194,7 @@ void GCodeBuffer::Diagnostics(MessageType mtype) noexcept
 {
 	String<StringLength256> scratchString;
 	scratchString.copy(codeChannel.ToString());
-#if HAS_SBC_INTERFACE
+#if HAS_BINARY_PARSER
 	scratchString.cat(IsBinary() ? "* " : " ");
 #else
 	scratchString.cat(" ");
@@ -230,6 +234,14 @@ void GCodeBuffer::Diagnostics(MessageType mtype) noexcept
 	}
 	scratchString.cat('\n');
 	reprap.GetPlatform().Message(mtype, scratchString.c_str());
+
+#if HAS_MASS_STORAGE || HAS_EMBEDDED_FILES
+	// The file input is shared by all channels, so report it just once
+	if (codeChannel == GCodeChannel::File && fileInput != nullptr)
+	{
+		fileInput->Diagnostics(mtype);
+	}
+#endif
 }
 
 // Add a character to the end
@@ -237,6 +249,8 @@ bool GCodeBuffer::Put(char c) noexcept
 {
 #if HAS_SBC_INTERFACE
 	machineState->lastCodeFromSbc = false;
+#endif
+#if HAS_BINARY_PARSER
 	isBinaryBuffer = false;
 #endif
 	return stringParser.Put(c);
@@ -268,11 +282,29 @@ void GCodeBuffer::PutBinary(const uint32_t *data, size_t len) noexcept
 
 #endif
 
+#if SUPPORT_BINARY_GCODE_FILES
+
+// Add an entire binary G-Code that was read from a local file, overwriting any existing content
+void GCodeBuffer::PutBinaryFromFile(const uint32_t *data, size_t len, FilePosition pos) noexcept
+{
+#if HAS_SBC_INTERFACE
+	machineState->lastCodeFromSbc = false;
+	macroJustStarted = false;
+#endif
+	isBinaryBuffer = true;
+	binaryParser.Put(data, len);
+	binaryParser.SetFilePosition(pos);
+}
+
+#endif
+
 // Add an entire G-Code, overwriting any existing content
 void GCodeBuffer::PutAndDecode(const char *str, size_t len) noexcept
 {
 #if HAS_SBC_INTERFACE
 	machineState->lastCodeFromSbc = false;
+#endif
+#if HAS_BINARY_PARSER
 	isBinaryBuffer = false;
 #endif
 	stringParser.PutAndDecode(str, len);
@@ -283,6 +315,8 @@ void GCodeBuffer::PutAndDecode(const char *str) noexcept
 {
 #if HAS_SBC_INTERFACE
 	machineState->lastCodeFromSbc = false;
+#endif
+#if HAS_BINARY_PARSER
 	isBinaryBuffer = false;
 #endif
 	stringParser.PutAndDecode(str);
@@ -736,6 +770,11 @@ bool GCodeBuffer::IsCompletelyIdle() const noexcept
 	return GetState() == GCodeState::normal && IsIdle();
 }
 
+bool GCodeBuffer::IsAtLineStart() const noexcept
+{
+	return NOT_BINARY_AND(stringParser.IsAtLineStart());
+}
+
 void GCodeBuffer::SetFinished(bool f) noexcept
 {
 	if (f)
@@ -1058,9 +1097,9 @@ void GCodeBuffer::WaitForAcknowledgement() noexcept
 
 #if HAS_MASS_STORAGE
 
-bool GCodeBuffer::OpenFileToWrite(const char* directory, const char* fileName, const FilePosition size, const bool binaryWrite, const uint32_t fileCRC32) noexcept
+bool GCodeBuffer::OpenFileToWrite(const char* directory, const char* fileName, const FilePosition size, const bool binaryWrite, const bool framedBlocks, const uint32_t fileCRC32) noexcept
 {
-	return NOT_BINARY_AND(stringParser.OpenFileToWrite(directory, fileName, size, binaryWrite, fileCRC32));
+	return NOT_BINARY_AND(stringParser.OpenFileToWrite(directory, fileName, size, binaryWrite, framedBlocks, fileCRC32));
 }
 
 bool GCodeBuffer::IsWritingFile() const noexcept
@@ -14,7 +14,7 @@
 #include <RepRapFirmware.h>
 #include <GCodes/GCodeChannel.h>
 #include <GCodes/GCodeMachineState.h>
-#if HAS_SBC_INTERFACE
+#if HAS_BINARY_PARSER
 # include <SBC/SbcMessageFormats.h>
 #endif
 #include <ObjectModel/ObjectModel.h>
@@ -52,6 +52,9 @@ public:
 	bool Put(char c) noexcept SPEED_CRITICAL;									// Add a character to the end
 #if HAS_SBC_INTERFACE
 	void PutBinary(const uint32_t *data, size_t len) noexcept;					// Add an entire binary G-Code, overwriting any existing content
+#endif
+#if SUPPORT_BINARY_GCODE_FILES
+	void PutBinaryFromFile(const uint32_t *data, size_t len, FilePosition pos) noexcept;	// Add an entire binary G-Code read from a file, overwriting any existing content
 #endif
 	void PutAndDecode(const char *data, size_t len) noexcept;					// Add an entire G-Code, overwriting any existing content
 	void PutAndDecode(const char *str) noexcept;								// Add a null-terminated string, overwriting any existing content
@@ -121,6 +124,7 @@ public:
 
 	bool IsIdle() const noexcept;
 	bool IsCompletelyIdle() const noexcept;
+	bool IsAtLineStart() const noexcept;						// Return true if we are reading text and haven't been given any of the next line yet
 	bool IsReady() const noexcept;								// Return true if a gcode is ready but hasn't been started yet
 	bool IsExecuting() const noexcept;							// Return true if a gcode has been started and is not paused
 	void SetFinished(bool f) noexcept;							// Set the G Code executed (or not)
@@ -152,9 +156,11 @@ public:
 
 	void WaitForAcknowledgement() noexcept;						// Flag that we are waiting for acknowledgement
 
-#if HAS_SBC_INTERFACE
+#if HAS_BINARY_PARSER
 	bool IsBinary() const noexcept { return isBinaryBuffer; }	// Return true if the code is in binary format
+#endif
 
+#if HAS_SBC_INTERFACE
 	bool IsFileFinished() const noexcept;						// Return true if this source has finished execution of a file
 	void SetFileFinished() noexcept;							// Mark the current file as finished
 	void SetPrintFinished() noexcept;							// Mark the current print file as finished
@@ -202,7 +208,7 @@ public:
 	MessageType GetResponseMessageType() const noexcept;
 
 #if HAS_MASS_STORAGE
-	bool OpenFileToWrite(const char* directory, const char* fileName, const FilePosition size, const bool binaryWrite, const uint32_t fileCRC32) noexcept;
+	bool OpenFileToWrite(const char* directory, const char* fileName, const FilePosition size, const bool binaryWrite, const bool framedBlocks, const uint32_t fileCRC32) noexcept;
 																// open a file to write to
 	bool IsWritingFile() const noexcept;						// Returns true if writing a file
 	void WriteToFile() noexcept;								// Write the current GCode to file
@@ -276,7 +282,7 @@ private:
 
 	GCodeResult lastResult;
 
-#if HAS_SBC_INTERFACE
+#if HAS_BINARY_PARSER
 	BinaryParser binaryParser;
 #endif
 
@@ -289,16 +295,19 @@ private:
 	uint32_t whenReportDueTimerStarted;					// When the report-due-timer has been started
 	static constexpr uint32_t reportDueInterval = 1000;	// Interval in which we send in ms
 
-#if HAS_SBC_INTERFACE
+#if HAS_BINARY_PARSER
 	bool isBinaryBuffer;
 #endif
 	bool timerRunning;									// True if we are waiting
 	bool motionCommanded;								// true if this GCode stream has commanded motion since it last waited for motion to stop
 
-	alignas(4) char buffer[MaxGCodeLength];				// must be aligned because in SBC binary mode we do dword fetches from it
+	alignas(4) char buffer[MaxGCodeLength];				// must be aligned because in binary mode we do dword fetches from it
+
+#if HAS_BINARY_PARSER
+	static_assert(MaxGCodeLength >= MaxCodeBufferSize);	// make sure the GCodeBuffer is large enough to hold a command in binary
+#endif
 
 #if HAS_SBC_INTERFACE
-	static_assert(MaxGCodeLength >= MaxCodeBufferSize);	// make sure the GCodeBuffer is large enough to hold a command received from the SBC in binary
 
 	// Accessed by both the Main and SBC tasks
 	BinarySemaphore macroSemaphore;
@@ -396,7 +405,7 @@ inline bool GCodeBuffer::IsExecuting() const noexcept
 inline bool GCodeBuffer::IsDoingLocalFile() const noexcept
 {
 #if HAS_SBC_INTERFACE
-	return !IsBinary() && IsDoingFile();
+	return !(IsBinary() && machineState->lastCodeFromSbc) && IsDoingFile();	// binary codes may also come from a local binary G-code file
 #else
 	return IsDoingFile();
 #endif
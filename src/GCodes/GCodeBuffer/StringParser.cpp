@@ -27,6 +27,9 @@ static constexpr char eofString[] = EOF_STRING;		// What's at the end of an HTML
 StringParser::StringParser(GCodeBuffer& gcodeBuffer) noexcept
 	: gb(gcodeBuffer), fileBeingWritten(nullptr), writingFileSize(0), indentToSkipTo(NoIndentSkip), eofStringCounter(0),
 	  hasCommandNumber(false), commandLetter('Q'), checksumRequired(false), crcRequired(false), binaryWriting(false)
+#if HAS_MASS_STORAGE
+	  , framedBinary(false)
+#endif
 {
 	StartNewFile();
 	Init();
@@ -37,7 +40,8 @@ void StringParser::Init() noexcept
 	gcodeLineEnd = 0;
 	commandStart = commandLength = 0;								// set both to zero so that calls to GetFilePosition don't return negative values
 	readPointer = -1;
-	hadLineNumber = hadChecksum = overflowed = seenExpression = false;
+	fastSlot = -1;
+	hadLineNumber = hadChecksum = overflowed = seenExpression = hasFastParameters = false;
 	computedChecksum = 0;
 	gb.bufferState = GCodeBufferState::parseNotStarted;
 	commandIndent = 0;
@@ -279,6 +283,12 @@ bool StringParser::Put(char c) noexcept
 	return false;
 }
 
+// Return true if we haven't been given any characters of the next line yet
+bool StringParser::IsAtLineStart() const noexcept
+{
+	return gb.bufferState == GCodeBufferState::parseNotStarted && commandLength == 0;
+}
+
 // This is called when we are fed a null, CR or LF character.
 // Return true if there is a completed command ready to be executed.
 bool StringParser::LineFinished() noexcept
@@ -703,6 +713,7 @@ void StringParser::ProcessVarOrGlobalCommand(bool isGlobal) THROWS(GCodeExceptio
 
 	SkipWhiteSpace();
 	ExpressionParser parser(gb, gb.buffer + readPointer, gb.buffer + ARRAY_SIZE(gb.buffer), commandIndent + readPointer);
+	parser.EnableCaching(GetFilePosition());
 	ExpressionValue ev = parser.Parse();
 	vset->InsertNew(varName.c_str(), ev, (isGlobal) ? 0 : gb.CurrentFileMachineState().GetBlockNesting());
 	if (isGlobal)
@@ -754,6 +765,7 @@ void StringParser::ProcessSetCommand() THROWS(GCodeException)
 
 	SkipWhiteSpace();
 	ExpressionParser parser(gb, gb.buffer + readPointer, gb.buffer + ARRAY_SIZE(gb.buffer), commandIndent + readPointer);
+	parser.EnableCaching(GetFilePosition());
 	ExpressionValue ev = parser.Parse();
 	var->Assign(ev);
 	if (isGlobal)
@@ -870,6 +882,7 @@ void StringParser::ProcessEchoCommand(const StringRef& reply) THROWS(GCodeExcept
 bool StringParser::EvaluateCondition() THROWS(GCodeException)
 {
 	ExpressionParser parser(gb, gb.buffer + readPointer, gb.buffer + ARRAY_SIZE(gb.buffer), commandIndent + readPointer);
+	parser.EnableCaching(GetFilePosition());
 	const bool b = parser.ParseBoolean();
 	parser.CheckForExtraCharacters();
 	return b;
@@ -893,6 +906,7 @@ void StringParser::DecodeCommand() noexcept
 		cl = toupper(cl);
 	}
 	commandFraction = -1;
+	hasFastParameters = false;
 	if (cl == 'G' || cl == 'M' || cl == 'T')
 	{
 		commandLetter = cl;
@@ -991,6 +1005,7 @@ void StringParser::DecodeCommand() noexcept
 void StringParser::FindParameters() noexcept
 {
 	bool inQuotes = false;
+	bool simpleSyntax = true;							// set false if we see quotes, braces or escapes
 	unsigned int localBraceCount = 0;
 	parametersPresent.Clear();
 	for (commandEnd = parameterStart; commandEnd < gcodeLineEnd; ++commandEnd)
@@ -999,12 +1014,14 @@ void StringParser::FindParameters() noexcept
 		if (c == '"')
 		{
 			inQuotes = !inQuotes;
+			simpleSyntax = false;
 		}
 		else if (!inQuotes)
 		{
 			if (c == '{')
 			{
 				++localBraceCount;
+				simpleSyntax = false;
 			}
 			else if (localBraceCount != 0)
 			{
@@ -1024,9 +1041,70 @@ void StringParser::FindParameters() noexcept
 				{
 					parametersPresent.SetBit(c2 - 'A');
 				}
+				else if (c == '\'')
+				{
+					simpleSyntax = false;
+				}
 			}
 		}
 	}
+
+	if (simpleSyntax && commandLetter == 'G' && hasCommandNumber && (commandNumber == 0 || commandNumber == 1) && commandFraction < 0)
+	{
+		PreParseParameters();
+	}
+}
+
+// Parse all the parameters of a simple G0 or G1 command, so that Seen and GetFValue don't need to search the command for them.
+// We only do this if every parameter is a letter followed by a plain number. If anything else is found we leave hasFastParameters false,
+// so that the parameters are found and read in the normal way.
+// The values are stored in alphabetical order of parameter letter, so that the slot for a letter is the number of lower letters present.
+void StringParser::PreParseParameters() noexcept
+{
+	Bitmap<uint32_t> lettersFound;
+	float values[26];
+	uint16_t offsets[26];
+	unsigned int pos = parameterStart;
+	while (pos < commandEnd)
+	{
+		const char c = gb.buffer[pos];
+		if (c == ' ' || c == '\t')
+		{
+			++pos;
+			continue;
+		}
+
+		const char letter = toupper(c);
+		if (letter < 'A' || letter > 'Z' || lettersFound.IsBitSet(letter - 'A'))
+		{
+			return;										// not a parameter letter, or a repeated one
+		}
+
+		const char *endptr;
+		const float val = SafeStrtof(gb.buffer + pos + 1, &endptr);
+		if (endptr == gb.buffer + pos + 1 || endptr > gb.buffer + commandEnd)
+		{
+			return;										// no number after the letter
+		}
+		lettersFound.SetBit(letter - 'A');
+		values[letter - 'A'] = val;
+		offsets[letter - 'A'] = pos + 1;
+		pos = endptr - gb.buffer;
+	}
+
+	// Check that we found the same parameters as FindParameters, which treats E after a digit differently
+	if (lettersFound.GetRaw() != parametersPresent.GetRaw() || lettersFound.CountSetBits() > MaxFastParameters)
+	{
+		return;
+	}
+
+	lettersFound.Iterate([this, &values, &offsets](unsigned int letterIndex, unsigned int slot) noexcept
+							{
+								fastValues[slot] = values[letterIndex];
+								fastOffsets[slot] = offsets[letterIndex];
+							}
+						);
+	hasFastParameters = true;
 }
 
 // Add an entire string, overwriting any existing content and adding '\n' at the end if necessary to make it a complete line
@@ -1118,6 +1196,7 @@ bool StringParser::IsLastCommand() const noexcept
 // Leave the pointer one after it for a subsequent read.
 bool StringParser::Seen(char c) noexcept
 {
+	fastSlot = -1;
 	bool wantLowerCase = (c >= 'a');
 	if (wantLowerCase)
 	{
@@ -1127,6 +1206,13 @@ bool StringParser::Seen(char c) noexcept
 	{
 		return false;
 	}
+	else if (hasFastParameters)
+	{
+		// The parameters have already been parsed, so we just need to find the slot for this one
+		fastSlot = Bitmap<uint32_t>::MakeFromRaw(parametersPresent.GetRaw() & ((1u << (c - 'A')) - 1)).CountSetBits();
+		readPointer = fastOffsets[fastSlot];
+		return true;
+	}
 
 	bool inQuotes = false;
 	bool escaped = false;
@@ -1185,8 +1271,9 @@ float StringParser::GetFValue() THROWS(GCodeException)
 		THROW_INTERNAL_ERROR;
 	}
 
-	const float result = ReadFloatValue();
+	const float result = (fastSlot >= 0) ? fastValues[fastSlot] : ReadFloatValue();
 	readPointer = -1;
+	fastSlot = -1;
 	return result;
 }
 
@@ -1631,7 +1718,7 @@ void StringParser::StartNewFile() noexcept
 #if HAS_MASS_STORAGE
 
 // Open a file to write to
-bool StringParser::OpenFileToWrite(const char* directory, const char* fileName, const FilePosition size, const bool binaryWrite, const uint32_t fileCRC32) noexcept
+bool StringParser::OpenFileToWrite(const char* directory, const char* fileName, const FilePosition size, const bool binaryWrite, const bool framedBlocks, const uint32_t fileCRC32) noexcept
 {
 	fileBeingWritten = reprap.GetPlatform().OpenFile(directory, fileName, OpenMode::writeWithCrc);
 	eofStringCounter = 0;
@@ -1643,6 +1730,13 @@ bool StringParser::OpenFileToWrite(const char* directory, const char* fileName,
 
 	crc32 = fileCRC32;
 	binaryWriting = binaryWrite;
+	framedBinary = binaryWrite && framedBlocks;
+	if (framedBinary)
+	{
+		blocksReceived = firstBadBlock = 0;
+		binaryBlocksEnded = binaryBlockWriteFailed = false;
+		StartBinaryBlockHeader();
+	}
 	return true;
 }
 
@@ -1688,6 +1782,11 @@ void StringParser::WriteToFile() noexcept
 // Write a character to file, returning true if we finished doing the binary upload
 bool StringParser::WriteBinaryToFile(char b) noexcept
 {
+	if (framedBinary)
+	{
+		return WriteBinaryBlockByte(b);
+	}
+
 	if (b == eofString[eofStringCounter] && writingFileSize == 0)
 	{
 		eofStringCounter++;
@@ -1717,6 +1816,93 @@ bool StringParser::WriteBinaryToFile(char b) noexcept
 	return true;
 }
 
+void StringParser::StartBinaryBlockHeader() noexcept
+{
+	blockState = BinaryBlockState::header;
+	blockFieldBytes = 0;
+	blockFieldValue = 0;
+}
+
+// Process a byte of a framed binary upload, returning true if the upload is finished.
+// After a block with a bad CRC we stop writing to the file but keep reading blocks until the end block, so that the rest of the upload isn't taken as G-code.
+// If a header doesn't start with the marker we have lost track of the blocks, so we end the upload there.
+bool StringParser::WriteBinaryBlockByte(char b) noexcept
+{
+	switch (blockState)
+	{
+	case BinaryBlockState::header:
+		if (blockFieldBytes == 0)
+		{
+			if ((uint8_t)b != BinaryBlockMarker)
+			{
+				FinishWritingBinary();
+				return true;
+			}
+		}
+		else
+		{
+			blockFieldValue |= (uint32_t)(uint8_t)b << (8 * (blockFieldBytes - 1));
+		}
+
+		++blockFieldBytes;
+		if (blockFieldBytes == BinaryBlockHeaderLength)
+		{
+			if (blockFieldValue == 0)
+			{
+				binaryBlocksEnded = true;
+				FinishWritingBinary();
+				return true;
+			}
+			blockBytesLeft = blockFieldValue;
+			blockBytesBuffered = 0;
+			blockCrc.Reset();
+			blockState = BinaryBlockState::data;
+		}
+		break;
+
+	case BinaryBlockState::data:
+		gb.buffer[blockBytesBuffered++] = b;
+		--blockBytesLeft;
+		if (blockBytesLeft == 0 || blockBytesBuffered == sizeof(gb.buffer))
+		{
+			FlushBinaryBlockData();
+		}
+		if (blockBytesLeft == 0)
+		{
+			blockState = BinaryBlockState::crc;
+			blockFieldBytes = 0;
+			blockFieldValue = 0;
+		}
+		break;
+
+	case BinaryBlockState::crc:
+		blockFieldValue |= (uint32_t)(uint8_t)b << (8 * blockFieldBytes);
+		++blockFieldBytes;
+		if (blockFieldBytes == sizeof(uint32_t))
+		{
+			++blocksReceived;
+			if (blockFieldValue != blockCrc.Get() && firstBadBlock == 0)
+			{
+				firstBadBlock = blocksReceived;
+			}
+			StartBinaryBlockHeader();
+		}
+		break;
+	}
+	return false;
+}
+
+// Write the block data held in the buffer. The data in the block is written before we can check its CRC, but once a block has failed we don't write any more.
+void StringParser::FlushBinaryBlockData() noexcept
+{
+	blockCrc.Update(gb.buffer, blockBytesBuffered);
+	if (firstBadBlock == 0 && !binaryBlockWriteFailed && !fileBeingWritten->Write(gb.buffer, blockBytesBuffered))
+	{
+		binaryBlockWriteFailed = true;
+	}
+	blockBytesBuffered = 0;
+}
+
 void StringParser::FinishWritingBinary() noexcept
 {
 	// If we get here then we have come to the end of the data
@@ -1724,6 +1910,30 @@ void StringParser::FinishWritingBinary() noexcept
 	const bool crcOk = (crc32 == fileBeingWritten->GetCRC32() || crc32 == 0);
 	fileBeingWritten = nullptr;
 	binaryWriting = false;
+	if (framedBinary)
+	{
+		framedBinary = false;
+		if (binaryBlockWriteFailed)
+		{
+			reprap.GetGCodes().HandleReply(gb, GCodeResult::error, "Failed to write file");
+			return;
+		}
+		if (firstBadBlock != 0 || !binaryBlocksEnded)
+		{
+			String<StringLength100> scratchString;
+			if (firstBadBlock != 0)
+			{
+				scratchString.printf("CRC32 checksum of block %" PRIu32 " doesn't match", firstBadBlock);
+			}
+			else
+			{
+				scratchString.printf("Upload ended without an end block after %" PRIu32 " blocks", blocksReceived);
+			}
+			reprap.GetGCodes().HandleReply(gb, GCodeResult::error, scratchString.c_str());
+			return;
+		}
+	}
+
 	if (crcOk)
 	{
 		const char* const r = (gb.LatestMachineState().compatibility == Compatibility::Marlin) ? "Done saving file." : "";
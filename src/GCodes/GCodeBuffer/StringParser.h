@@ -15,6 +15,7 @@
 #include <GCodes/GCodeException.h>
 #include <Networking/NetworkDefs.h>
 #include <Storage/CRC16.h>
+#include <Storage/CRC32.h>
 
 class GCodeBuffer;
 class IPAddress;
@@ -35,6 +36,7 @@ public:
 	void StartNewFile() noexcept;											// Called when we start a new file
 	bool FileEnded() noexcept;												// Called when we reach the end of the file we are reading from
 	bool CheckMetaCommand(const StringRef& reply) THROWS(GCodeException);	// Check whether the current command is a meta command, or we are skipping block
+	bool IsAtLineStart() const noexcept;									// Return true if we haven't been given any characters of the next line yet
 
 	// The following may be called after calling DecodeCommand
 	char GetCommandLetter() const noexcept { return commandLetter; }
@@ -67,7 +69,7 @@ public:
 	void SetCommsProperties(uint32_t arg) noexcept { checksumRequired = (arg & 1); crcRequired = (arg & 4); }
 
 #if HAS_MASS_STORAGE
-	bool OpenFileToWrite(const char* directory, const char* fileName, const FilePosition size, const bool binaryWrite, const uint32_t fileCRC32) noexcept;
+	bool OpenFileToWrite(const char* directory, const char* fileName, const FilePosition size, const bool binaryWrite, const bool framedBlocks, const uint32_t fileCRC32) noexcept;
 																			// Open a file to write to
 	bool IsWritingFile() const noexcept { return fileBeingWritten != nullptr; }	// Returns true if writing a file
 	void WriteToFile() noexcept;											// Write the current GCode to file
@@ -108,6 +110,12 @@ private:
 	void CheckNumberFound(const char *endptr) THROWS(GCodeException);
 
 	void CheckForMixedSpacesAndTabs() noexcept;
+
+#if HAS_MASS_STORAGE
+	bool WriteBinaryBlockByte(char b) noexcept;								// Process a byte of a framed binary upload, returning true if the upload is now complete
+	void FlushBinaryBlockData() noexcept;									// Write the block data held in the buffer to the file
+	void StartBinaryBlockHeader() noexcept;
+#endif
 	bool ProcessConditionalGCode(const StringRef& reply, BlockType skippedBlockType, bool doingFile) THROWS(GCodeException);
 																			// Check for and process a conditional GCode language command returning true if we found one
 	void ProcessIfCommand() THROWS(GCodeException);
@@ -125,6 +133,7 @@ private:
 
 	void SkipWhiteSpace() noexcept;
 	void FindParameters() noexcept;
+	void PreParseParameters() noexcept;
 
 	unsigned int commandStart;							// Index in the buffer of the command letter of this command
 	unsigned int parameterStart;
@@ -135,6 +144,10 @@ private:
 	Bitmap<uint32_t> parametersPresent;					// which parameters are present in this command
 	int readPointer;									// Where in the buffer to read next, or -1
 
+	static constexpr size_t MaxFastParameters = 12;		// the maximum number of parameters in a G0 or G1 command that we pre-parse
+	float fastValues[MaxFastParameters];				// the pre-parsed parameter values of a simple G0 or G1 command, in alphabetical order of letter
+	uint16_t fastOffsets[MaxFastParameters];			// the buffer index of the character after each pre-parsed parameter letter
+
 	FileStore *fileBeingWritten;						// If we are copying GCodes to a file, which file it is
 	FilePosition writingFileSize;						// Size of the file being written, or zero if not known
 
@@ -164,12 +177,35 @@ private:
 	bool warnedAboutMixedSpacesAndTabs;
 	bool overflowed;
 	bool seenExpression;
+	bool hasFastParameters;								// true if the parameters of the current command have been pre-parsed
+	int8_t fastSlot;									// the slot of the pre-parsed parameter found by Seen, or -1
 
 	bool checksumRequired;								// True if we only accept commands with a valid checksum
 	bool crcRequired;									// True if we only accept commands with a valid CRC, except for M409 commands
 	int8_t commandFraction;
 
 	bool binaryWriting;									// Executing gcode or writing binary file?
+
+#if HAS_MASS_STORAGE
+	// Framed binary uploads (M559/M560 B1). Each block is a marker byte, a 16-bit length, the data and the CRC-32 of the data, little-endian.
+	// A block with zero length and no CRC ends the upload. The data is collected in gb.buffer and written to the file in chunks of that size.
+	static constexpr uint8_t BinaryBlockMarker = 0xB5;
+	static constexpr size_t BinaryBlockHeaderLength = 3;
+
+	enum class BinaryBlockState : uint8_t { header, data, crc };
+
+	CRC32 blockCrc;										// CRC of the data in the current block
+	uint32_t blockFieldValue;							// the length or CRC being received
+	uint32_t blocksReceived;
+	uint32_t firstBadBlock;								// the number of the first block with a bad CRC, or 0 if none
+	uint16_t blockBytesLeft;
+	uint16_t blockBytesBuffered;
+	uint8_t blockFieldBytes;							// how many bytes of the header or CRC we have received
+	BinaryBlockState blockState;
+	bool framedBinary;									// true if the binary upload is in framed blocks
+	bool binaryBlocksEnded;								// true if we received the end block
+	bool binaryBlockWriteFailed;
+#endif
 };
 
 #endif /* SRC_GCODES_GCODEBUFFER_STRINGGCODEBUFFER_H */
@@ -8,6 +8,7 @@
 #include "GCodeInput.h"
 
 #include <Platform/RepRap.h>
+#include <Platform/Platform.h>
 #include "GCodes.h"
 #include "GCodeBuffer/GCodeBuffer.h"
 
@@ -252,11 +253,24 @@ bool NetworkGCodeInput::FillBuffer(GCodeBuffer *gb) noexcept /*override*/
 
 // File-based G-code input source
 
+static_assert(FileGCodeInputBufferSize % FileGCodeInputReadAlignment == 0, "FileGCodeInputBufferSize must be a multiple of the read alignment");
+
+FileGCodeInput::FileGCodeInput() noexcept
+	: readingPointer(0), bytesCached(0), primed(false), numReads(0), numUnderruns(0), longestReadTime(0)
+{
+}
+
+void FileGCodeInput::ClearBuffer() noexcept
+{
+	readingPointer = bytesCached = 0;
+	primed = false;
+}
+
 // Reset this input. Should be called when the associated file is being closed
 void FileGCodeInput::Reset() noexcept
 {
 	lastFileRead.Close();
-	RegularGCodeInput::Reset();
+	ClearBuffer();
 }
 
 // Reset this input. Should be called when a specific G-code or macro file is closed outside of the reading context
@@ -268,11 +282,25 @@ void FileGCodeInput::Reset(const FileData &file) noexcept
 	}
 }
 
+size_t FileGCodeInput::BytesCached() const noexcept
+{
+	return bytesCached;
+}
+
+char FileGCodeInput::ReadByte() noexcept
+{
+	const char c = buffer[readingPointer++];
+	if (readingPointer == FileGCodeInputBufferSize)
+	{
+		readingPointer = 0;
+	}
+	--bytesCached;
+	return c;
+}
+
 // Read another chunk of G-codes from the file and return true if more data is available
 GCodeInputReadResult FileGCodeInput::ReadFromFile(FileData &file) noexcept
 {
-	const size_t bytesCached = BytesCached();
-
 	// Keep track of the last file we read from
 	if (lastFileRead.IsLive() && lastFileRead != file)
 	{
@@ -283,37 +311,164 @@ GCodeInputReadResult FileGCodeInput::ReadFromFile(FileData &file) noexcept
 			lastFileRead.Seek(lastFileRead.GetPosition() - bytesCached);
 		}
 
-		RegularGCodeInput::Reset();
+		ClearBuffer();
 	}
 	lastFileRead.CopyFrom(file);
 
-	// Read more from the file
-	if (bytesCached < GCodeInputFileReadThreshold)
+	// Read more from the file if the buffer is empty or at least half of it is free
+	const size_t spaceLeft = FileGCodeInputBufferSize - bytesCached;
+	if (bytesCached == 0 || spaceLeft >= FileGCodeInputBufferSize/2)
 	{
-		// Reset the read+write pointers for better performance if possible
-		if (readingPointer == writingPointer)
+		// Reset the read pointer for better performance if possible
+		if (bytesCached == 0)
 		{
-			readingPointer = writingPointer = 0;
+			readingPointer = 0;
+		}
+
+		// Read as much as will fit contiguously, but end the read at an aligned file position if we can
+		const size_t writingPointer = (readingPointer + bytesCached) % FileGCodeInputBufferSize;
+		size_t bytesToRead = min<size_t>(spaceLeft, FileGCodeInputBufferSize - writingPointer);
+		const size_t excess = (file.GetPosition() + bytesToRead) % FileGCodeInputReadAlignment;
+		if (bytesToRead > excess)
+		{
+			bytesToRead -= excess;
+		}
+
+		const uint32_t startTime = millis();
+		const int bytesRead = file.Read(buffer + writingPointer, bytesToRead);
+		const uint32_t readTime = millis() - startTime;
+		if (readTime > longestReadTime)
+		{
+			longestReadTime = readTime;
 		}
 
-		// The code here used to read into a local buffer in blocks that are multiples of 4 bytes.
-		// However, unless we can use a buffer of at least 512 bytes then that is redundant,
-		// because the data will be copied via the sector buffer in FatFS anyway. So we don't do that any more.
-		const int bytesRead = file.Read(buffer + writingPointer, min<size_t>(BufferSpaceLeft(), GCodeInputBufferSize - writingPointer));
 		if (bytesRead < 0)
 		{
 			return GCodeInputReadResult::error;
 		}
 		if (bytesRead > 0)
 		{
-			writingPointer = (writingPointer + (size_t)bytesRead) % GCodeInputBufferSize;
-			return GCodeInputReadResult::haveData;
+			++numReads;
+			if (bytesCached == 0 && primed)
+			{
+				++numUnderruns;
+			}
+			primed = true;
+			bytesCached += (size_t)bytesRead;
 		}
 	}
 
 	return (bytesCached > 0) ? GCodeInputReadResult::haveData : GCodeInputReadResult::noData;
 }
 
+// Copy the next line from the buffer without consuming it, including the newline, null-terminating it in the destination.
+// Return the number of bytes in the line including the newline, or 0 if we haven't cached the whole of it or it is too long to fit.
+size_t FileGCodeInput::CopyCachedLine(char *dst, size_t maxLength) const noexcept
+{
+	size_t offset = readingPointer;
+	for (size_t i = 0; i < bytesCached && i + 1 < maxLength; ++i)
+	{
+		const char c = buffer[offset];
+		dst[i] = c;
+		if (c == '\n')
+		{
+			dst[i + 1] = 0;
+			return i + 1;
+		}
+		++offset;
+		if (offset == FileGCodeInputBufferSize)
+		{
+			offset = 0;
+		}
+	}
+	return 0;
+}
+
+void FileGCodeInput::Skip(size_t length) noexcept
+{
+	readingPointer = (readingPointer + length) % FileGCodeInputBufferSize;
+	bytesCached -= length;
+}
+
+#if SUPPORT_BINARY_GCODE_FILES
+
+// Check whether a file is a binary G-code file. If it is and the file position is within the header, skip the header; otherwise restore the file position.
+// If the file has the binary header but is a version that we don't support, report an error and position it at the end so that nothing gets executed.
+/*static*/ bool FileGCodeInput::IsBinaryFile(FileData &file) noexcept
+{
+	const FilePosition pos = file.GetPosition();
+	BinaryGCodeFileHeader header;
+	const bool isBinary = file.Seek(0)
+						&& file.Read(reinterpret_cast<char *>(&header), sizeof(header)) == (int)sizeof(header)
+						&& header.magic == BinaryGCodeFileHeader::MagicValue;
+	if (isBinary && header.version != BinaryGCodeFileHeader::CurrentVersion)
+	{
+		reprap.GetPlatform().MessageF(ErrorMessage, "binary G-code file version %u is not supported\n", (unsigned int)header.version);
+		(void)file.Seek(file.Length());
+	}
+	else
+	{
+		(void)file.Seek((isBinary && pos < sizeof(header)) ? sizeof(header) : pos);
+	}
+	return isBinary;
+}
+
+// Copy data out of the buffer without consuming it
+void FileGCodeInput::CopyFromBuffer(void *dst, size_t offset, size_t length) const noexcept
+{
+	const size_t start = (readingPointer + offset) % FileGCodeInputBufferSize;
+	const size_t firstPart = min<size_t>(length, FileGCodeInputBufferSize - start);
+	memcpy(dst, buffer + start, firstPart);
+	memcpy(reinterpret_cast<char *>(dst) + firstPart, buffer, length - firstPart);
+}
+
+// Pass the next binary code to a GCodeBuffer. Return noData if we haven't cached the whole of it yet, or error if the record is invalid.
+GCodeInputReadResult FileGCodeInput::FillBinaryBuffer(GCodeBuffer *gb) noexcept
+{
+	BinaryGCodeRecordHeader recordHeader;
+	if (bytesCached < sizeof(recordHeader))
+	{
+		return GCodeInputReadResult::noData;
+	}
+
+	CopyFromBuffer(&recordHeader, 0, sizeof(recordHeader));
+	const size_t codeLength = recordHeader.length;
+	if (codeLength < sizeof(CodeHeader) || codeLength > MaxCodeBufferSize || codeLength % sizeof(uint32_t) != 0)
+	{
+		return GCodeInputReadResult::error;
+	}
+	if (bytesCached < sizeof(recordHeader) + codeLength)
+	{
+		return GCodeInputReadResult::noData;
+	}
+
+	const FilePosition recordPosition = lastFileRead.GetPosition() - bytesCached;
+	const size_t codeStart = (readingPointer + sizeof(recordHeader)) % FileGCodeInputBufferSize;
+
+	// Records are a whole number of dwords and so is the buffer, so the code is always dword-aligned. Usually it is also contiguous, in which case we can pass it directly.
+	if (codeStart + codeLength <= FileGCodeInputBufferSize)
+	{
+		gb->PutBinaryFromFile(reinterpret_cast<const uint32_t *>(buffer + codeStart), codeLength/sizeof(uint32_t), recordPosition);
+	}
+	else
+	{
+		uint32_t code[MaxCodeBufferSize/sizeof(uint32_t)];
+		CopyFromBuffer(code, sizeof(recordHeader), codeLength);
+		gb->PutBinaryFromFile(code, codeLength/sizeof(uint32_t), recordPosition);
+	}
+	Skip(sizeof(recordHeader) + codeLength);
+	return GCodeInputReadResult::haveData;
+}
+
+#endif
+
+void FileGCodeInput::Diagnostics(MessageType mtype) noexcept
+{
+	reprap.GetPlatform().MessageF(mtype, "File input buffer %u bytes, reads %" PRIu32 ", underruns %" PRIu32 ", longest read %" PRIu32 "ms\n",
+									(unsigned int)FileGCodeInputBufferSize, numReads, numUnderruns, longestReadTime);
+	numReads = numUnderruns = longestReadTime = 0;
+}
+
 #endif
 
 // End
@@ -101,23 +101,76 @@ private:
 
 enum class GCodeInputReadResult : uint8_t { haveData, noData, error };
 
+#if SUPPORT_BINARY_GCODE_FILES
+
+// Binary G-code files start with this header. It is followed by a sequence of records, each consisting of a BinaryGCodeRecordHeader followed by a code
+// in the same format that the SBC uses. The format is described in Developer-documentation/BinaryGCodeFileFormat.md.
+struct BinaryGCodeFileHeader
+{
+	static constexpr uint32_t MagicValue = 0x47465252;			// "RRFG" when stored little-endian
+	static constexpr uint8_t CurrentVersion = 1;
+
+	uint32_t magic;
+	uint8_t version;
+	uint8_t reserved1[3];
+	uint32_t reserved2[2];
+};
+
+static_assert(sizeof(BinaryGCodeFileHeader) == 16, "Header must be 16 bytes");
+
+struct BinaryGCodeRecordHeader
+{
+	uint16_t length;											// the length of the code that follows in bytes, a multiple of 4
+	uint16_t reserved;
+};
+
+static_assert(sizeof(BinaryGCodeRecordHeader) == 4, "Record header must be 4 bytes");
+
+#endif
+
 #if HAS_MASS_STORAGE || HAS_EMBEDDED_FILES
 
-// This class is an expansion of the RegularGCodeInput class to buffer G-codes and to rewind file positions when
-// nested G-code files are started. However buffered codes are not explicitly checked for M112.
-class FileGCodeInput : public RegularGCodeInput
+// This class buffers G-codes read from a file and rewinds the file position when nested G-code files are started. Buffered codes are not checked for M112.
+// The buffer is larger than the buffers used by other inputs and is refilled whenever at least half of it is free, so that the parser consumes one half
+// while the other half is refilled. Reads end on a sector boundary of the file where possible, which allows FatFS to transfer whole sectors directly
+// into the buffer instead of copying them via its sector buffer.
+class FileGCodeInput : public StandardGCodeInput
 {
 public:
 
-	FileGCodeInput() noexcept : RegularGCodeInput() { }
+	FileGCodeInput() noexcept;
 
 	void Reset() noexcept override;								// Clears the buffer. Should be called when the associated file is being closed
 	void Reset(const FileData &file) noexcept;					// Clears the buffer of a specific file. Should be called when it is closed or re-opened outside the reading context
+	size_t BytesCached() const noexcept override;				// How many bytes have been cached?
 
 	GCodeInputReadResult ReadFromFile(FileData &file) noexcept;	// Read another chunk of G-codes from the file and return true if more data is available
+	size_t CopyCachedLine(char *dst, size_t maxLength) const noexcept;	// Copy the next complete line without consuming it and return its length, or 0 if there isn't one
+	void Skip(size_t length) noexcept;							// Discard cached data
+	void Diagnostics(MessageType mtype) noexcept;
+
+#if SUPPORT_BINARY_GCODE_FILES
+	static bool IsBinaryFile(FileData &file) noexcept;			// Check whether a file is a binary G-code file and if so skip the header
+	GCodeInputReadResult FillBinaryBuffer(GCodeBuffer *gb) noexcept;	// Pass the next binary code to a GCodeBuffer
+#endif
+
+protected:
+	char ReadByte() noexcept override;
 
 private:
+	void ClearBuffer() noexcept;
+#if SUPPORT_BINARY_GCODE_FILES
+	void CopyFromBuffer(void *dst, size_t offset, size_t length) const noexcept;
+#endif
+
 	FileData lastFileRead;
+	size_t readingPointer;
+	size_t bytesCached;
+	bool primed;												// true if we have read data from the file since the buffer was last cleared
+	uint32_t numReads;
+	uint32_t numUnderruns;										// how many times we had to read from the file because the buffer ran dry
+	uint32_t longestReadTime;									// the longest time a read took in milliseconds
+	alignas(4) char buffer[FileGCodeInputBufferSize];
 };
 
 #endif
@@ -10,6 +10,35 @@
 
 #include <limits>
 
+unsigned int GCodeMachineState::numInUse = 0;
+unsigned int GCodeMachineState::maxInUse = 0;
+unsigned int GCodeMachineState::numPreallocated = 0;
+uint32_t GCodeMachineState::numAllocations = 0;
+
+// Allocate some machine states and free them again, so that they are on the freelist ready for macro calls and blocks.
+// Doing this at startup means that they are allocated before the heap gets fragmented.
+/*static*/ void GCodeMachineState::Preallocate(unsigned int num) noexcept
+{
+	void *_ecv_array states[PreallocatedMachineStates];
+	num = min<unsigned int>(num, PreallocatedMachineStates);
+	for (unsigned int i = 0; i < num; ++i)
+	{
+		states[i] = FreelistManager::Allocate<GCodeMachineState>();
+	}
+	for (unsigned int i = 0; i < num; ++i)
+	{
+		FreelistManager::Release<GCodeMachineState>(states[i]);
+	}
+	numPreallocated += num;
+}
+
+/*static*/ void GCodeMachineState::Diagnostics(MessageType mtype) noexcept
+{
+	const unsigned int numFromHeap = max<unsigned int>(maxInUse, numPreallocated);
+	reprap.GetPlatform().MessageF(mtype, "Machine states in use %u, max %u, allocated %u, created %" PRIu32 ", reused %" PRIu32 "\n",
+									numInUse, maxInUse, numFromHeap, numAllocations, numAllocations - min<uint32_t>(numAllocations, numFromHeap));
+}
+
 // Create a default initialised GCodeMachineState
 GCodeMachineState::GCodeMachineState() noexcept
 	: feedRate(ConvertSpeedFromMmPerMin(DefaultFeedRate)),
@@ -21,6 +50,9 @@ GCodeMachineState::GCodeMachineState() noexcept
 	  doingFileMacro(false), waitWhileCooling(false), runningM501(false), runningM502(false),
 	  volumetricExtrusion(false), g53Active(false), runningSystemMacro(false), usingInches(false),
 	  waitingForAcknowledgement(false), messageAcknowledged(false), localPush(false), macroRestartable(false), firstCommandAfterRestart(false), commandRepeated(false),
+#if SUPPORT_BINARY_GCODE_FILES
+	  binaryFile(false),
+#endif
 #if HAS_SBC_INTERFACE
 	  lastCodeFromSbc(false), macroStartedByCode(false), fileFinished(false),
 #endif
@@ -46,6 +78,9 @@ GCodeMachineState::GCodeMachineState(GCodeMachineState& prev, bool withinSameFil
 	  doingFileMacro(prev.doingFileMacro), waitWhileCooling(prev.waitWhileCooling), runningM501(prev.runningM501), runningM502(prev.runningM502),
 	  volumetricExtrusion(false), g53Active(false), runningSystemMacro(prev.runningSystemMacro), usingInches(prev.usingInches),
 	  waitingForAcknowledgement(false), messageAcknowledged(false), localPush(withinSameFile), firstCommandAfterRestart(prev.firstCommandAfterRestart), commandRepeated(false),
+#if SUPPORT_BINARY_GCODE_FILES
+	  binaryFile(prev.binaryFile),
+#endif
 #if HAS_SBC_INTERFACE
 	  lastCodeFromSbc(prev.lastCodeFromSbc), macroStartedByCode(prev.macroStartedByCode), fileFinished(prev.fileFinished),
 #endif
@@ -151,6 +186,9 @@ void GCodeMachineState::CloseFile() noexcept
 	{
 #if HAS_MASS_STORAGE || HAS_EMBEDDED_FILES
 		fileState.Close();
+#endif
+#if SUPPORT_BINARY_GCODE_FILES
+		binaryFile = false;
 #endif
 	}
 }
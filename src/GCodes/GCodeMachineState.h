@@ -85,6 +85,14 @@ enum class GCodeState : uint8_t
 	gridProbing5,
 	gridProbing6,
 	gridProbing7,
+	gridProbingChangeProbe,
+
+	// These next 5 must be contiguous
+	gridScanning1,
+	gridScanning2,
+	gridScanning3,
+	gridScanning4,
+	gridScanning5,
 
 	// These next 10 must be contiguous
 	probingAtPoint0,
@@ -116,6 +124,7 @@ enum class GCodeState : uint8_t
 #if HAS_MASS_STORAGE
 	timingSDwrite,
 	timingSDread,
+	timingSDlatency,
 #endif
 
 #if HAS_SBC_INTERFACE
@@ -179,7 +188,21 @@ public:
 		BlockType blockType;										// the type of this block
 	};
 
-	DECLARE_FREELIST_NEW_DELETE(GCodeMachineState)
+	// Machine states are kept on a freelist when they are deleted, so the heap is only used when more are in use than ever before.
+	// They are only created and deleted by the GCodes task, so the counts don't need to be atomic.
+	void* operator new(size_t sz) noexcept
+	{
+		++numAllocations;
+		if (++numInUse > maxInUse)
+		{
+			maxInUse = numInUse;
+		}
+		return FreelistManager::Allocate<GCodeMachineState>();
+	}
+	void operator delete(void* p) noexcept { --numInUse; FreelistManager::Release<GCodeMachineState>(p); }
+
+	static void Preallocate(unsigned int num) noexcept;				// put some machine states on the freelist
+	static void Diagnostics(MessageType mtype) noexcept;
 
 	GCodeMachineState() noexcept;
 	GCodeMachineState(GCodeMachineState&, bool withinSameFile) noexcept;	// this chains the new one to the previous one
@@ -231,6 +254,9 @@ public:
 		macroRestartable : 1,					// true if the current macro has used M98 R1 to say that it can be interrupted and restarted
 		firstCommandAfterRestart : 1,			// true if this is the first command after restarting a macro that was interrupted
 		commandRepeated : 1						// true if the current command is being repeated because it returned GCodeResult::notFinished the first time
+#if SUPPORT_BINARY_GCODE_FILES
+		, binaryFile : 1						// true if fileState is a binary G-code file
+#endif
 #if HAS_SBC_INTERFACE
 		, lastCodeFromSbc : 1,
 		macroStartedByCode : 1,
@@ -274,6 +300,11 @@ private:
 	uint8_t blockNesting;
 	GCodeState state;
 	GCodeResult stateMachineResult;				// the worst status (ok, warning or error) that we encountered while running the state machine
+
+	static unsigned int numInUse;				// how many machine states exist
+	static unsigned int maxInUse;				// the most that have existed at the same time, which is how many have been allocated from the heap unless more were preallocated
+	static unsigned int numPreallocated;
+	static uint32_t numAllocations;				// how many times a machine state has been created
 };
 
 #endif /* SRC_GCODES_GCODEMACHINESTATE_H_ */
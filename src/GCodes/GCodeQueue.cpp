@@ -12,15 +12,30 @@
 #include "GCodeBuffer/GCodeBuffer.h"
 #include <Movement/Move.h>
 #include <Fans/LedStripDriver.h>
+#include <Platform/Tasks.h>
 
 // GCodeQueue class
 
-GCodeQueue::GCodeQueue() noexcept : freeItems(nullptr), queuedItems(nullptr)
+GCodeQueue::GCodeQueue() noexcept
+	: freeItems(nullptr), queuedItems(nullptr), lastQueuedItem(nullptr), numItems(0), numQueued(0), maxQueued(0), timesFull(0)
 {
 	for (size_t i = 0; i < maxQueuedCodes; i++)
 	{
 		freeItems = new QueuedCode(freeItems);
 	}
+	numItems = maxQueuedCodes;
+}
+
+// Allocate another queue item if we haven't reached the limit and enough never-used RAM would remain. Returns true if we created one.
+bool GCodeQueue::AddFreeItem() noexcept
+{
+	if (numItems >= MaxQueuedCodesLimit || Tasks::GetNeverUsedRam() < (ptrdiff_t)(MinFreeRamForPoolGrowth + sizeof(QueuedCode)))
+	{
+		return false;
+	}
+	freeItems = new QueuedCode(freeItems);
+	++numItems;
+	return true;
 }
 
 // Return true if the move in the GCodeBuffer should be queued. Caller has already checked that the command does not contain an expression.
@@ -117,12 +132,13 @@ GCodeQueue::GCodeQueue() noexcept : freeItems(nullptr), queuedItems(nullptr)
 
 // Try to queue the command in the passed GCodeBuffer.
 // If successful, return true to indicate it has been queued.
-// If the queue is full, return false. Caller will wait for space to become available.
+// If the queue is full and we can't extend it, return false. Caller will wait for space to become available.
 bool GCodeQueue::QueueCode(GCodeBuffer &gb, uint32_t scheduleAt) noexcept
 {
 	// Can we queue this code somewhere?
-	if (freeItems == nullptr)
+	if (freeItems == nullptr && !AddFreeItem())
 	{
+		++timesFull;
 		return false;
 	}
 
@@ -133,21 +149,22 @@ bool GCodeQueue::QueueCode(GCodeBuffer &gb, uint32_t scheduleAt) noexcept
 	code->executeAtMove = scheduleAt;
 	code->next = nullptr;
 
-	// Append it to the list of queued codes
+	// Append it to the list of queued codes. The move numbers never decrease, so the list stays in order of when the codes are due.
 	if (queuedItems == nullptr)
 	{
 		queuedItems = code;
 	}
 	else
 	{
-		QueuedCode *last = queuedItems;
-		while (last->Next() != nullptr)
-		{
-			last = last->Next();
-		}
-		last->next = code;
+		lastQueuedItem->next = code;
 	}
+	lastQueuedItem = code;
 
+	++numQueued;
+	if (numQueued > maxQueued)
+	{
+		maxQueued = numQueued;
+	}
 	return true;
 }
 
@@ -166,8 +183,13 @@ bool GCodeQueue::FillBuffer(GCodeBuffer *gb) noexcept
 
 	// Release this item again
 	queuedItems = queuedItems->next;
+	if (queuedItems == nullptr)
+	{
+		lastQueuedItem = nullptr;
+	}
 	code->next = freeItems;
 	freeItems = code;
+	--numQueued;
 	return true;
 }
 
@@ -201,6 +223,7 @@ void GCodeQueue::PurgeEntries() noexcept
 			QueuedCode *nextItem = item->Next();
 			item->next = freeItems;
 			freeItems = item;
+			--numQueued;
 
 			// Unlink it from the list
 			if (lastItem == nullptr)
@@ -219,6 +242,7 @@ void GCodeQueue::PurgeEntries() noexcept
 			item = item->Next();
 		}
 	}
+	lastQueuedItem = lastItem;
 }
 
 void GCodeQueue::Clear() noexcept
@@ -230,10 +254,17 @@ void GCodeQueue::Clear() noexcept
 		item->next = freeItems;
 		freeItems = item;
 	}
+	lastQueuedItem = nullptr;
+	numQueued = 0;
 }
 
 void GCodeQueue::Diagnostics(MessageType mtype) noexcept
 {
+	reprap.GetPlatform().MessageF(mtype, "Code queue size %u, queued %u, max queued %u, times full %" PRIu32 "\n",
+									(unsigned int)numItems, (unsigned int)numQueued, (unsigned int)maxQueued, timesFull);
+	maxQueued = numQueued;
+	timesFull = 0;
+
 	if (queuedItems == nullptr)
 	{
 		reprap.GetPlatform().Message(mtype, "Code queue is empty\n");
@@ -243,10 +274,10 @@ void GCodeQueue::Diagnostics(MessageType mtype) noexcept
 		const QueuedCode *item = queuedItems;
 		do
 		{
-#if HAS_SBC_INTERFACE
-			// The following may output binary gibberish if this code is stored in binary.
+#if HAS_BINARY_PARSER
+			// The following would output binary gibberish if this code is stored in binary.
 			// We could restore this message by using GCodeBuffer::AppendFullCommand but there is probably no need to
-			if (!reprap.UsingSbcInterface())
+			if (!item->isBinary)
 #endif
 			{
 				reprap.GetPlatform().MessageF(mtype, "Queued '%.*s' for move %" PRIu32 "\n", item->dataLength, item->data, item->executeAtMove);
@@ -259,7 +290,7 @@ void GCodeQueue::Diagnostics(MessageType mtype) noexcept
 
 void QueuedCode::AssignFrom(GCodeBuffer &gb) noexcept
 {
-#if HAS_SBC_INTERFACE
+#if HAS_BINARY_PARSER
 	isBinary = gb.IsBinary();
 #endif
 	dataLength = min<size_t>(gb.DataLength(), sizeof(data));
@@ -268,11 +299,21 @@ void QueuedCode::AssignFrom(GCodeBuffer &gb) noexcept
 
 void QueuedCode::AssignTo(GCodeBuffer *gb) noexcept
 {
-#if HAS_SBC_INTERFACE
+#if HAS_BINARY_PARSER
 	if (isBinary)
 	{
 		// Note that the data has to remain on a 4-byte boundary for this to work
-		gb->PutBinary(reinterpret_cast<const uint32_t *>(data), dataLength / sizeof(uint32_t));
+		const uint32_t * const binaryData = reinterpret_cast<const uint32_t *>(data);
+# if HAS_SBC_INTERFACE
+		if (reprap.UsingSbcInterface())
+		{
+			gb->PutBinary(binaryData, dataLength / sizeof(uint32_t));
+			return;
+		}
+# endif
+# if SUPPORT_BINARY_GCODE_FILES
+		gb->PutBinaryFromFile(binaryData, dataLength / sizeof(uint32_t), noFilePosition);	// the code came from a local binary G-code file
+# endif
 	}
 	else
 #endif
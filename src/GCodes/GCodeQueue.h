@@ -33,8 +33,15 @@ public:
 	static bool ShouldQueueCode(GCodeBuffer &gb) THROWS(GCodeException);	// Return true if this code should be queued
 
 private:
+	bool AddFreeItem() noexcept;
+
 	QueuedCode *freeItems;
-	QueuedCode *queuedItems;
+	QueuedCode *queuedItems;								// queued codes in the order they were queued, which is also the order of their move numbers
+	QueuedCode *lastQueuedItem;								// the tail of queuedItems, so that we can append in constant time
+	size_t numItems;										// how many items we have allocated
+	size_t numQueued;										// how many of them are in queuedItems
+	size_t maxQueued;										// the most that have been queued at once since the last diagnostics report
+	uint32_t timesFull;										// how often a code had to wait because the queue was full and couldn't grow
 };
 
 class QueuedCode
@@ -48,7 +55,7 @@ public:
 private:
 	QueuedCode *next;
 
-#if HAS_SBC_INTERFACE
+#if HAS_BINARY_PARSER
 	bool isBinary;
 	alignas(4) char data[BufferSizePerQueueItem];
 #else
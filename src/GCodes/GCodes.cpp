@@ -26,6 +26,7 @@
 #include "GCodes.h"
 
 #include "GCodeBuffer/GCodeBuffer.h"
+#include "GCodeBuffer/ExpressionCache.h"
 #include "GCodeQueue.h"
 #include <Heating/Heat.h>
 #include <Platform/Platform.h>
@@ -75,7 +76,7 @@ GCodes::GCodes(Platform& p) noexcept :
 #endif
 	lastWarningMillis(0)
 #if HAS_MASS_STORAGE
-	, sdTimingFile(nullptr)
+	, sdTimingFile(nullptr), timingReadBuffer(nullptr), timingLatencyCounts(nullptr)
 #endif
 {
 #if HAS_MASS_STORAGE || HAS_EMBEDDED_FILES
@@ -157,6 +158,7 @@ void GCodes::Exit() noexcept
 
 void GCodes::Init() noexcept
 {
+	GCodeMachineState::Preallocate(PreallocatedMachineStates);
 	numVisibleAxes = numTotalAxes = XYZ_AXES;			// must set this up before calling Reset()
 	memset(axisLetters, 0, sizeof(axisLetters));
 	axisLetters[0] = 'X';
@@ -183,6 +185,10 @@ void GCodes::Init() noexcept
 	lastDefaultFanSpeed = 0.0;
 
 	lastAuxStatusReportType = -1;						// no status reports requested yet
+	usbLinesToAcknowledge = 0;
+#if SUPPORT_RESUME_SNAPSHOT
+	lastResumeSnapshotMillis = 0;
+#endif
 
 	laserMaxPower = DefaultMaxLaserPower;
 	laserPowerSticky = false;
@@ -279,6 +285,9 @@ void GCodes::Reset() noexcept
 		tr.Init();
 	}
 	triggersPending.Clear();
+	triggersFromIsr = 0;
+	maxTriggerLatency = 0;
+	numIsrTriggers = 0;
 
 	simulationMode = SimulationMode::off;
 	exitSimulationWhenFileComplete = updateFileWhenSimulationComplete = false;
@@ -403,6 +412,9 @@ void GCodes::CheckFinishedRunningConfigFile(GCodeBuffer& gb) noexcept
 				}
 			}
 			runningConfigFile = false;
+#if SUPPORT_STARTUP_PROFILE
+			startupProfiler.Finished();
+#endif
 		}
 		reprap.InputsUpdated();
 	}
@@ -416,6 +428,26 @@ void GCodes::InitialiseTaps(bool fastThenSlow) noexcept
 	g30zHeightErrorLowestDiff = 1000.0;
 }
 
+// Return the height to raise the probe to after a tap. If we are sure to tap again at the same point and a shorter dive height between taps
+// has been configured, raise the probe only by that amount above where it stopped, otherwise raise it to the normal dive height.
+// This is called after tapsDone has been incremented and the height error of this tap has been stored, but before deciding whether to accept it.
+float GCodes::GetLiftHeightAfterTap(const ZProbe& zp) const noexcept
+{
+	if (zp.HasShortRetap() && !hadProbingError && tapsDone < (int)zp.GetMaxTaps())
+	{
+		// We can't accept the reading before we have done two slow taps unless we only do one tap, and then we must have just done the fast tap.
+		// After that we accept it if it agrees with the previous one to within the tolerance, or if this is the last tap.
+		const bool anotherTapNeeded = tapsDone < 2
+									|| zp.GetTolerance() <= 0.0
+									|| min<float>(g30zHeightErrorLowestDiff, fabsf(g30zHeightError - g30PrevHeightError)) > zp.GetTolerance();
+		if (anotherTapNeeded)
+		{
+			return min<float>(moveState.coords[Z_AXIS] + zp.GetRetapHeight(), zp.GetStartingHeight());
+		}
+	}
+	return zp.GetStartingHeight();
+}
+
 void GCodes::Spin() noexcept
 {
 	if (!active)
@@ -465,6 +497,38 @@ void GCodes::Spin() noexcept
 		}
 	} while (nextGcodeSource != originalNextGCodeSource);
 
+#if SUPPORT_TOOL_PREHEAT
+	{
+		const bool printingTextFile = simulationMode == SimulationMode::off && fileGCode->OriginalMachineState().fileState.IsLive()
+# if SUPPORT_BINARY_GCODE_FILES
+										&& !fileGCode->OriginalMachineState().binaryFile
+# endif
+										;
+		toolPreheater.Spin((printingTextFile) ? reprap.GetPrintMonitor().GetPrintingFilename() : nullptr, GetFilePosition(true));
+	}
+#endif
+
+#if SUPPORT_RESUME_SNAPSHOT
+	if (resumeSnapshot.IsActive() && millis() - lastResumeSnapshotMillis >= ResumeSnapshotIntervalMillis)
+	{
+		UpdateResumeSnapshot();
+	}
+#endif
+
+	// In USB streaming mode, acknowledge the lines we have completed if we have run out of input, because the host may be waiting for credit
+	if (usbLinesToAcknowledge != 0 && usbGCode->GetNormalInput() != nullptr && usbGCode->GetNormalInput()->BytesCached() == 0)
+	{
+		SendUsbStreamingAcknowledgement();
+	}
+
+	// When simulating a file we don't need to wait for the moves to execute, so the time taken is mostly spent going round the main loop.
+	// So keep executing commands from the file for a while, as long as we are making progress.
+	if (simulationMode == SimulationMode::normal && fileGCode != nullptr && fileGCode->IsDoingFile())
+	{
+		const uint32_t burstStartTime = millis();
+		while (millis() - burstStartTime < SimulationFileBurstMillis && fileGCode->GetState() == GCodeState::normal && SpinGCodeBuffer(*fileGCode)) { }
+	}
+
 
 #if HAS_SBC_INTERFACE
 	// Need to check if the print has been stopped by the SBC
@@ -559,6 +623,12 @@ bool GCodes::StartNextGCode(GCodeBuffer& gb, const StringRef& reply) noexcept
 	}
 	else if (gb.IsReady() || gb.IsExecuting())
 	{
+#if SUPPORT_STARTUP_PROFILE
+		if (runningConfigFile && &gb == triggerGCode && gb.IsReady())
+		{
+			startupProfiler.CommandStarted(gb);
+		}
+#endif
 		gb.SetFinished(ActOnCode(gb, reply));
 		return true;
 	}
@@ -695,6 +765,39 @@ bool GCodes::DoFilePrint(GCodeBuffer& gb, const StringRef& reply) noexcept
 		switch (gb.GetFileInput()->ReadFromFile(fd))
 		{
 		case GCodeInputReadResult::haveData:
+#if SUPPORT_BINARY_GCODE_FILES
+			if (gb.LatestMachineState().binaryFile)
+			{
+				// Binary files contain no meta commands and each record holds exactly one code, so we can decode and execute it directly
+				switch (gb.GetFileInput()->FillBinaryBuffer(&gb))
+				{
+				case GCodeInputReadResult::haveData:
+					gb.DecodeCommand();
+					if (gb.IsReady())
+					{
+						gb.SetFinished(ActOnCode(gb, reply));
+					}
+					return true;
+
+				case GCodeInputReadResult::noData:
+					if (fd.GetPosition() < fd.Length())
+					{
+						return true;					// we need to read more of the file to get the whole of the next code
+					}
+					// The file ends part way through a record
+					// no break
+				case GCodeInputReadResult::error:
+				default:
+					platform.Message(ErrorMessage, "invalid record in binary G-code file\n");
+					AbortPrint(gb);
+					return true;
+				}
+			}
+#endif
+			if (buildObjects.IsCurrentObjectCancelled())
+			{
+				SkipCancelledMoves(gb);
+			}
 			if (gb.GetFileInput()->FillBuffer(&gb))
 			{
 				bool done;
@@ -799,6 +902,195 @@ bool GCodes::DoFilePrint(GCodeBuffer& gb, const StringRef& reply) noexcept
 	return false;
 }
 
+#if HAS_MASS_STORAGE || HAS_EMBEDDED_FILES
+
+// The current object has been cancelled, so skip any plain G0/G1 moves at the start of the file input buffer without passing them to the parser.
+// Moves of cancelled objects are not executed, so all we need to do is to track the user position, extruder position, feed rate and line number
+// in the same way that DoStraightMove would, so that pausing, resuming and the travel move to the start of the next object behave as before.
+// Any other line, such as a comment, an M486 command or a move with an expression in it, stops the skipping and is left for the parser.
+void GCodes::SkipCancelledMoves(GCodeBuffer& gb) noexcept
+{
+	if (   &gb != fileGCode
+		|| gb.IsDoingFileMacro()
+		|| machineType != MachineType::fff
+		|| moveFractionToSkip != 0.0
+		|| gb.CurrentFileMachineState().GetBlockNesting() != 0				// a line that isn't indented would end the block, so leave it to the parser
+		|| !gb.IsAtLineStart()
+	   )
+	{
+		return;
+	}
+
+	FileGCodeInput * const input = gb.GetFileInput();
+	AxesBitmap axesMoved;
+	char line[MaxSkippedMoveLineLength];
+	size_t length;
+	while ((length = input->CopyCachedLine(line, sizeof(line))) != 0 && SkipCancelledMove(gb, line, axesMoved))
+	{
+		input->Skip(length);
+		++gb.CurrentFileMachineState().lineNumber;
+	}
+
+	if (axesMoved.IsNonEmpty())
+	{
+		// Update the machine coordinates as DoStraightMove would have done for the last move
+#if SUPPORT_COORDINATE_ROTATION
+		if (g68Angle != 0.0 && gb.DoingCoordinateRotation())
+		{
+			float coords[MaxAxes];
+			memcpyf(coords, moveState.currentUserPosition, MaxAxes);
+			RotateCoordinates(g68Angle, coords);
+			ToolOffsetTransform(coords, moveState.coords, axesMoved);
+		}
+		else
+#endif
+		{
+			ToolOffsetTransform(moveState.currentUserPosition, moveState.coords, axesMoved);
+		}
+	}
+}
+
+// Skip a line of a cancelled object if it is blank or is a G0/G1 command with only plain numbers for the axis, extrusion and feed rate parameters.
+// Return true if we skipped it, having added any axes it moved to axesMoved. The line includes the terminating newline.
+bool GCodes::SkipCancelledMove(GCodeBuffer& gb, const char *_ecv_array line, AxesBitmap& axesMoved) noexcept
+{
+	const char *_ecv_array p = line;
+	if (*p == '\r' || *p == '\n')
+	{
+		return true;														// blank line
+	}
+	if (*p != 'G' || (p[1] != '0' && p[1] != '1') || isDigit(p[2]) || p[2] == '.')
+	{
+		return false;
+	}
+	p += 2;
+
+	float axisValues[MaxAxes];
+	AxesBitmap axesSeen;
+	float eValue = 0.0, fValue = 0.0;
+	bool seenE = false, seenF = false;
+	for (;;)
+	{
+		while (*p == ' ' || *p == '\t')
+		{
+			++p;
+		}
+		const char c = *p;
+		if (c == '\r' || c == '\n' || c == ';')
+		{
+			break;
+		}
+
+		const char *_ecv_array endptr;
+		const float val = SafeStrtof(p + 1, &endptr);
+		if (endptr == p + 1)
+		{
+			return false;													// not a plain number, e.g. an expression or a quoted string
+		}
+		p = endptr;
+
+		if (c == extrudeLetter)
+		{
+			if (seenE)
+			{
+				return false;
+			}
+			seenE = true;
+			eValue = val;
+		}
+		else if (c == feedrateLetter)
+		{
+			if (seenF)
+			{
+				return false;
+			}
+			seenF = true;
+			fValue = val;
+		}
+		else
+		{
+			const char *_ecv_array const letterPtr = (c >= 'A' && c <= 'Z') ? strchr(axisLetters, c) : nullptr;
+			if (letterPtr == nullptr)
+			{
+				return false;												// some other parameter, e.g. H or R
+			}
+			const size_t axis = letterPtr - axisLetters;
+			if (axis >= numVisibleAxes || axesSeen.IsBitSet(axis))
+			{
+				return false;
+			}
+			axesSeen.SetBit(axis);
+			axisValues[axis] = val;
+		}
+	}
+
+	Tool * const tool = reprap.GetCurrentTool();
+	if (seenE && tool == nullptr)
+	{
+		return false;														// let the parser report the missing tool
+	}
+
+	// The line is a move that we can skip, so update the state in the same way that DoStraightMove and LoadExtrusionAndFeedrateFromGCode do
+	if (seenF)
+	{
+		gb.LatestMachineState().feedRate = gb.ConvertSpeed(fValue);
+	}
+
+	axesSeen.Iterate([this, &gb, &axisValues, &axesMoved](unsigned int axis, unsigned int) noexcept
+						{
+							const float moveArg = gb.ConvertDistance(axisValues[axis]);
+							if (gb.LatestMachineState().axesRelative)
+							{
+								moveState.currentUserPosition[axis] += moveArg;
+							}
+							else
+							{
+								moveState.currentUserPosition[axis] = moveArg + GetWorkplaceOffset(axis);
+							}
+							axesMoved.SetBit(axis);
+						}
+					);
+
+	if (seenE && tool->DriveCount() != 0)
+	{
+		const float moveArg = gb.ConvertDistance(eValue);
+		float requestedExtrusionAmount;
+		if (gb.LatestMachineState().drivesRelative)
+		{
+			requestedExtrusionAmount = moveArg;
+		}
+		else
+		{
+			requestedExtrusionAmount = moveArg - virtualExtruderPosition;
+			virtualExtruderPosition = moveArg;
+		}
+
+		// Keep the print progress figures the same as if we had parsed the move
+		rawExtruderTotal += requestedExtrusionAmount;
+		const float thisMix = tool->GetMix()[0];
+		if (thisMix != 0.0)
+		{
+			const int extruder = tool->GetDrive(0);
+			float extrusionAmount = requestedExtrusionAmount * thisMix;
+			if (gb.LatestMachineState().volumetricExtrusion)
+			{
+				extrusionAmount *= volumetricExtrusionFactors[extruder];
+			}
+			rawExtruderTotalByDrive[extruder] += extrusionAmount;
+		}
+
+#if TRACK_OBJECT_NAMES
+		if (requestedExtrusionAmount > 0.0 && axesSeen.IsNonEmpty())
+		{
+			buildObjects.UpdateObjectCoordinates(moveState.currentUserPosition, axesSeen);
+		}
+#endif
+	}
+	return true;
+}
+
+#endif
+
 // Restore positions etc. when exiting simulation mode
 void GCodes::EndSimulation(GCodeBuffer *gb) noexcept
 {
@@ -811,17 +1103,66 @@ void GCodes::EndSimulation(GCodeBuffer *gb) noexcept
 	reprap.MoveUpdated();
 }
 
+// Called from the pin change interrupt when the state of an interrupt-driven GpIn port changes.
+// We can't execute trigger macros here, but for an emergency stop trigger we disable the local drivers and heaters straight away
+// rather than waiting for the main loop to get round to CheckTriggers, which may take a long time if it is busy.
+void GCodes::GpInputChangedFromISR(unsigned int gpinNumber, bool newState) noexcept
+{
+	uint32_t fired = 0;
+	for (unsigned int i = 0; i < MaxTriggers; ++i)
+	{
+		if (triggers[i].CheckInputEdgeFromISR(gpinNumber, newState))
+		{
+			fired |= 1u << i;
+		}
+	}
+
+	if (fired != 0)
+	{
+		if ((fired & 1u) != 0)
+		{
+			reprap.GetHeat().SwitchOffAllLocalFromISR();
+			platform.EmergencyDisableDrivers();
+		}
+		if (triggersFromIsr == 0)
+		{
+			whenIsrTriggered = StepTimer::GetTimerTicks();
+		}
+		triggersFromIsr = triggersFromIsr | fired;
+	}
+}
+
 // Check for and execute triggers
 void GCodes::CheckTriggers() noexcept
 {
+	// Poll the triggers. Inputs that are interrupt-driven are handled by GpInputChangedFromISR instead, so that we don't see their edges twice.
 	for (unsigned int i = 0; i < MaxTriggers; ++i)
 	{
-		if (!triggersPending.IsBitSet(i) && triggers[i].Check())
+		if (!triggersPending.IsBitSet(i) && triggers[i].Check(false))
 		{
 			triggersPending.SetBit(i);
 		}
 	}
 
+	// Collect any triggers fired by input interrupts
+	if (triggersFromIsr != 0)
+	{
+		uint32_t fired, whenFired;
+		{
+			AtomicCriticalSectionLocker lock;
+			fired = triggersFromIsr;
+			whenFired = whenIsrTriggered;
+			triggersFromIsr = 0;
+		}
+		triggersPending |= TriggerNumbersBitmap::MakeFromRaw(fired);
+		const uint32_t latency = StepTimer::GetTimerTicks() - whenFired;
+		if (latency > maxTriggerLatency)
+		{
+			maxTriggerLatency = latency;
+		}
+		++numIsrTriggers;
+	}
+
 	// If any triggers are pending, activate the one with the lowest number
 	if (triggersPending.IsNonEmpty())
 	{
@@ -1024,6 +1365,18 @@ bool GCodes::IsReallyPrintingOrResuming() const noexcept
 	return reprap.GetPrintMonitor().IsPrinting() && (pauseState == PauseState::notPaused || pauseState == PauseState::resuming);
 }
 
+#if HAS_MASS_STORAGE || HAS_EMBEDDED_FILES
+
+// Return true if we are printing and the buffered data from the print file is running low.
+// This is called by other tasks so that they can give way to reads from the print file when they want to access the SD card.
+bool GCodes::IsPrintFileInputLow() const noexcept
+{
+	const FileGCodeInput * const fileInput = fileGCode->GetFileInput();
+	return fileInput != nullptr && IsReallyPrinting() && fileInput->BytesCached() < FileGCodeInputBufferSize/4;
+}
+
+#endif
+
 // Return true if the SD card print is waiting for a heater to reach temperature
 bool GCodes::IsHeatingUp() const noexcept
 {
@@ -1156,6 +1509,10 @@ bool GCodes::LowVoltagePause() noexcept
 			return false;
 		}
 
+#if SUPPORT_RESUME_SNAPSHOT
+		SaveResumeSnapshot(pauseRestorePoint, ResumeSnapshotKind::powerFailure);	// this is a single small write, so it is done even if power runs out before resurrect.g is written
+#endif
+
 		// Run the auto-pause script
 		if (powerFailScript != nullptr)
 		{
@@ -1320,60 +1677,7 @@ void GCodes::SaveResumeInfo(bool wasPowerFailure) noexcept
 			}
 			if (ok)
 			{
-				const unsigned int selectedPlane = fileGCode->OriginalMachineState().selectedPlane;
-				buf.printf("G%u\nM23 \"%s\"\nM26 S%" PRIu32, selectedPlane + 17, printingFilename, pauseRestorePoint.filePos);
-				if (pauseRestorePoint.proportionDone > 0.0)
-				{
-					buf.catf(" P%.3f %c%.3f %c%.3f",
-							(double)pauseRestorePoint.proportionDone,
-							(selectedPlane == 2) ? 'Y' : 'X', (double)pauseRestorePoint.initialUserC0,
-							(selectedPlane == 0) ? 'Y' : 'Z', (double)pauseRestorePoint.initialUserC1);
-				}
-				buf.cat('\n');
-				ok = f->Write(buf.c_str());									// write G17/18/19, filename and file position, and if necessary proportion done and initial XY position
-			}
-			if (ok)
-			{
-				// Build the commands to restore the head position. These assume that we are working in mm.
-				// Start with a vertical move to 2mm above the final Z position
-				buf.printf("G0 F6000 Z%.3f\n", (double)(pauseRestorePoint.moveCoords[Z_AXIS] + 2.0));
-
-				// Now set all the other axes
-				buf.cat("G0 F6000");
-				for (size_t axis = 0; axis < numVisibleAxes; ++axis)
-				{
-					if (axis != Z_AXIS)
-					{
-						buf.catf(" %c%.3f", axisLetters[axis], (double)pauseRestorePoint.moveCoords[axis]);
-					}
-				}
-
-				// Now move down to the correct Z height
-				buf.catf("\nG0 F6000 Z%.3f\n", (double)pauseRestorePoint.moveCoords[Z_AXIS]);
-
-				// Set the feed rate
-				buf.catf("G1 F%.1f", (double)InverseConvertSpeedToMmPerMin(pauseRestorePoint.feedRate));
-#if SUPPORT_LASER
-				if (machineType == MachineType::laser)
-				{
-					buf.catf(" S%u", (unsigned int)pauseRestorePoint.laserPwmOrIoBits.laserPwm);
-				}
-				else
-				{
-#endif
-#if SUPPORT_IOBITS
-					buf.catf(" P%u", (unsigned int)pauseRestorePoint.laserPwmOrIoBits.ioBits);
-#endif
-#if SUPPORT_LASER
-				}
-#endif
-				buf.cat("\n");
-				ok = f->Write(buf.c_str());									// restore feed rate and output bits or laser power
-			}
-			if (ok)
-			{
-				buf.printf("%s\nM24\n", (fileGCode->OriginalMachineState().usingInches) ? "G20" : "G21");
-				ok = f->Write(buf.c_str());									// restore inches/mm and resume printing
+				ok = WriteResumePosition(f, printingFilename, pauseRestorePoint, fileGCode->OriginalMachineState().selectedPlane, fileGCode->OriginalMachineState().usingInches);
 			}
 			if (!f->Close())
 			{
@@ -1381,6 +1685,9 @@ void GCodes::SaveResumeInfo(bool wasPowerFailure) noexcept
 			}
 			if (ok)
 			{
+#if SUPPORT_RESUME_SNAPSHOT
+				resumeSnapshot.Supersede();									// resurrect.g is now more recent than the snapshot
+#endif
 				platform.Message(LoggedGenericMessage, "Resume state saved\n");
 			}
 			else
@@ -1392,6 +1699,312 @@ void GCodes::SaveResumeInfo(bool wasPowerFailure) noexcept
 	}
 }
 
+// Write the commands that select the print file and the position in it, restore the head position and feed rate, and resume printing
+bool GCodes::WriteResumePosition(FileStore *f, const char *_ecv_array printingFilename, const RestorePoint& rp, unsigned int selectedPlane, bool usingInches) const noexcept
+{
+	String<StringLength256> buf;
+	buf.printf("G%u\nM23 \"%s\"\nM26 S%" PRIu32, selectedPlane + 17, printingFilename, rp.filePos);
+	if (rp.proportionDone > 0.0)
+	{
+		buf.catf(" P%.3f %c%.3f %c%.3f",
+				(double)rp.proportionDone,
+				(selectedPlane == 2) ? 'Y' : 'X', (double)rp.initialUserC0,
+				(selectedPlane == 0) ? 'Y' : 'Z', (double)rp.initialUserC1);
+	}
+	buf.cat('\n');
+	bool ok = f->Write(buf.c_str());										// write G17/18/19, filename and file position, and if necessary proportion done and initial XY position
+	if (ok)
+	{
+		// Build the commands to restore the head position. These assume that we are working in mm.
+		// Start with a vertical move to 2mm above the final Z position
+		buf.printf("G0 F6000 Z%.3f\n", (double)(rp.moveCoords[Z_AXIS] + 2.0));
+
+		// Now set all the other axes
+		buf.cat("G0 F6000");
+		for (size_t axis = 0; axis < numVisibleAxes; ++axis)
+		{
+			if (axis != Z_AXIS)
+			{
+				buf.catf(" %c%.3f", axisLetters[axis], (double)rp.moveCoords[axis]);
+			}
+		}
+
+		// Now move down to the correct Z height
+		buf.catf("\nG0 F6000 Z%.3f\n", (double)rp.moveCoords[Z_AXIS]);
+
+		// Set the feed rate
+		buf.catf("G1 F%.1f", (double)InverseConvertSpeedToMmPerMin(rp.feedRate));
+#if SUPPORT_LASER
+		if (machineType == MachineType::laser)
+		{
+			buf.catf(" S%u", (unsigned int)rp.laserPwmOrIoBits.laserPwm);
+		}
+		else
+		{
+#endif
+#if SUPPORT_IOBITS
+			buf.catf(" P%u", (unsigned int)rp.laserPwmOrIoBits.ioBits);
+#endif
+#if SUPPORT_LASER
+		}
+#endif
+		buf.cat("\n");
+		ok = f->Write(buf.c_str());									// restore feed rate and output bits or laser power
+	}
+	if (ok)
+	{
+		buf.printf("%s\nM24\n", (usingInches) ? "G20" : "G21");
+		ok = f->Write(buf.c_str());									// restore inches/mm and resume printing
+	}
+	return ok;
+}
+
+#endif
+
+#if SUPPORT_RESUME_SNAPSHOT
+
+// Save a periodic resume snapshot. We resume from the start of the move that is executing, so that nothing is missed if power fails before the next snapshot.
+void GCodes::UpdateResumeSnapshot() noexcept
+{
+	lastResumeSnapshotMillis = millis();
+	if (pauseState != PauseState::notPaused || IsSimulating())
+	{
+		return;									// resurrect.g has been or is being written, or we aren't really printing
+	}
+
+	RestorePoint rp;
+	if (!reprap.GetMove().GetResumePoint(rp))
+	{
+		return;									// no move from the file is executing or queued, so keep the previous snapshot
+	}
+
+	float userCoords[MaxAxes];
+	ToolOffsetInverseTransform(rp.moveCoords, userCoords);
+	memcpyf(rp.moveCoords, userCoords, MaxAxes);
+	rp.toolNumber = reprap.GetCurrentToolNumber();
+	rp.fanSpeed = lastDefaultFanSpeed;
+	SaveResumeSnapshot(rp, ResumeSnapshotKind::periodic);
+}
+
+// Fill in the resume snapshot using the specified resume point and the current state, and save it
+void GCodes::SaveResumeSnapshot(const RestorePoint& rp, ResumeSnapshotKind kind) noexcept
+{
+	const char *_ecv_array const printingFilename = reprap.GetPrintMonitor().GetPrintingFilename();
+	if (!resumeSnapshot.IsActive() || printingFilename == nullptr)
+	{
+		return;
+	}
+
+	ResumeSnapshotRecord& rec = resumeSnapshot.GetRecord();
+	memset(&rec, 0, sizeof(rec));								// so that unused fields and padding are always the same when we calculate the CRC
+	SafeStrncpy(rec.fileName, printingFilename, ARRAY_SIZE(rec.fileName));
+	rec.filePos = rp.filePos;
+	for (size_t axis = 0; axis < numVisibleAxes; ++axis)
+	{
+		rec.userCoords[axis] = rp.moveCoords[axis];
+		rec.babyStepOffsets[axis] = currentBabyStepOffsets[axis];
+		rec.positionOffsets[axis] = currentBabyStepOffsets[axis] - GetCurrentToolOffset(axis);
+	}
+	rec.feedRate = rp.feedRate;
+	rec.virtualExtruderPosition = rp.virtualExtruderPosition;
+	rec.proportionDone = rp.proportionDone;
+	rec.initialUserC0 = rp.initialUserC0;
+	rec.initialUserC1 = rp.initialUserC1;
+#if SUPPORT_LASER || SUPPORT_IOBITS
+	rec.laserPwmOrIoBits = rp.laserPwmOrIoBits;
+#endif
+	rec.fanSpeed = rp.fanSpeed;
+	rec.toolNumber = rp.toolNumber;
+
+	const Tool * const ct = reprap.GetCurrentTool();
+	if (ct != nullptr)
+	{
+		rec.toolHeaterCount = min<size_t>(ct->HeaterCount(), MaxHeatersPerTool);
+		for (size_t i = 0; i < rec.toolHeaterCount; ++i)
+		{
+			rec.toolActiveTemperatures[i] = ct->GetToolHeaterActiveTemperature(i);
+			rec.toolStandbyTemperatures[i] = ct->GetToolHeaterStandbyTemperature(i);
+		}
+	}
+
+	const Heat& heat = reprap.GetHeat();
+	for (size_t i = 0; i < MaxBedHeaters; ++i)
+	{
+		const int h = heat.GetBedHeater(i);
+		if (h >= 0 && heat.GetStatus(h) == HeaterStatus::active)
+		{
+			rec.bedHeatersActive |= 1u << i;
+			rec.bedTemperatures[i] = heat.GetActiveTemperature(h);
+		}
+	}
+	for (size_t i = 0; i < MaxChamberHeaters; ++i)
+	{
+		const int h = heat.GetChamberHeater(i);
+		if (h >= 0 && heat.GetStatus(h) == HeaterStatus::active)
+		{
+			rec.chamberHeatersActive |= 1u << i;
+			rec.chamberTemperatures[i] = heat.GetActiveTemperature(h);
+		}
+	}
+
+	rec.selectedPlane = fileGCode->OriginalMachineState().selectedPlane;
+	rec.workplaceNumber = moveState.currentCoordinateSystem;
+	if (fileGCode->OriginalMachineState().drivesRelative)
+	{
+		rec.flags |= ResumeSnapshotRecord::FlagDrivesRelative;
+	}
+	if (fileGCode->OriginalMachineState().usingInches)
+	{
+		rec.flags |= ResumeSnapshotRecord::FlagUsingInches;
+	}
+
+	if (!resumeSnapshot.Save(kind) && kind == ResumeSnapshotKind::powerFailure)
+	{
+		platform.MessageF(ErrorMessage, "Failed to write file %s\n", ResumeSnapshot::FileName);
+	}
+}
+
+// If the resume snapshot hasn't been superseded by resurrect.g, create resurrect.g from it. Return false if we needed to but failed.
+// The commands are the same as SaveResumeInfo writes, except that only the current tool's temperatures are restored and the state of the build objects isn't.
+bool GCodes::WriteResumeFileFromSnapshot() noexcept
+{
+	const ResumeSnapshotRecord * const rec = resumeSnapshot.ReadLatest();
+	if (rec == nullptr)
+	{
+		return true;
+	}
+
+	FileStore * const f = platform.OpenSysFile(RESUME_AFTER_POWER_FAIL_G, OpenMode::write);
+	if (f == nullptr)
+	{
+		return false;
+	}
+
+	String<StringLength256> buf;
+	buf.printf("; File \"%s\" resume print after %s, from resume snapshot\nG21\n",
+				rec->fileName, (rec->kind == ResumeSnapshotKind::powerFailure) ? "power failure" : "unexpected shutdown");
+	for (size_t i = 0; i < MaxBedHeaters; ++i)
+	{
+		if (rec->bedHeatersActive & (1u << i))
+		{
+			buf.catf("M140 P%u S%.1f\n", i, (double)rec->bedTemperatures[i]);
+		}
+	}
+	for (size_t i = 0; i < MaxChamberHeaters; ++i)
+	{
+		if (rec->chamberHeatersActive & (1u << i))
+		{
+			buf.catf("M141 P%u S%.1f\n", i, (double)rec->chamberTemperatures[i]);
+		}
+	}
+	bool ok = f->Write(buf.c_str())
+			&& reprap.GetMove().WriteResumeSettings(f);				// load grid, if we are using one
+	if (ok)
+	{
+		buf.copy("G92");
+		for (size_t axis = 0; axis < numVisibleAxes; ++axis)
+		{
+			buf.catf(" %c%.3f", axisLetters[axis], (double)(rec->userCoords[axis] - rec->positionOffsets[axis]));
+		}
+		buf.cat("\nG60 S1\n");
+		ok = f->Write(buf.c_str());
+	}
+	if (ok)
+	{
+		if (rec->toolNumber < 0)
+		{
+			buf.copy("T-1 P0\n");
+		}
+		else
+		{
+			buf.Clear();
+			if (rec->toolHeaterCount != 0)
+			{
+				buf.printf("G10 P%d ", rec->toolNumber);
+				char c = 'S';
+				for (size_t i = 0; i < rec->toolHeaterCount; ++i)
+				{
+					buf.catf("%c%d", c, (int)rec->toolActiveTemperatures[i]);
+					c = ':';
+				}
+				c = 'R';
+				buf.cat(' ');
+				for (size_t i = 0; i < rec->toolHeaterCount; ++i)
+				{
+					buf.catf("%c%d", c, (int)rec->toolStandbyTemperatures[i]);
+					c = ':';
+				}
+				buf.cat('\n');
+			}
+			buf.catf("T%d P0\n", rec->toolNumber);
+		}
+		buf.catf("M98 P\"%s\"\n", RESUME_PROLOGUE_G);
+		ok = f->Write(buf.c_str());									// set the tool temperatures, select the tool without running tool change files, and call the prologue
+	}
+	if (ok)
+	{
+		buf.copy("M116\nM290");
+		for (size_t axis = 0; axis < numVisibleAxes; ++axis)
+		{
+			buf.catf(" %c%.3f", axisLetters[axis], (double)rec->babyStepOffsets[axis]);
+		}
+		buf.cat(" R0\n");
+		if (rec->toolNumber >= 0)
+		{
+			buf.catf("T-1 P0\nT%d P6\n", rec->toolNumber);
+		}
+		ok = f->Write(buf.c_str());									// wait for temperatures, restore baby stepping and run the tool change files
+	}
+#if SUPPORT_WORKPLACE_COORDINATES
+	if (ok)
+	{
+		if (rec->workplaceNumber <= 5)
+		{
+			buf.printf("G%u\n", 54 + rec->workplaceNumber);
+		}
+		else
+		{
+			buf.printf("G59.%u\n", rec->workplaceNumber - 5);
+		}
+		ok = f->Write(buf.c_str());
+	}
+#endif
+	if (ok)
+	{
+		buf.printf("M106 S%.2f\nM116\nG92 E%.5f\n%s\n",
+					(double)rec->fanSpeed, (double)rec->virtualExtruderPosition, (rec->flags & ResumeSnapshotRecord::FlagDrivesRelative) ? "M83" : "M82");
+		ok = f->Write(buf.c_str());
+	}
+	if (ok)
+	{
+		RestorePoint rp;
+		memcpyf(rp.moveCoords, rec->userCoords, MaxAxes);
+		rp.feedRate = rec->feedRate;
+		rp.virtualExtruderPosition = rec->virtualExtruderPosition;
+		rp.proportionDone = rec->proportionDone;
+		rp.filePos = rec->filePos;
+		rp.initialUserC0 = rec->initialUserC0;
+		rp.initialUserC1 = rec->initialUserC1;
+#if SUPPORT_LASER || SUPPORT_IOBITS
+		rp.laserPwmOrIoBits = rec->laserPwmOrIoBits;
+#endif
+		ok = WriteResumePosition(f, rec->fileName, rp, rec->selectedPlane, (rec->flags & ResumeSnapshotRecord::FlagUsingInches) != 0);
+	}
+	if (!f->Close())
+	{
+		ok = false;
+	}
+	if (ok)
+	{
+		platform.MessageF(LoggedGenericMessage, "Created %s from resume snapshot\n", RESUME_AFTER_POWER_FAIL_G);
+	}
+	else
+	{
+		platform.DeleteSysFile(RESUME_AFTER_POWER_FAIL_G);
+	}
+	return ok;
+}
+
 #endif
 
 void GCodes::Diagnostics(MessageType mtype) noexcept
@@ -1409,7 +2022,22 @@ void GCodes::Diagnostics(MessageType mtype) noexcept
 		}
 	}
 
+	if (numIsrTriggers != 0)
+	{
+		platform.MessageF(mtype, "Input interrupt triggers %" PRIu32 ", max latency to main loop %.2fms\n",
+							numIsrTriggers, (double)((float)maxTriggerLatency * (1000.0/(float)StepClockRate)));
+		numIsrTriggers = maxTriggerLatency = 0;
+	}
+
 	codeQueue->Diagnostics(mtype);
+	GCodeMachineState::Diagnostics(mtype);
+#if SUPPORT_STARTUP_PROFILE
+	startupProfiler.Diagnostics(mtype);
+#endif
+	ExpressionCache::Diagnostics(mtype);
+#if SUPPORT_OBJECT_MODEL
+	ObjectModel::ResolvedEntryCacheDiagnostics(mtype);
+#endif
 }
 
 // Lock movement and wait for pending moves to finish.
@@ -1559,25 +2187,30 @@ const char * GCodes::LoadExtrusionAndFeedrateFromGCode(GCodeBuffer& gb, bool isP
 					rawExtruderTotal += requestedExtrusionAmount;
 				}
 
+				// Fetch the things that are the same for every drive of the tool once, not once per drive
+				const float *_ecv_array const mix = tool->GetMix();
+				const bool volumetric = gb.LatestMachineState().volumetricExtrusion;
+				const bool applyExtrusionFactors = moveState.applyM220M221;
+				const bool countFirstDrive = (moveState.moveType == 0 && !gb.IsDoingFileMacro());
 				float totalMix = 0.0;
 				for (size_t eDrive = 0; eDrive < eMoveCount; eDrive++)
 				{
-					const float thisMix = tool->GetMix()[eDrive];
+					const float thisMix = mix[eDrive];
 					if (thisMix != 0.0)
 					{
 						totalMix += thisMix;
 						const int extruder = tool->GetDrive(eDrive);
 						float extrusionAmount = requestedExtrusionAmount * thisMix;
-						if (gb.LatestMachineState().volumetricExtrusion)
+						if (volumetric)
 						{
 							extrusionAmount *= volumetricExtrusionFactors[extruder];
 						}
-						if (eDrive == 0 && moveState.moveType == 0 && !gb.IsDoingFileMacro())
+						if (eDrive == 0 && countFirstDrive)
 						{
 							rawExtruderTotalByDrive[extruder] += extrusionAmount;
 						}
 
-						moveState.coords[ExtruderToLogicalDrive(extruder)] = (moveState.applyM220M221)
+						moveState.coords[ExtruderToLogicalDrive(extruder)] = (applyExtrusionFactors)
 																				? extrusionAmount * extrusionFactors[extruder]
 																				: extrusionAmount;
 						extrudersMoving.SetBit(extruder);
@@ -1595,6 +2228,9 @@ const char * GCodes::LoadExtrusionAndFeedrateFromGCode(GCodeBuffer& gb, bool isP
 				// Note, if this is an extruder-only movement then the feed rate will apply to the total of all active extruders
 				if (gb.LatestMachineState().drivesRelative)
 				{
+					const bool volumetric = gb.LatestMachineState().volumetricExtrusion;
+					const bool applyExtrusionFactors = moveState.applyM220M221;
+					const bool countExtrusion = (moveState.moveType == 0 && !gb.IsDoingFileMacro());
 					for (size_t eDrive = 0; eDrive < mc; eDrive++)
 					{
 						const int extruder = tool->GetDrive(eDrive);
@@ -1606,17 +2242,17 @@ const char * GCodes::LoadExtrusionAndFeedrateFromGCode(GCodeBuffer& gb, bool isP
 								moveState.hasPositiveExtrusion = true;
 							}
 
-							if (gb.LatestMachineState().volumetricExtrusion)
+							if (volumetric)
 							{
 								extrusionAmount *= volumetricExtrusionFactors[extruder];
 							}
 
-							if (eDrive < mc && moveState.moveType == 0 && !gb.IsDoingFileMacro())
+							if (countExtrusion)
 							{
 								rawExtruderTotalByDrive[extruder] += extrusionAmount;
 								rawExtruderTotal += extrusionAmount;
 							}
-							moveState.coords[ExtruderToLogicalDrive(extruder)] = (moveState.applyM220M221)
+							moveState.coords[ExtruderToLogicalDrive(extruder)] = (applyExtrusionFactors)
 																					? extrusionAmount * extrusionFactors[extruder]
 																					: extrusionAmount;
 							extrudersMoving.SetBit(extruder);
@@ -1993,7 +2629,7 @@ bool GCodes::DoStraightMove(GCodeBuffer& gb, bool isCoordinated, const char *& e
 			}
 			const float moveLength = fastSqrtf(moveLengthSquared);
 			const float moveTime = moveLength/(moveState.feedRate * StepClockRate);		// this is a best-case time, often the move will take longer
-			moveState.totalSegments = (unsigned int)max<long>(1, lrintf(min<float>(moveLength * kin.GetReciprocalMinSegmentLength(), moveTime * kin.GetSegmentsPerSecond())));
+			moveState.totalSegments = kin.GetNumSegments(moveState.initialCoords, moveState.coords, numVisibleAxes, numVisibleAxes, moveLength, moveTime, moveState.isCoordinated);
 		}
 		else
 		{
@@ -2006,8 +2642,10 @@ bool GCodes::DoStraightMove(GCodeBuffer& gb, bool isCoordinated, const char *& e
 			const unsigned int minMeshSegments = max<unsigned int>(
 					1,
 					heightMap.GetMinimumSegments(
-						moveState.currentUserPosition[grid.GetAxisNumber(0)] - initialUserPosition[grid.GetAxisNumber(0)],
-						moveState.currentUserPosition[grid.GetAxisNumber(1)] - initialUserPosition[grid.GetAxisNumber(1)]
+						moveState.initialCoords[grid.GetAxisNumber(0)],
+						moveState.initialCoords[grid.GetAxisNumber(1)],
+						moveState.coords[grid.GetAxisNumber(0)] - moveState.initialCoords[grid.GetAxisNumber(0)],
+						moveState.coords[grid.GetAxisNumber(1)] - moveState.initialCoords[grid.GetAxisNumber(1)]
 					)
 			);
 			if (minMeshSegments > moveState.totalSegments)
@@ -2354,14 +2992,7 @@ bool GCodes::DoArcMove(GCodeBuffer& gb, bool clockwise, const char *& err)
 	}
 
 	// Compute how many segments to use
-	// For the arc to deviate up to MaxArcDeviation from the ideal, the segment length should be sqrtf(8 * arcRadius * MaxArcDeviation + fsquare(MaxArcDeviation))
-	// We leave out the square term because it is very small
-	// In CNC applications even very small deviations can be visible, so we use a smaller segment length at low speeds
-	const float arcSegmentLength = constrain<float>
-									(	min<float>(fastSqrtf(8 * moveState.arcRadius * MaxArcDeviation), moveState.feedRate * StepClockRate * (1.0/MinArcSegmentsPerSec)),
-										MinArcSegmentLength,
-										MaxArcSegmentLength
-									);
+	const float arcSegmentLength = reprap.GetMove().GetArcSegmentLength(moveState.arcRadius, moveState.feedRate);
 	moveState.totalSegments = max<unsigned int>((unsigned int)((moveState.arcRadius * totalArc)/arcSegmentLength + 0.8), 1u);
 	moveState.arcAngleIncrement = totalArc/moveState.totalSegments;
 	if (clockwise)
@@ -2389,7 +3020,7 @@ bool GCodes::DoArcMove(GCodeBuffer& gb, bool clockwise, const char *& err)
 void GCodes::FinaliseMove(GCodeBuffer& gb) noexcept
 {
 	moveState.canPauseAfter = !moveState.checkEndstops && !moveState.doingArcMove;		// pausing during an arc move isn't safe because the arc centre get recomputed incorrectly when we resume
-	moveState.filePos = (&gb == fileGCode) ? gb.GetFilePosition() : noFilePosition;
+	SetMoveFileDetails(gb);
 	gb.MotionCommanded();
 
 	if (buildObjects.IsCurrentObjectCancelled())
@@ -2687,7 +3318,7 @@ bool GCodes::DoFileMacro(GCodeBuffer& gb, const char* fileName, bool reportMissi
 #endif
 	{
 #if HAS_MASS_STORAGE || HAS_EMBEDDED_FILES
-		FileStore * const f = platform.OpenSysFile(fileName, OpenMode::read);
+		FileStore * const f = platform.OpenSysMacroFile(fileName);
 		if (f == nullptr)
 		{
 			if (reportMissing)
@@ -2705,6 +3336,9 @@ bool GCodes::DoFileMacro(GCodeBuffer& gb, const char* fileName, bool reportMissi
 		}
 		gb.GetVariables().AssignFrom(initialVariables);
 		gb.LatestMachineState().fileState.Set(f);
+#if SUPPORT_BINARY_GCODE_FILES
+		gb.LatestMachineState().binaryFile = false;				// macro files are always text
+#endif
 		gb.StartNewFile();
 		gb.GetFileInput()->Reset(gb.LatestMachineState().fileState);
 #else
@@ -2859,6 +3493,7 @@ GCodeResult GCodes::ExecuteG30(GCodeBuffer& gb, const StringRef& reply)
 
 	g30HValue = (gb.Seen('H')) ? gb.GetFValue() : 0.0;
 	g30ProbePointIndex = -1;
+	g30LevellingPassesDone = 0;
 	bool seenP = false;
 	gb.TryGetIValue('P', g30ProbePointIndex, seenP);
 	if (seenP)
@@ -2888,12 +3523,8 @@ GCodeResult GCodes::ExecuteG30(GCodeBuffer& gb, const StringRef& reply)
 			else
 			{
 				// Do a Z probe at the specified point.
-				const auto zp = SetZProbeNumber(gb, 'K');		// may throw, so do this before changing the state
-				gb.SetState(GCodeState::probingAtPoint0);
-				if (zp->GetProbeType() != ZProbeType::blTouch)
-				{
-					DeployZProbe(gb);
-				}
+				(void)SetZProbeNumber(gb, 'K');					// may throw, so do this before changing the state
+				StartProbingAtPoint(gb);
 			}
 		}
 	}
@@ -2912,6 +3543,16 @@ GCodeResult GCodes::ExecuteG30(GCodeBuffer& gb, const StringRef& reply)
 	return GCodeResult::ok;
 }
 
+// Start probing the stored probe point whose index is g30ProbePointIndex, using the current Z probe
+void GCodes::StartProbingAtPoint(GCodeBuffer& gb) noexcept
+{
+	gb.SetState(GCodeState::probingAtPoint0);
+	if (platform.GetZProbeOrDefault(currentZProbeNumber)->GetProbeType() != ZProbeType::blTouch)
+	{
+		DeployZProbe(gb);
+	}
+}
+
 // Set up currentZProbeNumber and return the probe
 ReadLockedPointer<ZProbe> GCodes::SetZProbeNumber(GCodeBuffer& gb, char probeLetter) THROWS(GCodeException)
 {
@@ -2954,8 +3595,9 @@ void GCodes::DoManualBedProbe(GCodeBuffer& gb)
 }
 
 // Start probing the grid, returning true if we didn't because of an error.
+// If 'scan' is true then we sweep along each row at the trigger height using the probe reading to measure the height, instead of probing each point.
 // Prior to calling this the movement system must be locked.
-GCodeResult GCodes::ProbeGrid(GCodeBuffer& gb, const StringRef& reply)
+GCodeResult GCodes::ProbeGrid(GCodeBuffer& gb, const StringRef& reply, bool scan)
 {
 	if (!defaultGrid.IsValid())
 	{
@@ -2969,13 +3611,60 @@ GCodeResult GCodes::ProbeGrid(GCodeBuffer& gb, const StringRef& reply)
 		return GCodeResult::error;
 	}
 
-	const auto zp = SetZProbeNumber(gb, 'K');			// may throw, so do this before changing the state
+	// Get the list of Z probes to use. If there is more than one then we probe the grid once with each, and each probe probes the points that
+	// the previous ones could not reach. Each probe's own offsets and trigger height are used, so the heights are consistent if the probes are calibrated.
+	uint32_t probeNumbers[MaxZProbes];
+	size_t numProbes = 1;
+	probeNumbers[0] = 0;
+	if (gb.Seen('K'))
+	{
+		numProbes = MaxZProbes;
+		gb.GetUnsignedArray(probeNumbers, numProbes, false);
+	}
+	if (numProbes > 1 && scan)
+	{
+		reply.copy("Only one Z probe may be used to scan the bed");
+		return GCodeResult::error;
+	}
+	for (size_t i = 0; i < numProbes; ++i)
+	{
+		if (probeNumbers[i] >= MaxZProbes || platform.GetEndstops().GetZProbe(probeNumbers[i]).IsNull())
+		{
+			reply.printf("Z probe %" PRIu32 " not found", probeNumbers[i]);
+			return GCodeResult::error;
+		}
+		gridProbeNumbers[i] = (uint8_t)probeNumbers[i];
+	}
+	numGridProbes = (uint8_t)numProbes;
+	gridProbeIndex = 0;
+	currentZProbeNumber = gridProbeNumbers[0];
+	const auto zp = platform.GetEndstops().GetZProbe(currentZProbeNumber);
+
+	if (scan && !zp->CanScan())
+	{
+		reply.printf("Z probe %u cannot be used to scan the bed. Use an analog probe and calibrate it using M558.1", currentZProbeNumber);
+		return GCodeResult::error;
+	}
+
+	// See whether we are doing adaptive probing. We need at least one point between the coarse points for it to be worthwhile.
+	gridAdaptiveTolerance = 0.0;
+	gridAdaptiveStride = 2;
+	gridPointsInterpolated = 0;
+	gridAdaptiveRefining = false;
+	if (!scan && gb.Seen('T'))
+	{
+		gridAdaptiveTolerance = gb.GetLimitedFValue('T', 0.001, 10.0);
+		if (gb.Seen('D'))
+		{
+			gridAdaptiveStride = gb.GetLimitedUIValue('D', 2, MaxAxis0GridPoints);
+		}
+	}
 
 	reprap.GetMove().AccessHeightMap().SetGrid(defaultGrid);
 	ClearBedMapping();
 	gridAxis0index = gridAxis1index = 0;
 
-	gb.SetState(GCodeState::gridProbing1);
+	gb.SetState((scan) ? GCodeState::gridScanning1 : GCodeState::gridProbing1);
 	if (zp->GetProbeType() != ZProbeType::blTouch)
 	{
 		DeployZProbe(gb);
@@ -3130,6 +3819,17 @@ bool GCodes::QueueFileToPrint(const char* fileName, const StringRef& reply) noex
 	FileStore * const f = platform.OpenFile(Platform::GetGCodeDir(), fileName, OpenMode::read);
 	if (f != nullptr)
 	{
+# if HAS_MASS_STORAGE
+		(void)f->EnableFastSeek();				// so that pausing, resuming and restarting a large file don't have to follow the FAT chain
+# endif
+# if SUPPORT_COMPRESSED_GCODE_FILES
+		if (!f->EnableDecompression())
+		{
+			f->Close();
+			reply.printf("GCode file \"%s\" is compressed but cannot be read\n", fileName);
+			return false;
+		}
+# endif
 		fileToPrint.Set(f);
 		return true;
 	}
@@ -3170,11 +3870,21 @@ void GCodes::StartPrinting(bool fromStart) noexcept
 #if HAS_MASS_STORAGE || HAS_EMBEDDED_FILES
 		fileGCode->OriginalMachineState().fileState.MoveFrom(fileToPrint);
 		fileGCode->GetFileInput()->Reset(fileGCode->OriginalMachineState().fileState);
+#endif
+#if SUPPORT_BINARY_GCODE_FILES
+		fileGCode->OriginalMachineState().binaryFile = FileGCodeInput::IsBinaryFile(fileGCode->OriginalMachineState().fileState);
 #endif
 	}
 	fileGCode->StartNewFile();
 
 	reprap.GetPrintMonitor().StartedPrint();
+#if SUPPORT_RESUME_SNAPSHOT
+	if (!IsSimulating())
+	{
+		resumeSnapshot.Start();
+		lastResumeSnapshotMillis = millis();
+	}
+#endif
 	platform.MessageF(LogWarn,
 						(IsSimulating()) ? "Started simulating printing file %s\n" : "Started printing file %s\n",
 							reprap.GetPrintMonitor().GetPrintingFilename());
@@ -3671,6 +4381,21 @@ void GCodes::HandleReplyPreserveResult(GCodeBuffer& gb, GCodeResult rslt, const
 	case Compatibility::Marlin:
 		if (gb.IsLastCommand() && !gb.IsDoingFileMacro())
 		{
+			if (IsUsbStreaming(gb))
+			{
+				// In streaming mode we acknowledge successful commands that have no reply in batches
+				if (rslt == GCodeResult::ok && reply[0] == 0)
+				{
+					++usbLinesToAcknowledge;
+					if (usbLinesToAcknowledge >= UsbStreamingAckLines)
+					{
+						SendUsbStreamingAcknowledgement();
+					}
+					break;
+				}
+				SendUsbStreamingAcknowledgement();		// acknowledge the earlier lines first, then this one in the usual way
+			}
+
 			// Put "ok" at the end
 			const char* const response = (gb.GetCommandLetter() == 'M' && gb.GetCommandNumber() == 998) ? "rs " : "ok";
 			// We don't need to handle M20 here because we always allocate an output buffer for that one
@@ -3719,7 +4444,7 @@ void GCodes::HandleReply(GCodeBuffer& gb, OutputBuffer *reply) noexcept
 
 #if HAS_SBC_INTERFACE
 	// Deal with replies to the SBC
-	if (gb.IsBinary())
+	if (gb.IsBinary() && gb.LatestMachineState().lastCodeFromSbc)
 	{
 		platform.Message(gb.GetResponseMessageType(), reply);
 		return;
@@ -3747,6 +4472,11 @@ void GCodes::HandleReply(GCodeBuffer& gb, OutputBuffer *reply) noexcept
 
 	case Compatibility::Marlin:
 	case Compatibility::NanoDLP:
+		if (IsUsbStreaming(gb))
+		{
+			SendUsbStreamingAcknowledgement();			// acknowledge the earlier lines first so that the acknowledgements stay in order
+		}
+
 		if (gb.GetCommandLetter() == 'M')
 		{
 			// The response to some M-codes is handled differently in Marlin mode
@@ -3802,6 +4532,23 @@ void GCodes::HandleReply(GCodeBuffer& gb, OutputBuffer *reply) noexcept
 	OutputBuffer::ReleaseAll(reply);
 }
 
+// In USB streaming mode (M575 P0 S8) the host doesn't wait for "ok" after each line. Instead it keeps up to UsbStreamingWindowLines lines
+// outstanding, and we send "ok N" to acknowledge N lines at a time. A line that gets a reply or an error is still acknowledged by a plain "ok"
+// after the reply, which counts as one line.
+bool GCodes::IsUsbStreaming(const GCodeBuffer& gb) const noexcept
+{
+	return &gb == usbGCode && (platform.GetCommsProperties(0) & 8u) != 0;
+}
+
+void GCodes::SendUsbStreamingAcknowledgement() noexcept
+{
+	if (usbLinesToAcknowledge != 0)
+	{
+		platform.MessageF(UsbMessage, "ok %u\n", usbLinesToAcknowledge);
+		usbLinesToAcknowledge = 0;
+	}
+}
+
 void GCodes::SetToolHeaters(Tool *tool, float temperature, bool both) THROWS(GCodeException)
 {
 	if (tool == nullptr)
@@ -3845,7 +4592,7 @@ GCodeResult GCodes::RetractFilament(GCodeBuffer& gb, bool retract)
 			SetMoveBufferDefaults();
 			moveState.tool = reprap.GetCurrentTool();
 			reprap.GetMove().GetCurrentUserPosition(moveState.coords, 0, moveState.tool);
-			moveState.filePos = (&gb == fileGCode) ? gb.GetFilePosition() : noFilePosition;
+			SetMoveFileDetails(gb);
 
 			if (retract)
 			{
@@ -4052,6 +4799,9 @@ void GCodes::StopPrint(StopPrintReason reason) noexcept
 		}
 #endif
 
+#if SUPPORT_MOTION_BENCHMARK
+		const bool wasBenchmarking = (simulationMode == SimulationMode::debug);
+#endif
 		exitSimulationWhenFileComplete = false;
 		simulationMode = SimulationMode::off;				// do this after we append the simulation info to the file so that DWC doesn't try to reload the file info too soon
 		reprap.GetMove().Simulate(simulationMode);
@@ -4070,6 +4820,14 @@ void GCodes::StopPrint(StopPrintReason reason) noexcept
 			platform.MessageF(LoggedGenericMessage, "Cancelled simulating file %s after %" PRIu32 "h %" PRIu32 "m simulated time\n",
 									printingFilename, simMinutes/60u, simMinutes % 60u);
 		}
+#if SUPPORT_MOTION_BENCHMARK
+		if (wasBenchmarking && reprap.GetMove().GetMotionBenchmark().HasResults())
+		{
+			String<StringLength500> benchmarkText;
+			reprap.GetMove().GetMotionBenchmark().Report(benchmarkText.GetRef());
+			platform.MessageF(GenericMessage, "%s\n", benchmarkText.c_str() + 1);		// skip the leading newline
+		}
+#endif
 	}
 	else if (reprap.GetPrintMonitor().IsPrinting())
 	{
@@ -4122,6 +4880,10 @@ void GCodes::StopPrint(StopPrintReason reason) noexcept
 #endif
 	}
 
+#if SUPPORT_RESUME_SNAPSHOT
+	resumeSnapshot.Stop(reason == StopPrintReason::normalCompletion);
+#endif
+
 	updateFileWhenSimulationComplete = false;
 	reprap.GetPrintMonitor().StoppedPrint();			// must do this after printing the simulation details not before, because it clears the filename and pause time
 	buildObjects.Init();
@@ -4568,7 +5330,7 @@ void GCodes::CheckReportDue(GCodeBuffer& gb, const StringRef& reply) const noexc
 										: GenerateJsonStatusResponse(lastAuxStatusReportType, -1, ResponseSource::AUX);		// older PanelDueFirmware using M408
 			if (statusBuf != nullptr)
 			{
-				platform.AppendAuxReply(0, statusBuf, true);
+				platform.AppendAuxStatusReport(0, statusBuf);
 				if (reprap.Debug(moduleGcodes))
 				{
 					debugPrintf("%s: Sent unsolicited status report\n", gb.GetChannel().ToString());
@@ -4628,6 +5390,16 @@ void GCodes::SetMoveBufferDefaults() noexcept
 	moveState.SetDefaults(numTotalAxes);
 }
 
+// Record the file position of the move being set up and, for job accounting, the build plate object and layer that it belongs to
+void GCodes::SetMoveFileDetails(const GCodeBuffer& gb) noexcept
+{
+	moveState.filePos = (&gb == fileGCode) ? gb.GetFilePosition() : noFilePosition;
+#if SUPPORT_JOB_ACCOUNTING
+	moveState.objectNumber = (int16_t)buildObjects.GetCurrentObjectNumber();
+	moveState.layerNumber = (uint16_t)reprap.GetPrintMonitor().GetCurrentLayer();
+#endif
+}
+
 // Resource locking/unlocking
 
 // Lock the resource, returning true if success.
@@ -4802,12 +5574,18 @@ bool GCodes::CheckNetworkCommandAllowed(GCodeBuffer& gb, const StringRef& reply,
 
 #if HAS_MASS_STORAGE
 
-// Start timing SD card file writing
+// Start timing SD card file writing, then reading, then if the L parameter is present, the latency of reads like those made when printing a file
 GCodeResult GCodes::StartSDTiming(GCodeBuffer& gb, const StringRef& reply) noexcept
 {
 	const float bytesReq = (gb.Seen('S')) ? gb.GetFValue() : 10.0;
 	const bool useCrc = (gb.Seen('C') && gb.GetUIValue() != 0);
+	timingReadsRequested = (gb.Seen('L')) ? gb.GetUIValue() : 0;
 	timingBytesRequested = (uint32_t)(bytesReq * (float)(1024 * 1024));
+	if (timingReadsRequested != 0 && timingBytesRequested < 2 * FileGCodeInputBufferSize)
+	{
+		reply.copy("File size too small for latency test");
+		return GCodeResult::error;
+	}
 	FileStore * const f = platform.OpenFile(Platform::GetGCodeDir(), TimingFileName, (useCrc) ? OpenMode::writeWithCrc : OpenMode::write, timingBytesRequested);
 	if (f == nullptr)
 	{
@@ -4823,6 +5601,14 @@ GCodeResult GCodes::StartSDTiming(GCodeBuffer& gb, const StringRef& reply) noexc
 	return GCodeResult::ok;
 }
 
+void GCodes::FreeSDLatencyBuffers() noexcept
+{
+	delete[] timingReadBuffer;
+	timingReadBuffer = nullptr;
+	delete[] timingLatencyCounts;
+	timingLatencyCounts = nullptr;
+}
+
 #endif
 
 #if SUPPORT_12864_LCD
@@ -36,6 +36,9 @@ Licence: GPL
 #include <Tools/Filament.h>
 #include <FilamentMonitors/FilamentMonitor.h>
 #include "RestorePoint.h"
+#include "ToolPreheater.h"
+#include "ResumeSnapshot.h"
+#include "StartupProfiler.h"
 #include "StraightProbeSettings.h"
 #include <Movement/BedProbing/Grid.h>
 
@@ -164,6 +167,9 @@ public:
 
 	bool IsReallyPrinting() const noexcept;										// Return true if we are printing from SD card and not pausing, paused or resuming
 	bool IsReallyPrintingOrResuming() const noexcept;
+#if HAS_MASS_STORAGE || HAS_EMBEDDED_FILES
+	bool IsPrintFileInputLow() const noexcept;									// Return true if we are printing and the buffered data from the print file is running low
+#endif
 	bool IsSimulating() const noexcept { return simulationMode != SimulationMode::off; }
 	bool IsDoingToolChange() const noexcept { return doingToolChange; }
 	bool IsHeatingUp() const noexcept;											// Return true if the SD card print is waiting for a heater to reach temperature
@@ -178,6 +184,7 @@ public:
 	bool NoMovesBeforeHoming() const noexcept { return noMovesBeforeHoming; }
 
 	void MoveStoppedByZProbe() noexcept { zProbeTriggered = true; }				// Called from the step ISR when the Z probe is triggered, causing the move to be aborted
+	void GpInputChangedFromISR(unsigned int gpinNumber, bool newState) noexcept;	// Called from the pin change ISR of an interrupt-driven GpIn port
 
 	size_t GetTotalAxes() const noexcept { return numTotalAxes; }
 	size_t GetVisibleAxes() const noexcept { return numVisibleAxes; }
@@ -223,6 +230,7 @@ public:
 
 #if HAS_MASS_STORAGE
 	GCodeResult StartSDTiming(GCodeBuffer& gb, const StringRef& reply) noexcept;	// Start timing SD card file writing
+	void FreeSDLatencyBuffers() noexcept;										// Free the buffers used by the SD card latency test
 #endif
 
 	void SavePosition(RestorePoint& rp, const GCodeBuffer& gb) const noexcept;		// Save position etc. to a restore point
@@ -347,6 +355,10 @@ private:
 	void StopPrint(StopPrintReason reason) noexcept;							// Stop the current print
 
 	bool DoFilePrint(GCodeBuffer& gb, const StringRef& reply) noexcept;					// Get G Codes from a file and print them
+#if HAS_MASS_STORAGE || HAS_EMBEDDED_FILES
+	void SkipCancelledMoves(GCodeBuffer& gb) noexcept;									// Skip plain G0/G1 moves of a cancelled object without parsing them
+	bool SkipCancelledMove(GCodeBuffer& gb, const char *_ecv_array line, AxesBitmap& axesMoved) noexcept;	// Skip one line if it is blank or a plain G0/G1 move
+#endif
 	bool DoFileMacro(GCodeBuffer& gb, const char* fileName, bool reportMissing, int codeRunning, VariableSet& initialVariables) noexcept;
 	bool DoFileMacro(GCodeBuffer& gb, const char* fileName, bool reportMissing, int codeRunning) noexcept;
 																						// Run a GCode macro file, optionally report error if not found
@@ -362,6 +374,8 @@ private:
 
 	void HandleReply(GCodeBuffer& gb, OutputBuffer *reply) noexcept;
 	void HandleReplyPreserveResult(GCodeBuffer& gb, GCodeResult rslt, const char *reply) noexcept;	// Handle G-Code replies
+	bool IsUsbStreaming(const GCodeBuffer& gb) const noexcept;											// Return true if this is the USB channel and it is in streaming mode
+	void SendUsbStreamingAcknowledgement() noexcept;
 
 	GCodeResult TryMacroFile(GCodeBuffer& gb) noexcept;								// Try to find a macro file that implements a G or M command
 
@@ -460,10 +474,12 @@ private:
 	GCodeResult SaveHeightMap(GCodeBuffer& gb, const StringRef& reply) const;				// Save the height map to the file specified by P parameter
 #endif
 	void ClearBedMapping();																	// Stop using bed compensation
-	GCodeResult ProbeGrid(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);	// Start probing the grid, returning true if we didn't because of an error
+	GCodeResult ProbeGrid(GCodeBuffer& gb, const StringRef& reply, bool scan) THROWS(GCodeException);	// Start probing the grid, returning true if we didn't because of an error
 	ReadLockedPointer<ZProbe> SetZProbeNumber(GCodeBuffer& gb, char probeLetter) THROWS(GCodeException);		// Set up currentZProbeNumber and return the probe
+	void StartProbingAtPoint(GCodeBuffer& gb) noexcept;							// Start probing the stored probe point g30ProbePointIndex
 	GCodeResult ExecuteG30(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);	// Probes at a given position - see the comment at the head of the function itself
 	void InitialiseTaps(bool fastThenSlow) noexcept;										// Set up to do the first of a possibly multi-tap probe
+	float GetLiftHeightAfterTap(const ZProbe& zp) const noexcept;							// Return the height to raise the probe to after a tap
 	void SetBedEquationWithProbe(int sParam, const StringRef& reply);						// Probes a series of points and sets the bed equation
 
 	GCodeResult ConfigureTrigger(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);	// Handle M581
@@ -478,7 +494,7 @@ private:
 #endif
 
 #if HAS_MASS_STORAGE || HAS_SBC_INTERFACE || HAS_EMBEDDED_FILES
-	GCodeResult SimulateFile(GCodeBuffer& gb, const StringRef &reply, const StringRef& file, bool updateFile) THROWS(GCodeException);	// Handle M37 to simulate a whole file
+	GCodeResult SimulateFile(GCodeBuffer& gb, const StringRef &reply, const StringRef& file, bool updateFile, SimulationMode simMode) THROWS(GCodeException);	// Handle M37 to simulate a whole file
 	GCodeResult ChangeSimulationMode(GCodeBuffer& gb, const StringRef &reply, SimulationMode newSimMode) THROWS(GCodeException);		// Handle M37 to change the simulation mode
 #endif
 
@@ -502,12 +518,19 @@ private:
 
 #if HAS_MASS_STORAGE || HAS_SBC_INTERFACE
 	void SaveResumeInfo(bool wasPowerFailure) noexcept;
+	bool WriteResumePosition(FileStore *f, const char *_ecv_array printingFilename, const RestorePoint& rp, unsigned int selectedPlane, bool usingInches) const noexcept;
+#endif
+#if SUPPORT_RESUME_SNAPSHOT
+	void UpdateResumeSnapshot() noexcept;										// Save a periodic resume snapshot
+	void SaveResumeSnapshot(const RestorePoint& rp, ResumeSnapshotKind kind) noexcept;	// Save a resume snapshot of the current state with the specified resume point
+	bool WriteResumeFileFromSnapshot() noexcept;								// Create resurrect.g from the resume snapshot if it is more recent
 #endif
 
 	void NewSingleSegmentMoveAvailable() noexcept;								// Flag that a new move is available
 	void NewMoveAvailable() noexcept;											// Flag that a new move is available
 
 	void SetMoveBufferDefaults() noexcept;										// Set up default values in the move buffer
+	void SetMoveFileDetails(const GCodeBuffer& gb) noexcept;					// Record where in the file the move being set up came from
 	void ChangeExtrusionFactor(unsigned int extruder, float factor) noexcept;	// Change a live extrusion factor
 
 #if SUPPORT_COORDINATE_ROTATION
@@ -646,9 +669,20 @@ private:
 	float g30PrevHeightError;					// the height error the previous time we probed
 	float g30zHeightErrorSum;					// the sum of the height errors for the current probe point
 	float g30zHeightErrorLowestDiff;			// the lowest difference we have seen between consecutive readings
+	unsigned int g30LevellingPassesDone;		// how many calibration passes the current G30 S command has done
+	size_t g30LevellingNumPoints;				// the number of points that we are probing again for another calibration pass
 	uint32_t lastProbedTime;					// time in milliseconds that the probe was last triggered
 	volatile bool zProbeTriggered;				// Set by the step ISR when a move is aborted because the Z probe is triggered
 	size_t gridAxis0index, gridAxis1index;		// Which grid probe point is next
+	size_t gridScanQueuedIndex;					// When scanning the grid, the axis 0 index of the point that the last move we queued goes to
+	float gridAdaptiveTolerance;				// The height tolerance when doing adaptive grid probing, or 0 if we are probing every point
+	uint32_t gridAdaptiveStride;				// The spacing of the points that we probe in the first pass of adaptive probing, in grid points
+	unsigned int gridPointsInterpolated;		// How many points adaptive probing filled in by interpolation
+	bool gridAdaptiveRefining;					// True if we are doing the second pass of adaptive probing
+	uint8_t gridProbeNumbers[MaxZProbes];		// The Z probes that G29 is using, in the order that we use them
+	uint8_t numGridProbes;						// How many Z probes G29 is using
+	uint8_t gridProbeIndex;						// The index into gridProbeNumbers of the Z probe that we are using now
+	LargeBitmap<MaxGridProbePoints> gridPointsToProbe;	// The points that we probe in the second pass of adaptive probing
 	bool doingManualBedProbe;					// true if we are waiting for the user to jog the nozzle until it touches the bed
 	bool hadProbingError;						// true if there was an error probing the last point
 	bool zDatumSetByProbing;					// true if the Z position was last set by probing, not by an endstop switch or by G92
@@ -665,6 +699,10 @@ private:
 	// Triggers
 	TriggerItem triggers[MaxTriggers];				// Trigger conditions
 	TriggerNumbersBitmap triggersPending;		// Bitmap of triggers pending but not yet executed
+	volatile uint32_t triggersFromIsr;			// Bitmap of triggers fired by interrupt-driven inputs that CheckTriggers hasn't seen yet
+	volatile uint32_t whenIsrTriggered;			// The step clock when the first of those triggers fired
+	uint32_t maxTriggerLatency;					// The longest time in step clocks between an input interrupt firing a trigger and CheckTriggers acting on it
+	uint32_t numIsrTriggers;					// How many triggers have been fired by input interrupts
 
 	// Firmware update
 	Bitmap<uint8_t> firmwareUpdateModuleMap;	// Bitmap of firmware modules to be updated
@@ -702,6 +740,11 @@ private:
 	uint32_t timingBytesRequested;				// how many bytes we were asked to write
 	uint32_t timingBytesWritten;				// how many timing bytes we have written so far
 	uint32_t timingStartMillis;
+	uint32_t timingReadsRequested;				// how many reads to time in the latency test, or zero to skip it
+	uint32_t timingMaxReadTicks;				// the longest read in the latency test
+	FilePosition timingFilePos;					// where the next read in the latency test starts
+	char *_ecv_array null timingReadBuffer;		// the buffer for the latency test, FileGCodeInputBufferSize bytes
+	uint16_t *_ecv_array null timingLatencyCounts;	// the histogram of read latencies, SdLatencyBuckets elements
 #endif
 
 #if SUPPORT_REMOTE_COMMANDS
@@ -709,6 +752,17 @@ private:
 #endif
 
 	int8_t lastAuxStatusReportType;				// The type of the last status report requested by PanelDue
+	unsigned int usbLinesToAcknowledge;			// In USB streaming mode, the number of lines that have completed that we haven't sent "ok" for yet
+#if SUPPORT_TOOL_PREHEAT
+	ToolPreheater toolPreheater;				// Reads ahead in the print file to preheat the next tool
+#endif
+#if SUPPORT_RESUME_SNAPSHOT
+	ResumeSnapshot resumeSnapshot;				// Binary snapshots of the state needed to resume the print after a power failure
+	uint32_t lastResumeSnapshotMillis;			// When we last saved a periodic resume snapshot
+#endif
+#if SUPPORT_STARTUP_PROFILE
+	StartupProfiler startupProfiler;			// Records how long the commands in config.g took
+#endif
 	bool isWaiting;								// True if waiting to reach temperature
 	bool cancelWait;							// Set true to cancel waiting
 	bool displayNoToolWarning;					// True if we need to display a 'no tool selected' warning
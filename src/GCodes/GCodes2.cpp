@@ -25,6 +25,8 @@
 #include <FilamentMonitors/FilamentMonitor.h>
 #include <General/IP4String.h>
 #include <Movement/StepperDrivers/DriverMode.h>
+#include <Movement/StepperDrivers/StallGuardLog.h>
+#include <Platform/CpuUsage.h>
 #include <Hardware/SoftwareReset.h>
 #include <Hardware/ExceptionHandlers.h>
 #include <Version.h>
@@ -304,7 +306,7 @@ bool GCodes::HandleGcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 				switch(sparam)
 				{
 				case 0:		// probe and save height map
-					result = ProbeGrid(gb, reply);
+					result = ProbeGrid(gb, reply, false);
 					break;
 
 				case 1:		// load height map file
@@ -327,6 +329,10 @@ bool GCodes::HandleGcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 #endif
 					break;
 
+				case 4:		// scan the bed without stopping at each point and save height map
+					result = ProbeGrid(gb, reply, true);
+					break;
+
 				default:
 					result = GCodeResult::badOrMissingParameter;
 					break;
@@ -498,7 +504,16 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 
 		GCodeResult result;
 		if (gb.GetCommandFraction() > 0
-			&& code != 36 && code != 201 && code != 569					// these are the only M-codes we implement that can have fractional parts
+			&& code != 36 && code != 201 && code != 558 && code != 569		// these are the only M-codes we implement that can have fractional parts
+#if SUPPORT_JOB_ACCOUNTING
+			&& code != 73
+#endif
+#if SUPPORT_STALLGUARD_LOG
+			&& code != 915
+#endif
+#if SUPPORT_TOOL_PREHEAT
+			&& code != 568
+#endif
 		   )
 		{
 			result = TryMacroFile(gb);
@@ -1087,7 +1102,7 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 				{
 					String<MaxFilenameLength> filename;
 					gb.GetUnprecedentedString(filename.GetRef());
-					const bool ok = gb.OpenFileToWrite(Platform::GetGCodeDir(), filename.c_str(), 0, false, 0);
+					const bool ok = gb.OpenFileToWrite(Platform::GetGCodeDir(), filename.c_str(), 0, false, false, 0);
 					if (ok)
 					{
 						reply.printf("Writing to file: %s", filename.c_str());
@@ -1181,7 +1196,10 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 					if (seen)
 					{
 						const bool updateFile = !gb.Seen('F') || gb.GetUIValue() == 1;
-						result = SimulateFile(gb, reply, simFileName.GetRef(), updateFile);
+						uint32_t fileSimulationMode = (uint32_t)SimulationMode::normal;
+						gb.TryGetLimitedUIValue('S', fileSimulationMode, seen, (uint32_t)SimulationMode::highest + 1);
+						result = SimulateFile(gb, reply, simFileName.GetRef(), updateFile,
+												(fileSimulationMode == (uint32_t)SimulationMode::off) ? SimulationMode::normal : (SimulationMode)fileSimulationMode);
 					}
 					else
 					{
@@ -1195,6 +1213,12 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 						{
 							reply.printf("Simulation mode: %s, move time: %.1f sec, other time: %.1f sec",
 									(IsSimulating()) ? "on" : "off", (double)reprap.GetMove().GetSimulationTime(), (double)simulationTime);
+#if SUPPORT_MOTION_BENCHMARK
+							if (reprap.GetMove().GetMotionBenchmark().HasResults())
+							{
+								reprap.GetMove().GetMotionBenchmark().Report(reply);
+							}
+#endif
 						}
 					}
 				}
@@ -1928,6 +1952,13 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 						result = CanInterface::RemoteDiagnostics(mt, board, type, gb, reply);
 						break;
 					}
+#endif
+#if SUPPORT_CPU_USAGE_STATS
+					if (type == 0 && gb.Seen('W'))
+					{
+						result = CpuUsage::SetWindow(gb, reply);		// set the CPU usage measurement window
+						break;
+					}
 #endif
 					if (type == 0)
 					{
@@ -2881,6 +2912,12 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 					bool dummy;
 					gb.TryGetQuotedString('K', key.GetRef(), dummy, true);
 					gb.TryGetQuotedString('F', flags.GetRef(), dummy, true);
+					if (strchr(flags.c_str(), 'b') != nullptr)
+					{
+						reply.copy("M409 replies are text, so binary format is not supported");
+						result = GCodeResult::error;
+						break;
+					}
 					if (&gb == auxGCode)
 					{
 						lastAuxStatusReportType = ObjectModelAuxStatusReportType;
@@ -2911,6 +2948,7 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 				}
 #if SUPPORT_LASER
 				platform.ReleaseLaserPin();
+				reprap.GetMove().SetLaserSynchronised(false);
 #endif
 				machineType = MachineType::fff;
 				reprap.StateUpdated();
@@ -2947,6 +2985,10 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 					{
 						laserMaxPower = max<float>(1.0, gb.GetFValue());
 					}
+					if (gb.Seen('H'))
+					{
+						reprap.GetMove().SetLaserSynchronised(gb.GetUIValue() == 1);	// H1 sets the laser power from the step timer instead of the laser task
+					}
 				}
 				reprap.StateUpdated();
 				break;
@@ -2963,6 +3005,7 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 				{
 #if SUPPORT_LASER
 					platform.ReleaseLaserPin();
+					reprap.GetMove().SetLaserSynchronised(false);
 #endif
 					machineType = MachineType::cnc;						// switch to CNC mode even if the spindle parameter is bad
 					reprap.StateUpdated();
@@ -3291,7 +3334,8 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 				break;
 
 			case 558: // Set or report Z probe type and for which axes it is used
-				result = platform.GetEndstops().HandleM558(gb, reply);
+				result = (gb.GetCommandFraction() == 1) ? platform.GetEndstops().HandleM558Point1(gb, reply)	// set or report the scanning parameters
+							: platform.GetEndstops().HandleM558(gb, reply);
 				break;
 
 #if HAS_MASS_STORAGE
@@ -3312,7 +3356,8 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 					gb.GetQuotedString(filename.GetRef());
 					const FilePosition size = (gb.Seen('S') ? (FilePosition)gb.GetIValue() : 0);
 					const uint32_t crc32 = (gb.Seen('C') ? gb.GetUIValue() : 0);
-					const bool ok = gb.OpenFileToWrite(defaultFolder.c_str(), filename.c_str(), size, true, crc32);
+					const bool framedBlocks = (gb.Seen('B') && gb.GetUIValue() == 1);
+					const bool ok = gb.OpenFileToWrite(defaultFolder.c_str(), filename.c_str(), size, true, framedBlocks, crc32);
 					if (ok)
 					{
 						reply.printf("Writing to file: %s", filename.c_str());
@@ -3410,6 +3455,12 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 						reprap.GetMove().SetJerkPolicy(gb.GetUIValue());
 					}
 
+					if (code == 566 && gb.Seen('J'))
+					{
+						seenAxis = true;
+						reprap.GetMove().SetJunctionDeviation(max<float>(gb.GetFValue(), 0.0));
+					}
+
 					if (seenAxis)
 					{
 						reprap.MoveUpdated();
@@ -3431,6 +3482,11 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 						if (code == 566)
 						{
 							reply.catf(", jerk policy: %u", reprap.GetMove().GetJerkPolicy());
+							const float junctionDeviation = reprap.GetMove().GetJunctionDeviation();
+							if (junctionDeviation > 0.0)
+							{
+								reply.catf(", junction deviation: %.3fmm", (double)junctionDeviation);
+							}
 						}
 					}
 				}
@@ -3468,6 +3524,13 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 				break;
 
 			case 568: // Tool Settings
+#if SUPPORT_TOOL_PREHEAT
+				if (gb.GetCommandFraction() == 1)
+				{
+					result = toolPreheater.Configure(gb, reply);	// set or report the tool preheat lookahead time
+					break;
+				}
+#endif
 				result = SetOrReportOffsets(gb, reply, 568);
 				break;
 
@@ -3556,6 +3619,10 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 						{
 							reply.cat(", connected");
 						}
+						if (chan == 0 && (cp & 8) != 0)
+						{
+							reply.catf(", streaming with window %u lines", UsbStreamingWindowLines);
+						}
 #if HAS_AUX_DEVICES
 						else if (chan != 0 && platform.IsAuxRaw(chan - 1))
 						{
@@ -3653,6 +3720,18 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 					}
 #endif
 
+					if (gb.Seen('B'))
+					{
+						result = reprap.GetNetwork().SetNumBuffers(gb.GetUIValue(), reply);
+						seen = true;
+					}
+
+					if (gb.Seen('D'))
+					{
+						reprap.GetNetwork().SetTelnetReplyBatchTime(gb.GetUIValue());
+						seen = true;
+					}
+
 					if (gb.Seen('P'))
 					{
 						const unsigned int protocol = gb.GetUIValue();
@@ -3733,7 +3812,7 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 #endif
 
 			case 593: // Configure dynamic ringing cancellation
-				result = reprap.GetMove().GetAxisShaper().Configure(gb, reply);
+				result = reprap.GetMove().ConfigureInputShaping(gb, reply);
 				break;
 
 #if SUPPORT_ASYNC_MOVES
@@ -3743,6 +3822,13 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 #endif
 
 			case 595:	// Configure movement queue size
+#if SUPPORT_MOVE_LOG
+				if (gb.GetCommandFraction() == 1)
+				{
+					result = reprap.GetMove().GetMoveLog().Configure(gb, reply);	// record the parameters of completed moves
+					break;
+				}
+#endif
 				result = reprap.GetMove().ConfigureMovementQueue(gb, reply);
 				break;
 
@@ -4437,12 +4523,27 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 
 #if HAS_STALL_DETECT || SUPPORT_CAN_EXPANSION
 			case 915:
+# if SUPPORT_STALLGUARD_LOG
+				if (gb.GetCommandFraction() == 1)
+				{
+					result = StallGuardLog::HandleM915Point1(gb, reply);		// capture StallGuard values
+					break;
+				}
+# endif
 				result = platform.ConfigureStallDetection(gb, reply, outBuf);
 				break;
 #endif
 
 #if HAS_MASS_STORAGE || HAS_SBC_INTERFACE
 			case 916:
+#if SUPPORT_RESUME_SNAPSHOT
+				if (!resumeSnapshot.IsActive() && !WriteResumeFileFromSnapshot())		// if the resume snapshot is more recent than resurrect.g, recreate resurrect.g from it
+				{
+					reply.printf("Failed to create %s from resume snapshot", RESUME_AFTER_POWER_FAIL_G);
+					result = GCodeResult::error;
+				}
+				else
+#endif
 				if (!platform.SysFileExists(RESUME_AFTER_POWER_FAIL_G))
 				{
 					reply.copy("No resume file found");
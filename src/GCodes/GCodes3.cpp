@@ -313,13 +313,32 @@ GCodeResult GCodes::DefineGrid(GCodeBuffer& gb, const StringRef &reply) THROWS(G
 	float radius = -1.0;
 	gb.TryGetFValue('R', radius, seenR);
 
+#if SUPPORT_BICUBIC_MESH
+	// The interpolation mode belongs to the height map and is kept when the grid is redefined, so it may be given on its own
+	bool seenI = false;
+	if (gb.Seen('I'))
+	{
+		seenI = true;
+		reprap.GetMove().AccessHeightMap().UseBicubicInterpolation(gb.GetLimitedUIValue('I', 2) != 0);
+	}
+#endif
+
 	if (!axesSeen && !seenR && !seenS && !seenP)
 	{
+#if SUPPORT_BICUBIC_MESH
+		if (seenI)
+		{
+			return GCodeResult::ok;
+		}
+#endif
 		// Just print the existing grid parameters
 		if (defaultGrid.IsValid())
 		{
 			reply.copy("Grid: ");
 			defaultGrid.PrintParameters(reply);
+#if SUPPORT_BICUBIC_MESH
+			reply.catf(", %s interpolation", (reprap.GetMove().AccessHeightMap().UsingBicubicInterpolation()) ? "bicubic" : "bilinear");
+#endif
 		}
 		else
 		{
@@ -415,8 +434,8 @@ GCodeResult GCodes::DefineGrid(GCodeBuffer& gb, const StringRef &reply) THROWS(G
 
 #if HAS_MASS_STORAGE || HAS_SBC_INTERFACE || HAS_EMBEDDED_FILES
 
-// Handle M37 to simulate a whole file
-GCodeResult GCodes::SimulateFile(GCodeBuffer& gb, const StringRef &reply, const StringRef& file, bool updateFile)
+// Handle M37 to simulate a whole file. The simulation mode is normally 'normal', but it may be 'debug' to generate the steps too, for example to benchmark them.
+GCodeResult GCodes::SimulateFile(GCodeBuffer& gb, const StringRef &reply, const StringRef& file, bool updateFile, SimulationMode simMode)
 {
 	if (reprap.GetPrintMonitor().IsPrinting())
 	{
@@ -445,7 +464,7 @@ GCodeResult GCodes::SimulateFile(GCodeBuffer& gb, const StringRef &reply, const
 # else
 		updateFileWhenSimulationComplete = updateFile;
 # endif
-		simulationMode = SimulationMode::normal;
+		simulationMode = simMode;
 		reprap.GetMove().Simulate(simulationMode);
 		reprap.GetPrintMonitor().StartingPrint(file.c_str());
 		StartPrinting(true);
@@ -1143,10 +1162,37 @@ GCodeResult GCodes::UpdateFirmware(GCodeBuffer& gb, const StringRef &reply)
 #if SUPPORT_CAN_EXPANSION
 	if (gb.Seen('B'))
 	{
-		const uint32_t boardNumber = gb.GetUIValue();
-		if (boardNumber != CanInterface::GetCanAddress())
+		// The B parameter may be a list of expansion board addresses. We tell all the boards to update before any of them finishes,
+		// so that they fetch their firmware from us in parallel.
+		uint32_t boardNumbers[MaxCanBoards];
+		size_t numBoards = ARRAY_SIZE(boardNumbers);
+		gb.GetUnsignedArray(boardNumbers, numBoards, false);
+		if (numBoards == 1)
 		{
-			return reprap.GetExpansion().UpdateRemoteFirmware(boardNumber, gb, reply);
+			if (boardNumbers[0] != CanInterface::GetCanAddress())
+			{
+				return reprap.GetExpansion().UpdateRemoteFirmware(boardNumbers[0], gb, reply);
+			}
+		}
+		else
+		{
+			GCodeResult rslt = GCodeResult::ok;
+			for (size_t i = 0; i < numBoards; ++i)
+			{
+				if (boardNumbers[i] == CanInterface::GetCanAddress())
+				{
+					reply.lcatf("Board %" PRIu32 ": the main board can't be updated together with expansion boards", boardNumbers[i]);
+					rslt = GCodeResult::error;
+					continue;
+				}
+				String<StringLength100> boardReply;
+				rslt = max(rslt, reprap.GetExpansion().UpdateRemoteFirmware(boardNumbers[i], gb, boardReply.GetRef()));
+				if (!boardReply.IsEmpty())
+				{
+					reply.lcatf("Board %" PRIu32 ": %s", boardNumbers[i], boardReply.c_str());
+				}
+			}
+			return rslt;
 		}
 	}
 #endif
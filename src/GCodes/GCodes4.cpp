@@ -625,7 +625,12 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 			const GridDefinition& grid = move.AccessHeightMap().GetGrid();
 			const float axis0Coord = grid.GetCoordinate(0, gridAxis0index);
 			const float axis1Coord = grid.GetCoordinate(1, gridAxis1index);
-			if (grid.IsInRadius(axis0Coord, axis1Coord))
+			const bool wanted = !move.AccessHeightMap().IsHeightSet(gridAxis0index, gridAxis1index)		// an earlier Z probe may have probed this point already
+								&& (   (gridAdaptiveTolerance <= 0.0)
+									|| ((gridAdaptiveRefining)
+										? gridPointsToProbe.IsBitSet(gridAxis1index * grid.NumAxisPoints(0) + gridAxis0index)
+										: HeightMap::IsCoarsePoint(gridAxis0index, grid.NumAxisPoints(0), gridAdaptiveStride) && HeightMap::IsCoarsePoint(gridAxis1index, grid.NumAxisPoints(1), gridAdaptiveStride)));
+			if (wanted && grid.IsInRadius(axis0Coord, axis1Coord))
 			{
 				const size_t axis0Num = grid.GetAxisNumber(0);
 				const size_t axis1Num = grid.GetAxisNumber(1);
@@ -648,12 +653,15 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 					moveState.linearAxesMentioned = moveState.rotationalAxesMentioned = true;		// assume that both linear and rotational axes might be moving
 					NewSingleSegmentMoveAvailable();
 
-					InitialiseTaps(false);
+					InitialiseTaps(zp->HasTwoProbingSpeeds());
 					gb.AdvanceState();
 				}
 				else
 				{
-					platform.MessageF(WarningMessage, "Skipping grid point %c=%.1f, %c=%.1f because Z probe cannot reach it\n", grid.GetAxisLetter(0), (double)axis0Coord, grid.GetAxisLetter(1), (double)axis1Coord);
+					if (gridProbeIndex + 1 == numGridProbes)											// if there is another Z probe to come then it may be able to reach the point
+					{
+						platform.MessageF(WarningMessage, "Skipping grid point %c=%.1f, %c=%.1f because Z probe cannot reach it\n", grid.GetAxisLetter(0), (double)axis0Coord, grid.GetAxisLetter(1), (double)axis1Coord);
+					}
 					gb.SetState(GCodeState::gridProbing6);
 				}
 			}
@@ -738,6 +746,7 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 		if (LockMovementAndWaitForStandstill(gb))
 		{
 			doingManualBedProbe = false;
+			hadProbingError = false;
 			++tapsDone;
 			reprap.GetHeat().SuspendHeaters(false);
 			const auto zp = platform.GetZProbeOrDefault(currentZProbeNumber);
@@ -757,9 +766,11 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 					break;
 				}
 
-				// Grid probing never does an additional fast tap, so we can always include this tap in the average
-				g30zHeightError = moveState.coords[Z_AXIS] - zp->GetActualTriggerHeight();
-				g30zHeightErrorSum += g30zHeightError;
+				if (tapsDone > 0)								// don't accumulate the result if we are doing fast-then-slow probing and this was the fast probe
+				{
+					g30zHeightError = moveState.coords[Z_AXIS] - zp->GetActualTriggerHeight();
+					g30zHeightErrorSum += g30zHeightError;
+				}
 			}
 
 			gb.AdvanceState();
@@ -771,11 +782,11 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 		break;
 
 	case GCodeState::gridProbing4a:	// ready to lift the probe after probing the current grid probe point
-		// Move back up to the dive height
+		// Move back up to the dive height, or less if we are going to tap again
 		SetMoveBufferDefaults();
 		{
 			const auto zp = platform.GetZProbeOrDefault(currentZProbeNumber);
-			moveState.coords[Z_AXIS] = zp->GetStartingHeight();
+			moveState.coords[Z_AXIS] = GetLiftHeightAfterTap(*zp);
 			moveState.feedRate = zp->GetTravelSpeed();
 		}
 		moveState.linearAxesMentioned = true;
@@ -789,7 +800,7 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 			// See whether we need to do any more taps
 			const auto zp = platform.GetZProbeOrDefault(currentZProbeNumber);
 			bool acceptReading = false;
-			if (zp->GetMaxTaps() < 2)
+			if (zp->GetMaxTaps() < 2 && tapsDone == 1)
 			{
 				acceptReading = true;
 			}
@@ -834,7 +845,7 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 
 	case GCodeState::gridProbing6:	// ready to compute the next probe point
 		{
-			const HeightMap& hm = reprap.GetMove().AccessHeightMap();
+			HeightMap& hm = reprap.GetMove().AccessHeightMap();
 			if (gridAxis1index & 1)
 			{
 				// Odd row, so decreasing X
@@ -860,6 +871,39 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 				}
 			}
 
+			if (gridAxis1index == hm.GetGrid().NumAxisPoints(1) && gridProbeIndex + 1 < numGridProbes)
+			{
+				// Done all the points that this Z probe can reach, so let the next one try the others
+				++gridProbeIndex;
+				gb.SetState(GCodeState::gridProbingChangeProbe);
+				RetractZProbe(gb);
+				break;
+			}
+
+			if (gridAxis1index == hm.GetGrid().NumAxisPoints(1) && gridAdaptiveTolerance > 0.0 && !gridAdaptiveRefining)
+			{
+				// Done the first pass of adaptive probing, so see which points we need to probe in the second pass
+				gridAdaptiveRefining = true;
+				unsigned int numToProbe;
+				gridPointsInterpolated = hm.RefineAdaptive(gridAdaptiveStride, gridAdaptiveTolerance, gridPointsToProbe, numToProbe);
+				if (numToProbe != 0)
+				{
+					if (numGridProbes > 1)
+					{
+						// Start the second pass with the first Z probe again
+						gridProbeIndex = 0;
+						gb.SetState(GCodeState::gridProbingChangeProbe);
+						RetractZProbe(gb);
+					}
+					else
+					{
+						gridAxis0index = gridAxis1index = 0;
+						gb.SetState(GCodeState::gridProbing1);
+					}
+					break;
+				}
+			}
+
 			if (gridAxis1index == hm.GetGrid().NumAxisPoints(1))
 			{
 				// Done all the points
@@ -883,7 +927,11 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 			{
 				reprap.GetMove().SetLatestMeshDeviation(deviation);
 				reply.printf("%" PRIu32 " points probed, min error %.3f, max error %.3f, mean %.3f, deviation %.3f\n",
-								numPointsProbed, (double)minError, (double)maxError, (double)deviation.GetMean(), (double)deviation.GetDeviationFromMean());
+								numPointsProbed - gridPointsInterpolated, (double)minError, (double)maxError, (double)deviation.GetMean(), (double)deviation.GetDeviationFromMean());
+				if (gridPointsInterpolated != 0)
+				{
+					reply.catf("%u points interpolated by adaptive probing\n", gridPointsInterpolated);
+				}
 #if HAS_MASS_STORAGE || HAS_SBC_INTERFACE
 				if (TrySaveHeightMap(DefaultHeightMapFile, reply))
 				{
@@ -910,6 +958,157 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 		gb.SetState(GCodeState::normal);
 		break;
 
+	case GCodeState::gridProbingChangeProbe:
+		// We have retracted the previous Z probe, so deploy the next one and start again at the first grid point
+		currentZProbeNumber = gridProbeNumbers[gridProbeIndex];
+		gridAxis0index = gridAxis1index = 0;
+		gb.SetState(GCodeState::gridProbing1);
+		if (platform.GetZProbeOrDefault(currentZProbeNumber)->GetProbeType() != ZProbeType::blTouch)
+		{
+			DeployZProbe(gb);
+		}
+		break;
+
+	// States used for scanning the grid. We sweep each row at the trigger height and convert the probe reading to a height error as we pass each point.
+	// The live coordinates are updated when each move completes, so we queue a separate move to each point and take the reading when we see that it has been reached.
+	// Odd rows are scanned in the direction of decreasing axis 0 coordinate, like when we probe the grid.
+	case GCodeState::gridScanning1:		// ready to move to the start of the next row
+		{
+			Move& move = reprap.GetMove();
+			const GridDefinition& grid = move.AccessHeightMap().GetGrid();
+			const auto zp = platform.GetZProbeOrDefault(currentZProbeNumber);
+			const size_t axis0Num = grid.GetAxisNumber(0);
+			const size_t axis1Num = grid.GetAxisNumber(1);
+			AxesBitmap axes;
+			axes.SetBit(axis0Num);
+			axes.SetBit(axis1Num);
+			float axesCoords[MaxAxes];
+			memcpy(axesCoords, moveState.coords, sizeof(axesCoords));				// copy current coordinates of all other axes in case they are relevant to IsAccessibleProbePoint
+			axesCoords[axis1Num] = grid.GetCoordinate(1, gridAxis1index) - zp->GetOffset(axis1Num);
+			axesCoords[Z_AXIS] = zp->GetActualTriggerHeight();
+			bool accessible = true;
+			for (size_t i = 0; accessible && i < grid.NumAxisPoints(0); ++i)
+			{
+				axesCoords[axis0Num] = grid.GetCoordinate(0, i) - zp->GetOffset(axis0Num);
+				accessible = move.IsAccessibleProbePoint(axesCoords, axes);
+			}
+			if (!accessible)
+			{
+				gb.LatestMachineState().SetError("Z probe cannot reach every point in a row of the grid, so the grid cannot be scanned");
+				gb.SetState(GCodeState::checkError);
+				RetractZProbe(gb);
+				break;
+			}
+
+			gridAxis0index = (gridAxis1index & 1) ? grid.NumAxisPoints(0) - 1 : 0;
+			gridScanQueuedIndex = gridAxis0index;
+			SetMoveBufferDefaults();
+			moveState.coords[axis0Num] = grid.GetCoordinate(0, gridAxis0index) - zp->GetOffset(axis0Num);
+			moveState.coords[axis1Num] = axesCoords[axis1Num];
+			moveState.coords[Z_AXIS] = (gridAxis1index == 0) ? zp->GetStartingHeight() : zp->GetActualTriggerHeight();	// we are already at the scanning height if this isn't the first row
+			moveState.feedRate = zp->GetTravelSpeed();
+			moveState.linearAxesMentioned = moveState.rotationalAxesMentioned = true;		// assume that both linear and rotational axes might be moving
+			NewSingleSegmentMoveAvailable();
+			gb.AdvanceState();
+		}
+		break;
+
+	case GCodeState::gridScanning2:		// moving to the start of the row
+		if (LockMovementAndWaitForStandstill(gb))
+		{
+			if (gridAxis1index == 0)
+			{
+				// Move down to the scanning height
+				SetMoveBufferDefaults();
+				const auto zp = platform.GetZProbeOrDefault(currentZProbeNumber);
+				moveState.coords[Z_AXIS] = zp->GetActualTriggerHeight();
+				moveState.feedRate = zp->GetTravelSpeed();
+				moveState.linearAxesMentioned = true;
+				NewSingleSegmentMoveAvailable();
+			}
+			gb.AdvanceState();
+		}
+		break;
+
+	case GCodeState::gridScanning3:		// moving to the scanning height
+		if (LockMovementAndWaitForStandstill(gb))
+		{
+			lastProbedTime = millis();														// start the recovery timer
+			gb.AdvanceState();
+		}
+		break;
+
+	case GCodeState::gridScanning4:		// at the start of the row, waiting for the probe to recover
+		{
+			const auto zp = platform.GetZProbeOrDefault(currentZProbeNumber);
+			if (millis() - lastProbedTime >= (uint32_t)(zp->GetRecoveryTime() * SecondsToMillis))
+			{
+				const GridDefinition& grid = reprap.GetMove().AccessHeightMap().GetGrid();
+				if (grid.IsInRadius(grid.GetCoordinate(0, gridAxis0index), grid.GetCoordinate(1, gridAxis1index)))
+				{
+					reprap.GetMove().AccessHeightMap().SetGridHeight(gridAxis0index, gridAxis1index, -zp->GetScanHeightOffset(zp->GetReading()));
+				}
+				gb.AdvanceState();
+			}
+		}
+		break;
+
+	case GCodeState::gridScanning5:		// scanning the row
+		{
+			Move& move = reprap.GetMove();
+			const GridDefinition& grid = move.AccessHeightMap().GetGrid();
+			const auto zp = platform.GetZProbeOrDefault(currentZProbeNumber);
+			const size_t axis0Num = grid.GetAxisNumber(0);
+			const bool decreasing = (gridAxis1index & 1) != 0;
+			const size_t lastIndex = (decreasing) ? 0 : grid.NumAxisPoints(0) - 1;
+
+			// If we have reached the next point then record its height
+			if (gridAxis0index != gridScanQueuedIndex)
+			{
+				const size_t nextIndex = (decreasing) ? gridAxis0index - 1 : gridAxis0index + 1;
+				const float target = grid.GetCoordinate(0, nextIndex) - zp->GetOffset(axis0Num);
+				const float liveCoord = move.LiveCoordinate(axis0Num, reprap.GetCurrentTool());
+				constexpr float Tolerance = 0.01;
+				if ((decreasing) ? liveCoord <= target + Tolerance : liveCoord >= target - Tolerance)
+				{
+					gridAxis0index = nextIndex;
+					if (grid.IsInRadius(grid.GetCoordinate(0, gridAxis0index), grid.GetCoordinate(1, gridAxis1index)))
+					{
+						move.AccessHeightMap().SetGridHeight(gridAxis0index, gridAxis1index, -zp->GetScanHeightOffset(zp->GetReading()));
+					}
+				}
+			}
+
+			if (gridAxis0index == lastIndex)
+			{
+				// Finished this row
+				++gridAxis1index;
+				if (gridAxis1index == grid.NumAxisPoints(1))
+				{
+					// Done all the rows
+					gb.SetState(GCodeState::gridProbing7);
+					RetractZProbe(gb);
+				}
+				else
+				{
+					gb.SetState(GCodeState::gridScanning1);
+				}
+				break;
+			}
+
+			// Queue the move to the following point as soon as the previous move has been taken, so that the head doesn't slow down between the points
+			if (gridScanQueuedIndex != lastIndex && moveState.segmentsLeft == 0)
+			{
+				gridScanQueuedIndex = (decreasing) ? gridScanQueuedIndex - 1 : gridScanQueuedIndex + 1;
+				SetMoveBufferDefaults();
+				moveState.coords[axis0Num] = grid.GetCoordinate(0, gridScanQueuedIndex) - zp->GetOffset(axis0Num);
+				moveState.feedRate = zp->GetScanSpeed();
+				moveState.linearAxesMentioned = moveState.rotationalAxesMentioned = true;
+				NewSingleSegmentMoveAvailable();
+			}
+		}
+		break;
+
 	// States used for G30 probing
 	case GCodeState::probingAtPoint0:
 		// Initial state when executing G30 with a P parameter. Start by moving to the dive height at the current position.
@@ -937,7 +1136,7 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 			moveState.linearAxesMentioned = moveState.rotationalAxesMentioned = true;		// assume that both linear and rotational axes might be moving
 			NewSingleSegmentMoveAvailable();
 
-			InitialiseTaps(false);
+			InitialiseTaps(zp->HasTwoProbingSpeeds());
 			gb.AdvanceState();
 		}
 		break;
@@ -1102,11 +1301,12 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 		break;
 
 	case GCodeState::probingAtPoint4a:
-		// Move back up to the dive height before we change anything, in particular before we adjust leadscrews
+		// Move back up to the dive height before we change anything, in particular before we adjust leadscrews.
+		// If we are going to tap again at this point, we may only need to move up a little.
 		SetMoveBufferDefaults();
 		{
 			const auto zp = platform.GetZProbeOrDefault(currentZProbeNumber);
-			moveState.coords[Z_AXIS] = zp->GetStartingHeight();
+			moveState.coords[Z_AXIS] = GetLiftHeightAfterTap(*zp);
 			moveState.feedRate = zp->GetTravelSpeed();
 		}
 		moveState.linearAxesMentioned = true;
@@ -1194,13 +1394,43 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 			}
 			else if (g30SValue >= -1)
 			{
-				if (reprap.GetMove().FinishedBedProbing(g30SValue, reply))
+				if (g30LevellingPassesDone != 0 && (size_t)g30ProbePointIndex + 1 < g30LevellingNumPoints)
+				{
+					// We are probing the points again for another calibration pass and there are more to do
+					++g30ProbePointIndex;
+					StartProbingAtPoint(gb);
+					break;
+				}
+
+				// Only repeat the calibration if all the points were probed, because we can't measure the heights of points that were given Z coordinates
+				Move& move = reprap.GetMove();
+				const size_t numPoints = move.GetProbePoints().NumberOfProbePoints();
+				bool allPointsProbed = (numPoints != 0);
+				for (size_t i = 0; i < numPoints; ++i)
+				{
+					if (!move.GetProbePoints().PointWasCorrected(i))
+					{
+						allPointsProbed = false;
+					}
+				}
+
+				if (move.FinishedBedProbing(g30SValue, reply))
 				{
 					stateMachineResult = GCodeResult::error;
 				}
-				else if (reprap.GetMove().GetKinematics().SupportsAutoCalibration())
+				else if (move.GetKinematics().SupportsAutoCalibration())
 				{
 					zDatumSetByProbing = true;			// if we successfully auto calibrated or adjusted leadscrews, we've set the Z datum by probing
+					if (allPointsProbed && move.GetKinematics().NeedsAnotherCalibrationPass(++g30LevellingPassesDone, reply))
+					{
+						// Report this pass and probe all the points again, which doesn't need the bed.g macro to be run again
+						platform.MessageF(gb.GetResponseMessageType(), "%s\n", reply.c_str());
+						reply.Clear();
+						g30LevellingNumPoints = numPoints;
+						g30ProbePointIndex = 0;
+						StartProbingAtPoint(gb);
+						break;
+					}
 				}
 			}
 			gb.SetState(GCodeState::normal);
@@ -1349,7 +1579,7 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 				reprap.GetMove().GetCurrentUserPosition(moveState.coords, 0, moveState.tool);
 				moveState.coords[Z_AXIS] += tool->GetRetractHop();
 				moveState.feedRate = platform.MaxFeedrate(Z_AXIS);
-				moveState.filePos = (&gb == fileGCode) ? gb.GetFilePosition() : noFilePosition;
+				SetMoveFileDetails(gb);
 				moveState.canPauseAfter = false;			// don't pause after a retraction because that could cause too much retraction
 				moveState.currentZHop = tool->GetRetractHop();
 				moveState.linearAxesMentioned = true;
@@ -1374,7 +1604,7 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 					moveState.coords[ExtruderToLogicalDrive(tool->GetDrive(i))] = tool->GetRetractLength() + tool->GetRetractExtra();
 				}
 				moveState.feedRate = tool->GetUnRetractSpeed() * tool->DriveCount();
-				moveState.filePos = (&gb == fileGCode) ? gb.GetFilePosition() : noFilePosition;
+				SetMoveFileDetails(gb);
 				moveState.canPauseAfter = true;
 				NewSingleSegmentMoveAvailable();
 			}
@@ -1475,6 +1705,19 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 				const uint32_t ms = millis() - timingStartMillis;
 				const float fileMbytes = (float)timingBytesWritten/(float)(1024 * 1024);
 				const float mbPerSec = (fileMbytes * 1000.0)/(float)ms;
+				if (timingReadsRequested != 0)
+				{
+					platform.MessageF(gb.GetResponseMessageType(), "SD read speed for %.1fMByte file was %.2fMBytes/sec\n", (double)fileMbytes, (double)mbPerSec);
+					timingReadBuffer = new char[FileGCodeInputBufferSize];
+					timingLatencyCounts = new uint16_t[SdLatencyBuckets];
+					memset(timingLatencyCounts, 0, SdLatencyBuckets * sizeof(uint16_t));
+					platform.Message(gb.GetResponseMessageType(), "Testing SD card read latency...\n");
+					timingBytesWritten = 0;						// this counts the reads in the latency test
+					timingMaxReadTicks = 0;
+					timingFilePos = sdTimingFile->Position();
+					gb.SetState(GCodeState::timingSDlatency);
+					break;
+				}
 				sdTimingFile->Close();
 				reply.printf("SD read speed for %.1fMByte file was %.2fMBytes/sec", (double)fileMbytes, (double)mbPerSec);
 				platform.Delete(Platform::GetGCodeDir(), TimingFileName);
@@ -1495,6 +1738,86 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 			readThisTime += bytesToRead;
 		}
 		break;
+
+	// Replay the reads that FileGCodeInput::ReadFromFile does when reading a print file. Most reads carry on from the previous one and are of half or all
+	// of the buffer, shortened so that they end at a sector boundary. Occasionally we seek to a random position, as happens when a macro is run.
+	// We time each seek and read together because both hold up the main task.
+	case GCodeState::timingSDlatency:
+		for (uint32_t readThisTime = 0; readThisTime < 100 * 1024; )
+		{
+			if (timingBytesWritten >= timingReadsRequested)
+			{
+				sdTimingFile->Close();
+				platform.Delete(Platform::GetGCodeDir(), TimingFileName);
+
+				// Convert the histogram to percentiles, reporting the upper bound of the bucket that the percentile falls in
+				constexpr unsigned int PerMille[] = { 500, 900, 990, 999 };
+				reply.printf("SD read latency for %" PRIu32 " reads (ms):", timingBytesWritten);
+				size_t bucket = 0;
+				uint32_t readsSoFar = timingLatencyCounts[0];
+				for (unsigned int pm : PerMille)
+				{
+					const uint32_t readsNeeded = (timingBytesWritten * pm + 999)/1000;
+					while (readsSoFar < readsNeeded && bucket + 1 < SdLatencyBuckets)
+					{
+						++bucket;
+						readsSoFar += timingLatencyCounts[bucket];
+					}
+					if (bucket + 1 < SdLatencyBuckets)
+					{
+						reply.catf(" %u.%u%%<%.1f", pm/10, pm % 10, (double)((bucket + 1) * SdLatencyBucketMicroseconds) * 0.001);
+					}
+					else
+					{
+						reply.catf(" %u.%u%%>=%.1f", pm/10, pm % 10, (double)(bucket * SdLatencyBucketMicroseconds) * 0.001);
+					}
+				}
+				reply.catf(" max %.2f", (double)((float)timingMaxReadTicks * (1000.0/(float)StepClockRate)));
+				FreeSDLatencyBuffers();
+				gb.SetState(GCodeState::normal);
+				break;
+			}
+
+			if (random(SdLatencySeekOneIn) == 0)
+			{
+				timingFilePos = random(timingBytesRequested - FileGCodeInputBufferSize);
+			}
+			else if (timingFilePos + FileGCodeInputBufferSize > timingBytesRequested)
+			{
+				timingFilePos = 0;
+			}
+			size_t bytesToRead = (random(2) == 0) ? FileGCodeInputBufferSize/2 : FileGCodeInputBufferSize;
+			const size_t excess = (timingFilePos + bytesToRead) % FileGCodeInputReadAlignment;
+			if (bytesToRead > excess)
+			{
+				bytesToRead -= excess;
+			}
+
+			const uint32_t startTicks = StepTimer::GetTimerTicks();
+			const bool ok = (timingFilePos == sdTimingFile->Position() || sdTimingFile->Seek(timingFilePos))
+							&& sdTimingFile->Read(timingReadBuffer, bytesToRead) == (int)bytesToRead;
+			const uint32_t ticks = StepTimer::GetTimerTicks() - startTicks;
+			if (!ok)
+			{
+				sdTimingFile->Close();
+				platform.Delete(Platform::GetGCodeDir(), TimingFileName);
+				FreeSDLatencyBuffers();
+				gb.LatestMachineState().SetError("Failed to read from timing file");
+				gb.SetState(GCodeState::normal);
+				break;
+			}
+
+			const uint32_t microseconds = (uint32_t)(((uint64_t)ticks * 1'000'000u)/StepClockRate);
+			++timingLatencyCounts[min<uint32_t>(microseconds/SdLatencyBucketMicroseconds, SdLatencyBuckets - 1)];
+			if (ticks > timingMaxReadTicks)
+			{
+				timingMaxReadTicks = ticks;
+			}
+			timingFilePos += bytesToRead;
+			++timingBytesWritten;
+			readThisTime += bytesToRead;
+		}
+		break;
 #endif
 
 #if HAS_SBC_INTERFACE
@@ -317,7 +317,7 @@ bool ObjectTracker::WriteObjectDirectory(FileStore *f) const noexcept
 // Create a new entry in the object directory
 void ObjectDirectoryEntry::Init(const char *label) noexcept
 {
-	name.Assign(label);
+	name.AssignInterned(label);
 	x[0] = x[1] = y[0] = y[1] = std::numeric_limits<int16_t>::min();
 }
 
@@ -370,7 +370,7 @@ bool ObjectDirectoryEntry::UpdateObjectCoordinates(const float coords[], AxesBit
 
 void ObjectDirectoryEntry::SetName(const char *label) noexcept
 {
-	name.Assign(label);
+	name.AssignInterned(label);
 }
 
 // Update the min and max object coordinates to include the coordinates passed
@@ -44,6 +44,7 @@ public:
 	GCodeResult HandleM486(GCodeBuffer& gb, const StringRef &reply, OutputBuffer*& buf) THROWS(GCodeException);	// Handle M486
 	const RestorePoint& GetInitialPosition() const noexcept { return rp; }
 	void SetVirtualTool(int toolNum) noexcept { virtualToolNumber = toolNum; }
+	int GetCurrentObjectNumber() const noexcept { return currentObjectNumber; }
 
 #if TRACK_OBJECT_NAMES
 	void StartObject(GCodeBuffer& gb, const char *label) noexcept;
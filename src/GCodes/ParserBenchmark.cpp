@@ -0,0 +1,195 @@
+/*
+ * ParserBenchmark.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "ParserBenchmark.h"
+
+#if SUPPORT_PARSER_BENCHMARK && HAS_MASS_STORAGE
+
+#include "GCodeBuffer/GCodeBuffer.h"
+#include "GCodeBuffer/ExpressionParser.h"
+#include <Platform/RepRap.h>
+#include <Platform/Platform.h>
+#include <Platform/Heap.h>
+#include <Movement/StepTimer.h>
+#include <Storage/FileStore.h>
+#include <Storage/CRC32.h>
+
+namespace ParserBenchmark
+{
+	struct MetaKeyword
+	{
+		const char *_ecv_array name;
+		bool isAssignment;								// true if the expression follows '=' instead of the keyword
+	};
+
+	// The meta commands that have an expression. The others are parsed as if they were G-code commands, which is what their cost is closest to.
+	static constexpr MetaKeyword metaKeywords[] =
+	{
+		{ "if", false }, { "elif", false }, { "while", false }, { "echo", false }, { "abort", false },
+		{ "var", true }, { "global", true }, { "set", true }
+	};
+
+	struct Results
+	{
+		CRC32 crc;										// CRC of the parse results
+		uint32_t numLines = 0;
+		uint32_t numCommands = 0;
+		uint32_t numMetaCommands = 0;
+		uint32_t numParameters = 0;
+		uint32_t numErrors = 0;							// how many parameters or expressions threw an exception, for example because they were strings
+		uint32_t parseTicks = 0;						// step clocks spent parsing, not including reading the file
+	};
+
+	static GCodeBuffer *benchmarkGCode = nullptr;		// created when first needed and kept, because GCodeBuffers are never deleted
+	static char fileBuffer[ParserBenchmarkBufferSize];
+	static char lineBuffer[ParserBenchmarkMaxLineLength];
+
+	// If the line is a meta command that has an expression then return a pointer to the expression, else return nullptr
+	static const char *_ecv_array null FindMetaExpression(const char *_ecv_array line) noexcept
+	{
+		while (*line == ' ' || *line == '\t')
+		{
+			++line;
+		}
+		for (const MetaKeyword& kw : metaKeywords)
+		{
+			const size_t len = strlen(kw.name);
+			if (StringStartsWith(line, kw.name) && (line[len] == ' ' || line[len] == '\t'))
+			{
+				if (kw.isAssignment)
+				{
+					const char *_ecv_array const equals = strchr(line + len, '=');
+					return (equals == nullptr) ? nullptr : equals + 1;
+				}
+				return line + len;
+			}
+		}
+		return nullptr;
+	}
+
+	// Parse one line without executing it, adding what we found to the CRC
+	static void ProcessLine(const char *_ecv_array line, size_t length, Results& res) noexcept
+	{
+		++res.numLines;
+		const char *_ecv_array const expression = FindMetaExpression(line);
+		if (expression != nullptr)
+		{
+			++res.numMetaCommands;
+			try
+			{
+				ExpressionParser parser(*benchmarkGCode, expression, line + length);
+				const ExpressionValue val = parser.Parse();
+				String<StringLength100> valText;
+				val.AppendAsString(valText.GetRef());
+				res.crc.Update(valText.c_str(), valText.strlen());
+			}
+			catch (const GCodeException&)
+			{
+				++res.numErrors;
+			}
+			return;
+		}
+
+		benchmarkGCode->PutAndDecode(line, length);
+		const char cl = benchmarkGCode->GetCommandLetter();
+		if (cl != 'G' && cl != 'M' && cl != 'T')
+		{
+			return;										// blank line, comment or unknown command
+		}
+
+		++res.numCommands;
+		const int commandNumber = benchmarkGCode->GetCommandNumber();
+		res.crc.Update(cl);
+		res.crc.Update(reinterpret_cast<const char *>(&commandNumber), sizeof(commandNumber));
+		for (char c = 'A'; c <= 'Z'; ++c)
+		{
+			if (benchmarkGCode->Seen(c))
+			{
+				++res.numParameters;
+				try
+				{
+					const float val = benchmarkGCode->GetFValue();
+					res.crc.Update(c);
+					res.crc.Update(reinterpret_cast<const char *>(&val), sizeof(val));
+				}
+				catch (const GCodeException&)
+				{
+					++res.numErrors;
+				}
+			}
+		}
+	}
+
+	// Handle M122 P110 F"filename"
+	GCodeResult Run(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
+	{
+		String<MaxFilenameLength> fileName;
+		gb.MustSee('F');
+		gb.GetQuotedString(fileName.GetRef());
+		FileStore * const f = reprap.GetPlatform().OpenFile(Platform::GetGCodeDir(), fileName.c_str(), OpenMode::read);
+		if (f == nullptr)
+		{
+			reply.printf("Failed to open file %s", fileName.c_str());
+			return GCodeResult::error;
+		}
+
+		if (benchmarkGCode == nullptr)
+		{
+			benchmarkGCode = new GCodeBuffer(GCodeChannel::File, nullptr, nullptr, GenericMessage);
+		}
+
+		Results res;
+		size_t lineLength = 0;
+		bool complete = false;
+		const uint32_t startMillis = millis();
+		const uint32_t startAllocations = StringHandle::GetNumAllocations();
+		do
+		{
+			const int bytesRead = f->Read(fileBuffer, sizeof(fileBuffer));
+			if (bytesRead <= 0)
+			{
+				if (lineLength != 0)
+				{
+					ProcessLine(lineBuffer, lineLength, res);	// the last line had no newline
+				}
+				complete = true;
+				break;
+			}
+
+			const uint32_t startTicks = StepTimer::GetTimerTicks();
+			for (int i = 0; i < bytesRead; ++i)
+			{
+				const char c = fileBuffer[i];
+				if (c == '\n')
+				{
+					lineBuffer[lineLength] = 0;
+					ProcessLine(lineBuffer, lineLength, res);
+					lineLength = 0;
+				}
+				else if (lineLength + 1 < sizeof(lineBuffer))
+				{
+					lineBuffer[lineLength++] = c;				// discard the end of the line if it is too long, because we only need representative lines
+				}
+			}
+			res.parseTicks += StepTimer::GetTimerTicks() - startTicks;
+		} while (millis() - startMillis < ParserBenchmarkMaxMillis);
+
+		f->Close();
+		const uint32_t numAllocations = StringHandle::GetNumAllocations() - startAllocations;
+		const float parseSeconds = (float)res.parseTicks * (1.0/(float)StepClockRate);
+		reply.printf("%s %" PRIu32 " lines: %" PRIu32 " commands, %" PRIu32 " meta commands, %" PRIu32 " parameters, %" PRIu32 " errors"
+						"\nParse time %.3f sec, %.0f lines/sec, %.2f heap allocations/line, result CRC %08" PRIx32,
+						(complete) ? "Parsed all" : "Stopped after", res.numLines, res.numCommands, res.numMetaCommands, res.numParameters, res.numErrors,
+						(double)parseSeconds, (parseSeconds > 0.0) ? (double)(res.numLines/parseSeconds) : 0.0,
+						(res.numLines == 0) ? 0.0 : (double)numAllocations/res.numLines, res.crc.Get());
+		return GCodeResult::ok;
+	}
+}
+
+#endif
+
+// End
@@ -0,0 +1,28 @@
+/*
+ * ParserBenchmark.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  This times the G-code parser and the expression evaluator on a file, for M122 P110 F"filename". Each line of the file is either decoded
+ *  by a GCodeBuffer of its own and all its parameters are read, or if it is a meta command then its expression is evaluated; nothing is executed.
+ *  We report the lines per second, the string heap allocations per line and a CRC of everything that was parsed. The CRC depends only on
+ *  the parse results, so comparing it with the value given by a previous build shows whether a change to the parser has altered its output.
+ *  The run is limited to ParserBenchmarkMaxMillis so that the main task isn't blocked for long enough to reset the processor.
+ */
+
+#ifndef SRC_GCODES_PARSERBENCHMARK_H_
+#define SRC_GCODES_PARSERBENCHMARK_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_PARSER_BENCHMARK && HAS_MASS_STORAGE
+
+namespace ParserBenchmark
+{
+	GCodeResult Run(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);
+}
+
+#endif
+
+#endif /* SRC_GCODES_PARSERBENCHMARK_H_ */
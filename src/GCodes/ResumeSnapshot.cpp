@@ -0,0 +1,150 @@
+/*
+ * ResumeSnapshot.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "ResumeSnapshot.h"
+
+#if SUPPORT_RESUME_SNAPSHOT
+
+#include <Platform/RepRap.h>
+#include <Platform/Platform.h>
+#include <Storage/FileStore.h>
+#include <Storage/CRC32.h>
+#include <cstddef>
+
+ResumeSnapshot::ResumeSnapshot() noexcept : file(nullptr), sequence(0), nextSlot(0)
+{
+}
+
+// Create the snapshot file, or reuse the one left by an earlier print, and clear both records so that a snapshot from an earlier print can't be used
+void ResumeSnapshot::Start() noexcept
+{
+#if HAS_SBC_INTERFACE
+	if (reprap.UsingSbcInterface())
+	{
+		return;
+	}
+#endif
+
+	if (file == nullptr)
+	{
+		file = reprap.GetPlatform().OpenSysFile(FileName, OpenMode::append);		// append mode lets us overwrite the records in place and doesn't tie up a write buffer
+		if (file == nullptr)
+		{
+			reprap.GetPlatform().MessageF(WarningMessage, "Failed to create file %s\n", FileName);
+			return;
+		}
+	}
+
+	memset(&record, 0, sizeof(record));
+	bool ok = file->Seek(0);
+	for (size_t i = 0; ok && i < 2 * ResumeSnapshotSlotSize; i += sizeof(record.fileName))
+	{
+		ok = file->Write(record.fileName, min<size_t>(sizeof(record.fileName), 2 * ResumeSnapshotSlotSize - i));
+	}
+	if (!ok || !file->Flush())
+	{
+		reprap.GetPlatform().MessageF(WarningMessage, "Failed to write file %s\n", FileName);
+		Stop(false);
+		return;
+	}
+	sequence = 0;
+	nextSlot = 0;
+}
+
+// Close the snapshot file, deleting it if the print completed normally
+void ResumeSnapshot::Stop(bool deleteFile) noexcept
+{
+	if (file != nullptr)
+	{
+		file->Close();
+		file = nullptr;
+		if (deleteFile)
+		{
+			reprap.GetPlatform().DeleteSysFile(FileName);
+		}
+	}
+}
+
+// Save the record that the caller has filled in, overwriting the older of the two records in the file
+bool ResumeSnapshot::Save(ResumeSnapshotKind kind) noexcept
+{
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	record.magic = ResumeSnapshotRecord::MagicValue;
+	record.version = ResumeSnapshotRecord::CurrentVersion;
+	record.kind = kind;
+	record.sequence = ++sequence;
+	record.crc = CalcCrc(record);
+	const bool ok = file->Seek(nextSlot * ResumeSnapshotSlotSize)
+					&& file->Write(reinterpret_cast<const char *>(&record), sizeof(record))
+					&& file->Flush();
+	nextSlot ^= 1;
+	return ok;
+}
+
+// Record that resurrect.g has been written since the last snapshot, so M916 should use that instead
+void ResumeSnapshot::Supersede() noexcept
+{
+	if (file != nullptr)
+	{
+		memset(&record, 0, sizeof(record));
+		(void)Save(ResumeSnapshotKind::none);
+	}
+}
+
+// Read the most recent valid record from the snapshot file. Return a pointer to it if it can be resumed from, else null.
+const ResumeSnapshotRecord *_ecv_null ResumeSnapshot::ReadLatest() noexcept
+{
+	FileStore * const f = (file != nullptr) ? file : reprap.GetPlatform().OpenSysFile(FileName, OpenMode::read);
+	if (f == nullptr)
+	{
+		return nullptr;
+	}
+
+	unsigned int bestSlot = 2;
+	uint32_t bestSequence = 0;
+	for (unsigned int slot = 0; slot < 2; ++slot)
+	{
+		if (ReadSlot(f, slot) && (bestSlot == 2 || (int32_t)(record.sequence - bestSequence) > 0))
+		{
+			bestSlot = slot;
+			bestSequence = record.sequence;
+		}
+	}
+
+	const bool ok = bestSlot < 2 && ReadSlot(f, bestSlot) && record.kind != ResumeSnapshotKind::none;
+	if (f != file)
+	{
+		f->Close();
+	}
+	return (ok) ? &record : nullptr;
+}
+
+// Read a record into our buffer and return true if it is valid
+bool ResumeSnapshot::ReadSlot(FileStore *f, unsigned int slot) noexcept
+{
+	return f->Seek(slot * ResumeSnapshotSlotSize)
+		&& f->Read(reinterpret_cast<char *>(&record), sizeof(record)) == (int)sizeof(record)
+		&& record.magic == ResumeSnapshotRecord::MagicValue
+		&& record.version == ResumeSnapshotRecord::CurrentVersion
+		&& record.crc == CalcCrc(record);
+}
+
+/*static*/ uint32_t ResumeSnapshot::CalcCrc(const ResumeSnapshotRecord& rec) noexcept
+{
+	constexpr size_t start = offsetof(ResumeSnapshotRecord, crc) + sizeof(rec.crc);
+	CRC32 crc;
+	crc.Update(reinterpret_cast<const char *>(&rec) + start, sizeof(rec) - start);
+	return crc.Get();
+}
+
+#endif	// SUPPORT_RESUME_SNAPSHOT
+
+// End
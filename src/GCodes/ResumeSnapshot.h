@@ -0,0 +1,104 @@
+/*
+ * ResumeSnapshot.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  While a file is being printed, GCodes saves a compact binary snapshot of the state needed to resume the print every few seconds,
+ *  and again when a power failure is detected. The snapshot file is created at the start of the print with room for two records and
+ *  kept open, so saving a snapshot is a single small write to space that is already allocated. The records are written alternately
+ *  and each one has a sequence number and a CRC, so if power fails part way through writing one the other is still valid.
+ *  When resurrect.g has been written successfully the snapshot is marked as superseded. M916 uses the snapshot instead of resurrect.g
+ *  if it hasn't been superseded, by creating resurrect.g from it first.
+ */
+
+#ifndef SRC_GCODES_RESUMESNAPSHOT_H_
+#define SRC_GCODES_RESUMESNAPSHOT_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_RESUME_SNAPSHOT
+
+class FileStore;
+
+enum class ResumeSnapshotKind : uint8_t
+{
+	none = 0,									// no snapshot, or resurrect.g is more recent
+	periodic,									// saved periodically during the print, resuming from the move that was executing
+	powerFailure								// saved when power failed, resuming from where the print was stopped
+};
+
+struct ResumeSnapshotRecord
+{
+	static constexpr uint32_t MagicValue = 0x504E5352;	// "RSNP" in little-endian order
+	static constexpr uint16_t CurrentVersion = 1;
+	static constexpr uint8_t FlagDrivesRelative = 0x01;
+	static constexpr uint8_t FlagUsingInches = 0x02;
+
+	// Header
+	uint32_t magic;
+	uint16_t version;
+	ResumeSnapshotKind kind;
+	uint8_t flags;
+	uint32_t sequence;
+	uint32_t crc;										// CRC-32 of the rest of the record after this field
+
+	// The resume point
+	FilePosition filePos;
+	float userCoords[MaxAxes];							// the user coordinates to resume at, including tool offsets and baby stepping
+	float positionOffsets[MaxAxes];						// the baby stepping offset minus the tool offset of each axis
+	float babyStepOffsets[MaxAxes];
+	float feedRate;
+	float virtualExtruderPosition;
+	float proportionDone;
+	float initialUserC0, initialUserC1;
+#if SUPPORT_LASER || SUPPORT_IOBITS
+	LaserPwmOrIoBits laserPwmOrIoBits;
+#endif
+
+	// Temperatures, tool and other state
+	float fanSpeed;
+	float toolActiveTemperatures[MaxHeatersPerTool];
+	float toolStandbyTemperatures[MaxHeatersPerTool];
+	float bedTemperatures[MaxBedHeaters];
+	float chamberTemperatures[MaxChamberHeaters];
+	uint32_t bedHeatersActive;							// bitmap of the bed heaters that were active
+	uint32_t chamberHeatersActive;						// bitmap of the chamber heaters that were active
+	int16_t toolNumber;
+	uint8_t toolHeaterCount;
+	uint8_t selectedPlane;
+	uint8_t workplaceNumber;
+	char fileName[MaxFilenameLength];
+};
+
+static_assert(sizeof(ResumeSnapshotRecord) <= ResumeSnapshotSlotSize, "ResumeSnapshotSlotSize is too small");
+static_assert(MaxBedHeaters <= 32 && MaxChamberHeaters <= 32, "Heater bitmaps too small");
+
+class ResumeSnapshot
+{
+public:
+	static constexpr const char *_ecv_array FileName = "resurrect.dat";
+
+	ResumeSnapshot() noexcept;
+
+	bool IsActive() const noexcept { return file != nullptr; }
+	void Start() noexcept;										// create the snapshot file at the start of a print
+	void Stop(bool deleteFile) noexcept;						// close the snapshot file at the end of a print
+	ResumeSnapshotRecord& GetRecord() noexcept { return record; }
+	bool Save(ResumeSnapshotKind kind) noexcept;				// save the record that the caller has filled in
+	void Supersede() noexcept;									// record that resurrect.g is more recent than the snapshot
+	const ResumeSnapshotRecord *_ecv_null ReadLatest() noexcept;	// read the most recent record, returning null if there isn't one to resume from
+
+private:
+	static uint32_t CalcCrc(const ResumeSnapshotRecord& rec) noexcept;
+	bool ReadSlot(FileStore *f, unsigned int slot) noexcept;
+
+	FileStore *file;
+	uint32_t sequence;
+	unsigned int nextSlot;
+	ResumeSnapshotRecord record;								// kept here rather than on the stack because it is quite large
+};
+
+#endif
+
+#endif /* SRC_GCODES_RESUMESNAPSHOT_H_ */
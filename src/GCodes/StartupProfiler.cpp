@@ -0,0 +1,177 @@
+/*
+ * StartupProfiler.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "StartupProfiler.h"
+
+#if SUPPORT_STARTUP_PROFILE
+
+#include "GCodeBuffer/GCodeBuffer.h"
+#include <Platform/RepRap.h>
+#include <Platform/Platform.h>
+#include <Movement/StepTimer.h>
+
+StartupProfiler::StartupProfiler() noexcept
+	: currentStartTicks(0), otherMicroseconds(0), configStartMillis(0), configFinishMillis(0), numCommandStats(0), numSlowestLines(0), running(false)
+{
+}
+
+// Record the time of the command that was running, if any, and start timing the new one
+void StartupProfiler::CommandStarted(const GCodeBuffer& gb) noexcept
+{
+	if (running)
+	{
+		RecordCommand();
+	}
+	else
+	{
+		configStartMillis = millis();
+		running = true;
+	}
+
+	current.id.letter = gb.GetCommandLetter();
+	current.id.number = (int16_t)gb.GetCommandNumber();
+	current.id.fraction = gb.GetCommandFraction();
+	current.lineNumber = gb.GetLineNumber();
+	current.depth = (uint8_t)gb.GetStackDepth();
+	currentStartTicks = StepTimer::GetTimerTicks();
+}
+
+void StartupProfiler::Finished() noexcept
+{
+	if (running)
+	{
+		RecordCommand();
+		configFinishMillis = millis();
+		running = false;
+	}
+}
+
+// Add the time of the current command to its command totals and to the list of slowest lines
+void StartupProfiler::RecordCommand() noexcept
+{
+	current.microseconds = (uint32_t)(((uint64_t)(StepTimer::GetTimerTicks() - currentStartTicks) * 1000000u)/StepClockRate);
+
+	unsigned int i = 0;
+	while (i < numCommandStats && !(commandStats[i].id == current.id))
+	{
+		++i;
+	}
+	if (i < numCommandStats)
+	{
+		++commandStats[i].count;
+		commandStats[i].totalMicroseconds += current.microseconds;
+	}
+	else if (numCommandStats < StartupProfileCommands)
+	{
+		commandStats[numCommandStats++] = { current.id, 1, current.microseconds };
+	}
+	else
+	{
+		otherMicroseconds += current.microseconds;
+	}
+
+	// Insert this line into the list of slowest lines if it is slow enough
+	unsigned int pos = numSlowestLines;
+	while (pos != 0 && slowestLines[pos - 1].microseconds < current.microseconds)
+	{
+		--pos;
+	}
+	if (pos < StartupProfileSlowestLines)
+	{
+		const unsigned int last = min<unsigned int>(numSlowestLines, StartupProfileSlowestLines - 1);
+		for (unsigned int j = last; j > pos; --j)
+		{
+			slowestLines[j] = slowestLines[j - 1];
+		}
+		slowestLines[pos] = current;
+		if (numSlowestLines < StartupProfileSlowestLines)
+		{
+			++numSlowestLines;
+		}
+	}
+}
+
+void StartupProfiler::CommandId::AppendTo(const StringRef& str) const noexcept
+{
+	if (letter == 0)
+	{
+		str.cat("(none)");
+	}
+	else if (fraction >= 0)
+	{
+		str.catf("%c%d.%d", letter, number, fraction);
+	}
+	else
+	{
+		str.catf("%c%d", letter, number);
+	}
+}
+
+void StartupProfiler::Diagnostics(MessageType mtype) const noexcept
+{
+	Platform& p = reprap.GetPlatform();
+	if (configStartMillis == 0)
+	{
+		return;
+	}
+	if (running)
+	{
+		p.MessageF(mtype, "Startup: config.g started at %.2fs and is still running\n", (double)((float)configStartMillis * 0.001));
+		return;
+	}
+
+	p.MessageF(mtype, "Startup: config.g started at %.2fs and took %.2fs\n",
+				(double)((float)configStartMillis * 0.001), (double)((float)(configFinishMillis - configStartMillis) * 0.001));
+
+	// Report the commands that took the most time in total, slowest first
+	String<StringLength256> str;
+	unsigned int reported = 0;
+	uint32_t lastReported = UINT32_MAX;
+	while (reported < numCommandStats && reported < StartupProfileReportedCommands)
+	{
+		// Find the slowest command that we haven't reported yet. Commands with equal times are all reported together.
+		uint32_t slowest = 0;
+		for (unsigned int i = 0; i < numCommandStats; ++i)
+		{
+			if (commandStats[i].totalMicroseconds < lastReported && commandStats[i].totalMicroseconds >= slowest)
+			{
+				slowest = commandStats[i].totalMicroseconds;
+			}
+		}
+		for (unsigned int i = 0; i < numCommandStats; ++i)
+		{
+			if (commandStats[i].totalMicroseconds == slowest)
+			{
+				str.cat(' ');
+				commandStats[i].id.AppendTo(str.GetRef());
+				str.catf("x%u:%.1fms", commandStats[i].count, (double)((float)commandStats[i].totalMicroseconds * 0.001));
+				++reported;
+			}
+		}
+		if (slowest == 0)
+		{
+			break;
+		}
+		lastReported = slowest;
+	}
+	p.MessageF(mtype, "Startup command times:%s, other %.1fms\n", str.c_str(), (double)((float)otherMicroseconds * 0.001));
+
+	// Report the slowest lines
+	str.Clear();
+	for (unsigned int i = 0; i < numSlowestLines; ++i)
+	{
+		const LineRecord& lr = slowestLines[i];
+		str.catf(" %" PRIi32 "/%u ", lr.lineNumber, lr.depth);
+		lr.id.AppendTo(str.GetRef());
+		str.catf(":%.1fms", (double)((float)lr.microseconds * 0.001));
+	}
+	p.MessageF(mtype, "Slowest startup lines (line/depth):%s\n", str.c_str());
+}
+
+#endif	// SUPPORT_STARTUP_PROFILE
+
+// End
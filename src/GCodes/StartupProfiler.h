@@ -0,0 +1,73 @@
+/*
+ * StartupProfiler.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  This records how long config.g and the macros it calls take to run. The time of each command is measured from when it starts to when the next
+ *  command starts, so it includes the time taken to read the next line from the file and any CAN transactions that the command does.
+ *  We keep the total time and count for each distinct command and the slowest individual lines, and report them in M122.
+ */
+
+#ifndef SRC_GCODES_STARTUPPROFILER_H_
+#define SRC_GCODES_STARTUPPROFILER_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_STARTUP_PROFILE
+
+class GCodeBuffer;
+
+class StartupProfiler
+{
+public:
+	StartupProfiler() noexcept;
+
+	void CommandStarted(const GCodeBuffer& gb) noexcept;			// called when the channel running config.g starts a new command
+	void Finished() noexcept;										// called when config.g has finished
+	void Diagnostics(MessageType mtype) const noexcept;
+
+private:
+	// The command that a time was recorded for
+	struct CommandId
+	{
+		char letter;
+		int8_t fraction;
+		int16_t number;
+
+		bool operator==(const CommandId& other) const noexcept { return letter == other.letter && fraction == other.fraction && number == other.number; }
+		void AppendTo(const StringRef& str) const noexcept;
+	};
+
+	struct CommandStats
+	{
+		CommandId id;
+		uint16_t count;
+		uint32_t totalMicroseconds;
+	};
+
+	struct LineRecord
+	{
+		CommandId id;
+		int32_t lineNumber;
+		uint8_t depth;												// 1 for config.g, 2 for a macro that it called, and so on
+		uint32_t microseconds;
+	};
+
+	void RecordCommand() noexcept;
+
+	CommandStats commandStats[StartupProfileCommands];				// the time spent in each distinct command
+	LineRecord slowestLines[StartupProfileSlowestLines];			// the slowest lines, slowest first
+	LineRecord current;												// the command that is running
+	uint32_t currentStartTicks;										// the step clock when the current command started
+	uint32_t otherMicroseconds;										// the time spent in commands that we had no room to record in commandStats
+	uint32_t configStartMillis;
+	uint32_t configFinishMillis;
+	unsigned int numCommandStats;
+	unsigned int numSlowestLines;
+	bool running;
+};
+
+#endif
+
+#endif /* SRC_GCODES_STARTUPPROFILER_H_ */
@@ -0,0 +1,262 @@
+/*
+ * ToolPreheater.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "ToolPreheater.h"
+
+#if SUPPORT_TOOL_PREHEAT
+
+#include "GCodeBuffer/GCodeBuffer.h"
+#include <Platform/RepRap.h>
+#include <Movement/Move.h>
+#include <Tools/Tool.h>
+#include <Storage/FileStore.h>
+#include <Storage/MassStorage.h>
+
+ToolPreheater::ToolPreheater() noexcept
+	: file(nullptr), scanPos(0), lineStartPos(0), foundToolPos(0), lastRatePos(0), lastRateMillis(0), bytesPerSecond(0.0),
+	  lookaheadMillis(0), toolNumberSoFar(-1), foundTool(-1), state(ScanState::lineStart), scanFinished(false), bufferIndex(0), bufferLength(0)
+{
+}
+
+// Handle M568.1
+GCodeResult ToolPreheater::Configure(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
+{
+	bool seen = false;
+	uint32_t seconds = lookaheadMillis/1000;
+	gb.TryGetLimitedUIValue('S', seconds, seen, MaxToolPreheatSeconds + 1);
+	if (seen)
+	{
+		lookaheadMillis = seconds * 1000;
+		if (lookaheadMillis == 0)
+		{
+			Stop();
+		}
+	}
+	else if (lookaheadMillis == 0)
+	{
+		reply.copy("Tool preheating is disabled");
+	}
+	else
+	{
+		reply.printf("Tools are preheated %" PRIu32 " seconds before they are selected by the file being printed", lookaheadMillis/1000);
+	}
+	return GCodeResult::ok;
+}
+
+// Close the file and forget what we found. Called when the print ends or when preheating is disabled.
+void ToolPreheater::Stop() noexcept
+{
+	if (file != nullptr)
+	{
+		file->Close();
+		file = nullptr;
+	}
+	foundTool = -1;
+	scanFinished = false;
+}
+
+// This is called by GCodes from the main loop. fileName is the print file, or null if we aren't printing one. filePos is the position that the print has reached.
+void ToolPreheater::Spin(const char *_ecv_array null fileName, FilePosition filePos) noexcept
+{
+	if (lookaheadMillis == 0 || fileName == nullptr || filePos == noFilePosition)
+	{
+		Stop();
+		return;
+	}
+
+	if (file == nullptr)
+	{
+		if (scanFinished)
+		{
+			return;											// we already failed to open this file, or we reached the end of it
+		}
+		file = MassStorage::OpenFile(fileName, OpenMode::read, 0);
+		if (file == nullptr)
+		{
+			scanFinished = true;
+			return;
+		}
+#if SUPPORT_COMPRESSED_GCODE_FILES
+		if (!file->EnableDecompression())
+		{
+			Stop();
+			scanFinished = true;
+			return;
+		}
+#endif
+		lastRatePos = filePos;
+		lastRateMillis = millis();
+		bytesPerSecond = 0.0;
+		StartScan(filePos);
+	}
+
+	UpdateReadRate(filePos);
+	if (filePos > scanPos)
+	{
+		StartScan(filePos);									// the print has overtaken us, or it has been restarted from a later position
+	}
+
+	if (bytesPerSecond <= 0.0)
+	{
+		return;												// we can't estimate how long it will be until a tool change yet
+	}
+
+	const float queuedSeconds = reprap.GetMove().GetQueuedMoveTime();
+	if (foundTool >= 0)
+	{
+		if (foundToolPos < filePos)
+		{
+			foundTool = -1;									// the print has already read the tool change command
+		}
+		else
+		{
+			const float secondsToToolChange = queuedSeconds + (float)(foundToolPos - filePos)/bytesPerSecond;
+			if (secondsToToolChange * 1000.0 > (float)lookaheadMillis)
+			{
+				return;										// not time to preheat yet, and we don't need to scan further
+			}
+
+			const ReadLockedPointer<Tool> tool = reprap.GetTool(foundTool);
+			if (tool.IsNotNull() && tool.Ptr() != reprap.GetCurrentTool() && tool->GetState() == ToolState::standby)
+			{
+				tool->HeatersToActiveOrStandby(true);
+			}
+			foundTool = -1;
+		}
+	}
+
+	// Read more of the file if we haven't yet scanned as far ahead as the lookahead time
+	if (!scanFinished && (queuedSeconds + (float)(scanPos - filePos)/bytesPerSecond) * 1000.0 < (float)lookaheadMillis)
+	{
+		ScanChunk();
+	}
+}
+
+// Start scanning from the specified file position, which the print has reached so it is at the start of a line
+void ToolPreheater::StartScan(FilePosition filePos) noexcept
+{
+	scanPos = lineStartPos = filePos;
+	state = ScanState::lineStart;
+	foundTool = -1;
+	bufferIndex = bufferLength = 0;
+	if (!file->Seek(filePos))
+	{
+		scanFinished = true;
+	}
+}
+
+// Measure the rate at which the print is reading the file, averaged over successive intervals
+void ToolPreheater::UpdateReadRate(FilePosition filePos) noexcept
+{
+	const uint32_t now = millis();
+	const uint32_t interval = now - lastRateMillis;
+	if (filePos < lastRatePos)
+	{
+		// The print has been restarted from an earlier position
+		lastRatePos = filePos;
+		lastRateMillis = now;
+		StartScan(filePos);
+	}
+	else if (interval >= ToolPreheatRateIntervalMillis)
+	{
+		const float rate = (float)(filePos - lastRatePos) * 1000.0/(float)interval;
+		bytesPerSecond = (bytesPerSecond <= 0.0) ? rate : 0.5 * (bytesPerSecond + rate);
+		lastRatePos = filePos;
+		lastRateMillis = now;
+	}
+}
+
+// Scan the next chunk of the file, stopping if we find a tool change command
+void ToolPreheater::ScanChunk() noexcept
+{
+	if (bufferIndex == bufferLength)
+	{
+		const int bytesRead = file->Read(buffer, sizeof(buffer));
+		if (bytesRead <= 0)
+		{
+			scanFinished = true;
+			return;
+		}
+		bufferIndex = 0;
+		bufferLength = (size_t)bytesRead;
+	}
+
+	while (bufferIndex < bufferLength && foundTool < 0)
+	{
+		const char c = buffer[bufferIndex++];
+		++scanPos;
+		if (c == '\n')
+		{
+			if (state == ScanState::toolNumber && toolNumberSoFar >= 0)
+			{
+				ToolFound(toolNumberSoFar);
+			}
+			state = ScanState::lineStart;
+			lineStartPos = scanPos;
+			continue;
+		}
+
+		switch (state)
+		{
+		case ScanState::lineStart:
+		case ScanState::afterLineNumber:
+			if (c == 'T' || c == 't')
+			{
+				toolNumberSoFar = -1;
+				state = ScanState::toolNumber;
+			}
+			else if (state == ScanState::lineStart && (c == 'N' || c == 'n'))
+			{
+				state = ScanState::lineNumber;
+			}
+			else if (c != ' ' && c != '\t')
+			{
+				state = ScanState::skipLine;
+			}
+			break;
+
+		case ScanState::lineNumber:
+			if (c == ' ' || c == '\t')
+			{
+				state = ScanState::afterLineNumber;
+			}
+			else if (!isDigit(c))
+			{
+				state = ScanState::skipLine;
+			}
+			break;
+
+		case ScanState::toolNumber:
+			if (isDigit(c) && toolNumberSoFar < MaxScannedToolNumber)
+			{
+				toolNumberSoFar = ((toolNumberSoFar < 0) ? 0 : toolNumberSoFar * 10) + (c - '0');
+			}
+			else
+			{
+				if (toolNumberSoFar >= 0 && (c == ' ' || c == '\t' || c == '\r' || c == ';' || c == '*'))
+				{
+					ToolFound(toolNumberSoFar);
+				}
+				state = ScanState::skipLine;				// this includes T commands with expressions and T-1, which we don't preheat for
+			}
+			break;
+
+		case ScanState::skipLine:
+			break;
+		}
+	}
+}
+
+void ToolPreheater::ToolFound(int toolNumber) noexcept
+{
+	foundTool = toolNumber;
+	foundToolPos = lineStartPos;
+}
+
+#endif	// SUPPORT_TOOL_PREHEAT
+
+// End
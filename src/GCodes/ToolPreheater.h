@@ -0,0 +1,59 @@
+/*
+ * ToolPreheater.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  This reads ahead in the file being printed to find the next tool change command, and when the tool change is expected within the configured
+ *  lookahead time it switches the heaters of the new tool from standby to active, so that the tool is hot or nearly so by the time it is selected.
+ *  The time until the tool change is the time of the moves already in the movement queue plus the time to read the bytes up to the T command,
+ *  at the rate that the file has been read at recently. The file is read using a separate file handle so that the print isn't disturbed.
+ *  Only T commands at the start of a line are recognised, and only tools that are in standby are preheated.
+ *  Binary print files are not scanned. Configured using M568.1 S<seconds>, where S0 disables it.
+ */
+
+#ifndef SRC_GCODES_TOOLPREHEATER_H_
+#define SRC_GCODES_TOOLPREHEATER_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_TOOL_PREHEAT
+
+class ToolPreheater
+{
+public:
+	ToolPreheater() noexcept;
+
+	GCodeResult Configure(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);	// handle M568.1
+	void Spin(const char *_ecv_array null fileName, FilePosition filePos) noexcept;		// called by GCodes, with a null filename when no print file is being executed
+	void Stop() noexcept;
+
+private:
+	enum class ScanState : uint8_t { lineStart, lineNumber, afterLineNumber, toolNumber, skipLine };
+	static constexpr int MaxScannedToolNumber = 9999;		// we stop accumulating digits at this value so that a long number can't overflow
+
+	void StartScan(FilePosition filePos) noexcept;
+	void ScanChunk() noexcept;
+	void ToolFound(int toolNumber) noexcept;
+	void UpdateReadRate(FilePosition filePos) noexcept;
+
+	FileStore *file;							// our own handle on the file being printed, or nullptr
+	FilePosition scanPos;						// where we have read the file up to
+	FilePosition lineStartPos;					// the position of the start of the line being scanned
+	FilePosition foundToolPos;					// the position of the T command we have found
+	FilePosition lastRatePos;					// the file position when we last measured the read rate
+	uint32_t lastRateMillis;
+	float bytesPerSecond;						// the recent rate at which the print file has been read, or 0 if we haven't measured it yet
+	uint32_t lookaheadMillis;					// how far ahead to preheat, or 0 if disabled
+	int toolNumberSoFar;
+	int foundTool;								// the number of the next tool that will be selected, or -1 if we haven't found one
+	ScanState state;
+	bool scanFinished;							// true if we reached the end of the file or it couldn't be read
+	size_t bufferIndex;							// the index of the next byte in the buffer to scan
+	size_t bufferLength;						// how many bytes there are in the buffer
+	char buffer[ToolPreheatReadChunkSize];
+};
+
+#endif
+
+#endif /* SRC_GCODES_TOOLPREHEATER_H_ */
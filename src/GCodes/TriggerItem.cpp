@@ -33,7 +33,7 @@ bool TriggerItem::IsUnused() const noexcept
 
 // Check whether this trigger is active and update the input states. This is called in a polling loop, so it needs to be fast.
 // TODO when we switch to interrupt-driven endstops, make this interrupt-driven instead
-bool TriggerItem::Check() noexcept
+bool TriggerItem::Check(bool pollInterruptDrivenInputs) noexcept
 {
 	bool triggered = false;
 
@@ -72,15 +72,17 @@ bool TriggerItem::Check() noexcept
 	if (portsMonitored.IsNonEmpty())
 	{
 		Platform& platform = reprap.GetPlatform();
-		portsMonitored.Iterate([this, &platform, &triggered](unsigned int inPort, unsigned int)
+		portsMonitored.Iterate([this, &platform, &triggered, pollInterruptDrivenInputs](unsigned int inPort, unsigned int)
 								{
-									const bool isActive = reprap.GetPlatform().GetGpInPort(inPort).GetState();
+									const GpInputPort& gpin = platform.GetGpInPort(inPort);
+									const bool isActive = gpin.GetState();
 									if (isActive != inputStates.IsBitSet(inPort))
 									{
+										const bool canTrigger = pollInterruptDrivenInputs || !gpin.IsInterruptDriven();
 										if (isActive)
 										{
 											inputStates.SetBit(inPort);
-											if (highLevelInputs.IsBitSet(inPort))
+											if (canTrigger && highLevelInputs.IsBitSet(inPort))
 											{
 												triggered = true;
 											}
@@ -88,7 +90,7 @@ bool TriggerItem::Check() noexcept
 										else
 										{
 											inputStates.ClearBit(inPort);
-											if (lowLevelInputs.IsBitSet(inPort))
+											if (canTrigger && lowLevelInputs.IsBitSet(inPort))
 											{
 												triggered = true;
 											}
@@ -98,11 +100,21 @@ bool TriggerItem::Check() noexcept
 								}
 							);
 	}
-	return triggered &&
-			(condition == 0
-				|| (condition == 1 && reprap.GetPrintMonitor().IsPrinting())
-				|| (condition == 2 && !reprap.GetPrintMonitor().IsPrinting())
-			);
+	return triggered && ConditionMet();
+}
+
+// Check whether an edge on an interrupt-driven input activates this trigger. Called from the pin change ISR, so it mustn't update anything.
+bool TriggerItem::CheckInputEdgeFromISR(unsigned int inPort, bool newState) const noexcept
+{
+	return ((newState) ? highLevelInputs : lowLevelInputs).IsBitSet(inPort) && ConditionMet();
+}
+
+// Return true if the condition (R parameter) under which this trigger may fire is satisfied
+bool TriggerItem::ConditionMet() const noexcept
+{
+	return condition == 0
+			|| (condition == 1 && reprap.GetPrintMonitor().IsPrinting())
+			|| (condition == 2 && !reprap.GetPrintMonitor().IsPrinting());
 }
 
 // Handle M581 for this trigger
@@ -21,8 +21,12 @@ public:
 	// Return true if this trigger is unused, i.e. it doesn't watch any pins
 	bool IsUnused() const noexcept;
 
-	// Check whether this trigger is active and update the input states
-	bool Check() noexcept;
+	// Check whether this trigger is active and update the input states.
+	// If pollInterruptDrivenInputs is false then edges on interrupt-driven inputs don't activate the trigger, because CheckInputEdgeFromISR has done that.
+	bool Check(bool pollInterruptDrivenInputs = true) noexcept;
+
+	// Called from the pin change ISR of an interrupt-driven input. Return true if the edge activates this trigger.
+	bool CheckInputEdgeFromISR(unsigned int inPort, bool newState) const noexcept;
 
 	// Handle M581 for this trigger
 	GCodeResult Configure(unsigned int number, GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);
@@ -31,6 +35,7 @@ public:
 	bool CheckLevel() noexcept;
 
 private:
+	bool ConditionMet() const noexcept;
 	static void AppendInputNames(AxesBitmap endstops, InputPortsBitmap inputs, const StringRef& reply) noexcept;
 
 	AxesBitmap highLevelEndstops, lowLevelEndstops, endstopStates;
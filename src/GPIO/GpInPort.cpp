@@ -9,6 +9,7 @@
 #include <GCodes/GCodeBuffer/GCodeBuffer.h>
 #include <Platform/RepRap.h>
 #include <Platform/Platform.h>
+#include <GCodes/GCodes.h>
 
 #if SUPPORT_CAN_EXPANSION
 # include <CAN/CanInterface.h>
@@ -40,14 +41,25 @@ DEFINE_GET_OBJECT_MODEL_TABLE(GpInputPort)
 
 bool GpInputPort::GetState() const noexcept
 {
-	// Temporary implementation until we use interrupts to track input pin state changes
 #if SUPPORT_CAN_EXPANSION
 	if (boardAddress != CanInterface::GetCanAddress())
 	{
 		return currentState;
 	}
 #endif
-	return port.ReadDigital();
+	return (interruptDriven) ? currentState : port.ReadDigital();
+}
+
+// Pin change interrupt. Record the new state and let GCodes act on any triggers that it fires, so that we don't depend on the main loop polling the pin.
+/*static*/ void GpInputPort::InputInterrupt(CallbackParameter param) noexcept
+{
+	GpInputPort * const gpin = static_cast<GpInputPort*>(param.vp);
+	const bool newState = gpin->port.ReadDigital();
+	if (newState != gpin->currentState)
+	{
+		gpin->currentState = newState;
+		reprap.GetGCodes().GpInputChangedFromISR(gpin->number, newState);
+	}
 }
 
 // Return true if the port is not configured
@@ -82,8 +94,10 @@ GCodeResult GpInputPort::Configure(uint32_t gpinNumber, GCodeBuffer &gb, const S
 			boardAddress = CanInterface::GetCanAddress();
 		}
 #endif
-		port.Release();
+		port.Release();								// this also detaches any interrupt
+		interruptDriven = false;
 		currentState = false;
+		number = (uint8_t)gpinNumber;
 
 		GCodeResult rslt;
 
@@ -108,6 +122,8 @@ GCodeResult GpInputPort::Configure(uint32_t gpinNumber, GCodeBuffer &gb, const S
 			if (port.AssignPort(pinName.c_str(), reply, PinUsedBy::gpin, PinAccess::read))
 			{
 				currentState = port.ReadDigital();
+				interruptDriven = port.AttachInterrupt(InputInterrupt, InterruptMode::change, CallbackParameter(this));	// if the pin doesn't support interrupts then we poll it
+				currentState = port.ReadDigital();		// in case it changed before we attached the interrupt
 				rslt = GCodeResult::ok;
 			}
 			else
@@ -138,7 +154,7 @@ GCodeResult GpInputPort::Configure(uint32_t gpinNumber, GCodeBuffer &gb, const S
 			reply.copy("Pin ");
 			port.AppendPinName(reply);
 		}
-		reply.catf(", active: %s", (GetState()) ? "true" : "false");
+		reply.catf(", active: %s%s", (GetState()) ? "true" : "false", (interruptDriven) ? ", interrupt driven" : "");
 	}
 	return GCodeResult::ok;
 }
@@ -23,11 +23,12 @@ public:
 #if SUPPORT_CAN_EXPANSION
 		boardAddress(CanInterface::GetCanAddress()),
 #endif
-		currentState(false) { }
+		number(0), interruptDriven(false), currentState(false) { }
 	GpInputPort(const GpInputPort&) = delete;
 
 	bool GetState() const noexcept;
 	bool IsUnused() const noexcept;
+	bool IsInterruptDriven() const noexcept { return interruptDriven; }	// true if state changes are reported to GCodes from the pin change interrupt
 
 #if SUPPORT_CAN_EXPANSION
 	void SetState(CanAddress src, bool b) noexcept { if (src == boardAddress) { currentState = b; } }
@@ -39,12 +40,16 @@ protected:
 	DECLARE_OBJECT_MODEL
 
 private:
+	static void InputInterrupt(CallbackParameter param) noexcept;
+
 	IoPort port;									// will be initialised by PwmPort default constructor
 #if SUPPORT_CAN_EXPANSION
 	RemoteInputHandle handle;
 	CanAddress boardAddress;
 #endif
-	bool currentState;
+	uint8_t number;									// our port number, so that the interrupt can report which port changed
+	bool interruptDriven;
+	volatile bool currentState;
 };
 
 #endif /* SRC_GPIO_GPINPORT_H_ */
@@ -7,6 +7,8 @@
 
 #include "I2C.h"
 #include <Platform/Tasks.h>
+#include <Platform/RepRap.h>
+#include <Platform/Platform.h>
 
 #if defined(I2C_IFACE)
 static bool i2cInitialised = false;
@@ -33,15 +35,107 @@ void I2C::Init() noexcept
 
 #include "RTOSIface/RTOSIface.h"
 
+// State of the transfer that the TWI interrupt is doing
+enum class TransferPhase : uint8_t { idle, writing, reading, finishing };
+
 static TaskHandle twiTask = nullptr;			// the task that is waiting for a TWI command to complete
+static volatile TransferPhase transferPhase = TransferPhase::idle;
+static volatile bool transferFailed;
+static uint8_t *transferBuffer;
+static size_t transferNumToWrite;
+static size_t transferTotal;					// the number of bytes to write plus the number to read
+static volatile size_t transferDone;			// the number of bytes written or read so far
 
-extern "C" void WIRE_ISR_HANDLER() noexcept
+// Statistics for the interrupt-driven transfers
+static uint32_t numTransfers = 0, numNaks = 0, numTimeouts = 0;
+
+// Finish the transfer and wake up the task that requested it. Called from the ISR.
+static void FinishTransfer(Twi *twi, bool failed) noexcept
 {
-	WIRE_INTERFACE->TWI_IDR = 0xFFFFFFFF;
-	TaskBase::GiveFromISR(twiTask);				// wake up the task
+	twi->TWI_IDR = 0xFFFFFFFF;
+	transferFailed = failed;
+	transferPhase = TransferPhase::idle;
+	TaskBase::GiveFromISR(twiTask);
 	twiTask = nullptr;
 }
 
+// Handle a TWI interrupt during a transfer
+static void TransferInterrupt(Twi *twi) noexcept
+{
+	const uint32_t sr = twi->TWI_SR;
+	if (sr & TWI_SR_NACK)
+	{
+		FinishTransfer(twi, true);				// the TWI has already sent a stop condition
+		return;
+	}
+
+	switch (transferPhase)
+	{
+	case TransferPhase::writing:
+		if (sr & TWI_SR_TXRDY)
+		{
+			const size_t done = transferDone + 1;
+			transferDone = done;
+			if (done < transferNumToWrite)
+			{
+				twi->TWI_THR = transferBuffer[done];
+			}
+			else
+			{
+				twi->TWI_CR = TWI_CR_STOP;
+				twi->TWI_IDR = 0xFFFFFFFF;
+				transferPhase = TransferPhase::finishing;
+				twi->TWI_IER = TWI_IER_TXCOMP | TWI_IER_NACK;
+			}
+		}
+		break;
+
+	case TransferPhase::reading:
+		if (sr & TWI_SR_RXRDY)
+		{
+			size_t done = transferDone;
+			transferBuffer[done++] = (uint8_t)twi->TWI_RHR;
+			transferDone = done;
+			if (done + 1 == transferTotal)
+			{
+				twi->TWI_CR = TWI_CR_STOP;		// the stop condition must be requested before the last byte is received
+			}
+			else if (done == transferTotal)
+			{
+				twi->TWI_IDR = 0xFFFFFFFF;
+				transferPhase = TransferPhase::finishing;
+				twi->TWI_IER = TWI_IER_TXCOMP | TWI_IER_NACK;
+			}
+		}
+		break;
+
+	case TransferPhase::finishing:
+		if (sr & TWI_SR_TXCOMP)
+		{
+			FinishTransfer(twi, false);
+		}
+		break;
+
+	case TransferPhase::idle:
+		twi->TWI_IDR = 0xFFFFFFFF;
+		break;
+	}
+}
+
+extern "C" void WIRE_ISR_HANDLER() noexcept
+{
+	if (transferPhase != TransferPhase::idle)
+	{
+		TransferInterrupt(WIRE_INTERFACE);
+	}
+	else
+	{
+		WIRE_INTERFACE->TWI_IDR = 0xFFFFFFFF;
+		TaskBase::GiveFromISR(twiTask);			// wake up the task
+		twiTask = nullptr;
+	}
+}
+
 uint32_t I2C::statusWaitFunc(Twi *twi, uint32_t bitsToWaitFor) noexcept
 {
 	bool ok = true;
@@ -61,6 +155,85 @@ uint32_t I2C::statusWaitFunc(Twi *twi, uint32_t bitsToWaitFor) noexcept
 	return sr;
 }
 
+size_t I2C::Transfer(uint16_t address, uint8_t *buffer, size_t numToWrite, size_t numToRead) noexcept
+{
+	MutexLocker Lock(Tasks::GetI2CMutex());
+
+	// The TWI can only send up to 3 bytes as an internal address before a repeated start, so use the polled transfer for longer writes followed by a read
+	if ((numToRead != 0 && numToWrite > 3) || numToWrite + numToRead == 0)
+	{
+		return I2C_IFACE.Transfer(address, buffer, numToWrite, numToRead, statusWaitFunc);
+	}
+
+	Twi * const twi = WIRE_INTERFACE;
+	(void)twi->TWI_SR;							// clear any old NACK
+	transferBuffer = buffer;
+	transferNumToWrite = numToWrite;
+	transferTotal = numToWrite + numToRead;
+	transferDone = 0;
+	transferFailed = false;
+	twiTask = TaskBase::GetCallerTaskHandle();
+	TaskBase::ClearCurrentTaskNotifyCount();
+
+	twi->TWI_IDR = 0xFFFFFFFF;
+	if (numToRead == 0)
+	{
+		// Write the bytes one at a time from the ISR, then send a stop condition
+		twi->TWI_MMR = TWI_MMR_DADR(address);
+		transferPhase = TransferPhase::writing;
+		twi->TWI_THR = buffer[0];				// this starts the transfer
+		twi->TWI_IER = TWI_IER_TXRDY | TWI_IER_NACK;
+	}
+	else
+	{
+		// Send any bytes to write as the internal address, then a repeated start, then read the bytes from the ISR
+		uint32_t iadr = 0;
+		for (size_t i = 0; i < numToWrite; ++i)
+		{
+			iadr = (iadr << 8) | buffer[i];
+		}
+		twi->TWI_MMR = TWI_MMR_DADR(address) | TWI_MMR_MREAD | (numToWrite << TWI_MMR_IADRSZ_Pos);
+		twi->TWI_IADR = iadr;
+		transferDone = numToWrite;
+		transferPhase = TransferPhase::reading;
+		twi->TWI_CR = (numToRead == 1) ? TWI_CR_START | TWI_CR_STOP : TWI_CR_START;
+		twi->TWI_IER = TWI_IER_RXRDY | TWI_IER_NACK;
+	}
+	NVIC_EnableIRQ(I2C_IRQn);
+
+	++numTransfers;
+	const bool completed = TaskBase::Take(I2cByteTimeoutMillis * (transferTotal + 1)) && transferPhase == TransferPhase::idle;
+	if (!completed)
+	{
+		// The device didn't respond or held the clock low for too long, so abandon the transfer and reset the interface
+		IrqDisable();
+		twi->TWI_IDR = 0xFFFFFFFF;
+		transferPhase = TransferPhase::idle;
+		twiTask = nullptr;
+		IrqEnable();
+		++numTimeouts;
+		I2C_IFACE.BeginMaster(I2cClockFreq);
+		return 0;
+	}
+
+	if (transferFailed)
+	{
+		++numNaks;
+		const size_t done = transferDone;
+		return (numToRead == 0 && done != 0) ? done - 1 : done;	// when writing, the last byte we loaded wasn't acknowledged
+	}
+	return transferTotal;
+}
+
+void I2C::Diagnostics(MessageType mtype) noexcept
+{
+	const TwoWire::ErrorCounts errs = I2C_IFACE.GetErrorCounts(true);
+	reprap.GetPlatform().MessageF(mtype, "I2C transfers %" PRIu32 ", nak errors %" PRIu32 ", timeouts %" PRIu32
+										", polled nak errors %" PRIu32 ", send timeouts %" PRIu32 ", receive timeouts %" PRIu32 ", finishTimeouts %" PRIu32 ", resets %" PRIu32 "\n",
+									numTransfers, numNaks, numTimeouts, errs.naks, errs.sendTimeouts, errs.recvTimeouts, errs.finishTimeouts, errs.resets);
+	numTransfers = numNaks = numTimeouts = 0;
+}
+
 #endif
 
 // End
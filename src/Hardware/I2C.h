@@ -23,14 +23,15 @@ namespace I2C
 
 	uint32_t statusWaitFunc(Twi *twi, uint32_t bitsToWaitFor) noexcept;
 
-	// Transfer data to/from an I2C peripheral.
+	// Transfer data to/from an I2C peripheral. The bytes to write are taken from the start of the buffer and the bytes read are stored after them.
+	// Return the number of bytes transferred, which is numToWrite + numToRead if successful.
+	// Apart from transfers that write more than 3 bytes and then read, the whole transfer is done by the TWI interrupt and the calling task sleeps until it completes.
+	// Tasks that request transfers at the same time queue on the I2C mutex.
 	// If the caller needs to do multiple I2C transactions without being interrupted, it should own the i2C mutex before calling this.
 	// Otherwise the caller need not own the mutex because it will be acquired here.
-	inline size_t Transfer(uint16_t address, uint8_t *buffer, size_t numToWrite, size_t numToRead) noexcept
-	{
-		MutexLocker Lock(Tasks::GetI2CMutex());
-		return I2C_IFACE.Transfer(address, buffer, numToWrite, numToRead, statusWaitFunc);
-	}
+	size_t Transfer(uint16_t address, uint8_t *buffer, size_t numToWrite, size_t numToRead) noexcept;
+
+	void Diagnostics(MessageType mtype) noexcept;
 
 #endif
 
@@ -13,6 +13,11 @@
 # include <RTOSIface/RTOSIface.h>
 #endif
 
+uint16_t NonVolatileMemory::pendingCalibrationBits = 0;
+uint32_t NonVolatileMemory::whenLastChangeScheduled = 0;
+int8_t NonVolatileMemory::pendingLowCalibration[MaxCalibratedThermistors];
+int8_t NonVolatileMemory::pendingHighCalibration[MaxCalibratedThermistors];
+
 NonVolatileMemory::NonVolatileMemory() noexcept : state(NvmState::notRead)
 {
 }
@@ -47,6 +52,8 @@ void NonVolatileMemory::EnsureRead() noexcept
 
 void NonVolatileMemory::EnsureWritten() noexcept
 {
+	ApplyPendingChanges();
+
 #if SAME5x
 	if (state >= NvmState::writeNeeded)
 	{
@@ -126,14 +133,19 @@ SoftwareResetData* NonVolatileMemory::AllocateResetDataSlot() noexcept
 	return &buffer.resetData[0];
 }
 
+// Get a calibration value. If a change to it has been scheduled but not yet written, return the new value.
 int8_t NonVolatileMemory::GetThermistorLowCalibration(unsigned int inputNumber) noexcept
 {
-	return GetThermistorCalibration(inputNumber, buffer.thermistorLowCalibration);
+	return (inputNumber < MaxCalibratedThermistors && (pendingCalibrationBits & (1u << inputNumber)) != 0)
+			? pendingLowCalibration[inputNumber]
+				: GetThermistorCalibration(inputNumber, buffer.thermistorLowCalibration);
 }
 
 int8_t NonVolatileMemory::GetThermistorHighCalibration(unsigned int inputNumber) noexcept
 {
-	return GetThermistorCalibration(inputNumber, buffer.thermistorHighCalibration);
+	return (inputNumber < MaxCalibratedThermistors && (pendingCalibrationBits & (1u << (inputNumber + MaxCalibratedThermistors))) != 0)
+			? pendingHighCalibration[inputNumber]
+				: GetThermistorCalibration(inputNumber, buffer.thermistorHighCalibration);
 }
 
 void NonVolatileMemory::SetThermistorLowCalibration(unsigned int inputNumber, int8_t val) noexcept
@@ -146,6 +158,57 @@ void NonVolatileMemory::SetThermistorHighCalibration(unsigned int inputNumber, i
 	SetThermistorCalibration(inputNumber, val, buffer.thermistorHighCalibration);
 }
 
+// Copy any scheduled changes into our buffer so that they get written along with our own changes
+void NonVolatileMemory::ApplyPendingChanges() noexcept
+{
+	const uint16_t bits = pendingCalibrationBits;
+	if (bits != 0)
+	{
+		pendingCalibrationBits = 0;
+		for (unsigned int i = 0; i < MaxCalibratedThermistors; ++i)
+		{
+			if (bits & (1u << i))
+			{
+				SetThermistorCalibration(i, pendingLowCalibration[i], buffer.thermistorLowCalibration);
+			}
+			if (bits & (1u << (i + MaxCalibratedThermistors)))
+			{
+				SetThermistorCalibration(i, pendingHighCalibration[i], buffer.thermistorHighCalibration);
+			}
+		}
+	}
+}
+
+/*static*/ void NonVolatileMemory::ScheduleThermistorLowCalibration(unsigned int inputNumber, int8_t val) noexcept
+{
+	if (inputNumber < MaxCalibratedThermistors)
+	{
+		pendingLowCalibration[inputNumber] = val;
+		pendingCalibrationBits |= 1u << inputNumber;
+		whenLastChangeScheduled = millis();
+	}
+}
+
+/*static*/ void NonVolatileMemory::ScheduleThermistorHighCalibration(unsigned int inputNumber, int8_t val) noexcept
+{
+	if (inputNumber < MaxCalibratedThermistors)
+	{
+		pendingHighCalibration[inputNumber] = val;
+		pendingCalibrationBits |= 1u << (inputNumber + MaxCalibratedThermistors);
+		whenLastChangeScheduled = millis();
+	}
+}
+
+// Write all the scheduled changes with a single erase and write. The caller must choose a time when stalling for a few milliseconds doesn't matter.
+/*static*/ void NonVolatileMemory::WritePendingChanges() noexcept
+{
+	if (pendingCalibrationBits != 0)
+	{
+		NonVolatileMemory mem;
+		mem.EnsureWritten();
+	}
+}
+
 int8_t NonVolatileMemory::GetThermistorCalibration(unsigned int inputNumber, uint8_t *calibArray) noexcept
 {
 	EnsureRead();
@@ -28,11 +28,21 @@ public:
 	void SetThermistorLowCalibration(unsigned int inputNumber, int8_t val) noexcept;
 	void SetThermistorHighCalibration(unsigned int inputNumber, int8_t val) noexcept;
 
+	// Deferred writes. Changes made by calling these are held in RAM and written together when WritePendingChanges is called, or when any
+	// NonVolatileMemory object is next written. This avoids stalling the caller while the flash page is erased and written.
+	static void ScheduleThermistorLowCalibration(unsigned int inputNumber, int8_t val) noexcept;
+	static void ScheduleThermistorHighCalibration(unsigned int inputNumber, int8_t val) noexcept;
+	static bool HasPendingChanges() noexcept { return pendingCalibrationBits != 0; }
+	static uint32_t WhenLastChangeScheduled() noexcept { return whenLastChangeScheduled; }
+	static void WritePendingChanges() noexcept;
+
+	static constexpr uint32_t PendingChangesWriteDelay = 2000;	// how many milliseconds to wait after the last change was scheduled, so that changes made together are written together
 	static constexpr unsigned int NumberOfResetDataSlots = 3;
 	static constexpr unsigned int MaxCalibratedThermistors = 8;
 
 private:
 	void EnsureRead() noexcept;
+	void ApplyPendingChanges() noexcept;
 	int8_t GetThermistorCalibration(unsigned int inputNumber, uint8_t *calibArray) noexcept;
 	void SetThermistorCalibration(unsigned int inputNumber, int8_t val, uint8_t *calibArray) noexcept;
 
@@ -54,6 +64,14 @@ private:
 
 	alignas(4) NVM buffer;
 	NvmState state;
+
+	// Changes waiting to be written. Bits 0 to MaxCalibratedThermistors-1 flag pending low calibration values, the next MaxCalibratedThermistors bits the high ones.
+	static uint16_t pendingCalibrationBits;
+	static uint32_t whenLastChangeScheduled;
+	static int8_t pendingLowCalibration[MaxCalibratedThermistors];
+	static int8_t pendingHighCalibration[MaxCalibratedThermistors];
+
+	static_assert(2 * MaxCalibratedThermistors <= 16);
 };
 
 #endif /* SRC_HARDWARE_NONVOLATILEMEMORY_H_ */
@@ -29,6 +29,7 @@ extern "C" {
 #include <Platform/TaskPriorities.h>
 #include <Platform/RepRap.h>
 #include <Platform/Platform.h>
+#include <Platform/CpuUsage.h>
 
 extern Mutex lwipMutex;
 
@@ -134,6 +135,9 @@ uint32_t lwip_rx_rate = 0;
 // At present, we only use receive interrupts
 extern "C" void GMAC_Handler() noexcept
 {
+#if SUPPORT_CPU_USAGE_STATS
+	CpuUsage::IsrTimer isrTimer(CpuUsage::IsrId::network);
+#endif
 	/* Get interrupt status. */
 	const uint32_t ul_isr = gmac_get_interrupt_status(GMAC);
 
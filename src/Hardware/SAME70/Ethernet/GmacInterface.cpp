@@ -58,6 +58,7 @@ extern "C" {
 #include <Platform/TaskPriorities.h>
 #include <Platform/RepRap.h>
 #include <Platform/Platform.h>
+#include <Platform/CpuUsage.h>
 
 extern Mutex lwipMutex;
 
@@ -167,6 +168,9 @@ uint32_t lwip_rx_rate = 0;
 // At present, we only use receive interrupts
 extern "C" void GMAC_Handler() noexcept
 {
+#if SUPPORT_CPU_USAGE_STATS
+	CpuUsage::IsrTimer isrTimer(CpuUsage::IsrId::network);
+#endif
 	/* Get interrupt status. */
 	const uint32_t ul_isr = gmac_get_interrupt_status(GMAC);
 
@@ -657,6 +661,9 @@ void ethernetif_hardware_init() noexcept
 	gmac_enable_copy_all(GMAC, false);
 	gmac_disable_broadcast(GMAC, false);
 	GMAC->GMAC_NCFGR |= GMAC_NCFGR_RXCOEN;			// check IP, UDP and TCP checksums so that we don't need to do it in lwip
+#if LWIP_HIGH_THROUGHPUT
+	GMAC->GMAC_DCFGR |= GMAC_DCFGR_TXCOEN;			// generate IP, UDP and TCP checksums, which lwip leaves as zero. This needs the full transmit packet buffer, which is the default.
+#endif
 
 #if SUPPORT_MULTICAST_DISCOVERY
 	// Without this code, we don't receive any multicast packets
@@ -8,12 +8,20 @@
 #include "SharedSpiClient.h"
 #include "SharedSpiDevice.h"
 #include <Hardware/IoPorts.h>
+#include <Movement/StepTimer.h>
 
 // SharedSpiDevice class members
 SharedSpiClient::SharedSpiClient(SharedSpiDevice& dev, uint32_t clockFreq, SpiMode m, Pin p, bool polarity) noexcept
-	: device(dev), clockFrequency(clockFreq), csPin(p), mode(m), csActivePolarity(polarity)
+	: device(dev), next(nullptr), clockFrequency(clockFreq), csPin(p), mode(m), csActivePolarity(polarity),
+	  numSelects(0), numBytes(0), selectedTicks(0), whenSelected(0)
 {
 	InitCsPin();
+	device.AddClient(this);
+}
+
+SharedSpiClient::~SharedSpiClient() noexcept
+{
+	device.RemoveClient(this);
 }
 
 void SharedSpiClient::InitCsPin() const noexcept
@@ -33,6 +41,8 @@ bool SharedSpiClient::Select(uint32_t timeout) const noexcept
 		device.SetClockFrequencyAndMode(clockFrequency, mode);		// this also enables the SPI peripheral
 		delayMicroseconds(1);										// allow the clock time to settle
 		IoPort::WriteDigital(csPin, csActivePolarity);
+		whenSelected = StepTimer::GetTimerTicks();
+		++numSelects;
 	}
 	return ok;
 }
@@ -43,11 +53,13 @@ void SharedSpiClient::Deselect() const noexcept
 	IoPort::WriteDigital(csPin, !csActivePolarity);
 	delayMicroseconds(1);											// in case the clock makes an abrupt transition when we disable SPI
 	device.Disable();
+	selectedTicks += StepTimer::GetTimerTicks() - whenSelected;
 	device.Release();
 }
 
 bool SharedSpiClient::TransceivePacket(const uint8_t* tx_data, uint8_t* rx_data, size_t len) const noexcept
 {
+	numBytes += len;
 	return device.TransceivePacket(tx_data, rx_data, len);
 }
 
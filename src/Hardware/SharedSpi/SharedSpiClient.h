@@ -21,6 +21,10 @@ class SharedSpiClient
 {
 public:
 	SharedSpiClient(SharedSpiDevice& dev, uint32_t clockFreq, SpiMode m, Pin p, bool polarity) noexcept;
+	~SharedSpiClient() noexcept;
+
+	SharedSpiClient(const SharedSpiClient&) = delete;
+	SharedSpiClient& operator=(const SharedSpiClient&) = delete;
 
 	void SetCsPin(Pin p) noexcept { csPin = p; InitCsPin(); }
 	void SetCsPolarity(bool b) noexcept { csActivePolarity = b; }
@@ -35,13 +39,22 @@ public:
 	bool WritePacket(const uint8_t *tx_data, size_t len) const noexcept { return TransceivePacket(tx_data, nullptr, len); }
 
 private:
+	friend class SharedSpiDevice;
+
 	void InitCsPin() const noexcept;
 
 	SharedSpiDevice& device;
+	SharedSpiClient *next;										// the next client of the same device
 	uint32_t clockFrequency;
 	Pin csPin;
 	SpiMode mode;
 	bool csActivePolarity;
+
+	// Bus usage statistics, reported and cleared by SharedSpiDevice::Diagnostics
+	mutable uint32_t numSelects;
+	mutable uint32_t numBytes;
+	mutable uint32_t selectedTicks;								// the total time in step clocks for which this client has owned the bus
+	mutable uint32_t whenSelected;
 };
 
 #endif /* SRC_HARDWARE_SHAREDSPI_SHAREDSPICLIENT_H_ */
@@ -6,8 +6,12 @@
  */
 
 #include "SharedSpiDevice.h"
+#include "SharedSpiClient.h"
 
 #include <Hardware/IoPorts.h>
+#include <Movement/StepTimer.h>
+#include <Platform/RepRap.h>
+#include <Platform/Platform.h>
 
 #if SAME5x
 # include <DmacManager.h>
@@ -29,11 +33,15 @@ constexpr uint32_t SpiTimeout = 10000;
 
 SharedSpiDevice::SharedSpiDevice(uint8_t sercomNum) noexcept
 #if SAME5x
-	: hardware(Serial::Sercoms[sercomNum])
+	: hardware(Serial::Sercoms[sercomNum]),
 #elif USART_SPI
-	: hardware(USART_SSPI)			// we ignore the parameter and support just one shared SPI
+	: hardware(USART_SSPI),			// we ignore the parameter and support just one shared SPI
 #else
-	: hardware(SHARED_SPI)			// we ignore the parameter and support just one shared SPI
+	: hardware(SHARED_SPI),			// we ignore the parameter and support just one shared SPI
+#endif
+	  clients(nullptr), whenDiagnosticsReported(millis()), numPolledTransfers(0)
+#if SUPPORT_SHARED_SPI_DMA
+	  , numDmaTransfers(0), numDmaTimeouts(0)
 #endif
 {
 #if SAME5x
@@ -96,6 +104,11 @@ SharedSpiDevice::SharedSpiDevice(uint8_t sercomNum) noexcept
 					| US_MR_CHMODE_NORMAL;
 	hardware->US_BRGR = SystemPeripheralClock()/DefaultSharedSpiClockFrequency;
 	hardware->US_CR = US_CR_RSTRX | US_CR_RSTTX | US_CR_RXDIS | US_CR_TXDIS | US_CR_RSTSTA;
+# if SUPPORT_SHARED_SPI_DMA
+	hardware->US_PTCR = PERIPH_PTCR_RXTDIS | PERIPH_PTCR_TXTDIS;
+	NVIC_SetPriority(SSPI_IRQn, NvicPrioritySpi);
+	NVIC_EnableIRQ(SSPI_IRQn);
+# endif
 
 #else
 
@@ -260,8 +273,18 @@ void SharedSpiDevice::SetClockFrequencyAndMode(uint32_t freq, SpiMode mode) cons
 }
 
 // Send and receive data returning true if successful
-bool SharedSpiDevice::TransceivePacket(const uint8_t* tx_data, uint8_t* rx_data, size_t len) const noexcept
+bool SharedSpiDevice::TransceivePacket(const uint8_t* tx_data, uint8_t* rx_data, size_t len) noexcept
 {
+#if SUPPORT_SHARED_SPI_DMA
+	// Sleeping until a short transfer completes would take longer than polling, and we mustn't sleep if we were called with the scheduler locked out
+	if (len >= SharedSpiDmaMinBytes && (tx_data != nullptr || rx_data != nullptr) && !inInterrupt() && __get_BASEPRI() == 0)
+	{
+		return DmaTransceivePacket(tx_data, rx_data, len);
+	}
+#endif
+
+	++numPolledTransfers;
+
 	// Clear any existing data
 #if SAME5x
 	(void)hardware->SPI.DATA.reg;
@@ -336,6 +359,136 @@ bool SharedSpiDevice::TransceivePacket(const uint8_t* tx_data, uint8_t* rx_data,
 	return true;	// success
 }
 
+#if SUPPORT_SHARED_SPI_DMA
+
+static TaskHandle sspiTask = nullptr;						// the task that is waiting for a DMA transfer to complete
+
+// Shared SPI USART interrupt handler
+extern "C" void SSPI_Handler() noexcept
+{
+	USART_SSPI->US_IDR = 0xFFFFFFFF;						// disable all USART interrupts
+	if (sspiTask != nullptr)
+	{
+		TaskBase::GiveFromISR(sspiTask);					// wake up the task
+		sspiTask = nullptr;
+	}
+}
+
+// Send and receive data using the PDC, sleeping until the transfer is complete. Return true if successful.
+bool SharedSpiDevice::DmaTransceivePacket(const uint8_t *tx_data, uint8_t *rx_data, size_t len) noexcept
+{
+	++numDmaTransfers;
+	hardware->US_PTCR = PERIPH_PTCR_RXTDIS | PERIPH_PTCR_TXTDIS;
+	(void)hardware->US_RHR;
+	hardware->US_CR = US_CR_RSTSTA;
+
+	if (rx_data != nullptr)
+	{
+		if (tx_data == nullptr)
+		{
+			// The PDC can't send a fixed value, so send 0xFF bytes from the receive buffer. Each byte is sent before the byte received in its place is stored.
+			memset(rx_data, 0xFF, len);
+			tx_data = rx_data;
+		}
+		hardware->US_RPR = reinterpret_cast<uint32_t>(rx_data);
+		hardware->US_RCR = len;
+	}
+	hardware->US_TPR = reinterpret_cast<uint32_t>(tx_data);
+	hardware->US_TCR = len;
+
+	hardware->US_PTCR = (rx_data != nullptr) ? PERIPH_PTCR_RXTEN | PERIPH_PTCR_TXTEN : PERIPH_PTCR_TXTEN;
+
+	// Suspend this task until the PDC has finished. When only sending, we wait for the last byte to leave the shift register below.
+	// We loop because a notification left over from something else could wake us early.
+	const uint32_t interruptBits = (rx_data != nullptr) ? US_IER_ENDRX : US_IER_ENDTX;
+	bool ok = true;
+	while (ok && (hardware->US_CSR & interruptBits) == 0)
+	{
+		sspiTask = TaskBase::GetCallerTaskHandle();
+		hardware->US_IER = interruptBits;
+		ok = TaskBase::Take(SharedSpiDmaTimeoutMillis);
+	}
+	hardware->US_IDR = 0xFFFFFFFF;
+	hardware->US_PTCR = PERIPH_PTCR_RXTDIS | PERIPH_PTCR_TXTDIS;
+	sspiTask = nullptr;
+	if (!ok)
+	{
+		++numDmaTimeouts;
+		return false;
+	}
+
+	// Wait for transmitter empty, to make sure that the last clock pulse has finished
+	waitForTxEmpty();
+
+	// If we were not receiving, clear data from the receive buffer and the overrun error
+	if (rx_data == nullptr)
+	{
+		(void)hardware->US_RHR;
+		hardware->US_CR = US_CR_RSTSTA;
+	}
+	return true;
+}
+
+#endif
+
+// Add a client to the list that we report bus usage for
+void SharedSpiDevice::AddClient(SharedSpiClient *client) noexcept
+{
+	TaskCriticalSectionLocker lock;
+	client->next = clients;
+	clients = client;
+}
+
+void SharedSpiDevice::RemoveClient(SharedSpiClient *client) noexcept
+{
+	TaskCriticalSectionLocker lock;
+	for (SharedSpiClient **pp = &clients; *pp != nullptr; pp = &((*pp)->next))
+	{
+		if (*pp == client)
+		{
+			*pp = client->next;
+			break;
+		}
+	}
+}
+
+// Report the bus usage of each client since we last reported it, and clear the statistics
+void SharedSpiDevice::Diagnostics(MessageType mtype) noexcept
+{
+	const uint32_t now = millis();
+	const float intervalTicks = (float)(now - whenDiagnosticsReported) * (float)(StepTimer::GetTickRate()/1000);
+	whenDiagnosticsReported = now;
+
+	Platform& p = reprap.GetPlatform();
+#if SUPPORT_SHARED_SPI_DMA
+	p.MessageF(mtype, "Shared SPI: polled transfers %" PRIu32 ", DMA transfers %" PRIu32 ", DMA timeouts %" PRIu32 "\n", numPolledTransfers, numDmaTransfers, numDmaTimeouts);
+	numDmaTransfers = numDmaTimeouts = 0;
+#else
+	p.MessageF(mtype, "Shared SPI: transfers %" PRIu32 "\n", numPolledTransfers);
+#endif
+	numPolledTransfers = 0;
+
+	// Collect the statistics inside a critical section so that clients can't be removed from the list while we do it, then print them
+	String<StringLength256> buf;
+	{
+		TaskCriticalSectionLocker lock;
+		for (SharedSpiClient *client = clients; client != nullptr; client = client->next)
+		{
+			if (client->numSelects != 0)
+			{
+				buf.catf(" CS pin %u: selects %" PRIu32 ", bytes %" PRIu32 ", busy %.2f%%\n",
+							(unsigned int)client->csPin, client->numSelects, client->numBytes,
+							(intervalTicks > 0.0) ? (double)((float)client->selectedTicks * 100.0/intervalTicks) : 0.0);
+				client->numSelects = client->numBytes = client->selectedTicks = 0;
+			}
+		}
+	}
+	if (!buf.IsEmpty())
+	{
+		p.Message(mtype, buf.c_str());
+	}
+}
+
 // Static members
 
 SharedSpiDevice *SharedSpiDevice::mainSharedSpiDevice = nullptr;
@@ -12,6 +12,8 @@
 #include <RTOSIface/RTOSIface.h>
 #include "SpiMode.h"
 
+class SharedSpiClient;
+
 class SharedSpiDevice
 {
 public:
@@ -22,7 +24,8 @@ public:
 	void SetClockFrequencyAndMode(uint32_t freq, SpiMode mode) const noexcept;
 
 	// Send and receive data returning true if successful. Caller must already own the mutex and have asserted CS.
-	bool TransceivePacket(const uint8_t *tx_data, uint8_t *rx_data, size_t len) const noexcept;
+	// Long transfers are done by DMA if it is supported, with the calling task sleeping until the transfer is complete.
+	bool TransceivePacket(const uint8_t *tx_data, uint8_t *rx_data, size_t len) noexcept;
 
 	// Get ownership of this SPI, return true if successful
 	bool Take(uint32_t timeout) noexcept { return mutex.Take(timeout); }
@@ -30,10 +33,18 @@ public:
 	// Release ownership of this SPI
 	void Release() noexcept { mutex.Release(); }
 
+	void AddClient(SharedSpiClient *client) noexcept;
+	void RemoveClient(SharedSpiClient *client) noexcept;
+	void Diagnostics(MessageType mtype) noexcept;
+
 	static void Init() noexcept;
 	static SharedSpiDevice& GetMainSharedSpiDevice() noexcept { return *mainSharedSpiDevice; }
+	static SharedSpiDevice *GetMainSharedSpiDevicePointer() noexcept { return mainSharedSpiDevice; }
 
 private:
+#if SUPPORT_SHARED_SPI_DMA
+	bool DmaTransceivePacket(const uint8_t *tx_data, uint8_t *rx_data, size_t len) noexcept;
+#endif
 	bool waitForTxReady() const noexcept;
 	bool waitForTxEmpty() const noexcept;
 	bool waitForRxReady() const noexcept;
@@ -47,6 +58,13 @@ private:
 #endif
 
 	Mutex mutex;
+	SharedSpiClient *clients;									// linked list of the clients of this device, for reporting bus usage
+	uint32_t whenDiagnosticsReported;							// the time in milliseconds when we last reported and cleared the statistics
+	uint32_t numPolledTransfers;
+#if SUPPORT_SHARED_SPI_DMA
+	uint32_t numDmaTransfers;
+	uint32_t numDmaTimeouts;
+#endif
 
 	static SharedSpiDevice *mainSharedSpiDevice;
 };
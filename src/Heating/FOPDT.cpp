@@ -37,6 +37,7 @@ constexpr ObjectModelTableEntry FopDt::objectModelTable[] =
 	{ "heatingRate",		OBJECT_MODEL_FUNC(self->heatingRate, 3),											ObjectModelEntryFlags::none },
 	{ "inverted",			OBJECT_MODEL_FUNC(self->inverted),													ObjectModelEntryFlags::none },
 	{ "maxPwm",				OBJECT_MODEL_FUNC(self->maxPwm, 2),													ObjectModelEntryFlags::none },
+	{ "mpc",				OBJECT_MODEL_FUNC(self->UseModelPredictiveControl()),								ObjectModelEntryFlags::none },
 	{ "pid",				OBJECT_MODEL_FUNC(self, 1),															ObjectModelEntryFlags::none },
 	{ "standardVoltage",	OBJECT_MODEL_FUNC(self->standardVoltage, 1),										ObjectModelEntryFlags::none },
 
@@ -48,7 +49,7 @@ constexpr ObjectModelTableEntry FopDt::objectModelTable[] =
 	{ "used",				OBJECT_MODEL_FUNC(self->usePid),													ObjectModelEntryFlags::none },
 };
 
-constexpr uint8_t FopDt::objectModelTableDescriptor[] = { 2, 10, 5 };
+constexpr uint8_t FopDt::objectModelTableDescriptor[] = { 2, 11, 5 };
 
 DEFINE_GET_OBJECT_MODEL_TABLE(FopDt)
 
@@ -118,6 +119,7 @@ bool FopDt::SetParameters(const CanMessageHeaterModelNewNew& msg, float temperat
 		maxPwm = msg.maxPwm;
 		standardVoltage = msg.standardVoltage;
 		usePid = msg.usePid;
+		useMpc = false;
 		inverted = msg.inverted;
 		pidParametersOverridden = msg.pidParametersOverridden;
 
@@ -154,7 +156,7 @@ void FopDt::SetDefaultToolParameters() noexcept
 	maxPwm = 1.0;
 	standardVoltage = 0.0;
 	usePid = true;
-	inverted = pidParametersOverridden = false;
+	useMpc = inverted = pidParametersOverridden = false;
 	CalcPidConstants(200.0);
 	enabled = true;
 }
@@ -170,7 +172,7 @@ void FopDt::SetDefaultBedOrChamberParameters() noexcept
 	maxPwm = 1.0;
 	standardVoltage = 0.0;
 	usePid = false;
-	inverted = pidParametersOverridden = false;
+	useMpc = inverted = pidParametersOverridden = false;
 	CalcPidConstants(60.0);
 	enabled = true;
 }
@@ -212,7 +214,7 @@ void FopDt::AppendM307Command(unsigned int heaterNumber, const StringRef& str, b
 				(double)deadTime,
 				(double)coolingRateExponent,
 				(double)maxPwm,
-				(usePid) ? 0 : 1);
+				(!usePid) ? 1 : (useMpc) ? 2 : 0);
 	if (inverted)
 	{
 		str.cat(" I1");
@@ -238,6 +240,7 @@ void FopDt::AppendM301Command(unsigned int heaterNumber, const StringRef& str) c
 void FopDt::AppendModelParameters(unsigned int heaterNumber, const StringRef& str, bool includeVoltage) const noexcept
 {
 	const char* const mode = (!usePid) ? "bang-bang"
+								: (useMpc) ? "model predictive"
 								: (pidParametersOverridden) ? "custom PID"
 									: "PID";
 	str.catf("Heater %u: heating rate %.3f, cooling rate %.3f", heaterNumber, (double)heatingRate, (double)basicCoolingRate);
@@ -59,6 +59,7 @@ public:
 	float GetMaxPwm() const noexcept { return maxPwm; }
 	float GetVoltage() const noexcept { return standardVoltage; }
 	bool UsePid() const noexcept { return usePid; }
+	bool UseModelPredictiveControl() const noexcept { return usePid && useMpc; }
 	bool IsInverted() const noexcept { return inverted; }
 	bool IsEnabled() const noexcept { return enabled; }
 
@@ -78,6 +79,7 @@ public:
 	bool ArePidParametersOverridden() const noexcept { return pidParametersOverridden; }
 	M301PidParameters GetM301PidParameters(bool forLoadChange) const noexcept;
 	void SetM301PidParameters(const M301PidParameters& params) noexcept;
+	void SetUseModelPredictiveControl(bool b) noexcept { useMpc = b; }
 
 	const PidParameters& GetPidParameters(bool forLoadChange) const noexcept
 	{
@@ -109,6 +111,7 @@ private:
 	float standardVoltage;					// power voltage reading at which tuning was done, or 0 if unknown
 	bool enabled;
 	bool usePid;
+	bool useMpc;							// if usePid is also true, use model predictive control instead of PID
 	bool inverted;
 	bool pidParametersOverridden;
 
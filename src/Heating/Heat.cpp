@@ -27,8 +27,13 @@ Licence: GPL
 #include <GCodes/GCodeBuffer/GCodeBuffer.h>
 #include <Tools/Tool.h>
 #include <Platform/TaskPriorities.h>
+#include <Fans/FansManager.h>
 #include <General/Portability.h>
 
+#if SUPPORT_SPI_SENSORS
+# include <Hardware/SharedSpi/SharedSpiDevice.h>
+#endif
+
 #if SUPPORT_DHT_SENSOR
 # include "Sensors/DhtSensor.h"
 #endif
@@ -57,6 +62,10 @@ constexpr uint32_t HeaterTaskStackWords = 470;			// task stack size in dwords, m
 constexpr uint32_t HeaterTaskStackWords = 420;			// task stack size in dwords, must be large enough for auto tuning. 400 was not quite enough for one Duet WiFi user running 3.2.2.
 #endif
 
+#if SUPPORT_SPI_SENSORS
+constexpr uint32_t SpiSensorsBusTimeout = 10;			// how long we wait to get the shared SPI bus before polling the SPI temperature sensors, in milliseconds
+#endif
+
 static Task<HeaterTaskStackWords> heaterTask;
 
 TaskHandle Heat::GetHeatTask() noexcept
@@ -119,7 +128,7 @@ ReadWriteLock Heat::heatersLock;
 ReadWriteLock Heat::sensorsLock;
 
 Heat::Heat() noexcept
-	: sensorCount(0), sensorsRoot(nullptr), sensorOrderingErrors(0), coldExtrude(false), heaterBeingTuned(-1), lastHeaterTuned(-1)
+	: sensorCount(0), sensorsRoot(nullptr), sensorOrderingErrors(0), coldExtrude(false)
 #if SUPPORT_REMOTE_COMMANDS
 	, newHeaterFaultState(0), newDriverFaultState(0)
 #endif
@@ -326,11 +335,30 @@ void Heat::SendHeatersStatus(CanMessageBuffer& buf) noexcept
 
 [[noreturn]] void Heat::HeaterTask() noexcept
 {
-	uint32_t nextWakeTime = millis();
+	// Each heater is spun every N ticks where N is its sample interval divided by Heater::SampleTickMillis, so on each pass we wake up at the next tick on which
+	// one or more heaters are due. Sensor polling and the regular broadcasts happen every RegularTicks ticks, which is also the default heater sample interval.
+	static_assert(HeatSampleIntervalMillis % Heater::SampleTickMillis == 0, "HeatSampleIntervalMillis must be a multiple of the heater tick");
+	constexpr uint32_t RegularTicks = HeatSampleIntervalMillis/Heater::SampleTickMillis;
+
+	uint32_t tickNumber = 0;
+	uint32_t lastTickTime = millis();
 	for (;;)
 	{
-		// Wait until we are woken or it's time to send another regular broadcast. If we are really unlucky, we could end up waiting for one tick too long.
-		nextWakeTime += HeatSampleIntervalMillis;
+		uint32_t ticksToWait = RegularTicks - (tickNumber % RegularTicks);
+		{
+			ReadLocker lock(heatersLock);
+			for (const Heater *h : heaters)
+			{
+				if (h != nullptr)
+				{
+					const uint32_t ticks = h->GetSampleIntervalTicks();
+					ticksToWait = min<uint32_t>(ticksToWait, ticks - (tickNumber % ticks));
+				}
+			}
+		}
+
+		// Wait until we are woken or it's time for the next tick. If we are really unlucky, we could end up waiting for one tick too long.
+		const uint32_t nextWakeTime = lastTickTime + ticksToWait * Heater::SampleTickMillis;
 		int32_t delayTime = (int32_t)(nextWakeTime - millis());
 		if (delayTime > 0)
 		{
@@ -360,8 +388,16 @@ void Heat::SendHeatersStatus(CanMessageBuffer& buf) noexcept
 		}
 #endif
 
-		// Check whether it is time to poll sensors and PIDs and send regular messages
-		if ((int32_t)(millis() - nextWakeTime) >= 0)
+		// Check whether it is time to spin any heaters, and whether it is time to poll sensors and send regular messages
+		if ((int32_t)(millis() - nextWakeTime) < 0)
+		{
+			continue;
+		}
+		tickNumber += ticksToWait;
+		lastTickTime = nextWakeTime;
+		const bool regularTick = (tickNumber % RegularTicks) == 0;
+
+		if (regularTick)
 		{
 #if SUPPORT_REMOTE_COMMANDS
 			// Announce ourselves to the main board, if it hasn't acknowledged us already
@@ -381,10 +417,16 @@ void Heat::SendHeatersStatus(CanMessageBuffer& buf) noexcept
 					unsigned int nextUnreportedSensor = 0;
 #endif
 					ReadLocker lock(sensorsLock);
+#if SUPPORT_SPI_SENSORS
+					PollSharedSpiSensors();
+#endif
 					TemperatureSensor *currentSensor = sensorsRoot;
 					while (currentSensor != nullptr)
 					{
-						currentSensor->Poll();
+						if (!currentSensor->UsesSharedSpi())
+						{
+							currentSensor->Poll();
+						}
 #if SUPPORT_CAN_EXPANSION
 						if (currentSensor->GetBoardAddress() == CanInterface::GetCanAddress() && sensorsFound < ARRAY_SIZE(msg->temperatureReports))
 						{
@@ -418,38 +460,56 @@ void Heat::SendHeatersStatus(CanMessageBuffer& buf) noexcept
 #endif
 			}
 
-			// Spin the heaters
+			reprap.GetFansManager().UpdateFanRpms(HeatSampleIntervalMillis);
+		}
+
+		// Spin the heaters that are due. On ticks when we didn't poll all the sensors, poll the sensor of each heater we spin first.
+		{
+			ReadLocker lock(heatersLock);
+			for (Heater *h : heaters)
 			{
-				ReadLocker lock(heatersLock);
-				for (Heater *h : heaters)
+				if (h != nullptr && (tickNumber % h->GetSampleIntervalTicks()) == 0)
 				{
-					if (h != nullptr)
+					if (!regularTick)
 					{
-						h->Spin();
+						const auto sensor = FindSensor(h->GetSensorNumber());
+						if (sensor.IsNotNull())
+						{
+							sensor->Poll();
+						}
 					}
+					h->Spin();
 				}
 			}
+		}
 
-			// See if we have finished tuning a heater
-			if (heaterBeingTuned != -1)
+		if (regularTick)
+		{
+			// See if we have finished tuning any heaters
+			for (unsigned int heater = 0; heater < MaxHeaters; ++heater)
 			{
-				const auto h = FindHeater(heaterBeingTuned);
-				if (h.IsNull() || h->GetStatus() != HeaterStatus::tuning)
+				if (heatersBeingTuned.IsBitSet(heater))
 				{
-					lastHeaterTuned = heaterBeingTuned;
-					heaterBeingTuned = -1;
-				}
+					const auto h = FindHeater(heater);
+					if (h.IsNull() || h->GetStatus() != HeaterStatus::tuning)
+					{
+						TaskCriticalSectionLocker lock;
+						heatersBeingTuned.ClearBit(heater);
+						heatersTuned.SetBit(heater);
+					}
 #if SUPPORT_REMOTE_COMMANDS
-				else if (CanInterface::InExpansionMode())
-				{
-					auto msg = buf.SetupStatusMessage<CanMessageHeaterTuningReport>(CanInterface::GetCanAddress(), CanInterface::GetCurrentMasterAddress());
-					if (LocalHeater::GetTuningCycleData(*msg))
+					else if (CanInterface::InExpansionMode())
 					{
-						msg->SetStandardFields(heaterBeingTuned);
-						CanInterface::SendMessageNoReplyNoFree(&buf);
+						// In expansion mode we only allow one heater to be tuned at a time, so any tuning cycle data is for this heater
+						auto msg = buf.SetupStatusMessage<CanMessageHeaterTuningReport>(CanInterface::GetCanAddress(), CanInterface::GetCurrentMasterAddress());
+						if (LocalHeater::GetTuningCycleData(*msg))
+						{
+							msg->SetStandardFields(heater);
+							CanInterface::SendMessageNoReplyNoFree(&buf);
+						}
 					}
-				}
 #endif
+				}
 			}
 
 #if SUPPORT_REMOTE_COMMANDS
@@ -938,12 +998,21 @@ GCodeResult Heat::ConfigureHeaterMonitoring(size_t heater, GCodeBuffer& gb, cons
 	h->GetFaultDetectionParameters(maxTempExcursion, maxFaultTime);
 	gb.TryGetFValue('P', maxFaultTime, seenValue);
 	gb.TryGetFValue('T', maxTempExcursion, seenValue);
+	if (gb.Seen('Q'))
+	{
+		const GCodeResult rslt = h->SetSampleInterval(gb.GetUIValue(), reply);
+		if (rslt != GCodeResult::ok || !seenValue)
+		{
+			return rslt;
+		}
+	}
 	if (seenValue)
 	{
 		return h->SetFaultDetectionParameters(maxTempExcursion, maxFaultTime, reply);
 	}
 
-	reply.printf("Heater %u allowed excursion %.1f" DEGREE_SYMBOL "C, fault trigger time %.1f seconds", heater, (double)maxTempExcursion, (double)maxFaultTime);
+	reply.printf("Heater %u allowed excursion %.1f" DEGREE_SYMBOL "C, fault trigger time %.1f seconds, sample interval %" PRIu32 "ms",
+					heater, (double)maxTempExcursion, (double)maxFaultTime, h->GetSampleIntervalMillis());
 	return GCodeResult::ok;
 }
 
@@ -990,13 +1059,30 @@ GCodeResult Heat::TuneHeater(GCodeBuffer& gb, const StringRef& reply) THROWS(GCo
 
 	if (seenHeater || seenTool)
 	{
-		if (heaterBeingTuned != -1)
+		// Several heaters may be tuned at the same time, but it's up to the user to make sure that they are thermally independent.
+		// We can check that they don't share any fans, because each heater needs to turn its fans on and off independently during tuning.
+		if (heatersBeingTuned.IsBitSet(heaterNumber))
 		{
-			// Trying to start a new auto tune, but we are already tuning a heater
-			reply.printf("Error: cannot start a new auto tune because heater %d is being tuned", heaterBeingTuned);
+			reply.printf("Error: heater %d is already being tuned", heaterNumber);
 			return GCodeResult::error;
 		}
 
+		GCodeResult rslt = GCodeResult::ok;
+		heatersBeingTuned.Iterate([this, fans, &reply, &rslt](unsigned int otherHeater, unsigned int)
+									{
+										const auto h = FindHeater(otherHeater);
+										if (rslt == GCodeResult::ok && h.IsNotNull() && h->GetStatus() == HeaterStatus::tuning && h->GetTuningFans().Intersects(fans))
+										{
+											reply.printf("Error: cannot start a new auto tune because heater %u is being tuned using the same fan", otherHeater);
+											rslt = GCodeResult::error;
+										}
+									}
+								 );
+		if (rslt != GCodeResult::ok)
+		{
+			return rslt;
+		}
+
 		const auto h = FindHeater(heaterNumber);
 		if (h.IsNull())
 		{
@@ -1004,25 +1090,39 @@ GCodeResult Heat::TuneHeater(GCodeBuffer& gb, const StringRef& reply) THROWS(GCo
 			return GCodeResult::error;
 		}
 
-		const GCodeResult rslt = h->StartAutoTune(gb, reply, fans);
+		rslt = h->StartAutoTune(gb, reply, fans);
 		if (Succeeded(rslt))
 		{
-			heaterBeingTuned = (int8_t)heaterNumber;
+			TaskCriticalSectionLocker lock;
+			if (heatersBeingTuned.IsEmpty())
+			{
+				heatersTuned.Clear();					// this is the first heater of a new set, so forget the results of the previous set
+			}
+			heatersTuned.ClearBit(heaterNumber);
+			heatersBeingTuned.SetBit(heaterNumber);
 		}
 		return rslt;
 	}
 
-	// If we get here then neither T nor H was given, so report the auto tune status
-	const int whichPid = (heaterBeingTuned == -1) ? lastHeaterTuned : heaterBeingTuned;
-	const auto h = FindHeater(whichPid);
-
-	if (h.IsNotNull())
+	// If we get here then neither T nor H was given, so report the auto tune status of all the heaters being tuned and the ones we finished tuning
+	const HeatersBitmap heatersToReport = heatersBeingTuned | heatersTuned;
+	if (heatersToReport.IsEmpty())
 	{
-		h->GetAutoTuneStatus(reply);
+		reply.copy("No heater has been tuned since startup");
 	}
 	else
 	{
-		reply.copy("No heater has been tuned since startup");
+		heatersToReport.Iterate([this, &reply](unsigned int heater, unsigned int)
+								{
+									const auto h = FindHeater(heater);
+									if (h.IsNotNull())
+									{
+										String<StringLength100> status;
+										h->GetAutoTuneStatus(status.GetRef());
+										reply.lcat(status.c_str());
+									}
+								}
+							   );
 	}
 	return GCodeResult::ok;
 }
@@ -1175,6 +1275,21 @@ float Heat::GetSensorTemperature(int sensorNum, TemperatureError& err) const noe
 	return BadErrorTemperature;
 }
 
+// Get a reading taken now from a sensor that supports it, otherwise its latest reading. Used by the height controller, which samples faster than the sensors are polled.
+float Heat::GetSensorInstantReading(int sensorNum, TemperatureError& err) const noexcept
+{
+	const auto sensor = FindSensor(sensorNum);
+	if (sensor.IsNotNull())
+	{
+		float temp;
+		err = sensor->GetInstantReading(temp);
+		return temp;
+	}
+
+	err = TemperatureError::unknownSensor;
+	return BadErrorTemperature;
+}
+
 // Return the highest used heater number plus one. Used by RepRap.cpp to shorten responses by omitting unused trailing heater numbers.
 size_t Heat::GetNumHeatersToReport() const noexcept
 {
@@ -1206,6 +1321,22 @@ size_t Heat::GetNumSensorsToReport() const noexcept
 }
 
 // Suspend the heaters to conserve power or while doing Z probing
+// Suspend all local heaters that are on, so that they can be resumed later. Safe to call from an ISR. Called only from the tick ISR when the power is failing.
+void Heat::SuspendLocalHeatersFromISR() noexcept
+{
+	for (Heater* h : heaters)
+	{
+		if (h != nullptr
+#if SUPPORT_CAN_EXPANSION
+			&& h->IsLocal()
+#endif
+		   )
+		{
+			h->Suspend(true);
+		}
+	}
+}
+
 void Heat::SuspendHeaters(bool sus) noexcept
 {
 	for (Heater *h : heaters)
@@ -1217,6 +1348,36 @@ void Heat::SuspendHeaters(bool sus) noexcept
 	}
 }
 
+#if SUPPORT_SPI_SENSORS
+
+// Poll all the sensors that use the shared SPI bus within a single period of bus ownership. Must read-lock the sensors lock before calling this.
+// The SPI mutex is recursive, so each sensor can still select itself in the usual way. Doing this means that we don't compete with other users
+// of the bus (e.g. TMC drivers on some boards) once per sensor, and these sensors are read at consistent intervals after the start of the tick.
+void Heat::PollSharedSpiSensors() noexcept
+{
+	bool triedBus = false, ownBus = false;
+	for (TemperatureSensor *sensor = sensorsRoot; sensor != nullptr; sensor = sensor->GetNext())
+	{
+		if (sensor->UsesSharedSpi())
+		{
+			if (!triedBus)
+			{
+				// If we can't get the bus quickly then each sensor will try again for itself, and report busBusy if it fails
+				ownBus = SharedSpiDevice::GetMainSharedSpiDevice().Take(SpiSensorsBusTimeout);
+				triedBus = true;
+			}
+			sensor->Poll();
+		}
+	}
+
+	if (ownBus)
+	{
+		SharedSpiDevice::GetMainSharedSpiDevice().Release();
+	}
+}
+
+#endif
+
 // Delete a sensor, if there is one. Must write-lock the sensors lock before calling this.
 void Heat::DeleteSensor(unsigned int sn) noexcept
 {
@@ -1306,48 +1467,80 @@ bool Heat::WriteBedAndChamberTempSettings(FileStore *f) const noexcept
 
 #if SUPPORT_CAN_EXPANSION
 
+// Process a sensor temperatures report from an expansion board.
+// We apply all the reports in a single pass of the sensors list, which is in increasing sensor number order, with the sensors list locked just once.
 void Heat::ProcessRemoteSensorsReport(CanAddress src, const CanMessageSensorTemperatures& msg) noexcept
 {
 	Bitmap<uint64_t> sensorsReported(msg.whichSensors);
-	sensorsReported.Iterate([this, src, &msg](unsigned int sensor, unsigned int index)
-								{
-									if (index < ARRAY_SIZE(msg.temperatureReports))
+	Bitmap<uint64_t> sensorsNotFound;
+	{
+		ReadLocker lock(sensorsLock);
+		TemperatureSensor *ts = sensorsRoot;
+		sensorsReported.Iterate([src, &msg, &ts, &sensorsNotFound](unsigned int sensor, unsigned int index)
 									{
-										const CanSensorReport& sr = msg.temperatureReports[index];
-										auto ts = FindSensor(sensor);
-										if (ts.IsNotNull())
-										{
-											ts->UpdateRemoteTemperature(src, sr);
-										}
-# ifdef DUET3_ATE
-										else
+										if (index < ARRAY_SIZE(msg.temperatureReports))
 										{
-											Duet3Ate::ProcessOrphanedSensorReport(src, sensor, sr);
+											while (ts != nullptr && ts->GetSensorNumber() < sensor)
+											{
+												ts = ts->GetNext();
+											}
+											if (ts != nullptr && ts->GetSensorNumber() == sensor)
+											{
+												ts->UpdateRemoteTemperature(src, msg.temperatureReports[index]);
+											}
+											else
+											{
+												sensorsNotFound.SetBit(sensor);
+											}
 										}
-# elif SUPPORT_REMOTE_COMMANDS
-										else if (CanInterface::InExpansionMode())
+									}
+								);
+	}
+
+# if defined(DUET3_ATE) || SUPPORT_REMOTE_COMMANDS
+	// Deal with any reports for sensors that we don't have. This is rare, so we don't mind looking up the index of each report again.
+	sensorsReported.Iterate([this, src, &msg, sensorsNotFound](unsigned int sensor, unsigned int index)
+								{
+									if (sensorsNotFound.IsBitSet(sensor))
+									{
+										const CanSensorReport& sr = msg.temperatureReports[index];
+#  ifdef DUET3_ATE
+										Duet3Ate::ProcessOrphanedSensorReport(src, sensor, sr);
+#  else
+										if (CanInterface::InExpansionMode())
 										{
-											// Create a new RemoteSensor
-											ts.Release();
-											RemoteSensor * const rs = new RemoteSensor(sensor, src);
-											rs->UpdateRemoteTemperature(src, sr);
-											InsertSensor(rs);
+											// Create a new RemoteSensor, unless another task created the sensor after we released the read lock
+											WriteLocker lock(sensorsLock);
+											const TemperatureSensor *existing = sensorsRoot;
+											while (existing != nullptr && existing->GetSensorNumber() < sensor)
+											{
+												existing = existing->GetNext();
+											}
+											if (existing == nullptr || existing->GetSensorNumber() != sensor)
+											{
+												RemoteSensor * const rs = new RemoteSensor(sensor, src);
+												rs->UpdateRemoteTemperature(src, sr);
+												InsertSensor(rs);
+											}
 										}
-# endif
+#  endif
 									}
 								}
 							);
+# endif
 }
 
+// Process a heaters status report from an expansion board, locking the heaters list just once
 void Heat::ProcessRemoteHeatersReport(CanAddress src, const CanMessageHeatersStatus& msg) noexcept
 {
 	Bitmap<uint64_t> heatersReported(msg.whichHeaters);
+	ReadLocker lock(heatersLock);
 	heatersReported.Iterate([this, src, &msg](unsigned int heaterNum, unsigned int index)
 								{
-									if (index < ARRAY_SIZE(msg.reports))
+									if (index < ARRAY_SIZE(msg.reports) && heaterNum < MaxHeaters)
 									{
-										const auto h = FindHeater(heaterNum);
-										if (h.IsNotNull())
+										Heater * const h = heaters[heaterNum];
+										if (h != nullptr)
 										{
 											h->UpdateRemoteStatus(src, msg.reports[index]);
 										}
@@ -1464,9 +1657,12 @@ GCodeResult Heat::SetHeaterMonitors(const CanMessageSetHeaterMonitors& msg, cons
 
 GCodeResult Heat::TuningCommand(const CanMessageHeaterTuningCommand& msg, const StringRef& reply) noexcept
 {
-	if (heaterBeingTuned != -1 && heaterBeingTuned != (int)msg.heaterNumber)
+	// The tuning cycle data that we report to the main board is shared between heaters, so we only allow one heater on this board to be tuned at a time
+	HeatersBitmap otherHeatersBeingTuned = heatersBeingTuned;
+	otherHeatersBeingTuned.ClearBit(msg.heaterNumber);
+	if (!otherHeatersBeingTuned.IsEmpty())
 	{
-		reply.printf("Heater %d is already being tuned", heaterBeingTuned);
+		reply.printf("Heater %u is already being tuned", otherHeatersBeingTuned.LowestSetBit());
 		return GCodeResult::error;
 	}
 	const auto h = FindHeater(msg.heaterNumber);
@@ -1474,7 +1670,10 @@ GCodeResult Heat::TuningCommand(const CanMessageHeaterTuningCommand& msg, const
 	{
 		return UnknownHeater(msg.heaterNumber, reply);
 	}
-	heaterBeingTuned = (int)msg.heaterNumber;			// setting this is OK even if we are stopping or fail to start tuning, because we check it in the heater task loop
+	{
+		TaskCriticalSectionLocker lock;
+		heatersBeingTuned.SetBit(msg.heaterNumber);	// setting this is OK even if we are stopping or fail to start tuning, because we check it in the heater task loop
+	}
 	return h->TuningCommand(msg, reply);
 }
 
@@ -75,6 +75,7 @@ public:
 
 	void SwitchOffAll(bool includingChamberAndBed) noexcept;			// Turn all heaters off. Not safe to call from an ISR.
 	void SwitchOffAllLocalFromISR() noexcept;							// Turn off all local heaters. Safe to call from an ISR.
+	void SuspendLocalHeatersFromISR() noexcept;							// Suspend all local heaters that are on. Safe to call from an ISR.
 	void SuspendHeaters(bool sus) noexcept;								// Suspend the heaters to conserve power or while probing
 	GCodeResult ResetFault(int heater, const StringRef& reply) noexcept;	// Reset a heater fault for a specific heater or all heaters
 
@@ -88,6 +89,7 @@ public:
 	ReadLockedPointer<TemperatureSensor> FindSensorAtOrAbove(unsigned int sn) const noexcept;	// Get a pointer to the first temperature sensor with the specified or higher number
 
 	float GetSensorTemperature(int sensorNum, TemperatureError& err) const noexcept; // Result is in degrees Celsius
+	float GetSensorInstantReading(int sensorNum, TemperatureError& err) const noexcept;				// take a reading now if the sensor supports it
 
 	float GetHighestTemperatureLimit() const noexcept;					// Get the highest temperature limit of any heater
 	size_t GetNumHeatersToReport() const noexcept;
@@ -166,6 +168,9 @@ private:
 	ReadLockedPointer<Heater> FindHeater(int heater) const noexcept;
 	void DeleteSensor(unsigned int sn) noexcept;
 	void InsertSensor(TemperatureSensor *newSensor) noexcept;
+#if SUPPORT_SPI_SENSORS
+	void PollSharedSpiSensors() noexcept;
+#endif
 
 #if SUPPORT_REMOTE_COMMANDS
 	void SendHeatersStatus(CanMessageBuffer& buf) noexcept;
@@ -185,8 +190,8 @@ private:
 	bool coldExtrude;											// Is cold extrusion allowed?
 	int8_t bedHeaters[MaxBedHeaters];							// Indices of the hot bed heaters to use or -1 if none is available
 	int8_t chamberHeaters[MaxChamberHeaters];					// Indices of the chamber heaters to use or -1 if none is available
-	int8_t heaterBeingTuned;									// which PID is currently being tuned
-	int8_t lastHeaterTuned;										// which PID we last finished tuning
+	HeatersBitmap heatersBeingTuned;							// which heaters are currently being tuned
+	HeatersBitmap heatersTuned;									// which heaters have finished tuning since we last started tuning with no heaters being tuned
 
 #if SUPPORT_REMOTE_COMMANDS
 	uint8_t newHeaterFaultState;								// 0 = normal, 1 = new heater fault, 2 = sent heater fault CAN message
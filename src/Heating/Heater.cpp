@@ -44,6 +44,7 @@ constexpr ObjectModelTableEntry Heater::objectModelTable[] =
 	{ "min",		OBJECT_MODEL_FUNC(self->GetLowestTemperatureLimit(), 1), 								ObjectModelEntryFlags::none },
 	{ "model",		OBJECT_MODEL_FUNC((const FopDt *)&self->GetModel()),									ObjectModelEntryFlags::none },
 	{ "monitors",	OBJECT_MODEL_FUNC_NOSELF(&monitorsArrayDescriptor), 									ObjectModelEntryFlags::none },
+	{ "sampleInterval", OBJECT_MODEL_FUNC((int32_t)self->GetSampleIntervalMillis()), 						ObjectModelEntryFlags::none },
 	{ "sensor",		OBJECT_MODEL_FUNC((int32_t)self->GetSensorNumber()), 									ObjectModelEntryFlags::none },
 	{ "standby",	OBJECT_MODEL_FUNC(self->GetStandbyTemperature(), 1), 									ObjectModelEntryFlags::live },
 	{ "state",		OBJECT_MODEL_FUNC(self->GetStatus().ToString()), 										ObjectModelEntryFlags::live },
@@ -56,44 +57,14 @@ constexpr ObjectModelTableEntry Heater::objectModelTable[] =
 										self->monitors[context.GetLastIndex()].GetTemperatureLimit(), 1),	ObjectModelEntryFlags::none },
 };
 
-constexpr uint8_t Heater::objectModelTableDescriptor[] = { 2, 10, 3 };
+constexpr uint8_t Heater::objectModelTableDescriptor[] = { 2, 11, 3 };
 
 DEFINE_GET_OBJECT_MODEL_TABLE(Heater)
 
 #endif
 
-// Static members of class Heater
-
-float Heater::tuningPwm;								// the PWM to use, 0..1
-float Heater::tuningTargetTemp;							// the target temperature
-float Heater::tuningHysteresis;
-float Heater::tuningFanPwm;
-
-DeviationAccumulator Heater::tuningStartTemp;			// the temperature when we turned on the heater
-DeviationAccumulator Heater::dHigh;
-DeviationAccumulator Heater::dLow;
-DeviationAccumulator Heater::tOn;
-DeviationAccumulator Heater::tOff;
-DeviationAccumulator Heater::heatingRate;
-DeviationAccumulator Heater::coolingRate;
-DeviationAccumulator Heater::tuningVoltage;				// sum of the voltage readings we take during the heating phase
-
-uint32_t Heater::tuningBeginTime;						// when we started the tuning process
-uint32_t Heater::lastOffTime;
-uint32_t Heater::lastOnTime;
-float Heater::peakTemp;									// max or min temperature
-uint32_t Heater::peakTime;								// the time at which we recorded peakTemp
-float Heater::afterPeakTemp;							// temperature after max from which we start timing the cooling rate
-uint32_t Heater::afterPeakTime;							// the time at which we recorded afterPeakTemp
-float Heater::lastCoolingRate;
-FansBitmap Heater::tuningFans;
-unsigned int Heater::tuningPhase;
-uint8_t Heater::idleCyclesDone;
-
-Heater::HeaterParameters Heater::fanOffParams, Heater::fanOnParams;
-
 // Clear all the counters except tuning voltage and start temperature
-/*static*/ void Heater::ClearCounters() noexcept
+void Heater::TuningData::ClearCounters() noexcept
 {
 	dHigh.Clear();
 	dLow.Clear();
@@ -104,8 +75,9 @@ Heater::HeaterParameters Heater::fanOffParams, Heater::fanOnParams;
 }
 
 Heater::Heater(unsigned int num) noexcept
-	: tuned(false), heaterNumber(num), sensorNumber(-1), activeTemperature(0.0), standbyTemperature(0.0),
+	: tuned(false), tuning(nullptr), heaterNumber(num), sensorNumber(-1), activeTemperature(0.0), standbyTemperature(0.0),
 	  maxTempExcursion(DefaultMaxTempExcursion), maxHeatingFaultTime(DefaultMaxHeatingFaultTime),
+	  sampleIntervalTicks(HeatSampleIntervalMillis/SampleTickMillis),
 	  isBedOrChamber(false),
 	  active(false), modelSetByUser(false), monitorsSetByUser(false)
 {
@@ -117,6 +89,17 @@ Heater::~Heater() noexcept
 	{
 		h.Disable();
 	}
+	delete tuning;
+}
+
+// Allocate the tuning variables if we haven't already. We never free them while the heater exists, because the heater task may be using them.
+bool Heater::AllocateTuningData() noexcept
+{
+	if (tuning == nullptr)
+	{
+		tuning = new TuningData;
+	}
+	return tuning != nullptr;
 }
 
 void Heater::SetSensorNumber(int sn) noexcept
@@ -137,7 +120,7 @@ GCodeResult Heater::SetOrReportModel(unsigned int heater, GCodeBuffer& gb, const
 		coolingRateExponent = model.GetCoolingRateExponent(),
 		basicCoolingRate = model.GetBasicCoolingRate(),
 		fanCoolingRate = model.GetFanCoolingRate();
-	int32_t dontUsePid = model.UsePid() ? 0 : 1;
+	int32_t controlMode = (!model.UsePid()) ? 1 : (model.UseModelPredictiveControl()) ? 2 : 0;		// B0 = PID, B1 = bang-bang, B2 = model predictive
 	int32_t inversionParameter = 0;
 
 	if (gb.Seen('K'))
@@ -184,7 +167,7 @@ GCodeResult Heater::SetOrReportModel(unsigned int heater, GCodeBuffer& gb, const
 	}
 
 	gb.TryGetFValue('D', td, seen);
-	gb.TryGetIValue('B', dontUsePid, seen);
+	gb.TryGetIValue('B', controlMode, seen);
 	gb.TryGetFValue('S', maxPwm, seen);
 	gb.TryGetFValue('V', voltage, seen);
 	gb.TryGetIValue('I', inversionParameter, seen);
@@ -192,12 +175,30 @@ GCodeResult Heater::SetOrReportModel(unsigned int heater, GCodeBuffer& gb, const
 	if (seen)
 	{
 		// Set the model
+		if (controlMode < 0 || controlMode > 2)
+		{
+			reply.copy("B parameter must be 0, 1 or 2");
+			return GCodeResult::error;
+		}
+#if SUPPORT_CAN_EXPANSION
+		if (controlMode == 2 && !IsLocal())
+		{
+			reply.printf("Heater %u is on an expansion board, which does not support model predictive control", heater);
+			return GCodeResult::error;
+		}
+#endif
 		const bool inverseTemperatureControl = (inversionParameter == 1 || inversionParameter == 3);
-		const GCodeResult rslt = SetModel(heatingRate, basicCoolingRate, fanCoolingRate, coolingRateExponent, td, maxPwm, voltage, dontUsePid == 0, inverseTemperatureControl, reply);
+		const bool wasUsingMpc = model.UseModelPredictiveControl();
+		model.SetUseModelPredictiveControl(controlMode == 2);				// set this first so that UpdateModel sees it
+		const GCodeResult rslt = SetModel(heatingRate, basicCoolingRate, fanCoolingRate, coolingRateExponent, td, maxPwm, voltage, controlMode != 1, inverseTemperatureControl, reply);
 		if (Succeeded(rslt))
 		{
 			modelSetByUser = true;
 		}
+		else
+		{
+			model.SetUseModelPredictiveControl(wasUsingMpc);
+		}
 		return rslt;
 	}
 
@@ -285,18 +286,24 @@ GCodeResult Heater::StartAutoTune(GCodeBuffer& gb, const StringRef& reply, FansB
 		reply.printf("Target temperature must be at least 20C above ambient temperature");
 	}
 
-	// Get abd store the optional parameters
-	tuningTargetTemp = targetTemp;
-	tuningFans = fans;
-	tuningPwm = (gb.Seen('P')) ? gb.GetLimitedFValue('P', 0.1, 1.0) : GetModel().GetMaxPwm();
-	tuningHysteresis = (gb.Seen('Y')) ? gb.GetLimitedFValue('Y', 1.0, 20.0) : DefaultTuningHysteresis;
-	tuningFanPwm = (gb.Seen('F')) ? gb.GetLimitedFValue('F', 0.1, 1.0) : DefaultTuningFanPwm;
+	if (!AllocateTuningData())
+	{
+		reply.copy("Insufficient memory to auto tune heater");
+		return GCodeResult::error;
+	}
+
+	// Get and store the optional parameters
+	tuning->tuningTargetTemp = targetTemp;
+	tuning->tuningFans = fans;
+	tuning->tuningPwm = (gb.Seen('P')) ? gb.GetLimitedFValue('P', 0.1, 1.0) : GetModel().GetMaxPwm();
+	tuning->tuningHysteresis = (gb.Seen('Y')) ? gb.GetLimitedFValue('Y', 1.0, 20.0) : DefaultTuningHysteresis;
+	tuning->tuningFanPwm = (gb.Seen('F')) ? gb.GetLimitedFValue('F', 0.1, 1.0) : DefaultTuningFanPwm;
 
 	const GCodeResult rslt = StartAutoTune(reply, seenA, ambientTemp);
 	if (rslt == GCodeResult::ok)
 	{
 		reply.printf("Auto tuning heater %u using target temperature %.1f" DEGREE_SYMBOL "C and PWM %.2f - do not leave printer unattended",
-						GetHeaterNumber(), (double)targetTemp, (double)tuningPwm);
+						GetHeaterNumber(), (double)targetTemp, (double)tuning->tuningPwm);
 	}
 	return rslt;
 }
@@ -313,14 +320,20 @@ const char *const Heater::TuningPhaseText[] =
 	"measuring with fan on"
 };
 
+// Get the fans that auto tuning this heater uses, which is none if the heater has never been tuned
+FansBitmap Heater::GetTuningFans() const noexcept
+{
+	return (tuning == nullptr) ? FansBitmap() : tuning->tuningFans;
+}
+
 // Get the auto tune status or last result
 void Heater::GetAutoTuneStatus(const StringRef& reply) const noexcept
 {
-	if (GetStatus() == HeaterStatus::tuning)
+	if (GetStatus() == HeaterStatus::tuning && tuning != nullptr)
 	{
 		// Phases are: 1 = stabilising, 2 = heating, 3 = settling, 4 = cycling with fan off, 5 = cycling with fan on
-		const unsigned int numPhases = (tuningFans.IsEmpty()) ? 4 : ARRAY_SIZE(TuningPhaseText);
-		reply.printf("Heater %u is being tuned, phase %u of %u, %s", GetHeaterNumber(), tuningPhase + 1, numPhases, TuningPhaseText[tuningPhase]);
+		const unsigned int numPhases = (tuning->tuningFans.IsEmpty()) ? 4 : ARRAY_SIZE(TuningPhaseText);
+		reply.printf("Heater %u is being tuned, phase %u of %u, %s", GetHeaterNumber(), tuning->tuningPhase + 1, numPhases, TuningPhaseText[tuning->tuningPhase]);
 	}
 	else if (tuned)
 	{
@@ -335,9 +348,9 @@ void Heater::GetAutoTuneStatus(const StringRef& reply) const noexcept
 // Tell the user what's happening, called after the tuning phase has been updated
 void Heater::ReportTuningUpdate() noexcept
 {
-	if (tuningPhase < ARRAY_SIZE(TuningPhaseText))
+	if (tuning->tuningPhase < ARRAY_SIZE(TuningPhaseText))
 	{
-		reprap.GetPlatform().MessageF(GenericMessage, "Auto tune starting phase %u, %s\n", tuningPhase, TuningPhaseText[tuningPhase]);
+		reprap.GetPlatform().MessageF(GenericMessage, "Auto tune of heater %u starting phase %u, %s\n", GetHeaterNumber(), tuning->tuningPhase, TuningPhaseText[tuning->tuningPhase]);
 	}
 }
 
@@ -347,51 +360,51 @@ void Heater::CalculateModel(HeaterParameters& params) noexcept
 	{
 #define PLUS_OR_MINUS "\xC2\xB1"
 		reprap.GetPlatform().MessageF(GenericMessage,
-										"tOn %ld" PLUS_OR_MINUS "%ld, tOff %ld" PLUS_OR_MINUS "%ld,"
-										" dHigh %ld" PLUS_OR_MINUS "%ld, dLow %ld" PLUS_OR_MINUS "%ld,"
+										"tuning->tOn %ld" PLUS_OR_MINUS "%ld, tuning->tOff %ld" PLUS_OR_MINUS "%ld,"
+										" tuning->dHigh %ld" PLUS_OR_MINUS "%ld, tuning->dLow %ld" PLUS_OR_MINUS "%ld,"
 										" R %.3f" PLUS_OR_MINUS "%.3f, C %.3f" PLUS_OR_MINUS "%.3f,"
 #if HAS_VOLTAGE_MONITOR
 										" V %.1f" PLUS_OR_MINUS "%.1f,"
 #endif
 										" cycles %u\n",
-										lrintf(tOn.GetMean()), lrintf(tOn.GetDeviation()),
-										lrintf(tOff.GetMean()), lrintf(tOff.GetDeviation()),
-										lrintf(dHigh.GetMean()), lrintf(dHigh.GetDeviation()),
-										lrintf(dLow.GetMean()), lrintf(dLow.GetDeviation()),
-										(double)heatingRate.GetMean(), (double)heatingRate.GetDeviation(),
-										(double)coolingRate.GetMean(), (double)coolingRate.GetDeviation(),
+										lrintf(tuning->tOn.GetMean()), lrintf(tuning->tOn.GetDeviation()),
+										lrintf(tuning->tOff.GetMean()), lrintf(tuning->tOff.GetDeviation()),
+										lrintf(tuning->dHigh.GetMean()), lrintf(tuning->dHigh.GetDeviation()),
+										lrintf(tuning->dLow.GetMean()), lrintf(tuning->dLow.GetDeviation()),
+										(double)tuning->heatingRate.GetMean(), (double)tuning->heatingRate.GetDeviation(),
+										(double)tuning->coolingRate.GetMean(), (double)tuning->coolingRate.GetDeviation(),
 #if HAS_VOLTAGE_MONITOR
-										(double)tuningVoltage.GetMean(), (double)tuningVoltage.GetDeviation(),
+										(double)tuning->tuningVoltage.GetMean(), (double)tuning->tuningVoltage.GetDeviation(),
 #endif
-										coolingRate.GetNumSamples()
+										tuning->coolingRate.GetNumSamples()
 									 );
 	}
 
-	const float cycleTime = tOn.GetMean() + tOff.GetMean();		// in milliseconds
-	const float averageTemperatureRiseHeating = tuningTargetTemp - 0.5 * (tuningHysteresis - TuningPeakTempDrop) - tuningStartTemp.GetMean();
-	const float averageTemperatureRiseCooling = tuningTargetTemp - TuningPeakTempDrop - 0.5 * tuningHysteresis - tuningStartTemp.GetMean();
-	const float averageTemperatureRise = (averageTemperatureRiseHeating * tOn.GetMean() + averageTemperatureRiseCooling * tOff.GetMean()) / cycleTime;
-	params.deadTime = (((dHigh.GetMean() * tOff.GetMean()) + (dLow.GetMean() * tOn.GetMean())) * MillisToSeconds)/cycleTime;	// in seconds
-	params.coolingRate = coolingRate.GetMean();
-	params.heatingRate = (heatingRate.GetMean() + (coolingRate.GetMean() * averageTemperatureRiseHeating/averageTemperatureRiseCooling)) / tuningPwm;
-	params.gain = (tOn.GetMean() + tOff.GetMean()) * averageTemperatureRise/tOn.GetMean();
-	params.numCycles = dHigh.GetNumSamples();
+	const float cycleTime = tuning->tOn.GetMean() + tuning->tOff.GetMean();		// in milliseconds
+	const float averageTemperatureRiseHeating = tuning->tuningTargetTemp - 0.5 * (tuning->tuningHysteresis - TuningPeakTempDrop) - tuning->tuningStartTemp.GetMean();
+	const float averageTemperatureRiseCooling = tuning->tuningTargetTemp - TuningPeakTempDrop - 0.5 * tuning->tuningHysteresis - tuning->tuningStartTemp.GetMean();
+	const float averageTemperatureRise = (averageTemperatureRiseHeating * tuning->tOn.GetMean() + averageTemperatureRiseCooling * tuning->tOff.GetMean()) / cycleTime;
+	params.deadTime = (((tuning->dHigh.GetMean() * tuning->tOff.GetMean()) + (tuning->dLow.GetMean() * tuning->tOn.GetMean())) * MillisToSeconds)/cycleTime;	// in seconds
+	params.coolingRate = tuning->coolingRate.GetMean();
+	params.heatingRate = (tuning->heatingRate.GetMean() + (tuning->coolingRate.GetMean() * averageTemperatureRiseHeating/averageTemperatureRiseCooling)) / tuning->tuningPwm;
+	params.gain = (tuning->tOn.GetMean() + tuning->tOff.GetMean()) * averageTemperatureRise/tuning->tOn.GetMean();
+	params.numCycles = tuning->dHigh.GetNumSamples();
 }
 
 void Heater::SetAndReportModelAfterTuning(bool usingFans) noexcept
 {
-	const float hRate = (usingFans) ? (fanOffParams.heatingRate + fanOnParams.heatingRate) * 0.5 : fanOffParams.heatingRate;
-	const float deadTime = (usingFans) ? (fanOffParams.deadTime + fanOnParams.deadTime) * 0.5 : fanOffParams.deadTime;
+	const float hRate = (usingFans) ? (tuning->fanOffParams.heatingRate + tuning->fanOnParams.heatingRate) * 0.5 : tuning->fanOffParams.heatingRate;
+	const float deadTime = (usingFans) ? (tuning->fanOffParams.deadTime + tuning->fanOnParams.deadTime) * 0.5 : tuning->fanOffParams.deadTime;
 	const float coolingRateExponent = (reprap.GetHeat().IsBedOrChamberHeater(GetHeaterNumber())) ? DefaultBedHeaterCoolingRateExponent : DefaultToolHeaterCoolingRateExponent;
-	const float averageTemperatureRiseCooling = tuningTargetTemp - TuningPeakTempDrop - 0.5 * tuningHysteresis - tuningStartTemp.GetMean();
-	const float basicCoolingRate = fanOffParams.coolingRate/powf(averageTemperatureRiseCooling * 0.01, coolingRateExponent);
+	const float averageTemperatureRiseCooling = tuning->tuningTargetTemp - TuningPeakTempDrop - 0.5 * tuning->tuningHysteresis - tuning->tuningStartTemp.GetMean();
+	const float basicCoolingRate = tuning->fanOffParams.coolingRate/powf(averageTemperatureRiseCooling * 0.01, coolingRateExponent);
 	float fanOnCoolingRate = 0.0;
 	if (usingFans)
 	{
 		// Sometimes the print cooling fan makes no difference to the cooling rate. The SetModel call will fail if the rate with fan on is lower than the rate with fan off.
-		if (fanOnParams.coolingRate > fanOffParams.coolingRate)
+		if (tuning->fanOnParams.coolingRate > tuning->fanOffParams.coolingRate)
 		{
-			fanOnCoolingRate = ((fanOnParams.coolingRate - fanOffParams.coolingRate) * 100.0)/(averageTemperatureRiseCooling * tuningFanPwm);
+			fanOnCoolingRate = ((tuning->fanOnParams.coolingRate - tuning->fanOffParams.coolingRate) * 100.0)/(averageTemperatureRiseCooling * tuning->tuningFanPwm);
 		}
 		else
 		{
@@ -405,9 +418,9 @@ void Heater::SetAndReportModelAfterTuning(bool usingFans) noexcept
 										fanOnCoolingRate,
 										coolingRateExponent,
 										deadTime,
-										tuningPwm,
+										tuning->tuningPwm,
 #if HAS_VOLTAGE_MONITOR
-										tuningVoltage.GetMean(),
+										tuning->tuningVoltage.GetMean(),
 #else
 										0.0,
 #endif
@@ -417,18 +430,18 @@ void Heater::SetAndReportModelAfterTuning(bool usingFans) noexcept
 		tuned = true;
 		str.printf(	"Auto tuning heater %u completed after %u idle and %u tuning cycles in %" PRIu32 " seconds. This heater needs the following M307 command:\n ",
 					GetHeaterNumber(),
-					idleCyclesDone,
-					(usingFans) ? fanOffParams.numCycles + fanOnParams.numCycles : fanOffParams.numCycles,
-					(millis() - tuningBeginTime)/(uint32_t)SecondsToMillis
+					tuning->idleCyclesDone,
+					(usingFans) ? tuning->fanOffParams.numCycles + tuning->fanOnParams.numCycles : tuning->fanOffParams.numCycles,
+					(millis() - tuning->tuningBeginTime)/(uint32_t)SecondsToMillis
 				  );
 		GetModel().AppendM307Command(GetHeaterNumber(), str.GetRef(), !reprap.GetHeat().IsBedOrChamberHeater(GetHeaterNumber()));
 		reprap.GetPlatform().Message(LoggedGenericMessage, str.c_str());
 		if (reprap.Debug(moduleHeat))
 		{
-			str.printf("Long term gain %.1f/%.1f", (double)fanOffParams.GetNormalGain(), (double)fanOffParams.gain);
+			str.printf("Long term gain %.1f/%.1f", (double)tuning->fanOffParams.GetNormalGain(), (double)tuning->fanOffParams.gain);
 			if (usingFans)
 			{
-				str.catf(" : %.1f/.1%f", (double)fanOnParams.GetNormalGain(), (double)fanOnParams.gain);
+				str.catf(" : %.1f/.1%f", (double)tuning->fanOnParams.GetNormalGain(), (double)tuning->fanOnParams.gain);
 			}
 			str.cat('\n');
 			reprap.GetPlatform().Message(GenericMessage, str.c_str());
@@ -461,6 +474,27 @@ GCodeResult Heater::SetFaultDetectionParameters(float pMaxTempExcursion, float p
 	return rslt;
 }
 
+// Set the interval between samples of this heater, in milliseconds
+GCodeResult Heater::SetSampleInterval(uint32_t interval, const StringRef& reply) noexcept
+{
+	if (interval < SampleTickMillis || interval > MaxSampleIntervalMillis || interval % SampleTickMillis != 0)
+	{
+		reply.printf("Heater %u sample interval must be a multiple of %" PRIu32 "ms between %" PRIu32 "ms and %" PRIu32 "ms",
+						heaterNumber, SampleTickMillis, SampleTickMillis, MaxSampleIntervalMillis);
+		return GCodeResult::error;
+	}
+
+	const uint16_t oldTicks = sampleIntervalTicks;
+	sampleIntervalTicks = interval/SampleTickMillis;
+	const GCodeResult rslt = UpdateSampleInterval(reply);
+	if (rslt != GCodeResult::ok)
+	{
+		sampleIntervalTicks = oldTicks;
+	}
+	reprap.HeatUpdated();
+	return rslt;
+}
+
 // Process M143 for this heater
 GCodeResult Heater::ConfigureMonitor(GCodeBuffer &gb, const StringRef &reply) THROWS(GCodeException)
 {
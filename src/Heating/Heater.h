@@ -75,11 +75,17 @@ public:
 	GCodeResult StartAutoTune(GCodeBuffer& gb, const StringRef& reply, FansBitmap fans) THROWS(GCodeException);
 																		// Start an auto tune cycle for this heater
 	void GetAutoTuneStatus(const StringRef& reply) const noexcept;		// Get the auto tune status or last result
+	FansBitmap GetTuningFans() const noexcept;							// Get the fans that auto tuning this heater uses
 
 	void GetFaultDetectionParameters(float& pMaxTempExcursion, float& pMaxFaultTime) const noexcept
 		{ pMaxTempExcursion = maxTempExcursion; pMaxFaultTime = maxHeatingFaultTime; }
 	GCodeResult SetFaultDetectionParameters(float pMaxTempExcursion, float pMaxFaultTime, const StringRef& reply) noexcept;
 
+	uint32_t GetSampleIntervalMillis() const noexcept { return sampleIntervalTicks * SampleTickMillis; }
+	uint32_t GetSampleIntervalTicks() const noexcept { return sampleIntervalTicks; }
+	GCodeResult SetSampleInterval(uint32_t interval, const StringRef& reply) noexcept;
+	int GetSensorNumber() const noexcept { return sensorNumber; }
+
 	GCodeResult ConfigureMonitor(GCodeBuffer &gb, const StringRef &reply) THROWS(GCodeException);
 
 	float GetHighestTemperatureLimit() const noexcept;
@@ -95,6 +101,9 @@ public:
 	GCodeResult SetHeaterMonitors(const CanMessageSetHeaterMonitors& msg, const StringRef& reply) noexcept;
 #endif
 
+	static constexpr uint32_t SampleTickMillis = 50;				// heater sample intervals are a multiple of this
+	static constexpr uint32_t MaxSampleIntervalMillis = 5000;
+
 	bool IsHeaterEnabled() const noexcept								// Is this heater enabled?
 		{ return model.IsEnabled(); }
 
@@ -132,9 +141,9 @@ protected:
 	virtual GCodeResult UpdateModel(const StringRef& reply) noexcept = 0;
 	virtual GCodeResult UpdateFaultDetectionParameters(const StringRef& reply) noexcept = 0;
 	virtual GCodeResult UpdateHeaterMonitors(const StringRef& reply) noexcept = 0;
+	virtual GCodeResult UpdateSampleInterval(const StringRef& reply) noexcept = 0;
 	virtual GCodeResult StartAutoTune(const StringRef& reply, bool seenA, float ambientTemp) noexcept = 0;
 
-	int GetSensorNumber() const noexcept { return sensorNumber; }
 	void SetSensorNumber(int sn) noexcept;
 	float GetMaxTemperatureExcursion() const noexcept { return maxTempExcursion; }
 	float GetMaxHeatingFaultTime() const noexcept { return maxHeatingFaultTime; }
@@ -161,36 +170,44 @@ protected:
 	static constexpr float TuningPeakTempDrop = 2.0;		// must be well below TuningHysteresis
 	static constexpr float HeaterSettledCoolingTimeRatio = 0.93;
 
-	// Variables used during heater tuning
-	static float tuningPwm;									// the PWM to use, 0..1
-	static float tuningTargetTemp;							// the target temperature
-	static float tuningHysteresis;
-	static float tuningFanPwm;
-
-	static DeviationAccumulator tuningStartTemp;			// the temperature when we turned on the heater
-	static uint32_t tuningBeginTime;						// when we started the tuning process
-	static DeviationAccumulator dHigh;
-	static DeviationAccumulator dLow;
-	static DeviationAccumulator tOn;
-	static DeviationAccumulator tOff;
-	static DeviationAccumulator heatingRate;
-	static DeviationAccumulator coolingRate;
-	static DeviationAccumulator tuningVoltage;				// sum of the voltage readings we take during the heating phase
-
-	static uint32_t lastOffTime;
-	static uint32_t lastOnTime;
-	static float peakTemp;									// max or min temperature
-	static uint32_t peakTime;								// the time at which we recorded peakTemp
-	static float afterPeakTemp;								// temperature after max from which we start timing the cooling rate
-	static uint32_t afterPeakTime;							// the time at which we recorded afterPeakTemp
-	static float lastCoolingRate;
-	static FansBitmap tuningFans;
-	static unsigned int tuningPhase;
-	static uint8_t idleCyclesDone;
-
-	static HeaterParameters fanOffParams, fanOnParams;
-
-	static void ClearCounters() noexcept;
+	// Variables used during heater tuning. Each heater has its own set so that several heaters can be tuned at the same time.
+	// They are allocated when the heater is first tuned, and kept until the heater is deleted so that the heater task never sees them disappear.
+	struct TuningData
+	{
+		float tuningPwm;									// the PWM to use, 0..1
+		float tuningTargetTemp;								// the target temperature
+		float tuningHysteresis;
+		float tuningFanPwm;
+
+		DeviationAccumulator tuningStartTemp;				// the temperature when we turned on the heater
+		uint32_t tuningBeginTime;							// when we started the tuning process
+		DeviationAccumulator dHigh;
+		DeviationAccumulator dLow;
+		DeviationAccumulator tOn;
+		DeviationAccumulator tOff;
+		DeviationAccumulator heatingRate;
+		DeviationAccumulator coolingRate;
+		DeviationAccumulator tuningVoltage;					// sum of the voltage readings we take during the heating phase
+
+		uint32_t lastOffTime;
+		uint32_t lastOnTime;
+		float peakTemp;										// max or min temperature
+		uint32_t peakTime;									// the time at which we recorded peakTemp
+		float afterPeakTemp;								// temperature after max from which we start timing the cooling rate
+		uint32_t afterPeakTime;								// the time at which we recorded afterPeakTemp
+		float lastCoolingRate;
+		FansBitmap tuningFans;
+		unsigned int tuningPhase;
+		uint8_t idleCyclesDone;
+
+		HeaterParameters fanOffParams, fanOnParams;
+
+		void ClearCounters() noexcept;
+	};
+
+	bool AllocateTuningData() noexcept;						// make sure that tuning points to a set of tuning variables, returning false if we ran out of memory
+
+	TuningData *null tuning;
 
 private:
 	static const char* const TuningPhaseText[];
@@ -202,6 +219,7 @@ private:
 	float standbyTemperature;						// the required standby temperature
 	float maxTempExcursion;							// the maximum temperature excursion permitted while maintaining the setpoint
 	float maxHeatingFaultTime;						// how long a heater fault is permitted to persist before a heater fault is raised
+	uint16_t sampleIntervalTicks;					// how often the heater task spins this heater, in units of SampleTickMillis
 
 	bool isBedOrChamber;							// true if this was a bed or chamber heater when we were switched on
 	bool active;									// are we active or standby?
@@ -9,6 +9,7 @@
 #include <GCodes/GCodes.h>
 #include <GCodes/GCodeBuffer/GCodeBuffer.h>
 #include "Heat.h"
+#include <Movement/Move.h>
 #include "HeaterMonitor.h"
 #include <Platform/Platform.h>
 #include <Platform/RepRap.h>
@@ -86,13 +87,20 @@ void LocalHeater::ResetHeater() noexcept
 	mode = HeaterMode::off;
 	previousTemperaturesGood = 0;
 	previousTemperatureIndex = 0;
-	iAccumulator = extrusionBoost = 0.0;
+	iAccumulator = extrusionBoost = mpcFeedForward = 0.0;
 	badTemperatureCount = 0;
 	averagePWM = lastPwm = 0.0;
 	heatingFaultCount = 0;
 	temperature = BadErrorTemperature;
 }
 
+// Called when the sample interval has been changed. The stored temperatures were taken at the old interval, so don't use them to calculate the derivative.
+GCodeResult LocalHeater::UpdateSampleInterval(const StringRef& reply) noexcept
+{
+	previousTemperaturesGood = 0;
+	return GCodeResult::ok;
+}
+
 // Configure the heater port and the sensor number
 GCodeResult LocalHeater::ConfigurePortAndSensor(const char *portName, PwmFrequency freq, unsigned int sn, const StringRef& reply)
 {
@@ -234,6 +242,10 @@ void LocalHeater::SwitchOff() noexcept
 // This is called when the heater model has been updated. Returns true if successful.
 GCodeResult LocalHeater::UpdateModel(const StringRef& reply) noexcept
 {
+	if (GetModel().UseModelPredictiveControl())
+	{
+		iAccumulator = mpcFeedForward = 0.0;		// the model correction we had is no longer valid
+	}
 	return GCodeResult::ok;
 }
 
@@ -261,12 +273,13 @@ void LocalHeater::Spin() noexcept
 	else
 	{
 		// We have an apparently-good temperature reading. Calculate the derivative, if possible.
+		const uint32_t sampleInterval = GetSampleIntervalMillis();
 		float derivative = 0.0;
 		bool gotDerivative = false;
 		badTemperatureCount = 0;
 		if ((previousTemperaturesGood & (1u << (NumPreviousTemperatures - 1))) != 0)
 		{
-			const float tentativeDerivative = (SecondsToMillis/(float)HeatSampleIntervalMillis) * (temperature - previousTemperatures[previousTemperatureIndex])
+			const float tentativeDerivative = (SecondsToMillis/(float)sampleInterval) * (temperature - previousTemperatures[previousTemperatureIndex])
 							/ (float)(NumPreviousTemperatures);
 			// Some sensors give occasional temperature spikes. We don't expect the temperature to increase by more than 10C/second.
 			if (fabsf(tentativeDerivative) <= 10.0)
@@ -318,7 +331,7 @@ void LocalHeater::Spin() noexcept
 								if (actualTemperatureRise < expectedTemperatureRise * ((IsBedOrChamber()) ? MinBedTemperatureRiseFactor : MinToolTemperatureRiseFactor))
 								{
 									++heatingFaultCount;
-									if (heatingFaultCount * HeatSampleIntervalMillis > GetMaxHeatingFaultTime() * SecondsToMillis)
+									if (heatingFaultCount * sampleInterval > GetMaxHeatingFaultTime() * SecondsToMillis)
 									{
 										RaiseHeaterFault(HeaterFaultType::temperatureRisingTooSlowly,
 															"expected %.2f" DEGREE_SYMBOL "C/sec measured %.2f" DEGREE_SYMBOL "C/sec",
@@ -344,7 +357,7 @@ void LocalHeater::Spin() noexcept
 				if (fabsf(error) > GetMaxTemperatureExcursion() && temperature > MaxAmbientTemperature)
 				{
 					++heatingFaultCount;
-					if (heatingFaultCount * HeatSampleIntervalMillis > GetMaxHeatingFaultTime() * SecondsToMillis)
+					if (heatingFaultCount * sampleInterval > GetMaxHeatingFaultTime() * SecondsToMillis)
 					{
 						RaiseHeaterFault(HeaterFaultType::exceededAllowedExcursion,
 											"target %.1f" DEGREE_SYMBOL "C actual %.1f" DEGREE_SYMBOL "C",
@@ -389,37 +402,44 @@ void LocalHeater::Spin() noexcept
 				// Performing normal temperature control
 				if (GetModel().UsePid())
 				{
-					// Using PID mode. Determine the PID parameters to use.
-					const bool inLoadMode = (mode == HeaterMode::stable) || fabsf(error) < 3.0;		// use standard PID when maintaining temperature
-					const PidParameters& params = GetModel().GetPidParameters(inLoadMode);
-
-					// If the P and D terms together demand that the heater is full on or full off, disregard the I term
-					const float errorMinusDterm = error - (params.tD * derivative);
-					const float pPlusD = params.kP * errorMinusDterm;
-					const float expectedPwm = GetModel().EstimateRequiredPwm(temperature - NormalAmbientTemperature, 0.0);
-					if (pPlusD + expectedPwm > GetModel().GetMaxPwm())
+					if (GetModel().UseModelPredictiveControl())
 					{
-						lastPwm = GetModel().GetMaxPwm();
-						// If we are heating up, preset the I term to the expected PWM at this temperature, ready for the switch over to PID
-						if (mode == HeaterMode::heating && error > 0.0 && derivative > 0.0)
-						{
-							iAccumulator = expectedPwm;
-						}
-					}
-					else if (pPlusD + expectedPwm < 0.0)
-					{
-						lastPwm = 0.0;
+						lastPwm = GetModelPredictivePwm(targetTemperature, error, sampleInterval);
 					}
 					else
 					{
-						const float errorToUse = error;
-						iAccumulator = constrain<float>
-										(iAccumulator + (errorToUse * params.kP * params.recipTi * (HeatSampleIntervalMillis * MillisToSeconds)),
-											0.0, GetModel().GetMaxPwm());
-						lastPwm = constrain<float>(pPlusD + iAccumulator + extrusionBoost, 0.0, GetModel().GetMaxPwm());
+						// Using PID mode. Determine the PID parameters to use.
+						const bool inLoadMode = (mode == HeaterMode::stable) || fabsf(error) < 3.0;		// use standard PID when maintaining temperature
+						const PidParameters& params = GetModel().GetPidParameters(inLoadMode);
+
+						// If the P and D terms together demand that the heater is full on or full off, disregard the I term
+						const float errorMinusDterm = error - (params.tD * derivative);
+						const float pPlusD = params.kP * errorMinusDterm;
+						const float expectedPwm = GetModel().EstimateRequiredPwm(temperature - NormalAmbientTemperature, 0.0);
+						if (pPlusD + expectedPwm > GetModel().GetMaxPwm())
+						{
+							lastPwm = GetModel().GetMaxPwm();
+							// If we are heating up, preset the I term to the expected PWM at this temperature, ready for the switch over to PID
+							if (mode == HeaterMode::heating && error > 0.0 && derivative > 0.0)
+							{
+								iAccumulator = expectedPwm;
+							}
+						}
+						else if (pPlusD + expectedPwm < 0.0)
+						{
+							lastPwm = 0.0;
+						}
+						else
+						{
+							const float errorToUse = error;
+							iAccumulator = constrain<float>
+											(iAccumulator + (errorToUse * params.kP * params.recipTi * (sampleInterval * MillisToSeconds)),
+												0.0, GetModel().GetMaxPwm());
+							lastPwm = constrain<float>(pPlusD + iAccumulator + GetPidExtrusionFeedForward(), 0.0, GetModel().GetMaxPwm());
+						}
 					}
 #if HAS_VOLTAGE_MONITOR
-					// Scale the PID based on the current voltage vs. the calibration voltage
+					// Scale the PWM based on the current voltage vs. the calibration voltage
 					if (!reprap.GetHeat().IsBedOrChamberHeater(GetHeaterNumber()))
 					{
 						lastPwm = GetModel().CorrectPwmForVoltage(lastPwm, reprap.GetPlatform().GetCurrentPowerVoltage());
@@ -479,7 +499,7 @@ void LocalHeater::Spin() noexcept
 
 		// Set the heater power and update the average PWM
 		SetHeater(lastPwm);
-		constexpr float avgFactor = HeatSampleIntervalMillis/(HeatPwmAverageTime * SecondsToMillis);
+		const float avgFactor = min<float>(sampleInterval/(HeatPwmAverageTime * SecondsToMillis), 1.0);
 		averagePWM = (averagePWM * (1.0 - avgFactor)) + (lastPwm * avgFactor);
 
 		// For temperature sensors which do not require frequent sampling and averaging,
@@ -518,7 +538,7 @@ float LocalHeater::GetExpectedHeatingRate() const noexcept
 	return GetModel().GetNetHeatingRate(temperatureRise, 1.0, pwm);
 }
 
-// Auto tune this heater. The caller has already checked that no other heater is being tuned and has set up tuningTargetTemp, tuningPwm, tuningFans, tuningHysteresis and tuningFanPwm.
+// Auto tune this heater. The caller has already allocated the tuning data and set up tuningTargetTemp, tuningPwm, tuningFans, tuningHysteresis and tuningFanPwm in it.
 GCodeResult LocalHeater::StartAutoTune(const StringRef& reply, bool seenA, float ambientTemp) noexcept
 {
 	if (lastPwm > 0.0 || GetAveragePWM() > 0.02)
@@ -527,25 +547,25 @@ GCodeResult LocalHeater::StartAutoTune(const StringRef& reply, bool seenA, float
 		return GCodeResult::error;
 	}
 
-	reprap.GetFansManager().SetFansValue(tuningFans, 0.0);
+	reprap.GetFansManager().SetFansValue(tuning->tuningFans, 0.0);
 
-	tuningStartTemp.Clear();
-	tuningBeginTime = millis();
+	tuning->tuningStartTemp.Clear();
+	tuning->tuningBeginTime = millis();
 	tuned = false;					// assume failure
 
 	if (seenA)
 	{
-		tuningStartTemp.Add(ambientTemp);
-		ClearCounters();
+		tuning->tuningStartTemp.Add(ambientTemp);
+		tuning->ClearCounters();
 		timeSetHeating = millis();
-		lastPwm = tuningPwm;										// turn on heater at specified power
-		tuningPhase = 1;
+		lastPwm = tuning->tuningPwm;										// turn on heater at specified power
+		tuning->tuningPhase = 1;
 		mode = HeaterMode::tuning1;
 		ReportTuningUpdate();
 	}
 	else
 	{
-		tuningPhase = 0;
+		tuning->tuningPhase = 0;
 		mode = HeaterMode::tuning0;
 	}
 
@@ -569,6 +589,44 @@ void LocalHeater::FeedForwardAdjustment(float fanPwmChange, float extrusionChang
 	}
 }
 
+// Calculate the PWM using model predictive control. We use the model to predict the temperature one dead time ahead from the power we have been applying,
+// then choose the PWM that will take the predicted temperature to the target over the control horizon. To this we add the extrusion feedforward for the
+// moves that we expect to be executing one dead time from now, so that the extra power reaches the nozzle when the extra filament does.
+// iAccumulator holds a slowly integrated correction for heat losses that the model doesn't know about, such as the print cooling fan.
+float LocalHeater::GetModelPredictivePwm(float targetTemperature, float error, uint32_t sampleInterval) noexcept
+{
+	const FopDt& model = GetModel();
+	const float deadTime = model.GetDeadTime();
+	const float horizon = max<float>(deadTime, sampleInterval * MillisToSeconds) * MpcHorizonFactor;
+	const float maxPwm = model.GetMaxPwm();
+
+	const float predictedTemperature = temperature + deadTime * model.GetNetHeatingRate(temperature - NormalAmbientTemperature, 0.0, lastPwm - iAccumulator - mpcFeedForward);
+	mpcFeedForward = reprap.GetMove().GetExtrusionFeedForwardAhead(GetHeaterNumber(), deadTime, deadTime + sampleInterval * MillisToSeconds);
+	const float pwm = model.EstimateRequiredPwm(predictedTemperature - NormalAmbientTemperature, 0.0)
+						+ (targetTemperature - predictedTemperature)/(horizon * model.GetHeatingRate())
+						+ iAccumulator + mpcFeedForward;
+
+	// Only integrate the correction when we are close to the target and not saturated, to avoid windup
+	if (fabsf(error) < MpcIntegrationBand && pwm > 0.0 && pwm < maxPwm)
+	{
+		iAccumulator = constrain<float>(iAccumulator + (error * sampleInterval * MillisToSeconds)/(horizon * horizon * MpcIntegralTimeFactor * model.GetHeatingRate()),
+										-maxPwm, maxPwm);
+	}
+	return constrain<float>(pwm, 0.0, maxPwm);
+}
+
+// Get the extrusion feedforward to use in PID mode. If the current tool has a feedforward lead time then we use the average feedforward that the moves in
+// the queue will need over that time, which ramps the power up before the flow increases. Otherwise we use the feedforward for the move that is executing.
+float LocalHeater::GetPidExtrusionFeedForward() const noexcept
+{
+	const Tool * const tool = reprap.GetCurrentTool();
+	if (tool != nullptr && tool->GetFeedForwardLeadTime() != 0 && tool->UsesHeater(GetHeaterNumber()))
+	{
+		return reprap.GetMove().GetExtrusionFeedForwardAhead(GetHeaterNumber(), 0.0, tool->GetFeedForwardLeadTime() * MillisToSeconds);
+	}
+	return extrusionBoost;
+}
+
 // Set extrusion feedforward. This is called from an ISR.
 void LocalHeater::SetExtrusionFeedForward(float pwm) noexcept
 {
@@ -618,30 +676,30 @@ void LocalHeater::DoTuningStep() noexcept
 	switch (mode)
 	{
 	case HeaterMode::tuning0:		// Waiting for initial temperature to settle after any thermostatic fans have turned on
-		if (tuningStartTemp.GetNumSamples() < 5000/HeatSampleIntervalMillis)
+		if (tuning->tuningStartTemp.GetNumSamples() < 5000/GetSampleIntervalMillis())
 		{
-			tuningStartTemp.Add(temperature);							// take another reading until we have samples temperatures for 5 seconds
+			tuning->tuningStartTemp.Add(temperature);							// take another reading until we have samples temperatures for 5 seconds
 			return;
 		}
 
-		if (tuningStartTemp.GetDeviation() <= 2.0)
+		if (tuning->tuningStartTemp.GetDeviation() <= 2.0)
 		{
 			timeSetHeating = now;
-			lastPwm = tuningPwm;										// turn on heater at specified power
+			lastPwm = tuning->tuningPwm;										// turn on heater at specified power
 			mode = HeaterMode::tuning1;
 
-			tuningPhase = 1;
+			tuning->tuningPhase = 1;
 			ReportTuningUpdate();
 			return;
 		}
 
-		if (now - tuningBeginTime < 20000)
+		if (now - tuning->tuningBeginTime < 20000)
 		{
 			// Allow up to 20 seconds for starting temperature to settle
 			return;
 		}
 
-		reprap.GetPlatform().Message(GenericMessage, "Auto tune cancelled because starting temperature is not stable\n");
+		reprap.GetPlatform().MessageF(GenericMessage, "Auto tune of heater %u cancelled because starting temperature is not stable\n", GetHeaterNumber());
 		break;
 
 	case HeaterMode::tuning1:		// Heating up
@@ -653,13 +711,13 @@ void LocalHeater::DoTuningStep() noexcept
 				// Move on to next phase
 				lastPwm = 0.0;
 				SetHeater(0.0);
-				peakTemp = afterPeakTemp = temperature;
-				lastOffTime = peakTime = afterPeakTime = now;
+				tuning->peakTemp = tuning->afterPeakTemp = temperature;
+				tuning->lastOffTime = tuning->peakTime = tuning->afterPeakTime = now;
 				mode = HeaterMode::tuning2;
 			}
 			else
 			{
-				lastPwm = tuningPwm;
+				lastPwm = tuning->tuningPwm;
 			}
 			return;
 		}
@@ -668,31 +726,31 @@ void LocalHeater::DoTuningStep() noexcept
 			const bool isBedOrChamberHeater = reprap.GetHeat().IsBedOrChamberHeater(GetHeaterNumber());
 			const uint32_t heatingTime = now - timeSetHeating;
 			const float extraTimeAllowed = (isBedOrChamberHeater) ? 120.0 : 30.0;
-			if (heatingTime > (uint32_t)((GetModel().GetDeadTime() + extraTimeAllowed) * SecondsToMillis) && (temperature - tuningStartTemp.GetMean()) < 3.0)
+			if (heatingTime > (uint32_t)((GetModel().GetDeadTime() + extraTimeAllowed) * SecondsToMillis) && (temperature - tuning->tuningStartTemp.GetMean()) < 3.0)
 			{
-				reprap.GetPlatform().Message(GenericMessage, "Auto tune cancelled because temperature is not increasing\n");
+				reprap.GetPlatform().MessageF(GenericMessage, "Auto tune of heater %u cancelled because temperature is not increasing\n", GetHeaterNumber());
 				break;
 			}
 
 			const uint32_t timeoutMinutes = (isBedOrChamberHeater) ? 30 : 7;
 			if (heatingTime >= timeoutMinutes * 60 * (uint32_t)SecondsToMillis)
 			{
-				reprap.GetPlatform().Message(GenericMessage, "Auto tune cancelled because target temperature was not reached\n");
+				reprap.GetPlatform().MessageF(GenericMessage, "Auto tune of heater %u cancelled because target temperature was not reached\n", GetHeaterNumber());
 				break;
 			}
 		}
 
-		if (temperature >= tuningTargetTemp)							// if reached target
+		if (temperature >= tuning->tuningTargetTemp)							// if reached target
 		{
 			// Move on to next phase
 			lastPwm = 0.0;
 			SetHeater(0.0);
-			peakTemp = afterPeakTemp = temperature;
-			lastOffTime = peakTime = afterPeakTime = now;
-			tuningVoltage.Clear();
-			idleCyclesDone = 0;
+			tuning->peakTemp = tuning->afterPeakTemp = temperature;
+			tuning->lastOffTime = tuning->peakTime = tuning->afterPeakTime = now;
+			tuning->tuningVoltage.Clear();
+			tuning->idleCyclesDone = 0;
 			mode = HeaterMode::tuning2;
-			tuningPhase = 2;
+			tuning->tuningPhase = 2;
 			ReportTuningUpdate();
 		}
 		return;
@@ -701,10 +759,10 @@ void LocalHeater::DoTuningStep() noexcept
 #if SUPPORT_REMOTE_COMMANDS
 		if (CanInterface::InExpansionMode())
 		{
-			if (temperature >= peakTemp)
+			if (temperature >= tuning->peakTemp)
 			{
-				peakTemp = afterPeakTemp = temperature;
-				peakTime = afterPeakTime = now;
+				tuning->peakTemp = tuning->afterPeakTemp = temperature;
+				tuning->peakTime = tuning->afterPeakTime = now;
 			}
 			else if (temperature < ExpansionMode::tuningLowTemp)
 			{
@@ -713,116 +771,116 @@ void LocalHeater::DoTuningStep() noexcept
 				// If we have been collecting data, see if we have enough, and either turn the heater on to start another cycle or finish tuning.
 
 				// Save the data (don't know whether we need it yet)
-				ExpansionMode::dHigh = peakTime - lastOffTime;
-				ExpansionMode::tOff = now - lastOffTime;
-				ExpansionMode::coolingRate = (afterPeakTemp - temperature) * SecondsToMillis/(now - afterPeakTime);
-				lastOnTime = peakTime = afterPeakTime = now;
-				peakTemp = afterPeakTemp = temperature;
-				lastPwm = tuningPwm;						// turn on heater at specified power
+				ExpansionMode::dHigh = tuning->peakTime - tuning->lastOffTime;
+				ExpansionMode::tOff = now - tuning->lastOffTime;
+				ExpansionMode::coolingRate = (tuning->afterPeakTemp - temperature) * SecondsToMillis/(now - tuning->afterPeakTime);
+				tuning->lastOnTime = tuning->peakTime = tuning->afterPeakTime = now;
+				tuning->peakTemp = tuning->afterPeakTemp = temperature;
+				lastPwm = tuning->tuningPwm;						// turn on heater at specified power
 				mode = HeaterMode::tuning3;
 			}
-			else if (afterPeakTime == peakTime && ExpansionMode::tuningHighTemp - temperature >= ExpansionMode::tuningPeakTempDrop)
+			else if (tuning->afterPeakTime == tuning->peakTime && ExpansionMode::tuningHighTemp - temperature >= ExpansionMode::tuningPeakTempDrop)
 			{
-				afterPeakTime = now;
-				afterPeakTemp = temperature;
+				tuning->afterPeakTime = now;
+				tuning->afterPeakTemp = temperature;
 			}
 			return;
 		}
 #endif
-		if (temperature >= peakTemp)
+		if (temperature >= tuning->peakTemp)
 		{
-			peakTemp = afterPeakTemp = temperature;
-			peakTime = afterPeakTime = now;
+			tuning->peakTemp = tuning->afterPeakTemp = temperature;
+			tuning->peakTime = tuning->afterPeakTime = now;
 		}
-		else if (temperature < tuningTargetTemp - tuningHysteresis)
+		else if (temperature < tuning->tuningTargetTemp - tuning->tuningHysteresis)
 		{
 			// Temperature has dropped below the low limit.
 			// If we have been doing idle cycles, see whether we can switch to collecting data, and turn the heater on.
 			// If we have been collecting data, see if we have enough, and either turn the heater on to start another cycle or finish tuning.
 
 			// Save the data (don't know whether we need it yet)
-			dHigh.Add((float)(peakTime - lastOffTime));
-			tOff.Add((float)(now - lastOffTime));
-			const float currentCoolingRate = (afterPeakTemp - temperature) * SecondsToMillis/(now - afterPeakTime);
-			coolingRate.Add(currentCoolingRate);
+			tuning->dHigh.Add((float)(tuning->peakTime - tuning->lastOffTime));
+			tuning->tOff.Add((float)(now - tuning->lastOffTime));
+			const float currentCoolingRate = (tuning->afterPeakTemp - temperature) * SecondsToMillis/(now - tuning->afterPeakTime);
+			tuning->coolingRate.Add(currentCoolingRate);
 
 			// Decide whether to finish this phase
-			if (tuningPhase == 2)				// if we are doing idle cycles
+			if (tuning->tuningPhase == 2)				// if we are doing idle cycles
 			{
 				// To allow for heat reservoirs, we do idle cycles until the cooling rate decreases by no more than a certain amount in a single cycle
-				if (idleCyclesDone == TuningHeaterMaxIdleCycles || (idleCyclesDone >= TuningHeaterMinIdleCycles && currentCoolingRate >= lastCoolingRate * HeaterSettledCoolingTimeRatio))
+				if (tuning->idleCyclesDone == TuningHeaterMaxIdleCycles || (tuning->idleCyclesDone >= TuningHeaterMinIdleCycles && currentCoolingRate >= tuning->lastCoolingRate * HeaterSettledCoolingTimeRatio))
 				{
-					tuningPhase = 3;
+					tuning->tuningPhase = 3;
 					ReportTuningUpdate();
 				}
 				else
 				{
-					lastCoolingRate = currentCoolingRate;
-					ClearCounters();
-					++idleCyclesDone;
+					tuning->lastCoolingRate = currentCoolingRate;
+					tuning->ClearCounters();
+					++tuning->idleCyclesDone;
 				}
 			}
-			else if (coolingRate.GetNumSamples() >= MinTuningHeaterCycles)
+			else if (tuning->coolingRate.GetNumSamples() >= MinTuningHeaterCycles)
 			{
-				const bool isConsistent = dLow.DeviationFractionWithin(0.2)
-										&& dHigh.DeviationFractionWithin(0.2)
-										&& heatingRate.DeviationFractionWithin(0.1)
-										&& coolingRate.DeviationFractionWithin(0.1);
-				if (isConsistent || coolingRate.GetNumSamples() == MaxTuningHeaterCycles)
+				const bool isConsistent = tuning->dLow.DeviationFractionWithin(0.2)
+										&& tuning->dHigh.DeviationFractionWithin(0.2)
+										&& tuning->heatingRate.DeviationFractionWithin(0.1)
+										&& tuning->coolingRate.DeviationFractionWithin(0.1);
+				if (isConsistent || tuning->coolingRate.GetNumSamples() == MaxTuningHeaterCycles)
 				{
 					if (!isConsistent)
 					{
-						reprap.GetPlatform().Message(WarningMessage, "heater behaviour was not consistent during tuning\n");
+						reprap.GetPlatform().MessageF(WarningMessage, "heater %u behaviour was not consistent during tuning\n", GetHeaterNumber());
 					}
 
-					if (tuningPhase == 3)
+					if (tuning->tuningPhase == 3)
 					{
-						CalculateModel(fanOffParams);
-						if (tuningFans.IsEmpty())
+						CalculateModel(tuning->fanOffParams);
+						if (tuning->tuningFans.IsEmpty())
 						{
 							SetAndReportModelAfterTuning(false);
 							break;
 						}
 						else
 						{
-							tuningPhase = 4;
-							ClearCounters();
+							tuning->tuningPhase = 4;
+							tuning->ClearCounters();
 #if TUNE_WITH_HALF_FAN
-							reprap.GetFansManager().SetFansValue(tuningFans, tuningFanPwm * 0.5);	// turn fans on at half PWM
+							reprap.GetFansManager().SetFansValue(tuning->tuningFans, tuning->tuningFanPwm * 0.5);	// turn fans on at half PWM
 #else
-							reprap.GetFansManager().SetFansValue(tuningFans, tuningFanPwm);		// turn fans on at full PWM
+							reprap.GetFansManager().SetFansValue(tuning->tuningFans, tuning->tuningFanPwm);		// turn fans on at full PWM
 #endif
 							ReportTuningUpdate();
 						}
 					}
 #if TUNE_WITH_HALF_FAN
-					else if (tuningPhase == 4)
+					else if (tuning->tuningPhase == 4)
 					{
-						CalculateModel(fanOnParams);
-						tuningPhase = 5;
-						ClearCounters();
-						reprap.GetFansManager().SetFansValue(tuningFans, tuningFanPwm);			// turn fans fully on
+						CalculateModel(tuning->fanOnParams);
+						tuning->tuningPhase = 5;
+						tuning->ClearCounters();
+						reprap.GetFansManager().SetFansValue(tuning->tuningFans, tuning->tuningFanPwm);			// turn fans fully on
 						ReportTuningUpdate();
 					}
 #endif
 					else
 					{
-						reprap.GetFansManager().SetFansValue(tuningFans, 0.0);					// turn fans off
-						CalculateModel(fanOnParams);
+						reprap.GetFansManager().SetFansValue(tuning->tuningFans, 0.0);					// turn fans off
+						CalculateModel(tuning->fanOnParams);
 						SetAndReportModelAfterTuning(true);
 						break;
 					}
 				}
 			}
-			lastOnTime = peakTime = afterPeakTime = now;
-			peakTemp = afterPeakTemp = temperature;
-			lastPwm = tuningPwm;						// turn on heater at specified power
+			tuning->lastOnTime = tuning->peakTime = tuning->afterPeakTime = now;
+			tuning->peakTemp = tuning->afterPeakTemp = temperature;
+			lastPwm = tuning->tuningPwm;						// turn on heater at specified power
 			mode = HeaterMode::tuning3;
 		}
-		else if (afterPeakTime == peakTime && tuningTargetTemp - temperature >= TuningPeakTempDrop)
+		else if (tuning->afterPeakTime == tuning->peakTime && tuning->tuningTargetTemp - temperature >= TuningPeakTempDrop)
 		{
-			afterPeakTime = now;
-			afterPeakTemp = temperature;
+			tuning->afterPeakTime = now;
+			tuning->afterPeakTemp = temperature;
 		}
 		return;
 
@@ -830,10 +888,10 @@ void LocalHeater::DoTuningStep() noexcept
 #if SUPPORT_REMOTE_COMMANDS
 		if (CanInterface::InExpansionMode())
 		{
-			if (temperature <= peakTemp)
+			if (temperature <= tuning->peakTemp)
 			{
-				peakTemp = afterPeakTemp = temperature;
-				peakTime = afterPeakTime = now;
+				tuning->peakTemp = tuning->afterPeakTemp = temperature;
+				tuning->peakTime = tuning->afterPeakTime = now;
 			}
 			else if (temperature >= ExpansionMode::tuningHighTemp)
 			{
@@ -841,49 +899,49 @@ void LocalHeater::DoTuningStep() noexcept
 # if HAS_VOLTAGE_MONITOR
 				ExpansionMode::tuningVoltage = reprap.GetPlatform().GetCurrentPowerVoltage();	// save this while the heater is on
 # else
-				tuningVoltage = 0.0;
+				ExpansionMode::tuningVoltage = 0.0;
 # endif
-				ExpansionMode::dLow = peakTime - lastOnTime;
-				ExpansionMode::tOn = now - lastOnTime;
-				ExpansionMode::heatingRate = (temperature - afterPeakTemp) * SecondsToMillis/(now - afterPeakTime);
-				lastOffTime = peakTime = afterPeakTime = now;
-				peakTemp = afterPeakTemp = temperature;
+				ExpansionMode::dLow = tuning->peakTime - tuning->lastOnTime;
+				ExpansionMode::tOn = now - tuning->lastOnTime;
+				ExpansionMode::heatingRate = (temperature - tuning->afterPeakTemp) * SecondsToMillis/(now - tuning->afterPeakTime);
+				tuning->lastOffTime = tuning->peakTime = tuning->afterPeakTime = now;
+				tuning->peakTemp = tuning->afterPeakTemp = temperature;
 				lastPwm = 0.0;										// turn heater off
 				mode = HeaterMode::tuning2;
 				++ExpansionMode::cyclesDone;
 				ExpansionMode::tuningCycleComplete = true;
 			}
-			else if (afterPeakTime == peakTime && temperature - ExpansionMode::tuningLowTemp >= ExpansionMode::tuningPeakTempDrop)
+			else if (tuning->afterPeakTime == tuning->peakTime && temperature - ExpansionMode::tuningLowTemp >= ExpansionMode::tuningPeakTempDrop)
 			{
-				afterPeakTime = now;
-				afterPeakTemp = temperature;
+				tuning->afterPeakTime = now;
+				tuning->afterPeakTemp = temperature;
 			}
 			return;
 		}
 #endif
 #if HAS_VOLTAGE_MONITOR
-		tuningVoltage.Add(reprap.GetPlatform().GetCurrentPowerVoltage());
+		tuning->tuningVoltage.Add(reprap.GetPlatform().GetCurrentPowerVoltage());
 #endif
-		if (temperature <= peakTemp)
+		if (temperature <= tuning->peakTemp)
 		{
-			peakTemp = afterPeakTemp = temperature;
-			peakTime = afterPeakTime = now;
+			tuning->peakTemp = tuning->afterPeakTemp = temperature;
+			tuning->peakTime = tuning->afterPeakTime = now;
 		}
-		else if (temperature >= tuningTargetTemp)
+		else if (temperature >= tuning->tuningTargetTemp)
 		{
 			// We have reached the target temperature, so record a data point and turn the heater off
-			dLow.Add((float)(peakTime - lastOnTime));
-			tOn.Add((float)(now - lastOnTime));
-			heatingRate.Add((temperature - afterPeakTemp) * SecondsToMillis/(now - afterPeakTime));
-			lastOffTime = peakTime = afterPeakTime = now;
-			peakTemp = afterPeakTemp = temperature;
+			tuning->dLow.Add((float)(tuning->peakTime - tuning->lastOnTime));
+			tuning->tOn.Add((float)(now - tuning->lastOnTime));
+			tuning->heatingRate.Add((temperature - tuning->afterPeakTemp) * SecondsToMillis/(now - tuning->afterPeakTime));
+			tuning->lastOffTime = tuning->peakTime = tuning->afterPeakTime = now;
+			tuning->peakTemp = tuning->afterPeakTemp = temperature;
 			lastPwm = 0.0;								// turn heater off
 			mode = HeaterMode::tuning2;
 		}
-		else if (afterPeakTime == peakTime && temperature - tuningTargetTemp >= TuningPeakTempDrop - tuningHysteresis)
+		else if (tuning->afterPeakTime == tuning->peakTime && temperature - tuning->tuningTargetTemp >= TuningPeakTempDrop - tuning->tuningHysteresis)
 		{
-			afterPeakTime = now;
-			afterPeakTemp = temperature;
+			tuning->afterPeakTime = now;
+			tuning->afterPeakTemp = temperature;
 		}
 		return;
 
@@ -955,10 +1013,16 @@ GCodeResult LocalHeater::TuningCommand(const CanMessageHeaterTuningCommand& msg,
 			return GCodeResult::error;
 		}
 
+		if (!AllocateTuningData())
+		{
+			reply.copy("Insufficient memory to auto tune heater");
+			return GCodeResult::error;
+		}
+
 		// We could do some more checks here but the main board should have done all the checks needed already
 		ExpansionMode::tuningHighTemp = msg.highTemp;
 		ExpansionMode::tuningLowTemp = msg.lowTemp;
-		tuningPwm = msg.pwm;
+		tuning->tuningPwm = msg.pwm;
 		ExpansionMode::tuningPeakTempDrop = msg.peakTempDrop;
 		timeSetHeating = millis();
 		ExpansionMode::tuningCycleComplete = false;
@@ -22,6 +22,9 @@ class HeaterMonitor;
 class LocalHeater : public Heater
 {
 	static const size_t NumPreviousTemperatures = 4;		// How many samples we average the temperature derivative over
+	static constexpr float MpcHorizonFactor = 2.0;			// The model predictive control horizon as a multiple of the dead time
+	static constexpr float MpcIntegralTimeFactor = 5.0;		// The integral time of the model correction as a multiple of the control horizon
+	static constexpr float MpcIntegrationBand = 3.0;		// We only update the model correction when we are this close to the target temperature
 
 public:
 	LocalHeater(unsigned int heaterNum) noexcept;
@@ -59,12 +62,15 @@ protected:
 	GCodeResult UpdateModel(const StringRef& reply) noexcept override;		// Called when the heater model has been changed
 	GCodeResult UpdateFaultDetectionParameters(const StringRef& reply) noexcept override { return GCodeResult::ok; }
 	GCodeResult UpdateHeaterMonitors(const StringRef& reply) noexcept override { return GCodeResult::ok; }
+	GCodeResult UpdateSampleInterval(const StringRef& reply) noexcept override;
 	GCodeResult StartAutoTune(const StringRef& reply, bool seenA, float ambientTemp) noexcept override;
 																			// Start an auto tune cycle for this heater
 private:
 	void SetHeater(float power) const noexcept;				// Power is a fraction in [0,1]
 	TemperatureError ReadTemperature() noexcept;			// Read and store the temperature of this heater
 	void DoTuningStep() noexcept;							// Called on each temperature sample when auto tuning
+	float GetModelPredictivePwm(float targetTemperature, float error, uint32_t sampleInterval) noexcept;
+	float GetPidExtrusionFeedForward() const noexcept;
 	float GetExpectedHeatingRate() const noexcept;			// Get the minimum heating rate we expect
 	void RaiseHeaterFault(HeaterFaultType type, const char *_ecv_array format, ...) noexcept;
 
@@ -76,6 +82,7 @@ private:
 	float lastPwm;											// The last PWM value set for this heater
 	float averagePWM;										// The running average of the PWM, after scaling.
 	volatile float extrusionBoost;							// The amount of extrusion feedforward to apply
+	float mpcFeedForward;									// The anticipated extrusion feedforward included in lastPwm when using model predictive control
 	float lastTemperatureValue;								// the last temperature we recorded while heating up
 	uint32_t lastTemperatureMillis;							// when we recorded the last temperature
 	uint32_t timeSetHeating;								// When we turned on the heater
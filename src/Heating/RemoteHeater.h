@@ -46,6 +46,7 @@ protected:
 	GCodeResult UpdateModel(const StringRef& reply) noexcept override;		// Called when the heater model has been changed
 	GCodeResult UpdateFaultDetectionParameters(const StringRef& reply) noexcept override;
 	GCodeResult UpdateHeaterMonitors(const StringRef& reply) noexcept override;
+	GCodeResult UpdateSampleInterval(const StringRef& reply) noexcept override;
 	GCodeResult StartAutoTune(const StringRef& reply, bool seenA, float ambientTemp) noexcept override;
 																			// Start an auto tune cycle for this heater
 private:
@@ -71,10 +72,10 @@ private:
 	uint32_t whenLastStatusReceived;
 
 	// Variables used only during tuning
-	static uint32_t timeSetHeating;											// When we turned on the heater at the start of auto tuning
-	static float currentCoolingRate;
-	static unsigned int tuningCyclesDone;
-	static bool newTuningResult;
+	uint32_t timeSetHeating;												// When we turned on the heater at the start of auto tuning
+	float currentCoolingRate;
+	unsigned int tuningCyclesDone;
+	bool newTuningResult;
 };
 
 #endif
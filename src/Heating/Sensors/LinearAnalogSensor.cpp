@@ -69,24 +69,42 @@ GCodeResult LinearAnalogSensor::Configure(GCodeBuffer& gb, const StringRef& repl
 }
 
 void LinearAnalogSensor::Poll() noexcept
+{
+	float t;
+	const TemperatureError err = TakeReading(t);
+	if (err == TemperatureError::success)
+	{
+		SetResult(t, err);
+	}
+	else
+	{
+		SetResult(err);
+	}
+}
+
+// The ADC results and the averaging filters are updated continuously, so we can convert the latest values at any time without waiting for the next poll
+TemperatureError LinearAnalogSensor::GetInstantReading(float& t) noexcept
+{
+	return TakeReading(t);
+}
+
+TemperatureError LinearAnalogSensor::TakeReading(float& t) const noexcept
 {
 	if (filtered && adcFilterChannel >= 0)
 	{
 		const volatile ThermistorAveragingFilter& tempFilter = reprap.GetPlatform().GetAdcFilter(adcFilterChannel);
-		if (tempFilter.IsValid())
-		{
-			const int32_t averagedTempReading = tempFilter.GetSum()/(ThermistorAverageReadings >> AdcOversampleBits);
-			SetResult((averagedTempReading * linearIncreasePerCount) + lowTemp, TemperatureError::success);
-		}
-		else
+		if (!tempFilter.IsValid())
 		{
-			SetResult(TemperatureError::notReady);
+			return TemperatureError::notReady;
 		}
+		const int32_t averagedTempReading = tempFilter.GetSum()/(tempFilter.NumAveraged() >> AdcOversampleBits);
+		t = (averagedTempReading * linearIncreasePerCount) + lowTemp;
 	}
 	else
 	{
-		SetResult((port.ReadAnalog() * linearIncreasePerCount) + lowTemp, TemperatureError::success);
+		t = (port.ReadAnalog() * linearIncreasePerCount) + lowTemp;
 	}
+	return TemperatureError::success;
 }
 
 void LinearAnalogSensor::CalcDerivedParameters() noexcept
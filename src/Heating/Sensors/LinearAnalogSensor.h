@@ -17,12 +17,14 @@ public:
 
 	GCodeResult Configure(GCodeBuffer& gb, const StringRef& reply, bool& changed) override THROWS(GCodeException);
 	void Poll() noexcept override;
+	TemperatureError GetInstantReading(float& t) noexcept override;
 	const char *GetShortSensorType() const noexcept override { return TypeName; }
 
 	static constexpr const char *TypeName = "linearanalog";
 
 private:
 	void CalcDerivedParameters() noexcept;
+	TemperatureError TakeReading(float& t) const noexcept;
 
 	// Configurable parameters
 	float lowTemp, highTemp;
@@ -16,6 +16,9 @@
 
 class SpiTemperatureSensor : public SensorWithPort
 {
+public:
+	bool UsesSharedSpi() const noexcept override { return true; }
+
 protected:
 	SpiTemperatureSensor(unsigned int sensorNum, const char *name, SpiMode spiMode, uint32_t clockFrequency) noexcept;
 
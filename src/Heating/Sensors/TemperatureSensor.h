@@ -22,6 +22,9 @@ public:
 	// Try to get a temperature reading
 	virtual TemperatureError GetLatestTemperature(float& t, uint8_t outputNumber = 0) noexcept;
 
+	// Take a reading now instead of returning the one from the last poll, for callers that sample faster than the sensors are polled. Sensors that can't do that return the latest reading.
+	virtual TemperatureError GetInstantReading(float& t) noexcept { return GetLatestTemperature(t); }
+
 	// How many additional outputs does this sensor have
 	virtual const uint8_t GetNumAdditionalOutputs() const noexcept { return 0; }
 
@@ -74,6 +77,9 @@ public:
 	// Get the smart drivers channel that this sensor monitors, or -1 if it doesn't
 	virtual int GetSmartDriversChannel() const noexcept { return -1; }
 
+	// Return true if this sensor is read using the shared SPI bus. Overridden in class SpiTemperatureSensor.
+	virtual bool UsesSharedSpi() const noexcept { return false; }
+
 #if SUPPORT_CAN_EXPANSION
 	// Get the expansion board address. Overridden for remote sensors.
 	virtual CanAddress GetBoardAddress() const noexcept;
@@ -31,6 +31,7 @@ using
 
 // For the theory behind ADC oversampling, see http://www.atmel.com/Images/doc8003.pdf
 static constexpr unsigned int AdcOversampleBits = 2;							// we use 2-bit oversampling
+static constexpr unsigned int MinThermistorAverageReadings = 1u << (2 * AdcOversampleBits);	// we need at least 4^AdcOversampleBits readings to get the extra bits
 static constexpr int32_t OversampledAdcRange = 1u << (AdcBits + AdcOversampleBits);	// The readings we pass in should be in range 0..(AdcRange - 1)
 
 // The Steinhart-Hart equation for thermistor resistance is:
@@ -41,15 +42,24 @@ static constexpr int32_t OversampledAdcRange = 1u << (AdcBits + AdcOversampleBit
 //
 // The parameters that can be configured in RRF are R25 (the resistance at 25C), Beta, and optionally C.
 
+// Each lookup table segment spans at least 32 oversampled ADC counts. With a 12-bit ADC this gives 512 segments, for which the interpolation error
+// of a typical 100K thermistor with a 4.7K series resistor is less than 0.3C up to 320C.
+constexpr size_t Thermistor::LookupTableSegments = min<size_t>(512, OversampledAdcRange/32);
+
 // Create an instance with default values
 Thermistor::Thermistor(unsigned int sensorNum, bool p_isPT1000) noexcept
-	: SensorWithPort(sensorNum, (p_isPT1000) ? "PT1000" : "Thermistor"),
+	: SensorWithPort(sensorNum, (p_isPT1000) ? "PT1000" : "Thermistor"), lookupTable(nullptr),
 	  r25(DefaultThermistorR25), beta(DefaultThermistorBeta), shC(DefaultThermistorC), seriesR(DefaultThermistorSeriesR), adcFilterChannel(-1),
-	  isPT1000(p_isPT1000), adcLowOffset(0), adcHighOffset(0)
+	  adcReadingsAveraged(ThermistorAverageReadings), isPT1000(p_isPT1000), adcLowOffset(0), adcHighOffset(0)
 {
 	CalcDerivedParameters();
 }
 
+Thermistor::~Thermistor() noexcept
+{
+	delete[] lookupTable;
+}
+
 // Get the ADC reading
 int32_t Thermistor::GetRawReading(bool& valid) const noexcept
 {
@@ -87,7 +97,7 @@ bool Thermistor::ConfigureHParam(int hVal, const StringRef& reply) noexcept
 			}
 # endif
 			const int32_t computedCorrection =
-							(val - (int32_t)(vrefReading/(ThermistorAveragingFilter::NumAveraged() >> AdcOversampleBits)))
+							(val - (int32_t)(vrefReading/(reprap.GetPlatform().GetAdcFilter(VrefFilterIndex).NumAveraged() >> AdcOversampleBits)))
 								/(1 << (AdcBits + AdcOversampleBits - 13));
 			if (computedCorrection >= -127 && computedCorrection <= 127)
 			{
@@ -96,12 +106,10 @@ bool Thermistor::ConfigureHParam(int hVal, const StringRef& reply) noexcept
 				port.AppendPinName(reply);
 				reply.catf("\" is %d", adcHighOffset);
 
-				// Store the value in NVM
+				// Store the value in NVM. Platform::Spin writes it later.
 				if (!reprap.GetGCodes().IsRunningConfigFile())
 				{
-					NonVolatileMemory mem;
-					mem.SetThermistorHighCalibration(adcFilterChannel, adcHighOffset);
-					mem.EnsureWritten();
+					NonVolatileMemory::ScheduleThermistorHighCalibration(adcFilterChannel, adcHighOffset);
 				}
 			}
 			else
@@ -138,7 +146,7 @@ bool Thermistor::ConfigureLParam(int lVal, const StringRef& reply) noexcept
 		if (valid)
 		{
 			const int32_t computedCorrection =
-							(val - (int32_t)(reprap.GetPlatform().GetAdcFilter(VssaFilterIndex).GetSum()/(ThermistorAveragingFilter::NumAveraged() >> AdcOversampleBits)))
+							(val - (int32_t)(reprap.GetPlatform().GetAdcFilter(VssaFilterIndex).GetSum()/(reprap.GetPlatform().GetAdcFilter(VssaFilterIndex).NumAveraged() >> AdcOversampleBits)))
 								/(1 << (AdcBits + AdcOversampleBits - 13));
 			if (computedCorrection >= -127 && computedCorrection <= 127)
 			{
@@ -147,12 +155,10 @@ bool Thermistor::ConfigureLParam(int lVal, const StringRef& reply) noexcept
 				port.AppendPinName(reply);
 				reply.catf("\" is %d", adcLowOffset);
 
-				// Store the value in NVM
+				// Store the value in NVM. Platform::Spin writes it later.
 				if (!reprap.GetGCodes().IsRunningConfigFile())
 				{
-					NonVolatileMemory mem;
-					mem.SetThermistorLowCalibration(adcFilterChannel, adcLowOffset);
-					mem.EnsureWritten();
+					NonVolatileMemory::ScheduleThermistorLowCalibration(adcFilterChannel, adcLowOffset);
 				}
 			}
 			else
@@ -186,6 +192,7 @@ void Thermistor::InitPort() noexcept
 	adcFilterChannel = p.GetAveragingFilterIndex(port);
 	if (adcFilterChannel >= 0)
 	{
+		p.GetAdcFilter(adcFilterChannel).SetNumAveraged(adcReadingsAveraged);
 		p.GetAdcFilter(adcFilterChannel).Init((1u << AdcBits) - 1);
 #ifdef DUET_NG
 		seriesR = p.GetDefaultThermistorSeriesR(adcFilterChannel);
@@ -248,6 +255,46 @@ GCodeResult Thermistor::Configure(GCodeBuffer& gb, const StringRef& reply, bool&
 		changed = true;
 	}
 
+	if (gb.Seen('O'))
+	{
+		// Set the number of ADC readings averaged. More readings give a less noisy result with a slower response.
+		const uint32_t numAveraged = gb.GetUIValue();
+		if (numAveraged < MinThermistorAverageReadings || numAveraged > MaxThermistorAverageReadings || (numAveraged & (numAveraged - 1)) != 0)
+		{
+			reply.printf("Number of readings to average must be a power of 2 between %u and %u", MinThermistorAverageReadings, MaxThermistorAverageReadings);
+			return GCodeResult::error;
+		}
+		if (adcFilterChannel < 0)
+		{
+			reply.copy("This input is not filtered, so the number of readings averaged can't be set");
+			return GCodeResult::error;
+		}
+		adcReadingsAveraged = (uint8_t)numAveraged;
+		reprap.GetPlatform().GetAdcFilter(adcFilterChannel).SetNumAveraged(numAveraged);
+		changed = true;
+	}
+
+	if (gb.Seen('U'))
+	{
+		// Enable or disable the lookup table. This is only useful for thermistors, because for PT1000 sensors we already use a table.
+		if (isPT1000)
+		{
+			reply.copy("Lookup tables are only supported for thermistors");
+			return GCodeResult::error;
+		}
+		if (gb.GetUIValue() != 0)
+		{
+			BuildLookupTable();
+		}
+		else
+		{
+			int16_t *_ecv_array const oldTable = lookupTable;
+			lookupTable = nullptr;
+			delete[] oldTable;
+		}
+		changed = true;
+	}
+
 	TryConfigureSensorName(gb, changed);
 
 	if (!changed)
@@ -260,9 +307,13 @@ GCodeResult Thermistor::Configure(GCodeBuffer& gb, const StringRef& reply, bool&
 		}
 		else
 		{
-			reply.catf(", T:%.1f B:%.1f C:%.2e R:%.1f", (double)r25, (double)beta, (double)shC, (double)seriesR);
+			reply.catf(", T:%.1f B:%.1f C:%.2e R:%.1f U:%u", (double)r25, (double)beta, (double)shC, (double)seriesR, (lookupTable != nullptr) ? 1u : 0u);
 		}
 		reply.catf(" L:%d H:%d", adcLowOffset, adcHighOffset);
+		if (adcFilterChannel >= 0)
+		{
+			reply.catf(" O:%u", adcReadingsAveraged);
+		}
 
 		if (reprap.Debug(moduleHeat) && adcFilterChannel >= 0)
 		{
@@ -409,6 +460,26 @@ void Thermistor::Poll() noexcept
 			{
 				SetResult(BadErrorTemperature, TemperatureError::shortCircuit);
 			}
+			else if (lookupTable != nullptr)
+			{
+				// It's a thermistor and we have a lookup table, so interpolate between the entries either side of the ratio of the reading to the ADC range
+				const int32_t reading = averagedTempReading - averagedVssaReading;
+				const int32_t range = averagedVrefReading - averagedVssaReading;
+				const float pos = (float)reading * (float)LookupTableSegments/(float)range;
+				const size_t index = min<size_t>((size_t)pos, LookupTableSegments - 1);
+				const int32_t low = lookupTable[index];
+				const float temp = ((float)low + (float)(lookupTable[index + 1] - low) * (pos - (float)index)) * (1.0/LookupTableScale);
+
+				// Same open circuit check as below. The resistance is more than 100 * seriesR when reading/(range - reading) > 100.
+				if (temp < MinimumConnectedTemperature && reading * 101 > range * 100)
+				{
+					SetResult(ABS_ZERO, TemperatureError::openCircuit);
+				}
+				else
+				{
+					SetResult(temp, TemperatureError::success);
+				}
+			}
 			else
 			{
 				float resistance = seriesR * (float)(averagedTempReading - averagedVssaReading)/(float)(averagedVrefReading - averagedTempReading);
@@ -427,9 +498,7 @@ void Thermistor::Poll() noexcept
 				else
 				{
 					// Else it's a thermistor
-					const float logResistance = logf(resistance);
-					const float recipT = shA + shB * logResistance + shC * logResistance * logResistance * logResistance;
-					const float temp =  (recipT > 0.0) ? (1.0/recipT) + ABS_ZERO : BadErrorTemperature;
+					const float temp = CalcThermistorTemperature(resistance);
 
 					// It's hard to distinguish between an open circuit and a cold high-resistance thermistor.
 					// So we treat a temperature below -5C as an open circuit, unless we are using a low-resistance thermistor. The E3D thermistor has a resistance of about 470k @ -5C.
@@ -453,12 +522,45 @@ void Thermistor::Poll() noexcept
 	}
 }
 
-// Calculate shA and shB from the other parameters
+// Calculate shA and shB from the other parameters, and rebuild the lookup table if we are using one
 void Thermistor::CalcDerivedParameters() noexcept
 {
 	shB = 1.0/beta;
 	const float lnR25 = logf(r25);
 	shA = 1.0/(25.0 - ABS_ZERO) - shB * lnR25 - shC * lnR25 * lnR25 * lnR25;
+	if (lookupTable != nullptr)
+	{
+		BuildLookupTable();
+	}
+}
+
+// Calculate the temperature of the thermistor from its resistance using the Steinhart-Hart equation
+float Thermistor::CalcThermistorTemperature(float resistance) const noexcept
+{
+	const float logResistance = logf(resistance);
+	const float recipT = shA + shB * logResistance + shC * logResistance * logResistance * logResistance;
+	return (recipT > 0.0) ? (1.0/recipT) + ABS_ZERO : BadErrorTemperature;
+}
+
+// Fill in the lookup table, allocating it if necessary. Entry i holds the temperature when the reading is i/LookupTableSegments of the ADC range.
+void Thermistor::BuildLookupTable() noexcept
+{
+	if (lookupTable == nullptr)
+	{
+		lookupTable = new int16_t[LookupTableSegments + 1];
+	}
+
+	for (size_t i = 0; i <= LookupTableSegments; ++i)
+	{
+		// The end points correspond to zero and infinite resistance, so move them in slightly. Those readings are reported as short or open circuit anyway.
+		const float ratio = constrain<float>((float)i/(float)LookupTableSegments, 0.0001, 0.9999);
+		float resistance = seriesR * ratio/(1.0 - ratio);
+#ifdef DUET_NG
+		resistance = max<float>(resistance - 1.0, 1.0);		// allow for the VSSA fuse in the same way as when we calculate the temperature directly
+#endif
+		const float temp = constrain<float>(CalcThermistorTemperature(resistance), ABS_ZERO, MaxLookupTableTemperature);
+		lookupTable[i] = (int16_t)lrintf(temp * LookupTableScale);
+	}
 }
 
 // End
@@ -22,6 +22,7 @@ class Thermistor : public SensorWithPort
 {
 public:
 	Thermistor(unsigned int sensorNum, bool p_isPT1000) noexcept;					// create an instance with default values
+	~Thermistor() noexcept;
 
 	GCodeResult Configure(GCodeBuffer& gb, const StringRef& reply, bool& changed) override THROWS(GCodeException); // configure the sensor from M308 parameters
 
@@ -36,7 +37,13 @@ public:
 	static constexpr const char *TypeNamePT1000 = "pt1000";
 
 private:
+	static const size_t LookupTableSegments;										// how many intervals the lookup table divides the ADC range into
+	static constexpr float LookupTableScale = 16.0;									// lookup table entries are in units of 1/LookupTableScale C
+	static constexpr float MaxLookupTableTemperature = 2000.0;						// must be small enough for the table entries not to overflow
+
 	void CalcDerivedParameters() noexcept;											// calculate shA and shB
+	float CalcThermistorTemperature(float resistance) const noexcept;				// calculate the temperature from the resistance
+	void BuildLookupTable() noexcept;
 	int32_t GetRawReading(bool& valid) const noexcept;								// get the ADC reading
 	bool ConfigureHParam(int hVal, const StringRef& reply) noexcept;				// configure the H parameter returning true if successful, false if error
 	bool ConfigureLParam(int lVal, const StringRef& reply) noexcept;				// configure the L parameter returning true if successful, false if error
@@ -45,11 +52,13 @@ private:
 	// The following are configurable parameters
 	float r25, beta, shC, seriesR;													// parameters declared in the M305 command
 	int8_t adcFilterChannel;
+	uint8_t adcReadingsAveraged;													// how many ADC readings the filter averages
 	bool isPT1000;																	// true if it is a PT1000 sensor, not a thermistor
 	int8_t adcLowOffset, adcHighOffset;
 
 	// The following are derived from the configurable parameters
 	float shA, shB;																	// derived parameters
+	int16_t *_ecv_array null lookupTable;											// temperatures at equally spaced readings, or nullptr if we don't use a table
 };
 
 #endif /* SRC_HEATING_THERMISTOR_H_ */
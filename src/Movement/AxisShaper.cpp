@@ -326,6 +326,7 @@ GCodeResult AxisShaper::Configure(GCodeBuffer& gb, const StringRef& reply) THROW
 			overlappedDeltaVPerA = u;
 		}
 
+		CalcSegmentTables();
 		reprap.MoveUpdated();
 	}
 	else if (type == InputShaperType::none)
@@ -361,6 +362,37 @@ GCodeResult AxisShaper::Configure(GCodeBuffer& gb, const StringRef& reply) THROW
 	return GCodeResult::ok;
 }
 
+// Calculate the tables of shaped segment parameters, so that generating the segments for each move needs only multiplications
+void AxisShaper::CalcSegmentTables() noexcept
+{
+	auto setSegment = [](ImpulseSegment& is, float coefficient, float duration) noexcept -> void
+						{
+							is.duration = duration;
+							is.deltaVPerA = coefficient * duration;
+							is.distancePerA = 0.5 * coefficient * fsquare(duration);
+							is.recipCoefficient = 1.0/coefficient;
+						};
+
+	for (unsigned int i = 0; i < numExtraImpulses; ++i)
+	{
+		setSegment(startSegments[i], coefficients[i], durations[i]);
+		setSegment(endSegments[i], 1.0 - coefficients[i], durations[i]);
+	}
+	for (unsigned int i = 0; i < 2 * numExtraImpulses; ++i)
+	{
+		setSegment(overlappedSegments[i], overlappedCoefficients[i], overlappedDurations[i]);
+	}
+}
+
+// Allocate a MoveSegment for one shaped segment and set it up. 'acceleration' is negative for deceleration.
+inline MoveSegment *AxisShaper::ImpulseSegment::Allocate(MoveSegment *next, const ImpulseSegment& is, float segStartSpeed, float acceleration, float recipAcceleration) noexcept
+{
+	MoveSegment * const seg = MoveSegment::Allocate(next);
+	const float recipSegAcceleration = recipAcceleration * is.recipCoefficient;
+	seg->SetNonLinear((segStartSpeed * is.duration) + (acceleration * is.distancePerA), is.duration, -segStartSpeed * recipSegAcceleration, 2.0 * recipSegAcceleration);
+	return seg;
+}
+
 // Plan input shaping, generate the MoveSegment, and set up the basic move parameters.
 // On entry, params.shapingPlan is set to 'no shaping'.
 // Currently we use a single input shaper for all axes, so the move segments are attached to the DDA not the DM
@@ -726,6 +758,7 @@ MoveSegment *AxisShaper::GetAccelerationSegments(const DDA& dda, PrepParams& par
 {
 	if (params.shaped.accelDistance > 0.0)
 	{
+		const float recipAcceleration = 1.0/params.shaped.acceleration;
 		if (params.shapingPlan.shapeAccelOverlapped)
 		{
 			MoveSegment *accelSegs = nullptr;
@@ -733,14 +766,8 @@ MoveSegment *AxisShaper::GetAccelerationSegments(const DDA& dda, PrepParams& par
 			for (unsigned int i = 2 * numExtraImpulses; i != 0; )
 			{
 				--i;
-				accelSegs = MoveSegment::Allocate(accelSegs);
-				const float acceleration = params.shaped.acceleration * overlappedCoefficients[i];
-				const float segTime = overlappedDurations[i];
-				segStartSpeed -= acceleration * segTime;
-				const float b = segStartSpeed/(-acceleration);
-				const float c = 2.0/acceleration;
-				const float segLen = (segStartSpeed + (0.5 * acceleration * segTime)) * segTime;
-				accelSegs->SetNonLinear(segLen, segTime, b, c);
+				segStartSpeed -= params.shaped.acceleration * overlappedSegments[i].deltaVPerA;
+				accelSegs = ImpulseSegment::Allocate(accelSegs, overlappedSegments[i], segStartSpeed, params.shaped.acceleration, recipAcceleration);
 			}
 			return accelSegs;
 		}
@@ -755,15 +782,9 @@ MoveSegment *AxisShaper::GetAccelerationSegments(const DDA& dda, PrepParams& par
 			for (unsigned int i = numExtraImpulses; i != 0; )
 			{
 				--i;
-				endAccelSegs = MoveSegment::Allocate(endAccelSegs);
-				const float acceleration = params.shaped.acceleration * (1.0 - coefficients[i]);
-				const float segTime = durations[i];
-				segStartSpeed -= acceleration * segTime;
-				const float b = segStartSpeed/(-acceleration);
-				const float c = 2.0/acceleration;
-				const float segLen = (segStartSpeed + (0.5 * acceleration * segTime)) * segTime;
-				endDistance -= segLen;
-				endAccelSegs->SetNonLinear(segLen, segTime, b, c);
+				segStartSpeed -= params.shaped.acceleration * endSegments[i].deltaVPerA;
+				endAccelSegs = ImpulseSegment::Allocate(endAccelSegs, endSegments[i], segStartSpeed, params.shaped.acceleration, recipAcceleration);
+				endDistance -= endAccelSegs->GetSegmentLength();
 			}
 			accumulatedSegTime += totalShapingClocks;
 		}
@@ -776,14 +797,8 @@ MoveSegment *AxisShaper::GetAccelerationSegments(const DDA& dda, PrepParams& par
 			// Shape the start of the acceleration
 			for (unsigned int i = 0; i < numExtraImpulses; ++i)
 			{
-				MoveSegment *seg = MoveSegment::Allocate(nullptr);
-				const float acceleration = params.shaped.acceleration * coefficients[i];
-				const float segTime = durations[i];
-				const float b = startSpeed/(-acceleration);
-				const float c = 2.0/acceleration;
-				const float segLen = (startSpeed + (0.5 * acceleration * segTime)) * segTime;
-				startDistance += segLen;
-				seg->SetNonLinear(segLen, segTime, b, c);
+				MoveSegment * const seg = ImpulseSegment::Allocate(nullptr, startSegments[i], startSpeed, params.shaped.acceleration, recipAcceleration);
+				startDistance += seg->GetSegmentLength();
 				if (i == 0)
 				{
 					startAccelSegs = seg;
@@ -792,7 +807,7 @@ MoveSegment *AxisShaper::GetAccelerationSegments(const DDA& dda, PrepParams& par
 				{
 					startAccelSegs->AddToTail(seg);
 				}
-				startSpeed += acceleration * segTime;
+				startSpeed += params.shaped.acceleration * startSegments[i].deltaVPerA;
 			}
 			accumulatedSegTime += totalShapingClocks;
 		}
@@ -801,8 +816,8 @@ MoveSegment *AxisShaper::GetAccelerationSegments(const DDA& dda, PrepParams& par
 		if (endDistance > startDistance)
 		{
 			endAccelSegs = MoveSegment::Allocate(endAccelSegs);
-			const float b = startSpeed/(-params.shaped.acceleration);
-			const float c = 2.0/params.shaped.acceleration;
+			const float b = -startSpeed * recipAcceleration;
+			const float c = 2.0 * recipAcceleration;
 			endAccelSegs->SetNonLinear(endDistance - startDistance, params.shaped.accelClocks - accumulatedSegTime, b, c);
 		}
 		else if (reprap.Debug(moduleMove))
@@ -831,6 +846,9 @@ MoveSegment *AxisShaper::GetDecelerationSegments(const DDA& dda, PrepParams& par
 {
 	if (params.shaped.decelStartDistance < dda.totalDistance)
 	{
+		// We treat deceleration as negative acceleration
+		const float acceleration = -params.shaped.deceleration;
+		const float recipAcceleration = 1.0/acceleration;
 		if (params.shapingPlan.shapeDecelOverlapped)
 		{
 			MoveSegment *decelSegs = nullptr;
@@ -838,14 +856,8 @@ MoveSegment *AxisShaper::GetDecelerationSegments(const DDA& dda, PrepParams& par
 			for (unsigned int i = 2 * numExtraImpulses; i != 0; )
 			{
 				--i;
-				decelSegs = MoveSegment::Allocate(decelSegs);
-				const float deceleration = params.shaped.deceleration * overlappedCoefficients[i];
-				const float segTime = overlappedDurations[i];
-				segStartSpeed += deceleration * segTime;
-				const float b = segStartSpeed/deceleration;
-				const float c = -2.0/deceleration;
-				const float segLen = (segStartSpeed + (-0.5 * deceleration * segTime)) * segTime;
-				decelSegs->SetNonLinear(segLen, segTime, b, c);
+				segStartSpeed -= acceleration * overlappedSegments[i].deltaVPerA;
+				decelSegs = ImpulseSegment::Allocate(decelSegs, overlappedSegments[i], segStartSpeed, acceleration, recipAcceleration);
 			}
 			return decelSegs;
 		}
@@ -860,15 +872,9 @@ MoveSegment *AxisShaper::GetDecelerationSegments(const DDA& dda, PrepParams& par
 			for (unsigned int i = numExtraImpulses; i != 0; )
 			{
 				--i;
-				endDecelSegs = MoveSegment::Allocate(endDecelSegs);
-				const float deceleration = params.shaped.deceleration * (1.0 - coefficients[i]);
-				const float segTime = durations[i];
-				segStartSpeed += deceleration * segTime;
-				const float b = segStartSpeed/deceleration;
-				const float c = -2.0/deceleration;
-				const float segLen = (segStartSpeed + (-0.5 * deceleration * segTime)) * segTime;
-				endDecelSegs->SetNonLinear(segLen, segTime, b, c);
-				endDistance -= segLen;
+				segStartSpeed -= acceleration * endSegments[i].deltaVPerA;
+				endDecelSegs = ImpulseSegment::Allocate(endDecelSegs, endSegments[i], segStartSpeed, acceleration, recipAcceleration);
+				endDistance -= endDecelSegs->GetSegmentLength();
 			}
 			accumulatedSegTime += totalShapingClocks;
 		}
@@ -881,14 +887,8 @@ MoveSegment *AxisShaper::GetDecelerationSegments(const DDA& dda, PrepParams& par
 			// Shape the start of the deceleration
 			for (unsigned int i = 0; i < numExtraImpulses; ++i)
 			{
-				MoveSegment *seg = MoveSegment::Allocate(nullptr);
-				const float deceleration = params.shaped.deceleration * coefficients[i];
-				const float segTime = durations[i];
-				const float b = startSpeed/deceleration;
-				const float c = -2.0/deceleration;
-				const float segLen = (startSpeed + (-0.5 * deceleration * segTime)) * segTime;
-				startDistance += segLen;
-				seg->SetNonLinear(segLen, segTime, b, c);
+				MoveSegment * const seg = ImpulseSegment::Allocate(nullptr, startSegments[i], startSpeed, acceleration, recipAcceleration);
+				startDistance += seg->GetSegmentLength();
 				if (i == 0)
 				{
 					startDecelSegs = seg;
@@ -897,7 +897,7 @@ MoveSegment *AxisShaper::GetDecelerationSegments(const DDA& dda, PrepParams& par
 				{
 					startDecelSegs->AddToTail(seg);
 				}
-				startSpeed -= deceleration * segTime;
+				startSpeed += acceleration * startSegments[i].deltaVPerA;
 			}
 			accumulatedSegTime += totalShapingClocks;
 		}
@@ -906,8 +906,8 @@ MoveSegment *AxisShaper::GetDecelerationSegments(const DDA& dda, PrepParams& par
 		if (endDistance > startDistance)
 		{
 			endDecelSegs = MoveSegment::Allocate(endDecelSegs);
-			const float b = startSpeed/params.shaped.deceleration;
-			const float c = -2.0/params.shaped.deceleration;
+			const float b = -startSpeed * recipAcceleration;
+			const float c = 2.0 * recipAcceleration;
 			endDecelSegs->SetNonLinear(endDistance - startDistance, params.shaped.decelClocks - accumulatedSegTime, b, c);
 		}
 		else if (reprap.Debug(moduleMove))
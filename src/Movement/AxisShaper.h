@@ -67,6 +67,18 @@ private:
 	void TryShapeDecelBoth(DDA& dda, PrepParams& params) const noexcept;
 	bool ImplementAccelShaping(const DDA& dda, PrepParams& params, float newAccelDistance, float newAccelClocks) const noexcept;
 	bool ImplementDecelShaping(const DDA& dda, PrepParams& params, float newDecelStartDistance, float newDecelClocks) const noexcept;
+	void CalcSegmentTables() noexcept;
+
+	// Precomputed parameters of one shaped acceleration or deceleration segment, per unit of the unshaped acceleration or deceleration
+	struct ImpulseSegment
+	{
+		float duration;									// the duration of the segment in step clocks
+		float deltaVPerA;								// the speed change during the segment
+		float distancePerA;								// the distance moved during the segment, less the contribution from the initial speed
+		float recipCoefficient;							// the reciprocal of the fraction of the acceleration used in this segment
+
+		static MoveSegment *Allocate(MoveSegment *next, const ImpulseSegment& is, float segStartSpeed, float acceleration, float recipAcceleration) noexcept;
+	};
 
 	static constexpr unsigned int MaxExtraImpulses = 4;
 	static constexpr float DefaultFrequency = 40.0;
@@ -93,6 +105,9 @@ private:
 	float overlappedShapingClocks;						// the acceleration or deceleration duration when we use overlapping, in step clocks
 	float overlappedDeltaVPerA;							// the effective acceleration time (velocity change per unit acceleration) when we use overlapping, in step clocks
 	float overlappedDistancePerA;						// the distance needed by an overlapped acceleration or deceleration, less the initial velocity contribution
+	ImpulseSegment startSegments[MaxExtraImpulses];		// the segments used to shape the start of acceleration or deceleration
+	ImpulseSegment endSegments[MaxExtraImpulses];		// the segments used to shape the end of acceleration or deceleration
+	ImpulseSegment overlappedSegments[2 * MaxExtraImpulses];	// the segments of an overlapped acceleration or deceleration
 	InputShaperType type;
 };
 
@@ -10,6 +10,7 @@
 #include <Platform/RepRap.h>
 #include <GCodes/GCodes.h>
 #include <Storage/FileStore.h>
+#include <Storage/CRC32.h>
 #include <Math/Deviation.h>
 
 #include <cmath>
@@ -327,7 +328,18 @@ void GridDefinition::PrintError(float originalAxis0range, float originalAxis1ran
 // Adding more fields to the header row can be handled in GridDefinition::ReadParameters(), though.
 const char * const HeightMap::HeightMapComment = "RepRapFirmware height map file v2";
 
-HeightMap::HeightMap() noexcept : useMap(false) { }
+#if SUPPORT_BICUBIC_MESH
+constexpr float BicubicMeshTolerance = 0.002;		// the maximum height error we allow when we approximate the bicubic surface by straight move segments, in mm
+#endif
+constexpr float BilinearMeshTolerance = 0.002;		// the maximum height error we allow when we don't split a move at every grid line it crosses, in mm
+constexpr unsigned int MaxGridLinesForReducedSegments = 32;	// if a move crosses more grid lines than this then we split it at every one, to limit the time taken
+
+HeightMap::HeightMap() noexcept : useMap(false)
+#if SUPPORT_BICUBIC_MESH
+	, useBicubic(false), recipMaxSegmentLength(0.0)
+#endif
+{
+}
 
 void HeightMap::SetGrid(const GridDefinition& gd) noexcept
 {
@@ -354,14 +366,25 @@ void HeightMap::SetGridHeight(size_t index, float height) noexcept
 {
 	if (index < MaxGridProbePoints)
 	{
-		gridHeights[index] = height;
+		gridHeights[index] = ToFixed(height);
 		gridHeightSet.SetBit(index);
 	}
 }
 
-// Return the minimum number of segments for a move by this X or Y amount
+// Round a value to the nearest int16_t, clamping it to the range of int16_t and avoiding the value we use to mark un-probed points in binary files
+static inline int16_t RoundToInt16(float val) noexcept
+{
+	return (int16_t)lrintf(constrain<float>(val, -32767.0, 32767.0));
+}
+
+/*static*/ int16_t HeightMap::ToFixed(float height) noexcept
+{
+	return RoundToInt16(height * RecipHeightUnit);
+}
+
+// Return the minimum number of segments for a move from this position by this X or Y amount
 // Note that deltaAxis0 and deltaAxis1 may be negative
-unsigned int HeightMap::GetMinimumSegments(float deltaAxis0, float deltaAxis1) const noexcept
+unsigned int HeightMap::GetMinimumSegments(float startAxis0, float startAxis1, float deltaAxis0, float deltaAxis1) const noexcept
 {
 	const float axis0Distance = fabsf(deltaAxis0);
 	unsigned int axis0Segments = (axis0Distance > 0.0) ? (unsigned int)(axis0Distance * def.recipAxisSpacings[0] + 0.4) : 1;
@@ -369,15 +392,155 @@ unsigned int HeightMap::GetMinimumSegments(float deltaAxis0, float deltaAxis1) c
 	const float axis1Distance = fabsf(deltaAxis1);
 	unsigned int axis1Segments = (axis1Distance > 0.0) ? (unsigned int)(axis1Distance * def.recipAxisSpacings[1] + 0.4) : 1;
 
-	return max<unsigned int>(axis0Segments, axis1Segments);
+	const unsigned int gridLineSegments = max<unsigned int>(axis0Segments, axis1Segments);
+
+#if SUPPORT_BICUBIC_MESH
+	if (useBicubic)
+	{
+		// The bicubic surface has no kinks at the grid lines, so we only need enough segments to keep within tolerance of it.
+		// We never need more segments than bilinear interpolation would, because that would give a worse approximation in any case.
+		const unsigned int curvatureSegments = (unsigned int)ceilf(fastSqrtf(fsquare(deltaAxis0) + fsquare(deltaAxis1)) * recipMaxSegmentLength);
+		return constrain<unsigned int>(curvatureSegments, 1, gridLineSegments);
+	}
+#endif
+
+	// Bilinear interpolation has kinks at the grid lines, but where the height map is close to planar they are too small to matter.
+	// So try successively doubled numbers of equal segments and use the first one that keeps within tolerance of the interpolated surface.
+	if (gridLineSegments > 1 && gridLineSegments <= MaxGridLinesForReducedSegments)
+	{
+		return GetReducedBilinearSegments(startAxis0, startAxis1, deltaAxis0, deltaAxis1, gridLineSegments);
+	}
+	return gridLineSegments;
+}
+
+// Find the smallest power of 2 number of equal segments, less than gridLineSegments, such that the straight segments keep within BilinearMeshTolerance
+// of the bilinear surface at every grid line crossing and half way between them. Return gridLineSegments if there is no such number.
+unsigned int HeightMap::GetReducedBilinearSegments(float startAxis0, float startAxis1, float deltaAxis0, float deltaAxis1, unsigned int gridLineSegments) const noexcept
+{
+	// Find the fractions of the way along the move at which it crosses grid lines, in increasing order
+	float crossings[2 * (MaxGridLinesForReducedSegments + 1)];
+	size_t numCrossings = 0;
+	const float starts[2] = { startAxis0, startAxis1 };
+	const float deltas[2] = { deltaAxis0, deltaAxis1 };
+	for (size_t axis = 0; axis < 2; ++axis)
+	{
+		if (deltas[axis] != 0.0)
+		{
+			const float firstIndex = (starts[axis] - def.mins[axis]) * def.recipAxisSpacings[axis];
+			const float lastIndex = firstIndex + deltas[axis] * def.recipAxisSpacings[axis];
+			const float step = (lastIndex > firstIndex) ? 1.0 : -1.0;
+			const float recipIndexChange = 1.0/(lastIndex - firstIndex);
+			for (float line = (step > 0.0) ? floorf(firstIndex) + 1.0 : ceilf(firstIndex) - 1.0;
+				 (step > 0.0) ? line < lastIndex : line > lastIndex;
+				 line += step)
+			{
+				if (numCrossings == ARRAY_SIZE(crossings))
+				{
+					return gridLineSegments;
+				}
+				crossings[numCrossings++] = (line - firstIndex) * recipIndexChange;
+			}
+		}
+	}
+	if (numCrossings == 0)
+	{
+		return 1;
+	}
+
+	// The crossings of each axis are in order already, so an insertion sort is quick
+	for (size_t i = 1; i < numCrossings; ++i)
+	{
+		const float t = crossings[i];
+		size_t j = i;
+		while (j != 0 && crossings[j - 1] > t)
+		{
+			crossings[j] = crossings[j - 1];
+			--j;
+		}
+		crossings[j] = t;
+	}
+
+	// Check each candidate number of segments against the surface at each crossing point and half way between it and the previous one
+	for (unsigned int numSegments = 1; numSegments < gridLineSegments; numSegments *= 2)
+	{
+		const float recipNumSegments = 1.0/(float)numSegments;
+		bool ok = true;
+		float prevT = 0.0;
+		for (size_t i = 0; ok && i <= numCrossings; ++i)
+		{
+			const float nextT = (i == numCrossings) ? 1.0 : crossings[i];
+			const float samples[2] = { 0.5 * (prevT + nextT), nextT };
+			for (float t : samples)
+			{
+				const unsigned int segment = min<unsigned int>((unsigned int)(t * numSegments), numSegments - 1);
+				const float t0 = segment * recipNumSegments;
+				const float t1 = t0 + recipNumSegments;
+				const float h0 = GetInterpolatedHeightError(startAxis0 + t0 * deltaAxis0, startAxis1 + t0 * deltaAxis1);
+				const float h1 = GetInterpolatedHeightError(startAxis0 + t1 * deltaAxis0, startAxis1 + t1 * deltaAxis1);
+				const float h = GetInterpolatedHeightError(startAxis0 + t * deltaAxis0, startAxis1 + t * deltaAxis1);
+				if (fabsf(h - (h0 + (h1 - h0) * (t - t0) * numSegments)) > BilinearMeshTolerance)
+				{
+					ok = false;
+					break;
+				}
+			}
+			prevT = nextT;
+		}
+		if (ok)
+		{
+			return numSegments;
+		}
+	}
+	return gridLineSegments;
 }
 
 #if HAS_MASS_STORAGE || HAS_SBC_INTERFACE
 
+// The header at the start of a binary height map file. It is followed by the heights of the points in microns as int16_t values in the same order
+// as in a CSV file, with the value BinaryHeightNotProbed for the points that were not probed. All values are stored little-endian.
+// Binary files are smaller and much faster to load than CSV files, which matters when the height map has thousands of points.
+// The CRC is the standard CRC32 of the height data, so that we don't use a height map that has been corrupted.
+struct BinaryHeightMapHeader
+{
+	static constexpr uint32_t MagicValue = 0x48465252;		// "RRFH" when stored little-endian
+	static constexpr uint8_t CurrentVersion = 1;
+
+	uint32_t magic;
+	uint8_t version;
+	char letters[2];
+	uint8_t reserved;
+	float mins[2], maxs[2];
+	float radius;
+	float spacings[2];
+	uint16_t nums[2];
+	uint32_t crc;
+};
+
+static_assert(sizeof(BinaryHeightMapHeader) == 44, "Binary height map header must be 44 bytes");
+
+constexpr int16_t BinaryHeightNotProbed = INT16_MIN;
+
+// Return true if we save the grid to this file in binary format. We can load either format from any file.
+static bool IsBinaryFileName(const char *fname) noexcept
+{
+	return StringEndsWithIgnoreCase(fname, ".bin");
+}
+
 // Save the grid to file returning true if an error occurred
 bool HeightMap::SaveToFile(FileStore *f, const char *fname, float zOffset) noexcept
 {
-	String<StringLength500> bufferSpace;
+	if (IsBinaryFileName(fname))
+	{
+		if (SaveToBinaryFile(f, zOffset))
+		{
+			return true;
+		}
+		fileName.copy(fname);
+		return false;
+	}
+
+	constexpr size_t RowLength = (MaxAxis0GridPoints * 8) + 2;						// a row of heights needs 8 characters per grid point
+	String<(RowLength > StringLength500) ? RowLength : StringLength500> bufferSpace;
 	const StringRef buf = bufferSpace.GetRef();
 
 	// Write the header comment
@@ -419,7 +582,7 @@ bool HeightMap::SaveToFile(FileStore *f, const char *fname, float zOffset) noexc
 			}
 			if (gridHeightSet.IsBitSet(index))
 			{
-				buf.catf("%7.3f", (double)(gridHeights[index] + zOffset));
+				buf.catf("%7.3f", (double)(GetHeight(index) + zOffset));
 			}
 			else
 			{
@@ -438,9 +601,155 @@ bool HeightMap::SaveToFile(FileStore *f, const char *fname, float zOffset) noexc
 	return false;
 }
 
+// Save the grid to file in binary format returning true if an error occurred
+bool HeightMap::SaveToBinaryFile(FileStore *f, float zOffset) noexcept
+{
+	BinaryHeightMapHeader hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = BinaryHeightMapHeader::MagicValue;
+	hdr.version = BinaryHeightMapHeader::CurrentVersion;
+	for (size_t axis = 0; axis < 2; ++axis)
+	{
+		hdr.letters[axis] = def.letters[axis];
+		hdr.mins[axis] = def.mins[axis];
+		hdr.maxs[axis] = def.maxs[axis];
+		hdr.spacings[axis] = def.spacings[axis];
+		hdr.nums[axis] = (uint16_t)def.nums[axis];
+	}
+	hdr.radius = def.radius;
+
+	// Fill the buffer with the values to write for the points starting at the specified index, returning the number of values
+	const float fixedZOffset = (float)ToFixed(zOffset);
+	int16_t buf[64];
+	auto fillBuffer = [this, fixedZOffset, &buf](uint32_t startIndex) noexcept -> size_t
+						{
+							const size_t numValues = min<size_t>(ARRAY_SIZE(buf), def.NumPoints() - startIndex);
+							for (size_t i = 0; i < numValues; ++i)
+							{
+								const uint32_t index = startIndex + i;
+								buf[i] = (gridHeightSet.IsBitSet(index)) ? RoundToInt16((float)gridHeights[index] + fixedZOffset) : BinaryHeightNotProbed;
+							}
+							return numValues;
+						};
+
+	// We need the CRC before we write the header, so generate the data twice rather than seeking back to rewrite the header
+	CRC32 crc;
+	for (uint32_t index = 0; index < def.NumPoints(); )
+	{
+		const size_t numValues = fillBuffer(index);
+		crc.Update(reinterpret_cast<const char *>(buf), numValues * sizeof(buf[0]));
+		index += numValues;
+	}
+	hdr.crc = crc.Get();
+
+	if (!f->Write(reinterpret_cast<const uint8_t *>(&hdr), sizeof(hdr)))
+	{
+		return true;
+	}
+	for (uint32_t index = 0; index < def.NumPoints(); )
+	{
+		const size_t numValues = fillBuffer(index);
+		if (!f->Write(reinterpret_cast<const uint8_t *>(buf), numValues * sizeof(buf[0])))
+		{
+			return true;
+		}
+		index += numValues;
+	}
+	return false;
+}
+
+// Load the grid from a binary file, returning true if an error occurred with the error reason appended to the buffer.
+bool HeightMap::LoadFromBinaryFile(FileStore *f, const StringRef& r) noexcept
+{
+	BinaryHeightMapHeader hdr;
+	if (!f->Seek(0) || f->Read(reinterpret_cast<uint8_t *>(&hdr), sizeof(hdr)) != (int)sizeof(hdr))
+	{
+		r.cat("failed to read header");
+		return true;
+	}
+	if (hdr.version != BinaryHeightMapHeader::CurrentVersion)
+	{
+		r.cat("wrong version header");
+		return true;
+	}
+
+	GridDefinition newGrid;
+	for (size_t axis = 0; axis < 2; ++axis)
+	{
+		newGrid.letters[axis] = hdr.letters[axis];
+		newGrid.mins[axis] = hdr.mins[axis];
+		newGrid.maxs[axis] = hdr.maxs[axis];
+		newGrid.spacings[axis] = hdr.spacings[axis];
+		newGrid.nums[axis] = hdr.nums[axis];
+	}
+	newGrid.radius = hdr.radius;
+	newGrid.CheckValidity(false);
+	if (!newGrid.IsValid())
+	{
+		r.cat("invalid grid");
+		return true;
+	}
+	if (f->Length() != sizeof(hdr) + newGrid.NumPoints() * sizeof(int16_t))
+	{
+		r.cat("wrong file length");
+		return true;
+	}
+
+	// The heights are stored in the file in the same form as we hold them, so read them straight into the height array
+	SetGrid(newGrid);
+	const size_t dataLength = def.NumPoints() * sizeof(gridHeights[0]);
+	if (f->Read(reinterpret_cast<uint8_t *>(gridHeights), dataLength) != (int)dataLength)
+	{
+		r.cat("failed to read heights");
+		return true;
+	}
+
+	CRC32 crc;
+	crc.Update(reinterpret_cast<const char *>(gridHeights), dataLength);
+	if (crc.Get() != hdr.crc)
+	{
+		r.cat("CRC mismatch");
+		return true;
+	}
+
+	for (uint32_t index = 0; index < def.NumPoints(); ++index)
+	{
+		if (gridHeights[index] == BinaryHeightNotProbed)
+		{
+			gridHeights[index] = 0;
+		}
+		else
+		{
+			gridHeightSet.SetBit(index);
+		}
+	}
+	return false;
+}
+
 // Load the grid from file, returning true if an error occurred with the error reason appended to the buffer
 bool HeightMap::LoadFromFile(FileStore *f, const char *fname, const StringRef& r) noexcept
 {
+	// Check for a binary height map first
+	{
+		uint32_t magic;
+		if (f->Read(reinterpret_cast<uint8_t *>(&magic), sizeof(magic)) == (int)sizeof(magic) && magic == BinaryHeightMapHeader::MagicValue)
+		{
+			ClearGridHeights();
+			if (LoadFromBinaryFile(f, r))
+			{
+				return true;
+			}
+			ExtrapolateMissing();
+			fileName.copy(fname);
+			return false;
+		}
+		if (!f->Seek(0))
+		{
+			r.cat("failed to read file");
+			return true;
+		}
+	}
+
 	const size_t MaxLineLength = (MaxAxis0GridPoints * 8) + 2;					// maximum length of a line in the height map file, need 8 characters per grid point
 	const char* const readFailureText = "failed to read line from file";
 	char buffer[MaxLineLength + 1];
@@ -539,7 +848,7 @@ unsigned int HeightMap::GetStatistics(Deviation& deviation, float& minError, flo
 		if (gridHeightSet.IsBitSet(i))
 		{
 			++numProbed;
-			const float fHeightError = gridHeights[i];
+			const float fHeightError = GetHeight(i);
 			if (fHeightError > maxError)
 			{
 				maxError = fHeightError;
@@ -592,6 +901,12 @@ float HeightMap::GetInterpolatedHeightError(float axis0, float axis1) const noex
 	const float yFloor = floor(yf);
 	const int32_t yIndex = (int32_t)yFloor;
 
+#if SUPPORT_BICUBIC_MESH
+	if (useBicubic)
+	{
+		return InterpolateBicubic(xIndex, yIndex, xf - xFloor, yf - yFloor);
+	}
+#endif
 	return InterpolateAxis0Axis1(xIndex, yIndex, xf - xFloor, yf - yFloor);
 }
 
@@ -603,13 +918,238 @@ float HeightMap::InterpolateAxis0Axis1(uint32_t axis0Index, uint32_t axis1Index,
 	const uint32_t indexX1Y1 = indexX0Y1 + 1;						// (X1,Y1)
 
 	const float xyFrac = axis0Frac * axis1Frac;
-	return (gridHeights[indexX0Y0] * (1.0 - axis0Frac - axis1Frac + xyFrac))
-			+ (gridHeights[indexX1Y0] * (axis0Frac - xyFrac))
-			+ (gridHeights[indexX0Y1] * (axis1Frac - xyFrac))
-			+ (gridHeights[indexX1Y1] * xyFrac);
+	return (GetHeight(indexX0Y0) * (1.0 - axis0Frac - axis1Frac + xyFrac))
+			+ (GetHeight(indexX1Y0) * (axis0Frac - xyFrac))
+			+ (GetHeight(indexX0Y1) * (axis1Frac - xyFrac))
+			+ (GetHeight(indexX1Y1) * xyFrac);
+}
+
+#if SUPPORT_BICUBIC_MESH
+
+// Turn bicubic interpolation on or off. We calculate the slopes before we set the flag, because the Move task may be using the height map.
+void HeightMap::UseBicubicInterpolation(bool b) noexcept
+{
+	if (b && !useBicubic)
+	{
+		CalculateSlopes();
+	}
+	useBicubic = b;
+}
+
+// Calculate the derivatives of the height at each grid point for bicubic interpolation, using central differences except at the edges.
+// The derivatives are with respect to the grid indices, so that InterpolateBicubic doesn't need to scale them by the grid spacing.
+// We work in microns throughout, because that is how the heights and derivatives are stored.
+// Also estimate the maximum curvature of the surface, so that GetMinimumSegments can work out how long the move segments can be.
+void HeightMap::CalculateSlopes() noexcept
+{
+	const uint32_t num0 = def.nums[0], num1 = def.nums[1];
+	float maxCurvature0 = 0.0, maxCurvature1 = 0.0, maxCrossCurvature = 0.0;
+	for (uint32_t iAxis1 = 0; iAxis1 < num1; ++iAxis1)
+	{
+		const uint32_t prev1 = (iAxis1 == 0) ? 0 : iAxis1 - 1;
+		const uint32_t next1 = (iAxis1 + 1 == num1) ? iAxis1 : iAxis1 + 1;
+		const float recipSpan1 = (next1 > prev1) ? 1.0/(float)(next1 - prev1) : 0.0;
+		for (uint32_t iAxis0 = 0; iAxis0 < num0; ++iAxis0)
+		{
+			const uint32_t prev0 = (iAxis0 == 0) ? 0 : iAxis0 - 1;
+			const uint32_t next0 = (iAxis0 + 1 == num0) ? iAxis0 : iAxis0 + 1;
+			const float recipSpan0 = (next0 > prev0) ? 1.0/(float)(next0 - prev0) : 0.0;
+
+			int16_t *const slopes = gridSlopes[GetMapIndex(iAxis0, iAxis1)];
+			slopes[0] = RoundToInt16((float)(gridHeights[GetMapIndex(next0, iAxis1)] - gridHeights[GetMapIndex(prev0, iAxis1)]) * recipSpan0);
+			slopes[1] = RoundToInt16((float)(gridHeights[GetMapIndex(iAxis0, next1)] - gridHeights[GetMapIndex(iAxis0, prev1)]) * recipSpan1);
+			const float crossSlope = (float)(  gridHeights[GetMapIndex(next0, next1)] - gridHeights[GetMapIndex(next0, prev1)]
+											 - gridHeights[GetMapIndex(prev0, next1)] + gridHeights[GetMapIndex(prev0, prev1)]) * recipSpan0 * recipSpan1;
+			slopes[2] = RoundToInt16(crossSlope);
+			maxCrossCurvature = max<float>(maxCrossCurvature, fabsf(crossSlope));
+
+			if (iAxis0 != 0 && iAxis0 + 1 != num0)
+			{
+				maxCurvature0 = max<float>(maxCurvature0, fabsf((float)(gridHeights[GetMapIndex(next0, iAxis1)] - 2 * gridHeights[GetMapIndex(iAxis0, iAxis1)] + gridHeights[GetMapIndex(prev0, iAxis1)])));
+			}
+			if (iAxis1 != 0 && iAxis1 + 1 != num1)
+			{
+				maxCurvature1 = max<float>(maxCurvature1, fabsf((float)(gridHeights[GetMapIndex(iAxis0, next1)] - 2 * gridHeights[GetMapIndex(iAxis0, iAxis1)] + gridHeights[GetMapIndex(iAxis0, prev1)])));
+			}
+		}
+	}
+
+	// Convert the curvatures to mm^-1 and allow for the cubic overshooting the second differences by up to a factor of 2.
+	// Then a straight segment of length L deviates from the surface by at most L^2 * curvature/8.
+	const float curvature = 2.0 * HeightUnit * (  maxCurvature0 * fsquare(def.recipAxisSpacings[0])
+								   + maxCurvature1 * fsquare(def.recipAxisSpacings[1])
+								   + 2.0 * maxCrossCurvature * def.recipAxisSpacings[0] * def.recipAxisSpacings[1]);
+	recipMaxSegmentLength = fastSqrtf(curvature/(8.0 * BicubicMeshTolerance));
+}
+
+// Evaluate the bicubic Hermite patch for a grid cell from the heights and derivatives at its corners
+float HeightMap::InterpolateBicubic(uint32_t axis0Index, uint32_t axis1Index, float axis0Frac, float axis1Frac) const noexcept
+{
+	const uint32_t indexX0Y0 = GetMapIndex(axis0Index, axis1Index);
+	const uint32_t indexX1Y0 = indexX0Y0 + 1;
+	const uint32_t indexX0Y1 = indexX0Y0 + def.nums[0];
+	const uint32_t indexX1Y1 = indexX0Y1 + 1;
+
+	// Hermite basis functions in each direction: h0 and h1 weight the values at the two ends, d0 and d1 weight the derivatives
+	const float u = axis0Frac, u2 = u * u, u3 = u2 * u;
+	const float uh1 = 3 * u2 - 2 * u3, uh0 = 1.0 - uh1, ud0 = u3 - 2 * u2 + u, ud1 = u3 - u2;
+	const float v = axis1Frac, v2 = v * v, v3 = v2 * v;
+	const float vh1 = 3 * v2 - 2 * v3, vh0 = 1.0 - vh1, vd0 = v3 - 2 * v2 + v, vd1 = v3 - v2;
+
+	auto corner = [this](uint32_t index, float uh, float ud, float vh, float vd) noexcept -> float
+					{
+						const int16_t *const slopes = gridSlopes[index];
+						return ((float)gridHeights[index] * uh + (float)slopes[0] * ud) * vh + ((float)slopes[1] * uh + (float)slopes[2] * ud) * vd;
+					};
+
+	return (  corner(indexX0Y0, uh0, ud0, vh0, vd0)
+			+ corner(indexX1Y0, uh1, ud1, vh0, vd0)
+			+ corner(indexX0Y1, uh0, ud0, vh1, vd1)
+			+ corner(indexX1Y1, uh1, ud1, vh1, vd1)) * HeightUnit;
+}
+
+#endif
+
+// Adaptive probing. The first pass probes only the coarse points, which are every stride'th point along each axis plus the points on the far edges.
+// The curvature of the bed at the corners of each coarse cell tells us how far the bed may deviate from the bilinear surface through the corners.
+// If it may deviate by more than the tolerance then the second pass probes the remaining points in that cell, otherwise we interpolate them.
+
+// Return the index of the next coarse point along an axis, where 'index' is a coarse point
+static inline uint32_t NextCoarseIndex(uint32_t index, uint32_t numPoints, uint32_t stride) noexcept
+{
+	return min<uint32_t>(index + stride, numPoints - 1);
+}
+
+// Estimate the second derivative of the height along an axis at a coarse point with respect to the grid index, or return 0 if we can't.
+// The last coarse point may be closer than the stride to the one before it, so we use divided differences.
+float HeightMap::GetCoarseCurvature(size_t axis, uint32_t axis0Index, uint32_t axis1Index, uint32_t stride) const noexcept
+{
+	const uint32_t numPoints = def.nums[axis];
+	const uint32_t index = (axis == 0) ? axis0Index : axis1Index;
+	if (index == 0 || index + 1 == numPoints)
+	{
+		return 0.0;
+	}
+	const uint32_t prev = index - stride, next = NextCoarseIndex(index, numPoints, stride);			// index is not the last point so it is a multiple of the stride
+	const uint32_t prevMapIndex = (axis == 0) ? GetMapIndex(prev, axis1Index) : GetMapIndex(axis0Index, prev);
+	const uint32_t nextMapIndex = (axis == 0) ? GetMapIndex(next, axis1Index) : GetMapIndex(axis0Index, next);
+	const uint32_t mapIndex = GetMapIndex(axis0Index, axis1Index);
+	if (!gridHeightSet.IsBitSet(prevMapIndex) || !gridHeightSet.IsBitSet(nextMapIndex))
+	{
+		return 0.0;
+	}
+	const float slopeBefore = (GetHeight(mapIndex) - GetHeight(prevMapIndex))/(float)(index - prev);
+	const float slopeAfter = (GetHeight(nextMapIndex) - GetHeight(mapIndex))/(float)(next - index);
+	return 2.0 * (slopeAfter - slopeBefore)/(float)(next - prev);
 }
 
+// Decide whether we need to probe all the points in a coarse cell. If the curvature is c then the bilinear surface may be in error by up to c * L^2/8 where L is the cell size.
+// If we failed to probe a corner, e.g. because it was out of reach, we probe the whole cell to be safe.
+bool HeightMap::CoarseCellNeedsRefining(uint32_t i0, uint32_t i1, uint32_t j0, uint32_t j1, uint32_t stride, float tolerance) const noexcept
+{
+	const uint32_t corners0[2] = { i0, i1 }, corners1[2] = { j0, j1 };
+	const float size0Squared = fsquare((float)(i1 - i0)), size1Squared = fsquare((float)(j1 - j0));
+	for (uint32_t c0 : corners0)
+	{
+		for (uint32_t c1 : corners1)
+		{
+			if (!gridHeightSet.IsBitSet(GetMapIndex(c0, c1)))
+			{
+				return true;
+			}
+			const float error = max<float>(fabsf(GetCoarseCurvature(0, c0, c1, stride)) * size0Squared, fabsf(GetCoarseCurvature(1, c0, c1, stride)) * size1Squared) * 0.125;
+			if (error > tolerance)
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+// Called when the coarse points have been probed. Set the bits in pointsToProbe for the points that we need to probe in the second pass and set numToProbe to the number of them.
+// Fill in the heights of the points in the remaining cells by bilinear interpolation, and return how many points we filled in.
+unsigned int HeightMap::RefineAdaptive(uint32_t stride, float tolerance, LargeBitmap<MaxGridProbePoints>& pointsToProbe, unsigned int& numToProbe) noexcept
+{
+	pointsToProbe.ClearAll();
+	numToProbe = 0;
+	const uint32_t num0 = def.nums[0], num1 = def.nums[1];
+
+	// First mark the points in the cells that need refining. A point on the boundary between two cells must be probed if either cell needs refining.
+	for (uint32_t j0 = 0; j0 + 1 < num1; j0 = NextCoarseIndex(j0, num1, stride))
+	{
+		const uint32_t j1 = NextCoarseIndex(j0, num1, stride);
+		for (uint32_t i0 = 0; i0 + 1 < num0; i0 = NextCoarseIndex(i0, num0, stride))
+		{
+			const uint32_t i1 = NextCoarseIndex(i0, num0, stride);
+			if (CoarseCellNeedsRefining(i0, i1, j0, j1, stride, tolerance))
+			{
+				for (uint32_t j = j0; j <= j1; ++j)
+				{
+					for (uint32_t i = i0; i <= i1; ++i)
+					{
+						const uint32_t index = GetMapIndex(i, j);
+						if (!gridHeightSet.IsBitSet(index) && !pointsToProbe.IsBitSet(index))
+						{
+							pointsToProbe.SetBit(index);
+							++numToProbe;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Now interpolate the remaining points from the corners of their cells
+	unsigned int numInterpolated = 0;
+	for (uint32_t j0 = 0; j0 + 1 < num1; j0 = NextCoarseIndex(j0, num1, stride))
+	{
+		const uint32_t j1 = NextCoarseIndex(j0, num1, stride);
+		for (uint32_t i0 = 0; i0 + 1 < num0; i0 = NextCoarseIndex(i0, num0, stride))
+		{
+			const uint32_t i1 = NextCoarseIndex(i0, num0, stride);
+			const uint32_t corner00 = GetMapIndex(i0, j0), corner10 = GetMapIndex(i1, j0), corner01 = GetMapIndex(i0, j1), corner11 = GetMapIndex(i1, j1);
+			if (   !gridHeightSet.IsBitSet(corner00) || !gridHeightSet.IsBitSet(corner10)
+				|| !gridHeightSet.IsBitSet(corner01) || !gridHeightSet.IsBitSet(corner11)
+			   )
+			{
+				continue;										// this cell needs refining, so all its points are marked to be probed
+			}
+			for (uint32_t j = j0; j <= j1; ++j)
+			{
+				const float frac1 = (float)(j - j0)/(float)(j1 - j0);
+				for (uint32_t i = i0; i <= i1; ++i)
+				{
+					const uint32_t index = GetMapIndex(i, j);
+					if (!gridHeightSet.IsBitSet(index) && !pointsToProbe.IsBitSet(index))
+					{
+						const float frac0 = (float)(i - i0)/(float)(i1 - i0);
+						const float height = (GetHeight(corner00) * (1.0 - frac0) + GetHeight(corner10) * frac0) * (1.0 - frac1)
+											+ (GetHeight(corner01) * (1.0 - frac0) + GetHeight(corner11) * frac0) * frac1;
+						SetGridHeight(index, height);
+						++numInterpolated;
+					}
+				}
+			}
+		}
+	}
+	return numInterpolated;
+}
+
+// Extrapolate missing points to ensure consistency, then recalculate the data that we derive from the heights
 void HeightMap::ExtrapolateMissing() noexcept
+{
+	FillMissingFromPlane();
+#if SUPPORT_BICUBIC_MESH
+	if (useBicubic)
+	{
+		CalculateSlopes();
+	}
+#endif
+}
+
+// Fill in the points that were not probed using a plane fitted to the points that were
+void HeightMap::FillMissingFromPlane() noexcept
 {
 	//1: calculating the bed plane by least squares fit
 	//2: filling in missing points
@@ -626,7 +1166,7 @@ void HeightMap::ExtrapolateMissing() noexcept
 			{
 				const float fAxis0 = (def.spacings[0] * iAxis0) + def.mins[0];
 				const float fAxis1 = (def.spacings[1] * iAxis1) + def.mins[1];
-				const float fZ = gridHeights[index];
+				const float fZ = GetHeight(index);
 
 				n++;
 				sumAxis0 += fAxis0; sumAxis1 += fAxis1; sumZ += fZ;
@@ -650,7 +1190,7 @@ void HeightMap::ExtrapolateMissing() noexcept
 			{
 				const float fAxis0 = (def.spacings[0] * iAxis0) + def.mins[0];
 				const float fAxis1 = (def.spacings[1] * iAxis1) + def.mins[1];
-				const float fZ = gridHeights[index];
+				const float fZ = GetHeight(index);
 
 				const float rAxis0 = fAxis0 - centAxis0;
 				const float rAxis1 = fAxis1 - centAxis1;
@@ -694,7 +1234,7 @@ void HeightMap::ExtrapolateMissing() noexcept
 				const float fAxis0 = (def.spacings[0] * iAxis0) + def.mins[0];
 				const float fAxis1 = (def.spacings[1] * iAxis1) + def.mins[1];
 				const float fZ = (d - (a * fAxis0 + b * fAxis1)) * invC;
-				gridHeights[index] = fZ;	// fill in Z but don't mark it as set so we can always differentiate between measured and extrapolated
+				gridHeights[index] = ToFixed(fZ);	// fill in Z but don't mark it as set so we can always differentiate between measured and extrapolated
 			}
 		}
 	}
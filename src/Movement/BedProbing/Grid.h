@@ -79,6 +79,7 @@ public:
 	float GetInterpolatedHeightError(float axis0, float axis1) const noexcept;			// Compute the interpolated height error at the specified point
 	void ClearGridHeights() noexcept;													// Clear all grid height corrections
 	void SetGridHeight(size_t axis0Index, size_t axis1Index, float height) noexcept;	// Set the height of a grid point
+	bool IsHeightSet(size_t axis0Index, size_t axis1Index) const noexcept { return gridHeightSet.IsBitSet(GetMapIndex(axis0Index, axis1Index)); }
 
 #if HAS_MASS_STORAGE || HAS_SBC_INTERFACE
 	bool SaveToFile(FileStore *f, const char *fname, float zOffset) noexcept	// Save the grid to file returning true if an error occurred
@@ -88,30 +89,64 @@ public:
 	const char *GetFileName() const noexcept { return fileName.c_str(); }
 #endif
 
-	unsigned int GetMinimumSegments(float deltaAxis0, float deltaAxis1) const noexcept;	// Return the minimum number of segments for a move by this X or Y amount
+	unsigned int GetMinimumSegments(float startAxis0, float startAxis1, float deltaAxis0, float deltaAxis1) const noexcept;	// Return the minimum number of segments for a move from this point by this X or Y amount
 
 	bool UseHeightMap(bool b) noexcept;
 	bool UsingHeightMap() const noexcept { return useMap; }
 
+#if SUPPORT_BICUBIC_MESH
+	void UseBicubicInterpolation(bool b) noexcept;
+	bool UsingBicubicInterpolation() const noexcept { return useBicubic; }
+#endif
+
 	unsigned int GetStatistics(Deviation& deviation, float& minError, float& maxError) const noexcept;
 																	// Return number of points probed, mean and RMS deviation, min and max error
-	void ExtrapolateMissing() noexcept;								// Extrapolate missing points to ensure consistency
+	void ExtrapolateMissing() noexcept;								// Extrapolate missing points to ensure consistency and recalculate any derived data
+
+	static bool IsCoarsePoint(uint32_t index, uint32_t numPoints, uint32_t stride) noexcept
+		{ return index % stride == 0 || index + 1 == numPoints; }	// Return true if a point is probed in the first pass of adaptive probing
+	unsigned int RefineAdaptive(uint32_t stride, float tolerance, LargeBitmap<MaxGridProbePoints>& pointsToProbe, unsigned int& numToProbe) noexcept;
+																	// Choose the points to probe in the second pass of adaptive probing and interpolate the others
 
 private:
 	static const char * const HeightMapComment;						// The start of the comment we write at the start of the height map file
+	static constexpr float HeightUnit = 0.001;						// The heights are stored as multiples of 1 micron
+	static constexpr float RecipHeightUnit = 1.0/HeightUnit;
 
 	GridDefinition def;
-	float gridHeights[MaxGridProbePoints];							// The Z coordinates of the points on the bed that were probed
+	int16_t gridHeights[MaxGridProbePoints];						// The Z coordinates of the points on the bed that were probed, in microns
 	LargeBitmap<MaxGridProbePoints> gridHeightSet;					// Bitmap of which heights are set
 #if HAS_MASS_STORAGE || HAS_SBC_INTERFACE
 	String<MaxFilenameLength> fileName;								// The name of the file that this height map was loaded from or saved to
 #endif
 	bool useMap;													// True to do bed compensation
+#if SUPPORT_BICUBIC_MESH
+	bool useBicubic;												// True to use bicubic instead of bilinear interpolation
+	int16_t gridSlopes[MaxGridProbePoints][3];						// The height derivatives w.r.t. axis 0 index, axis 1 index and both at each grid point, in microns
+	float recipMaxSegmentLength;									// The reciprocal of the longest move segment that keeps the bicubic surface within tolerance
+#endif
 
 	uint32_t GetMapIndex(uint32_t axis0Index, uint32_t axis1Index) const noexcept { return (axis1Index * def.NumAxisPoints(0)) + axis0Index; }
 	void SetGridHeight(size_t index, float height) noexcept;							// Set the height of a grid point
+	float GetHeight(uint32_t index) const noexcept { return (float)gridHeights[index] * HeightUnit; }
+	static int16_t ToFixed(float height) noexcept;										// Convert a height or slope in mm to microns, clamping it to the range of int16_t
+
+#if HAS_MASS_STORAGE || HAS_SBC_INTERFACE
+	bool SaveToBinaryFile(FileStore *f, float zOffset) noexcept;
+	bool LoadFromBinaryFile(FileStore *f, const StringRef& r) noexcept;
+#endif
 
 	float InterpolateAxis0Axis1(uint32_t axis0Index, uint32_t axis1Index, float axis0Frac, float axis1Frac) const noexcept;
+	void FillMissingFromPlane() noexcept;
+
+	float GetCoarseCurvature(size_t axis, uint32_t axis0Index, uint32_t axis1Index, uint32_t stride) const noexcept;
+	unsigned int GetReducedBilinearSegments(float startAxis0, float startAxis1, float deltaAxis0, float deltaAxis1, unsigned int gridLineSegments) const noexcept;
+	bool CoarseCellNeedsRefining(uint32_t i0, uint32_t i1, uint32_t j0, uint32_t j1, uint32_t stride, float tolerance) const noexcept;
+
+#if SUPPORT_BICUBIC_MESH
+	void CalculateSlopes() noexcept;
+	float InterpolateBicubic(uint32_t axis0Index, uint32_t axis1Index, float axis0Frac, float axis1Frac) const noexcept;
+#endif
 };
 
 #endif /* SRC_MOVEMENT_GRID_H_ */
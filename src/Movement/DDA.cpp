@@ -154,8 +154,16 @@ DDA::DDA(DDA* n) noexcept : next(n), prev(nullptr), state(empty)
 	}
 
 	flags.all = 0;						// in particular we need to set endCoordinatesValid and usePressureAdvance to false, also checkEndstops false for the ATE build
+#if SUPPORT_MOVE_LOG
+	logFlags = logShapingPlan = 0;
+	logPrepareClocks = 0;
+#endif
 	virtualExtruderPosition = 0.0;
 	filePos = noFilePosition;
+#if SUPPORT_JOB_ACCOUNTING
+	objectNumber = -1;
+	layerNumber = 0;
+#endif
 
 #if SUPPORT_LASER || SUPPORT_IOBITS
 	laserPwmOrIoBits.Clear();
@@ -307,6 +315,10 @@ bool DDA::InitStandardMove(DDARing& ring, const RawMove &nextMove, bool doMotorM
 	}
 
 	flags.all = 0;														// set all flags false
+#if SUPPORT_MOVE_LOG
+	logFlags = logShapingPlan = 0;
+	logPrepareClocks = 0;
+#endif
 
 	// 1. Compute the new endpoints and the movement vector
 	const Move& move = reprap.GetMove();
@@ -327,6 +339,7 @@ bool DDA::InitStandardMove(DDARing& ring, const RawMove &nextMove, bool doMotorM
 	bool extrudersMoving = false;
 	bool forwardExtruding = false;
 	float accelerations[MaxAxesPlusExtruders];
+	float localSteps = 0.0;												// the total number of steps that local drivers will take, for the step rate limit
 
 	for (size_t drive = 0; drive < MaxAxesPlusExtruders; drive++)
 	{
@@ -383,6 +396,10 @@ bool DDA::InitStandardMove(DDARing& ring, const RawMove &nextMove, bool doMotorM
 				stepsRequested[drive] += labs(delta);
 			}
 #endif
+			if (delta != 0)
+			{
+				localSteps += (float)labs(delta) * (float)Bitmap<uint32_t>(reprap.GetPlatform().GetDriversBitmap(drive)).CountSetBits();
+			}
 		}
 		else if (LogicalDriveToExtruder(drive) < reprap.GetGCodes().GetNumExtruders())
 		{
@@ -393,6 +410,7 @@ bool DDA::InitStandardMove(DDARing& ring, const RawMove &nextMove, bool doMotorM
 			if (movement != 0.0)
 			{
 				extrudersMoving = true;
+				localSteps += fabsf(movement) * reprap.GetPlatform().DriveStepsPerUnit(drive) * (float)Bitmap<uint32_t>(reprap.GetPlatform().GetDriversBitmap(drive)).CountSetBits();
 				if (movement > 0.0)
 				{
 					forwardExtruding = true;
@@ -432,6 +450,10 @@ bool DDA::InitStandardMove(DDARing& ring, const RawMove &nextMove, bool doMotorM
 	tool = nextMove.tool;
 	flags.checkEndstops = nextMove.checkEndstops;
 	filePos = nextMove.filePos;
+#if SUPPORT_JOB_ACCOUNTING
+	objectNumber = nextMove.objectNumber;
+	layerNumber = nextMove.layerNumber;
+#endif
 	virtualExtruderPosition = nextMove.virtualExtruderPosition;
 	proportionDone = nextMove.proportionDone;
 	initialUserC0 = nextMove.initialUserC0;
@@ -535,6 +557,18 @@ bool DDA::InitStandardMove(DDARing& ring, const RawMove &nextMove, bool doMotorM
 		k.LimitSpeedAndAcceleration(*this, normalisedDirectionVector, numVisibleAxes, flags.continuousRotationShortcut);	// give the kinematics the chance to further restrict the speed and acceleration
 	}
 
+	// Limit the speed so that the total step rate of the local drivers doesn't exceed what the step ISR can generate without hiccups.
+	// Drivers on expansion boards don't count because those boards generate their own steps.
+	const float maxStepsPerClock = move.GetMaxStepsPerClock();
+	if (maxStepsPerClock > 0.0 && localSteps * requestedSpeed > maxStepsPerClock * totalDistance)
+	{
+		requestedSpeed = max<float>((maxStepsPerClock * totalDistance)/localSteps, reprap.GetPlatform().MinMovementSpeed());
+		reprap.GetMove().RecordStepRateLimitedMove();
+#if SUPPORT_MOVE_LOG
+		logFlags |= MoveLogRecord::FlagStepRateLimited;
+#endif
+	}
+
 	// 7. Calculate the provisional accelerate and decelerate distances and the top speed
 	endSpeed = 0.0;							// until the next move asks us to adjust it
 
@@ -588,10 +622,18 @@ bool DDA::InitLeadscrewMove(DDARing& ring, float feedrate, const float adjustmen
 
 	// 3. Store some values
 	flags.all = 0;
+#if SUPPORT_MOVE_LOG
+	logFlags = logShapingPlan = 0;
+	logPrepareClocks = 0;
+#endif
 	flags.isLeadscrewAdjustmentMove = true;
 	virtualExtruderPosition = prev->virtualExtruderPosition;
 	tool = nullptr;
 	filePos = prev->filePos;
+#if SUPPORT_JOB_ACCOUNTING
+	objectNumber = -1;
+	layerNumber = prev->layerNumber;
+#endif
 	flags.endCoordinatesValid = prev->flags.endCoordinatesValid;
 	acceleration = deceleration = reprap.GetPlatform().NormalAcceleration(Z_AXIS);
 
@@ -659,6 +701,10 @@ bool DDA::InitAsyncMove(DDARing& ring, const AsyncMove& nextMove) noexcept
 
 	// 3. Store some values
 	flags.all = 0;
+#if SUPPORT_MOVE_LOG
+	logFlags = logShapingPlan = 0;
+	logPrepareClocks = 0;
+#endif
 	virtualExtruderPosition = 0;
 	tool = nullptr;
 	filePos = noFilePosition;
@@ -697,6 +743,10 @@ bool DDA::InitFromRemote(const CanMessageMovementLinear& msg) noexcept
 	afterPrepare.moveStartTime = StepTimer::ConvertToLocalTime(msg.whenToExecute);
 	clocksNeeded = msg.accelerationClocks + msg.steadyClocks + msg.decelClocks;
 	flags.all = 0;
+#if SUPPORT_MOVE_LOG
+	logFlags = logShapingPlan = 0;
+	logPrepareClocks = 0;
+#endif
 	flags.isRemote = true;
 # if !USE_REMOTE_INPUT_SHAPING
 	flags.isPrintingMove = (msg.pressureAdvanceDrives != 0);
@@ -1224,10 +1274,58 @@ void DDA::RecalculateMove(DDARing& ring) noexcept
 // Decide what speed we would really like this move to end at.
 // On entry, targetNextSpeed is the speed we would like the next move after this one to start at and this one to end at
 // On return, targetNextSpeed is the actual speed we can achieve without exceeding the jerk limits.
+// If a junction deviation has been configured and both moves include linear axis motion, the speed change of the linear axes is limited by
+// the junction deviation instead of by their jerk limits, so that shallow corners can be taken faster than sharp ones.
 void DDA::MatchSpeeds() noexcept
 {
+#if SUPPORT_MOVE_LOG
+	logFlags &= ~(MoveLogRecord::FlagEndLimitedByJerk | MoveLogRecord::FlagEndLimitedByJunction);	// this may be called more than once during lookahead
+#endif
+	AxesBitmap junctionLimitedAxes;
+	const float junctionDeviation = reprap.GetMove().GetJunctionDeviation();
+	if (junctionDeviation > 0.0)
+	{
+		const AxesBitmap linearAxes = reprap.GetPlatform().GetLinearAxes();
+		float dotProduct = 0.0, thisMagSquared = 0.0, nextMagSquared = 0.0;
+		const float * const thisDv = directionVector;
+		const float * const nextDv = next->directionVector;
+		linearAxes.Iterate([&dotProduct, &thisMagSquared, &nextMagSquared, thisDv, nextDv](unsigned int axis, unsigned int count) noexcept
+							{
+								dotProduct += thisDv[axis] * nextDv[axis];
+								thisMagSquared += fsquare(thisDv[axis]);
+								nextMagSquared += fsquare(nextDv[axis]);
+							}
+						  );
+
+		// The direction vectors are unit-normalised in the linear axes when there is any linear motion, so if both moves have linear motion then the
+		// dot product is the cosine of the angle between them
+		if (thisMagSquared > 0.5 && nextMagSquared > 0.5)
+		{
+			if (dotProduct < 0.999999)
+			{
+				// Limit the speed to the speed at which a circular arc tangential to both moves, and whose closest point to the corner is the junction deviation away from it,
+				// could be followed at the lower of the deceleration of this move and the acceleration of the next
+				const float sinHalfTheta = fastSqrtf(max<float>(0.5 * (1.0 + dotProduct), 0.0));
+				const float junctionSpeed = fastSqrtf(min<float>(deceleration, next->acceleration) * junctionDeviation * sinHalfTheta/(1.0 - sinHalfTheta));
+				if (junctionSpeed < beforePrepare.targetNextSpeed)
+				{
+					beforePrepare.targetNextSpeed = junctionSpeed;
+#if SUPPORT_MOVE_LOG
+					logFlags |= MoveLogRecord::FlagEndLimitedByJunction;
+#endif
+				}
+			}
+			junctionLimitedAxes = linearAxes;
+		}
+	}
+
 	for (size_t drive = 0; drive < MaxAxesPlusExtruders; ++drive)
 	{
+		if (drive < MaxAxes && junctionLimitedAxes.IsBitSet(drive))
+		{
+			continue;						// this axis has been limited by the junction deviation
+		}
+
 		if (directionVector[drive] != 0.0 || next->directionVector[drive] != 0.0)
 		{
 			const float totalFraction = fabsf(directionVector[drive] - next->directionVector[drive]);
@@ -1236,6 +1334,9 @@ void DDA::MatchSpeeds() noexcept
 			if (jerk > allowedJerk)
 			{
 				beforePrepare.targetNextSpeed = allowedJerk/totalFraction;
+#if SUPPORT_MOVE_LOG
+				logFlags |= MoveLogRecord::FlagEndLimitedByJerk;
+#endif
 			}
 		}
 	}
@@ -1267,6 +1368,25 @@ bool DDA::FetchEndPosition(volatile int32_t ep[MaxAxesPlusExtruders], volatile f
 	return flags.endCoordinatesValid;
 }
 
+#if SUPPORT_JOB_ACCOUNTING
+
+// Return the total forward extrusion of this move. For an extruder, endCoordinates holds the amount of movement.
+float DDA::GetForwardExtrusion() const noexcept
+{
+	float extrusion = 0.0;
+	if (!flags.isLeadscrewAdjustmentMove)					// leadscrew adjustment moves copy the extrusion amounts from the previous move
+	{
+		const size_t numExtruders = reprap.GetGCodes().GetNumExtruders();
+		for (size_t extruder = 0; extruder < numExtruders; ++extruder)
+		{
+			extrusion += max<float>(endCoordinates[ExtruderToLogicalDrive(extruder)], 0.0);
+		}
+	}
+	return extrusion;
+}
+
+#endif
+
 // This may be called from an ISR, e.g. via Kinematics::OnHomingSwitchTriggered
 void DDA::SetPositions(const float move[MaxAxesPlusExtruders]) noexcept
 {
@@ -1312,6 +1432,12 @@ void DDA::EnsureUnshapedSegments(const PrepParams& params) noexcept
 // This must not be called with interrupts disabled, because it calls Platform::EnableDrive.
 void DDA::Prepare(SimulationMode simMode) noexcept
 {
+#if SUPPORT_PREPARE_PROFILING
+	const uint32_t profileStartCycles = PrepareProfiler::GetCycles();
+	uint32_t phaseCycles[PrepareProfiler::NumPhases] = { 0 };
+	unsigned int profileFeatures = 0;
+#endif
+
 	flags.wasAccelOnlyMove = IsAccelerationMove();			// save this for the next move to look at
 
 #if SUPPORT_LASER
@@ -1328,7 +1454,7 @@ void DDA::Prepare(SimulationMode simMode) noexcept
 	PrepParams params;										// the default constructor clears params.plan to 'no shaping'
 	if (flags.xyMoving)
 	{
-		reprap.GetMove().GetAxisShaper().PlanShaping(*this, params, flags.xyMoving);	// this will set up shapedSegments if we are doing any shaping
+		reprap.GetMove().GetAxisShaperForMove(directionVector).PlanShaping(*this, params, flags.xyMoving);	// this will set up shapedSegments if we are doing any shaping
 	}
 	else
 	{
@@ -1337,10 +1463,17 @@ void DDA::Prepare(SimulationMode simMode) noexcept
 		clocksNeeded = params.unshaped.TotalClocks();
 	}
 
+#if SUPPORT_PREPARE_PROFILING
+	phaseCycles[(size_t)PrepareProfiler::Phase::shaping] = PrepareProfiler::GetCycles() - profileStartCycles;
+#endif
+
 	// Copy the unshaped acceleration and deceleration back to the DDA because ManageLaserPower uses them
 	//TODO change ManageLaserPower to work on the shaped segments instead
 	acceleration = params.unshaped.acceleration;
 	deceleration = params.unshaped.deceleration;
+#if SUPPORT_MOVE_LOG
+	logShapingPlan = (uint8_t)params.shapingPlan.all;
+#endif
 
 	if (simMode < SimulationMode::normal)
 	{
@@ -1368,8 +1501,10 @@ void DDA::Prepare(SimulationMode simMode) noexcept
 		CanMotion::StartMovement();
 #endif
 
-		// Handle all drivers
+		// Handle all drivers. The kinematics and the number of axes don't change while we do this, so fetch them once rather than for every drive.
 		Platform& platform = reprap.GetPlatform();
+		const Kinematics& kin = reprap.GetMove().GetKinematics();
+		const size_t totalAxes = reprap.GetGCodes().GetTotalAxes();
 		if (flags.isLeadscrewAdjustmentMove)
 		{
 			platform.EnableDrivers(Z_AXIS, false);			// ensure all Z motors are enabled
@@ -1381,6 +1516,9 @@ void DDA::Prepare(SimulationMode simMode) noexcept
 #endif
 		for (size_t drive = 0; drive < MaxAxesPlusExtruders; ++drive)
 		{
+#if SUPPORT_PREPARE_PROFILING
+			const uint32_t driveStartCycles = PrepareProfiler::GetCycles();
+#endif
 			if (flags.isLeadscrewAdjustmentMove)
 			{
 #if SUPPORT_CAN_EXPANSION
@@ -1427,7 +1565,7 @@ void DDA::Prepare(SimulationMode simMode) noexcept
 				}
 			}
 #if SUPPORT_LINEAR_DELTA
-			else if (flags.isDeltaMovement && reprap.GetMove().GetKinematics().GetMotionType(drive) == MotionType::segmentFreeDelta)
+			else if (flags.isDeltaMovement && kin.GetMotionType(drive) == MotionType::segmentFreeDelta)
 			{
 				// On a delta we need to move all towers even if some of them have no net movement
 				platform.EnableDrivers(drive, false);
@@ -1479,7 +1617,7 @@ void DDA::Prepare(SimulationMode simMode) noexcept
 				axisMotorsEnabled.SetBit(drive);
 			}
 #endif
-			else if (drive < reprap.GetGCodes().GetTotalAxes())
+			else if (drive < totalAxes)
 			{
 				// It's a linear axis
 				int32_t delta = endPoint[drive] - prev->endPoint[drive];
@@ -1490,7 +1628,7 @@ void DDA::Prepare(SimulationMode simMode) noexcept
 					{
 						EnsureUnshapedSegments(params);
 					}
-					if (flags.continuousRotationShortcut && reprap.GetMove().GetKinematics().IsContinuousRotationAxis(drive))
+					if (flags.continuousRotationShortcut && kin.IsContinuousRotationAxis(drive))
 					{
 						// This is a continuous rotation axis, so we may have adjusted the move to cross the 180 degrees position
 						const int32_t stepsPerRotation = lrintf(360.0 * platform.DriveStepsPerUnit(drive));
@@ -1544,7 +1682,7 @@ void DDA::Prepare(SimulationMode simMode) noexcept
 					}
 #endif
 					axisMotorsEnabled.SetBit(drive);
-					additionalAxisMotorsToEnable |= reprap.GetMove().GetKinematics().GetConnectedAxes(drive);
+					additionalAxisMotorsToEnable |= kin.GetConnectedAxes(drive);
 				}
 			}
 			else
@@ -1617,6 +1755,10 @@ void DDA::Prepare(SimulationMode simMode) noexcept
 					}
 				}
 			}
+#if SUPPORT_PREPARE_PROFILING
+			phaseCycles[(size_t)((flags.isLeadscrewAdjustmentMove || drive < totalAxes) ? PrepareProfiler::Phase::axes : PrepareProfiler::Phase::extruders)]
+				+= PrepareProfiler::GetCycles() - driveStartCycles;
+#endif
 		}
 
 		// On CoreXY and similar architectures, we also need to enable the motors controlling any connected axes
@@ -1643,7 +1785,17 @@ void DDA::Prepare(SimulationMode simMode) noexcept
 		}
 
 #if SUPPORT_CAN_EXPANSION
+# if SUPPORT_PREPARE_PROFILING
+		const uint32_t canStartCycles = PrepareProfiler::GetCycles();
+# endif
 		const uint32_t canClocksNeeded = CanMotion::FinishMovement(*this, afterPrepare.moveStartTime, simMode != SimulationMode::off);
+# if SUPPORT_PREPARE_PROFILING
+		phaseCycles[(size_t)PrepareProfiler::Phase::canFinish] = PrepareProfiler::GetCycles() - canStartCycles;
+		if (canClocksNeeded != 0)
+		{
+			profileFeatures |= PrepareProfiler::FeatureRemoteDrivers;
+		}
+# endif
 		if (canClocksNeeded > clocksNeeded)
 		{
 			// Due to rounding error in the calculations, we quite often calculate the CAN move as being longer than our previously-calculated value, normally by just one clock.
@@ -1673,6 +1825,27 @@ void DDA::Prepare(SimulationMode simMode) noexcept
 #endif
 	}
 
+#if SUPPORT_PREPARE_PROFILING
+	if (simMode < SimulationMode::normal)					// if we are simulating then we didn't prepare the drives, so don't record it
+	{
+		if (shapedSegments != nullptr)
+		{
+			profileFeatures |= PrepareProfiler::FeatureShaped;
+		}
+		if (flags.usePressureAdvance)
+		{
+			profileFeatures |= PrepareProfiler::FeaturePressureAdvance;
+		}
+# if SUPPORT_LINEAR_DELTA
+		if (flags.isDeltaMovement)
+		{
+			profileFeatures |= PrepareProfiler::FeatureDelta;
+		}
+# endif
+		reprap.GetMove().GetPrepareProfiler().Record(phaseCycles, PrepareProfiler::GetCycles() - profileStartCycles, clocksNeeded, profileFeatures);
+	}
+#endif
+
 	if (state != completed)
 	{
 		state = frozen;					// must do this last so that the ISR doesn't start executing it before we have finished setting it up
@@ -2012,10 +2185,29 @@ uint32_t maxDelay;
 uint32_t maxDelayIncrease;
 #endif
 
+#if SUPPORT_STEP_ISR_PROFILING
+
+// Return the kind of segment that a DM is executing, for the step ISR profiler
+static inline StepIsrProfiler::SegmentKind GetProfiledSegmentKind(DMState st) noexcept
+{
+	return (st >= DMState::deltaNormal) ? StepIsrProfiler::SegmentKind::delta
+			: (st == DMState::cartLinear) ? StepIsrProfiler::SegmentKind::linear
+				: StepIsrProfiler::SegmentKind::nonlinear;
+}
+
+#endif
+
 // Generate the step pulses of internal drivers used by this DDA
 // Sets the status to 'completed' if the move is complete and the next move should be started
 void DDA::StepDrivers(Platform& p, uint32_t now) noexcept
 {
+#if SUPPORT_STEP_ISR_PROFILING
+	const uint32_t profileStartCycles = StepIsrProfiler::GetCycles();
+	unsigned int numDmsStepping = 0;
+	StepIsrProfiler::SegmentKind profiledKind = StepIsrProfiler::SegmentKind::linear;
+	uint32_t calcCycles = 0;
+#endif
+
 	// Check endstop switches and Z probe if asked. This is not speed critical because fast moves do not use endstops or the Z probe.
 	if (flags.checkEndstops)		// if any homing switches or the Z probe is enabled in this move
 	{
@@ -2046,6 +2238,14 @@ void DDA::StepDrivers(Platform& p, uint32_t now) noexcept
 		driversStepping |= p.GetDriversBitmap(dm->drive);
 #if 0	// debug only
 		++stepsDone[dm->drive];
+#endif
+#if SUPPORT_STEP_ISR_PROFILING
+		++numDmsStepping;
+		const StepIsrProfiler::SegmentKind kind = GetProfiledSegmentKind(dm->state);
+		if (kind > profiledKind)
+		{
+			profiledKind = kind;
+		}
 #endif
 		dm = dm->nextDM;
 	}
@@ -2072,10 +2272,13 @@ void DDA::StepDrivers(Platform& p, uint32_t now) noexcept
 	}
 
 	// Calculate the next step times. We must do this even if no local drivers are stepping in case endstops or Z probes are active.
-	for (DriveMovement *dm2 = activeDMs; dm2 != dm; dm2 = dm2->nextDM)
-	{
-		(void)dm2->CalcNextStepTime(*this);							// calculate next step times
-	}
+#if SUPPORT_STEP_ISR_PROFILING
+	const uint32_t calcStartCycles = StepIsrProfiler::GetCycles();
+#endif
+	DriveMovement::CalcNextStepTimes(*this, activeDMs, dm);		// calculate next step times
+#if SUPPORT_STEP_ISR_PROFILING
+	calcCycles = StepIsrProfiler::GetCycles() - calcStartCycles;
+#endif
 #else
 # if SUPPORT_SLOW_DRIVERS											// if supporting slow drivers
 	if ((driversStepping & p.GetSlowDriversBitmap()) != 0)			// if using some slow drivers
@@ -2090,10 +2293,13 @@ void DDA::StepDrivers(Platform& p, uint32_t now) noexcept
 		StepPins::StepDriversHigh(driversStepping);					// step drivers high
 		lastStepPulseTime = StepTimer::GetTimerTicks();
 
-		for (DriveMovement *dm2 = activeDMs; dm2 != dm; dm2 = dm2->nextDM)
-		{
-			(void)dm2->CalcNextStepTime(*this);						// calculate next step times
-		}
+# if SUPPORT_STEP_ISR_PROFILING
+		const uint32_t calcStartCycles = StepIsrProfiler::GetCycles();
+# endif
+		DriveMovement::CalcNextStepTimes(*this, activeDMs, dm);		// calculate next step times
+# if SUPPORT_STEP_ISR_PROFILING
+		calcCycles = StepIsrProfiler::GetCycles() - calcStartCycles;
+# endif
 
 		while (StepTimer::GetTimerTicks() - lastStepPulseTime < p.GetSlowDriverStepHighClocks()) {}
 		StepPins::StepDriversLow(driversStepping);					// step drivers low
@@ -2106,10 +2312,13 @@ void DDA::StepDrivers(Platform& p, uint32_t now) noexcept
 # if SAME70
 		__DSB();													// without this the step pulse can be far too short
 # endif
-		for (DriveMovement *dm2 = activeDMs; dm2 != dm; dm2 = dm2->nextDM)
-		{
-			(void)dm2->CalcNextStepTime(*this);						// calculate next step times
-		}
+# if SUPPORT_STEP_ISR_PROFILING
+		const uint32_t calcStartCycles = StepIsrProfiler::GetCycles();
+# endif
+		DriveMovement::CalcNextStepTimes(*this, activeDMs, dm);		// calculate next step times
+# if SUPPORT_STEP_ISR_PROFILING
+		calcCycles = StepIsrProfiler::GetCycles() - calcStartCycles;
+# endif
 
 		StepPins::StepDriversLow(driversStepping);					// step drivers low
 	}
@@ -2151,6 +2360,10 @@ void DDA::StepDrivers(Platform& p, uint32_t now) noexcept
 			state = completed;
 		}
 	}
+
+#if SUPPORT_STEP_ISR_PROFILING
+	reprap.GetMove().GetStepIsrProfiler().Record(numDmsStepping, profiledKind, StepIsrProfiler::GetCycles() - profileStartCycles, calcCycles);
+#endif
 }
 
 // Simulate stepping the drivers, for debugging.
@@ -2175,10 +2388,7 @@ void DDA::SimulateSteppingDrivers(Platform& p) noexcept
 		lastStepTime = dueTime;
 		checkTiming = true;
 
-		for (DriveMovement *dm2 = activeDMs; dm2 != dm; dm2 = dm2->nextDM)
-		{
-			(void)dm2->CalcNextStepTime(*this);							// calculate next step times
-		}
+		DriveMovement::CalcNextStepTimes(*this, activeDMs, dm);		// calculate next step times
 
 		// Remove those drives from the list, update the direction pins where necessary, and re-insert them so as to keep the list in step-time order.
 		DriveMovement *dmToInsert = activeDMs;							// head of the chain we need to re-insert
@@ -2211,6 +2421,102 @@ void DDA::SimulateSteppingDrivers(Platform& p) noexcept
 	}
 }
 
+#if SUPPORT_MOVE_LOG
+
+// Record the planned parameters of this move. Called from the step ISR when the move has completed.
+void DDA::FillMoveLogRecord(MoveLogRecord& rec) const noexcept
+{
+	rec.startTime = afterPrepare.moveStartTime;
+	rec.clocksNeeded = clocksNeeded;
+	rec.prepareClocks = logPrepareClocks;
+	rec.filePos = filePos;
+	rec.totalDistance = totalDistance;
+	rec.requestedSpeed = requestedSpeed;
+	rec.startSpeed = startSpeed;
+	rec.topSpeed = topSpeed;
+	rec.endSpeed = endSpeed;
+	rec.acceleration = acceleration;
+	rec.deceleration = deceleration;
+	rec.shapingPlan = logShapingPlan;
+	uint8_t recFlags = logFlags;
+	if (flags.isPrintingMove) { recFlags |= MoveLogRecord::FlagPrintingMove; }
+	if (flags.hadLookaheadUnderrun) { recFlags |= MoveLogRecord::FlagLookaheadUnderrun; }
+	if (flags.checkEndstops) { recFlags |= MoveLogRecord::FlagCheckingEndstops; }
+	if (topSpeed < requestedSpeed) { recFlags |= MoveLogRecord::FlagTopSpeedNotReached; }
+	rec.flags = recFlags;
+	rec.spare = 0;
+}
+
+#endif
+
+#if SUPPORT_MOTION_BENCHMARK
+
+// Generate all the steps of this move without moving the motors, and record how long it took in the benchmark. Called by the Move task when simulating in debug mode.
+// For the axis drives of an unshaped move (which step in proportion to the distance moved, unless this is a delta) we also compare the time of each step
+// with the exact time calculated in double precision from the trapezoidal speed profile. The speeds are in mm per step clock, so the times are in step clocks.
+void DDA::BenchmarkSteps(MotionBenchmark& benchmark) noexcept
+{
+	const double u = startSpeed, v = topSpeed, w = endSpeed;
+	const double decelStartDistance = (double)totalDistance - (v * v - w * w)/(2.0 * deceleration);
+	const double accelDistance = min<double>((v * v - u * u)/(2.0 * acceleration), decelStartDistance);
+	const double accelClocks = (v - u)/acceleration;
+	const double decelStartClocks = accelClocks + max<double>(decelStartDistance - accelDistance, 0.0)/v;
+	const bool checkTimes = (shapedSegments == nullptr);
+
+	uint32_t numSteps = 0, numChecked = 0, cycles = 0;
+	double sumSquaredError = 0.0;
+	float maxError = 0.0;
+	while (activeDMs != nullptr)
+	{
+		const uint32_t dueTime = activeDMs->nextStepTime;
+		DriveMovement *dm = activeDMs;
+		while (dm != nullptr && dueTime >= dm->nextStepTime)			// for each drive that is due to step
+		{
+			++numSteps;
+			if (checkTimes && !dm->isDelta && !dm->isExtruder)
+			{
+				const double s = (double)dm->nextStep * dm->mp.cart.effectiveMmPerStep;
+				const double exactTime = (s <= accelDistance) ? (sqrt(u * u + 2.0 * acceleration * s) - u)/acceleration
+										: (s <= decelStartDistance) ? accelClocks + (s - accelDistance)/v
+											: decelStartClocks + (v - sqrt(max<double>(v * v - 2.0 * deceleration * (s - decelStartDistance), 0.0)))/deceleration;
+				const double error = (double)dm->nextStepTime - exactTime;
+				sumSquaredError += error * error;
+				maxError = max<float>(maxError, fabs(error));
+				++numChecked;
+			}
+			dm = dm->nextDM;
+		}
+
+		const uint32_t startCycles = MotionBenchmark::GetCycles();
+		DriveMovement::CalcNextStepTimes(*this, activeDMs, dm);		// calculate next step times
+		cycles += MotionBenchmark::GetCycles() - startCycles;
+
+		// Remove those drives from the list and re-insert them so as to keep the list in step-time order
+		DriveMovement *dmToInsert = activeDMs;
+		activeDMs = dm;
+		while (dmToInsert != dm)
+		{
+			DriveMovement * const nextToInsert = dmToInsert->nextDM;
+			if (dmToInsert->state >= DMState::firstMotionState)
+			{
+				InsertDM(dmToInsert);
+				dmToInsert->directionChanged = false;
+			}
+			else
+			{
+				dmToInsert->nextDM = completedDMs;
+				completedDMs = dmToInsert;
+			}
+			dmToInsert = nextToInsert;
+		}
+	}
+
+	benchmark.RecordSteps(numSteps, cycles, numChecked, sumSquaredError, maxError, filePos);
+	state = completed;
+}
+
+#endif
+
 // Stop a drive and re-calculate the corresponding endpoint.
 // For extruder drivers, we need to be able to calculate how much of the extrusion was completed after calling this.
 void DDA::StopDrive(size_t drive) noexcept
@@ -2257,6 +2563,25 @@ void DDA::MoveAborted() noexcept
 	state = completed;
 }
 
+// Return the forward extrusion speed averaged over the whole move in mm/sec. This is the same speed that we pass to Tool::ApplyFeedForward when the move starts.
+float DDA::GetForwardExtrusionSpeed() const noexcept
+{
+	if (clocksNeeded == 0)
+	{
+		return 0.0;
+	}
+
+	float extrusionFraction = 0.0;
+	for (size_t drive = reprap.GetGCodes().GetTotalAxes(); drive < MaxAxesPlusExtruders; ++drive)
+	{
+		if (directionVector[drive] > 0.0)
+		{
+			extrusionFraction += directionVector[drive];
+		}
+	}
+	return (extrusionFraction * totalDistance * (float)StepClockRate)/(float)clocksNeeded;
+}
+
 // Return the proportion of the complete multi-segment move that has already been done.
 // The move was either not started or was aborted.
 float DDA::GetProportionDone(bool moveWasAborted) const noexcept
@@ -2387,28 +2712,39 @@ void DDA::UpdateMovementAccumulators(volatile int32_t *accumulators) const noexc
 // Manage the laser power. Return the number of ticks until we should be called again, or 0 to be called at the start of the next move.
 uint32_t DDA::ManageLaserPower() const noexcept
 {
-	Platform& platform = reprap.GetPlatform();
+	constexpr uint32_t LaserPwmIntervalClocks = (LaserPwmIntervalMillis * StepClockRate)/1000;
+	Pwm_t pwm;
+	const uint32_t clocksToNextUpdate = CalcLaserPwm(StepTimer::GetTimerTicks() - afterPrepare.moveStartTime, LaserPwmIntervalClocks, pwm);
+	reprap.GetPlatform().SetLaserPwm(pwm);
+	return (clocksToNextUpdate == 0) ? 0
+			: (clocksToNextUpdate <= LaserPwmIntervalClocks) ? LaserPwmIntervalMillis
+				: lrintf((float)clocksToNextUpdate * StepClocksToMillis) + LaserPwmIntervalMillis;
+}
+
+// Calculate the laser PWM for the point that the move has reached after clocksMoving step clocks, reducing it in proportion to the speed during acceleration and deceleration.
+// Return the number of step clocks until it should be recalculated, or 0 if it doesn't need to be recalculated until the next move.
+// updateInterval is how often to recalculate it during acceleration and deceleration.
+uint32_t DDA::CalcLaserPwm(uint32_t clocksMoving, uint32_t updateInterval, Pwm_t& pwm) const noexcept
+{
 	if (!flags.controlLaser || laserPwmOrIoBits.laserPwm == 0)
 	{
-		platform.SetLaserPwm(0);
+		pwm = 0;
 		return 0;
 	}
 
-	const uint32_t clocksMoving = StepTimer::GetTimerTicks() - afterPrepare.moveStartTime;
 	if (clocksMoving >= clocksNeeded)			// this also covers the case of now < startTime
 	{
 		// Something has gone wrong with the timing. Set zero laser power, but try again soon.
-		platform.SetLaserPwm(0);
-		return LaserPwmIntervalMillis;
+		pwm = 0;
+		return updateInterval;
 	}
 
 	const float accelSpeed = startSpeed + acceleration * clocksMoving;
 	if (accelSpeed < topSpeed)
 	{
 		// Acceleration phase
-		const Pwm_t pwm = (Pwm_t)((accelSpeed/topSpeed) * laserPwmOrIoBits.laserPwm);
-		platform.SetLaserPwm(pwm);
-		return LaserPwmIntervalMillis;
+		pwm = (Pwm_t)((accelSpeed/topSpeed) * laserPwmOrIoBits.laserPwm);
+		return updateInterval;
 	}
 
 	const uint32_t clocksLeft = clocksNeeded - clocksMoving;
@@ -2416,20 +2752,14 @@ uint32_t DDA::ManageLaserPower() const noexcept
 	if (decelSpeed < topSpeed)
 	{
 		// Deceleration phase
-		const Pwm_t pwm = (Pwm_t)((decelSpeed/topSpeed) * laserPwmOrIoBits.laserPwm);
-		platform.SetLaserPwm(pwm);
-		return LaserPwmIntervalMillis;
+		pwm = (Pwm_t)((decelSpeed/topSpeed) * laserPwmOrIoBits.laserPwm);
+		return updateInterval;
 	}
 
-	// We must be in the constant speed phase
-	platform.SetLaserPwm(laserPwmOrIoBits.laserPwm);
+	// We must be in the constant speed phase, so we don't need to recalculate the power until deceleration starts
+	pwm = laserPwmOrIoBits.laserPwm;
 	const uint32_t decelClocks = (topSpeed - endSpeed)/deceleration;
-	if (clocksLeft <= decelClocks)
-	{
-		return LaserPwmIntervalMillis;
-	}
-	const uint32_t clocksToDecel = clocksLeft - decelClocks;
-	return lrintf((float)clocksToDecel * StepClocksToMillis) + LaserPwmIntervalMillis;
+	return (clocksLeft <= decelClocks + updateInterval) ? updateInterval : clocksLeft - decelClocks;
 }
 
 #endif
@@ -13,6 +13,8 @@
 #include "StepTimer.h"
 #include "MoveSegment.h"
 #include "InputShaperPlan.h"
+#include "MotionBenchmark.h"
+#include "MoveLog.h"
 #include <Platform/Tasks.h>
 #include <GCodes/GCodes.h>			// for class RawMove
 
@@ -46,6 +48,12 @@ struct PrepParams
 	PrepParamSet shaped;								// only valid if the shaping plan is not empty
 	InputShaperPlan shapingPlan;
 
+	// Pressure advance distances for one value of K, calculated by the first extruder that uses that K so that the other extruders of a mixing tool don't repeat the calculation
+	float paKclocks = 0.0;								// the K that the following are for, or 0 if they haven't been calculated
+	float paExtraExtrusionDistance;
+	float paForwardDistance;
+	float paReverseDistance;
+
 #if SUPPORT_CAN_EXPANSION
 	// Parameters used by CAN expansion
 	float initialSpeedFraction, finalSpeedFraction;
@@ -101,7 +109,15 @@ public:
 	void Start(Platform& p, uint32_t tim) noexcept SPEED_CRITICAL;					// Start executing the DDA, i.e. move the move.
 	void StepDrivers(Platform& p, uint32_t now) noexcept SPEED_CRITICAL;			// Take one step of the DDA, called by timer interrupt.
 	void SimulateSteppingDrivers(Platform& p) noexcept;								// For debugging use
+#if SUPPORT_MOTION_BENCHMARK
+	void BenchmarkSteps(MotionBenchmark& benchmark) noexcept;						// Generate all the steps without moving the motors, checking their timing
+#endif
+#if SUPPORT_MOVE_LOG
+	void FillMoveLogRecord(MoveLogRecord& rec) const noexcept;						// Record the planned parameters of this move when it has completed
+	void SetPrepareClocks(uint32_t clocks) noexcept { logPrepareClocks = clocks; }
+#endif
 	bool ScheduleNextStepInterrupt(StepTimer& timer) const noexcept SPEED_CRITICAL;	// Schedule the next interrupt, returning true if we can't because it is already due
+	bool IsNextStepDueWithin(uint32_t now, uint32_t interval, uint32_t& whenDue) const noexcept SPEED_CRITICAL;	// Return true if the next step is due within 'interval' clocks of 'now'
 
 	void SetNext(DDA *n) noexcept { next = n; }
 	void SetPrevious(DDA *p) noexcept { prev = p; }
@@ -149,7 +165,14 @@ public:
 	float GetVirtualExtruderPosition() const noexcept { return virtualExtruderPosition; }
 	float AdvanceBabyStepping(DDARing& ring, size_t axis, float amount) noexcept;	// Try to push babystepping earlier in the move queue
 	const Tool *GetTool() const noexcept { return tool; }
+#if SUPPORT_JOB_ACCOUNTING
+	int GetObjectNumber() const noexcept { return objectNumber; }
+	unsigned int GetLayerNumber() const noexcept { return layerNumber; }
+	float GetForwardExtrusion() const noexcept;									// Return the total forward extrusion of this move
+	uint32_t GetRequestedClocks() const noexcept { return (requestedSpeed > 0.0) ? (uint32_t)(totalDistance/requestedSpeed) : clocksNeeded; }	// Return how long this move would take at the requested speed
+#endif
 	float GetTotalDistance() const noexcept { return totalDistance; }
+	float GetForwardExtrusionSpeed() const noexcept;								// Return the forward extrusion speed averaged over the whole move in mm/sec
 	void LimitSpeedAndAcceleration(float maxSpeed, float maxAcceleration) noexcept;	// Limit the speed an acceleration of this move
 
 	// Filament monitor support
@@ -173,10 +196,14 @@ public:
 
 #if SUPPORT_LASER
 	uint32_t ManageLaserPower() const noexcept;										// Manage the laser power
+	uint32_t CalcLaserPwm(uint32_t clocksMoving, uint32_t updateInterval, Pwm_t& pwm) const noexcept;	// Calculate the laser power at a point in the move
 #endif
 
-#if SUPPORT_IOBITS
+#if SUPPORT_LASER || SUPPORT_IOBITS
 	uint32_t GetMoveStartTime() const noexcept { return afterPrepare.moveStartTime; }
+#endif
+
+#if SUPPORT_IOBITS
 	IoBits_t GetIoBits() const noexcept { return laserPwmOrIoBits.ioBits; }
 #endif
 
@@ -218,6 +245,7 @@ public:
 	static constexpr uint32_t MaxStepInterruptTime = 10 * StepTimer::MinInterruptInterval;	// the maximum time we spend looping in the ISR , in step clocks
 	static constexpr uint32_t WakeupTime = (100 * StepClockRate)/1000000;					// stop resting 100us before the move is due to end
 	static constexpr uint32_t HiccupIncrement = HiccupTime/2;								// how much we increase the hiccup time by on each attempt
+	static constexpr uint32_t MaxStepBurstTime = (50 * StepClockRate)/1000000;				// the maximum time we wait in the ISR for steps that are due in burst mode
 
 	static constexpr uint32_t UsualMinimumPreparedTime = StepClockRate/10;					// 100ms
 	static constexpr uint32_t AbsoluteMinimumPreparedTime = StepClockRate/20;				// 50ms
@@ -304,6 +332,11 @@ private:
 
 	const Tool *tool;								// which tool (if any) is active
 
+#if SUPPORT_JOB_ACCOUNTING
+	int16_t objectNumber;							// the build plate object that this move is part of, or -1 if none
+	uint16_t layerNumber;							// the layer that was being printed when this move was read
+#endif
+
     FilePosition filePos;							// The position in the SD card file after this move was read, or zero if not read from SD card
 
 	int32_t endPoint[MaxAxesPlusExtruders];  		// Machine coordinates of the endpoint
@@ -359,6 +392,12 @@ private:
 	DriveMovement* completedDMs;					// list of associated DMs that don't need any more steps
 	MoveSegment* shapedSegments;					// linked list of move segments used by axis DMs
 	MoveSegment* unshapedSegments;					// linked list of move segments used by extruder DMs
+
+#if SUPPORT_MOVE_LOG
+	uint32_t logPrepareClocks;						// how long Prepare took
+	uint8_t logShapingPlan;							// the low bits of the input shaping plan that Prepare used
+	uint8_t logFlags;								// MoveLogRecord flags set during lookahead
+#endif
 };
 
 // Find the DriveMovement record for a given drive even if it is completed, or return nullptr if there isn't one
@@ -429,6 +468,18 @@ inline __attribute__((always_inline)) bool DDA::ScheduleNextStepInterrupt(StepTi
 	return false;
 }
 
+// Return true if this move is executing and its next step is due within 'interval' step clocks of 'now', in which case set whenDue to when it is due
+// Base priority must be >= NvicPriorityStep when calling this
+inline __attribute__((always_inline)) bool DDA::IsNextStepDueWithin(uint32_t now, uint32_t interval, uint32_t& whenDue) const noexcept
+{
+	if (state == executing && activeDMs != nullptr)
+	{
+		whenDue = activeDMs->nextStepTime + afterPrepare.moveStartTime;
+		return (int32_t)(whenDue - now) < (int32_t)interval;
+	}
+	return false;
+}
+
 // Return true if there is no reason to delay preparing this move
 inline bool DDA::IsGoodToPrepare() const noexcept
 {
@@ -11,12 +11,23 @@
 #include <Platform/Tasks.h>
 #include <GCodes/GCodeBuffer/GCodeBuffer.h>
 #include <Tools/Tool.h>
+#include <PrintMonitor/PrintMonitor.h>
+#include <Platform/EventTrace.h>
+#include <Platform/Metrics.h>
 
 #if SUPPORT_CAN_EXPANSION
 # include "CAN/CanMotion.h"
 #endif
 
 constexpr uint32_t MoveStartPollInterval = 10;					// delay in milliseconds between checking whether we should start moves
+constexpr uint32_t DefaultMaxStepsPerBurst = 4;					// default maximum number of steps we generate in one step interrupt in burst mode
+constexpr uint32_t MaxMaxStepsPerBurst = 16;					// the most steps we allow in one burst
+constexpr uint32_t DefaultTargetPreparedTime = DDA::UsualMinimumPreparedTime;
+constexpr uint32_t MaxTargetPreparedTimeMillis = 1000;			// the most execution time that M595 T lets us prepare ahead
+constexpr uint32_t MaxAdaptivePreparedTimeFactor = 4;			// the adaptive prepared time can rise to this multiple of the target
+constexpr float MoveRateAveragingFactor = 1.0/16;				// weighting of the latest move when tracking the rate at which moves are added
+constexpr ptrdiff_t DynamicRingRamFraction = 4;				// when sizing the ring from free RAM, use at most this fraction of the RAM that has never been used
+constexpr size_t RamPerExtraDda = sizeof(DDA) + 8 + 2 * (sizeof(DriveMovement) + 8);	// RAM needed for each additional DDA and its share of DMs, allowing 8 bytes of overhead per allocation
 
 // Object model table and functions
 // Note: if using GCC version 7.3.1 20180622 and lambda functions are used in this table, you must compile this file with option -std=gnu++17.
@@ -30,21 +41,45 @@ constexpr ObjectModelTableEntry DDARing::objectModelTable[] =
 {
 	// DDARing each group, these entries must be in alphabetical order
 	// 0. DDARing members
-	{ "gracePeriod",			OBJECT_MODEL_FUNC(self->gracePeriod * MillisToSeconds, 3),			ObjectModelEntryFlags::none },
-	{ "length",					OBJECT_MODEL_FUNC((int32_t)self->numDdasInRing), 					ObjectModelEntryFlags::none },
+	{ "avgMoveTime",			OBJECT_MODEL_FUNC(self->averageMoveClocks * (1.0/StepClockRate), 4),											ObjectModelEntryFlags::live },
+	{ "gracePeriod",			OBJECT_MODEL_FUNC(self->gracePeriod * MillisToSeconds, 3),														ObjectModelEntryFlags::none },
+	{ "length",					OBJECT_MODEL_FUNC((int32_t)self->numDdasInRing), 																ObjectModelEntryFlags::none },
+	{ "moveRate",				OBJECT_MODEL_FUNC((self->averageMoveInterval > 0.0) ? (float)StepClockRate/self->averageMoveInterval : 0.0, 1),	ObjectModelEntryFlags::live },
+	{ "prepareTime",			OBJECT_MODEL_FUNC((float)self->adaptivePreparedTime * (1.0/StepClockRate), 3),									ObjectModelEntryFlags::live },
+	{ "prepareTimeTarget",		OBJECT_MODEL_FUNC((float)self->targetPreparedTime * (1.0/StepClockRate), 3),									ObjectModelEntryFlags::none },
 };
 
-constexpr uint8_t DDARing::objectModelTableDescriptor[] = { 1, 2 };
+constexpr uint8_t DDARing::objectModelTableDescriptor[] = { 1, 6 };
 
 DEFINE_GET_OBJECT_MODEL_TABLE(DDARing)
 
-DDARing::DDARing() noexcept : gracePeriod(DefaultGracePeriod), scheduledMoves(0), completedMoves(0), numHiccups(0)
+DDARing::DDARing() noexcept : gracePeriod(DefaultGracePeriod), burstStepInterval(0), maxStepsPerBurst(DefaultMaxStepsPerBurst),
+								scheduledMoves(0), completedMoves(0), numHiccups(0), numBurstSteps(0), minFullRingHorizon(UINT32_MAX),
+								targetPreparedTime(DefaultTargetPreparedTime), adaptivePreparedTime(DefaultTargetPreparedTime),
+								lastMoveAddedTime(0), averageMoveInterval(0.0), averageMoveClocks(0.0), hadPrepareUnderrun(false),
+#if SUPPORT_CAN_EXPANSION
+								canMotionHeldUpPrepare(false),
+#endif
+								nextHiccupRecord(0), numHiccupRecords(0)
+#if SUPPORT_LASER
+								, laserSynchronised(false)
+#endif
 {
 }
 
 // This can be called in the constructor for class Move
-void DDARing::Init1(unsigned int numDdas) noexcept
+// If maxNumDdas is greater than numDdas then we make the ring longer, up to maxNumDdas, if we can do so using no more than a fraction of the free RAM
+void DDARing::Init1(unsigned int numDdas, unsigned int maxNumDdas) noexcept
 {
+	if (maxNumDdas > numDdas)
+	{
+		const ptrdiff_t extraDdas = (Tasks::GetNeverUsedRam()/DynamicRingRamFraction)/(ptrdiff_t)RamPerExtraDda;
+		if (extraDdas > 0)
+		{
+			numDdas = min<unsigned int>(numDdas + (unsigned int)extraDdas, maxNumDdas);
+		}
+	}
+
 	numDdasInRing = numDdas;
 
 	// Build the DDA ring
@@ -63,6 +98,9 @@ void DDARing::Init1(unsigned int numDdas) noexcept
 	currentDda = nullptr;
 
 	timer.SetCallback(DDARing::TimerCallback, CallbackParameter(this));
+#if SUPPORT_LASER
+	laserTimer.SetCallback(DDARing::LaserTimerCallback, CallbackParameter(this));
+#endif
 }
 
 // This must be called from Move::Init, not from the Move constructor, because it indirectly refers to the GCodes module which must therefore be initialised first
@@ -119,6 +157,30 @@ GCodeResult DDARing::ConfigureMovementQueue(GCodeBuffer& gb, const StringRef& re
 	gb.TryGetUIValue('P', numDdasWanted, seen);
 	gb.TryGetUIValue('S', numDMsWanted, seen);
 	gb.TryGetUIValue('R', gracePeriod, seen);
+	uint32_t preparedTimeMillis;
+	if (gb.TryGetLimitedUIValue('T', preparedTimeMillis, seen, MaxTargetPreparedTimeMillis + 1))
+	{
+		targetPreparedTime = adaptivePreparedTime = max<uint32_t>(preparedTimeMillis * (StepClockRate/1000), DDA::AbsoluteMinimumPreparedTime);
+	}
+	if (numDdasWanted > numDdasInRing && numDMsWanted == 0)
+	{
+		numDMsWanted = NumDmsForRingLength(numDdasWanted);		// if the number of DMs wasn't specified, allocate enough for the new ring length
+	}
+
+	// Burst mode: B is the step rate in steps/sec above which we generate several steps per interrupt (0 = disabled), N is the maximum number of steps per interrupt
+	bool seenBurst = false;
+	uint32_t burstStepRate = (burstStepInterval == 0) ? 0 : StepClockRate/burstStepInterval;
+	gb.TryGetUIValue('B', burstStepRate, seenBurst);
+	if (gb.Seen('N'))
+	{
+		maxStepsPerBurst = gb.GetLimitedUIValue('N', 1, MaxMaxStepsPerBurst + 1);
+		seenBurst = true;
+	}
+	if (seenBurst)
+	{
+		burstStepInterval = (burstStepRate == 0 || maxStepsPerBurst <= 1) ? 0 : StepClockRate/burstStepRate;
+	}
+
 	if (seen)
 	{
 		if (!reprap.GetGCodes().LockMovementAndWaitForStandstill(gb))
@@ -162,9 +224,18 @@ GCodeResult DDARing::ConfigureMovementQueue(GCodeBuffer& gb, const StringRef& re
 		}
 		reprap.MoveUpdated();
 	}
-	else
+	else if (!seenBurst)
 	{
-		reply.printf("DDAs %u, DMs %u, GracePeriod %" PRIu32, numDdasInRing, DriveMovement::NumCreated(), gracePeriod);
+		reply.printf("DDAs %u, DMs %u, GracePeriod %" PRIu32 ", prepare time target %" PRIu32 "ms (currently %" PRIu32 "ms)",
+						numDdasInRing, DriveMovement::NumCreated(), gracePeriod, targetPreparedTime/(StepClockRate/1000), adaptivePreparedTime/(StepClockRate/1000));
+		if (burstStepInterval == 0)
+		{
+			reply.cat(", burst mode disabled");
+		}
+		else
+		{
+			reply.catf(", burst mode above %" PRIu32 " steps/sec with up to %" PRIu32 " steps per interrupt", StepClockRate/burstStepInterval, maxStepsPerBurst);
+		}
 	}
 	return GCodeResult::ok;
 }
@@ -182,13 +253,23 @@ void DDARing::RecycleDDAs() noexcept
 				checkPointer->DebugPrintAll("rd");
 			}
 			++stepErrors;
+			Metrics::Increment(Metrics::Counter::stepErrors);
 			reprap.GetPlatform().LogError(ErrorCode::BadMove);
 		}
 
+#if SUPPORT_JOB_ACCOUNTING
+		if (checkPointer->GetFilePosition() != noFilePosition)
+		{
+			reprap.GetPrintMonitor().GetJobAccounting().RecordMove(checkPointer->GetObjectNumber(), checkPointer->GetLayerNumber(), checkPointer->GetClocksNeeded(),
+																	checkPointer->GetRequestedClocks(), checkPointer->GetForwardExtrusion());
+		}
+#endif
+
 		// Now release the DMs and check for underrun
 		if (checkPointer->Free())
 		{
 			++numLookaheadUnderruns;
+			Metrics::Increment(Metrics::Counter::lookaheadUnderruns);
 		}
 		checkPointer = checkPointer->GetNext();
 	}
@@ -226,6 +307,15 @@ bool DDARing::AddStandardMove(const RawMove &nextMove, bool doMotorMapping) noex
 {
 	if (addPointer->InitStandardMove(*this, nextMove, doMotorMapping))
 	{
+		// Track how fast moves are being supplied and how long they are
+		const uint32_t now = StepTimer::GetTimerTicks();
+		if (scheduledMoves != 0)
+		{
+			averageMoveInterval += ((float)(now - lastMoveAddedTime) - averageMoveInterval) * MoveRateAveragingFactor;
+		}
+		lastMoveAddedTime = now;
+		averageMoveClocks += ((float)addPointer->GetClocksNeeded() - averageMoveClocks) * MoveRateAveragingFactor;
+
 		addPointer = addPointer->GetNext();
 		scheduledMoves++;
 		return true;
@@ -265,11 +355,26 @@ bool DDARing::AddAsyncMove(const AsyncMove& nextMove) noexcept
 // Return the maximum time in milliseconds that should elapse before we prepare further unprepared moves that are already in the ring, or TaskBase::TimeoutUnlimited if there are no unprepared moves left.
 uint32_t DDARing::Spin(SimulationMode simulationMode, bool waitingForSpace, bool shouldStartMove) noexcept
 {
+	if (waitingForSpace && simulationMode == SimulationMode::off)
+	{
+		// The ring is full, so record how far ahead it lets us plan
+		unsigned int numMoves;
+		const uint32_t horizon = GetLookaheadHorizon(numMoves);
+		if (horizon < minFullRingHorizon)
+		{
+			minFullRingHorizon = horizon;
+		}
+	}
+
 	DDA *cdda = currentDda;											// capture volatile variable
 
 	// If we are simulating, simulate completion of the current move.
-	// Do this here rather than at the end, so that when simulating, currentDda is non-null for most of the time and IsExtruding() returns the correct value
-	if (simulationMode != SimulationMode::off && cdda != nullptr)
+	// Do this here rather than at the end, so that when simulating, currentDda is non-null for most of the time and IsExtruding() returns the correct value.
+	// When printing for real, GCodes normally keeps the ring full, so the lookahead sees as many moves as the ring holds. So only complete a simulated move
+	// when the ring is full or GCodes has stopped supplying moves. Otherwise we would drain the ring while GCodes was starved of CPU time by this
+	// higher priority task, making the lookahead decelerate at the end of each batch of moves and giving longer times than a real print.
+	const bool simulateCompletion = simulationMode != SimulationMode::off && cdda != nullptr && (waitingForSpace || shouldStartMove || waitingForRingToEmpty);
+	if (simulateCompletion)
 	{
 		simulationTime += (float)cdda->GetClocksNeeded() * (1.0/StepClockRate);
 		if (simulationMode == SimulationMode::debug && reprap.Debug(moduleDda))
@@ -279,6 +384,12 @@ uint32_t DDARing::Spin(SimulationMode simulationMode, bool waitingForSpace, bool
 				cdda->SimulateSteppingDrivers(reprap.GetPlatform());
 			} while (cdda->GetState() != DDA::completed);
 		}
+#if SUPPORT_MOTION_BENCHMARK
+		else if (simulationMode == SimulationMode::debug)
+		{
+			cdda->BenchmarkSteps(reprap.GetMove().GetMotionBenchmark());
+		}
+#endif
 		else
 		{
 			cdda->Complete();
@@ -320,7 +431,8 @@ uint32_t DDARing::Spin(SimulationMode simulationMode, bool waitingForSpace, bool
 		uint32_t ret = PrepareMoves(cdda, preparedTime, preparedCount, simulationMode);
 		if (simulationMode >= SimulationMode::normal)
 		{
-			return 0;
+			// If we completed a simulated move then we want to be called again straight away. Otherwise wait for GCodes to give us another move.
+			return (simulateCompletion) ? 0 : MoveStartPollInterval;
 		}
 
 		if (waitingForSpace)
@@ -386,7 +498,11 @@ uint32_t DDARing::Spin(SimulationMode simulationMode, bool waitingForSpace, bool
 			{
 				Move::WakeLaserTask();
 			}
+# if SUPPORT_LASER
+			else if (!laserSynchronised)
+# else
 			else
+# endif
 			{
 				p.SetLaserPwm(0);
 			}
@@ -406,10 +522,22 @@ uint32_t DDARing::Spin(SimulationMode simulationMode, bool waitingForSpace, bool
 // Return the maximum time in milliseconds that should elapse before we prepare further unprepared moves that are already in the ring, or TaskBase::TimeoutUnlimited if there are no unprepared moves left.
 uint32_t DDARing::PrepareMoves(DDA *firstUnpreparedMove, int32_t moveTimeLeft, unsigned int alreadyPrepared, SimulationMode simulationMode) noexcept
 {
-	// If the number of prepared moves will execute in less than the minimum time, prepare another move.
+	// If we ran out of prepared moves when there were unprepared moves in the ring, we weren't preparing far enough ahead, so increase the prepared time we aim for.
+	// Otherwise let it decay back towards the configured target, so that we freeze moves as late as possible and give the lookahead the best chance.
+	if (hadPrepareUnderrun)
+	{
+		hadPrepareUnderrun = false;
+		adaptivePreparedTime = min<uint32_t>(adaptivePreparedTime + adaptivePreparedTime/4, targetPreparedTime * MaxAdaptivePreparedTimeFactor);
+	}
+	else if (adaptivePreparedTime > targetPreparedTime)
+	{
+		adaptivePreparedTime -= (adaptivePreparedTime - targetPreparedTime)/64 + 1;
+	}
+
+	// If the number of prepared moves will execute in less than the target time, prepare another move.
 	// Try to avoid preparing deceleration-only moves too early
 	while (	  firstUnpreparedMove->GetState() == DDA::provisional
-		   && moveTimeLeft < (int32_t)DDA::UsualMinimumPreparedTime		// prepare moves one tenth of a second ahead of when they will be needed
+		   && moveTimeLeft < (int32_t)adaptivePreparedTime				// prepare moves that far ahead of when they will be needed
 		   && alreadyPrepared * 2 < numDdasInRing						// but don't prepare more than half the ring, to handle accelerate/decelerate moves in small segments
 		   && (firstUnpreparedMove->IsGoodToPrepare() || moveTimeLeft < (int32_t)DDA::AbsoluteMinimumPreparedTime)
 #if SUPPORT_CAN_EXPANSION
@@ -417,12 +545,38 @@ uint32_t DDARing::PrepareMoves(DDA *firstUnpreparedMove, int32_t moveTimeLeft, u
 #endif
 		  )
 	{
+#if SUPPORT_EVENT_TRACE
+		const uint32_t startTicks = StepTimer::GetTimerTicks();
+#endif
+#if SUPPORT_MOTION_BENCHMARK
+		const uint32_t benchmarkStartCycles = MotionBenchmark::GetCycles();
+#endif
+#if SUPPORT_MOVE_LOG
+		const uint32_t prepareStartTicks = StepTimer::GetTimerTicks();
+#endif
 		firstUnpreparedMove->Prepare(simulationMode);
+#if SUPPORT_MOVE_LOG
+		firstUnpreparedMove->SetPrepareClocks(StepTimer::GetTimerTicks() - prepareStartTicks);
+#endif
+#if SUPPORT_MOTION_BENCHMARK
+		if (simulationMode == SimulationMode::debug)
+		{
+			reprap.GetMove().GetMotionBenchmark().RecordPrepare(MotionBenchmark::GetCycles() - benchmarkStartCycles, firstUnpreparedMove->GetFilePosition());
+		}
+#endif
+#if SUPPORT_EVENT_TRACE
+		EventTrace::Record(EventTrace::EventId::movePrepare, StepTimer::GetTimerTicks() - startTicks, firstUnpreparedMove->GetClocksNeeded());
+#endif
 		moveTimeLeft += firstUnpreparedMove->GetTimeLeft();
 		++alreadyPrepared;
 		firstUnpreparedMove = firstUnpreparedMove->GetNext();
 	}
 
+#if SUPPORT_CAN_EXPANSION
+	// Remember whether it was CAN that stopped us preparing the next move, so that we can report it if there is a hiccup
+	canMotionHeldUpPrepare = firstUnpreparedMove->GetState() == DDA::provisional && moveTimeLeft < (int32_t)adaptivePreparedTime && !CanMotion::CanPrepareMove();
+#endif
+
 	// Decide how soon we want to be called again to prepare further moves
 	if (firstUnpreparedMove->GetState() == DDA::provisional)
 	{
@@ -432,7 +586,7 @@ uint32_t DDARing::PrepareMoves(DDA *firstUnpreparedMove, int32_t moveTimeLeft, u
 			return 1;
 		}
 
-		const int32_t clocksTillWakeup = moveTimeLeft - (int32_t)DDA::UsualMinimumPreparedTime;						// calculate how long before we run out of prepared moves, less the usual advance prepare time
+		const int32_t clocksTillWakeup = moveTimeLeft - (int32_t)adaptivePreparedTime;								// calculate how long before we run out of prepared moves, less the advance prepare time
 		return (clocksTillWakeup <= 0) ? 2 : min<uint32_t>((uint32_t)clocksTillWakeup/(StepClockRate/1000), 2);		// wake up at that time, but delay for at least 2 ticks
 	}
 
@@ -440,6 +594,96 @@ uint32_t DDARing::PrepareMoves(DDA *firstUnpreparedMove, int32_t moveTimeLeft, u
 	return TaskBase::TimeoutUnlimited;
 }
 
+// Return the estimated time in step clocks to execute the moves in the ring that have not been completed, and the number of those moves.
+// This is called without locking out the step interrupt, so the result is approximate.
+uint32_t DDARing::GetLookaheadHorizon(unsigned int& numMoves) const noexcept
+{
+	uint32_t horizon = 0;
+	numMoves = 0;
+	for (const DDA *dda = getPointer; dda != addPointer; dda = dda->GetNext())
+	{
+		const DDA::DDAState st = dda->GetState();
+		if (st == DDA::provisional)
+		{
+			horizon += dda->GetClocksNeeded();
+		}
+		else if (st == DDA::frozen || st == DDA::executing)
+		{
+			horizon += (uint32_t)max<int32_t>(dda->GetTimeLeft(), 0);
+		}
+		else
+		{
+			continue;
+		}
+		++numMoves;
+	}
+	return horizon;
+}
+
+// Return the average extrusion feedforward PWM that the tools of the moves in the ring will apply to the specified heater between windowStart and windowEnd
+// step clocks from now. Time for which there are no moves in the ring counts as no extrusion. This is called by the heater task without locking the ring,
+// so the result is only an estimate.
+float DDARing::GetExtrusionFeedForwardAhead(int heater, uint32_t windowStart, uint32_t windowEnd) const noexcept
+{
+	if (windowEnd <= windowStart)
+	{
+		windowEnd = windowStart + 1;
+	}
+
+	uint32_t moveStart = 0;
+	float total = 0.0;
+	for (const DDA *dda = getPointer; dda != addPointer && moveStart < windowEnd; dda = dda->GetNext())
+	{
+		const DDA::DDAState st = dda->GetState();
+		uint32_t duration;
+		if (st == DDA::provisional)
+		{
+			duration = dda->GetClocksNeeded();
+		}
+		else if (st == DDA::frozen || st == DDA::executing)
+		{
+			duration = (uint32_t)max<int32_t>(dda->GetTimeLeft(), 0);
+		}
+		else
+		{
+			continue;
+		}
+
+		const uint32_t moveEnd = moveStart + duration;
+		if (moveEnd > windowStart)
+		{
+			const Tool * const tool = dda->GetTool();
+			if (tool != nullptr)
+			{
+				const uint32_t overlap = min<uint32_t>(moveEnd, windowEnd) - max<uint32_t>(moveStart, windowStart);
+				total += tool->GetHeaterFeedForward(heater) * dda->GetForwardExtrusionSpeed() * (float)overlap;
+			}
+		}
+		moveStart = moveEnd;
+	}
+	return total/(float)(windowEnd - windowStart);
+}
+
+// Return the estimated time in step clocks to complete the moves that are executing or waiting in the queue.
+// Like GetExtrusionFeedForwardAhead this is called from other tasks, so the result is only an estimate if the Move task changes the queue meanwhile.
+uint32_t DDARing::GetQueuedMoveTime() const noexcept
+{
+	uint32_t total = 0;
+	for (const DDA *dda = getPointer; dda != addPointer; dda = dda->GetNext())
+	{
+		const DDA::DDAState st = dda->GetState();
+		if (st == DDA::provisional)
+		{
+			total += dda->GetClocksNeeded();
+		}
+		else if (st == DDA::frozen || st == DDA::executing)
+		{
+			total += (uint32_t)max<int32_t>(dda->GetTimeLeft(), 0);
+		}
+	}
+	return total;
+}
+
 // Return true if this DDA ring is idle
 bool DDARing::IsIdle() const noexcept
 {
@@ -461,6 +705,9 @@ void DDARing::Interrupt(Platform& p) noexcept
 	{
 		uint32_t now = StepTimer::GetTimerTicks();
 		const uint32_t isrStartTime = now;
+		const uint32_t isrLateTicks = now - timer.GetWhenDue();
+		uint32_t stepsThisInterrupt = 1;
+		bool startedNewMove = false;
 		for (;;)
 		{
 			// Generate a step for the current move
@@ -479,6 +726,23 @@ void DDARing::Interrupt(Platform& p) noexcept
 				{
 					break;
 				}
+				startedNewMove = true;
+			}
+
+			// In burst mode, if the next step is due very soon then wait for it here instead of taking another interrupt.
+			// We poll the step timer, so the step spacing is still governed by the timer.
+			if (burstStepInterval != 0 && stepsThisInterrupt < maxStepsPerBurst)
+			{
+				now = StepTimer::GetTimerTicks();
+				uint32_t whenDue;
+				if (cdda->IsNextStepDueWithin(now, burstStepInterval, whenDue) && whenDue - isrStartTime < DDA::MaxStepBurstTime)
+				{
+					while ((int32_t)(StepTimer::GetTimerTicks() - whenDue) < 0) { }
+					now = StepTimer::GetTimerTicks();
+					++stepsThisInterrupt;
+					++numBurstSteps;
+					continue;
+				}
 			}
 
 			// Schedule a callback at the time when the next step is due, and quit unless it is due immediately
@@ -494,6 +758,8 @@ void DDARing::Interrupt(Platform& p) noexcept
 			{
 				// Force a break by updating the move start time.
 				++numHiccups;
+				Metrics::Increment(Metrics::Counter::hiccups);
+				RecordHiccup(cdda, isrLateTicks, startedNewMove);
 #if SUPPORT_CAN_EXPANSION
 				uint32_t cumulativeHiccupTime = 0;
 #endif
@@ -520,6 +786,29 @@ void DDARing::Interrupt(Platform& p) noexcept
 	}
 }
 
+// Record the probable cause of a hiccup. Called by the ISR.
+void DDARing::RecordHiccup(const DDA *cdda, uint32_t isrLateTicks, bool startedNewMove) noexcept
+{
+	HiccupRecord& rec = hiccupLog[nextHiccupRecord];
+	rec.whenMillis = millis();
+	rec.filePos = cdda->GetFilePosition();
+	rec.isrLateTicks = ((int32_t)isrLateTicks < 0) ? 0 : isrLateTicks;
+	rec.cause = (rec.isrLateTicks >= DDA::MaxStepInterruptTime/2) ? HiccupCause::isrLate
+				: (startedNewMove) ? HiccupCause::newMove
+					: HiccupCause::stepCalcOverrun;
+	rec.afterPrepareUnderrun = hadPrepareUnderrun;
+#if SUPPORT_CAN_EXPANSION
+	rec.canNotReady = canMotionHeldUpPrepare;
+#else
+	rec.canNotReady = false;
+#endif
+	nextHiccupRecord = (nextHiccupRecord + 1) % HiccupLogEntries;
+	if (numHiccupRecords < HiccupLogEntries)
+	{
+		numHiccupRecords = numHiccupRecords + 1;
+	}
+}
+
 // DDARing timer callback function
 /*static*/ void DDARing::TimerCallback(CallbackParameter p) noexcept
 {
@@ -532,6 +821,9 @@ void DDARing::OnMoveCompleted(DDA *cdda, Platform& p) noexcept
 	// The following finish time is wrong if we aborted the move because of endstop or Z probe checks.
 	// However, following a move that checks endstops or the Z probe, we always wait for the move to complete before we schedule another, so this doesn't matter.
 	const uint32_t finishTime = cdda->GetMoveFinishTime();	// calculate when this move should finish
+#if SUPPORT_MOVE_LOG
+	reprap.GetMove().GetMoveLog().Record(*cdda);
+#endif
 	CurrentMoveCompleted();							// tell the DDA ring that the current move is complete
 
 	// Try to start a new move
@@ -552,10 +844,13 @@ void DDARing::OnMoveCompleted(DDA *cdda, Platform& p) noexcept
 		if (st == DDA::provisional)
 		{
 			++numPrepareUnderruns;					// there are more moves available, but they are not prepared yet. Signal an underrun.
+			Metrics::Increment(Metrics::Counter::prepareUnderruns);
+			hadPrepareUnderrun = true;
 		}
 		else if (!waitingForRingToEmpty)
 		{
 			++numNoMoveUnderruns;
+			Metrics::Increment(Metrics::Counter::noMoveUnderruns);
 		}
 		p.ExtrudeOff();								// turn off ancillary PWM
 		if (cdda->GetTool() != nullptr)
@@ -563,6 +858,10 @@ void DDARing::OnMoveCompleted(DDA *cdda, Platform& p) noexcept
 			cdda->GetTool()->StopFeedForward();
 		}
 #if SUPPORT_LASER
+		if (laserSynchronised)
+		{
+			laserTimer.CancelCallbackFromIsr();
+		}
 		if (reprap.GetGCodes().GetMachineType() == MachineType::laser)
 		{
 			p.SetLaserPwm(0);						// turn off the laser
@@ -962,14 +1261,111 @@ bool DDARing::LowPowerOrStallPause(RestorePoint& rp) noexcept
 
 #endif
 
+#if SUPPORT_RESUME_SNAPSHOT
+
+// Get the resume point for a periodic resume snapshot. This is the start of the move that is executing, or of the next move if none is executing.
+// Unlike LowPowerOrStallPause, the moves are not changed, and if a move is executing we resume from its start because we don't know how much of it will be done.
+// Return false if there is no move in the ring that has a file position.
+bool DDARing::GetResumePoint(RestorePoint& rp) const noexcept
+{
+	const DDA *dda;
+	{
+		AtomicCriticalSectionLocker lock;
+		dda = currentDda;
+		if (dda == nullptr)
+		{
+			dda = getPointer;
+		}
+	}
+
+	while (dda != addPointer && dda->GetFilePosition() == noFilePosition)
+	{
+		dda = dda->GetNext();
+	}
+	if (dda == addPointer)
+	{
+		return false;
+	}
+
+	rp.feedRate = dda->GetRequestedSpeedMmPerClock();
+	rp.virtualExtruderPosition = dda->GetVirtualExtruderPosition();
+	rp.filePos = dda->GetFilePosition();
+	rp.proportionDone = 0.0;
+	rp.initialUserC0 = dda->GetInitialUserC0();
+	rp.initialUserC1 = dda->GetInitialUserC1();
+#if SUPPORT_LASER || SUPPORT_IOBITS
+	rp.laserPwmOrIoBits = dda->GetLaserPwmOrIoBits();
+#endif
+
+	// The start coordinates of this move are the end coordinates of the previous one
+	DDA * const prevDda = dda->GetPrevious();
+	const size_t numVisibleAxes = reprap.GetGCodes().GetVisibleAxes();
+	for (size_t axis = 0; axis < numVisibleAxes; ++axis)
+	{
+		rp.moveCoords[axis] = prevDda->GetEndCoordinate(axis, false);
+	}
+	reprap.GetMove().InverseAxisAndBedTransform(rp.moveCoords, prevDda->GetTool());
+	return true;
+}
+
+#endif
+
 void DDARing::Diagnostics(MessageType mtype, const char *prefix) noexcept
 {
 	const DDA * const cdda = currentDda;
 	reprap.GetPlatform().MessageF(mtype,
-									"=== %sDDARing ===\nScheduled moves %" PRIu32 ", completed %" PRIu32 ", hiccups %" PRIu32 ", stepErrors %u, LaErrors %u, Underruns [%u, %u, %u], CDDA state %d\n",
-									prefix, scheduledMoves, completedMoves, numHiccups, stepErrors, numLookaheadErrors, numLookaheadUnderruns, numPrepareUnderruns, numNoMoveUnderruns,
+									"=== %sDDARing ===\nScheduled moves %" PRIu32 ", completed %" PRIu32 ", hiccups %" PRIu32 ", burst steps %" PRIu32 ", stepErrors %u, LaErrors %u, Underruns [%u, %u, %u], CDDA state %d\n",
+									prefix, scheduledMoves, completedMoves, numHiccups, numBurstSteps, stepErrors, numLookaheadErrors, numLookaheadUnderruns, numPrepareUnderruns, numNoMoveUnderruns,
 									(cdda == nullptr) ? -1 : (int)cdda->GetState());
+	unsigned int numMoves;
+	const uint32_t horizon = GetLookaheadHorizon(numMoves);
+	if (minFullRingHorizon == UINT32_MAX)
+	{
+		reprap.GetPlatform().MessageF(mtype, "Ring length %u, lookahead horizon %" PRIu32 "ms over %u moves\n", numDdasInRing, horizon/(StepClockRate/1000), numMoves);
+	}
+	else
+	{
+		reprap.GetPlatform().MessageF(mtype, "Ring length %u, lookahead horizon %" PRIu32 "ms over %u moves, min when full %" PRIu32 "ms\n",
+										numDdasInRing, horizon/(StepClockRate/1000), numMoves, minFullRingHorizon/(StepClockRate/1000));
+	}
+
+	// Report the causes of the most recent hiccups, most recent first
+	HiccupRecord recs[HiccupLogEntries];
+	size_t numRecs;
+	{
+		AtomicCriticalSectionLocker lock;
+		numRecs = numHiccupRecords;
+		for (size_t i = 0; i < numRecs; ++i)
+		{
+			recs[i] = hiccupLog[(nextHiccupRecord + HiccupLogEntries - 1 - i) % HiccupLogEntries];
+		}
+		numHiccupRecords = 0;
+	}
+
+	const uint32_t now = millis();
+	for (size_t i = 0; i < numRecs; ++i)
+	{
+		static const char *_ecv_array const causeNames[] = { "step calc overrun", "ISR late", "new move" };
+		const HiccupRecord& rec = recs[i];
+		String<StringLength50> filePosText;
+		if (rec.filePos == noFilePosition)
+		{
+			filePosText.copy("not from file");
+		}
+		else
+		{
+			filePosText.printf("file pos %" PRIu32, rec.filePos);
+		}
+		reprap.GetPlatform().MessageF(mtype, "Hiccup %.1fs ago: %s, ISR %.1fus late, %s%s%s\n",
+										(double)((now - rec.whenMillis) * 0.001), causeNames[(unsigned int)rec.cause],
+										(double)(rec.isrLateTicks * (1000000.0/(float)StepClockRate)), filePosText.c_str(),
+										(rec.afterPrepareUnderrun) ? ", after prepare underrun" : "",
+										(rec.canNotReady) ? ", CAN not ready" : "");
+	}
+
 	numHiccups = stepErrors = numLookaheadUnderruns = numPrepareUnderruns = numNoMoveUnderruns = numLookaheadErrors = 0;
+	numBurstSteps = 0;
+	minFullRingHorizon = UINT32_MAX;
 }
 
 #if SUPPORT_LASER
@@ -992,6 +1388,60 @@ uint32_t DDARing::ManageLaserPower() const noexcept
 	return 0;
 }
 
+// Select whether the laser power is set from a step timer callback, which is scheduled at the start of each move and then at intervals while the speed is changing.
+// This avoids the latency of waking up the laser task. Movement must be stopped when this is called.
+void DDARing::SetLaserSynchronised(bool b) noexcept
+{
+	if (b != laserSynchronised)
+	{
+		laserTimer.CancelCallback();
+		laserSynchronised = b;
+	}
+}
+
+// Laser timer callback function
+/*static*/ void DDARing::LaserTimerCallback(CallbackParameter p) noexcept
+{
+	DDARing * const ring = static_cast<DDARing*>(p.vp);
+	if (ring->laserTimer.ScheduleCallbackFromIsr())		// check that the callback really is due, see the comment in StepTimer.h
+	{
+		ring->ManageLaserPowerFromIsr();
+	}
+}
+
+// Schedule the first laser power update of a move at the time that the move starts. Base priority must be >= NvicPriorityStep when calling this.
+void DDARing::StartLaserTimer(const DDA *cdda) noexcept
+{
+	if (laserTimer.ScheduleCallbackFromIsr(cdda->GetMoveStartTime()))
+	{
+		ManageLaserPowerFromIsr();
+	}
+}
+
+// Set the laser power for the point that the current move has reached and schedule the next update. Base priority must be >= NvicPriorityStep when calling this.
+void DDARing::ManageLaserPowerFromIsr() noexcept
+{
+	Platform& p = reprap.GetPlatform();
+	for (;;)
+	{
+		const DDA * const cdda = currentDda;					// capture volatile variable
+		if (cdda == nullptr)
+		{
+			p.SetLaserPwm(0);
+			return;
+		}
+
+		const uint32_t now = StepTimer::GetTimerTicks();
+		Pwm_t pwm;
+		const uint32_t clocksToNextUpdate = cdda->CalcLaserPwm(now - cdda->GetMoveStartTime(), LaserPwmSyncIntervalClocks, pwm);
+		p.SetLaserPwm(pwm);
+		if (clocksToNextUpdate == 0 || !laserTimer.ScheduleCallbackFromIsr(now + clocksToNextUpdate))
+		{
+			return;
+		}
+	}
+}
+
 #endif
 
 #if SUPPORT_REMOTE_COMMANDS
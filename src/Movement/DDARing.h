@@ -17,7 +17,7 @@ class DDARing INHERIT_OBJECT_MODEL
 public:
 	DDARing() noexcept;
 
-	void Init1(unsigned int numDdas) noexcept;
+	void Init1(unsigned int numDdas, unsigned int maxNumDdas = 0) noexcept;
 	void Init2() noexcept;
 	void Exit() noexcept;
 
@@ -32,6 +32,10 @@ public:
 	uint32_t Spin(SimulationMode simulationMode, bool waitingForSpace, bool shouldStartMove) noexcept SPEED_CRITICAL;	// Try to process moves in the ring
 	bool IsIdle() const noexcept;														// Return true if this DDA ring is idle
 	uint32_t GetGracePeriod() const noexcept { return gracePeriod; }					// Return the minimum idle time, before we should start a move. Better to have a few moves in the queue so that we can do lookahead
+	unsigned int GetNumDdasInRing() const noexcept { return numDdasInRing; }
+	uint32_t GetLookaheadHorizon(unsigned int& numMoves) const noexcept;				// Return the estimated time in step clocks to execute the moves in the ring
+	float GetExtrusionFeedForwardAhead(int heater, uint32_t windowStart, uint32_t windowEnd) const noexcept;	// Return the average extrusion feedforward PWM for a heater over a future time window
+	uint32_t GetQueuedMoveTime() const noexcept;									// Return the estimated time in step clocks to execute the moves in the queue
 
 	float PushBabyStepping(size_t axis, float amount) noexcept;							// Try to push some babystepping through the lookahead queue, returning the amount pushed
 
@@ -68,15 +72,21 @@ public:
 	bool LiveCoordinates(float m[MaxAxesPlusExtruders]) noexcept;						// Fetch the last point at the end of the last completed DDA if it has changed since we last called this
 	void SetLiveCoordinates(const float coords[MaxAxesPlusExtruders]) noexcept;			// Force the live coordinates (see above) to be these
 	bool HaveLiveCoordinatesChanged() const noexcept { return liveCoordinatesChanged; }
+	void FlagLiveCoordinatesChanged() noexcept { liveCoordinatesChanged = true; }		// Make the next call to LiveCoordinates fetch them, e.g. because the transform applied to them has changed
 	void ResetExtruderPositions() noexcept;												// Resets the extrusion amounts of the live coordinates
 
 	bool PauseMoves(RestorePoint& rp, float speedFactor) noexcept;						// Pause the print as soon as we can, returning true if we were able to skip any
 #if HAS_VOLTAGE_MONITOR || HAS_STALL_DETECT
 	bool LowPowerOrStallPause(RestorePoint& rp) noexcept;								// Pause the print immediately, returning true if we were able to
 #endif
+#if SUPPORT_RESUME_SNAPSHOT
+	bool GetResumePoint(RestorePoint& rp) const noexcept;								// Get the point that we would resume from if power failed now, without pausing
+#endif
 
 #if SUPPORT_LASER
 	uint32_t ManageLaserPower() const noexcept;											// Manage the laser power
+	void SetLaserSynchronised(bool b) noexcept;											// Select whether the laser power is set by the step timer instead of the laser task
+	bool IsLaserSynchronised() const noexcept { return laserSynchronised; }
 #endif
 
 	void RecordLookaheadError() noexcept { ++numLookaheadErrors; }						// Record a lookahead error
@@ -106,24 +116,74 @@ private:
 	bool StartNextMove(Platform& p, uint32_t startTime) noexcept SPEED_CRITICAL;		// Start the next move, returning true if laser or IObits need to be controlled
 	uint32_t PrepareMoves(DDA *firstUnpreparedMove, int32_t moveTimeLeft, unsigned int alreadyPrepared, SimulationMode simulationMode) noexcept;
 
+	// Why the step ISR had to insert a hiccup
+	enum class HiccupCause : uint8_t
+	{
+		stepCalcOverrun = 0,				// the steps of the current move were due faster than the ISR could generate them
+		isrLate,							// the ISR started late, because higher priority interrupts or interrupt lockouts delayed it
+		newMove,							// the ISR started a new move whose first steps were already due, e.g. because the moves are very short or were prepared late
+	};
+
+	struct HiccupRecord
+	{
+		uint32_t whenMillis;				// when the hiccup happened
+		FilePosition filePos;				// the file position of the move that was executing, or noFilePosition
+		uint32_t isrLateTicks;				// how long after the step interrupt was due the ISR started
+		HiccupCause cause;
+		bool afterPrepareUnderrun;			// true if we ran out of prepared moves since we last prepared some
+		bool canNotReady;					// true if we last stopped preparing moves because there weren't enough free CAN buffers
+	};
+
+	void RecordHiccup(const DDA *cdda, uint32_t isrLateTicks, bool startedNewMove) noexcept;		// called by the ISR
+
 	static void TimerCallback(CallbackParameter p) noexcept;
 
+#if SUPPORT_LASER
+	static constexpr uint32_t LaserPwmSyncIntervalClocks = (LaserPwmSyncIntervalMicroseconds * StepClockRate)/1000000;
+
+	static void LaserTimerCallback(CallbackParameter p) noexcept;
+	void StartLaserTimer(const DDA *cdda) noexcept;
+	void ManageLaserPowerFromIsr() noexcept SPEED_CRITICAL;
+#endif
+
 	DDA* volatile currentDda;
 	DDA* addPointer;
 	DDA* volatile getPointer;
 	DDA* checkPointer;
 
 	StepTimer timer;															// Timer object to control getting step interrupts
+#if SUPPORT_LASER
+	StepTimer laserTimer;														// Timer object used to set the laser power when it is synchronised to the step timer
+#endif
 
 	volatile float liveCoordinates[MaxAxesPlusExtruders];						// The endpoint that the machine moved to in the last completed move
 	volatile int32_t liveEndPoints[MaxAxesPlusExtruders];						// The XYZ endpoints of the last completed move in motor coordinates
 
 	unsigned int numDdasInRing;
 	uint32_t gracePeriod;														// The minimum idle time in milliseconds, before we should start a move. Better to have a few moves in the queue so that we can do lookahead
+	uint32_t burstStepInterval;													// In burst mode, steps due within this many step clocks are generated without taking another interrupt; 0 disables burst mode
+	uint32_t maxStepsPerBurst;													// The maximum number of step pulses that we generate in one interrupt in burst mode
 
 	uint32_t scheduledMoves;													// Move counters for the code queue
 	volatile uint32_t completedMoves;											// This one is modified by an ISR, hence volatile
 	volatile int32_t numHiccups;												// Modified in the ISR
+	volatile uint32_t numBurstSteps;											// How many steps we generated without taking another interrupt because of burst mode. Modified in the ISR
+	uint32_t minFullRingHorizon;												// The shortest lookahead horizon in step clocks that we have seen when the ring was full, or UINT32_MAX
+
+	// Adaptive planning
+	uint32_t targetPreparedTime;												// The configured amount of execution time in step clocks that we try to keep prepared ahead
+	uint32_t adaptivePreparedTime;												// The amount we currently aim for, increased after a prepare underrun and decaying back to targetPreparedTime
+	uint32_t lastMoveAddedTime;													// The step clock time when the last move was added to the ring
+	float averageMoveInterval;													// Rolling average interval in step clocks between moves being added
+	float averageMoveClocks;													// Rolling average estimated duration in step clocks of the moves added
+	volatile bool hadPrepareUnderrun;											// Set by the ISR when it ran out of prepared moves but there were unprepared ones
+#if SUPPORT_CAN_EXPANSION
+	volatile bool canMotionHeldUpPrepare;										// Set when we last stopped preparing moves because CanMotion wasn't ready
+#endif
+
+	HiccupRecord hiccupLog[HiccupLogEntries];									// Ring buffer of the causes of recent hiccups, written by the ISR
+	volatile size_t nextHiccupRecord;
+	volatile size_t numHiccupRecords;
 
 	unsigned int numLookaheadUnderruns;											// How many times we have run out of moves to adjust during lookahead
 	unsigned int numPrepareUnderruns;											// How many times we wanted a new move but there were only un-prepared moves in the queue
@@ -142,6 +202,9 @@ private:
 	volatile bool liveCoordinatesValid;											// True if the XYZ live coordinates in liveCoordinates are reliable (the extruder ones always are)
 	volatile bool liveCoordinatesChanged;										// True if the live coordinates have changed since LiveCoordinates was last called
 	volatile bool waitingForRingToEmpty;										// True if Move has signalled that we are waiting for this ring to empty
+#if SUPPORT_LASER
+	bool laserSynchronised;														// True if the laser power is set by laserTimer instead of by the laser task
+#endif
 };
 
 // Start the next move. Return true if laser or IO bits need to be active
@@ -161,6 +224,13 @@ pre(getPointer->GetState() == DDA::frozen)
 	}
 	currentDda = cdda;
 	cdda->Start(p, startTime);
+#if SUPPORT_LASER
+	if (laserSynchronised)
+	{
+		StartLaserTimer(cdda);				// the laser timer sets the laser power, so the laser task isn't needed
+		return false;
+	}
+#endif
 #if SUPPORT_LASER || SUPPORT_IOBITS
 	return cdda->ControlLaser();
 #else
@@ -10,6 +10,7 @@
 #include "Move.h"
 #include "StepTimer.h"
 #include <Platform/RepRap.h>
+#include <Platform/Tasks.h>
 #include <Math/Isqrt.h>
 #include "Kinematics/LinearDeltaKinematics.h"
 
@@ -17,6 +18,10 @@
 
 DriveMovement *DriveMovement::freeList = nullptr;
 unsigned int DriveMovement::numCreated = 0;
+unsigned int DriveMovement::numInUse = 0;
+unsigned int DriveMovement::maxInUse = 0;
+unsigned int DriveMovement::numOnDemand = 0;
+unsigned int DriveMovement::numTopUpFailures = 0;
 
 void DriveMovement::InitialAllocate(unsigned int num) noexcept
 {
@@ -40,12 +45,40 @@ DriveMovement *DriveMovement::Allocate(size_t p_drive, DMState st) noexcept
 	{
 		dm = new DriveMovement(nullptr);
 		++numCreated;
+		++numOnDemand;
+	}
+	++numInUse;
+	if (numInUse > maxInUse)
+	{
+		maxInUse = numInUse;
 	}
 	dm->drive = (uint8_t)p_drive;
 	dm->state = st;
 	return dm;
 }
 
+// Create more DMs if the free list is running low, so that DDA::Prepare rarely needs to allocate from the heap
+void DriveMovement::TopUp() noexcept
+{
+	if (numCreated - numInUse < MinFreeDMs)
+	{
+		if (Tasks::GetNeverUsedRam() >= (ptrdiff_t)(MinFreeRamForPoolGrowth + DMsPerTopUp * sizeof(DriveMovement)))
+		{
+			InitialAllocate(numCreated + DMsPerTopUp);
+		}
+		else
+		{
+			++numTopUpFailures;
+		}
+	}
+}
+
+void DriveMovement::PoolDiagnostics(const StringRef& reply) noexcept
+{
+	reply.catf("DMs in use %u max %u, on-demand %u, top-up fails %u", numInUse, maxInUse, numOnDemand, numTopUpFailures);
+	maxInUse = numInUse;
+}
+
 // Constructors
 DriveMovement::DriveMovement(DriveMovement *next) noexcept : nextDM(next)
 {
@@ -74,6 +107,9 @@ void DriveMovement::DebugPrint() const noexcept
 		{
 			debugPrintf("\n");
 		}
+#if NEWTON_STEP_CALC
+		debugPrintf(" newton maxErr=%.3f\n", (double)maxNewtonError);
+#endif
 	}
 	else
 	{
@@ -84,6 +120,9 @@ void DriveMovement::DebugPrint() const noexcept
 // This is called when currentSegment has just been changed to a new segment. Return true if there is a new segment to execute.
 bool DriveMovement::NewCartesianSegment() noexcept
 {
+#if NEWTON_STEP_CALC
+	newtonRecipSqrt = 0.0;								// the square root is discontinuous between segments, so don't refine it from the previous one
+#endif
 	while (true)
 	{
 		if (currentSegment == nullptr)
@@ -96,7 +135,7 @@ bool DriveMovement::NewCartesianSegment() noexcept
 		if (currentSegment->IsLinear())
 		{
 			// Set up pB, pC such that for forward motion, time = pB + pC * stepNumber
-			pB = currentSegment->CalcLinearB(distanceSoFar, timeSoFar);
+			SetLinearCoefficients(currentSegment->CalcLinearB(distanceSoFar, timeSoFar), pC);
 			state = DMState::cartLinear;
 		}
 		else
@@ -126,6 +165,9 @@ bool DriveMovement::NewCartesianSegment() noexcept
 // This is called when currentSegment has just been changed to a new segment. Return true if there is a new segment to execute.
 bool DriveMovement::NewDeltaSegment(const DDA& dda) noexcept
 {
+#if NEWTON_STEP_CALC
+	newtonRecipSqrt = 0.0;								// the square root is discontinuous between segments, so don't refine it from the previous one
+#endif
 	while (true)
 	{
 		if (currentSegment == nullptr)
@@ -216,6 +258,9 @@ bool DriveMovement::NewDeltaSegment(const DDA& dda) noexcept
 // This is called when currentSegment has just been changed to a new segment. Return true if there is a new segment to execute.
 bool DriveMovement::NewExtruderSegment() noexcept
 {
+#if NEWTON_STEP_CALC
+	newtonRecipSqrt = 0.0;								// the square root is discontinuous between segments, so don't refine it from the previous one
+#endif
 	while (true)
 	{
 		if (currentSegment == nullptr)
@@ -233,7 +278,7 @@ bool DriveMovement::NewExtruderSegment() noexcept
 		if (currentSegment->IsLinear())
 		{
 			// Set up pB, pC such that for forward motion, time = pB + pC * stepNumber
-			pB = currentSegment->CalcLinearB(startDistance, startTime);
+			SetLinearCoefficients(currentSegment->CalcLinearB(startDistance, startTime), pC);
 			state = DMState::cartLinear;
 		}
 		else
@@ -272,6 +317,9 @@ bool DriveMovement::PrepareCartesianAxis(const DDA& dda, const PrepParams& param
 	distanceSoFar = 0.0;
 	timeSoFar = 0.0;
 	mp.cart.pressureAdvanceK = 0.0;
+#if NEWTON_STEP_CALC
+	maxNewtonError = 0.0;
+#endif
 	// We can't use directionVector here because those values relate to Cartesian space, whereas we may be CoreXY etc.
 	mp.cart.effectiveStepsPerMm =
 #if SUPPORT_REMOTE_COMMANDS
@@ -310,6 +358,10 @@ bool DriveMovement::PrepareDeltaAxis(const DDA& dda, const PrepParams& params) n
 	const float h0MinusZ0 = fastSqrtf(dSquaredMinusAsquaredMinusBsquared);
 
 	mp.delta.h0MinusZ0 = h0MinusZ0;
+#if NEWTON_STEP_CALC
+	mp.delta.recipT2 = 0.0;
+	maxNewtonError = 0.0;
+#endif
 	mp.delta.fTwoA = 2.0 * A;
 	mp.delta.fTwoB = 2.0 * B;
 	mp.delta.fHmz0s = h0MinusZ0 * stepsPerMm;
@@ -416,7 +468,7 @@ bool DriveMovement::PrepareDeltaAxis(const DDA& dda, const PrepParams& params) n
 // Prepare this DM for an extruder move, returning true if there are steps to do
 // If there are no steps to do, set nextStep = 0 so that DDARing::CurrentMoveCompleted doesn't add any steps to the movement accumulator
 // We have already generated the extruder segments and we know that there are some
-bool DriveMovement::PrepareExtruder(const DDA& dda, const PrepParams& params) noexcept
+bool DriveMovement::PrepareExtruder(const DDA& dda, PrepParams& params) noexcept
 {
 	const float effStepsPerMm =
 #if SUPPORT_REMOTE_COMMANDS
@@ -442,6 +494,9 @@ bool DriveMovement::PrepareExtruder(const DDA& dda, const PrepParams& params) no
 	mp.cart.effectiveMmPerStep = effMmPerStep;
 	distanceSoFar = forwardDistance;
 	timeSoFar = 0.0;
+#if NEWTON_STEP_CALC
+	maxNewtonError = 0.0;
+#endif
 
 	// Calculate the total forward and reverse movement distances
 	if ((   dda.flags.usePressureAdvance
@@ -452,92 +507,102 @@ bool DriveMovement::PrepareExtruder(const DDA& dda, const PrepParams& params) no
 	   )
 	{
 		// We are using nonzero pressure advance. Movement must be forwards.
+		// The distances depend only on the move and K, so if another extruder of this move has already used the same K then we use the distances it calculated.
 		mp.cart.pressureAdvanceK = shaper.GetKclocks();
-		mp.cart.extraExtrusionDistance = mp.cart.pressureAdvanceK * (dda.topSpeed - dda.startSpeed);
-		forwardDistance += mp.cart.extraExtrusionDistance;
+		if (params.paKclocks != mp.cart.pressureAdvanceK)
+		{
+			params.paKclocks = mp.cart.pressureAdvanceK;
+			params.paExtraExtrusionDistance = mp.cart.pressureAdvanceK * (dda.topSpeed - dda.startSpeed);
+			float paForwardDistance = params.paExtraExtrusionDistance, paReverseDistance;
 
 # if 0 //SHAPE_EXTRUSION
-		forwardDistance += params.shaped.decelStartDistance;
-		reverseDistance = 0.0;
+			paForwardDistance += params.shaped.decelStartDistance;
+			paReverseDistance = 0.0;
 
-		// Find the deceleration segments
-		const MoveSegment *decelSeg = dda.unshapedSegments;
-		while (decelSeg != nullptr && (decelSeg->IsLinear() || decelSeg->IsAccelerating()))
-		{
-			decelSeg = decelSeg->GetNext();
-		}
-
-		float lastUncorrectedSpeed = dda.topSpeed;
-		float lastDistance = forwardDistance;
-		while (decelSeg != nullptr)
-		{
-			const float initialDecelSpeed = lastUncorrectedSpeed - mp.cart.pressureAdvanceK * decelSeg->deceleration;
-			if (initialDecelSpeed <= 0.0)
+			// Find the deceleration segments
+			const MoveSegment *decelSeg = dda.unshapedSegments;
+			while (decelSeg != nullptr && (decelSeg->IsLinear() || decelSeg->IsAccelerating()))
 			{
-				// This entire deceleration segment is in reverse
-				reverseDistance += ((0.5 * params.unshaped.deceleration * params.unshaped.decelClocks) - initialDecelSpeed) * params.unshaped.decelClocks;
+				decelSeg = decelSeg->GetNext();
 			}
-			else
+
+			float lastUncorrectedSpeed = dda.topSpeed;
+			float lastDistance = paForwardDistance;
+			while (decelSeg != nullptr)
 			{
-				const float timeToReverse = initialDecelSpeed * ((-0.5) * decelSeg->GetC());	// 'c' is -2/deceleration, so -0.5*c is 1/deceleration
-				if (timeToReverse < params.unshaped.decelClocks)
+				const float initialDecelSpeed = lastUncorrectedSpeed - mp.cart.pressureAdvanceK * decelSeg->deceleration;
+				if (initialDecelSpeed <= 0.0)
 				{
-					// There is a reversal, although it could be tiny
-					const float distanceToReverse = fsquare(initialDecelSpeed) * decelSeg->GetC() * (-0.25);	// because (v^2-u^2) = 2as, so if v=0 then s=-u^2/2a = u^2/2d = -0.25*u^2*c
-					forwardDistance += params.unshaped.decelStartDistance + distanceToReverse;
-					reverseDistance = 0.5 * params.unshaped.deceleration * fsquare(params.unshaped.decelClocks - timeToReverse);	// because s = 0.5*a*t^2
+					// This entire deceleration segment is in reverse
+					paReverseDistance += ((0.5 * params.unshaped.deceleration * params.unshaped.decelClocks) - initialDecelSpeed) * params.unshaped.decelClocks;
 				}
 				else
 				{
-					// No reversal
-					forwardDistance += dda.totalDistance - (mp.cart.pressureAdvanceK * params.unshaped.deceleration * params.unshaped.decelClocks);
-					reverseDistance = 0.0;
+					const float timeToReverse = initialDecelSpeed * ((-0.5) * decelSeg->GetC());	// 'c' is -2/deceleration, so -0.5*c is 1/deceleration
+					if (timeToReverse < params.unshaped.decelClocks)
+					{
+						// There is a reversal, although it could be tiny
+						const float distanceToReverse = fsquare(initialDecelSpeed) * decelSeg->GetC() * (-0.25);	// because (v^2-u^2) = 2as, so if v=0 then s=-u^2/2a = u^2/2d = -0.25*u^2*c
+						paForwardDistance += params.unshaped.decelStartDistance + distanceToReverse;
+						paReverseDistance = 0.5 * params.unshaped.deceleration * fsquare(params.unshaped.decelClocks - timeToReverse);	// because s = 0.5*a*t^2
+					}
+					else
+					{
+						// No reversal
+						paForwardDistance += dda.totalDistance - (mp.cart.pressureAdvanceK * params.unshaped.deceleration * params.unshaped.decelClocks);
+						paReverseDistance = 0.0;
+					}
 				}
-			}
 
-		}
+			}
 # else
-		// Check if there is a reversal in the deceleration segment
-		// There is at most one deceleration segment in the unshaped segments
-		const MoveSegment *decelSeg = dda.unshapedSegments;
-		while (decelSeg != nullptr && (decelSeg->IsLinear() || decelSeg->IsAccelerating()))
-		{
-			decelSeg = decelSeg->GetNext();
-		}
+			// Check if there is a reversal in the deceleration segment
+			// There is at most one deceleration segment in the unshaped segments
+			const MoveSegment *decelSeg = dda.unshapedSegments;
+			while (decelSeg != nullptr && (decelSeg->IsLinear() || decelSeg->IsAccelerating()))
+			{
+				decelSeg = decelSeg->GetNext();
+			}
 
-		if (decelSeg == nullptr)
-		{
-			forwardDistance += dda.totalDistance;			// no deceleration segment
-			reverseDistance = 0.0;
-		}
-		else
-		{
-			const float initialDecelSpeed = dda.topSpeed - mp.cart.pressureAdvanceK * params.unshaped.deceleration;
-			if (initialDecelSpeed <= 0.0)
+			if (decelSeg == nullptr)
 			{
-				// The entire deceleration segment is in reverse
-				forwardDistance += params.unshaped.decelStartDistance;
-				reverseDistance = ((0.5 * params.unshaped.deceleration * params.unshaped.decelClocks) - initialDecelSpeed) * params.unshaped.decelClocks;
+				paForwardDistance += dda.totalDistance;			// no deceleration segment
+				paReverseDistance = 0.0;
 			}
 			else
 			{
-				const float timeToReverse = initialDecelSpeed * ((-0.5) * decelSeg->GetC());	// 'c' is -2/deceleration, so -0.5*c is 1/deceleration
-				if (timeToReverse < params.unshaped.decelClocks)
+				const float initialDecelSpeed = dda.topSpeed - mp.cart.pressureAdvanceK * params.unshaped.deceleration;
+				if (initialDecelSpeed <= 0.0)
 				{
-					// There is a reversal, although it could be tiny
-					const float distanceToReverse = fsquare(initialDecelSpeed) * decelSeg->GetC() * (-0.25);	// because (v^2-u^2) = 2as, so if v=0 then s=-u^2/2a = u^2/2d = -0.25*u^2*c
-					forwardDistance += params.unshaped.decelStartDistance + distanceToReverse;
-					reverseDistance = 0.5 * params.unshaped.deceleration * fsquare(params.unshaped.decelClocks - timeToReverse);	// because s = 0.5*a*t^2
+					// The entire deceleration segment is in reverse
+					paForwardDistance += params.unshaped.decelStartDistance;
+					paReverseDistance = ((0.5 * params.unshaped.deceleration * params.unshaped.decelClocks) - initialDecelSpeed) * params.unshaped.decelClocks;
 				}
 				else
 				{
-					// No reversal
-					forwardDistance += dda.totalDistance - (mp.cart.pressureAdvanceK * params.unshaped.deceleration * params.unshaped.decelClocks);
-					reverseDistance = 0.0;
+					const float timeToReverse = initialDecelSpeed * ((-0.5) * decelSeg->GetC());	// 'c' is -2/deceleration, so -0.5*c is 1/deceleration
+					if (timeToReverse < params.unshaped.decelClocks)
+					{
+						// There is a reversal, although it could be tiny
+						const float distanceToReverse = fsquare(initialDecelSpeed) * decelSeg->GetC() * (-0.25);	// because (v^2-u^2) = 2as, so if v=0 then s=-u^2/2a = u^2/2d = -0.25*u^2*c
+						paForwardDistance += params.unshaped.decelStartDistance + distanceToReverse;
+						paReverseDistance = 0.5 * params.unshaped.deceleration * fsquare(params.unshaped.decelClocks - timeToReverse);	// because s = 0.5*a*t^2
+					}
+					else
+					{
+						// No reversal
+						paForwardDistance += dda.totalDistance - (mp.cart.pressureAdvanceK * params.unshaped.deceleration * params.unshaped.decelClocks);
+						paReverseDistance = 0.0;
+					}
 				}
 			}
-		}
 # endif
+			params.paForwardDistance = paForwardDistance;
+			params.paReverseDistance = paReverseDistance;
+		}
+		mp.cart.extraExtrusionDistance = params.paExtraExtrusionDistance;
+		forwardDistance += params.paForwardDistance;
+		reverseDistance = params.paReverseDistance;
 	}
 	else
 	{
@@ -645,13 +710,74 @@ static inline float fastLimSqrtf(float f) noexcept
 	return (f > 0.0) ? fastSqrtf(f) : 0.0;
 }
 
-// Calculate and store the time since the start of the move when the next step for the specified DriveMovement is due.
-// We have already incremented nextStep and checked that it does not exceed totalSteps, so at least one more step is due
-// Return true if all OK, false to abort this move because the calculation has gone wrong
-bool DriveMovement::CalcNextStepTimeFull(const DDA &dda) noexcept
+// Return the square root of x, which is the time-dependent part of the step time in a nonlinear segment, or zero if x is negative.
+// If Newton step calculation is enabled then we refine the reciprocal square root used for the previous step, which needs only multiplications.
+// The relative error after one iteration is about 3/8 of the square of the residual, so when that would give a step time error greater than
+// MaxNewtonStepTimeError we evaluate the square root in full instead, and reseed from it.
+inline float DriveMovement::NonlinearSqrt(float x) noexcept
+{
+#if NEWTON_STEP_CALC
+	if (newtonRecipSqrt > 0.0 && x > 0.0)
+	{
+		const float residual = 1.0 - x * fsquare(newtonRecipSqrt);
+		const float refinedRecipSqrt = newtonRecipSqrt * (1.0 + 0.5 * residual);
+		const float root = x * refinedRecipSqrt;
+		const float errorBound = 0.375 * fsquare(residual) * root;
+		if (errorBound <= MaxNewtonStepTimeError)
+		{
+			newtonRecipSqrt = refinedRecipSqrt;
+			if (errorBound > maxNewtonError)
+			{
+				maxNewtonError = errorBound;
+			}
+			return root;
+		}
+	}
+
+	const float root = fastLimSqrtf(x);
+	newtonRecipSqrt = (root > 0.0) ? 1.0/root : 0.0;
+	return root;
+#else
+	return fastLimSqrtf(x);
+#endif
+}
+
+#if SUPPORT_LINEAR_DELTA
+
+// Return the square root of x, which is the term in the delta carriage height calculation that depends on the carriage height, or zero if x is negative.
+// This varies smoothly from step to step except close to the top of a reversal, so if Newton step calculation is enabled then we refine the value from the previous step.
+// The error is in units of steps moved by the effector, so we limit it to MaxNewtonDeltaError unless we have just reversed.
+inline float DriveMovement::DeltaSqrt(float x) noexcept
+{
+#if NEWTON_STEP_CALC
+	if (mp.delta.recipT2 > 0.0 && x > 0.0 && !directionChanged)
+	{
+		const float residual = 1.0 - x * fsquare(mp.delta.recipT2);
+		const float refinedRecipSqrt = mp.delta.recipT2 * (1.0 + 0.5 * residual);
+		const float root = x * refinedRecipSqrt;
+		if (0.375 * fsquare(residual) * root <= MaxNewtonDeltaError)
+		{
+			mp.delta.recipT2 = refinedRecipSqrt;
+			return root;
+		}
+	}
+
+	const float root = fastLimSqrtf(x);
+	mp.delta.recipT2 = (root > 0.0) ? 1.0/root : 0.0;
+	return root;
+#else
+	return fastLimSqrtf(x);
+#endif
+}
+
+#endif
+
+// Move on to the next segment if necessary and decide how many steps to generate before we calculate the next step time.
+// Set shiftFactor to the log2 of the number of steps to generate and return true, or return false if there has been a step error.
+inline bool DriveMovement::PrepareStepCalc(const DDA &dda, uint32_t& shiftFactor) noexcept
 pre(nextStep <= totalSteps; stepsTillRecalc == 0)
 {
-	uint32_t shiftFactor = 0;									// assume single stepping
+	shiftFactor = 0;											// assume single stepping
 
 	{
 		uint32_t stepsToLimit = segmentStepLimit - nextStep;
@@ -710,10 +836,102 @@ pre(nextStep <= totalSteps; stepsTillRecalc == 0)
 	}
 
 	stepsTillRecalc = (1u << shiftFactor) - 1u;					// store number of additional steps to generate
+	return true;
+}
 
-	float nextCalcStepTime;
+// Store the calculated time of the next step and the step interval. Return true if successful, false if there was a step error.
+inline bool DriveMovement::SetNextStepTime(const DDA &dda, float nextCalcStepTime, uint32_t shiftFactor) noexcept
+{
+	return SetNextStepTime(dda, (uint32_t)nextCalcStepTime, shiftFactor);
+}
+
+inline bool DriveMovement::SetNextStepTime(const DDA &dda, uint32_t iNextCalcStepTime, uint32_t shiftFactor) noexcept
+{
+	if (iNextCalcStepTime > dda.clocksNeeded)
+	{
+		// The calculation makes this step late.
+		// When the end speed is very low, calculating the time of the last step is very sensitive to rounding error.
+		// So if this is the last step and it is late, bring it forward to the expected finish time.
+		// Very rarely on a delta, the penultimate step may also be calculated late. Allow for that here in case it affects Cartesian axes too.
+		if (nextStep + stepsTillRecalc + 1 >= totalSteps)
+		{
+			iNextCalcStepTime = dda.clocksNeeded;
+		}
+		else
+		{
+			// We don't expect any step except the last to be late
+			state = DMState::stepError;
+			nextStep += 120000000 + stepsTillRecalc;		// so we can tell what happened in the debug print
+			stepInterval = iNextCalcStepTime;				//DEBUG
+			return false;
+		}
+	}
 
-	// Work out the time of the step
+	// When crossing between movement phases with high microstepping, due to rounding errors the next step may appear to be due before the last one
+	stepInterval = (iNextCalcStepTime > nextStepTime)
+					? (iNextCalcStepTime - nextStepTime) >> shiftFactor	// calculate the time per step, ready for next time
+					: 0;
+
+#if 0	//DEBUG
+	if (isExtruder && stepInterval < 20 /*&& nextStep + stepsTillRecalc + 1 < totalSteps*/)
+	{
+		state = DMState::stepError;
+		nextStep += 130000000 + stepsTillRecalc;			// so we can tell what happened in the debug print
+		return false;
+	}
+#endif
+
+#if EVEN_STEPS
+	nextStepTime = iNextCalcStepTime - (stepsTillRecalc * stepInterval);
+#else
+	nextStepTime = iNextCalcStepTime;
+#endif
+
+	return true;
+}
+
+// Set up the coefficients of a linear segment, such that for forward motion, time = pB + pC * stepNumber
+inline void DriveMovement::SetLinearCoefficients(float b, float c) noexcept
+{
+	pB = b;
+	pC = c;
+#if FIXED_POINT_LINEAR_STEPS
+	// At high step rates the step interval is small, so we can represent it in fixed point with enough fraction bits to keep the error
+	// over a long segment well below one clock. At lower step rates few step times are calculated, so we use floating point.
+	if (c > 0.0 && c < MaxFixedPointStepInterval && fabsf(b) < MaxFixedPointTime)
+	{
+		fixedC = (uint32_t)lrintf(c * FixedPointScale);
+		fixedB = llrintf(b * FixedPointScale);
+	}
+	else
+	{
+		fixedC = 0;
+	}
+#endif
+}
+
+// Return the time of the specified step in a linear segment
+template<> inline uint32_t DriveMovement::LinearStepTime<false>(uint32_t stepNumber) const noexcept
+{
+	return (uint32_t)(pB + (float)stepNumber * pC);
+}
+
+#if FIXED_POINT_LINEAR_STEPS
+
+// Fixed point version. A 32 x 32 bit multiply with a 64-bit result followed by a 64-bit add is cheaper than the
+// integer to float conversion, multiply-add and float to integer conversion on processors with a slow FPU pipeline.
+template<> inline uint32_t DriveMovement::LinearStepTime<true>(uint32_t stepNumber) const noexcept
+{
+	return (fixedC == 0)
+			? LinearStepTime<false>(stepNumber)
+				: (uint32_t)((fixedB + (int64_t)((uint64_t)stepNumber * fixedC)) >> FixedPointFractionBits);
+}
+
+#endif
+
+// Work out the time of the next step, after PrepareStepCalc has been called. Return true if successful, false if there was a step error.
+inline bool DriveMovement::CalcStepTime(const DDA &dda, uint32_t shiftFactor, float& nextCalcStepTime) noexcept
+{
 	switch (state)
 	{
 	case DMState::cartLinear:									// linear steady speed
@@ -721,13 +939,13 @@ pre(nextStep <= totalSteps; stepsTillRecalc == 0)
 		break;
 
 	case DMState::cartAccel:									// Cartesian accelerating
-		nextCalcStepTime = pB + fastLimSqrtf(pA + pC * (float)(nextStep + stepsTillRecalc));
+		nextCalcStepTime = pB + NonlinearSqrt(pA + pC * (float)(nextStep + stepsTillRecalc));
 		break;
 
 	case DMState::cartDecelForwardsReversing:
 		if (nextStep + stepsTillRecalc < reverseStartStep)
 		{
-			nextCalcStepTime = pB - fastLimSqrtf(pA + pC * (float)(nextStep + stepsTillRecalc));
+			nextCalcStepTime = pB - NonlinearSqrt(pA + pC * (float)(nextStep + stepsTillRecalc));
 			break;
 		}
 
@@ -736,11 +954,11 @@ pre(nextStep <= totalSteps; stepsTillRecalc == 0)
 		state = DMState::cartDecelReverse;
 		// no break
 	case DMState::cartDecelReverse:								// Cartesian decelerating, reverse motion. Convert the steps to int32_t because the net steps may be negative.
-		nextCalcStepTime = pB + fastLimSqrtf(pA + pC * (float)((2 * (int32_t)(reverseStartStep - 1)) - (int32_t)(nextStep + stepsTillRecalc)));
+		nextCalcStepTime = pB + NonlinearSqrt(pA + pC * (float)((2 * (int32_t)(reverseStartStep - 1)) - (int32_t)(nextStep + stepsTillRecalc)));
 		break;
 
 	case DMState::cartDecelNoReverse:							// Cartesian accelerating with no reversal
-		nextCalcStepTime = pB - fastLimSqrtf(pA + pC * (float)(nextStep + stepsTillRecalc));
+		nextCalcStepTime = pB - NonlinearSqrt(pA + pC * (float)(nextStep + stepsTillRecalc));
 		break;
 
 	case DMState::deltaForwardsReversing:						// moving forwards
@@ -768,7 +986,7 @@ pre(nextStep <= totalSteps; stepsTillRecalc == 0)
 			const float t1 = mp.delta.fMinusAaPlusBbTimesS + hmz0sc;
 			const float t2a = mp.delta.fDSquaredMinusAsquaredMinusBsquaredTimesSsquared - fsquare(mp.delta.fHmz0s) + fsquare(t1);
 			// Due to rounding error we can end up trying to take the square root of a negative number if we do not take precautions here
-			const float t2 = fastLimSqrtf(t2a);
+			const float t2 = DeltaSqrt(t2a);
 			const float ds = (direction) ? t1 - t2 : t1 + t2;
 
 			// Now feed ds into the step algorithm for Cartesian motion
@@ -781,8 +999,8 @@ pre(nextStep <= totalSteps; stepsTillRecalc == 0)
 
 			const float pCds = pC * ds;
 			nextCalcStepTime = (currentSegment->IsLinear()) ? pB + pCds
-								: (currentSegment->IsAccelerating()) ? pB + fastLimSqrtf(pA + pCds)
-									 : pB - fastLimSqrtf(pA + pCds);
+								: (currentSegment->IsAccelerating()) ? pB + NonlinearSqrt(pA + pCds)
+									 : pB - NonlinearSqrt(pA + pCds);
 			//if (currentSegment->IsLinear()) { pA = ds; }	//DEBUG
 		}
 		break;
@@ -801,49 +1019,166 @@ pre(nextStep <= totalSteps; stepsTillRecalc == 0)
 	}
 #endif
 
-	uint32_t iNextCalcStepTime = (uint32_t)nextCalcStepTime;
+	return true;
+}
 
-	if (iNextCalcStepTime > dda.clocksNeeded)
+// Calculate and store the time since the start of the move when the next step for the specified DriveMovement is due.
+// We have already incremented nextStep and checked that it does not exceed totalSteps, so at least one more step is due
+// Return true if all OK, false to abort this move because the calculation has gone wrong
+bool DriveMovement::CalcNextStepTimeFull(const DDA &dda) noexcept
+pre(nextStep <= totalSteps; stepsTillRecalc == 0)
+{
+	uint32_t shiftFactor;
+	if (!PrepareStepCalc(dda, shiftFactor))
 	{
-		// The calculation makes this step late.
-		// When the end speed is very low, calculating the time of the last step is very sensitive to rounding error.
-		// So if this is the last step and it is late, bring it forward to the expected finish time.
-		// Very rarely on a delta, the penultimate step may also be calculated late. Allow for that here in case it affects Cartesian axes too.
-		if (nextStep + stepsTillRecalc + 1 >= totalSteps)
+		return false;
+	}
+
+	if (state == DMState::cartLinear)
+	{
+		return SetNextStepTime(dda, LinearStepTime<UseFixedPointLinearSteps>(nextStep + stepsTillRecalc), shiftFactor);
+	}
+
+	float nextCalcStepTime;
+	return CalcStepTime(dda, shiftFactor, nextCalcStepTime)
+		&& SetNextStepTime(dda, nextCalcStepTime, shiftFactor);
+}
+
+#if BATCHED_STEP_CALC
+
+// Calculate the next step times of the DMs from 'first' up to but not including 'last', with the same results as calling CalcNextStepTime on each one.
+// The square roots needed by Cartesian accelerating and decelerating segments are collected in a structure of arrays and evaluated together,
+// so that the FPU can overlap them instead of each one stalling on the result of the one before.
+/*static*/ void DriveMovement::CalcNextStepTimes(const DDA &dda, DriveMovement *first, const DriveMovement *last) noexcept
+{
+	constexpr size_t BatchSize = 8;
+
+	DriveMovement *batchDms[BatchSize];
+	float batchOffsets[BatchSize];
+	float batchSqrtArgs[BatchSize];
+	float batchSigns[BatchSize];
+	uint8_t batchShiftFactors[BatchSize];
+	size_t numBatched = 0;
+
+	auto executeBatch = [&]() noexcept -> void
+	{
+		float stepTimes[BatchSize];
+		for (size_t i = 0; i < numBatched; ++i)
 		{
-			iNextCalcStepTime = dda.clocksNeeded;
+			stepTimes[i] = batchOffsets[i] + batchSigns[i] * batchDms[i]->NonlinearSqrt(batchSqrtArgs[i]);
 		}
-		else
+		for (size_t i = 0; i < numBatched; ++i)
 		{
-			// We don't expect any step except the last to be late
-			state = DMState::stepError;
-			nextStep += 120000000 + stepsTillRecalc;		// so we can tell what happened in the debug print
-			stepInterval = iNextCalcStepTime;				//DEBUG
-			return false;
+			(void)batchDms[i]->SetNextStepTime(dda, stepTimes[i], batchShiftFactors[i]);
 		}
-	}
-
-	// When crossing between movement phases with high microstepping, due to rounding errors the next step may appear to be due before the last one
-	stepInterval = (iNextCalcStepTime > nextStepTime)
-					? (iNextCalcStepTime - nextStepTime) >> shiftFactor	// calculate the time per step, ready for next time
-					: 0;
+		numBatched = 0;
+	};
 
-#if 0	//DEBUG
-	if (isExtruder && stepInterval < 20 /*&& nextStep + stepsTillRecalc + 1 < totalSteps*/)
+	for (DriveMovement *dm = first; dm != last; dm = dm->nextDM)
 	{
-		state = DMState::stepError;
-		nextStep += 130000000 + stepsTillRecalc;			// so we can tell what happened in the debug print
-		return false;
-	}
+		++dm->nextStep;
+		if (dm->nextStep > dm->totalSteps)
+		{
+			dm->state = DMState::idle;
+#ifdef DUET3_MB6HC												// we need to increase the minimum step pulse length to be long enough for the TMC5160
+			asm volatile("nop");
+			asm volatile("nop");
+			asm volatile("nop");
+			asm volatile("nop");
+			asm volatile("nop");
+			asm volatile("nop");
 #endif
+			continue;
+		}
 
+		if (dm->stepsTillRecalc != 0)
+		{
+			--dm->stepsTillRecalc;								// we are doing double/quad/octal stepping
 #if EVEN_STEPS
-	nextStepTime = iNextCalcStepTime - (stepsTillRecalc * stepInterval);
-#else
-	nextStepTime = iNextCalcStepTime;
+			dm->nextStepTime += dm->stepInterval;
+#endif
+#ifdef DUET3_MB6HC												// we need to increase the minimum step pulse length to be long enough for the TMC5160
+			asm volatile("nop");
+			asm volatile("nop");
+			asm volatile("nop");
+			asm volatile("nop");
+			asm volatile("nop");
+			asm volatile("nop");
 #endif
+			continue;
+		}
 
-	return true;
+		uint32_t shiftFactor;
+		if (!dm->PrepareStepCalc(dda, shiftFactor))
+		{
+			continue;
+		}
+
+		const uint32_t stepNumber = dm->nextStep + dm->stepsTillRecalc;
+		float sqrtArg;
+		float sign;
+		switch (dm->state)
+		{
+		case DMState::cartLinear:								// linear steady speed, no square root needed
+			(void)dm->SetNextStepTime(dda, dm->LinearStepTime<UseFixedPointLinearSteps>(stepNumber), shiftFactor);
+			continue;
+
+		case DMState::cartAccel:
+			sqrtArg = dm->pA + dm->pC * (float)stepNumber;
+			sign = 1.0;
+			break;
+
+		case DMState::cartDecelForwardsReversing:
+			if (stepNumber < dm->reverseStartStep)
+			{
+				sqrtArg = dm->pA + dm->pC * (float)stepNumber;
+				sign = -1.0;
+				break;
+			}
+			dm->direction = false;
+			dm->directionChanged = true;
+			dm->state = DMState::cartDecelReverse;
+			// no break
+		case DMState::cartDecelReverse:
+			sqrtArg = dm->pA + dm->pC * (float)((2 * (int32_t)(dm->reverseStartStep - 1)) - (int32_t)stepNumber);
+			sign = 1.0;
+			break;
+
+		case DMState::cartDecelNoReverse:
+			sqrtArg = dm->pA + dm->pC * (float)stepNumber;
+			sign = -1.0;
+			break;
+
+		default:
+			// Delta segments need more than a square root, so they are not batched
+			{
+				float nextCalcStepTime;
+				if (dm->CalcStepTime(dda, shiftFactor, nextCalcStepTime))
+				{
+					(void)dm->SetNextStepTime(dda, nextCalcStepTime, shiftFactor);
+				}
+			}
+			continue;
+		}
+
+		batchDms[numBatched] = dm;
+		batchOffsets[numBatched] = dm->pB;
+		batchSqrtArgs[numBatched] = sqrtArg;
+		batchSigns[numBatched] = sign;
+		batchShiftFactors[numBatched] = (uint8_t)shiftFactor;
+		++numBatched;
+		if (numBatched == BatchSize)
+		{
+			executeBatch();
+		}
+	}
+
+	if (numBatched != 0)
+	{
+		executeBatch();
+	}
 }
 
+#endif
+
 // End
@@ -18,6 +18,18 @@ class ExtruderShaper;
 
 #define EVEN_STEPS			(1)						// 1 to generate steps at even intervals when doing double/quad/octal stepping
 
+#ifndef BATCHED_STEP_CALC
+# define BATCHED_STEP_CALC	(SAME70)				// 1 to calculate the step times of all drives due to step together, 0 to calculate them one drive at a time
+#endif
+
+#ifndef NEWTON_STEP_CALC
+# define NEWTON_STEP_CALC	(0)						// 1 to refine the square roots in nonlinear and delta step time calculations from the previous step instead of evaluating them in full
+#endif
+
+#ifndef FIXED_POINT_LINEAR_STEPS
+# define FIXED_POINT_LINEAR_STEPS	(SAM4E || SAM4S)	// 1 to calculate step times in linear segments at high step rates using fixed point arithmetic
+#endif
+
 enum class DMState : uint8_t
 {
 	idle = 0,
@@ -49,11 +61,12 @@ public:
 	void operator delete(void* ptr, std::align_val_t align) noexcept {}
 
 	bool CalcNextStepTime(const DDA &dda) noexcept SPEED_CRITICAL;
+	static void CalcNextStepTimes(const DDA &dda, DriveMovement *first, const DriveMovement *last) noexcept SPEED_CRITICAL;
 	bool PrepareCartesianAxis(const DDA& dda, const PrepParams& params) noexcept SPEED_CRITICAL;
 #if SUPPORT_LINEAR_DELTA
 	bool PrepareDeltaAxis(const DDA& dda, const PrepParams& params) noexcept SPEED_CRITICAL;
 #endif
-	bool PrepareExtruder(const DDA& dda, const PrepParams& params) noexcept SPEED_CRITICAL;
+	bool PrepareExtruder(const DDA& dda, PrepParams& params) noexcept SPEED_CRITICAL;
 
 	void DebugPrint() const noexcept;
 	int32_t GetNetStepsLeft() const noexcept;
@@ -67,17 +80,38 @@ public:
 	static unsigned int NumCreated() noexcept { return numCreated; }
 	static DriveMovement *Allocate(size_t p_drive, DMState st) noexcept;
 	static void Release(DriveMovement *item) noexcept;
+	static void TopUp() noexcept;										// top up the free list if it is running low, called by the Move task
+	static void PoolDiagnostics(const StringRef& reply) noexcept;		// append the pool statistics to 'reply' and reset the high water mark
 
 private:
 	bool CalcNextStepTimeFull(const DDA &dda) noexcept SPEED_CRITICAL;
+	bool PrepareStepCalc(const DDA &dda, uint32_t& shiftFactor) noexcept SPEED_CRITICAL;
+	bool CalcStepTime(const DDA &dda, uint32_t shiftFactor, float& nextCalcStepTime) noexcept SPEED_CRITICAL;
+	bool SetNextStepTime(const DDA &dda, float nextCalcStepTime, uint32_t shiftFactor) noexcept SPEED_CRITICAL;
+	bool SetNextStepTime(const DDA &dda, uint32_t iNextCalcStepTime, uint32_t shiftFactor) noexcept SPEED_CRITICAL;
+	template<bool FixedPoint> uint32_t LinearStepTime(uint32_t stepNumber) const noexcept SPEED_CRITICAL;
+	void SetLinearCoefficients(float b, float c) noexcept;
+	float NonlinearSqrt(float x) noexcept SPEED_CRITICAL;
+#if SUPPORT_LINEAR_DELTA
+	float DeltaSqrt(float x) noexcept SPEED_CRITICAL;
+#endif
 	bool NewCartesianSegment() noexcept SPEED_CRITICAL;
 	bool NewExtruderSegment() noexcept SPEED_CRITICAL;
 #if SUPPORT_LINEAR_DELTA
 	bool NewDeltaSegment(const DDA& dda) noexcept SPEED_CRITICAL;
 #endif
 
+	static constexpr bool UseFixedPointLinearSteps = FIXED_POINT_LINEAR_STEPS;
+
+	static constexpr unsigned int MinFreeDMs = MaxAxesPlusExtruders;	// when there are fewer than this number free, the Move task creates more
+	static constexpr unsigned int DMsPerTopUp = 4;						// how many more we create at a time
+
 	static DriveMovement *freeList;
 	static unsigned int numCreated;
+	static unsigned int numInUse;										// how many are currently allocated
+	static unsigned int maxInUse;										// the high water mark of numInUse since the last diagnostics report
+	static unsigned int numOnDemand;									// how many times Allocate found the free list empty and had to use the heap
+	static unsigned int numTopUpFailures;								// how many times TopUp couldn't create more because RAM was low
 
 	// Parameters common to Cartesian, delta and extruder moves
 
@@ -107,6 +141,24 @@ private:
 	float timeSoFar;
 	float pA, pB, pC;
 
+#if FIXED_POINT_LINEAR_STEPS
+	static constexpr unsigned int FixedPointFractionBits = 24;
+	static constexpr float FixedPointScale = (float)(1u << FixedPointFractionBits);
+	static constexpr float MaxFixedPointStepInterval = 255.0;		// the step interval in clocks must be less than 256 to fit in fixedC
+	static constexpr float MaxFixedPointTime = 1.0e11;				// the magnitude of pB in clocks must be less than 2^(63 - FixedPointFractionBits)
+
+	int64_t fixedB;										// pB scaled by FixedPointScale, if fixedC is nonzero
+	uint32_t fixedC;									// pC scaled by FixedPointScale, or zero if the coefficients of this linear segment are not representable
+#endif
+
+#if NEWTON_STEP_CALC
+	static constexpr float MaxNewtonStepTimeError = 0.5;	// the maximum estimated step time error in step clocks that we accept from Newton refinement
+	static constexpr float MaxNewtonDeltaError = 0.05;		// the maximum estimated error in the delta carriage position in steps that we accept from Newton refinement
+
+	float newtonRecipSqrt;								// reciprocal of the square root calculated for the previous step, or zero if we don't have one
+	float maxNewtonError;								// maximum estimated step time error in step clocks from Newton refinement during this move
+#endif
+
 	// Parameters unique to a style of move (Cartesian, delta or extruder). Currently, extruders and Cartesian moves use the same parameters.
 	union
 	{
@@ -120,6 +172,9 @@ private:
 			float fHmz0s;								// the starting height less the starting Z height, multiplied by the Z movement fraction (can go negative)
 			float fMinusAaPlusBbTimesS;
 			float reverseStartDistance;					// the overall move distance at which movement reversal occurs
+#if NEWTON_STEP_CALC
+			float recipT2;								// reciprocal of the square root in the carriage height calculation for the previous step, or zero if we don't have one
+#endif
 		} delta;
 
 		struct CartesianParameters
@@ -173,6 +228,19 @@ inline bool DriveMovement::CalcNextStepTime(const DDA &dda) noexcept
 	return false;
 }
 
+#if !BATCHED_STEP_CALC
+
+// Calculate the next step times of the DMs from 'first' up to but not including 'last'
+inline void DriveMovement::CalcNextStepTimes(const DDA &dda, DriveMovement *first, const DriveMovement *last) noexcept
+{
+	for (DriveMovement *dm = first; dm != last; dm = dm->nextDM)
+	{
+		(void)dm->CalcNextStepTime(dda);
+	}
+}
+
+#endif
+
 // Return the number of net steps left for the move in the forwards direction.
 // We have already taken nextSteps - 1 steps, unless nextStep is zero.
 inline int32_t DriveMovement::GetNetStepsLeft() const noexcept
@@ -215,6 +283,7 @@ inline void DriveMovement::Release(DriveMovement *item) noexcept
 {
 	item->nextDM = freeList;
 	freeList = item;
+	--numInUse;
 }
 
 #if HAS_SMART_DRIVERS
@@ -16,12 +16,14 @@
 #include <Heating/Sensors/TemperatureSensor.h>
 #include <Movement/Move.h>
 #include <Platform/TaskPriorities.h>
+#include <Movement/StepTimer.h>
 
 HeightController::HeightController() noexcept
 	: heightControllerTask(nullptr), sensorNumber(-1),
 		sampleInterval(DefaultSampleInterval), setPoint(1.0), pidP(1.0), configuredPidI(0.0), configuredPidD(0.0), iAccumulator(0.0),
 		zMin(5.0), zMax(10.0), state(PidState::stopped)
 {
+	ResetStats();
 	CalcDerivedValues();
 }
 
@@ -45,7 +47,7 @@ GCodeResult HeightController::Configure(GCodeBuffer& gb, const StringRef& reply)
 	if (gb.Seen('F'))
 	{
 		const float freq = gb.GetFValue();
-		if (freq >= 0.1 && freq <= 200.0)
+		if (freq >= 0.1 && freq <= MaxSampleFrequency)
 		{
 			sampleInterval = lrintf(1000/freq);
 		}
@@ -84,6 +86,7 @@ GCodeResult HeightController::Configure(GCodeBuffer& gb, const StringRef& reply)
 	{
 		reply.printf("Height controller uses sensor %u, frequency %.1f, P%.1f I%.1f D%.1f, Z%.1f to %.1f",
 						sensorNumber, (double)(1000.0/(float)sampleInterval), (double)pidP, (double)configuredPidI, (double)configuredPidD, (double)zMin, (double)zMax);
+		AppendStats(reply);
 	}
 	return GCodeResult::ok;
 }
@@ -119,6 +122,7 @@ GCodeResult HeightController::StartHeightFollowing(GCodeBuffer& gb, const String
 
 			if (state == PidState::stopped)
 			{
+				ResetStats();
 				state = PidState::starting;
 				heightControllerTask->Give();
 			}
@@ -132,6 +136,7 @@ GCodeResult HeightController::StartHeightFollowing(GCodeBuffer& gb, const String
 	else
 	{
 		reply.printf("Height following mode is %sactive", (state == PidState::stopped) ? "in" : "");
+		AppendStats(reply);
 	}
 	return GCodeResult::ok;
 }
@@ -165,8 +170,9 @@ void HeightController::Stop() noexcept
 		}
 		else
 		{
+			const StepTimer::Ticks startTicks = StepTimer::GetTimerTicks();
 			TemperatureError err;
-			const float sensorVal = reprap.GetHeat().GetSensorTemperature(sensorNumber, err);
+			const float sensorVal = reprap.GetHeat().GetSensorInstantReading(sensorNumber, err);
 			if (err == TemperatureError::success)
 			{
 				AsyncMove * const move = reprap.GetMove().LockAuxMove();
@@ -200,6 +206,10 @@ void HeightController::Stop() noexcept
 					move->acceleration = move->deceleration = acceleration;
 					reprap.GetMove().ReleaseAuxMove(true);
 				}
+				else
+				{
+					++numMissedCorrections;
+				}
 
 				lastReading = sensorVal;
 				lastReadingOk = true;
@@ -207,12 +217,43 @@ void HeightController::Stop() noexcept
 			else
 			{
 				lastReadingOk = false;
+				++numSensorErrors;
+			}
+
+			const uint32_t loopTicks = StepTimer::GetTimerTicks() - startTicks;
+			++numSamples;
+			totalLoopTicks += loopTicks;
+			minLoopTicks = min<uint32_t>(minLoopTicks, loopTicks);
+			maxLoopTicks = max<uint32_t>(maxLoopTicks, loopTicks);
+			if (xTaskGetTickCount() - lastWakeTime >= sampleInterval)
+			{
+				++numOverruns;						// vTaskDelayUntil will return immediately, so this sample is late
 			}
 			vTaskDelayUntil(&lastWakeTime, sampleInterval);
 		}
 	}
 }
 
+void HeightController::ResetStats() noexcept
+{
+	numSamples = numOverruns = numMissedCorrections = numSensorErrors = 0;
+	minLoopTicks = UINT32_MAX;
+	maxLoopTicks = 0;
+	totalLoopTicks = 0;
+}
+
+// Append the loop timing statistics to the reply
+void HeightController::AppendStats(const StringRef& reply) const noexcept
+{
+	if (numSamples != 0)
+	{
+		constexpr float MicrosecondsPerTick = 1.0e6/(float)StepClockRate;
+		reply.catf("\n%" PRIu32 " samples, loop time min %.1f avg %.1f max %.1fus, %" PRIu32 " overruns, %" PRIu32 " corrections missed, %" PRIu32 " sensor errors",
+					numSamples, (double)(minLoopTicks * MicrosecondsPerTick), (double)(((float)totalLoopTicks/numSamples) * MicrosecondsPerTick),
+					(double)(maxLoopTicks * MicrosecondsPerTick), numOverruns, numMissedCorrections, numSensorErrors);
+	}
+}
+
 void HeightController::CalcDerivedValues() noexcept
 {
 	actualPidI = configuredPidI * ((float)sampleInterval * MillisToSeconds);
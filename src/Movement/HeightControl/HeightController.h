@@ -27,9 +27,12 @@ public:
 
 private:
 	void CalcDerivedValues() noexcept;
+	void ResetStats() noexcept;
+	void AppendStats(const StringRef& reply) const noexcept;
 
 	static constexpr unsigned int HeightControllerTaskStackWords = 100;
 	static constexpr uint32_t DefaultSampleInterval = 200;
+	static constexpr float MaxSampleFrequency = 1000.0;		// the RTOS tick rate, because we schedule samples using task delays
 
 	Task<HeightControllerTaskStackWords> *heightControllerTask;
 	int sensorNumber;								// which sensor, normally a virtual heater, or -1 if not configured
@@ -55,6 +58,14 @@ private:
 		running
 	};
 
+	// Loop timing statistics, reset when height following starts
+	uint32_t numSamples;
+	uint32_t numOverruns;							// how many times the loop took longer than the sample interval
+	uint32_t numMissedCorrections;					// how many times the previous correction hadn't been taken by the Move task yet
+	uint32_t numSensorErrors;
+	uint32_t minLoopTicks, maxLoopTicks;			// how long each sample took to process, in step clocks
+	uint64_t totalLoopTicks;
+
 	volatile PidState state;						// volatile because it is accessed by more than one task
 	bool lastReadingOk;
 };
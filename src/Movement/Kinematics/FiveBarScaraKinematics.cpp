@@ -83,19 +83,19 @@ void FiveBarScaraKinematics::getInverse(const float coords[]) const noexcept
 	{
 		// calculate cantilevered side first:
 
-		float lefttheta[6];
+		float lefttheta[3];
 		getTheta(lefttheta, proximalL, distalL + cantL, xOrigL, yOrigL, x_0, y_0, Arm::left);
 		xL = lefttheta[0];
 		yL = lefttheta[1];
 		thetaL = lefttheta[2];
 
 		// calculate x1,y1, i.e. where the distal arms meet
-		float fraction = distalL / (distalL + cantL);
+		const float fraction = cantFractionL;
 		x1 = (x_0 - xL) * fraction + xL;
 		y1 = (y_0 - yL) * fraction + yL;
 
 		// calculate right, non cantilevered side:
-		float righttheta[6];
+		float righttheta[3];
 		getTheta(righttheta, proximalR, distalR, xOrigR, yOrigR, x1, y1, Arm::right);
 		xR = righttheta[0];
 		yR = righttheta[1];
@@ -104,19 +104,19 @@ void FiveBarScaraKinematics::getInverse(const float coords[]) const noexcept
 	else if (isCantilevered(2))
 	{
 		// calculate cantilevered side first:
-		float righttheta[6];
+		float righttheta[3];
 		getTheta(righttheta, proximalR, distalR + cantR, xOrigR, yOrigR, x_0, y_0, Arm::right);
 		xR = righttheta[0];
 		yR = righttheta[1];
 		thetaR = righttheta[2];
 
 		// calculate x1,y1, i.e. where the distal arms meet
-		float fraction = distalR / (distalR + cantR);
+		const float fraction = cantFractionR;
 		x1 = (x_0 - xR) * fraction + xR;
 		y1 = (y_0 - yR) * fraction + yR;
 
 		// calculate left, non cantilevered side:
-		float lefttheta[6];
+		float lefttheta[3];
 		getTheta(lefttheta, proximalL, distalL, xOrigL, yOrigL, x1, y1, Arm::left);
 		xL = lefttheta[0];
 		yL = lefttheta[1];
@@ -125,7 +125,7 @@ void FiveBarScaraKinematics::getInverse(const float coords[]) const noexcept
 	}
 	else
 	{	// not cantilevered, hotend is at top joint
-		float lefttheta[6];
+		float lefttheta[3];
 		getTheta(lefttheta, proximalL, distalL, xOrigL, yOrigL, x_0, y_0, Arm::left);
 		x1 = x_0;
 		y1 = y_0;
@@ -133,7 +133,7 @@ void FiveBarScaraKinematics::getInverse(const float coords[]) const noexcept
 		yL = lefttheta[1];
 		thetaL = lefttheta[2];
 
-		float righttheta[6];
+		float righttheta[3];
 		getTheta(righttheta, proximalR, distalR, xOrigR, yOrigR, x_0, y_0, Arm::right);
 		xR = righttheta[0];
 		yR = righttheta[1];
@@ -162,46 +162,25 @@ void FiveBarScaraKinematics::getInverse(const float coords[]) const noexcept
 		std::isnan(cachedThetaL) || std::isnan(cachedXL) || std::isnan(cachedYL);
 }
 
-// quadrants: 1 is right upper, 2 is left upper, 3 is left down, 4 is right down
-int FiveBarScaraKinematics::getQuadrant(float x, float y) const noexcept
-{
-	return (x >= 0.0 && y >= 0.0) ? 1
-			: (x < 0.0 && y >= 0.0) ? 2
-				: (x < 0.0 && y < 0.0) ? 3
-					: 4;						// x >= 0 && y < 0
-}
-
 // return true if the Scara is cantilevered
 bool FiveBarScaraKinematics::isCantilevered(int mode) const noexcept
 {
 	return (cantL > 0.0f && mode == 1) || (cantR > 0.0f && mode == 2);
 }
 
-// get angle between -90 and 270 for given origin and destination coordinates
+// get angle between 0 and 360 for given origin and destination coordinates
 float FiveBarScaraKinematics::getAbsoluteAngle(float xOrig, float yOrig, float xDest, float yDest) const noexcept
 {
-	const float length = fastSqrtf(fsquare(xOrig - xDest) + fsquare(yOrig - yDest));
-	const float y = fabs(yOrig - yDest);
-	float angle = asinf(y / length) * 180.0f / Pi;
-
-	const int quad = getQuadrant(xDest - xOrig, yDest - yOrig);
-
-	switch(quad)
+	const float dx = xDest - xOrig;
+	const float dy = yDest - yOrig;
+	if (dx == 0.0 && dy == 0.0)
 	{
-	case 1: // right upper quadrant I
-		// nothing to change
-		break;
-	case 2:  // left upper quadrant II
-		angle = 180.0 - angle;
-		break;
-	case 3:  // left lower quadrant III
-		angle = 180.0 + angle;
-		break;
-	case 4: // right lower quadrant IV
-		angle = 360.0 - angle;
-		break;
+		return std::numeric_limits<float>::quiet_NaN();		// the angle is undefined
 	}
-	return angle;
+
+	// A single atan2f is much faster than the square root, arcsine and quadrant correction that we used to do
+	const float angle = atan2f(dy, dx) * RadiansToDegrees;
+	return (angle < 0.0) ? angle + 360.0 : angle;
 }
 
 // first circle, second circle. Return the two intersection points
@@ -240,9 +219,8 @@ void FiveBarScaraKinematics::getIntersec(float result[], float firstRadius, floa
 	result[3] = y2;
 }
 
-// return coordinates and theta angles or both possible solutions
-// first solution in [0], [1], [2] is the angle which fits to the current workmode
-// result: x,y,theta of first point, then x,y,theta of second solution
+// return coordinates and theta angle of the solution which fits the current workmode
+// result: x,y,theta
 void FiveBarScaraKinematics::getTheta(float result[], float prox, float distal, float proxX, float proxY, float destX, float destY, Arm arm) const noexcept
 {
 	float inter12[4];
@@ -252,9 +230,6 @@ void FiveBarScaraKinematics::getTheta(float result[], float prox, float distal,
 	const float x2 = inter12[2];
 	const float y2 = inter12[3];
 
-	const float thetaA = getAbsoluteAngle(proxX, proxY, x1, y1);
-	const float thetaB = getAbsoluteAngle(proxX, proxY, x2, y2);
-
 	const float proxTurnA = getTurn(proxX, proxY, x1, y1, destX, destY);
 	const float proxTurnB = getTurn(proxX, proxY, x2, y2, destX, destY);
 
@@ -334,23 +309,18 @@ void FiveBarScaraKinematics::getTheta(float result[], float prox, float distal,
 		}
 	}
 
+	// Only calculate the angle of the solution we use
 	if (use == 1)
 	{
 	    result[0] = x1;
 	    result[1] = y1;
-	    result[2] = thetaA;
-	    result[3] = x2;
-	    result[4] = y2;
-	    result[5] = thetaB;
+	    result[2] = getAbsoluteAngle(proxX, proxY, x1, y1);
 	}
 	else if (use == 2)
 	{
 	    result[0] = x2;
 	    result[1] = y2;
-	    result[2] = thetaB;
-	    result[3] = x1;
-	    result[4] = y1;
-	    result[5] = thetaA;
+	    result[2] = getAbsoluteAngle(proxX, proxY, x2, y2);
 	}
 	else
 	{
@@ -358,9 +328,6 @@ void FiveBarScaraKinematics::getTheta(float result[], float prox, float distal,
 	    result[0] = std::numeric_limits<float>::quiet_NaN();
 	    result[1] = std::numeric_limits<float>::quiet_NaN();
 	    result[2] = std::numeric_limits<float>::quiet_NaN();
-	    result[3] = std::numeric_limits<float>::quiet_NaN();
-	    result[4] = std::numeric_limits<float>::quiet_NaN();
-	    result[5] = std::numeric_limits<float>::quiet_NaN();
 	}
 }
 
@@ -774,6 +741,34 @@ void FiveBarScaraKinematics::MotorStepsToCartesian(const int32_t motorPos[], con
 	const float thetaL = ((float)motorPos[X_AXIS]/stepsPerMm[X_AXIS]);
 	const float thetaR = ((float)motorPos[Y_AXIS]/stepsPerMm[Y_AXIS]);
 
+	// The position is often requested repeatedly for the same motor positions, e.g. when reporting the live position while the machine is idle
+	if (!cachedForwardInvalid && thetaL == cachedForwardThetaL && thetaR == cachedForwardThetaR)
+	{
+		machinePos[X_AXIS] = cachedForwardX0;
+		machinePos[Y_AXIS] = cachedForwardY0;
+	}
+	else
+	{
+		getForwardWithCantilever(thetaL, thetaR, machinePos);
+		cachedForwardThetaL = thetaL;
+		cachedForwardThetaR = thetaR;
+		cachedForwardX0 = machinePos[X_AXIS];
+		cachedForwardY0 = machinePos[Y_AXIS];
+		cachedForwardInvalid = false;
+	}
+
+    machinePos[Z_AXIS] = (float) motorPos[Z_AXIS] / stepsPerMm[Z_AXIS];
+
+	// Convert any additional axes linearly
+	for (size_t drive = XYZ_AXES; drive < numVisibleAxes; ++drive)
+	{
+		machinePos[drive] = motorPos[drive]/stepsPerMm[drive];
+	}
+}
+
+// Calculate the X and Y coordinates of the print head reference point from the actuator angles, including the cantilever if there is one
+void FiveBarScaraKinematics::getForwardWithCantilever(float thetaL, float thetaR, float machinePos[]) const noexcept
+{
 	float x_0 = -1.0;
 	float y_0 = -1.0;
 
@@ -816,14 +811,6 @@ void FiveBarScaraKinematics::MotorStepsToCartesian(const int32_t motorPos[], con
 
     machinePos[X_AXIS] = x_0;
     machinePos[Y_AXIS] = y_0;
-
-    machinePos[Z_AXIS] = (float) motorPos[Z_AXIS] / stepsPerMm[Z_AXIS];
-
-	// Convert any additional axes linearly
-	for (size_t drive = XYZ_AXES; drive < numVisibleAxes; ++drive)
-	{
-		machinePos[drive] = motorPos[drive]/stepsPerMm[drive];
-	}
 }
 
 // Return true if the specified XY position is reachable by the print head reference point.
@@ -949,6 +936,11 @@ void FiveBarScaraKinematics::Recalc() noexcept
 	cachedX0 = std::numeric_limits<float>::quiet_NaN(); // make sure that the cached values won't match any coordinates
 	cachedY0 = std::numeric_limits<float>::quiet_NaN(); // make sure that the cached values won't match any coordinates
 	cachedInvalid = true;
+	cachedForwardInvalid = true;
+
+	// The proportions of the cantilevered distal arms from the proximal joint to where the distal arms meet
+	cantFractionL = distalL / (distalL + cantL);
+	cantFractionR = distalR / (distalR + cantR);
 }
 
 #endif // SUPPORT_FIVEBARSCARA
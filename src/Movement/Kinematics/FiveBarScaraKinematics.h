@@ -52,13 +52,13 @@ private:
 	static constexpr const char *Home5BarScaraFileName = "home5barscara.g";
 
 	void Recalc() noexcept;
-	int getQuadrant(float x, float y) const noexcept;
 	bool isCantilevered(int mode) const noexcept;
 	float getAbsoluteAngle(float xOrig, float yOrig, float xDest, float yDest) const noexcept;
 	void getIntersec(float result12[], float firstRadius, float secondRadius, float firstX, float firstY, float secondX, float secondY) const noexcept;
 	void getTheta(float result[], float proximal, float distal, float proxX, float proxY, float destX, float destY, Arm arm) const noexcept;
 	void getXYFromAngle(float resultcoords[], float angle, float length, float origX, float origY) const noexcept;
 	void getForward(float resultcoords[], float thetaL, float thetaR) const noexcept;
+	void getForwardWithCantilever(float thetaL, float thetaR, float machinePos[]) const noexcept;
 	void getInverse(const float coords[]) const noexcept;
 	float getAngle(float x1, float y1, float xAngle, float yAngle, float x2, float y2) const noexcept;
     float getTurn(float x1, float y1, float x2, float y2, float x3, float y3) const noexcept;
@@ -95,6 +95,7 @@ private:
 	float actuatorAngleRMax;
 
 	// Derived parameters
+	float cantFractionL, cantFractionR;
 
 	// State variables
 	mutable float cachedX0, cachedY0;
@@ -103,6 +104,9 @@ private:
 	mutable float cachedYL, cachedYR;
 	mutable float cachedX1, cachedY1;
 	mutable bool cachedInvalid;
+	mutable float cachedForwardThetaL, cachedForwardThetaR;		// the actuator angles of the last forward transform
+	mutable float cachedForwardX0, cachedForwardY0;				// the result of the last forward transform
+	mutable bool cachedForwardInvalid;
 };
 
 #endif // SUPPORT_FIVEBARSCARA
@@ -60,6 +60,7 @@ private:
 
 	void Init() noexcept;
 	void Recalc() noexcept;
+	void RecalcForwardTransform() noexcept;
 	float LineLengthSquared(const float machinePos[3], const float anchor[3]) const noexcept;		// Calculate the square of the line length from a spool from a Cartesian coordinate
 	void ForwardTransform(float a, float b, float c, float d, float machinePos[3]) const noexcept;
 	float MotorPosToLinePos(const int32_t motorPos, size_t axis) const noexcept;
@@ -78,6 +79,12 @@ private:
 	float k0[HANGPRINTER_AXES], spoolRadiiSq[HANGPRINTER_AXES], k2[HANGPRINTER_AXES], lineLengthsOrigin[HANGPRINTER_AXES];
 	float printRadiusSquared;
 
+	// Derived parameters used by the forward transform, which depend only on the anchor positions
+	float fwdRotation[3][3];						// rotation from the frame in which Ax=0, Dx=0, Dy=0 back to machine coordinates
+	float fwdK0bScale, fwdK0bCross, fwdK0cScale, fwdK0cCross;	// factors of the line length terms in k0b and k0c
+	float fwdK1b, fwdK1c;							// the constants k1b and k1c
+	float fwdYScale, fwdYSlope;						// factors used to calculate Y from the line lengths and Z
+
 #if DUAL_CAN
 	// Some CAN helpers
 	struct ODriveAnswer {
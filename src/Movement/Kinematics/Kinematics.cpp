@@ -39,11 +39,12 @@ constexpr ObjectModelTableEntry Kinematics::objectModelTable[] =
 	{ "segmentation",		OBJECT_MODEL_FUNC_IF(self->segmentationType.useSegmentation, self, 1), 	ObjectModelEntryFlags::none },
 
 	// 1. segmentation members
+	{ "maxError",			OBJECT_MODEL_FUNC(self->maxSegmentError, 2), 							ObjectModelEntryFlags::none },
 	{ "minSegLength",		OBJECT_MODEL_FUNC(self->minSegmentLength, 2), 							ObjectModelEntryFlags::none },
 	{ "segmentsPerSec",		OBJECT_MODEL_FUNC(self->segmentsPerSecond, 1), 							ObjectModelEntryFlags::none },
 };
 
-constexpr uint8_t Kinematics::objectModelTableDescriptor[] = { 2, 1, 2 };
+constexpr uint8_t Kinematics::objectModelTableDescriptor[] = { 2, 1, 3 };
 
 DEFINE_GET_OBJECT_MODEL_TABLE(Kinematics)
 
@@ -52,6 +53,7 @@ DEFINE_GET_OBJECT_MODEL_TABLE(Kinematics)
 // Constructor. Pass segsPerSecond <= 0.0 to get non-segmented kinematics.
 Kinematics::Kinematics(KinematicsType t, SegmentationType segType) noexcept
 	: segmentsPerSecond(DefaultSegmentsPerSecond), minSegmentLength(DefaultMinSegmentLength), reciprocalMinSegmentLength(1.0/DefaultMinSegmentLength),
+	  maxSegmentError(0.0),
 	  segmentationType(segType), type(t)
 {
 }
@@ -67,7 +69,14 @@ bool Kinematics::Configure(unsigned int mCode, GCodeBuffer& gb, const StringRef&
 			reply.printf("Kinematics is %s, ", GetName());
 			if (segmentationType.useSegmentation)
 			{
-				reply.catf("%d segments/sec, min. segment length %.2fmm", (int)segmentsPerSecond, (double)minSegmentLength);
+				if (maxSegmentError > 0.0)
+				{
+					reply.catf("max. segmentation error %.2f steps, min. segment length %.2fmm", (double)maxSegmentError, (double)minSegmentLength);
+				}
+				else
+				{
+					reply.catf("%d segments/sec, min. segment length %.2fmm", (int)segmentsPerSecond, (double)minSegmentLength);
+				}
 			}
 			else
 			{
@@ -89,9 +98,10 @@ bool Kinematics::TryConfigureSegmentation(GCodeBuffer& gb) THROWS(GCodeException
 	bool seen = false;
 	gb.TryGetFValue('S', segmentsPerSecond, seen);
 	gb.TryGetFValue('T', minSegmentLength, seen);
+	gb.TryGetFValue('E', maxSegmentError, seen);
 	if (seen)
 	{
-		segmentationType.useSegmentation = minSegmentLength > 0.0 && segmentsPerSecond > 0.0;
+		segmentationType.useSegmentation = minSegmentLength > 0.0 && (segmentsPerSecond > 0.0 || maxSegmentError > 0.0);
 		if (segmentationType.useSegmentation)
 		{
 			reciprocalMinSegmentLength = 1.0 / minSegmentLength;
@@ -100,6 +110,50 @@ bool Kinematics::TryConfigureSegmentation(GCodeBuffer& gb) THROWS(GCodeException
 	return seen;
 }
 
+// Return the number of segments to split a move into.
+// If a maximum segmentation error has been configured, we calculate the motor positions at the start, middle and end of the move.
+// The motors move linearly within each segment, so the error at the middle of an unsegmented move is approximately the difference
+// between the true motor position and the mean of the start and end positions, and it falls with the square of the number of segments.
+// Otherwise we use the configured number of segments per second.
+unsigned int Kinematics::GetNumSegments(const float startCoords[], const float endCoords[], size_t numVisibleAxes, size_t numTotalAxes,
+											float moveLength, float moveTime, bool isCoordinated) const noexcept
+{
+	const float maxSegmentsByLength = moveLength * reciprocalMinSegmentLength;
+	if (maxSegmentError <= 0.0)
+	{
+		return (unsigned int)max<long>(1, lrintf(min<float>(maxSegmentsByLength, moveTime * segmentsPerSecond)));
+	}
+
+	float midCoords[MaxAxes];
+	for (size_t axis = 0; axis < numTotalAxes; ++axis)
+	{
+		midCoords[axis] = 0.5 * (startCoords[axis] + endCoords[axis]);
+	}
+
+	const float * const stepsPerMm = reprap.GetPlatform().GetDriveStepsPerUnit();
+	int32_t startSteps[MaxAxes] = { 0 }, midSteps[MaxAxes] = { 0 }, endSteps[MaxAxes] = { 0 };
+	if (   !CartesianToMotorSteps(startCoords, stepsPerMm, numVisibleAxes, numTotalAxes, startSteps, isCoordinated)
+		|| !CartesianToMotorSteps(midCoords, stepsPerMm, numVisibleAxes, numTotalAxes, midSteps, isCoordinated)
+		|| !CartesianToMotorSteps(endCoords, stepsPerMm, numVisibleAxes, numTotalAxes, endSteps, isCoordinated)
+	   )
+	{
+		return (unsigned int)max<long>(1, lrintf(maxSegmentsByLength));		// a point is unreachable, so use the shortest segments allowed and let Move report the error
+	}
+
+	float maxError = 0.0;
+	for (size_t axis = 0; axis < MaxAxes; ++axis)					// some kinematics have more motors than visible axes
+	{
+		const float error = fabsf((float)midSteps[axis] - 0.5 * (float)(startSteps[axis] + endSteps[axis]));
+		if (error > maxError)
+		{
+			maxError = error;
+		}
+	}
+
+	const float segmentsNeeded = ceilf(fastSqrtf(maxError/maxSegmentError));
+	return (unsigned int)max<long>(1, lrintf(min<float>(maxSegmentsByLength, segmentsNeeded)));
+}
+
 // Return true if the specified XY position is reachable by the print head reference point.
 // This default implementation assumes a rectangular reachable area, so it just uses the bed dimensions give in the M208 command.
 bool Kinematics::IsReachable(float axesCoords[MaxAxes], AxesBitmap axes) const noexcept
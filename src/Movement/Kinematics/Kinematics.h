@@ -120,6 +120,10 @@ public:
 	virtual bool DoAutoCalibration(size_t numFactors, const RandomProbePointSet& probePoints, const StringRef& reply) noexcept
 	pre(SupportsAutoCalibration()) { return false; }
 
+	// Return true if auto calibration should be repeated after probing the same points again. Called after DoAutoCalibration has succeeded using only probed points.
+	// passesDone is the number of calibration passes done so far. If returning false, optionally append a note to 'reply'.
+	virtual bool NeedsAnotherCalibrationPass(unsigned int passesDone, const StringRef& reply) const noexcept { return false; }
+
 	// Set the default parameters that are changed by auto calibration back to their defaults.
 	// Do nothing if auto calibration is not supported.
 	virtual void SetCalibrationDefaults() noexcept { }
@@ -218,6 +222,10 @@ public:
 	float GetMinSegmentLength() const noexcept pre(UseSegmentation()) { return minSegmentLength; }
 	float GetReciprocalMinSegmentLength() const noexcept pre(UseSegmentation()) { return reciprocalMinSegmentLength; }
 
+	// Return the number of segments to split a move into, given its start and end machine coordinates, length and minimum duration
+	unsigned int GetNumSegments(const float startCoords[], const float endCoords[], size_t numVisibleAxes, size_t numTotalAxes,
+									float moveLength, float moveTime, bool isCoordinated) const noexcept pre(UseSegmentation());
+
 protected:
 	DECLARE_OBJECT_MODEL
 
@@ -246,6 +254,7 @@ private:
 	float segmentsPerSecond;				// if we are using segmentation, the target number of segments/second
 	float minSegmentLength;					// if we are using segmentation, the minimum segment size
 	float reciprocalMinSegmentLength;		// if we are using segmentation, the reciprocal of minimum segment size
+	float maxSegmentError;					// if we are using segmentation and this is nonzero, the maximum motor position error in steps, which replaces segmentsPerSecond
 
 	SegmentationType segmentationType;		// the type of segmentation we are using
 	KinematicsType type;
@@ -462,53 +462,41 @@ bool LinearDeltaKinematics::DoAutoCalibration(size_t numFactors, const RandomPro
 		initialDeviation.Set(initialSumOfSquares, initialSum, numPoints);
 	}
 
-	// Do 1 or more Newton-Raphson iterations
+	// Do Newton-Raphson iterations until the expected deviation stops improving
 	Deviation finalDeviation;
+	float iterationDeviations[MaxDeltaCalibrationIterations];
 	unsigned int iteration = 0;
 	for (;;)
 	{
-		// Build a Nx9 matrix of derivatives with respect to xa, xb, yc, za, zb, zc, diagonal.
-		FixedMatrix<floatc_t, MaxCalibrationPoints, NumDeltaFactors> derivativeMatrix;
-		for (size_t i = 0; i < numPoints; ++i)
+		// Build the normal equations for least squares fitting. Instead of storing the Nx9 matrix of derivatives with respect to xa, xb, yc, za, zb, zc, diagonal
+		// and then multiplying it by its transpose, we accumulate the contribution of each probe point in turn. This saves stack, so we can support more probe points.
+		FixedMatrix<floatc_t, NumDeltaFactors, NumDeltaFactors + 1> normalMatrix;
+		for (size_t i = 0; i < numFactors; ++i)
 		{
-			for (size_t j = 0; j < numFactors; ++j)
+			for (size_t j = 0; j <= numFactors; ++j)
 			{
-				const size_t adjustedJ = (numFactors == 8 && j >= 6) ? j + 1 : j;		// skip diagonal rod length if doing 8-factor calibration
-				const floatc_t d =
-					ComputeDerivative(adjustedJ, probeMotorPositions(i, DELTA_A_AXIS), probeMotorPositions(i, DELTA_B_AXIS), probeMotorPositions(i, DELTA_C_AXIS));
-				if (std::isnan(d))			// a couple of users have reported getting Nans in the derivative, probably due to points being unreachable
-				{
-					reply.printf("Auto calibration failed because probe point P%u was unreachable using the current delta parameters. Try a smaller probing radius.", i);
-					return true;
-				}
-				derivativeMatrix(i, j) = d;
+				normalMatrix(i, j) = 0.0;
 			}
 		}
 
-		if (reprap.Debug(moduleMove))
+		for (size_t k = 0; k < numPoints; ++k)
 		{
-			PrintMatrix("Derivative matrix", derivativeMatrix, numPoints, numFactors);
-		}
+			floatc_t derivatives[NumDeltaFactors];
+			if (!ComputeDerivatives(numFactors, probeMotorPositions(k, DELTA_A_AXIS), probeMotorPositions(k, DELTA_B_AXIS), probeMotorPositions(k, DELTA_C_AXIS), derivatives))
+			{
+				reply.printf("Auto calibration failed because probe point P%u was unreachable using the current delta parameters. Try a smaller probing radius.", k);
+				return true;
+			}
 
-		// Now build the normal equations for least squares fitting
-		FixedMatrix<floatc_t, NumDeltaFactors, NumDeltaFactors + 1> normalMatrix;
-		for (size_t i = 0; i < numFactors; ++i)
-		{
-			for (size_t j = 0; j < numFactors; ++j)
+			const floatc_t residual = -((floatc_t)probePoints.GetZHeight(k) + corrections[k]);
+			for (size_t i = 0; i < numFactors; ++i)
 			{
-				floatc_t temp = derivativeMatrix(0, i) * derivativeMatrix(0, j);
-				for (size_t k = 1; k < numPoints; ++k)
+				for (size_t j = 0; j < numFactors; ++j)
 				{
-					temp += derivativeMatrix(k, i) * derivativeMatrix(k, j);
+					normalMatrix(i, j) += derivatives[i] * derivatives[j];
 				}
-				normalMatrix(i, j) = temp;
-			}
-			floatc_t temp = derivativeMatrix(0, i) * -((floatc_t)probePoints.GetZHeight(0) + corrections[0]);
-			for (size_t k = 1; k < numPoints; ++k)
-			{
-				temp += derivativeMatrix(k, i) * -((floatc_t)probePoints.GetZHeight(k) + corrections[k]);
+				normalMatrix(i, numFactors) += derivatives[i] * residual;
 			}
-			normalMatrix(i, numFactors) = temp;
 		}
 
 		if (reprap.Debug(moduleMove))
@@ -536,12 +524,15 @@ bool LinearDeltaKinematics::DoAutoCalibration(size_t numFactors, const RandomPro
 			// Calculate and display the residuals
 			// Save a little stack by not allocating a residuals vector, because stack for it doesn't only get reserved when debug is enabled.
 			debugPrintf("Residuals:");
+			// We didn't keep the derivatives, but the delta parameters haven't been changed yet so we can calculate them again.
 			for (size_t i = 0; i < numPoints; ++i)
 			{
+				floatc_t derivatives[NumDeltaFactors];
+				(void)ComputeDerivatives(numFactors, probeMotorPositions(i, DELTA_A_AXIS), probeMotorPositions(i, DELTA_B_AXIS), probeMotorPositions(i, DELTA_C_AXIS), derivatives);
 				floatc_t residual = probePoints.GetZHeight(i);
 				for (size_t j = 0; j < numFactors; ++j)
 				{
-					residual += solution[j] * derivativeMatrix(i, j);
+					residual += solution[j] * derivatives[j];
 				}
 				debugPrintf(" %7.4f", (double)residual);
 			}
@@ -594,10 +585,13 @@ bool LinearDeltaKinematics::DoAutoCalibration(size_t numFactors, const RandomPro
 			}
 		}
 
-		// Decide whether to do another iteration. Two is slightly better than one, but three doesn't improve things.
-		// Alternatively, we could stop when the expected RMS error is only slightly worse than the RMS of the residuals.
+		// Decide whether to do another iteration. Two is slightly better than one, but usually three doesn't improve things much,
+		// so after the second iteration we stop as soon as an iteration hasn't reduced the expected deviation significantly.
+		iterationDeviations[iteration] = finalDeviation.GetDeviationFromMean();
 		++iteration;
-		if (iteration == 2)
+		if (   iteration == MaxDeltaCalibrationIterations
+			|| (iteration >= 2 && iterationDeviations[iteration - 1] > iterationDeviations[iteration - 2] * DeltaCalibrationConvergenceRatio)
+		   )
 		{
 			break;
 		}
@@ -619,6 +613,12 @@ bool LinearDeltaKinematics::DoAutoCalibration(size_t numFactors, const RandomPro
 			numFactors, numPoints,
 			(double)initialDeviation.GetMean(), (double)initialDeviation.GetDeviationFromMean(),
 			(double)finalDeviation.GetMean(), (double)finalDeviation.GetDeviationFromMean());
+	reply.catf(", %u iterations (expected deviation", iteration);
+	for (size_t i = 0; i < iteration; ++i)
+	{
+		reply.catf(" %.3f", (double)iterationDeviations[i]);
+	}
+	reply.cat(')');
 
 	// We don't want to call MessageF(LogMessage, "%s\n", reply.c_str()) here because that will allocate a buffer within MessageF, which adds to our stack usage.
 	// Better to allocate the buffer here so that it uses the same stack space as the arrays that we have finished with
@@ -638,6 +638,23 @@ MotionType LinearDeltaKinematics::GetMotionType(size_t axis) const noexcept
 	return (axis < numTowers) ? MotionType::segmentFreeDelta : MotionType::linear;
 }
 
+// Compute the derivatives of height with respect to each of the factors being calibrated at a set of motor endpoints.
+// Return false if any of them is not a number.
+bool LinearDeltaKinematics::ComputeDerivatives(size_t numFactors, float ha, float hb, float hc, floatc_t derivatives[]) const noexcept
+{
+	for (size_t j = 0; j < numFactors; ++j)
+	{
+		const size_t adjustedJ = (numFactors == 8 && j >= 6) ? j + 1 : j;		// skip diagonal rod length if doing 8-factor calibration
+		const floatc_t d = ComputeDerivative(adjustedJ, ha, hb, hc);
+		if (std::isnan(d))			// a couple of users have reported getting Nans in the derivative, probably due to points being unreachable
+		{
+			return false;
+		}
+		derivatives[j] = d;
+	}
+	return true;
+}
+
 // Compute the derivative of height with respect to a parameter at the specified motor endpoints.
 // 'deriv' indicates the parameter as follows:
 // 0, 1, 2 = X, Y, Z tower endstop adjustments
@@ -69,6 +69,7 @@ private:
     void ForwardTransform(float Ha, float Hb, float Hc, float headPos[XYZ_AXES]) const noexcept;	// Calculate the Cartesian position from the motor positions
 
 	floatc_t ComputeDerivative(unsigned int deriv, float ha, float hb, float hc) const noexcept;	// Compute the derivative of height with respect to a parameter at a set of motor endpoints
+	bool ComputeDerivatives(size_t numFactors, float ha, float hb, float hc, floatc_t derivatives[]) const noexcept;	// Compute the derivatives of height with respect to the factors being calibrated
 	void Adjust(size_t numFactors, const floatc_t v[]) noexcept;									// Perform 3-, 4-, 6- or 7-factor adjustment
 	void PrintParameters(const StringRef& reply) const noexcept;									// Print all the parameters for debugging
 
@@ -57,24 +57,28 @@ constexpr ObjectModelTableEntry ZLeadscrewKinematics::objectModelTable[] =
 	{ "correctionFactor",	OBJECT_MODEL_FUNC(self->correctionFactor, 1), 				ObjectModelEntryFlags::none },
 	{ "lastCorrections",	OBJECT_MODEL_FUNC_NOSELF(&lastCorrectionsArrayDescriptor), 	ObjectModelEntryFlags::none },
 	{ "maxCorrection",		OBJECT_MODEL_FUNC(self->maxCorrection, 1), 					ObjectModelEntryFlags::none },
+	{ "maxPasses",			OBJECT_MODEL_FUNC((int32_t)self->maxPasses), 				ObjectModelEntryFlags::none },
 	{ "screwPitch",			OBJECT_MODEL_FUNC(self->screwPitch, 2), 					ObjectModelEntryFlags::none },
 	{ "screwX",				OBJECT_MODEL_FUNC_NOSELF(&screwXArrayDescriptor), 			ObjectModelEntryFlags::none },
 	{ "screwY",				OBJECT_MODEL_FUNC_NOSELF(&screwYArrayDescriptor), 			ObjectModelEntryFlags::none },
+	{ "targetDeviation",	OBJECT_MODEL_FUNC(self->targetDeviation, 3), 				ObjectModelEntryFlags::none },
 };
 
-constexpr uint8_t ZLeadscrewKinematics::objectModelTableDescriptor[] = { 2, 1, 6 };
+constexpr uint8_t ZLeadscrewKinematics::objectModelTableDescriptor[] = { 2, 1, 8 };
 
 DEFINE_GET_OBJECT_MODEL_TABLE_WITH_PARENT(ZLeadscrewKinematics, Kinematics)
 
 #endif
 
 ZLeadscrewKinematics::ZLeadscrewKinematics(KinematicsType k) noexcept
-	: Kinematics(k, SegmentationType(false, false, false)), numLeadscrews(0), correctionFactor(1.0), maxCorrection(1.0), screwPitch(M3ScrewPitch)
+	: Kinematics(k, SegmentationType(false, false, false)), numLeadscrews(0), correctionFactor(1.0), maxCorrection(1.0), screwPitch(M3ScrewPitch),
+	  targetDeviation(0.0), lastInitialDeviation(0.0), maxPasses(DefaultMaxLevellingPasses), lastAdjustmentMade(false)
 {
 }
 
 ZLeadscrewKinematics::ZLeadscrewKinematics(KinematicsType k, SegmentationType segType) noexcept
-	: Kinematics(k, segType), numLeadscrews(0), correctionFactor(1.0), maxCorrection(1.0), screwPitch(M3ScrewPitch)
+	: Kinematics(k, segType), numLeadscrews(0), correctionFactor(1.0), maxCorrection(1.0), screwPitch(M3ScrewPitch),
+	  targetDeviation(0.0), lastInitialDeviation(0.0), maxPasses(DefaultMaxLevellingPasses), lastAdjustmentMade(false)
 {
 }
 
@@ -103,6 +107,14 @@ bool ZLeadscrewKinematics::Configure(unsigned int mCode, GCodeBuffer& gb, const
 		gb.TryGetFValue('S', maxCorrection, seenPFS);
 		gb.TryGetFValue('P', screwPitch, seenPFS);
 		gb.TryGetFValue('F', correctionFactor, seenPFS);
+		if (gb.TryGetFValue('T', targetDeviation, seenPFS))
+		{
+			targetDeviation = max<float>(targetDeviation, 0.0);
+		}
+		if (gb.TryGetLimitedUIValue('R', maxPasses, seenPFS, MaxLevellingPasses + 1))
+		{
+			maxPasses = max<uint32_t>(maxPasses, 1);
+		}
 
 		if (seenX && seenY && xSize == ySize)
 		{
@@ -139,6 +151,10 @@ bool ZLeadscrewKinematics::Configure(unsigned int mCode, GCodeBuffer& gb, const
 				reply.catf(" (%.1f,%.1f)", (double)leadscrewX[i], (double)leadscrewY[i]);
 			}
 			reply.catf(", factor %.02f, maximum correction %.02fmm, manual adjusting screw pitch %.02fmm", (double)correctionFactor, (double)maxCorrection, (double)screwPitch);
+			if (targetDeviation > 0.0)
+			{
+				reply.catf(", target deviation %.3fmm in up to %u passes", (double)targetDeviation, (unsigned int)maxPasses);
+			}
 		}
 		return false;
 	}
@@ -159,6 +175,7 @@ bool ZLeadscrewKinematics::DoAutoCalibration(size_t numFactors, const RandomProb
 		return false;
 	}
 
+	lastAdjustmentMade = false;
 	if (numFactors != numLeadscrews)
 	{
 		reply.printf("Number of calibration factors (%u) not equal to number of leadscrews (%u)", numFactors, numLeadscrews);
@@ -385,6 +402,8 @@ bool ZLeadscrewKinematics::DoAutoCalibration(size_t numFactors, const RandomProb
 				{
 					lastCorrections[i] = solution[i];
 				}
+				lastInitialDeviation = initialDeviation.GetDeviationFromMean();
+				lastAdjustmentMade = true;
 
 				reply.printf("Leadscrew adjustments made:");
 				AppendCorrections(solution, reply);
@@ -412,6 +431,31 @@ bool ZLeadscrewKinematics::DoAutoCalibration(size_t numFactors, const RandomProb
 	return failed;
 }
 
+// Return true if we should probe the same points again and make another adjustment because the deviation measured before the last adjustment was above the target
+bool ZLeadscrewKinematics::NeedsAnotherCalibrationPass(unsigned int passesDone, const StringRef& reply) const noexcept
+{
+	if (targetDeviation <= 0.0 || !lastAdjustmentMade)
+	{
+		return false;
+	}
+
+	if (lastInitialDeviation <= targetDeviation)
+	{
+		if (passesDone > 1)
+		{
+			reply.catf("\nTarget deviation %.3fmm reached after %u passes", (double)targetDeviation, passesDone);
+		}
+		return false;
+	}
+
+	if (passesDone >= maxPasses)
+	{
+		reply.catf("\nTarget deviation %.3fmm not reached after %u passes", (double)targetDeviation, passesDone);
+		return false;
+	}
+	return true;
+}
+
 // Append the list of leadscrew corrections to 'reply'
 void ZLeadscrewKinematics::AppendCorrections(const floatc_t corrections[], const StringRef& reply) const noexcept
 {
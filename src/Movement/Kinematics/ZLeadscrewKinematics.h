@@ -20,6 +20,7 @@ public:
 	bool Configure(unsigned int mCode, GCodeBuffer& gb, const StringRef& reply, bool& error) THROWS(GCodeException) override;
 	bool SupportsAutoCalibration() const noexcept override;
 	bool DoAutoCalibration(size_t numFactors, const RandomProbePointSet& probePoints, const StringRef& reply) noexcept override;
+	bool NeedsAnotherCalibrationPass(unsigned int passesDone, const StringRef& reply) const noexcept override;
 #if HAS_MASS_STORAGE || HAS_SBC_INTERFACE
 	bool WriteResumeSettings(FileStore *f) const noexcept override;
 #endif
@@ -41,6 +42,10 @@ private:
 	float maxCorrection;
 	float screwPitch;
 	float lastCorrections[MaxLeadscrews];
+	float targetDeviation;									// if nonzero, G30 S re-probes and adjusts the leadscrews again until the deviation is no more than this
+	float lastInitialDeviation;								// the deviation that was measured before the most recent adjustment
+	uint32_t maxPasses;										// the maximum number of probing passes when levelling to the target deviation
+	bool lastAdjustmentMade;								// true if the most recent auto calibration adjusted the leadscrews
 };
 
 #endif /* SRC_MOVEMENT_KINEMATICS_ZLEADSCREWKINEMATICS_H_ */
@@ -0,0 +1,87 @@
+/*
+ * MotionBenchmark.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "MotionBenchmark.h"
+
+#if SUPPORT_MOTION_BENCHMARK
+
+MotionBenchmark::MotionBenchmark() noexcept
+{
+	Reset();
+}
+
+// Enable the DWT cycle counter. It is left free-running, so we only ever take differences between readings.
+// The profilers do the same thing, so it doesn't matter if they are enabled too.
+/*static*/ void MotionBenchmark::Init() noexcept
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if SAME70
+	DWT->LAR = 0xC5ACCE55;											// the Cortex-M7 DWT registers are locked on reset
+#endif
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+void MotionBenchmark::RecordPrepare(uint32_t cycles, FilePosition filePos) noexcept
+{
+	totalPrepareCycles += cycles;
+	++numMovesPrepared;
+	if (cycles > maxPrepareCycles)
+	{
+		maxPrepareCycles = cycles;
+		slowestPrepareFilePos = filePos;
+	}
+}
+
+// Record the step generation of one move
+void MotionBenchmark::RecordSteps(uint32_t numSteps, uint32_t cycles, uint32_t numChecked, double sumSquaredError, float maxError, FilePosition filePos) noexcept
+{
+	totalSteps += numSteps;
+	totalStepCalcCycles += cycles;
+	totalStepsChecked += numChecked;
+	totalSquaredError += sumSquaredError;
+	if (numSteps != 0 && cycles/numSteps > maxStepCalcCyclesPerStep)
+	{
+		maxStepCalcCyclesPerStep = cycles/numSteps;
+		slowestStepCalcFilePos = filePos;
+	}
+	if (maxError > maxStepError)
+	{
+		maxStepError = maxError;
+		maxStepErrorFilePos = filePos;
+	}
+}
+
+// Clear the results. The Move task has a higher priority than the tasks that call this, so we just need to stop it running.
+void MotionBenchmark::Reset() noexcept
+{
+	TaskCriticalSectionLocker lock;
+	totalPrepareCycles = totalStepCalcCycles = totalSteps = totalStepsChecked = 0;
+	totalSquaredError = 0.0;
+	numMovesPrepared = maxPrepareCycles = maxStepCalcCyclesPerStep = 0;
+	maxStepError = 0.0;
+	slowestPrepareFilePos = slowestStepCalcFilePos = maxStepErrorFilePos = noFilePosition;
+}
+
+// Append the results to the reply. This is only called when the Move task isn't simulating any more moves, so we don't need to lock out the Move task.
+void MotionBenchmark::Report(const StringRef& reply) const noexcept
+{
+	const double cyclesPerMicrosecond = (double)SystemCoreClock * 1.0e-6;
+	const double stepClocksPerMicrosecond = (double)StepClockRate * 1.0e-6;
+	reply.catf("\nBenchmark: %" PRIu32 " moves, prepare time avg %.1fus max %.1fus at file pos %" PRIu32,
+				numMovesPrepared, (double)totalPrepareCycles/(numMovesPrepared * cyclesPerMicrosecond),
+				(double)maxPrepareCycles/cyclesPerMicrosecond, slowestPrepareFilePos);
+	reply.catf("\n%" PRIu64 " steps, step calc time avg %.2fus max %.2fus at file pos %" PRIu32,
+				totalSteps, (totalSteps == 0) ? 0.0 : (double)totalStepCalcCycles/(totalSteps * cyclesPerMicrosecond),
+				(double)maxStepCalcCyclesPerStep/cyclesPerMicrosecond, slowestStepCalcFilePos);
+	reply.catf("\n%" PRIu64 " step times checked, error rms %.3fus max %.3fus at file pos %" PRIu32,
+				totalStepsChecked, (totalStepsChecked == 0) ? 0.0 : sqrt(totalSquaredError/totalStepsChecked)/stepClocksPerMicrosecond,
+				(double)maxStepError/stepClocksPerMicrosecond, maxStepErrorFilePos);
+}
+
+#endif	// SUPPORT_MOTION_BENCHMARK
+
+// End
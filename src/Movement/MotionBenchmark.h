@@ -0,0 +1,55 @@
+/*
+ * MotionBenchmark.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  This class collects the results of benchmarking the motion planning code on a G-code file. The benchmark runs when the file is simulated
+ *  in debug simulation mode (M37 P"file" S1), in which the moves are prepared and all their steps are generated as if they were being executed,
+ *  but they are not sent to the motors. We record the number of CPU cycles taken to prepare each move and to calculate its steps, the total number
+ *  of steps, and the error of each step time compared with the exact time calculated in double precision. The step times are only checked for
+ *  the axis drives of unshaped moves on machines other than deltas, because those are the ones for which the exact time is easy to calculate.
+ *  The results are reported by M37 with no parameters, and when the simulation of a file finishes.
+ */
+
+#ifndef SRC_MOVEMENT_MOTIONBENCHMARK_H_
+#define SRC_MOVEMENT_MOTIONBENCHMARK_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_MOTION_BENCHMARK
+
+class MotionBenchmark
+{
+public:
+	MotionBenchmark() noexcept;
+
+	static void Init() noexcept;												// enable the cycle counter
+	static uint32_t GetCycles() noexcept { return DWT->CYCCNT; }
+
+	// These are called by the Move task only
+	void RecordPrepare(uint32_t cycles, FilePosition filePos) noexcept;
+	void RecordSteps(uint32_t numSteps, uint32_t cycles, uint32_t numChecked, double sumSquaredError, float maxError, FilePosition filePos) noexcept;
+
+	void Reset() noexcept;														// called when debug simulation starts
+	bool HasResults() const noexcept { return numMovesPrepared != 0; }
+	void Report(const StringRef& reply) const noexcept;
+
+private:
+	uint64_t totalPrepareCycles;
+	uint64_t totalStepCalcCycles;
+	uint64_t totalSteps;
+	uint64_t totalStepsChecked;
+	double totalSquaredError;													// the sum of the squares of the step time errors, in step clocks squared
+	uint32_t numMovesPrepared;
+	uint32_t maxPrepareCycles;
+	uint32_t maxStepCalcCyclesPerStep;											// the highest average step calculation time of any move with steps
+	float maxStepError;															// the largest step time error, in step clocks
+	FilePosition slowestPrepareFilePos;											// where the moves came from that gave the above maximums
+	FilePosition slowestStepCalcFilePos;
+	FilePosition maxStepErrorFilePos;
+};
+
+#endif	// SUPPORT_MOTION_BENCHMARK
+
+#endif /* SRC_MOVEMENT_MOTIONBENCHMARK_H_ */
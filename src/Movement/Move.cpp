@@ -102,6 +102,7 @@ constexpr ObjectModelTableEntry Move::objectModelTable[] =
 	{ "currentMove",			OBJECT_MODEL_FUNC(self, 2),																		ObjectModelEntryFlags::live },
 	{ "extruders",				OBJECT_MODEL_FUNC_NOSELF(&extrudersArrayDescriptor),											ObjectModelEntryFlags::live },
 	{ "idle",					OBJECT_MODEL_FUNC(self, 1),																		ObjectModelEntryFlags::none },
+	{ "junctionDeviation",		OBJECT_MODEL_FUNC(self->junctionDeviation, 3),													ObjectModelEntryFlags::none },
 	{ "kinematics",				OBJECT_MODEL_FUNC(self->kinematics),															ObjectModelEntryFlags::none },
 	{ "limitAxes",				OBJECT_MODEL_FUNC_NOSELF(reprap.GetGCodes().LimitAxes()),										ObjectModelEntryFlags::none },
 	{ "noMovesBeforeHoming",	OBJECT_MODEL_FUNC_NOSELF(reprap.GetGCodes().NoMovesBeforeHoming()),								ObjectModelEntryFlags::none },
@@ -111,7 +112,11 @@ constexpr ObjectModelTableEntry Move::objectModelTable[] =
 	{ "rotation",				OBJECT_MODEL_FUNC(self, 44),																	ObjectModelEntryFlags::none },
 #endif
 	{ "shaping",				OBJECT_MODEL_FUNC(&self->axisShaper, 0),														ObjectModelEntryFlags::none },
+	{ "shapingY",				OBJECT_MODEL_FUNC_IF(self->useYAxisShaper, &self->yAxisShaper, 0),								ObjectModelEntryFlags::none },
 	{ "speedFactor",			OBJECT_MODEL_FUNC_NOSELF(reprap.GetGCodes().GetSpeedFactor(), 2),								ObjectModelEntryFlags::none },
+#if SUPPORT_STEP_ISR_PROFILING
+	{ "stepIsr",				OBJECT_MODEL_FUNC(&self->stepIsrProfiler, 0),													ObjectModelEntryFlags::live },
+#endif
 	{ "travelAcceleration",		OBJECT_MODEL_FUNC(InverseConvertAcceleration(self->maxTravelAcceleration), 1),					ObjectModelEntryFlags::none },
 	{ "virtualEPos",			OBJECT_MODEL_FUNC_NOSELF(reprap.GetGCodes().GetVirtualExtruderPosition(), 5),					ObjectModelEntryFlags::live },
 	{ "workplaceNumber",		OBJECT_MODEL_FUNC_NOSELF((int32_t)reprap.GetGCodes().GetWorkplaceCoordinateSystemNumber() - 1),	ObjectModelEntryFlags::none },
@@ -175,7 +180,7 @@ constexpr ObjectModelTableEntry Move::objectModelTable[] =
 constexpr uint8_t Move::objectModelTableDescriptor[] =
 {
 	9 + SUPPORT_COORDINATE_ROTATION,
-	17 + SUPPORT_WORKPLACE_COORDINATES,
+	19 + SUPPORT_WORKPLACE_COORDINATES + SUPPORT_STEP_ISR_PROFILING,
 	2,
 	4 + SUPPORT_LASER,
 	3,
@@ -203,16 +208,22 @@ Move::Move() noexcept
 	  heightController(nullptr),
 #endif
 	  maxPrintingAcceleration(ConvertAcceleration(DefaultPrintingAcceleration)), maxTravelAcceleration(ConvertAcceleration(DefaultTravelAcceleration)),
-	  jerkPolicy(0),
-	  numCalibratedFactors(0)
+	  jerkPolicy(0), junctionDeviation(0.0),
+	  arcMaxDeviation(MaxArcDeviation), arcMaxSegmentLength(MaxArcSegmentLength),
+	  mergeMinCosAngle(2.0), mergeMaxLength(DefaultMaxMergedMoveLength), maxStepsPerClock(DefaultMaxStepRate/StepClockRate),
+	  useYAxisShaper(false), numCalibratedFactors(0)
 {
 	// Kinematics must be set up here because GCodes::Init asks the kinematics for the assumed initial position
 	kinematics = Kinematics::Create(KinematicsType::cartesian);		// default to Cartesian
+#if SUPPORT_DYNAMIC_DDA_RING
+	mainDDARing.Init1(InitialDdaRingLength, MaxDdaRingLength);
+#else
 	mainDDARing.Init1(InitialDdaRingLength);
+#endif
 #if SUPPORT_ASYNC_MOVES
 	auxDDARing.Init1(AuxDdaRingLength);
 #endif
-	DriveMovement::InitialAllocate(InitialNumDms);
+	DriveMovement::InitialAllocate(NumDmsForRingLength(mainDDARing.GetNumDdasInRing()));
 }
 
 void Move::Init() noexcept
@@ -229,9 +240,11 @@ void Move::Init() noexcept
 	SetIdentityTransform();
 	compensateXY = true;
 	tangents[0] = tangents[1] = tangents[2] = 0.0;
+	usingSkewCompensation = false;
 
 	usingMesh = useTaper = false;
 	zShift = 0.0;
+	latestLiveCoordinatesTool = nullptr;
 
 	idleTimeout = DefaultIdleTimeout;
 	moveState = MoveState::idle;
@@ -240,6 +253,21 @@ void Move::Init() noexcept
 	simulationMode = SimulationMode::off;
 	longestGcodeWaitInterval = 0;
 	bedLevellingMoveAvailable = false;
+	mergedMovePending = flushMergedMoveRequested = false;
+	lastMoveEndValid = false;
+	lastMoveFilePos = noFilePosition;
+	numMovesMerged = 0;
+	numStepRateLimitedMoves = 0;
+
+#if SUPPORT_STEP_ISR_PROFILING
+	StepIsrProfiler::Init();
+#endif
+#if SUPPORT_PREPARE_PROFILING
+	PrepareProfiler::Init();
+#endif
+#if SUPPORT_MOTION_BENCHMARK
+	MotionBenchmark::Init();
+#endif
 
 	moveTask.Create(MoveStart, "Move", this, TaskPriority::MovePriority);
 }
@@ -268,6 +296,10 @@ void Move::Exit() noexcept
 		auxDDARing.RecycleDDAs();
 #endif
 
+		// Make sure that DDA::Prepare will find enough free segments and DMs, so that it rarely has to allocate from the heap
+		MoveSegment::TopUp();
+		DriveMovement::TopUp();
+
 		// See if we can add another move to the ring
 		bool moveRead = false;
 		const bool canAddMove = mainDDARing.CanAddMove();
@@ -292,6 +324,15 @@ void Move::Exit() noexcept
 					}
 				}
 				bedLevellingMoveAvailable = false;
+				lastMoveEndValid = false;
+			}
+			else if (   mergedMovePending
+					 && (flushMergedMoveRequested || !IsMergeCandidate(mergedMove) || millis() - whenMergedMoveStarted >= MergeHoldMillis)
+					)
+			{
+				// We have been holding a move back but we can't or needn't wait any longer for another move to merge with it
+				moveRead = true;
+				FlushMergedMove();
 			}
 			else
 			{
@@ -302,21 +343,22 @@ void Move::Exit() noexcept
 					moveRead = true;
 					if (simulationMode < SimulationMode::partial)		// in simulation mode partial, we don't process incoming moves beyond this point
 					{
-						if (nextMove.moveType == 0)
+						if (!TryMergeMove(nextMove))
 						{
-							AxisAndBedTransform(nextMove.coords, nextMove.tool, true);
-						}
+							if (mergedMovePending)
+							{
+								FlushMergedMove();
+							}
 
-						if (mainDDARing.AddStandardMove(nextMove, !IsRawMotorMove(nextMove.moveType)))
-						{
-							const uint32_t now = millis();
-							const uint32_t timeWaiting = now - whenLastMoveAdded;
-							if (timeWaiting > longestGcodeWaitInterval)
+							if (mergeMinCosAngle <= 1.0)
+							{
+								HoldMove(nextMove);						// hold it back in case the next move can be merged with it
+							}
+							else
 							{
-								longestGcodeWaitInterval = timeWaiting;
+								lastMoveEndValid = false;
+								AddMoveToMainRing(nextMove);
 							}
-							whenLastMoveAdded = now;
-							moveState = MoveState::collecting;
 						}
 					}
 				}
@@ -383,9 +425,188 @@ void Move::Exit() noexcept
 		// 3. In order to implement idle timeout, we must wake up regularly anyway, say every half second
 		if (!moveRead && nextPrepareDelay != 0)
 		{
-			TaskBase::Take(min<uint32_t>(nextPrepareDelay, 500));
+			TaskBase::Take(min<uint32_t>(nextPrepareDelay, (mergedMovePending) ? MergeHoldMillis : 500));
+		}
+	}
+}
+
+// Apply the axis and bed transforms to a move and add it to the main DDA ring
+void Move::AddMoveToMainRing(RawMove& m) noexcept
+{
+	if (m.moveType == 0)
+	{
+		AxisAndBedTransform(m.coords, m.tool, true);
+	}
+
+	if (mainDDARing.AddStandardMove(m, !IsRawMotorMove(m.moveType)))
+	{
+		const uint32_t now = millis();
+		const uint32_t timeWaiting = now - whenLastMoveAdded;
+		if (timeWaiting > longestGcodeWaitInterval)
+		{
+			longestGcodeWaitInterval = timeWaiting;
+		}
+		whenLastMoveAdded = now;
+		moveState = MoveState::collecting;
+	}
+}
+
+// Get the length of the straight segments that an arc move of the specified radius is split into. 'speed' is the requested speed in mm per step clock.
+// For the arc to deviate up to arcMaxDeviation from the ideal, the segment length should be sqrtf(8 * arcRadius * arcMaxDeviation + fsquare(arcMaxDeviation))
+// We leave out the square term because it is very small.
+// In CNC applications even very small deviations can be visible, so we use a smaller segment length at low speeds.
+float Move::GetArcSegmentLength(float arcRadius, float speed) const noexcept
+{
+	return constrain<float>(min<float>(fastSqrtf(8 * arcRadius * arcMaxDeviation), speed * StepClockRate * (1.0/MinArcSegmentsPerSec)),
+							MinArcSegmentLength,
+							arcMaxSegmentLength
+						   );
+}
+
+// Return true if a move is of a type that we may merge with an adjacent move
+bool Move::IsMergeCandidate(const RawMove& m) const noexcept
+{
+	return m.moveType == 0 && m.isCoordinated && !m.checkEndstops && !m.reduceAcceleration && m.proportionDone == 1.0;
+}
+
+// Hold back a move that we were given, so that we can try to merge the following move with it
+void Move::HoldMove(const RawMove& m) noexcept
+{
+	mergedMove = m;
+	mergedMoveIsWholeMove = (m.filePos == noFilePosition || m.filePos != lastMoveFilePos);
+	mergedMoveStartValid = lastMoveEndValid && m.moveType == 0;
+	if (mergedMoveStartValid)
+	{
+		memcpyf(mergedMoveStartCoords, lastMoveEndCoords, MaxAxes);
+		float sumOfSquares = 0.0;
+		for (size_t axis = 0; axis < reprap.GetGCodes().GetTotalAxes(); ++axis)
+		{
+			sumOfSquares += fsquare(m.coords[axis] - mergedMoveStartCoords[axis]);
 		}
+		mergedMoveLength = fastSqrtf(sumOfSquares);
+	}
+
+	lastMoveFilePos = m.filePos;
+	lastMoveEndValid = (m.moveType == 0);
+	memcpyf(lastMoveEndCoords, m.coords, MaxAxes);
+	whenMergedMoveStarted = millis();
+	mergedMovePending = true;
+}
+
+// Add the move we are holding back to the DDA ring
+void Move::FlushMergedMove() noexcept
+{
+	mergedMovePending = flushMergedMoveRequested = false;
+	AddMoveToMainRing(mergedMove);
+}
+
+// Try to merge a new move into the move we are holding back, returning true if successful.
+// We merge moves only if they have the same motion parameters, the change of direction between them is small, the extrusion per mm is the same and the merged move is not too long.
+bool Move::TryMergeMove(const RawMove& m) noexcept
+{
+	if (   !mergedMovePending || !mergedMoveStartValid || !mergedMoveIsWholeMove || usingMesh
+		|| !IsMergeCandidate(mergedMove) || !IsMergeCandidate(m)
+		|| m.filePos == lastMoveFilePos												// the new move is a segment of an arc or other segmented move
+		|| m.tool != mergedMove.tool || m.feedRate != mergedMove.feedRate
+		|| m.usePressureAdvance != mergedMove.usePressureAdvance || m.applyM220M221 != mergedMove.applyM220M221
+		|| m.usingStandardFeedrate != mergedMove.usingStandardFeedrate
+#if SUPPORT_LASER || SUPPORT_IOBITS
+		|| memcmp(&m.laserPwmOrIoBits, &mergedMove.laserPwmOrIoBits, sizeof(LaserPwmOrIoBits)) != 0
+#endif
+	   )
+	{
+		return false;
+	}
+
+	// Check the change in direction, using the direction of the merged move so far so that errors can't accumulate
+	const size_t numTotalAxes = reprap.GetGCodes().GetTotalAxes();
+	float newLengthSquared = 0.0, dotProduct = 0.0;
+	for (size_t axis = 0; axis < numTotalAxes; ++axis)
+	{
+		const float delta = m.coords[axis] - mergedMove.coords[axis];
+		newLengthSquared += fsquare(delta);
+		dotProduct += delta * (mergedMove.coords[axis] - mergedMoveStartCoords[axis]);
+	}
+	const float newLength = fastSqrtf(newLengthSquared);
+	if (   newLength <= 0.0 || mergedMoveLength <= 0.0
+		|| mergedMoveLength + newLength > mergeMaxLength
+		|| dotProduct < mergeMinCosAngle * newLength * mergedMoveLength
+	   )
+	{
+		return false;
+	}
+
+	// Check that the extrusion per mm is the same for all extruders
+	const size_t numExtruders = reprap.GetGCodes().GetNumExtruders();
+	for (size_t extruder = 0; extruder < numExtruders; ++extruder)
+	{
+		const size_t drive = ExtruderToLogicalDrive(extruder);
+		const float oldRatio = mergedMove.coords[drive]/mergedMoveLength;
+		const float newRatio = m.coords[drive]/newLength;
+		if (fabsf(newRatio - oldRatio) > MaxMergeExtrusionRatioError * max<float>(fabsf(oldRatio), fabsf(newRatio)))
+		{
+			return false;
+		}
+	}
+
+	// Merge the moves. The file position, virtual extruder position and angle from the previous move are those of the first move.
+	for (size_t axis = 0; axis < numTotalAxes; ++axis)
+	{
+		mergedMove.coords[axis] = m.coords[axis];
+	}
+	for (size_t extruder = 0; extruder < numExtruders; ++extruder)
+	{
+		const size_t drive = ExtruderToLogicalDrive(extruder);
+		mergedMove.coords[drive] += m.coords[drive];
+	}
+	mergedMove.canPauseAfter = m.canPauseAfter;
+	mergedMove.hasPositiveExtrusion |= m.hasPositiveExtrusion;
+	mergedMove.linearAxesMentioned |= m.linearAxesMentioned;
+	mergedMove.rotationalAxesMentioned |= m.rotationalAxesMentioned;
+
+	// Recalculate the length rather than adding the lengths, so that the direction check on the next move uses the true direction of the merged move
+	float sumOfSquares = 0.0;
+	for (size_t axis = 0; axis < numTotalAxes; ++axis)
+	{
+		sumOfSquares += fsquare(mergedMove.coords[axis] - mergedMoveStartCoords[axis]);
+	}
+	mergedMoveLength = fastSqrtf(sumOfSquares);
+
+	lastMoveFilePos = m.filePos;
+	memcpyf(lastMoveEndCoords, m.coords, MaxAxes);
+	++numMovesMerged;
+	return true;
+}
+
+// If we are holding back a move, discard it and set up the restore point to resume from its start.
+// Called from the Main task with the Move task locked out by the caller.
+bool Move::SkipMergedMove(RestorePoint& rp, float speedFactor) noexcept
+{
+	if (!mergedMovePending || !mergedMoveIsWholeMove || !mergedMoveStartValid || mergedMove.filePos == noFilePosition)
+	{
+		return false;
+	}
+
+	const size_t numVisibleAxes = reprap.GetGCodes().GetVisibleAxes();
+	for (size_t axis = 0; axis < numVisibleAxes; ++axis)
+	{
+		rp.moveCoords[axis] = mergedMoveStartCoords[axis];
+	}
+	rp.proportionDone = 0.0;
+	rp.initialUserC0 = mergedMove.initialUserC0;
+	rp.initialUserC1 = mergedMove.initialUserC1;
+	if (mergedMove.usingStandardFeedrate)
+	{
+		rp.feedRate = mergedMove.feedRate/speedFactor;
 	}
+	rp.virtualExtruderPosition = mergedMove.virtualExtruderPosition;
+	rp.filePos = mergedMove.filePos;
+#if SUPPORT_LASER || SUPPORT_IOBITS
+	rp.laserPwmOrIoBits = mergedMove.laserPwmOrIoBits;
+#endif
+	mergedMovePending = flushMergedMoveRequested = false;
+	lastMoveEndValid = false;
+	return true;
 }
 
 // This is called from GCodes to tell the Move task that a move is available
@@ -400,6 +621,12 @@ void Move::MoveAvailable() noexcept
 // Tell the lookahead ring we are waiting for it to empty and return true if it is
 bool Move::WaitingForAllMovesFinished() noexcept
 {
+	if (mergedMovePending)
+	{
+		flushMergedMoveRequested = true;							// ask the Move task to add the move it is holding back to the ring
+		MoveAvailable();
+		return false;
+	}
 	return mainDDARing.SetWaitingToEmpty();
 }
 
@@ -433,6 +660,7 @@ bool Move::SetKinematics(KinematicsType k) noexcept
 		}
 		delete kinematics;
 		kinematics = nk;
+		mainDDARing.FlagLiveCoordinatesChanged();
 		reprap.MoveUpdated();
 	}
 	return true;
@@ -453,7 +681,16 @@ bool Move::IsAccessibleProbePoint(float axesCoords[MaxAxes], AxesBitmap axes) co
 // Pause the print as soon as we can, returning true if we are able to skip any moves and updating 'rp' to the first move we skipped.
 bool Move::PausePrint(RestorePoint& rp, float speedFactor) noexcept
 {
-	return mainDDARing.PauseMoves(rp, speedFactor);
+	TaskCriticalSectionLocker lock;							// lock out the Move task while we look at the move it may be holding back
+
+	if (mainDDARing.PauseMoves(rp, speedFactor))
+	{
+		// We skipped some moves in the ring, so we also skip any move that we are holding back
+		mergedMovePending = flushMergedMoveRequested = false;
+		lastMoveEndValid = false;
+		return true;
+	}
+	return SkipMergedMove(rp, speedFactor);
 }
 
 #if HAS_VOLTAGE_MONITOR || HAS_STALL_DETECT
@@ -461,7 +698,26 @@ bool Move::PausePrint(RestorePoint& rp, float speedFactor) noexcept
 // Pause the print immediately, returning true if we were able to skip or abort any moves and setting up to the move we aborted
 bool Move::LowPowerOrStallPause(RestorePoint& rp) noexcept
 {
-	return mainDDARing.LowPowerOrStallPause(rp);
+	TaskCriticalSectionLocker lock;							// lock out the Move task while we look at the move it may be holding back
+
+	if (mainDDARing.LowPowerOrStallPause(rp))
+	{
+		mergedMovePending = flushMergedMoveRequested = false;
+		lastMoveEndValid = false;
+		return true;
+	}
+	return SkipMergedMove(rp, 1.0);
+}
+
+#endif
+
+#if SUPPORT_RESUME_SNAPSHOT
+
+// Get the start of the move being executed, or of the next move if none is, for a resume snapshot. The moves are not changed.
+bool Move::GetResumePoint(RestorePoint& rp) const noexcept
+{
+	TaskCriticalSectionLocker lock;							// lock out the Move task while we look at the ring
+	return mainDDARing.GetResumePoint(rp);
 }
 
 #endif
@@ -477,9 +733,21 @@ void Move::Diagnostics(MessageType mtype) noexcept
 	scratchString.copy(GetCompensationTypeString());
 
 	Platform& p = reprap.GetPlatform();
-	p.MessageF(mtype, "=== Move ===\nDMs created %u, segments created %u, maxWait %" PRIu32 "ms, bed compensation in use: %s, comp offset %.3f\n",
-						DriveMovement::NumCreated(), MoveSegment::NumCreated(), longestGcodeWaitInterval, scratchString.c_str(), (double)zShift);
+	p.MessageF(mtype, "=== Move ===\nDMs created %u, segments created %u (%u bytes), maxWait %" PRIu32 "ms, bed compensation in use: %s, comp offset %.3f, moves merged %" PRIu32 ", step rate limited %" PRIu32 "\n",
+						DriveMovement::NumCreated(), MoveSegment::NumCreated(), MoveSegment::NumCreated() * (unsigned int)sizeof(MoveSegment), longestGcodeWaitInterval, scratchString.c_str(), (double)zShift,
+						numMovesMerged, numStepRateLimitedMoves);
 	longestGcodeWaitInterval = 0;
+	numMovesMerged = 0;
+	numStepRateLimitedMoves = 0;
+
+	{
+		String<StringLength256> poolString;
+		MoveSegment::PoolDiagnostics(poolString.GetRef());
+		poolString.cat("; ");
+		DriveMovement::PoolDiagnostics(poolString.GetRef());
+		p.MessageF(mtype, "%s\n", poolString.c_str());
+	}
+	p.GetEndstops().Diagnostics(mtype);
 
 #if 0	// debug only
 	scratchString.copy("Steps requested/done:");
@@ -520,6 +788,13 @@ void Move::Diagnostics(MessageType mtype) noexcept
 #else
 	mainDDARing.Diagnostics(mtype, "");
 #endif
+
+#if SUPPORT_STEP_ISR_PROFILING
+	stepIsrProfiler.Diagnostics(mtype);
+#endif
+#if SUPPORT_PREPARE_PROFILING
+	prepareProfiler.Diagnostics(mtype);
+#endif
 }
 
 // Set the current position to be this
@@ -527,6 +802,7 @@ void Move::SetNewPosition(const float positionNow[MaxAxesPlusExtruders], bool do
 {
 	float newPos[MaxAxesPlusExtruders];
 	memcpyf(newPos, positionNow, ARRAY_SIZE(newPos));			// copy to local storage because Transform modifies it
+	lastMoveEndValid = false;									// don't merge the next move with the previous one
 	AxisAndBedTransform(newPos, reprap.GetCurrentTool(), doBedCompensation);
 
 	mainDDARing.SetLiveCoordinates(newPos);
@@ -605,6 +881,11 @@ void Move::InverseAxisAndBedTransform(float xyzPoint[MaxAxes], const Tool *tool)
 // Do the Axis transform BEFORE the bed transform
 void Move::AxisTransform(float xyzPoint[MaxAxes], const Tool *tool) const noexcept
 {
+	if (!usingSkewCompensation)
+	{
+		return;												// the usual case, so avoid looking up the axis mapping for every move and coordinate query
+	}
+
 	// Identify the lowest Y axis
 	const size_t numVisibleAxes = reprap.GetGCodes().GetVisibleAxes();
 	const AxesBitmap yAxes = Tool::GetYAxes(tool);
@@ -631,6 +912,11 @@ void Move::AxisTransform(float xyzPoint[MaxAxes], const Tool *tool) const noexce
 // Invert the Axis transform AFTER the bed transform
 void Move::InverseAxisTransform(float xyzPoint[MaxAxes], const Tool *tool) const noexcept
 {
+	if (!usingSkewCompensation)
+	{
+		return;												// the usual case, so avoid looking up the axis mapping for every move and coordinate query
+	}
+
 	// Identify the lowest Y axis
 	const size_t numVisibleAxes = reprap.GetGCodes().GetVisibleAxes();
 	const AxesBitmap yAxes = Tool::GetYAxes(tool);
@@ -736,6 +1022,7 @@ void Move::SetZeroHeightError(const float coords[MaxAxes]) noexcept
 	{
 		zShift = 0.0;
 	}
+	mainDDARing.FlagLiveCoordinatesChanged();
 }
 
 void Move::SetIdentityTransform() noexcept
@@ -745,6 +1032,7 @@ void Move::SetIdentityTransform() noexcept
 	heightMap.UseHeightMap(false);
 	usingMesh = false;
 	zShift = 0.0;
+	mainDDARing.FlagLiveCoordinatesChanged();
 	reprap.MoveUpdated();
 }
 
@@ -764,6 +1052,7 @@ bool Move::LoadHeightMapFromFile(FileStore *f, const char *fname, const StringRe
 	}
 	float minError, maxError;
 	(void)heightMap.GetStatistics(latestMeshDeviation, minError, maxError);
+	mainDDARing.FlagLiveCoordinatesChanged();
 	reprap.MoveUpdated();
 	return err;
 }
@@ -784,6 +1073,7 @@ void Move::SetTaperHeight(float h) noexcept
 		taperHeight = h;
 		recipTaperHeight = 1.0/h;
 	}
+	mainDDARing.FlagLiveCoordinatesChanged();
 	reprap.MoveUpdated();
 }
 
@@ -791,6 +1081,7 @@ void Move::SetTaperHeight(float h) noexcept
 bool Move::UseMesh(bool b) noexcept
 {
 	usingMesh = heightMap.UseHeightMap(b);
+	mainDDARing.FlagLiveCoordinatesChanged();
 	reprap.MoveUpdated();
 	return usingMesh;
 }
@@ -805,6 +1096,8 @@ void Move::SetAxisCompensation(unsigned int axis, float tangent) noexcept
 	if (axis < ARRAY_SIZE(tangents))
 	{
 		tangents[axis] = tangent;
+		usingSkewCompensation = (tangents[0] != 0.0 || tangents[1] != 0.0 || tangents[2] != 0.0);
+		mainDDARing.FlagLiveCoordinatesChanged();
 		reprap.MoveUpdated();
 	}
 }
@@ -817,6 +1110,7 @@ bool Move::IsXYCompensated() const
 void Move::SetXYCompensation(bool xyCompensation)
 {
 	compensateXY = xyCompensation;
+	mainDDARing.FlagLiveCoordinatesChanged();
 	reprap.MoveUpdated();
 }
 
@@ -869,6 +1163,7 @@ bool Move::FinishedBedProbing(int sParam, const StringRef& reply) noexcept
 	// Clear out the Z heights so that we don't re-use old points.
 	// This allows us to use different numbers of probe point on different occasions.
 	probePoints.ClearProbeHeights();
+	mainDDARing.FlagLiveCoordinatesChanged();			// the bed transform may have changed
 	return error;
 }
 
@@ -938,6 +1233,12 @@ void Move::Simulate(SimulationMode simMode) noexcept
 	{
 		mainDDARing.ResetSimulationTime();
 	}
+#if SUPPORT_MOTION_BENCHMARK
+	if (simMode == SimulationMode::debug)
+	{
+		motionBenchmark.Reset();
+	}
+#endif
 }
 
 // Adjust the leadscrews
@@ -1013,8 +1314,95 @@ GCodeResult Move::ConfigureAccelerations(GCodeBuffer&gb, const StringRef& reply)
 // Process M595
 GCodeResult Move::ConfigureMovementQueue(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
 {
+	// K is the limit on the total step rate of local drivers in steps per second, or 0 for no limit
+	if (gb.Seen('K'))
+	{
+		maxStepsPerClock = max<float>(gb.GetFValue(), 0.0)/StepClockRate;
+		if (!gb.SeenAny("DUPSRTBNCLQ"))
+		{
+			return GCodeResult::ok;
+		}
+	}
+
+	// Arc segmentation: D is the maximum deviation from the ideal arc, U is the maximum segment length
+	bool seenArc = false;
+	gb.TryGetFValue('D', arcMaxDeviation, seenArc);
+	gb.TryGetFValue('U', arcMaxSegmentLength, seenArc);
+	if (seenArc)
+	{
+		arcMaxDeviation = max<float>(arcMaxDeviation, MinArcDeviation);
+		arcMaxSegmentLength = max<float>(arcMaxSegmentLength, MinArcSegmentLength);
+		if (!gb.SeenAny("PSRTBNCL"))
+		{
+			return GCodeResult::ok;
+		}
+	}
+
 	const size_t ringNumber = (gb.Seen('Q')) ? gb.GetLimitedUIValue('Q', ARRAY_SIZE(rings)) : 0;
-	return rings[ringNumber].ConfigureMovementQueue(gb, reply);
+	if (ringNumber == 0)
+	{
+		// Move merging applies to the main ring only. C is the maximum change of direction in degrees (0 = merging disabled), L is the maximum merged move length.
+		bool seenMerge = false;
+		float maxMergeAngle = (mergeMinCosAngle > 1.0) ? 0.0 : acosf(mergeMinCosAngle) * RadiansToDegrees;
+		gb.TryGetFValue('C', maxMergeAngle, seenMerge);
+		gb.TryGetFValue('L', mergeMaxLength, seenMerge);
+		if (seenMerge)
+		{
+			mergeMinCosAngle = (maxMergeAngle <= 0.0) ? 2.0 : cosf(min<float>(maxMergeAngle, MaxMergeAngle) * DegreesToRadians);
+			if (!gb.SeenAny("PSRTBN"))
+			{
+				return GCodeResult::ok;
+			}
+		}
+	}
+
+	const GCodeResult rslt = rings[ringNumber].ConfigureMovementQueue(gb, reply);
+	if (ringNumber == 0 && reply.strlen() != 0)
+	{
+		if (mergeMinCosAngle > 1.0)
+		{
+			reply.cat(", move merging disabled");
+		}
+		else
+		{
+			reply.catf(", merging moves up to %.1fmm with direction change up to %.2fdeg",
+						(double)mergeMaxLength, (double)(acosf(mergeMinCosAngle) * RadiansToDegrees));
+		}
+		reply.catf(", arc segments up to %.2fmm with deviation up to %.3fmm", (double)arcMaxSegmentLength, (double)arcMaxDeviation);
+		if (maxStepsPerClock > 0.0)
+		{
+			reply.catf(", total step rate limited to %.0f steps/sec", (double)(maxStepsPerClock * StepClockRate));
+		}
+		else
+		{
+			reply.cat(", no step rate limit");
+		}
+	}
+	return rslt;
+}
+
+// Process M593. Y1 selects the separate input shaper for moves that are mostly along the Y axis, Y0 selects the main shaper.
+GCodeResult Move::ConfigureInputShaping(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
+{
+	if (gb.Seen('Y'))
+	{
+		if (gb.GetUIValue() == 0)
+		{
+			return axisShaper.Configure(gb, reply);
+		}
+		const GCodeResult rslt = yAxisShaper.Configure(gb, reply);
+		if (rslt == GCodeResult::ok && gb.SeenAny("FSPHT"))
+		{
+			useYAxisShaper = true;
+			reprap.MoveUpdated();
+		}
+		if (reply.strlen() != 0)
+		{
+			reply.Prepend((useYAxisShaper) ? "Y axis: " : "Y axis (not in use): ");
+		}
+		return rslt;
+	}
+	return axisShaper.Configure(gb, reply);
 }
 
 // Process M572
@@ -1184,6 +1572,13 @@ void Move::RevertPosition(const CanMessageRevertPosition& msg) noexcept
 // Interrupts are assumed enabled on entry
 float Move::LiveCoordinate(unsigned int axisOrExtruder, const Tool *tool) noexcept
 {
+	// The cached coordinates are reused until a move completes, the motor positions are set, or the transform changes.
+	// So polling the position of an idle machine doesn't need the forward kinematics or the inverse bed transform.
+	if (tool != latestLiveCoordinatesTool)
+	{
+		latestLiveCoordinatesTool = tool;
+		mainDDARing.FlagLiveCoordinatesChanged();
+	}
 	if (mainDDARing.HaveLiveCoordinatesChanged())
 	{
 		mainDDARing.LiveCoordinates(latestLiveCoordinates);
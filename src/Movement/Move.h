@@ -11,6 +11,10 @@
 #include <RepRapFirmware.h>
 #include "AxisShaper.h"
 #include "ExtruderShaper.h"
+#include "StepIsrProfiler.h"
+#include "PrepareProfiler.h"
+#include "MotionBenchmark.h"
+#include "MoveLog.h"
 #include "DDARing.h"
 #include "DDA.h"								// needed because of our inline functions
 #include "BedProbing/RandomProbePointSet.h"
@@ -30,14 +34,21 @@
 #if SAME70
 
 constexpr unsigned int InitialDdaRingLength = 60;
+constexpr unsigned int MaxDdaRingLength = 200;							// the most DDAs we put in the main ring at startup if SUPPORT_DYNAMIC_DDA_RING is set
 constexpr unsigned int AuxDdaRingLength = 5;
-const unsigned int InitialNumDms = (InitialDdaRingLength/2 * 4) + AuxDdaRingLength;
 
 #elif SAM4E || SAM4S || SAME5x
 
 constexpr unsigned int InitialDdaRingLength = 40;
+constexpr unsigned int MaxDdaRingLength = 80;							// the most DDAs we put in the main ring at startup if SUPPORT_DYNAMIC_DDA_RING is set
 constexpr unsigned int AuxDdaRingLength = 3;
-const unsigned int InitialNumDms = (InitialDdaRingLength/2 * 4) + AuxDdaRingLength;
+
+#endif
+
+#if SAME70 || SAM4E || SAM4S || SAME5x
+
+// Return the number of DMs we allocate for a main DDA ring of the specified length
+constexpr unsigned int NumDmsForRingLength(unsigned int ringLength) noexcept { return (ringLength/2 * 4) + AuxDdaRingLength; }
 
 #else
 
@@ -47,6 +58,21 @@ const unsigned int NumDms = 20 * 5;												// suitable for e.g. a delta + 2-
 
 #endif
 
+constexpr float DefaultMaxMergedMoveLength = 5.0;						// the default maximum length in mm of a move made by merging collinear moves
+constexpr float MaxMergeAngle = 10.0;									// the largest change of direction in degrees that we allow between merged moves
+
+// The default limit on the total step rate of all local drivers in steps per second, which M595 K can change.
+// These are conservative estimates of what DDA::StepDrivers can sustain with several drivers moving; beyond this the step ISR inserts hiccups.
+#if SAME70
+constexpr float DefaultMaxStepRate = 600000.0;
+#elif SAME5x
+constexpr float DefaultMaxStepRate = 400000.0;
+#elif SAM4E || SAM4S
+constexpr float DefaultMaxStepRate = 250000.0;
+#else
+constexpr float DefaultMaxStepRate = 150000.0;
+#endif
+
 // This is the master movement class.  It controls all movement in the machine.
 class Move INHERIT_OBJECT_MODEL
 {
@@ -104,8 +130,24 @@ public:
 
 	float GetMaxPrintingAcceleration() const noexcept { return maxPrintingAcceleration; }
 	float GetMaxTravelAcceleration() const noexcept { return maxTravelAcceleration; }
+	float GetMaxStepsPerClock() const noexcept { return maxStepsPerClock; }			// get the total step rate limit for local drivers in steps per step clock, or 0 if none
+	void RecordStepRateLimitedMove() noexcept { ++numStepRateLimitedMoves; }
 	AxisShaper& GetAxisShaper() noexcept { return axisShaper; }
+	const AxisShaper& GetAxisShaperForMove(const float directionVector[]) const noexcept;	// Get the input shaper to use for a move
+	GCodeResult ConfigureInputShaping(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);		// process M593
 	ExtruderShaper& GetExtruderShaper(size_t extruder) noexcept { return extruderShapers[extruder]; }
+#if SUPPORT_STEP_ISR_PROFILING
+	StepIsrProfiler& GetStepIsrProfiler() noexcept { return stepIsrProfiler; }
+#endif
+#if SUPPORT_PREPARE_PROFILING
+	PrepareProfiler& GetPrepareProfiler() noexcept { return prepareProfiler; }
+#endif
+#if SUPPORT_MOTION_BENCHMARK
+	MotionBenchmark& GetMotionBenchmark() noexcept { return motionBenchmark; }
+#endif
+#if SUPPORT_MOVE_LOG
+	MoveLog& GetMoveLog() noexcept { return moveLog; }
+#endif
 
 	void Diagnostics(MessageType mtype) noexcept;							// Report useful stuff
 
@@ -138,6 +180,9 @@ public:
 #if HAS_VOLTAGE_MONITOR || HAS_STALL_DETECT
 	bool LowPowerOrStallPause(RestorePoint& rp) noexcept;									// Pause the print immediately, returning true if we were able to
 #endif
+#if SUPPORT_RESUME_SNAPSHOT
+	bool GetResumePoint(RestorePoint& rp) const noexcept;									// Get the point that we would resume from if power failed now, without pausing
+#endif
 
 	bool NoLiveMovement() const noexcept { return mainDDARing.IsIdle(); }					// Is a move running, or are there any queued?
 
@@ -160,6 +205,9 @@ public:
 	float GetRequestedSpeedMmPerSec() const noexcept { return mainDDARing.GetRequestedSpeedMmPerSec(); }
 	float GetAccelerationMmPerSecSquared() const noexcept { return mainDDARing.GetAccelerationMmPerSecSquared(); }
 	float GetDecelerationMmPerSecSquared() const noexcept { return mainDDARing.GetDecelerationMmPerSecSquared(); }
+	float GetExtrusionFeedForwardAhead(int heater, float windowStart, float windowEnd) const noexcept		// window times are in seconds from now
+		{ return mainDDARing.GetExtrusionFeedForwardAhead(heater, (uint32_t)(windowStart * (float)StepClockRate), (uint32_t)(windowEnd * (float)StepClockRate)); }
+	float GetQueuedMoveTime() const noexcept { return (float)mainDDARing.GetQueuedMoveTime() * (1.0/(float)StepClockRate); }	// in seconds
 
 	void AdjustLeadscrews(const floatc_t corrections[]) noexcept;							// Called by some Kinematics classes to adjust the leadscrews
 
@@ -173,6 +221,9 @@ public:
 
 	unsigned int GetJerkPolicy() const noexcept { return jerkPolicy; }
 	void SetJerkPolicy(unsigned int jp) noexcept { jerkPolicy = jp; }
+	float GetJunctionDeviation() const noexcept { return junctionDeviation; }
+	void SetJunctionDeviation(float jd) noexcept { junctionDeviation = jd; }
+	float GetArcSegmentLength(float arcRadius, float speed) const noexcept;		// Get the length of the straight segments that an arc move of the specified radius is split into
 
 #if HAS_SMART_DRIVERS
 	uint32_t GetStepInterval(size_t axis, uint32_t microstepShift) const noexcept;			// Get the current step interval for this axis or extruder
@@ -196,13 +247,18 @@ public:
 	static void WakeLaserTaskFromISR() noexcept;											// wake up the laser task, called at the start of a new move
 #endif
 
+#if SUPPORT_LASER
+	void SetLaserSynchronised(bool b) noexcept { mainDDARing.SetLaserSynchronised(b); }	// select whether the laser power is set by the step timer
+	bool IsLaserSynchronised() const noexcept { return mainDDARing.IsLaserSynchronised(); }
+#endif
+
 	static void WakeMoveTaskFromISR() noexcept;
 
 	static const TaskBase *GetMoveTaskHandle() noexcept { return &moveTask; }
 
 #if SUPPORT_REMOTE_COMMANDS
 # if USE_REMOTE_INPUT_SHAPING
-	void AddShapeddMoveFromRemote(const CanMessageMovementLinearShaped& msg) noexcept		// add a move from the ATE to the movement queue
+	void AddShapedMoveFromRemote(const CanMessageMovementLinearShaped& msg) noexcept		// add a move from the ATE to the movement queue
 	{
 		mainDDARing.AddMoveFromRemote(msg);
 		MoveAvailable();
@@ -248,6 +304,14 @@ private:
 
 	const char *GetCompensationTypeString() const noexcept;
 
+	// Merging of consecutive collinear moves before they are added to the main DDA ring
+	bool IsMergeCandidate(const RawMove& m) const noexcept;
+	bool TryMergeMove(const RawMove& m) noexcept;
+	void HoldMove(const RawMove& m) noexcept;
+	void FlushMergedMove() noexcept;
+	bool SkipMergedMove(RestorePoint& rp, float speedFactor) noexcept;
+	void AddMoveToMainRing(RawMove& m) noexcept;
+
 	// Move task stack size
 	// 250 is not enough when Move and DDA debug are enabled
 	// deckingman's system (MB6HC with CAN expansion) needs at least 365 in 3.3beta3
@@ -274,6 +338,9 @@ private:
 	float maxTravelAcceleration;
 
 	unsigned int jerkPolicy;							// When we allow jerk
+	float junctionDeviation;							// If nonzero, the junction deviation in mm used to limit cornering speed instead of the axis jerk limits
+	float arcMaxDeviation;								// The maximum deviation in mm of the segments of G2 and G3 moves from the ideal arc
+	float arcMaxSegmentLength;							// The maximum length of a segment of a G2 or G3 move
 	unsigned int idleCount;								// The number of times Spin was called and had no new moves to process
 
 	uint32_t whenLastMoveAdded;							// The time when we last added a move to the main DDA ring
@@ -282,8 +349,28 @@ private:
 	uint32_t idleTimeout;								// How long we wait with no activity before we reduce motor currents to idle, in milliseconds
 	uint32_t longestGcodeWaitInterval;					// the longest we had to wait for a new GCode
 
+	static constexpr uint32_t MergeHoldMillis = 5;		// the longest we hold a move back waiting for a following move to merge it with
+	static constexpr float MaxMergeExtrusionRatioError = 0.01;	// the maximum relative difference in extrusion per mm between moves that we merge
+	RawMove mergedMove;									// the move we are holding back, possibly the result of merging several moves
+	float lastMoveEndCoords[MaxAxes];					// the untransformed end coordinates of the last move we were given
+	float mergedMoveStartCoords[MaxAxes];				// the untransformed start coordinates of mergedMove
+	float mergedMoveLength;								// the length of mergedMove
+	float mergeMinCosAngle;								// the cosine of the largest change in direction we allow between moves that we merge, or greater than 1.0 if merging is disabled
+	float mergeMaxLength;								// the maximum length of a merged move
+	uint32_t whenMergedMoveStarted;						// when we started holding mergedMove
+	uint32_t numMovesMerged;							// how many moves we have merged into the preceding move since the last diagnostics report
+	float maxStepsPerClock;								// the limit on the total step rate of local drivers in steps per step clock, or 0 if there is no limit
+	uint32_t numStepRateLimitedMoves;					// how many moves have had their speed reduced to keep within the step rate limit since the last diagnostics report
+	FilePosition lastMoveFilePos;						// the file position of the last move we were given
+	volatile bool mergedMovePending;					// true if mergedMove holds a move that has not been added to the DDA ring yet
+	volatile bool flushMergedMoveRequested;				// true if GCodes is waiting for the pending move to be added to the ring
+	bool lastMoveEndValid;								// true if lastMoveEndCoords is valid
+	bool mergedMoveStartValid;							// true if mergedMoveStartCoords and mergedMoveLength are valid
+	bool mergedMoveIsWholeMove;							// true if mergedMove started at the start of a G0 or G1 command, not partway through a segmented move
+
 	float tangents[3]; 									// Axis compensation - 90 degrees + angle gives angle between axes
 	bool compensateXY;									// If true then we compensate for XY skew by adjusting the Y coordinate; else we adjust the X coordinate
+	bool usingSkewCompensation;							// true if any of the tangents is nonzero, so that AxisTransform has something to do
 
 	float tanXY() const noexcept { return tangents[0]; }
 	float tanYZ() const noexcept { return tangents[1]; }
@@ -303,9 +390,24 @@ private:
 	Kinematics *kinematics;								// What kinematics we are using
 
 	AxisShaper axisShaper;
+	AxisShaper yAxisShaper;								// the input shaper for moves that are mostly along the Y axis, if useYAxisShaper is set
+	bool useYAxisShaper;								// true if moves that are mostly along the Y axis use yAxisShaper
 	ExtruderShaper extruderShapers[MaxExtruders];
+#if SUPPORT_STEP_ISR_PROFILING
+	StepIsrProfiler stepIsrProfiler;
+#endif
+#if SUPPORT_PREPARE_PROFILING
+	PrepareProfiler prepareProfiler;
+#endif
+#if SUPPORT_MOTION_BENCHMARK
+	MotionBenchmark motionBenchmark;
+#endif
+#if SUPPORT_MOVE_LOG
+	MoveLog moveLog;
+#endif
 
-	float latestLiveCoordinates[MaxAxesPlusExtruders];
+	float latestLiveCoordinates[MaxAxesPlusExtruders];	// the live coordinates after the inverse axis and bed transform, recalculated only when the machine moves or the transform changes
+	const Tool *latestLiveCoordinatesTool;				// the tool that was used to transform latestLiveCoordinates
 	float specialMoveCoords[MaxDriversPerAxis];			// Amounts by which to move individual Z motors (leadscrew adjustment move)
 
 	uint8_t numCalibratedFactors;
@@ -322,6 +424,14 @@ private:
 
 //******************************************************************************************************
 
+// Get the input shaper to use for a move.
+// The shaper changes the velocity profile of the whole move, which must be the same for all axes to keep the head on the programmed path.
+// So if a separate Y axis shaper is configured, we use it for moves that are mostly along the Y axis and the main shaper for all other moves.
+inline const AxisShaper& Move::GetAxisShaperForMove(const float directionVector[]) const noexcept
+{
+	return (useYAxisShaper && fabsf(directionVector[Y_AXIS]) > fabsf(directionVector[X_AXIS])) ? yAxisShaper : axisShaper;
+}
+
 // Get the current position in untransformed coords
 inline void Move::GetCurrentMachinePosition(float m[MaxAxes], bool disableMotorMapping) const noexcept
 {
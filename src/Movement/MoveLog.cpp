@@ -0,0 +1,152 @@
+/*
+ * MoveLog.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "MoveLog.h"
+
+#if SUPPORT_MOVE_LOG
+
+#include "DDA.h"
+#include <GCodes/GCodeBuffer/GCodeBuffer.h>
+#include <Platform/RepRap.h>
+#include <Platform/Platform.h>
+#include <Platform/Tasks.h>
+#include <Storage/FileStore.h>
+#include <Storage/MassStorage.h>
+
+MoveLog::MoveLog() noexcept : records(nullptr), size(0), numRecorded(0), recording(false)
+{
+}
+
+// Handle M595.1
+GCodeResult MoveLog::Configure(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
+{
+	if (gb.Seen('P'))
+	{
+		String<MaxFilenameLength> fileName;
+		gb.GetQuotedString(fileName.GetRef());
+		return WriteFile(fileName.c_str(), reply);
+	}
+
+	if (gb.Seen('S'))
+	{
+		if (gb.GetUIValue() == 0)
+		{
+			recording = false;
+			return GCodeResult::ok;
+		}
+
+		uint32_t numRecords = DefaultMoveLogRecords;
+		bool dummy;
+		gb.TryGetLimitedUIValue('N', numRecords, dummy, MaxMoveLogRecords + 1);
+		if (numRecords == 0)
+		{
+			reply.copy("N parameter must be at least 1");
+			return GCodeResult::error;
+		}
+
+		recording = false;
+		if (numRecords != size)
+		{
+			Release();
+			if (Tasks::GetNeverUsedRam() < (ptrdiff_t)(MinFreeRamForPoolGrowth + numRecords * sizeof(MoveLogRecord)))
+			{
+				reply.copy("Not enough free RAM to record that many moves");
+				return GCodeResult::error;
+			}
+			records = new MoveLogRecord[numRecords];
+			size = numRecords;
+		}
+		numRecorded = 0;
+		recording = true;
+		return GCodeResult::ok;
+	}
+
+	if (records == nullptr)
+	{
+		reply.copy("Move log is not allocated");
+	}
+	else
+	{
+		const size_t total = numRecorded;
+		reply.printf("Move log is %s, %u of %u records used, %u moves not kept",
+						(recording) ? "recording" : "stopped", min<size_t>(total, size), size, (total > size) ? total - size : 0);
+	}
+	return GCodeResult::ok;
+}
+
+// Record a completed move. Called by the step ISR, so there is no need to disable interrupts.
+void MoveLog::Record(const DDA& dda) noexcept
+{
+	if (recording)
+	{
+		const size_t total = numRecorded;
+		dda.FillMoveLogRecord(records[total % size]);
+		numRecorded = total + 1;
+	}
+}
+
+// Stop recording and write the records to the specified file in /sys, oldest first, then free the buffer
+GCodeResult MoveLog::WriteFile(const char *_ecv_array fileName, const StringRef& reply) noexcept
+{
+	if (records == nullptr || numRecorded == 0)
+	{
+		reply.copy("No moves have been recorded");
+		return GCodeResult::error;
+	}
+
+	// Once we have cleared the flag the step ISR doesn't touch the buffer, because it can't be part way through Record when this task is running
+	recording = false;
+
+	String<MaxFilenameLength> fullName;
+	reprap.GetPlatform().MakeSysFileName(fullName.GetRef(), (fileName[0] == 0) ? FileName : fileName);
+	FileStore * const f = MassStorage::OpenFile(fullName.c_str(), OpenMode::write, 0);
+	if (f == nullptr)
+	{
+		reply.printf("Failed to create file %s", fullName.c_str());
+		return GCodeResult::error;
+	}
+
+	const size_t total = numRecorded;
+	const size_t numKept = min<size_t>(total, size);
+	MoveLogFileHeader header;
+	header.magic = MoveLogFileHeader::MagicValue;
+	header.version = MoveLogFileHeader::CurrentVersion;
+	header.recordSize = sizeof(MoveLogRecord);
+	header.stepClockRate = StepClockRate;
+	header.numRecords = numKept;
+	header.numLost = total - numKept;
+
+	// The records are in two pieces if the buffer has wrapped round
+	const size_t oldest = (total > size) ? total % size : 0;
+	bool ok = f->Write(reinterpret_cast<const char *>(&header), sizeof(header))
+			&& f->Write(reinterpret_cast<const char *>(records + oldest), (numKept - oldest) * sizeof(MoveLogRecord))
+			&& (oldest == 0 || f->Write(reinterpret_cast<const char *>(records), oldest * sizeof(MoveLogRecord)));
+	ok = f->Close() && ok;
+	if (!ok)
+	{
+		MassStorage::Delete(fullName.c_str(), false);
+		reply.printf("Failed to write file %s", fullName.c_str());
+		return GCodeResult::error;
+	}
+
+	reply.printf("%u moves written to file %s", numKept, fullName.c_str());
+	Release();
+	return GCodeResult::ok;
+}
+
+void MoveLog::Release() noexcept
+{
+	recording = false;
+	delete[] records;
+	records = nullptr;
+	size = 0;
+	numRecorded = 0;
+}
+
+#endif	// SUPPORT_MOVE_LOG
+
+// End
@@ -0,0 +1,80 @@
+/*
+ * MoveLog.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  This class records the planned parameters of each move when it completes, for analysing what the planner did during a real print.
+ *  M595.1 S1 N<records> allocates a ring buffer and starts recording, M595.1 S0 stops recording, and M595.1 P"file" stops recording and writes
+ *  the records to a binary file in /sys which the user can download. The records are written by the step ISR when each move completes, so
+ *  they hold the values in internal units (step clocks, and mm per step clock for speeds) so that no conversions are done in the ISR.
+ *  The file starts with a MoveLogFileHeader that gives the step clock rate and the record size, followed by the records oldest first.
+ */
+
+#ifndef SRC_MOVEMENT_MOVELOG_H_
+#define SRC_MOVEMENT_MOVELOG_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_MOVE_LOG
+
+struct MoveLogRecord
+{
+	static constexpr uint8_t FlagPrintingMove = 0x01;			// the move included XY movement and extrusion
+	static constexpr uint8_t FlagEndLimitedByJerk = 0x02;		// the end speed was limited by the jerk limit (M566) of one or more drives
+	static constexpr uint8_t FlagEndLimitedByJunction = 0x04;	// the end speed was limited by the junction deviation (M205 J)
+	static constexpr uint8_t FlagTopSpeedNotReached = 0x08;		// the move was too short to reach the requested speed at the allowed acceleration
+	static constexpr uint8_t FlagLookaheadUnderrun = 0x10;		// the lookahead queue was not long enough to optimise this move
+	static constexpr uint8_t FlagCheckingEndstops = 0x20;		// the move monitored endstops or a Z probe, so it may have been stopped early
+	static constexpr uint8_t FlagStepRateLimited = 0x40;		// the requested speed was reduced to keep the total step rate of local drivers within the M595 K limit
+
+	uint32_t startTime;											// the step clock when the move started
+	uint32_t clocksNeeded;										// the planned duration of the move in step clocks
+	uint32_t prepareClocks;										// how long DDA::Prepare took, in step clocks
+	FilePosition filePos;										// the file position after the move was read, or noFilePosition
+	float totalDistance;										// mm
+	float requestedSpeed, startSpeed, topSpeed, endSpeed;		// mm per step clock
+	float acceleration, deceleration;							// mm per step clock squared
+	uint8_t shapingPlan;										// the bits of the InputShaperPlan
+	uint8_t flags;
+	uint16_t spare;
+};
+
+struct MoveLogFileHeader
+{
+	static constexpr uint32_t MagicValue = 0x474C564D;			// "MVLG" in little-endian order
+	static constexpr uint16_t CurrentVersion = 1;
+
+	uint32_t magic;
+	uint16_t version;
+	uint16_t recordSize;
+	uint32_t stepClockRate;
+	uint32_t numRecords;
+	uint32_t numLost;											// how many moves completed while the buffer was full and overwrote the oldest records
+};
+
+class DDA;
+
+class MoveLog
+{
+public:
+	static constexpr const char *_ecv_array FileName = "moves.bin";
+
+	MoveLog() noexcept;
+
+	GCodeResult Configure(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);	// handle M595.1
+	void Record(const DDA& dda) noexcept;						// called by the step ISR when a move completes
+
+private:
+	GCodeResult WriteFile(const char *_ecv_array fileName, const StringRef& reply) noexcept;
+	void Release() noexcept;
+
+	MoveLogRecord *_ecv_array null records;
+	size_t size;												// the number of records in the buffer
+	volatile size_t numRecorded;								// the total number of moves recorded, whether or not they have since been overwritten
+	volatile bool recording;
+};
+
+#endif	// SUPPORT_MOVE_LOG
+
+#endif /* SRC_MOVEMENT_MOVELOG_H_ */
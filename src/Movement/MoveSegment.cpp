@@ -11,6 +11,10 @@
 
 MoveSegment *MoveSegment::freeList = nullptr;
 unsigned int MoveSegment::numCreated = 0;
+unsigned int MoveSegment::numInUse = 0;
+unsigned int MoveSegment::maxInUse = 0;
+unsigned int MoveSegment::numOnDemand = 0;
+unsigned int MoveSegment::numTopUpFailures = 0;
 
 void MoveSegment::InitialAllocate(unsigned int num) noexcept
 {
@@ -34,10 +38,38 @@ MoveSegment *MoveSegment::Allocate(MoveSegment *next) noexcept
 	{
 		ms = new MoveSegment(next);
 		++numCreated;
+		++numOnDemand;
+	}
+	++numInUse;
+	if (numInUse > maxInUse)
+	{
+		maxInUse = numInUse;
 	}
 	return ms;
 }
 
+// Create more MoveSegments if the free list is running low, so that DDA::Prepare rarely needs to allocate from the heap
+void MoveSegment::TopUp() noexcept
+{
+	if (numCreated - numInUse < MinFreeSegments)
+	{
+		if (Tasks::GetNeverUsedRam() >= (ptrdiff_t)(MinFreeRamForPoolGrowth + SegmentsPerTopUp * sizeof(MoveSegment)))
+		{
+			InitialAllocate(numCreated + SegmentsPerTopUp);
+		}
+		else
+		{
+			++numTopUpFailures;
+		}
+	}
+}
+
+void MoveSegment::PoolDiagnostics(const StringRef& reply) noexcept
+{
+	reply.catf("segments in use %u max %u, on-demand %u, top-up fails %u", numInUse, maxInUse, numOnDemand, numTopUpFailures);
+	maxInUse = numInUse;
+}
+
 void MoveSegment::AddToTail(MoveSegment *tail) noexcept
 {
 	MoveSegment *seg = this;
@@ -175,6 +175,8 @@ public:
 
 	static void InitialAllocate(unsigned int num) noexcept;
 	static unsigned int NumCreated() noexcept { return numCreated; }
+	static void TopUp() noexcept;										// top up the free list if it is running low, called by the Move task
+	static void PoolDiagnostics(const StringRef& reply) noexcept;		// append the pool statistics to 'reply' and reset the high water mark
 
 	static constexpr unsigned int SFdistance = 10;
 	static constexpr unsigned int SFstepsPerMm = 16;
@@ -192,8 +194,15 @@ private:
 	static constexpr uint32_t LinearFlag = 0x01;
 	static constexpr uint32_t AllFlags = 0x03;
 
+	static constexpr unsigned int MinFreeSegments = 20;				// when there are fewer than this number free, the Move task creates more
+	static constexpr unsigned int SegmentsPerTopUp = 10;			// how many more we create at a time
+
 	static MoveSegment *freeList;
 	static unsigned int numCreated;
+	static unsigned int numInUse;									// how many are currently allocated
+	static unsigned int maxInUse;									// the high water mark of numInUse since the last diagnostics report
+	static unsigned int numOnDemand;								// how many times Allocate found the free list empty and had to use the heap
+	static unsigned int numTopUpFailures;							// how many times TopUp couldn't create more because RAM was low
 
 	static_assert(sizeof(MoveSegment*) == sizeof(uint32_t));
 
@@ -292,6 +301,7 @@ inline void MoveSegment::Release(MoveSegment *item) noexcept
 {
 	item->nextAndFlags = reinterpret_cast<uint32_t>(freeList);
 	freeList = item;
+	--numInUse;
 }
 
 #endif /* SRC_MOVEMENT_MOVESEGMENT_H_ */
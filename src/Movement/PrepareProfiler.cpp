@@ -0,0 +1,105 @@
+/*
+ * PrepareProfiler.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "PrepareProfiler.h"
+
+#if SUPPORT_PREPARE_PROFILING
+
+#include <Platform/RepRap.h>
+#include <Platform/Platform.h>
+
+PrepareProfiler::PrepareProfiler() noexcept
+{
+	Reset();
+}
+
+// Enable the DWT cycle counter. It is left free-running, so we only ever take differences between readings.
+// The step ISR profiler does the same thing, so it doesn't matter if both are enabled.
+/*static*/ void PrepareProfiler::Init() noexcept
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if SAME70
+	DWT->LAR = 0xC5ACCE55;											// the Cortex-M7 DWT registers are locked on reset
+#endif
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+void PrepareProfiler::Record(const uint32_t phaseCycles[NumPhases], uint32_t totalCycles, uint32_t moveClocks, unsigned int features) noexcept
+{
+	for (size_t i = 0; i < NumPhases; ++i)
+	{
+		phaseStats[i].Add(phaseCycles[i]);
+	}
+	byFeatures[features % NumFeatureCombinations].Add(totalCycles);
+	if ((uint64_t)totalCycles * StepClockRate > (uint64_t)moveClocks * SystemCoreClock)
+	{
+		++numOverBudget;
+	}
+}
+
+// Clear the statistics. The Move task has a higher priority than the tasks that call this, so we just need to stop it running.
+void PrepareProfiler::Reset() noexcept
+{
+	TaskCriticalSectionLocker lock;
+	for (CycleStats& cs : phaseStats)
+	{
+		cs.Clear();
+	}
+	for (CycleStats& cs : byFeatures)
+	{
+		cs.Clear();
+	}
+	numOverBudget = 0;
+}
+
+void PrepareProfiler::Diagnostics(MessageType mtype) noexcept
+{
+	Platform& p = reprap.GetPlatform();
+	String<StringLength256> scratchString;
+
+	// Take a copy of the statistics, so that we report a consistent set
+	CycleStats localPhaseStats[NumPhases];
+	CycleStats localByFeatures[NumFeatureCombinations];
+	uint32_t localNumOverBudget;
+	{
+		TaskCriticalSectionLocker lock;
+		memcpy(localPhaseStats, phaseStats, sizeof(localPhaseStats));
+		memcpy(localByFeatures, byFeatures, sizeof(localByFeatures));
+		localNumOverBudget = numOverBudget;
+	}
+
+	static const char * const phaseNames[NumPhases] = { "shaping", "axes", "extruders", "CAN" };
+	scratchString.printf("Prepare cycles by phase (min/avg/max):");
+	for (size_t i = 0; i < NumPhases; ++i)
+	{
+		const CycleStats& cs = localPhaseStats[i];
+		scratchString.catf(" %s %" PRIu32 "/%" PRIu32 "/%" PRIu32, phaseNames[i], cs.GetMin(), cs.GetAverage(), cs.maxCycles);
+	}
+	p.MessageF(mtype, "%s\nMoves %" PRIu32 ", slower to prepare than to execute %" PRIu32 "\n", scratchString.c_str(), localPhaseStats[0].count, localNumOverBudget);
+
+	// Report the total for each feature combination that has been used. S = shaped, P = pressure advance, D = delta, R = remote drivers.
+	scratchString.printf("Prepare cycles by features (count/min/avg/max):");
+	for (size_t i = 0; i < NumFeatureCombinations; ++i)
+	{
+		const CycleStats& cs = localByFeatures[i];
+		if (cs.count != 0)
+		{
+			String<5> featureNames;
+			if (i & FeatureShaped) { featureNames.cat('S'); }
+			if (i & FeaturePressureAdvance) { featureNames.cat('P'); }
+			if (i & FeatureDelta) { featureNames.cat('D'); }
+			if (i & FeatureRemoteDrivers) { featureNames.cat('R'); }
+			scratchString.catf(" %s:%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32,
+								(featureNames.IsEmpty()) ? "none" : featureNames.c_str(), cs.count, cs.GetMin(), cs.GetAverage(), cs.maxCycles);
+		}
+	}
+	p.MessageF(mtype, "%s\n", scratchString.c_str());
+}
+
+#endif	// SUPPORT_PREPARE_PROFILING
+
+// End
@@ -0,0 +1,78 @@
+/*
+ * PrepareProfiler.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  This class records how many CPU cycles each phase of DDA::Prepare takes, using the DWT cycle counter, so that we can tell which features make
+ *  move preparation the bottleneck. The phases are input shaping, the axis drives, the extruder drives and, on CAN builds, sending the movement
+ *  messages. The total is also recorded for each combination of the features that affect the cost, and we count the moves that took longer to
+ *  prepare than they take to execute. The statistics are accumulated from the start of each print, or from startup if no print has been started.
+ */
+
+#ifndef SRC_MOVEMENT_PREPAREPROFILER_H_
+#define SRC_MOVEMENT_PREPAREPROFILER_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_PREPARE_PROFILING
+
+class PrepareProfiler
+{
+public:
+	enum class Phase : uint8_t
+	{
+		shaping = 0,					// planning the input shaping, or setting up the unshaped parameters
+		axes,							// preparing the axis drives, including adding CAN movements for them
+		extruders,						// preparing the extruder drives, including nonlinear extrusion and pressure advance for remote extruders
+		canFinish,						// sending the CAN movement messages
+	};
+	static constexpr size_t NumPhases = 4;
+
+	// Bits of the feature combination that we record the total against
+	static constexpr unsigned int FeatureShaped = 1u << 0;
+	static constexpr unsigned int FeaturePressureAdvance = 1u << 1;
+	static constexpr unsigned int FeatureDelta = 1u << 2;
+	static constexpr unsigned int FeatureRemoteDrivers = 1u << 3;
+	static constexpr size_t NumFeatureCombinations = 16;
+
+	PrepareProfiler() noexcept;
+
+	static void Init() noexcept;												// enable the cycle counter
+	static uint32_t GetCycles() noexcept { return DWT->CYCCNT; }
+
+	// Record the preparation of one move. Called by the Move task only.
+	void Record(const uint32_t phaseCycles[NumPhases], uint32_t totalCycles, uint32_t moveClocks, unsigned int features) noexcept;
+	void Reset() noexcept;														// called when a print starts
+	void Diagnostics(MessageType mtype) noexcept;
+
+private:
+	struct CycleStats
+	{
+		uint64_t totalCycles;
+		uint32_t count;
+		uint32_t minCycles;
+		uint32_t maxCycles;
+
+		void Clear() noexcept { totalCycles = 0; count = 0; minCycles = UINT32_MAX; maxCycles = 0; }
+		void Add(uint32_t cycles) noexcept;
+		uint32_t GetMin() const noexcept { return (count == 0) ? 0 : minCycles; }
+		uint32_t GetAverage() const noexcept { return (count == 0) ? 0 : (uint32_t)(totalCycles/count); }
+	};
+
+	CycleStats phaseStats[NumPhases];
+	CycleStats byFeatures[NumFeatureCombinations];								// the total preparation time for each combination of features
+	uint32_t numOverBudget;														// how many moves took longer to prepare than to execute
+};
+
+inline void PrepareProfiler::CycleStats::Add(uint32_t cycles) noexcept
+{
+	totalCycles += cycles;
+	++count;
+	if (cycles < minCycles) { minCycles = cycles; }
+	if (cycles > maxCycles) { maxCycles = cycles; }
+}
+
+#endif	// SUPPORT_PREPARE_PROFILING
+
+#endif /* SRC_MOVEMENT_PREPAREPROFILER_H_ */
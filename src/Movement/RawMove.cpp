@@ -22,6 +22,10 @@ void RawMove::SetDefaults(size_t firstDriveToZero) noexcept
 	rotationalAxesMentioned = false;
 	filePos = noFilePosition;
 	tool = nullptr;
+#if SUPPORT_JOB_ACCOUNTING
+	objectNumber = -1;
+	layerNumber = 0;
+#endif
 	cosXyAngle = 1.0;
 	for (size_t drive = firstDriveToZero; drive < MaxAxesPlusExtruders; ++drive)
 	{
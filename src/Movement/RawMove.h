@@ -37,6 +37,10 @@ struct RawMove
 	LaserPwmOrIoBits laserPwmOrIoBits;								// the laser PWM or port bit settings required
 #else
 	uint16_t padding;
+#endif
+#if SUPPORT_JOB_ACCOUNTING
+	int16_t objectNumber;											// the build plate object that this move is part of, or -1 if none
+	uint16_t layerNumber;											// the layer that was being printed when this move was read
 #endif
 	// If adding any more fields, keep the total size a multiple of 4 bytes so that we can use our optimised assignment operator
 
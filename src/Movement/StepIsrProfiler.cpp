@@ -0,0 +1,149 @@
+/*
+ * StepIsrProfiler.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "StepIsrProfiler.h"
+
+#if SUPPORT_STEP_ISR_PROFILING
+
+#include <Platform/RepRap.h>
+#include <Platform/Platform.h>
+
+// Object model table and functions
+// Note: if using GCC version 7.3.1 20180622 and lambda functions are used in this table, you must compile this file with option -std=gnu++17.
+// Otherwise the table will be allocated in RAM instead of flash, which wastes too much RAM.
+
+// Macro to build a standard lambda function that includes the necessary type conversions
+#define OBJECT_MODEL_FUNC(...) OBJECT_MODEL_FUNC_BODY(StepIsrProfiler, __VA_ARGS__)
+#define OBJECT_MODEL_FUNC_IF(...) OBJECT_MODEL_FUNC_IF_BODY(StepIsrProfiler, __VA_ARGS__)
+
+constexpr ObjectModelArrayDescriptor StepIsrProfiler::drivesArrayDescriptor =
+{
+	nullptr,					// no lock needed
+	[] (const ObjectModel *self, const ObjectExplorationContext& context) noexcept -> size_t { return MaxDrivesRecorded + 1; },
+	[] (const ObjectModel *self, ObjectExplorationContext& context) noexcept -> ExpressionValue { return ExpressionValue(self, 1); }
+};
+
+constexpr ObjectModelArrayDescriptor StepIsrProfiler::linearArrayDescriptor =
+{
+	nullptr,					// no lock needed
+	[] (const ObjectModel *self, const ObjectExplorationContext& context) noexcept -> size_t { return NumHistogramBuckets; },
+	[] (const ObjectModel *self, ObjectExplorationContext& context) noexcept
+		-> ExpressionValue { return ExpressionValue((int32_t)((const StepIsrProfiler*)self)->histograms[(unsigned int)SegmentKind::linear][context.GetLastIndex()]); }
+};
+
+constexpr ObjectModelArrayDescriptor StepIsrProfiler::nonlinearArrayDescriptor =
+{
+	nullptr,					// no lock needed
+	[] (const ObjectModel *self, const ObjectExplorationContext& context) noexcept -> size_t { return NumHistogramBuckets; },
+	[] (const ObjectModel *self, ObjectExplorationContext& context) noexcept
+		-> ExpressionValue { return ExpressionValue((int32_t)((const StepIsrProfiler*)self)->histograms[(unsigned int)SegmentKind::nonlinear][context.GetLastIndex()]); }
+};
+
+constexpr ObjectModelArrayDescriptor StepIsrProfiler::deltaArrayDescriptor =
+{
+	nullptr,					// no lock needed
+	[] (const ObjectModel *self, const ObjectExplorationContext& context) noexcept -> size_t { return NumHistogramBuckets; },
+	[] (const ObjectModel *self, ObjectExplorationContext& context) noexcept
+		-> ExpressionValue { return ExpressionValue((int32_t)((const StepIsrProfiler*)self)->histograms[(unsigned int)SegmentKind::delta][context.GetLastIndex()]); }
+};
+
+constexpr ObjectModelTableEntry StepIsrProfiler::objectModelTable[] =
+{
+	// Within each group, these entries must be in alphabetical order
+	// 0. StepIsrProfiler members
+	{ "calcAvgCycles",			OBJECT_MODEL_FUNC((int32_t)self->calcStats.GetAverage()),										ObjectModelEntryFlags::live },
+	{ "calcMaxCycles",			OBJECT_MODEL_FUNC((int32_t)self->calcStats.maxCycles),											ObjectModelEntryFlags::live },
+	{ "delta",					OBJECT_MODEL_FUNC_NOSELF(&deltaArrayDescriptor),												ObjectModelEntryFlags::live },
+	{ "drives",					OBJECT_MODEL_FUNC_NOSELF(&drivesArrayDescriptor),												ObjectModelEntryFlags::live },
+	{ "linear",					OBJECT_MODEL_FUNC_NOSELF(&linearArrayDescriptor),												ObjectModelEntryFlags::live },
+	{ "nonlinear",				OBJECT_MODEL_FUNC_NOSELF(&nonlinearArrayDescriptor),											ObjectModelEntryFlags::live },
+
+	// 1. StepIsrProfiler.drives[] members
+	{ "avgCycles",				OBJECT_MODEL_FUNC((int32_t)self->byDrives[context.GetLastIndex()].GetAverage()),				ObjectModelEntryFlags::live },
+	{ "count",					OBJECT_MODEL_FUNC((int32_t)self->byDrives[context.GetLastIndex()].count),						ObjectModelEntryFlags::live },
+	{ "maxCycles",				OBJECT_MODEL_FUNC((int32_t)self->byDrives[context.GetLastIndex()].maxCycles),					ObjectModelEntryFlags::live },
+	{ "minCycles",				OBJECT_MODEL_FUNC((int32_t)self->byDrives[context.GetLastIndex()].GetMin()),					ObjectModelEntryFlags::live },
+};
+
+constexpr uint8_t StepIsrProfiler::objectModelTableDescriptor[] = { 2, 6, 4 };
+
+DEFINE_GET_OBJECT_MODEL_TABLE(StepIsrProfiler)
+
+StepIsrProfiler::StepIsrProfiler() noexcept
+{
+	ClearStats();
+}
+
+// Enable the DWT cycle counter. It is left free-running, so we only ever take differences between readings.
+/*static*/ void StepIsrProfiler::Init() noexcept
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if SAME70
+	DWT->LAR = 0xC5ACCE55;											// the Cortex-M7 DWT registers are locked on reset
+#endif
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+void StepIsrProfiler::Reset() noexcept
+{
+	const uint32_t oldPrio = ChangeBasePriority(NvicPriorityStep);	// lock out the step ISR while we clear the statistics
+	ClearStats();
+	RestoreBasePriority(oldPrio);
+}
+
+void StepIsrProfiler::ClearStats() noexcept
+{
+	for (CycleStats& cs : byDrives)
+	{
+		cs.Clear();
+	}
+	calcStats.Clear();
+	memset(histograms, 0, sizeof(histograms));
+}
+
+void StepIsrProfiler::Diagnostics(MessageType mtype) noexcept
+{
+	Platform& p = reprap.GetPlatform();
+	String<StringLength256> scratchString;
+
+	// Take a copy of the statistics and reset them, so that we report a consistent set
+	const uint32_t oldPrio = ChangeBasePriority(NvicPriorityStep);
+	CycleStats localByDrives[MaxDrivesRecorded + 1];
+	memcpy(localByDrives, byDrives, sizeof(localByDrives));
+	const CycleStats localCalcStats = calcStats;
+	uint32_t localHistograms[NumSegmentKinds][NumHistogramBuckets];
+	memcpy(localHistograms, histograms, sizeof(localHistograms));
+	ClearStats();
+	RestoreBasePriority(oldPrio);
+
+	p.MessageF(mtype, "=== Step ISR (CPU clock %" PRIu32 "MHz) ===\nStepDrivers cycles by drives stepped (count/min/avg/max):", SystemCoreClock/1000000);
+	for (size_t i = 0; i <= MaxDrivesRecorded; ++i)
+	{
+		const CycleStats& cs = localByDrives[i];
+		if (cs.count != 0)
+		{
+			scratchString.catf(" %u:%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32, (unsigned int)i, cs.count, cs.GetMin(), cs.GetAverage(), cs.maxCycles);
+		}
+	}
+	p.MessageF(mtype, "%s\nStep time calc cycles avg %" PRIu32 " max %" PRIu32 "\n", scratchString.c_str(), localCalcStats.GetAverage(), localCalcStats.maxCycles);
+
+	static const char * const kindNames[NumSegmentKinds] = { "linear", "nonlinear", "delta" };
+	for (size_t kind = 0; kind < NumSegmentKinds; ++kind)
+	{
+		scratchString.printf("Log2 histogram %s:", kindNames[kind]);
+		for (size_t bucket = 0; bucket < NumHistogramBuckets; ++bucket)
+		{
+			scratchString.catf(" %" PRIu32, localHistograms[kind][bucket]);
+		}
+		p.MessageF(mtype, "%s\n", scratchString.c_str());
+	}
+}
+
+#endif	// SUPPORT_STEP_ISR_PROFILING
+
+// End
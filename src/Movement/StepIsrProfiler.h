@@ -0,0 +1,94 @@
+/*
+ * StepIsrProfiler.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  This class records how many CPU cycles DDA::StepDrivers takes each time it is called from the step ISR, using the DWT cycle counter.
+ *  Durations are recorded by the number of local drives stepped in that call, and as a log2 histogram for each kind of segment being executed,
+ *  so that achievable step rates can be judged against the real ISR headroom.
+ */
+
+#ifndef SRC_MOVEMENT_STEPISRPROFILER_H_
+#define SRC_MOVEMENT_STEPISRPROFILER_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_STEP_ISR_PROFILING
+
+#include <ObjectModel/ObjectModel.h>
+
+class StepIsrProfiler INHERIT_OBJECT_MODEL
+{
+public:
+	// The kind of segment being executed. Where drives executing different kinds of segment step together, the most expensive kind is recorded.
+	enum class SegmentKind : uint8_t
+	{
+		linear = 0,
+		nonlinear,
+		delta
+	};
+
+	StepIsrProfiler() noexcept;
+
+	static void Init() noexcept;												// enable the cycle counter
+	static uint32_t GetCycles() noexcept { return DWT->CYCCNT; }
+
+	// Record one call to DDA::StepDrivers. Called from the step ISR only.
+	void Record(unsigned int numDrivesStepped, SegmentKind kind, uint32_t totalCycles, uint32_t calcCycles) noexcept SPEED_CRITICAL;
+
+	void Diagnostics(MessageType mtype) noexcept;								// report and reset the statistics
+	void Reset() noexcept;
+
+	static constexpr size_t NumSegmentKinds = 3;
+	static constexpr size_t NumHistogramBuckets = 16;							// bucket N counts durations of [2^N, 2^(N+1)) cycles, the last bucket counts all longer ones
+	static constexpr size_t MaxDrivesRecorded = NumDirectDrivers;				// calls that step more drives than this are recorded against this number
+
+protected:
+	DECLARE_OBJECT_MODEL
+	OBJECT_MODEL_ARRAY(drives)
+	OBJECT_MODEL_ARRAY(linear)
+	OBJECT_MODEL_ARRAY(nonlinear)
+	OBJECT_MODEL_ARRAY(delta)
+
+private:
+	void ClearStats() noexcept;
+
+	struct CycleStats
+	{
+		uint64_t totalCycles;
+		uint32_t count;
+		uint32_t minCycles;
+		uint32_t maxCycles;
+
+		void Clear() noexcept { totalCycles = 0; count = 0; minCycles = UINT32_MAX; maxCycles = 0; }
+		void Add(uint32_t cycles) noexcept;
+		uint32_t GetMin() const noexcept { return (count == 0) ? 0 : minCycles; }
+		uint32_t GetAverage() const noexcept { return (count == 0) ? 0 : (uint32_t)(totalCycles/count); }
+	};
+
+	CycleStats byDrives[MaxDrivesRecorded + 1];									// index 0 is for calls in which no local drives were stepped
+	CycleStats calcStats;														// time spent calculating next step times
+	uint32_t histograms[NumSegmentKinds][NumHistogramBuckets];
+};
+
+inline void StepIsrProfiler::CycleStats::Add(uint32_t cycles) noexcept
+{
+	totalCycles += cycles;
+	++count;
+	if (cycles < minCycles) { minCycles = cycles; }
+	if (cycles > maxCycles) { maxCycles = cycles; }
+}
+
+// Record one call to DDA::StepDrivers
+inline void StepIsrProfiler::Record(unsigned int numDrivesStepped, SegmentKind kind, uint32_t totalCycles, uint32_t calcCycles) noexcept
+{
+	byDrives[min<unsigned int>(numDrivesStepped, MaxDrivesRecorded)].Add(totalCycles);
+	calcStats.Add(calcCycles);
+	const unsigned int bucket = (totalCycles == 0) ? 0 : 31 - __builtin_clz(totalCycles);
+	++histograms[(unsigned int)kind][min<unsigned int>(bucket, NumHistogramBuckets - 1)];
+}
+
+#endif	// SUPPORT_STEP_ISR_PROFILING
+
+#endif /* SRC_MOVEMENT_STEPISRPROFILER_H_ */
@@ -10,6 +10,8 @@
 #include <Platform/RepRap.h>
 #include <Platform/Platform.h>
 #include <GCodes/GCodes.h>
+#include <Platform/CpuUsage.h>
+#include <Platform/EventTrace.h>
 
 #if SUPPORT_REMOTE_COMMANDS
 # include <CanMessageFormats.h>
@@ -43,6 +45,12 @@ int32_t StepTimer::peakPosJitter = 0;
 int32_t StepTimer::peakNegJitter = 0;
 bool StepTimer::gotJitter = false;
 uint32_t StepTimer::peakReceiveDelay = 0;
+uint32_t StepTimer::totalReceiveDelay = 0;
+uint32_t StepTimer::numReceiveDelays = 0;
+uint32_t StepTimer::peakTransmitDelay = 0;
+uint32_t StepTimer::totalTransmitDelay = 0;
+uint32_t StepTimer::numTransmitDelays = 0;
+uint32_t StepTimer::correctionHistogram[NumCorrectionBuckets] = { 0 };
 volatile unsigned int StepTimer::syncCount = 0;
 unsigned int StepTimer::numJitterResyncs = 0;
 unsigned int StepTimer::numTimeoutResyncs = 0;
@@ -282,11 +290,13 @@ void StepTimer::DisableTimerInterrupt() noexcept
 	const uint32_t timeStampDelay = ((uint32_t)((timeStampNow - timeStamp) & 0xFFFF) * CanInterface::GetTimeStampPeriod()) >> 6;	// timestamp counter is 16 bits
 #endif
 
-	// Save the peak timestamp delay for diagnostic purposes
+	// Save the peak and total timestamp delays for diagnostic purposes
 	if (timeStampDelay > peakReceiveDelay)
 	{
 		peakReceiveDelay = timeStampDelay;
 	}
+	totalReceiveDelay += timeStampDelay;
+	++numReceiveDelays;
 
 	const uint32_t oldLocalTime = prevLocalTime;					// save the previous values
 	const uint32_t oldMasterTime = prevMasterTime;
@@ -302,6 +312,16 @@ void StepTimer::DisableTimerInterrupt() noexcept
 	else if (msg.lastTimeSent == oldMasterTime)
 	{
 		// We have the previous message details and now we have the transmit delay for that message
+		if (msg.lastTimeAcknowledgeDelay != 0)						// zero means the master didn't have the transmit delay available
+		{
+			if (msg.lastTimeAcknowledgeDelay > peakTransmitDelay)
+			{
+				peakTransmitDelay = msg.lastTimeAcknowledgeDelay;
+			}
+			totalTransmitDelay += msg.lastTimeAcknowledgeDelay;
+			++numTransmitDelays;
+		}
+
 		const uint32_t correctedMasterTime = oldMasterTime + msg.lastTimeAcknowledgeDelay;
 		const uint32_t newOffset = oldLocalTime - correctedMasterTime;
 
@@ -332,6 +352,8 @@ void StepTimer::DisableTimerInterrupt() noexcept
 				{
 					peakNegJitter = diff;
 				}
+				const uint32_t magnitude = (uint32_t)labs(diff);
+				++correctionHistogram[(magnitude == 0) ? 0 : min<size_t>(32 - __builtin_clz(magnitude), NumCorrectionBuckets - 1)];
 				reprap.GetGCodes().SetRemotePrinting(msg.isPrinting);
 				if (msgLen >= 16)										// if real time is included
 				{
@@ -364,6 +386,13 @@ void StepTimer::DisableTimerInterrupt() noexcept
 			pendingList = nextTimer;								// remove it from the pending list
 
 			tmr->active = false;
+#if SUPPORT_EVENT_TRACE
+			const Ticks late = GetTimerTicks() - tmr->whenDue;
+			if ((int32_t)late >= (int32_t)(EventTraceLateTimerMicroseconds * StepClockRate/1000000))
+			{
+				EventTrace::Record(EventTrace::EventId::timerLate, late, reinterpret_cast<uint32_t>(tmr->callback));
+			}
+#endif
 			tmr->callback(tmr->cbParam);							// execute its callback. This may schedule another callback and hence change the pending list.
 
 			tmr = pendingList;
@@ -385,6 +414,10 @@ extern "C" void STEP_TC_HANDLER() noexcept SPEED_CRITICAL;
 
 void STEP_TC_HANDLER() noexcept
 {
+#if SUPPORT_CPU_USAGE_STATS
+	CpuUsage::IsrTimer isrTimer(CpuUsage::IsrId::step);
+#endif
+
 #if SAME5x
 	uint8_t tcsr = StepTc->INTFLAG.reg;								// read the status register, which clears the status bits
 	tcsr &= StepTc->INTENSET.reg;									// select only enabled interrupts
@@ -520,10 +553,20 @@ extern "C" uint32_t StepTimerGetTimerTicks() noexcept
 // Remote diagnostics
 /*static*/ void StepTimer::Diagnostics(const StringRef& reply) noexcept
 {
+	reply.lcatf("Sync corrections");
+	char c = ' ';
+	for (uint32_t& count : correctionHistogram)
+	{
+		reply.catf("%c%" PRIu32, c, count);
+		count = 0;
+		c = '/';
+	}
+	reply.catf(", Rx sync delay mean %" PRIu32 ", Tx sync delay mean %" PRIu32 " peak %" PRIu32, GetMeanReceiveDelay(), GetMeanTransmitDelay(), peakTransmitDelay);
 	reply.lcatf("Peak sync jitter %" PRIi32 "/%" PRIi32 ", peak Rx sync delay %" PRIu32 ", resyncs %u/%u, ", peakNegJitter, peakPosJitter, peakReceiveDelay, numTimeoutResyncs, numJitterResyncs);
 	gotJitter = false;
 	numTimeoutResyncs = numJitterResyncs = 0;
-	peakReceiveDelay = 0;
+	peakReceiveDelay = peakTransmitDelay = 0;
+	totalReceiveDelay = numReceiveDelays = totalTransmitDelay = numTransmitDelays = 0;
 
 	StepTimer *pst = pendingList;
 	if (pst == nullptr)
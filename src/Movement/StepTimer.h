@@ -57,6 +57,9 @@ public:
 	// Get the current tick count when we only need a 16-bit value. Faster than GetTimerTicks() on the SAM4S and SAME70.
 	static uint16_t GetTimerTicks16() noexcept;
 
+	// Get the tick count at which the callback was scheduled. This is still valid inside the callback.
+	Ticks GetWhenDue() const noexcept { return whenDue; }
+
 	// Get the tick rate (can also access it directly as StepClockRate)
 	static constexpr uint32_t GetTickRate() noexcept { return StepClockRate; }
 
@@ -75,6 +78,16 @@ public:
 	static bool IsSynced() noexcept;
 	static void Diagnostics(const StringRef& reply) noexcept;
 
+	// Time sync quality statistics, accumulated since they were last reset by Diagnostics
+	static constexpr size_t NumCorrectionBuckets = 8;							// bucket 0 counts corrections of 0 ticks, bucket n counts 2^(n-1) to 2^n-1 ticks, the last bucket counts all larger ones
+	static uint32_t GetCorrectionCount(size_t bucket) noexcept { return correctionHistogram[bucket]; }
+	static int32_t GetPeakPosJitter() noexcept { return (gotJitter) ? peakPosJitter : 0; }
+	static int32_t GetPeakNegJitter() noexcept { return (gotJitter) ? peakNegJitter : 0; }
+	static uint32_t GetPeakReceiveDelay() noexcept { return peakReceiveDelay; }
+	static uint32_t GetPeakTransmitDelay() noexcept { return peakTransmitDelay; }
+	static uint32_t GetMeanReceiveDelay() noexcept { return (numReceiveDelays == 0) ? 0 : totalReceiveDelay/numReceiveDelays; }
+	static uint32_t GetMeanTransmitDelay() noexcept { return (numTransmitDelays == 0) ? 0 : totalTransmitDelay/numTransmitDelays; }
+
 	static constexpr uint32_t MinSyncInterval = 2000;							// maximum interval in milliseconds between sync messages for us to remain synced
 																				// increased from 1000 because of workaround we added for bad Tx time stamps on SAME70
 #endif
@@ -106,6 +119,10 @@ private:
 	static int32_t peakPosJitter, peakNegJitter;								// the max and min corrections we made to local time offset while synced
 	static bool gotJitter;														// true if we have recorded the jitter
 	static uint32_t peakReceiveDelay;											// the maximum receive delay we measured by using the receive time stamp
+	static uint32_t totalReceiveDelay, numReceiveDelays;						// used to calculate the mean receive delay
+	static uint32_t peakTransmitDelay;											// the maximum transmit delay reported by the master
+	static uint32_t totalTransmitDelay, numTransmitDelays;						// used to calculate the mean transmit delay
+	static uint32_t correctionHistogram[NumCorrectionBuckets];					// the magnitudes of the corrections we made to local time offset while synced
 	static volatile unsigned int syncCount;										// the number of messages we have received since starting sync
 	static unsigned int numJitterResyncs, numTimeoutResyncs;
 
@@ -0,0 +1,169 @@
+/*
+ * StallGuardLog.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "StallGuardLog.h"
+
+#if SUPPORT_STALLGUARD_LOG
+
+#include <Platform/RepRap.h>
+#include <Platform/Platform.h>
+#include <GCodes/GCodeBuffer/GCodeBuffer.h>
+#include <Movement/StepTimer.h>
+#include <Storage/MassStorage.h>
+
+namespace StallGuardLog
+{
+	static StallGuardLogRecord records[StallGuardLogEntries];
+	static volatile uint32_t capturingDrivers = 0;			// bitmap of the drivers we are capturing from
+	static size_t nextRecord = 0;							// where the next record will be written
+	static size_t numRecords = 0;
+	static uint32_t numOverwritten = 0;
+
+	bool IsCapturing(size_t driver) noexcept
+	{
+		return (capturingDrivers & (1u << driver)) != 0;
+	}
+
+	// Record a value read from a driver. The caller has already checked that we are capturing from this driver and that the motor is not at standstill.
+	void Record(size_t driver, uint16_t sgResult, uint32_t fullStepInterval) noexcept
+	{
+		TaskCriticalSectionLocker lock;						// so that the GCodes task doesn't start saving the buffer while we are writing to it
+		if (IsCapturing(driver))							// check again in case capture was stopped just now
+		{
+			StallGuardLogRecord& r = records[nextRecord];
+			r.when = StepTimer::GetTimerTicks();
+			r.fullStepInterval = fullStepInterval;
+			r.sgResult = sgResult;
+			r.driver = (uint8_t)driver;
+			r.reserved = 0;
+			nextRecord = (nextRecord + 1) % StallGuardLogEntries;
+			if (numRecords < StallGuardLogEntries)
+			{
+				++numRecords;
+			}
+			else
+			{
+				++numOverwritten;
+			}
+		}
+	}
+
+	// Save the captured records to a file, returning true if successful
+	static bool SaveToFile(FileStore *f) noexcept
+	{
+		StallGuardLogFileHeader hdr;
+		hdr.magic = StallGuardLogFileHeader::MagicValue;
+		hdr.version = StallGuardLogFileHeader::CurrentVersion;
+		hdr.recordSize = sizeof(StallGuardLogRecord);
+		hdr.reserved = 0;
+		hdr.stepClockRate = StepClockRate;
+		hdr.numRecords = numRecords;
+		hdr.numOverwritten = numOverwritten;
+		if (!f->Write(reinterpret_cast<const char *>(&hdr), sizeof(hdr)))
+		{
+			return false;
+		}
+
+		// When the buffer has wrapped round the oldest record is the one we would overwrite next
+		const size_t firstRecord = (numRecords < StallGuardLogEntries) ? 0 : nextRecord;
+		const size_t numAtEnd = min<size_t>(numRecords, StallGuardLogEntries - firstRecord);
+		return f->Write(reinterpret_cast<const char *>(&records[firstRecord]), numAtEnd * sizeof(StallGuardLogRecord))
+			&& (numAtEnd == numRecords || f->Write(reinterpret_cast<const char *>(&records[0]), (numRecords - numAtEnd) * sizeof(StallGuardLogRecord)));
+	}
+
+	// Handle M915.1. Sn starts (S1) or stops (S0) capture, P selects the local drivers to capture from, F saves the records to a file.
+	GCodeResult HandleM915Point1(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
+	{
+		Platform& platform = reprap.GetPlatform();
+		bool seen = false;
+		if (gb.Seen('S'))
+		{
+			seen = true;
+			if (gb.GetUIValue() == 0)
+			{
+				TaskCriticalSectionLocker lock;
+				capturingDrivers = 0;
+			}
+			else
+			{
+				uint32_t drivers = 0;
+				if (gb.Seen('P'))
+				{
+					DriverId drives[NumDirectDrivers];
+					size_t dCount = NumDirectDrivers;
+					gb.GetDriverIdArray(drives, dCount);
+					for (size_t i = 0; i < dCount; ++i)
+					{
+						if (!drives[i].IsLocal() || drives[i].localDriver >= platform.GetNumSmartDrivers())
+						{
+							reply.copy("StallGuard values can only be captured from local smart drivers");
+							return GCodeResult::error;
+						}
+						drivers |= 1u << drives[i].localDriver;
+					}
+				}
+				else
+				{
+					drivers = (1u << platform.GetNumSmartDrivers()) - 1;
+				}
+
+				TaskCriticalSectionLocker lock;
+				nextRecord = numRecords = 0;
+				numOverwritten = 0;
+				capturingDrivers = drivers;
+			}
+		}
+
+		String<MaxFilenameLength> fileName;
+		if (gb.TryGetQuotedString('F', fileName.GetRef(), seen))
+		{
+			{
+				TaskCriticalSectionLocker lock;
+				capturingDrivers = 0;						// stop capturing so that the buffer doesn't change while we save it
+			}
+
+			String<MaxFilenameLength> fullName;
+			platform.MakeSysFileName(fullName.GetRef(), fileName.c_str());
+			FileStore * const f = MassStorage::OpenFile(fullName.c_str(), OpenMode::write, 0);
+			if (f == nullptr)
+			{
+				reply.printf("Failed to create file %s", fullName.c_str());
+				return GCodeResult::error;
+			}
+			const bool ok = SaveToFile(f);
+			f->Close();
+			if (!ok)
+			{
+				MassStorage::Delete(fullName.c_str(), false);
+				reply.printf("Failed to save StallGuard values to file %s", fullName.c_str());
+				return GCodeResult::error;
+			}
+			reply.printf("%u StallGuard values saved to file %s", numRecords, fullName.c_str());
+			return GCodeResult::ok;
+		}
+
+		if (!seen)
+		{
+			const uint32_t drivers = capturingDrivers;
+			if (drivers == 0)
+			{
+				reply.copy("StallGuard capture is stopped");
+			}
+			else
+			{
+				reply.copy("Capturing StallGuard values from drivers");
+				ListDrivers(reply, DriversBitmap::MakeFromRaw(drivers));
+			}
+			reply.catf(", %u values captured, %" PRIu32 " overwritten", numRecords, numOverwritten);
+		}
+		return GCodeResult::ok;
+	}
+}
+
+#endif
+
+// End
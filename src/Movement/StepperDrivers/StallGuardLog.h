@@ -0,0 +1,55 @@
+/*
+ * StallGuardLog.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  This records the StallGuard load values that the smart driver code reads from selected drivers while they are moving, so that the stall
+ *  detection threshold for sensorless homing can be chosen from real data instead of by trial and error. The values go into a ring buffer
+ *  in RAM and M915.1 saves them to a binary file, which can then be downloaded in the usual way.
+ */
+
+#ifndef SRC_MOVEMENT_STEPPERDRIVERS_STALLGUARDLOG_H_
+#define SRC_MOVEMENT_STEPPERDRIVERS_STALLGUARDLOG_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_STALLGUARD_LOG
+
+// The header at the start of a saved file. It is followed by numRecords records in the order in which they were captured.
+struct StallGuardLogFileHeader
+{
+	static constexpr uint32_t MagicValue = 0x53465252;		// "RRFS" when stored little-endian
+	static constexpr uint8_t CurrentVersion = 1;
+
+	uint32_t magic;
+	uint8_t version;
+	uint8_t recordSize;
+	uint16_t reserved;
+	uint32_t stepClockRate;									// the units of the times in the records
+	uint32_t numRecords;
+	uint32_t numOverwritten;								// how many older records were lost because the buffer was full
+};
+
+struct StallGuardLogRecord
+{
+	uint32_t when;											// the step clock when the value was read
+	uint32_t fullStepInterval;								// the step clocks per full step when the value was read, which tells us the motor speed
+	uint16_t sgResult;										// the StallGuard load value, 0 to 1023
+	uint8_t driver;											// the local driver number
+	uint8_t reserved;
+};
+
+static_assert(sizeof(StallGuardLogFileHeader) == 20, "Header must be 20 bytes");
+static_assert(sizeof(StallGuardLogRecord) == 12, "Record must be 12 bytes");
+
+namespace StallGuardLog
+{
+	bool IsCapturing(size_t driver) noexcept;
+	void Record(size_t driver, uint16_t sgResult, uint32_t fullStepInterval) noexcept;		// called by the smart driver task
+	GCodeResult HandleM915Point1(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);
+}
+
+#endif
+
+#endif /* SRC_MOVEMENT_STEPPERDRIVERS_STALLGUARDLOG_H_ */
@@ -45,6 +45,8 @@
 #include <Cache.h>
 #include <General/Portability.h>
 #include <Hardware/IoPorts.h>
+#include "StallGuardLog.h"
+#include <Platform/CpuUsage.h>
 
 #if SAME5x || SAMC21
 # include <DmacManager.h>
@@ -71,6 +73,8 @@ constexpr uint32_t DefaultTpwmthrsReg = 2000;				// low values (high changeover
 constexpr size_t TmcTaskStackWords = 150;					// 100 is sufficient unless we use debugPrintf in the code executed by the TMC task
 
 constexpr uint16_t DriverNotPresentTimeouts = 20;
+constexpr unsigned int IdleDriverPollDivisor = 4;			// a driver whose motor is at standstill is polled on only one in this many of its turns
+constexpr uint32_t AllIdlePollInterval = 1;					// ticks to wait between polls when all motors are at standstill and no registers need to be written
 
 #if HAS_STALL_DETECT
 const int DefaultStallDetectThreshold = 1;
@@ -441,6 +445,7 @@ public:
 	StandardDriverStatus GetStatus(bool accumulated, bool clearAccumulated) noexcept;
 	uint8_t GetDriverNumber() const noexcept { return driverNumber; }
 	bool UpdatePending() const noexcept;
+	bool WantsPoll() noexcept;
 #if TMC22xx_HAS_ENABLE_PINS
 	bool UsesGlobalEnable() const noexcept { return enablePin == NoPin; }
 #endif
@@ -602,6 +607,7 @@ private:
 	uint16_t numTimeouts;									// how many times a transfer timed out
 	uint16_t numDmaErrors;
 	uint16_t badChopConfErrors;
+	uint32_t whenStatsReset;								// the millisecond clock when we last reset the read and write counts
 
 #if TMC22xx_HAS_ENABLE_PINS
 	Pin enablePin;											// the enable pin of this driver, if it has its own
@@ -621,6 +627,7 @@ private:
 #endif
 	volatile uint8_t specialReadRegisterNumber;				// the special register number we are reading
 	volatile uint8_t specialWriteRegisterNumber;			// the special register number we are writing
+	uint8_t idlePollsSkipped;								// how many of its turns this driver has skipped since it was last polled
 	bool enabled;											// true if driver is enabled
 #if RESET_MICROSTEP_COUNTERS_AT_INIT
 	bool hadStepFailure;
@@ -640,6 +647,8 @@ Uart * const TmcDriverState::uart = UART_TMC22xx;
 
 // TMC22xx management task
 static Task<TmcTaskStackWords> tmcTask;
+static volatile bool tmcTaskIdle = false;					// true while the TMC task is waiting because none of the drivers needed to be polled
+static void WakeTmcTaskIfIdle() noexcept;
 
 #if TMC22xx_USES_SERCOM
 static DmaCallbackReason dmaFinishedReason;
@@ -711,6 +720,20 @@ inline bool TmcDriverState::UpdatePending() const noexcept
 	return registersToUpdate != 0;
 }
 
+// Return true if we should poll this driver on this turn. We poll the drivers of moving motors every time, but the drivers of motors at standstill less often.
+inline bool TmcDriverState::WantsPoll() noexcept
+{
+	if (   (readRegisters[ReadDrvStat] & TMC_RR_STST) == 0
+		|| specialReadRegisterNumber < 0x80									// a special read has been requested
+		|| ++idlePollsSkipped >= IdleDriverPollDivisor
+	   )
+	{
+		idlePollsSkipped = 0;
+		return true;
+	}
+	return false;
+}
+
 // Set up the PDC or DMAC to send a register
 inline void TmcDriverState::SetupDMASend(uint8_t regNum, uint32_t regVal) noexcept
 {
@@ -888,6 +911,7 @@ void TmcDriverState::UpdateRegister(size_t regIndex, uint32_t regVal) noexcept
 		writeRegisters[regIndex] = regVal;
 		registersToUpdate |= (1u << regIndex);								// flag it for sending
 	}
+	WakeTmcTaskIfIdle();													// so that e.g. a current change takes effect straight away
 
 	if (regIndex == WriteGConf || regIndex == WriteTpwmthrs)
 	{
@@ -985,7 +1009,9 @@ pre(!driversPowered)
 	failedOp = 0xFF;
 	registerToRead = 0;
 	lastIfCount = 0;
+	idlePollsSkipped = 0;
 	readErrors = writeErrors = numReads = numWrites = numTimeouts = numDmaErrors = badChopConfErrors = 0;
+	whenStatsReset = millis();
 #if HAS_STALL_DETECT
 	ResetLoadRegisters();
 #endif
@@ -1143,6 +1169,7 @@ GCodeResult TmcDriverState::GetAnyRegister(const StringRef& reply, uint8_t regNu
 	if (specialReadRegisterNumber == 0xFF)
 	{
 		specialReadRegisterNumber = regNum;
+		WakeTmcTaskIfIdle();
 	}
 	return GCodeResult::notFinished;
 }
@@ -1310,14 +1337,17 @@ void TmcDriverState::AppendDriverStatus(const StringRef& reply) noexcept
 	ResetLoadRegisters();
 #endif
 
-	reply.catf(", read errors %u, write errors %u, ifcnt %u, reads %u, writes %u, timeouts %u, DMA errors %u, CC errors %u",
-					readErrors, writeErrors, lastIfCount, numReads, numWrites, numTimeouts, numDmaErrors, badChopConfErrors);
+	const uint32_t now = millis();
+	const uint32_t pollsPerSecond = ((uint32_t)(numReads + numWrites) * 1000u)/max<uint32_t>(now - whenStatsReset, 1u);
+	reply.catf(", read errors %u, write errors %u, ifcnt %u, reads %u, writes %u, polls/sec %" PRIu32 ", timeouts %u, DMA errors %u, CC errors %u",
+					readErrors, writeErrors, lastIfCount, numReads, numWrites, pollsPerSecond, numTimeouts, numDmaErrors, badChopConfErrors);
 	if (failedOp != 0xFF)
 	{
 		reply.catf(", failedOp 0x%02x", failedOp);
 		failedOp = 0xFF;
 	}
 	readErrors = writeErrors = numReads = numWrites = numTimeouts = numDmaErrors = badChopConfErrors = 0;
+	whenStatsReset = now;
 }
 
 // This is called by the ISR when the SPI transfer has completed
@@ -1390,6 +1420,12 @@ inline void TmcDriverState::TransferDone() noexcept
 				{
 					minSgLoadRegister = sgResult;
 				}
+# if SUPPORT_STALLGUARD_LOG
+				if (StallGuardLog::IsCapturing(GetDriverNumber()) && (readRegisters[ReadDrvStat] & TMC_RR_STST) == 0)
+				{
+					StallGuardLog::Record(GetDriverNumber(), sgResult, reprap.GetMove().GetStepInterval(axisNumber, microstepShiftFactor));
+				}
+# endif
 			}
 #endif
 			readRegisters[registerToRead] = regVal;
@@ -1557,6 +1593,9 @@ extern "C" void TMC22xx_UART_Handler() noexcept SPEED_CRITICAL;
 
 void TMC22xx_UART_Handler() noexcept
 {
+#if SUPPORT_CPU_USAGE_STATS
+	CpuUsage::IsrTimer isrTimer(CpuUsage::IsrId::drivers);
+#endif
 	UART_TMC22xx->UART_IDR = UART_IDR_ENDRX;			// disable the interrupt
 	dmaFinished = true;
 	tmcTask.GiveFromISR();
@@ -1570,35 +1609,46 @@ void TMC22xx_UART_Handler() noexcept
 extern "C" void UART_TMC_DRV0_Handler() noexcept SPEED_CRITICAL;
 void UART_TMC_DRV0_Handler() noexcept
 {
+#if SUPPORT_CPU_USAGE_STATS
+	CpuUsage::IsrTimer isrTimer(CpuUsage::IsrId::drivers);
+#endif
 	driverStates[0].UartTmcHandler();
 }
 
 extern "C" void UART_TMC_DRV1_Handler() noexcept SPEED_CRITICAL;
 void UART_TMC_DRV1_Handler() noexcept
 {
+#if SUPPORT_CPU_USAGE_STATS
+	CpuUsage::IsrTimer isrTimer(CpuUsage::IsrId::drivers);
+#endif
 	driverStates[1].UartTmcHandler();
 }
 
 #endif
 
-// Do a UART transaction with the specified driver number. Called from the TMC task loop.
-// Returns true if the transaction was completed successfully.
-bool DoTransaction(size_t driverNumber)
+// Return the driver that we poll in the specified position of the polling sequence
+static inline TmcDriverState& DriverInSlot(size_t slot) noexcept
 {
-	TmcDriverState *currentDriver;
 #if TMC22xx_SINGLE_DRIVER
-	currentDriver = driverStates;
+	return driverStates[0];
 #elif TMC22xx_USE_SLAVEADDR && TMC22xx_HAS_MUX
-	const size_t mappedDriverNumber = ((driverNumber & 1u) << 2) | (driverNumber >> 1);	// this assumes we have between 5 and 8 drivers and a 2-way multiplexer
-	currentDriver = &driverStates[mappedDriverNumber];
+	return driverStates[((slot & 1u) << 2) | (slot >> 1)];		// this assumes we have between 5 and 8 drivers and a 2-way multiplexer
 #else
-	currentDriver = &driverStates[driverNumber];
+	return driverStates[slot];
 #endif
+}
+
+// Do a UART transaction with the specified driver number. Called from the TMC task loop.
+// Returns true if the transaction was completed successfully.
+bool DoTransaction(size_t driverNumber)
+{
+	TmcDriverState * const currentDriver = &DriverInSlot(driverNumber);
 #if TMC22xx_USES_SERCOM
 	dmaFinishedReason = DmaCallbackReason::none;
 #else
 	dmaFinished = false;
 #endif
+	TaskBase::ClearCurrentTaskNotifyCount();							// in case we were woken up while we were idle just as our wait timed out
 	currentDriver->StartTransfer();
 
 	// Wait for the end-of-transfer interrupt
@@ -1652,6 +1702,45 @@ void NextDriver(size_t& currentDriverNumber) noexcept
 #endif
 }
 
+// Choose which driver to poll next when the drivers are ready, returning false if none of them needs to be polled yet.
+// A driver that has a register waiting to be written jumps the queue. Otherwise we take the drivers in turn, but skip most of the turns of the drivers
+// of motors that are at standstill, so that the drivers of moving motors are polled more often.
+static bool ChooseNextDriver(size_t& currentDriverNumber) noexcept
+{
+	const size_t numDrivers = GetNumTmcDrivers();
+	size_t slot = currentDriverNumber;
+	for (size_t i = 0; i < numDrivers; ++i)
+	{
+		NextDriver(slot);
+		if (DriverInSlot(slot).UpdatePending())
+		{
+			currentDriverNumber = slot;
+			return true;
+		}
+	}
+
+	for (size_t i = 0; i < numDrivers; ++i)
+	{
+		NextDriver(currentDriverNumber);
+		if (DriverInSlot(currentDriverNumber).WantsPoll())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Wake up the TMC task if it is waiting because none of the drivers needed to be polled
+static void WakeTmcTaskIfIdle() noexcept
+{
+	TaskCriticalSectionLocker lock;
+	if (tmcTaskIdle)
+	{
+		tmcTaskIdle = false;
+		tmcTask.Give();
+	}
+}
+
 // This is the loop that the TMC task runs
 extern "C" [[noreturn]] void TmcLoop(void *) noexcept
 {
@@ -1817,8 +1906,20 @@ debugPrintf("Driver %u ok\n", driver);
 #endif
 
 		case DriversState::ready:
-			(void)DoTransaction(currentDriverNumber);
-			NextDriver(currentDriverNumber);
+			if (ChooseNextDriver(currentDriverNumber))
+			{
+				(void)DoTransaction(currentDriverNumber);
+			}
+			else
+			{
+				// All the motors are at standstill and there is nothing to write, so wait a little unless a register write wakes us up
+				{
+					TaskCriticalSectionLocker lock;
+					tmcTaskIdle = true;
+				}
+				(void)TaskBase::Take(AllIdlePollInterval);
+				tmcTaskIdle = false;
+			}
 			break;
 		}
 	}
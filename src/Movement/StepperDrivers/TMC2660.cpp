@@ -14,6 +14,7 @@
 #include <Movement/Move.h>
 #include <Movement/StepTimer.h>
 #include <Endstops/Endstop.h>
+#include <Platform/CpuUsage.h>
 #include <Cache.h>
 
 # if SAME70
@@ -857,6 +858,9 @@ extern "C" void TMC2660_SPI_Handler(void) noexcept SPEED_CRITICAL;
 
 void TMC2660_SPI_Handler(void) noexcept
 {
+#if SUPPORT_CPU_USAGE_STATS
+	CpuUsage::IsrTimer isrTimer(CpuUsage::IsrId::drivers);
+#endif
 	TmcDriverState *driver = currentDriver;				// capture volatile variable
 	if (driver != nullptr)
 	{
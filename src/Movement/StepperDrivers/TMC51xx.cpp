@@ -18,6 +18,7 @@
 #include <Platform/TaskPriorities.h>
 #include <General/Portability.h>
 #include <Endstops/Endstop.h>
+#include "StallGuardLog.h"
 
 #if SAME5x || SAMC21
 
@@ -72,6 +73,7 @@ constexpr float RecipFullScaleCurrent = Tmc5160SenseResistor/325.0;		// 1.0 divi
 // TODO use the DIAG outputs to detect stalls instead
 const uint32_t DriversSpiClockFrequency = 2000000;			// 2MHz SPI clock
 const uint32_t TransferTimeout = 2;							// any transfer should complete within 2 ticks @ 1ms/tick
+const uint32_t IdlePollInterval = 1;						// when no moves are running and no registers need to be written, we poll the drivers once per tick
 
 // GCONF register (0x00, RW)
 constexpr uint8_t REGNUM_GCONF = 0x00;
@@ -278,6 +280,8 @@ enum class DriversState : uint8_t
 
 static DriversState driversState = DriversState::shutDown;
 
+static void WakeTmcTaskIfIdle() noexcept;
+
 //----------------------------------------------------------------------------------------------------------------------------------
 // Private types and methods
 
@@ -462,6 +466,7 @@ void TmcDriverState::UpdateRegister(size_t regIndex, uint32_t regVal) noexcept
 {
 	writeRegisters[regIndex] = regVal;
 	newRegistersToUpdate |= (1u << regIndex);							// flag it for sending
+	WakeTmcTaskIfIdle();												// so that e.g. a current change takes effect without waiting for the next poll
 }
 
 // Calculate the chopper control register and flag it for sending
@@ -475,6 +480,7 @@ void TmcDriverState::SetStallDetectThreshold(int sgThreshold) noexcept
 	const uint32_t sgVal = ((uint32_t)constrain<int>(sgThreshold, -64, 63)) & 127u;
 	writeRegisters[WriteCoolConf] = (writeRegisters[WriteCoolConf] & ~COOLCONF_SGT_MASK) | (sgVal << COOLCONF_SGT_SHIFT);
 	newRegistersToUpdate |= 1u << WriteCoolConf;
+	WakeTmcTaskIfIdle();
 }
 
 inline void TmcDriverState::SetAxisNumber(size_t p_axisNumber) noexcept
@@ -611,6 +617,7 @@ GCodeResult TmcDriverState::GetAnyRegister(const StringRef& reply, uint8_t regNu
 	if (specialReadRegisterNumber == 0xFF)
 	{
 		specialReadRegisterNumber = regNum;
+		WakeTmcTaskIfIdle();
 	}
 	return GCodeResult::notFinished;
 }
@@ -819,6 +826,7 @@ void TmcDriverState::SetStallDetectFilter(bool sgFilter) noexcept
 		writeRegisters[WriteCoolConf] &= ~COOLCONF_SGFILT;
 	}
 	newRegistersToUpdate |= 1u << WriteCoolConf;
+	WakeTmcTaskIfIdle();
 }
 
 void TmcDriverState::SetStallMinimumStepsPerSecond(unsigned int stepsPerSecond) noexcept
@@ -914,6 +922,13 @@ void TmcDriverState::TransferSucceeded(const uint8_t *rcvDataBlock) noexcept
 				{
 					minSgLoadRegister = sgResult;
 				}
+#if SUPPORT_STALLGUARD_LOG
+				const size_t driver = driverBit.LowestSetBit();
+				if (StallGuardLog::IsCapturing(driver))
+				{
+					StallGuardLog::Record(driver, sgResult, interval);
+				}
+#endif
 			}
 
 			if ((regVal & (TMC_RR_OLA | TMC_RR_OLB)) != 0)
@@ -973,6 +988,18 @@ static TmcDriverState driverStates[MaxSmartDrivers];
 
 // TMC51xx management task
 static Task<TmcTaskStackWords> tmcTask;
+static volatile bool tmcTaskIdle = false;						// true while the TMC task is waiting between polls because there is nothing urgent to do
+
+// Wake up the TMC task if it is waiting between polls, because there is a register to write or read
+static void WakeTmcTaskIfIdle() noexcept
+{
+	TaskCriticalSectionLocker lock;
+	if (tmcTaskIdle)
+	{
+		tmcTaskIdle = false;
+		tmcTask.Give();
+	}
+}
 
 // Declare the DMA buffers with the __nocache attribute for the SAME70. Access to these must be aligned.
 static __nocache volatile uint8_t sendData[5 * MaxSmartDrivers];
@@ -1220,6 +1247,36 @@ extern "C" [[noreturn]] void TmcLoop(void *) noexcept
 				}
 			}
 
+			// All the drivers are in one SPI chain, so each transfer writes or reads one register in every driver.
+			// If no moves are running and no driver has a register waiting to be written, there is no need to keep polling the drivers flat out.
+			// So we wait a little before the next transfer, unless a register write or special read request wakes us up first.
+			if (driversState == DriversState::ready && GetMoveInstance().NoLiveMovement())
+			{
+				{
+					TaskCriticalSectionLocker lock;
+					tmcTaskIdle = true;
+					for (size_t i = 0; i < numTmc51xxDrivers; ++i)
+					{
+						if (driverStates[i].UpdatePending())
+						{
+							tmcTaskIdle = false;
+							break;
+						}
+					}
+				}
+
+				if (tmcTaskIdle)
+				{
+					(void)TaskBase::Take(IdlePollInterval);
+					tmcTaskIdle = false;
+					if (driversState == DriversState::noPower)
+					{
+						timedOut = true;							// we have already processed the last responses
+						continue;
+					}
+				}
+			}
+
 			// Set up data to write. Driver 0 is the first in the SPI chain so we must write them in reverse order.
 			volatile uint8_t *writeBufPtr = sendData + 5 * numTmc51xxDrivers;
 			for (size_t i = 0; i < numTmc51xxDrivers; ++i)
@@ -283,6 +283,8 @@ constexpr ObjectModelTableEntry WiFiInterface::objectModelTable[] =
 {
 	// These entries must be in alphabetical order
 	{ "actualIP",			OBJECT_MODEL_FUNC(self->ipAddress),				ObjectModelEntryFlags::none },
+	{ "bytesReceived",		OBJECT_MODEL_FUNC(self->GetBytesReceived()),	ObjectModelEntryFlags::live },
+	{ "bytesSent",			OBJECT_MODEL_FUNC(self->GetBytesSent()),		ObjectModelEntryFlags::live },
 	{ "firmwareVersion",	OBJECT_MODEL_FUNC(self->wiFiServerVersion),		ObjectModelEntryFlags::none },
 	{ "gateway",			OBJECT_MODEL_FUNC(self->gateway),				ObjectModelEntryFlags::none },
 	{ "mac",				OBJECT_MODEL_FUNC(self->macAddress),			ObjectModelEntryFlags::none },
@@ -291,7 +293,7 @@ constexpr ObjectModelTableEntry WiFiInterface::objectModelTable[] =
 	{ "type",				OBJECT_MODEL_FUNC_NOSELF("wifi"),				ObjectModelEntryFlags::none },
 };
 
-constexpr uint8_t WiFiInterface::objectModelTableDescriptor[] = { 1, 7 };
+constexpr uint8_t WiFiInterface::objectModelTableDescriptor[] = { 1, 9 };
 
 DEFINE_GET_OBJECT_MODEL_TABLE(WiFiInterface)
 
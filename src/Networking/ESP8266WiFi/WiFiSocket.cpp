@@ -16,12 +16,17 @@
 
 const unsigned int MaxBuffersPerSocket = 4;
 
+uint32_t WiFiSocket::queuedData[NumDwords(MaxDataLength)];
+WiFiSocket *WiFiSocket::queuedSocket = nullptr;
+size_t WiFiSocket::queuedLength = 0;
+
 WiFiSocket::WiFiSocket(NetworkInterface *iface) noexcept : Socket(iface), receivedData(nullptr), hasMoreDataPending(false), state(SocketState::inactive), needsPolling(false)
 {
 }
 
 void WiFiSocket::Init(SocketNumber n) noexcept
 {
+	DiscardQueuedData();
 	socketNum = n;
 	state = SocketState::inactive;
 	txBufferSpace = 0;
@@ -30,6 +35,12 @@ void WiFiSocket::Init(SocketNumber n) noexcept
 // Close a connection when the last packet has been sent
 void WiFiSocket::Close() noexcept
 {
+	if (queuedSocket == this && !SendQueuedData(0))
+	{
+		Terminate();
+		return;
+	}
+
 	if (state == SocketState::connected || state == SocketState::clientDisconnecting)
 	{
 		const int32_t reply = GetInterface()->SendCommand(NetworkCommand::connClose, socketNum, 0, 0, nullptr, 0, nullptr, 0);
@@ -52,6 +63,7 @@ void WiFiSocket::Close() noexcept
 // We can call this after any sort of error on a socket as long as it is in use.
 void WiFiSocket::Terminate() noexcept
 {
+	DiscardQueuedData();
 	if (state != SocketState::inactive)
 	{
 		const int32_t reply = GetInterface()->SendCommand(NetworkCommand::connAbort, socketNum, 0, 0, nullptr, 0, nullptr, 0);
@@ -120,6 +132,12 @@ void WiFiSocket::Taken(size_t len) noexcept
 // Poll a socket to see if it needs to be serviced
 void WiFiSocket::Poll() noexcept
 {
+	// Pass any data we are holding to the module first, so that the status we get reflects it
+	if (queuedSocket == this && !SendQueuedData(0))
+	{
+		return;
+	}
+
 	// Get the socket status
 	Receiver<ConnStatusResponse> resp;
 	const int32_t ret = GetInterface()->SendCommand(NetworkCommand::connGetStatus, socketNum, 0, nullptr, 0, resp);
@@ -264,6 +282,7 @@ void WiFiSocket::ReceiveData(uint16_t bytesAvailable) noexcept
 			{
 				bytesAvailable -= ret;
 				lastBuffer->dataLength += (size_t)ret;
+				GetInterface()->RecordBytesReceived((size_t)ret);
 				if (reprap.Debug(moduleNetwork))
 				{
 					debugPrintf("Received %u bytes\n", (unsigned int)ret);
@@ -283,6 +302,7 @@ void WiFiSocket::ReceiveData(uint16_t bytesAvailable) noexcept
 					bytesAvailable -= ret;
 					buf->dataLength = (size_t)ret;
 					NetworkBuffer::AppendToList(&receivedData, buf);
+					GetInterface()->RecordBytesReceived((size_t)ret);
 					if (reprap.Debug(moduleNetwork))
 					{
 						debugPrintf("Received %u bytes\n", (unsigned int)ret);
@@ -314,18 +334,35 @@ size_t WiFiSocket::Send(const uint8_t *data, size_t length) noexcept
 {
 	if (state == SocketState::connected && txBufferSpace != 0)
 	{
-		const size_t lengthToSend = min<size_t>(length, min<size_t>(txBufferSpace, MaxDataLength));
-		const int32_t reply = GetInterface()->SendCommand(NetworkCommand::connWrite, socketNum, 0, 0, data, lengthToSend, nullptr, 0);
-		if (reply >= 0 && (size_t)reply <= lengthToSend)
+		// Only one socket can have queued data, so if another socket has some then send it now
+		if (queuedSocket != nullptr && queuedSocket != this)
 		{
-			txBufferSpace -= (size_t)reply;
-			return (size_t)reply;
+			(void)queuedSocket->SendQueuedData(0);
 		}
-		if (reprap.Debug(moduleNetwork))
+
+		const size_t lengthToQueue = min<size_t>(length, txBufferSpace);
+		size_t lengthQueued = 0;
+		while (lengthQueued < lengthToQueue)
 		{
-			debugPrintf("Send failed, terminating\n");
+			if (queuedLength == MaxDataLength && !SendQueuedData(0))
+			{
+				return 0;
+			}
+			const size_t toCopy = min<size_t>(lengthToQueue - lengthQueued, MaxDataLength - queuedLength);
+			memcpy(reinterpret_cast<uint8_t *>(queuedData) + queuedLength, data + lengthQueued, toCopy);
+			queuedLength += toCopy;
+			queuedSocket = this;
+			lengthQueued += toCopy;
 		}
-		state = SocketState::broken;							// something is not right, terminate the socket soon
+		txBufferSpace -= lengthQueued;
+		GetInterface()->RecordBytesSent(lengthQueued);
+
+		// If the module can't accept any more data then the caller will wait for it to accept some, so it must have what we have queued
+		if (lengthQueued < length && !SendQueuedData(0))
+		{
+			return 0;
+		}
+		return lengthQueued;
 	}
 	return 0;
 }
@@ -335,6 +372,12 @@ void WiFiSocket::Send() noexcept
 {
 	if (state == SocketState::connected)
 	{
+		if (queuedSocket == this)
+		{
+			(void)SendQueuedData(MessageHeaderSamToEsp::FlagPush);		// send the queued data and the push request in one transaction
+			return;
+		}
+
 		const int32_t reply = GetInterface()->SendCommand(NetworkCommand::connWrite, socketNum, MessageHeaderSamToEsp::FlagPush, 0, nullptr, 0, nullptr, 0);
 		if (reply < 0)
 		{
@@ -347,6 +390,35 @@ void WiFiSocket::Send() noexcept
 	}
 }
 
+// Pass the queued data to the WiFi module, returning true if successful
+bool WiFiSocket::SendQueuedData(uint8_t flags) noexcept
+{
+	const size_t length = queuedLength;
+	queuedSocket = nullptr;
+	queuedLength = 0;
+	const int32_t reply = GetInterface()->SendCommand(NetworkCommand::connWrite, socketNum, flags, 0, queuedData, length, nullptr, 0);
+	if (reply == (int32_t)length)
+	{
+		return true;
+	}
+
+	if (reprap.Debug(moduleNetwork))
+	{
+		debugPrintf("Send failed, terminating\n");
+	}
+	state = SocketState::broken;								// something is not right, terminate the socket soon
+	return false;
+}
+
+void WiFiSocket::DiscardQueuedData() noexcept
+{
+	if (queuedSocket == this)
+	{
+		queuedSocket = nullptr;
+		queuedLength = 0;
+	}
+}
+
 // Return true if we need to poll this socket
 bool WiFiSocket::NeedsPolling() const noexcept
 {
@@ -14,6 +14,7 @@
 
 #include "Networking/NetworkDefs.h"
 #include "Networking/Socket.h"
+#include <MessageFormats.h>
 
 class WiFiInterface;
 
@@ -53,6 +54,14 @@ private:
 	WiFiInterface *GetInterface() const noexcept;
 	void ReceiveData(uint16_t bytesAvailable) noexcept;
 	void DiscardReceivedData() noexcept;
+	bool SendQueuedData(uint8_t flags) noexcept pre(queuedSocket == this);
+	void DiscardQueuedData() noexcept;
+
+	// Data that we have accepted from a responder but not yet passed to the WiFi module. We combine the data from successive calls to Send for the same socket
+	// into one SPI transaction, because responders often send a response in small pieces such as one OutputBuffer at a time. Only one socket can have queued data.
+	static uint32_t queuedData[NumDwords(MaxDataLength)];		// dword-aligned for SendCommand
+	static WiFiSocket *null queuedSocket;
+	static size_t queuedLength;
 
 	NetworkBuffer *receivedData;						// List of buffers holding received data
 	bool hasMoreDataPending;							// If there is more data left to read when the buffered data has been processed
@@ -32,6 +32,7 @@ const uint8_t ESP_READ_REG = 0x0a;			// Address as 32-bit word. Returns read dat
 // The following two commands are needed by the ESP32 ROM loader
 const uint8_t ESP_SPI_SET_PARAMS = 0x0b;	// Six 32-bit words: id, total size in bytes, block size, sector size, page size, status mask.
 const uint8_t ESP_SPI_ATTACH = 0x0d;		// 32-bit word: Zero for normal SPI flash. A second 32-bit word (should be 0) is passed to ROM loader only.
+const uint8_t ESP_CHANGE_BAUDRATE = 0x0f;	// Two 32-bit words: new baud rate, 0 when talking to the ROM loader. The reply is sent at the old baud rate.
 
 // MAC address storage locations
 const uint32_t ESP_OTP_MAC0 = 0x3ff00050;
@@ -78,6 +79,12 @@ const char * const resultMessages[] =
 // 230400b always manages to connect.
 static const uint32_t uploadBaudRates[] = { 230400, 115200, 74880, 9600 };
 
+#if WIFI_USES_ESP32
+// The ESP32 ROM loader can be told to change to a higher baud rate once we have connected. Almost all the data goes from us to the ESP, and its replies are short,
+// so the UART ISR latency that limits the ESP8266 connection is much less of a problem. If anything fails at this rate we reconnect and start again at the rate that worked.
+static const uint32_t fastUploadBaudRate = 921600;
+#endif
+
 WifiFirmwareUploader::WifiFirmwareUploader(AsyncSerial& port, WiFiInterface& iface) noexcept
 	: uploadPort(port), interface(iface), uploadFile(nullptr), state(UploadState::idle)
 {
@@ -533,6 +540,27 @@ WifiFirmwareUploader::EspUploadResult WifiFirmwareUploader::flashSpiAttach() noe
 	return doCommand(ESP_SPI_ATTACH, (const uint8_t*)buf, sizeof(buf), 0, nullptr, defaultTimeout);
 }
 
+// Ask the ROM loader to change to a different baud rate. If it succeeds, the caller must change the baud rate of our UART.
+WifiFirmwareUploader::EspUploadResult WifiFirmwareUploader::changeBaudRate(uint32_t baud) noexcept
+{
+	const uint32_t buf[2] = { baud, 0 };
+	return doCommand(ESP_CHANGE_BAUDRATE, (const uint8_t*)buf, sizeof(buf), 0, nullptr, defaultTimeout);
+}
+
+// If we are uploading at the fast baud rate, reconnect at the normal baud rate and start again. Return true if we are doing so.
+bool WifiFirmwareUploader::FallBackToNormalBaudRate() noexcept
+{
+	if (!usingFastBaudRate || !uploadFile->Seek(0))
+	{
+		return false;
+	}
+	MessageF("Failed at %" PRIu32 " baud, retrying at normal speed\n", fastUploadBaudRate);
+	usingFastBaudRate = false;
+	fastBaudRateFailed = true;
+	state = UploadState::resetting;					// connectAttemptNumber is unchanged, so we reconnect at the baud rate that worked before
+	return true;
+}
+
 #endif
 
 // Compute the checksum of a block of data
@@ -662,6 +690,24 @@ void WifiFirmwareUploader::Spin() noexcept
 					break;
 				}
 				MessageF("SPI flash parameters set\n");
+				if (!fastBaudRateFailed)
+				{
+					if (changeBaudRate(fastUploadBaudRate) == EspUploadResult::success)
+					{
+						uploadPort.begin(fastUploadBaudRate);
+						usingFastBaudRate = true;
+						lastAttemptTime = millis();
+						state = UploadState::changingBaudRate;
+					}
+					else
+					{
+						// We don't know what baud rate the ESP is using now, so reset it and connect again
+						MessageF("Failed to change baud rate\n");
+						fastBaudRateFailed = true;
+						state = UploadState::resetting;
+					}
+					break;
+				}
 				state = UploadState::erasing2;
 #else
 				state = UploadState::erasing1;
@@ -683,6 +729,19 @@ void WifiFirmwareUploader::Spin() noexcept
 		}
 		break;
 
+#if WIFI_USES_ESP32
+	case UploadState::changingBaudRate:
+		// The ESP may send rubbish while it changes baud rate, so wait a little and discard it
+		if (millis() - lastAttemptTime >= baudRateChangeDelay)
+		{
+			flushInput();
+			MessageF("Changed to %" PRIu32 " baud\n", fastUploadBaudRate);
+			lastAttemptTime = millis();
+			state = UploadState::erasing2;
+		}
+		break;
+#endif
+
 	case UploadState::erasing1:
 #if WIFI_USES_ESP32
 		// no break
@@ -717,6 +776,12 @@ void WifiFirmwareUploader::Spin() noexcept
 			}
 			else
 			{
+#if WIFI_USES_ESP32
+				if (FallBackToNormalBaudRate())
+				{
+					break;
+				}
+#endif
 				MessageF("Erase failed\n");
 				state = UploadState::done;
 			}
@@ -734,6 +799,12 @@ void WifiFirmwareUploader::Spin() noexcept
 				lastAttemptTime = millis();
 				if (uploadResult != EspUploadResult::success)
 				{
+#if WIFI_USES_ESP32
+					if (FallBackToNormalBaudRate())
+					{
+						break;
+					}
+#endif
 					MessageF("Flash block upload failed\n");
 					state = UploadState::done;
 				}
@@ -812,6 +883,9 @@ void WifiFirmwareUploader::SendUpdateFile(const char *file, uint32_t address) no
 	// Set up the state so that subsequent calls to Spin() will attempt the upload
 	uploadAddress = address;
 	connectAttemptNumber = 0;
+#if WIFI_USES_ESP32
+	usingFastBaudRate = fastBaudRateFailed = false;
+#endif
 	state = UploadState::resetting;
 }
 
@@ -36,6 +36,9 @@ private:
 	static const uint32_t blockWriteTimeout = 200;
 	static const uint32_t eraseTimeout = 15000;					// increased from 12 to 15 seconds because Roland's board was timing out
 	static const unsigned int percentToReportIncrement = 5;		// how often we report % complete
+#if WIFI_USES_ESP32
+	static const uint32_t baudRateChangeDelay = 50;				// how long we wait after changing the baud rate before we send anything
+#endif
 
 #if !WIFI_USES_ESP32
 	static const uint32_t systemParametersAddress = 0x3FE000;	// the address of the system + user parameter area that needs to be cleared when changing SDK version
@@ -73,6 +76,9 @@ private:
 		idle,
 		resetting,
 		connecting,
+#if WIFI_USES_ESP32
+		changingBaudRate,
+#endif
 		erasing1,
 		erasing2,
 		uploading,
@@ -97,6 +103,8 @@ private:
 #if WIFI_USES_ESP32
 	EspUploadResult flashSpiSetParameters(uint32_t size) noexcept;
 	EspUploadResult flashSpiAttach() noexcept;
+	EspUploadResult changeBaudRate(uint32_t baud) noexcept;
+	bool FallBackToNormalBaudRate() noexcept;
 #endif
 	static uint16_t checksum(const uint8_t *data, uint16_t dataLen, uint16_t cksum) noexcept;
 	EspUploadResult flashWriteBlock(uint16_t flashParmVal, uint16_t flashParmMask) noexcept;
@@ -115,6 +123,10 @@ private:
 	UploadState state;
 	EspUploadResult uploadResult;
 	int restartModeOnCompletion;
+#if WIFI_USES_ESP32
+	bool usingFastBaudRate;
+	bool fastBaudRateFailed;
+#endif
 };
 
 #endif	// HAS_WIFI_NETWORKING
@@ -15,7 +15,7 @@
 #include <Platform/Platform.h>
 
 FtpResponder::FtpResponder(NetworkResponder *n) noexcept
-	: UploadingNetworkResponder(n), dataSocket(nullptr), passivePort(0), passivePortOpenTime(0), dataBuf(nullptr), haveFileToMove(false)
+	: UploadingNetworkResponder(n), dataSocket(nullptr), passivePort(0), passivePortOpenTime(0), allocateSize(0), dataBuf(nullptr), readAheadBuffer(nullptr), haveFileToMove(false)
 {
 }
 
@@ -25,7 +25,7 @@ bool FtpResponder::Accept(Socket *s, NetworkProtocol protocol) noexcept
 	if (responderState == ResponderState::free && protocol == FtpProtocol)
 	{
 		// Make sure we can get an output buffer before we accept the connection, or we won't be able to reply
-		if (outBuf != nullptr || OutputBuffer::Allocate(outBuf))
+		if (outBuf != nullptr || OutputBuffer::Allocate(outBuf, OutputBufferConsumer::ftp))
 		{
 			clientPointer = 0;
 			skt = s;
@@ -80,7 +80,7 @@ bool FtpResponder::Spin() noexcept
 		return true;
 
 	case ResponderState::waitingForPasvPort:
-		if (millis() - passivePortOpenTime > ftpPasvPortTimeout && (outBuf != nullptr || OutputBuffer::Allocate(outBuf)))
+		if (millis() - passivePortOpenTime > ftpPasvPortTimeout && (outBuf != nullptr || OutputBuffer::Allocate(outBuf, OutputBufferConsumer::ftp)))
 		{
 			outBuf->copy("425 Failed to establish connection.\r\n");
 			Commit(ResponderState::reading);
@@ -91,7 +91,7 @@ bool FtpResponder::Spin() noexcept
 		return false;
 
 	case ResponderState::pasvPortOpened:
-		if (dataBuf != nullptr || OutputBuffer::Allocate(dataBuf))
+		if (dataBuf != nullptr || OutputBuffer::Allocate(dataBuf, OutputBufferConsumer::ftp))
 		{
 			return ReadData();
 		}
@@ -116,7 +116,7 @@ bool FtpResponder::Spin() noexcept
 		return true;
 
 	case ResponderState::pasvTransferComplete:
-		if (outBuf != nullptr || OutputBuffer::Allocate(outBuf))
+		if (outBuf != nullptr || OutputBuffer::Allocate(outBuf, OutputBufferConsumer::ftp))
 		{
 			// Is the main FTP connection still available?
 			if (skt->CanSend())
@@ -279,16 +279,21 @@ void FtpResponder::SendPassiveData() noexcept
 	}
 
 	// If we have a file buffer here, we must be in the process of sending a file
+	unsigned int buffersSent = 0;
 	while (fileBuffer != nullptr)
 	{
-		if (fileBuffer->IsEmpty() && fileBeingSent != nullptr)
+		if (fileBuffer->IsEmpty())
 		{
-			const int bytesRead = fileBuffer->ReadFromFile(fileBeingSent);
-			if (bytesRead != (int)NetworkBuffer::bufferSize)
+			if (readAheadBuffer != nullptr)
+			{
+				// Send the data that we read while the socket was busy with the previous buffer
+				fileBuffer->Release();
+				fileBuffer = readAheadBuffer;
+				readAheadBuffer = nullptr;
+			}
+			else if (fileBeingSent != nullptr)
 			{
-				// We had a read error or we reached the end of the file
-				fileBeingSent->Close();
-				fileBeingSent = nullptr;
+				ReadFileChunk(fileBuffer);
 			}
 		}
 
@@ -321,17 +326,28 @@ void FtpResponder::SendPassiveData() noexcept
 					}
 					fileBuffer->Release();
 					fileBuffer = nullptr;
+					ReleaseReadAheadBuffer();
 
 					responderState = ResponderState::pasvTransferComplete;
 				}
+				else
+				{
+					ReadAhead();
+				}
 				return;
 			}
 
 			fileBuffer->Taken(sent);
 			if (sent < remaining)
 			{
+				ReadAhead();
 				return;
 			}
+			if (++buffersSent >= MaxFileBuffersPerSend)
+			{
+				ReadAhead();
+				return;							// let other responders run
+			}
 		}
 	}
 
@@ -343,6 +359,39 @@ void FtpResponder::SendPassiveData() noexcept
 	responderState = ResponderState::pasvTransferComplete;
 }
 
+// Read the next chunk of the file being sent into a buffer, closing the file if we reached the end of it or the read failed
+void FtpResponder::ReadFileChunk(NetworkBuffer *buf) noexcept
+{
+	const int bytesRead = buf->ReadFromFile(fileBeingSent);
+	if (bytesRead != (int)NetworkBuffer::bufferSize)
+	{
+		fileBeingSent->Close();
+		fileBeingSent = nullptr;
+	}
+}
+
+// The data socket can't take any more data for now. While it sends what it has, read the next chunk of the file so that it is ready when the socket wants it.
+void FtpResponder::ReadAhead() noexcept
+{
+	if (fileBeingSent != nullptr && readAheadBuffer == nullptr)
+	{
+		readAheadBuffer = NetworkBuffer::Allocate();
+		if (readAheadBuffer != nullptr)
+		{
+			ReadFileChunk(readAheadBuffer);
+		}
+	}
+}
+
+void FtpResponder::ReleaseReadAheadBuffer() noexcept
+{
+	if (readAheadBuffer != nullptr)
+	{
+		readAheadBuffer->Release();
+		readAheadBuffer = nullptr;
+	}
+}
+
 // Write some more upload data
 void FtpResponder::DoUpload() noexcept
 {
@@ -357,6 +406,7 @@ void FtpResponder::DoUpload() noexcept
 		}
 
 		dataSocket->Taken(len);
+		uploadedBytes += len;
 		if (!fileBeingUploaded.Write(buffer, len))
 		{
 			uploadError = true;
@@ -396,7 +446,7 @@ bool FtpResponder::ReadData() noexcept
 		return true;
 	}
 
-	if (haveCompleteLine && (outBuf != nullptr || OutputBuffer::Allocate(outBuf)))
+	if (haveCompleteLine && (outBuf != nullptr || OutputBuffer::Allocate(outBuf, OutputBufferConsumer::ftp)))
 	{
 		ProcessLine();
 		return true;
@@ -450,6 +500,7 @@ void FtpResponder::ProcessLine() noexcept
 	{
 	case ResponderState::authenticating:
 		haveFileToMove = false;
+		allocateSize = 0;
 		filenameBeingProcessed.Clear();
 
 		// don't check the user name
@@ -646,6 +697,13 @@ void FtpResponder::ProcessLine() noexcept
 			haveFileToMove = false;
 			Commit(ResponderState::reading);
 		}
+		// reserve space for the next file to be stored
+		else if (StringStartsWith(clientMessage, "ALLO"))
+		{
+			allocateSize = StrToU32(GetParameter("ALLO"));
+			outBuf->copy("200 ALLO command successful.\r\n");
+			Commit(ResponderState::reading);
+		}
 		// no op
 		else if (StringEqualsIgnoreCase(clientMessage, "NOOP"))
 		{
@@ -710,6 +768,13 @@ void FtpResponder::ProcessLine() noexcept
 			}
 			Commit(ResponderState::pasvPortOpened);
 		}
+		// reserve space for the file to be stored
+		else if (StringStartsWith(clientMessage, "ALLO"))
+		{
+			allocateSize = StrToU32(GetParameter("ALLO"));
+			outBuf->copy("200 ALLO command successful.\r\n");
+			Commit(ResponderState::pasvPortOpened);
+		}
 		// upload a file
 		else if (StringStartsWith(clientMessage, "STOR"))
 		{
@@ -717,8 +782,11 @@ void FtpResponder::ProcessLine() noexcept
 			haveFileToMove = false;
 			filenameBeingProcessed.Clear();
 
+			// If the client sent ALLO then pre-allocate the file so that it is contiguous
 			const char * const filename = GetParameter("STOR");
-			if (StartUpload(currentDirectory.c_str(), filename, OpenMode::write))
+			const uint32_t preAllocSize = allocateSize;
+			allocateSize = 0;
+			if (StartUpload(currentDirectory.c_str(), filename, OpenMode::write, preAllocSize))
 			{
 				outBuf->copy("150 OK to send data.\r\n");
 				Commit(ResponderState::uploading);
@@ -907,6 +975,14 @@ void FtpResponder::CloseDataPort() noexcept
 		fileBeingSent->Close();
 		fileBeingSent = nullptr;
 	}
+
+	// Discard any file data that we haven't sent, so that it isn't sent at the start of the next transfer
+	if (fileBuffer != nullptr)
+	{
+		fileBuffer->Release();
+		fileBuffer = nullptr;
+	}
+	ReleaseReadAheadBuffer();
 }
 
 /*static*/ void FtpResponder::InitStatic() noexcept
@@ -28,6 +28,9 @@ protected:
 	void ConnectionLost() noexcept override;
 	void SendData() noexcept override;
 	void SendPassiveData() noexcept;
+	void ReadFileChunk(NetworkBuffer *buf) noexcept;
+	void ReadAhead() noexcept;
+	void ReleaseReadAheadBuffer() noexcept;
 	void DoUpload() noexcept;
 	bool ReadData() noexcept;
 	void CharFromClient(char c) noexcept;
@@ -42,7 +45,9 @@ protected:
 	Socket *dataSocket;
 	TcpPort passivePort;
 	uint32_t passivePortOpenTime;
+	uint32_t allocateSize;								// the file size given by the last ALLO command, or 0 if none
 	OutputBuffer *dataBuf;
+	NetworkBuffer *readAheadBuffer;						// the next chunk of the file being sent, read while the data socket was busy
 
 	bool sendError;
 	bool haveCompleteLine;
@@ -14,6 +14,30 @@
 #include "GCodes/GCodes.h"
 #include "General/IP4String.h"
 
+#if SUPPORT_WEB_FILE_CACHE
+# include "WebFileCache.h"
+#endif
+
+#if SUPPORT_METRICS
+# include <Platform/Metrics.h>
+#endif
+
+#if SUPPORT_MODEL_RESPONSE_CACHE
+# include "ModelResponseCache.h"
+#endif
+
+#if SUPPORT_ACCELEROMETERS
+# include <Accelerometers/Accelerometers.h>
+#endif
+
+#if SUPPORT_EVENT_TRACE
+# include <Platform/EventTrace.h>
+#endif
+
+#if SUPPORT_WEBSOCKETS
+# include <Libraries/sha1/sha1.h>
+#endif
+
 #define KO_START "rr_"
 const size_t KoFirst = 3;
 
@@ -23,6 +47,29 @@ const char serviceUnavailableResponse[] = "HTTP/1.1 503 Service Unavailable\r\n\
 static_assert(ARRAY_SIZE(serviceUnavailableResponse) <= OUTPUT_BUFFER_SIZE, "OUTPUT_BUFFER_SIZE too small");
 
 const uint32_t HttpReceiveTimeout = 2000;
+const uint32_t HttpKeepAliveTimeout = 5000;						// how long we keep an idle persistent connection open waiting for the next request
+const size_t MaxPersistentConnections = NumHttpResponders - 1;		// leave at least one responder free to accept new connections
+
+#if SUPPORT_WEBSOCKETS
+const uint32_t WebSocketUpdateInterval = 250;					// how often we send WebSocket clients the live fields of the object model
+const uint32_t WebSocketMinUpdateInterval = 50;					// the minimum interval between updates, to limit the rate when the model is changing
+const size_t MaxWebSocketFlagsLength = 8;						// so that we can append 'u' and the change counter to the flags
+const char *_ecv_array const DefaultWebSocketFlags = "d99n";
+const char *_ecv_array const WebSocketGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// WebSocket opcodes
+const uint8_t WsOpcodeContinuation = 0x00;
+const uint8_t WsOpcodeText = 0x01;
+const uint8_t WsOpcodeBinary = 0x02;
+const uint8_t WsOpcodeClose = 0x08;
+const uint8_t WsOpcodePing = 0x09;
+const uint8_t WsOpcodePong = 0x0A;
+
+// WebSocket close status codes
+const uint16_t WsStatusProtocolError = 1002;
+const uint16_t WsStatusPolicyViolation = 1008;
+const uint16_t WsStatusMessageTooBig = 1009;
+#endif
 
 // Text for a human-readable 404 page
 const char* const ErrorPagePart1 =
@@ -36,7 +83,16 @@ const char* const ErrorPagePart2 =
 	"</p>\n"
 	"</body>\n";
 
-HttpResponder::HttpResponder(NetworkResponder *n) noexcept : UploadingNetworkResponder(n)
+HttpResponder::HttpResponder(NetworkResponder *n) noexcept : UploadingNetworkResponder(n), isPersistent(false)
+#if SUPPORT_OBJECT_MODEL
+	, streamingModel(false), binaryModelResponse(false)
+#endif
+#if HAS_MASS_STORAGE
+	, thumbnailFile(nullptr), thumbnailOffset(0), thumbnailStreamLastProgressTime(0), streamingThumbnail(false)
+#endif
+#if SUPPORT_WEBSOCKETS
+	, isWebSocket(false)
+#endif
 {
 }
 
@@ -48,14 +104,7 @@ bool HttpResponder::Accept(Socket *s, NetworkProtocol protocol) noexcept
 		responderState = ResponderState::reading;
 		skt = s;
 		timer = millis();
-
-		// Reset the parse state variables
-		clientPointer = 0;
-		parseState = HttpParseState::doingCommandWord;
-		numCommandWords = 0;
-		numQualKeys = 0;
-		numHeaderKeys = 0;
-		commandWords[0] = clientMessage;
+		ResetParser();
 
 		if (reprap.Debug(moduleWebserver))
 		{
@@ -66,6 +115,23 @@ bool HttpResponder::Accept(Socket *s, NetworkProtocol protocol) noexcept
 	return false;
 }
 
+// Reset the parse state variables ready to receive a request
+void HttpResponder::ResetParser() noexcept
+{
+	clientPointer = 0;
+	parseState = HttpParseState::doingCommandWord;
+	numCommandWords = 0;
+	numQualKeys = 0;
+	numHeaderKeys = 0;
+	commandWords[0] = clientMessage;
+#if SUPPORT_OBJECT_MODEL
+	streamingModel = false;
+#endif
+#if HAS_MASS_STORAGE
+	StopThumbnailStream();
+#endif
+}
+
 // Do some work, returning true if we did anything significant
 bool HttpResponder::Spin() noexcept
 {
@@ -76,15 +142,24 @@ bool HttpResponder::Spin() noexcept
 
 	case ResponderState::reading:
 		{
+			// Parse the request directly from the socket's receive buffers, which is much faster than fetching one character at a time.
+			// When we reach the end of the request we take only the characters we have used, so that any body or following request is left for later.
 			bool readSomething = false;
-			char c;
-			while (skt->ReadChar(c))
+			const uint8_t *_ecv_array data;
+			size_t len;
+			while (skt->ReadBuffer(data, len))
 			{
-				if (CharFromClient(c))
+				for (size_t i = 0; i < len; )
 				{
-					timer = millis();		// restart the timeout
-					return true;
+					i += CopyPlainChars(data + i, len - i);
+					if (i < len && CharFromClient((char)data[i++]))
+					{
+						skt->Taken(i);
+						timer = millis();	// restart the timeout
+						return true;
+					}
 				}
+				skt->Taken(len);
 				readSomething = true;
 			}
 
@@ -95,7 +170,19 @@ bool HttpResponder::Spin() noexcept
 				return true;
 			}
 
-			if (!skt->CanRead() || millis() - timer >= HttpReceiveTimeout)
+			if (isPersistent && clientPointer == 0)
+			{
+				// We are waiting for the next request on a persistent connection. If it doesn't arrive, close the connection normally.
+				if (!skt->CanRead() || millis() - timer >= HttpKeepAliveTimeout)
+				{
+					skt->Close();
+					skt = nullptr;
+					EndPersistence();
+					responderState = ResponderState::free;
+					return true;
+				}
+			}
+			else if (!skt->CanRead() || millis() - timer >= HttpReceiveTimeout)
 			{
 				ConnectionLost();
 				return true;
@@ -122,11 +209,47 @@ bool HttpResponder::Spin() noexcept
 		SendData();
 		return true;
 
+#if SUPPORT_WEBSOCKETS
+	case ResponderState::webSocket:
+		return WebSocketSpin();
+#endif
+
 	default:	// should not happen
 		return false;
 	}
 }
 
+// Copy a run of characters that CharFromClient would simply store, stopping at the first one that it needs to act on. Return the number of characters copied.
+// This lets us handle most of the characters in a request with block searches and copies, leaving the state machine to deal with the delimiters.
+size_t HttpResponder::CopyPlainChars(const uint8_t *_ecv_array data, size_t len) noexcept
+{
+	const char *_ecv_array delimiters;
+	switch (parseState)
+	{
+	case HttpParseState::doingCommandWord:		delimiters = "\n\r \t"; break;
+	case HttpParseState::doingFilename:			delimiters = "\n\r \t?%"; break;
+	case HttpParseState::doingQualifierValue:	delimiters = "\n\r \t%&+"; break;
+	case HttpParseState::doingHeaderKey:		delimiters = "\n\r:"; break;
+	case HttpParseState::doingHeaderValue:		delimiters = "\n\r"; break;
+	default:									return 0;
+	}
+
+	// Never fill the message buffer, so that CharFromClient still detects overflow
+	size_t run = min<size_t>(len, ARRAY_SIZE(clientMessage) - 1 - clientPointer);
+	for (const char *_ecv_array p = delimiters; *p != 0 && run != 0; ++p)
+	{
+		const void *const found = memchr(data, *p, run);
+		if (found != nullptr)
+		{
+			run = static_cast<const uint8_t *>(found) - data;
+		}
+	}
+
+	memcpy(clientMessage + clientPointer, data, run);
+	clientPointer += run;
+	return run;
+}
+
 // Process a character from the client
 // Rewritten as a state machine by dc42 to increase capability and speed, and reduce RAM requirement.
 // On entry:
@@ -453,7 +576,7 @@ bool HttpResponder::CharFromClient(char c) noexcept
 // This may also return true with response == nullptr if we tried to generate a response but ran out of buffers.
 bool HttpResponder::GetJsonResponse(const char *_ecv_array request, OutputBuffer *&response, bool& keepOpen) noexcept
 {
-	keepOpen = false;	// assume we don't want to persist the connection
+	keepOpen = true;	// assume that the connection may persist if the client wants it to
 	const char *parameter;
 	if (StringEqualsIgnoreCase(request, "connect") && (parameter = GetKeyValue("password")) != nullptr)
 	{
@@ -598,8 +721,20 @@ bool HttpResponder::GetJsonResponse(const char *_ecv_array request, OutputBuffer
 		FilePosition offset;
 		if (nameVal != nullptr && offsetVal != nullptr && (offset = StrToU32(offsetVal)) != 0)
 		{
-			OutputBuffer::ReleaseAll(response);
-			response = reprap.GetThumbnailResponse(nameVal, offset, false);
+			const char* const rawVal = GetKeyValue("raw");
+			if (rawVal != nullptr && StrToU32(rawVal) != 0)
+			{
+				// The client wants the whole thumbnail as binary image data
+				if (!StartThumbnailStream(nameVal, offset, response))
+				{
+					response->copy("{\"err\":1}");
+				}
+			}
+			else
+			{
+				OutputBuffer::ReleaseAll(response);
+				response = reprap.GetThumbnailResponse(nameVal, offset, false);
+			}
 		}
 		else
 		{
@@ -638,10 +773,28 @@ bool HttpResponder::GetJsonResponse(const char *_ecv_array request, OutputBuffer
 #if SUPPORT_OBJECT_MODEL
 	else if (StringEqualsIgnoreCase(request, "model"))
 	{
-		OutputBuffer::ReleaseAll(response);
 		const char *const filterVal = GetKeyValue("key");
 		const char *const flagsVal = GetKeyValue("flags");
-		response = reprap.GetModelResponse(nullptr, filterVal, flagsVal);
+		binaryModelResponse = (flagsVal != nullptr && strchr(flagsVal, 'b') != nullptr);
+		if ((filterVal == nullptr || filterVal[0] == 0) && flagsVal != nullptr && strlen(flagsVal) < modelStreamFlags.Capacity())
+		{
+			// A request for the whole object model can need a lot of output buffers, so generate it a branch at a time as we send it.
+			// We can't tell the client the length in advance, so the response ends when we close the connection.
+			modelStreamFlags.copy(flagsVal);
+			reprap.StartModelResponse(response, "", flagsVal);
+			modelStreamIndex = 0;
+			modelStreamFirst = true;
+			streamingModel = true;
+		}
+		else
+		{
+			OutputBuffer::ReleaseAll(response);
+#if SUPPORT_MODEL_RESPONSE_CACHE
+			response = ModelResponseCache::GetResponse(filterVal, flagsVal);		// this may be shared with other clients, so we must not add to it
+#else
+			response = reprap.GetModelResponse(nullptr, filterVal, flagsVal);
+#endif
+		}
 	}
 #endif
 	else if (StringEqualsIgnoreCase(request, "config"))
@@ -649,6 +802,20 @@ bool HttpResponder::GetJsonResponse(const char *_ecv_array request, OutputBuffer
 		OutputBuffer::ReleaseAll(response);
 		response = reprap.GetConfigResponse();
 	}
+#if SUPPORT_ACCELEROMETERS
+	else if (StringEqualsIgnoreCase(request, "accelerometer"))
+	{
+		OutputBuffer::ReleaseAll(response);
+		response = Accelerometers::GetStreamResponse();
+	}
+#endif
+#if SUPPORT_EVENT_TRACE
+	else if (StringEqualsIgnoreCase(request, "trace"))
+	{
+		OutputBuffer::ReleaseAll(response);
+		response = EventTrace::GetResponse();
+	}
+#endif
 	else
 	{
 		RejectMessage("Unknown request", 500);
@@ -687,7 +854,8 @@ bool HttpResponder::SendFileInfo(bool quitEarly) noexcept
 					);
 		outBuf->catf("Content-Length: %u\r\n", (jsonResponse != nullptr) ? jsonResponse->Length() : 0);
 		AddCorsHeader();
-		outBuf->cat("Connection: close\r\n\r\n");
+		const bool keepOpen = KeepConnectionOpen();
+		outBuf->catf("Connection: %s\r\n\r\n", keepOpen ? "keep-alive" : "close");
 		outBuf->Append(jsonResponse);
 		if (outBuf->HadOverflow())
 		{
@@ -698,7 +866,7 @@ bool HttpResponder::SendFileInfo(bool quitEarly) noexcept
 		else
 		{
 			filenameBeingProcessed.Clear();
-			Commit();
+			Commit(keepOpen ? ResponderState::reading : ResponderState::free);
 		}
 	}
 	return gotFileInfo;
@@ -717,6 +885,7 @@ bool HttpResponder::Authenticate() noexcept
 		sessions[numSessions].ip = GetRemoteIP();
 		sessions[numSessions].lastQueryTime = millis();
 		sessions[numSessions].isPostUploading = false;
+		sessions[numSessions].replySeq = seq;			// a new client doesn't want the replies to commands that were sent before it connected
 		numSessions++;
 		return true;
 	}
@@ -768,6 +937,10 @@ bool HttpResponder::RemoveAuthentication() noexcept
 		{
 			sessions[k] = sessions[k + 1];
 		}
+
+		// The session we removed may have been the only one that hadn't fetched the oldest replies
+		MutexLocker lock(gcodeReplyMutex);
+		ReleaseServedGCodeReplies();
 	}
 }
 
@@ -776,6 +949,9 @@ void HttpResponder::SendFile(const char *_ecv_array nameOfFileToSend, bool isWeb
 #if HAS_MASS_STORAGE
 	FileStore *fileToSend = nullptr;
 	bool zip = false;
+	FilePosition fileLength = 0;
+	time_t lastModified = 0;
+	NetworkBuffer *cachedContents = nullptr;			// if we are sending a web file that we hold in RAM, the buffer holding it
 
 	if (isWebFile)
 	{
@@ -795,53 +971,133 @@ void HttpResponder::SendFile(const char *_ecv_array nameOfFileToSend, bool isWeb
 		// or file download requests after IP address changes
 		if (strlen(nameOfFileToSend) <= MaxExpectedWebDirFilenameLength)
 		{
-			for (;;)
+			static_assert(MaxExpectedWebDirFilenameLength + 3 <= MaxFilenameLength);			// this ensures that we can append '.gz' to the filename without overflow
+			String<MaxFilenameLength> nameBuf;
+			const char *_ecv_array const requestedName = nameOfFileToSend;
+
+#if SUPPORT_WEB_FILE_CACHE
+			// If we know the size and date of the file then we may not need to access the SD card at all
+			const WebFileCache::Entry *const cacheEntry = WebFileCache::Find(requestedName);
+			if (cacheEntry != nullptr)
 			{
-				// Try to open a gzipped version of the file first
-				if (!StringEndsWithIgnoreCase(nameOfFileToSend, ".gz"))
+				zip = cacheEntry->zip;
+				fileLength = cacheEntry->size;
+				lastModified = cacheEntry->lastModified;
+				if (ClientHasCurrentCopy(fileLength, lastModified))
+				{
+					WebFileCache::RecordNotModified();
+					SendNotModified(fileLength, lastModified);
+					return;
+				}
+
+				if (cacheEntry->dataSlot >= 0 && (cachedContents = NetworkBuffer::Allocate()) != nullptr)
 				{
-					static_assert(MaxExpectedWebDirFilenameLength + 3 <= MaxFilenameLength);			// this ensures that we can append '.gz' to the filename without overflow
-					String<MaxFilenameLength> nameBuf;
-					nameBuf.copy(nameOfFileToSend);
-					nameBuf.cat(".gz");
+					(void)cachedContents->AppendData(WebFileCache::GetData(*cacheEntry), fileLength);
+				}
+				else
+				{
+					nameBuf.copy(requestedName);
+					if (zip)
+					{
+						nameBuf.cat(".gz");
+					}
 					fileToSend = GetPlatform().OpenFile(Platform::GetWebDir(), nameBuf.c_str(), OpenMode::read);
+				}
+			}
+
+			if (cachedContents == nullptr && fileToSend == nullptr)
+#endif
+			{
+				zip = false;
+				lastModified = 0;
+				for (;;)
+				{
+					// Try to open a gzipped version of the file first
+					if (!StringEndsWithIgnoreCase(nameOfFileToSend, ".gz"))
+					{
+						nameBuf.copy(nameOfFileToSend);
+						nameBuf.cat(".gz");
+						fileToSend = GetPlatform().OpenFile(Platform::GetWebDir(), nameBuf.c_str(), OpenMode::read);
+						if (fileToSend != nullptr)
+						{
+							zip = true;
+							break;
+						}
+					}
+
+					// That failed, so try to open the normal version of the file
+					fileToSend = GetPlatform().OpenFile(Platform::GetWebDir(), nameOfFileToSend, OpenMode::read);
 					if (fileToSend != nullptr)
 					{
-						zip = true;
+						break;
+					}
+
+					if (StringEqualsIgnoreCase(nameOfFileToSend, INDEX_PAGE_FILE))
+					{
+						nameOfFileToSend = OLD_INDEX_PAGE_FILE;			// the index file wasn't found, so try the old one
+					}
+					else if (!strchr(nameOfFileToSend, '.'))			// if we were asked to return a file without a '.' in the name, return the index page
+					{
+						nameOfFileToSend = INDEX_PAGE_FILE;
+					}
+					else
+					{
 						break;
 					}
 				}
 
-				// That failed, so try to open the normal version of the file
-				fileToSend = GetPlatform().OpenFile(Platform::GetWebDir(), nameOfFileToSend, OpenMode::read);
 				if (fileToSend != nullptr)
 				{
-					break;
-				}
+					// Get the date of the file so that we can tell the client how to check whether its copy is up to date
+					fileLength = fileToSend->Length();
+					if (MassStorage::CombineName(nameBuf.GetRef(), Platform::GetWebDir(), nameOfFileToSend) && (!zip || !nameBuf.cat(".gz")))
+					{
+						lastModified = MassStorage::GetLastModifiedTime(nameBuf.c_str());
+					}
 
-				if (StringEqualsIgnoreCase(nameOfFileToSend, INDEX_PAGE_FILE))
-				{
-					nameOfFileToSend = OLD_INDEX_PAGE_FILE;			// the index file wasn't found, so try the old one
-				}
-				else if (!strchr(nameOfFileToSend, '.'))			// if we were asked to return a file without a '.' in the name, return the index page
-				{
-					nameOfFileToSend = INDEX_PAGE_FILE;
-				}
-				else
-				{
-					break;
+#if SUPPORT_WEB_FILE_CACHE
+					// Only remember the file if we didn't substitute another one for it, so that a later request for the same name gets the same file
+					if (nameOfFileToSend == requestedName)
+					{
+						const WebFileCache::Entry *const newEntry = WebFileCache::Store(requestedName, zip, lastModified, fileToSend);
+						if (newEntry != nullptr && newEntry->dataSlot >= 0 && (cachedContents = NetworkBuffer::Allocate()) != nullptr)
+						{
+							(void)cachedContents->AppendData(WebFileCache::GetData(*newEntry), fileLength);
+							fileToSend->Close();
+							fileToSend = nullptr;
+						}
+					}
+#endif
+					if (ClientHasCurrentCopy(fileLength, lastModified))
+					{
+						if (fileToSend != nullptr)
+						{
+							fileToSend->Close();
+						}
+						if (cachedContents != nullptr)
+						{
+							cachedContents->Release();
+						}
+						SendNotModified(fileLength, lastModified);
+						return;
+					}
 				}
 			}
 		}
 
 		// If we still couldn't find the file and it was an HTML file, return the 404 error page
-		if (fileToSend == nullptr && (StringEndsWithIgnoreCase(nameOfFileToSend, ".html") || StringEndsWithIgnoreCase(nameOfFileToSend, ".htm")))
+		if (fileToSend == nullptr && cachedContents == nullptr && (StringEndsWithIgnoreCase(nameOfFileToSend, ".html") || StringEndsWithIgnoreCase(nameOfFileToSend, ".htm")))
 		{
 			nameOfFileToSend = FOUR04_PAGE_FILE;
 			fileToSend = GetPlatform().OpenFile(Platform::GetWebDir(), nameOfFileToSend, OpenMode::read);
+			lastModified = 0;							// don't let the client cache the error page in place of the file it asked for
+			if (fileToSend != nullptr)
+			{
+				fileLength = fileToSend->Length();
+			}
 		}
 
-		if (fileToSend == nullptr)
+		if (fileToSend == nullptr && cachedContents == nullptr)
 		{
 			RejectMessage("page not found<br>Check that the SD card is mounted and has the correct files in its /www folder", 404);
 			return;
@@ -855,9 +1111,11 @@ void HttpResponder::SendFile(const char *_ecv_array nameOfFileToSend, bool isWeb
 			RejectMessage("file not found", 404);
 			return;
 		}
+		fileLength = fileToSend->Length();
 	}
 
 	fileBeingSent = fileToSend;
+	fileBuffer = cachedContents;
 	outBuf->copy("HTTP/1.1 200 OK\r\n");
 
 	// Don't cache files served by rr_download
@@ -869,6 +1127,10 @@ void HttpResponder::SendFile(const char *_ecv_array nameOfFileToSend, bool isWeb
 					);
 		AddCorsHeader();
 	}
+	else if (lastModified != 0)
+	{
+		AppendValidators(fileLength, lastModified);
+	}
 
 	const char* contentType;
 	if (StringEndsWithIgnoreCase(nameOfFileToSend, ".png"))
@@ -911,40 +1173,130 @@ void HttpResponder::SendFile(const char *_ecv_array nameOfFileToSend, bool isWeb
 		outBuf->cat("Content-Encoding: gzip\r\n");
 	}
 
-	outBuf->catf("Content-Length: %lu\r\n", fileToSend->Length());
-	outBuf->cat("Connection: close\r\n\r\n");
-	Commit();
+	outBuf->catf("Content-Length: %lu\r\n", fileLength);
+	const bool keepOpen = KeepConnectionOpen();
+	outBuf->catf("Connection: %s\r\n\r\n", keepOpen ? "keep-alive" : "close");
+	Commit(keepOpen ? ResponderState::reading : ResponderState::free);
 #else
 	RejectMessage("file not found", 404);
 #endif
 }
 
+#if HAS_MASS_STORAGE
+
+// Make the entity tag that we use to identify a version of a web file. It changes if the file is replaced by one of a different size or date.
+/*static*/ void HttpResponder::MakeETag(const StringRef& etag, FilePosition fileLength, time_t lastModified) noexcept
+{
+	etag.printf("\"%08lx-%08lx\"", (unsigned long)fileLength, (unsigned long)lastModified);
+}
+
+// Make a date in the format that HTTP uses, e.g. "Tue, 14 Oct 2026 10:20:30 GMT"
+/*static*/ void HttpResponder::MakeHttpDate(const StringRef& date, time_t t) noexcept
+{
+	static const char *_ecv_array const DayNames[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+	static const char *_ecv_array const MonthNames[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+	tm timeInfo;
+	gmtime_r(&t, &timeInfo);
+	date.printf("%s, %02d %s %04d %02d:%02d:%02d GMT",
+					DayNames[timeInfo.tm_wday], timeInfo.tm_mday, MonthNames[timeInfo.tm_mon], timeInfo.tm_year + 1900,
+					timeInfo.tm_hour, timeInfo.tm_min, timeInfo.tm_sec);
+}
+
+// Append the headers that let the client check later whether its copy of a web file is up to date
+void HttpResponder::AppendValidators(FilePosition fileLength, time_t lastModified) noexcept
+{
+	String<StringLength50> str;
+	MakeETag(str.GetRef(), fileLength, lastModified);
+	outBuf->catf("ETag: %s\r\n", str.c_str());
+	MakeHttpDate(str.GetRef(), lastModified);
+	outBuf->catf("Last-Modified: %s\r\n", str.c_str());
+}
+
+// Return true if the request was conditional and the client already has this version of the file.
+// If the client sent an entity tag then we use that and ignore the date, as RFC 7232 requires. We only generate dates in one format, so an exact match is sufficient.
+bool HttpResponder::ClientHasCurrentCopy(FilePosition fileLength, time_t lastModified) const noexcept
+{
+	if (lastModified == 0)
+	{
+		return false;								// we don't know the date of the file, so we didn't give the client any validators
+	}
+
+	const char *_ecv_array ifModifiedSince = nullptr;
+	for (size_t i = 0; i < numHeaderKeys; ++i)
+	{
+		if (StringEqualsIgnoreCase(headers[i].key, "If-None-Match"))
+		{
+			String<StringLength50> etag;
+			MakeETag(etag.GetRef(), fileLength, lastModified);
+			return strstr(headers[i].value, etag.c_str()) != nullptr;		// the header may hold a list of tags
+		}
+		if (StringEqualsIgnoreCase(headers[i].key, "If-Modified-Since"))
+		{
+			ifModifiedSince = headers[i].value;
+		}
+	}
+
+	if (ifModifiedSince != nullptr)
+	{
+		String<StringLength50> date;
+		MakeHttpDate(date.GetRef(), lastModified);
+		return StringEqualsIgnoreCase(ifModifiedSince, date.c_str());
+	}
+	return false;
+}
+
+// Tell the client that its copy of the file is up to date
+void HttpResponder::SendNotModified(FilePosition fileLength, time_t lastModified) noexcept
+{
+	outBuf->copy("HTTP/1.1 304 Not Modified\r\n");
+	AppendValidators(fileLength, lastModified);
+	const bool keepOpen = KeepConnectionOpen();
+	outBuf->catf("Connection: %s\r\n\r\n", keepOpen ? "keep-alive" : "close");
+	Commit(keepOpen ? ResponderState::reading : ResponderState::free);
+}
+
+#endif
+
 void HttpResponder::SendGCodeReply() noexcept
 {
+	bool keepOpen;
 	{
-		// Do we need to keep the G-Code reply for other clients?
-		bool clearReply = false;
 		MutexLocker Lock(gcodeReplyMutex);
 
-		if (!gcodeReply.IsEmpty())
+		// Find the session for this client so that we can send it the replies that it hasn't had yet
+		HttpSession *session = nullptr;
+		const IPAddress remoteIP = GetRemoteIP();
+		for (size_t i = 0; i < numSessions; i++)
 		{
-			clientsServed++;
-			if (clientsServed < numSessions)
+			if (sessions[i].ip == remoteIP)
 			{
-				// Yes - make sure the Network class doesn't discard its buffers yet
-				// NB: This must happen here, because NetworkTransaction::Write() might already release OutputBuffers
-				gcodeReply.IncreaseReferences(1);
+				session = &sessions[i];
+				break;
 			}
-			else
+		}
+
+		size_t replyLength = 0;
+		if (session != nullptr)
+		{
+			for (size_t i = 0; i < numGCodeReplies; ++i)
 			{
-				// No - clean up again later
-				clearReply = true;
+				const GCodeReply& reply = gcodeReplies[(firstGCodeReply + i) % MaxGCodeReplies];
+				if ((int16_t)(reply.seq - session->replySeq) > 0)
+				{
+					// The reply stays in the ring for other clients, so the network transaction needs its own reference to the buffers.
+					// NB: This must happen here, because NetworkTransaction::Write() might already release OutputBuffers
+					reply.buf->IncreaseReferences(1);
+					replyLength += reply.buf->Length();
+					outStack.Push(reply.buf);
+				}
 			}
 
-			if (reprap.Debug(moduleWebserver))
+			if (reprap.Debug(moduleWebserver) && replyLength != 0)
 			{
-				GetPlatform().MessageF(UsbMessage, "Sending G-Code reply to HTTP client %d of %d (length %u)\n", clientsServed, numSessions, gcodeReply.DataLength());
+				GetPlatform().MessageF(UsbMessage, "Sending G-Code reply to HTTP client (length %u)\n", replyLength);
 			}
+			session->replySeq = seq;
+			ReleaseServedGCodeReplies();
 		}
 
 		// Send the whole G-Code reply as plain text to the client
@@ -954,21 +1306,75 @@ void HttpResponder::SendGCodeReply() noexcept
 						"Expires: 0\r\n"
 						"Content-Type: text/plain\r\n"
 					);
-		outBuf->catf("Content-Length: %u\r\n", gcodeReply.DataLength());
+		outBuf->catf("Content-Length: %u\r\n", replyLength);
 		AddCorsHeader();
-		outBuf->cat("Connection: close\r\n\r\n");
-		outStack.Append(gcodeReply);
+		keepOpen = KeepConnectionOpen();
+		outBuf->catf("Connection: %s\r\n\r\n", keepOpen ? "keep-alive" : "close");
+	}
 
-		// Possibly clean up the G-code reply once again
-		if (clearReply)
-		{
-			gcodeReply.Clear();
-		}
+	Commit(keepOpen ? ResponderState::reading : ResponderState::free);
+}
+
+#if SUPPORT_METRICS
+
+// Send the counters and gauges in the Prometheus text format in response to a /metrics request. outBuf is non-null on entry.
+void HttpResponder::SendMetrics() noexcept
+{
+	if (!CheckAuthenticated() && reprap.NoPasswordSet())
+	{
+		Authenticate();
+	}
+
+	if (!CheckAuthenticated())
+	{
+		RejectMessage("Not authorized", 401);
+		return;
+	}
+
+	OutputBuffer *metricsResponse;
+	if (!OutputBuffer::Allocate(metricsResponse, OutputBufferConsumer::http))
+	{
+		ReportOutputBufferExhaustion(__FILE__, __LINE__);
+		outBuf->copy(serviceUnavailableResponse);
+		Commit(ResponderState::free, false);
+		return;
+	}
+
+	Metrics::Report(metricsResponse);
+	if (metricsResponse->HadOverflow())
+	{
+		OutputBuffer::ReleaseAll(metricsResponse);
+		ReportOutputBufferExhaustion(__FILE__, __LINE__);
+		outBuf->copy(serviceUnavailableResponse);
+		Commit(ResponderState::free, false);
+		return;
+	}
+
+	outBuf->copy(	"HTTP/1.1 200 OK\r\n"
+					"Cache-Control: no-cache, no-store, must-revalidate\r\n"
+					"Pragma: no-cache\r\n"
+					"Expires: 0\r\n"
+					"Content-Type: text/plain; version=0.0.4\r\n"
+				);
+	outBuf->catf("Content-Length: %u\r\n", metricsResponse->Length());
+	AddCorsHeader();
+	const bool keepOpen = KeepConnectionOpen();
+	outBuf->catf("Connection: %s\r\n\r\n", keepOpen ? "keep-alive" : "close");
+	outBuf->Append(metricsResponse);
+
+	if (outBuf->HadOverflow())
+	{
+		ReportOutputBufferExhaustion(__FILE__, __LINE__);
+		outBuf->copy(serviceUnavailableResponse);
+		Commit(ResponderState::free, false);
+		return;
 	}
 
-	Commit();
+	Commit(keepOpen ? ResponderState::reading : ResponderState::free, false);
 }
 
+#endif
+
 // Send a JSON response to the current command. outBuf is non-null on entry.
 void HttpResponder::SendJsonResponse(const char *_ecv_array command) noexcept
 {
@@ -987,6 +1393,14 @@ void HttpResponder::SendJsonResponse(const char *_ecv_array command) noexcept
 			return;
 		}
 
+#if SUPPORT_WEBSOCKETS
+		if (StringEqualsIgnoreCase(command, "model") && IsWebSocketUpgrade())
+		{
+			StartWebSocket();
+			return;
+		}
+#endif
+
 #if HAS_MASS_STORAGE
 		if (StringEqualsIgnoreCase(command, "download"))
 		{
@@ -1003,8 +1417,11 @@ void HttpResponder::SendJsonResponse(const char *_ecv_array command) noexcept
 	// Try to process a request for JSON responses
 	OutputBuffer *jsonResponse;
 	bool mayKeepOpen;
-	if (OutputBuffer::Allocate(jsonResponse))
+	if (OutputBuffer::Allocate(jsonResponse, OutputBufferConsumer::http))
 	{
+#if SUPPORT_OBJECT_MODEL
+		binaryModelResponse = false;
+#endif
 		const bool gotResponse = GetJsonResponse(command, jsonResponse, mayKeepOpen);
 		if (!gotResponse)
 		{
@@ -1024,6 +1441,12 @@ void HttpResponder::SendJsonResponse(const char *_ecv_array command) noexcept
 		// We ran out of buffers at some point.
 		// DC 2020-05-05: we no longer retry or discard responses if there are no buffers available, instead we return a 503 error immediately
 		ReportOutputBufferExhaustion(__FILE__, __LINE__);
+#if SUPPORT_OBJECT_MODEL
+		streamingModel = false;
+#endif
+#if HAS_MASS_STORAGE
+		StopThumbnailStream();
+#endif
 
 		// We know that we have an output buffer, but it may be too short to send a long reply, so send a short one
 		outBuf->copy(serviceUnavailableResponse);
@@ -1032,20 +1455,14 @@ void HttpResponder::SendJsonResponse(const char *_ecv_array command) noexcept
 	}
 
 	// Send the JSON response
-	bool keepOpen = false;
-	if (mayKeepOpen)
-	{
-		// Check that the browser wants to persist the connection too
-		for (size_t i = 0; i < numHeaderKeys; ++i)
-		{
-			if (StringEqualsIgnoreCase(headers[i].key, "Connection"))
-			{
-				// Comment out the following line to disable persistent connections
-				keepOpen = StringEqualsIgnoreCase(headers[i].value, "keep-alive");
-				break;
-			}
-		}
-	}
+	const bool keepOpen = mayKeepOpen
+#if SUPPORT_OBJECT_MODEL
+							&& !streamingModel				// a streamed response has no length, so it ends when we close the connection
+#endif
+#if HAS_MASS_STORAGE
+							&& !streamingThumbnail
+#endif
+							&& KeepConnectionOpen();
 
 	// Note that when using RTOS the following response should preferably be small enough to fit in a single buffer.
 	// This is because the current task may get suspended e.g. when reading from SD card to build a file list,
@@ -1056,20 +1473,55 @@ void HttpResponder::SendJsonResponse(const char *_ecv_array command) noexcept
 					"Cache-Control: no-cache, no-store, must-revalidate\r\n"
 					"Pragma: no-cache\r\n"
 					"Expires: 0\r\n"
-					"Content-Type: application/json\r\n"
 				);
-	const unsigned int replyLength = (jsonResponse != nullptr) ? jsonResponse->Length() : 0;
-	outBuf->catf("Content-Length: %u\r\n", replyLength);
-	AddCorsHeader();
-	outBuf->catf("Connection: %s\r\n\r\n", keepOpen ? "keep-alive" : "close");
-	outBuf->Append(jsonResponse);
-
-	if (outBuf->HadOverflow())
+#if HAS_MASS_STORAGE
+	if (streamingThumbnail)
 	{
-		// We ran out of buffers at some point.
-		// DC 2020-05-05: we no longer retry or discard responses if there are no buffers available, instead we return a 503 error immediately
-		ReportOutputBufferExhaustion(__FILE__, __LINE__);
-
+		outBuf->cat("Content-Type: application/octet-stream\r\n");
+	}
+	else
+#endif
+	{
+#if SUPPORT_OBJECT_MODEL
+		outBuf->catf("Content-Type: %s\r\n", (binaryModelResponse) ? "application/cbor" : "application/json");
+#else
+		outBuf->cat("Content-Type: application/json\r\n");
+#endif
+	}
+	const unsigned int replyLength = (jsonResponse != nullptr) ? jsonResponse->Length() : 0;
+#if SUPPORT_OBJECT_MODEL
+	if (streamingModel)
+	{
+		modelStreamLastProgressTime = millis();
+	}
+	else
+#endif
+#if HAS_MASS_STORAGE
+	if (streamingThumbnail)
+	{
+		thumbnailStreamLastProgressTime = millis();
+	}
+	else
+#endif
+	{
+		outBuf->catf("Content-Length: %u\r\n", replyLength);
+	}
+	AddCorsHeader();
+	outBuf->catf("Connection: %s\r\n\r\n", keepOpen ? "keep-alive" : "close");
+	outBuf->Append(jsonResponse);
+
+	if (outBuf->HadOverflow())
+	{
+		// We ran out of buffers at some point.
+		// DC 2020-05-05: we no longer retry or discard responses if there are no buffers available, instead we return a 503 error immediately
+		ReportOutputBufferExhaustion(__FILE__, __LINE__);
+#if SUPPORT_OBJECT_MODEL
+		streamingModel = false;
+#endif
+#if HAS_MASS_STORAGE
+		StopThumbnailStream();
+#endif
+
 		// We know that we have an output buffer, but it may be too short to send a long reply, so send a short one
 		outBuf->copy(serviceUnavailableResponse);
 		Commit(ResponderState::free, false);
@@ -1130,7 +1582,7 @@ void HttpResponder::ProcessRequest() noexcept
 	}
 
 	// Reserve an output buffer before we process the request, or we won't be able to reply
-	if (outBuf != nullptr || OutputBuffer::Allocate(outBuf))
+	if (outBuf != nullptr || OutputBuffer::Allocate(outBuf, OutputBufferConsumer::http))
 	{
 		if (StringEqualsIgnoreCase(commandWords[0], "GET"))
 		{
@@ -1142,6 +1594,12 @@ void HttpResponder::ProcessRequest() noexcept
 			{
 				SendJsonResponse(commandWords[1] + 1 + KoFirst);
 			}
+#if SUPPORT_METRICS
+			else if (StringEqualsIgnoreCase(commandWords[1], "/metrics") || StringEqualsIgnoreCase(commandWords[1], "metrics"))
+			{
+				SendMetrics();
+			}
+#endif
 			else
 			{
 				SendFile(commandWords[1], true);
@@ -1286,7 +1744,7 @@ void HttpResponder::RejectMessage(const char *_ecv_array response, unsigned int
 		GetPlatform().MessageF(UsbMessage, "Webserver: rejecting message with: %u %s\n", code, response);
 	}
 
-	if (outBuf != nullptr || OutputBuffer::Allocate(outBuf))
+	if (outBuf != nullptr || OutputBuffer::Allocate(outBuf))		// not subject to the quota, so that we can still reject requests
 	{
 		outBuf->printf("HTTP/1.1 %u %s\r\n"
 					   "Connection: close\r\n", code, response);
@@ -1389,15 +1847,655 @@ void HttpResponder::CancelUpload() noexcept
 // This overrides the version in class NetworkResponder
 void HttpResponder::SendData() noexcept
 {
+#if SUPPORT_OBJECT_MODEL
+	// If we are streaming the object model, generate the next branch each time we have sent everything that we generated before
+	while (streamingModel)
+	{
+		if (!SendOutputBuffers() || !StreamNextModelBranch())
+		{
+			return;
+		}
+	}
+#endif
+#if HAS_MASS_STORAGE
+	while (streamingThumbnail)
+	{
+		if (!SendOutputBuffers() || !StreamNextThumbnailChunk())
+		{
+			return;
+		}
+	}
+#endif
 	NetworkResponder::SendData();
 	if (responderState == ResponderState::reading)
 	{
+		// We have sent the response on a persistent connection, so get ready for the next request. If the client has already sent it, we process it next.
 		timer = millis();				// restart the timer
+		ResetParser();
+	}
+	else if (responderState == ResponderState::free)
+	{
+		EndPersistence();
+#if SUPPORT_WEBSOCKETS
+		EndWebSocket();
+#endif
+	}
+}
+
+// This overrides the version in class UploadingNetworkResponder
+void HttpResponder::ConnectionLost() noexcept
+{
+	EndPersistence();
+#if HAS_MASS_STORAGE
+	StopThumbnailStream();
+#endif
+#if SUPPORT_WEBSOCKETS
+	EndWebSocket();
+#endif
+	UploadingNetworkResponder::ConnectionLost();
+}
+
+// Decide whether to keep the connection open after sending the response to the current request, and update the count of persistent connections.
+// HTTP/1.1 connections persist unless the client asks us to close them. HTTP/1.0 connections persist only if the client asks for keep-alive.
+bool HttpResponder::KeepConnectionOpen() noexcept
+{
+	bool wanted = (numCommandWords >= 3 && StringEqualsIgnoreCase(commandWords[2], "HTTP/1.1"));
+	for (size_t i = 0; i < numHeaderKeys; ++i)
+	{
+		if (StringEqualsIgnoreCase(headers[i].key, "Connection"))
+		{
+			if (StringEqualsIgnoreCase(headers[i].value, "keep-alive"))
+			{
+				wanted = true;
+			}
+			else if (StringEqualsIgnoreCase(headers[i].value, "close"))
+			{
+				wanted = false;
+			}
+			break;
+		}
+	}
+
+	if (!wanted)
+	{
+		EndPersistence();
+	}
+	else if (!isPersistent && numPersistentConnections < MaxPersistentConnections)
+	{
+		isPersistent = true;
+		++numPersistentConnections;
+	}
+	return isPersistent;
+}
+
+void HttpResponder::EndPersistence() noexcept
+{
+	if (isPersistent)
+	{
+		isPersistent = false;
+		--numPersistentConnections;
+	}
+}
+
+#if HAS_MASS_STORAGE
+
+// Open the file and put the first chunk of the decoded thumbnail in 'response'. Return false if the file couldn't be opened.
+bool HttpResponder::StartThumbnailStream(const char *_ecv_array filename, FilePosition offset, OutputBuffer *response) noexcept
+{
+	StopThumbnailStream();
+	FileStore * const f = GetPlatform().OpenFile(Platform::GetGCodeDir(), filename, OpenMode::read);
+	if (f == nullptr)
+	{
+		return false;
+	}
+	if (!f->Seek(offset))
+	{
+		f->Close();
+		return false;
+	}
+
+	thumbnailFile = f;
+	thumbnailOffset = offset;
+	streamingThumbnail = true;
+	if (!RepRap::AppendThumbnailData(thumbnailFile, response, thumbnailOffset, ThumbnailStreamChunkChars, true) || thumbnailOffset == 0)
+	{
+		StopThumbnailStream();									// the thumbnail fitted in the first chunk
+	}
+	return true;
+}
+
+// Decode the next chunk of the thumbnail that we are streaming. Return true if we generated it or gave up, false if we need to wait for buffers.
+bool HttpResponder::StreamNextThumbnailChunk() noexcept
+{
+	OutputBuffer *buf;
+	if (OutputBuffer::Allocate(buf, OutputBufferConsumer::http))
+	{
+		const FilePosition oldOffset = thumbnailOffset;
+		// The previous chunk may have ended part way through a line that we read all of, so we always seek to the start of the data
+		const bool ok = thumbnailFile->Seek(thumbnailOffset)
+						&& RepRap::AppendThumbnailData(thumbnailFile, buf, thumbnailOffset, ThumbnailStreamChunkChars, true);
+		if (!buf->HadOverflow())
+		{
+			if (!ok || thumbnailOffset == 0)
+			{
+				StopThumbnailStream();							// if we couldn't read the file then closing the connection tells the client that the thumbnail is incomplete
+			}
+			outBuf = buf;
+			thumbnailStreamLastProgressTime = millis();
+			return true;
+		}
+
+		// There weren't enough free buffers for this chunk. Try it again when some have been released.
+		OutputBuffer::ReleaseAll(buf);
+		thumbnailOffset = oldOffset;
+	}
+
+	if (millis() - thumbnailStreamLastProgressTime >= MaxBufferWaitTime)
+	{
+		ReportOutputBufferExhaustion(__FILE__, __LINE__);
+		StopThumbnailStream();
+		return true;
+	}
+	return false;
+}
+
+void HttpResponder::StopThumbnailStream() noexcept
+{
+	streamingThumbnail = false;
+	if (thumbnailFile != nullptr)
+	{
+		thumbnailFile->Close();
+		thumbnailFile = nullptr;
+	}
+}
+
+#endif
+
+#if SUPPORT_OBJECT_MODEL
+
+// Generate the next part of an object model response that we are streaming. Return true if we generated it or gave up, false if we need to wait for buffers.
+bool HttpResponder::StreamNextModelBranch() noexcept
+{
+	OutputBuffer *buf;
+	if (OutputBuffer::Allocate(buf, OutputBufferConsumer::http))
+	{
+		const size_t oldIndex = modelStreamIndex;
+		const bool gotBranch = reprap.GetModelBranchResponse(buf, modelStreamFlags.c_str(), modelStreamIndex, modelStreamFirst);	// this finishes the response if there are no more branches
+
+		if (   !buf->HadOverflow()
+#if SUPPORT_WEBSOCKETS
+			&& (!isWebSocket || FrameWebSocketMessage(buf, WsOpcodeContinuation, !gotBranch))	// a WebSocket client gets each branch as a fragment of one message
+#endif
+		   )
+		{
+			modelStreamFirst = false;
+			streamingModel = gotBranch;
+			outBuf = buf;
+			modelStreamLastProgressTime = millis();
+			return true;
+		}
+
+		// There weren't enough free buffers for this branch. Try it again when some have been released.
+		OutputBuffer::ReleaseAll(buf);
+		modelStreamIndex = oldIndex;
+	}
+
+	if (millis() - modelStreamLastProgressTime >= MaxBufferWaitTime)
+	{
+		// We can't get enough buffers, so give up. Closing the connection tells the client that the response is incomplete.
+		ReportOutputBufferExhaustion(__FILE__, __LINE__);
+		streamingModel = false;
+#if SUPPORT_WEBSOCKETS
+		if (isWebSocket)
+		{
+			stateAfterSending = ResponderState::free;			// the client has received part of a message, so we can't continue
+		}
+#endif
+		return true;
+	}
+	return false;
+}
+
+#endif
+
+#if SUPPORT_WEBSOCKETS
+
+// WebSocket support (RFC 6455).
+// A client subscribes to object model updates by sending a WebSocket upgrade request for rr_model, with an optional 'flags' qualifier.
+// We send it a full report first. After that we send it a delta report (see the 'u' flag) whenever the model change counter changes, and at least every
+// WebSocketUpdateInterval so that it gets the live fields. Each report is a message holding the same JSON (or CBOR, if the 'b' flag was given) that rr_model returns.
+// The delta reports are generated once and sent to every client that they are valid for, so the cost of generating them doesn't grow with the number of clients.
+// We ignore messages from the client apart from ping and close frames.
+
+// Encode binary data in base 64
+static void Base64Encode(const StringRef& str, const uint8_t *_ecv_array data, size_t length) noexcept
+{
+	static const char Base64Chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	str.Clear();
+	for (size_t i = 0; i < length; i += 3)
+	{
+		const uint32_t val = ((uint32_t)data[i] << 16)
+							| ((i + 1 < length) ? (uint32_t)data[i + 1] << 8 : 0)
+							| ((i + 2 < length) ? (uint32_t)data[i + 2] : 0);
+		str.cat(Base64Chars[(val >> 18) & 0x3F]);
+		str.cat(Base64Chars[(val >> 12) & 0x3F]);
+		str.cat((i + 1 < length) ? Base64Chars[(val >> 6) & 0x3F] : '=');
+		str.cat((i + 2 < length) ? Base64Chars[val & 0x3F] : '=');
+	}
+}
+
+// Return true if the request asks to upgrade the connection to a WebSocket
+bool HttpResponder::IsWebSocketUpgrade() const noexcept
+{
+	for (size_t i = 0; i < numHeaderKeys; ++i)
+	{
+		if (StringEqualsIgnoreCase(headers[i].key, "Upgrade"))
+		{
+			return StringEqualsIgnoreCase(headers[i].value, "websocket");
+		}
+	}
+	return false;
+}
+
+// Accept a WebSocket upgrade request
+void HttpResponder::StartWebSocket() noexcept
+{
+	const char *_ecv_array key = nullptr;
+	const char *_ecv_array version = nullptr;
+	for (size_t i = 0; i < numHeaderKeys; ++i)
+	{
+		if (StringEqualsIgnoreCase(headers[i].key, "Sec-WebSocket-Key"))
+		{
+			key = headers[i].value;
+		}
+		else if (StringEqualsIgnoreCase(headers[i].key, "Sec-WebSocket-Version"))
+		{
+			version = headers[i].value;
+		}
+	}
+
+	if (key == nullptr || version == nullptr || strcmp(version, "13") != 0)
+	{
+		RejectMessage("unsupported WebSocket request", 400);
+		return;
+	}
+
+	const char *_ecv_array flags = GetKeyValue("flags");
+	if (flags == nullptr)
+	{
+		flags = DefaultWebSocketFlags;
+	}
+	if (strlen(flags) > MaxWebSocketFlagsLength || strchr(flags, 'u') != nullptr)
+	{
+		RejectMessage("unsupported flags", 400);
+		return;
+	}
+
+	// A WebSocket connection stays open, so it counts as a persistent connection
+	if (!isPersistent)
+	{
+		if (numPersistentConnections >= MaxPersistentConnections)
+		{
+			RejectMessage("too many connections", 503);
+			return;
+		}
+		isPersistent = true;
+		++numPersistentConnections;
+	}
+
+	// The accept value is the base 64 encoded SHA1 hash of the key concatenated with the WebSocket GUID
+	SHA1Context hash;
+	SHA1Reset(&hash);
+	SHA1Input(&hash, reinterpret_cast<const uint8_t *>(key), strlen(key));
+	SHA1Input(&hash, reinterpret_cast<const uint8_t *>(WebSocketGuid), strlen(WebSocketGuid));
+	SHA1Result(&hash);
+	uint8_t digest[20];
+	for (size_t i = 0; i < 5; ++i)
+	{
+		for (size_t j = 0; j < 4; ++j)
+		{
+			digest[4 * i + j] = (uint8_t)(hash.Message_Digest[i] >> (24 - 8 * j));
+		}
+	}
+	String<StringLength50> accept;
+	Base64Encode(accept.GetRef(), digest, sizeof(digest));
+
+	outBuf->printf(	"HTTP/1.1 101 Switching Protocols\r\n"
+					"Upgrade: websocket\r\n"
+					"Connection: Upgrade\r\n"
+					"Sec-WebSocket-Accept: %s\r\n", accept.c_str());
+	AddCorsHeader();
+	outBuf->cat("\r\n");
+
+	isWebSocket = true;
+	++numWebSockets;
+	webSocketFlags.copy(flags);
+	webSocketSentFull = false;
+	webSocketChanges = 0;
+	webSocketPayloadLeft = 0;
+	clientPointer = 0;
+	Commit(ResponderState::webSocket, false);
+}
+
+// Do some work on a WebSocket connection, returning true if we did anything significant
+bool HttpResponder::WebSocketSpin() noexcept
+{
+	// Process anything the client has sent us
+	bool readSomething = false;
+	const uint8_t *_ecv_array data;
+	size_t len;
+	while (skt->ReadBuffer(data, len))
+	{
+		readSomething = true;
+		for (size_t i = 0; i < len; )
+		{
+			if (WebSocketCharFromClient((char)data[i++]))
+			{
+				skt->Taken(i);
+				return true;
+			}
+		}
+		skt->Taken(len);
+	}
+
+	if (!skt->CanRead())
+	{
+		ConnectionLost();
+		return true;
+	}
+
+	if (!webSocketSentFull)
+	{
+		StartWebSocketReport();
+		return true;
+	}
+
+	const uint32_t now = millis();
+	if (now - timer >= WebSocketUpdateInterval || (reprap.GetModelChangeCounter() != webSocketChanges && now - timer >= WebSocketMinUpdateInterval))
+	{
+		// The client isn't making HTTP requests, so keep its session alive. If the session has gone then the client has disconnected.
+		if (!CheckAuthenticated())
+		{
+			CloseWebSocket(WsStatusPolicyViolation);
+		}
+		else if (!SendSharedWebSocketUpdate())
+		{
+			StartWebSocketReport();
+		}
+		return true;
+	}
+	return readSomething;
+}
+
+// Process a character received from a WebSocket client. Return true if we have committed a reply or closed the connection.
+bool HttpResponder::WebSocketCharFromClient(char c) noexcept
+{
+	if (webSocketPayloadLeft != 0)
+	{
+		// We are receiving the payload of a frame. We only need to keep the payload of a control frame, which is limited to 125 bytes.
+		if (webSocketOpcode >= WsOpcodeClose)
+		{
+			clientMessage[webSocketControlLength] = c ^ (char)webSocketMask[webSocketControlLength & 3];
+			++webSocketControlLength;
+		}
+		--webSocketPayloadLeft;
+		return webSocketPayloadLeft == 0 && WebSocketFrameReceived();
+	}
+
+	// We are receiving the frame header
+	clientMessage[clientPointer++] = c;
+	if (clientPointer < 2)
+	{
+		return false;
+	}
+
+	const uint8_t byte0 = (uint8_t)clientMessage[0];
+	const uint8_t byte1 = (uint8_t)clientMessage[1];
+	if ((byte1 & 0x80) == 0)
+	{
+		CloseWebSocket(WsStatusProtocolError);					// frames from the client must be masked
+		return true;
+	}
+
+	const size_t lengthBytes = ((byte1 & 0x7F) == 126) ? 2 : ((byte1 & 0x7F) == 127) ? 8 : 0;
+	if (clientPointer < 2 + lengthBytes + sizeof(webSocketMask))
+	{
+		return false;
+	}
+
+	uint64_t payloadLength = byte1 & 0x7F;
+	if (lengthBytes != 0)
+	{
+		payloadLength = 0;
+		for (size_t i = 0; i < lengthBytes; ++i)
+		{
+			payloadLength = (payloadLength << 8) | (uint8_t)clientMessage[2 + i];		// big-endian
+		}
+	}
+	memcpy(webSocketMask, clientMessage + 2 + lengthBytes, sizeof(webSocketMask));
+	webSocketOpcode = byte0 & 0x0F;
+	webSocketControlLength = 0;
+	clientPointer = 0;
+
+	if (webSocketOpcode >= WsOpcodeClose && (payloadLength > 125 || (byte0 & 0x80) == 0))
+	{
+		CloseWebSocket(WsStatusProtocolError);					// control frames must be short and not fragmented
+		return true;
+	}
+	if (payloadLength > UINT32_MAX)
+	{
+		CloseWebSocket(WsStatusMessageTooBig);
+		return true;
+	}
+
+	webSocketPayloadLeft = (uint32_t)payloadLength;
+	return webSocketPayloadLeft == 0 && WebSocketFrameReceived();
+}
+
+// Act on a complete frame from the client. Return true if we have committed a reply or closed the connection.
+bool HttpResponder::WebSocketFrameReceived() noexcept
+{
+	switch (webSocketOpcode)
+	{
+	case WsOpcodeClose:
+		// Echo the status code and close the connection
+		SendWebSocketControlFrame(WsOpcodeClose, clientMessage, min<size_t>(webSocketControlLength, 2), ResponderState::free);
+		return true;
+
+	case WsOpcodePing:
+		SendWebSocketControlFrame(WsOpcodePong, clientMessage, webSocketControlLength, ResponderState::webSocket);
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+void HttpResponder::SendWebSocketControlFrame(uint8_t opcode, const char *_ecv_array payload, size_t length, ResponderState nextState) noexcept
+{
+	if (outBuf == nullptr && !OutputBuffer::Allocate(outBuf, OutputBufferConsumer::http))
+	{
+		if (nextState == ResponderState::free)
+		{
+			ConnectionLost();
+		}
+		return;
+	}
+
+	AppendWebSocketFrameHeader(outBuf, opcode, true, length);
+	outBuf->cat(payload, length);
+	Commit(nextState, false);
+}
+
+void HttpResponder::CloseWebSocket(uint16_t statusCode) noexcept
+{
+	const char status[2] = { (char)(statusCode >> 8), (char)(statusCode & 0xFF) };
+	SendWebSocketControlFrame(WsOpcodeClose, status, sizeof(status), ResponderState::free);
+}
+
+// Send the most recent delta report to the client, generating a new one if necessary. Return false if we need to generate a report just for this client.
+// A delta report of what changed after the change counter had value N is valid for a client whose copy of the model reflects a later value too.
+bool HttpResponder::SendSharedWebSocketUpdate() noexcept
+{
+	const uint32_t now = millis();
+	const uint32_t changes = reprap.GetModelChangeCounter();
+	if (   webSocketUpdate == nullptr
+		|| !webSocketUpdateFlags.Equals(webSocketFlags.c_str())
+		|| webSocketChanges < webSocketUpdateBase
+		|| webSocketUpdateChanges != changes
+		|| now - webSocketUpdateTime >= WebSocketUpdateInterval/2		// the live fields in it are too old
+	   )
+	{
+		// Generate a new report. Other clients that are as up to date as this one will be able to use it too.
+		OutputBuffer::ReleaseAll(webSocketUpdate);
+		String<StringLength20> flags;
+		flags.printf("%su%" PRIu32, webSocketFlags.c_str(), webSocketChanges);
+		try
+		{
+			webSocketUpdate = reprap.GetModelResponse(nullptr, "", flags.c_str());
+		}
+		catch (const GCodeException&)
+		{
+			webSocketUpdate = nullptr;
+		}
+
+		if (webSocketUpdate == nullptr)
+		{
+			return false;
+		}
+		webSocketUpdateFlags.copy(webSocketFlags.c_str());
+		webSocketUpdateBase = webSocketChanges;
+		webSocketUpdateChanges = changes;
+		webSocketUpdateTime = now;
+		++webSocketUpdatesGenerated;
+	}
+
+	// Send the frame header followed by the shared report
+	OutputBuffer *buf;
+	if (!OutputBuffer::Allocate(buf, OutputBufferConsumer::http))
+	{
+		return true;												// try again later
 	}
+	AppendWebSocketFrameHeader(buf, (strchr(webSocketFlags.c_str(), 'b') != nullptr) ? WsOpcodeBinary : WsOpcodeText, true, webSocketUpdate->Length());
+	webSocketUpdate->IncreaseReferences(1);
+	if (!outStack.Push(webSocketUpdate))							// if this fails then it releases the reference we added
+	{
+		OutputBuffer::ReleaseAll(buf);
+		return false;
+	}
+
+	outBuf = buf;
+	webSocketChanges = webSocketUpdateChanges;
+	timer = now;
+	++webSocketUpdatesSent;
+	Commit(ResponderState::webSocket, false);
+	return true;
 }
 
+// Start sending a report that we generate just for this client, one branch at a time. Each branch is sent as one fragment of the message.
+// We send a full report if the client hasn't had one yet, otherwise a delta report of what changed since the client's copy.
+void HttpResponder::StartWebSocketReport() noexcept
+{
+	OutputBuffer *buf;
+	if (!OutputBuffer::Allocate(buf, OutputBufferConsumer::http))
+	{
+		return;														// try again later
+	}
+
+	const uint32_t changes = reprap.GetModelChangeCounter();
+	if (webSocketSentFull)
+	{
+		modelStreamFlags.printf("%su%" PRIu32, webSocketFlags.c_str(), webSocketChanges);
+	}
+	else
+	{
+		modelStreamFlags.copy(webSocketFlags.c_str());
+	}
+	reprap.StartModelResponse(buf, "", modelStreamFlags.c_str());
+	if (!FrameWebSocketMessage(buf, (strchr(webSocketFlags.c_str(), 'b') != nullptr) ? WsOpcodeBinary : WsOpcodeText, false))
+	{
+		OutputBuffer::ReleaseAll(buf);
+		return;
+	}
+
+	outBuf = buf;
+	modelStreamIndex = 0;
+	modelStreamFirst = true;
+	streamingModel = true;
+	modelStreamLastProgressTime = timer = millis();
+	webSocketChanges = changes;
+	webSocketSentFull = true;
+	Commit(ResponderState::webSocket, false);
+}
+
+void HttpResponder::EndWebSocket() noexcept
+{
+	if (isWebSocket)
+	{
+		isWebSocket = false;
+		--numWebSockets;
+		if (numWebSockets == 0)
+		{
+			OutputBuffer::ReleaseAll(webSocketUpdate);
+		}
+	}
+}
+
+// Put a WebSocket frame header in front of the data in a buffer chain. Return false if there was no buffer available, in which case the chain is unchanged.
+/*static*/ bool HttpResponder::FrameWebSocketMessage(OutputBuffer *&buf, uint8_t opcode, bool fin) noexcept
+{
+	OutputBuffer *header;
+	if (!OutputBuffer::Allocate(header, OutputBufferConsumer::http))
+	{
+		return false;
+	}
+	AppendWebSocketFrameHeader(header, opcode, fin, buf->Length());
+	header->Append(buf);
+	buf = header;
+	return true;
+}
+
+// Append the header of an unmasked frame, which is what a server sends
+/*static*/ void HttpResponder::AppendWebSocketFrameHeader(OutputBuffer *buf, uint8_t opcode, bool fin, size_t payloadLength) noexcept
+{
+	char header[10];
+	size_t headerLength;
+	header[0] = (char)(((fin) ? 0x80 : 0) | opcode);
+	if (payloadLength < 126)
+	{
+		header[1] = (char)payloadLength;
+		headerLength = 2;
+	}
+	else if (payloadLength <= 0xFFFF)
+	{
+		header[1] = 126;
+		header[2] = (char)(payloadLength >> 8);
+		header[3] = (char)payloadLength;
+		headerLength = 4;
+	}
+	else
+	{
+		header[1] = 127;
+		for (size_t i = 0; i < 8; ++i)
+		{
+			header[9 - i] = (char)((uint64_t)payloadLength >> (8 * i));		// big-endian
+		}
+		headerLength = 10;
+	}
+	buf->cat(header, headerLength);
+}
+
+#endif
+
 void HttpResponder::Diagnostics(MessageType mt) const noexcept
 {
+#if HAS_MASS_STORAGE
+	if (responderState == ResponderState::uploading)
+	{
+		GetPlatform().MessageF(mt, " HTTP(%d, %.1fKb/s)", (int)responderState, (double)GetUploadRate());
+		return;
+	}
+#endif
 	GetPlatform().MessageF(mt, " HTTP(%d)", (int)responderState);
 }
 
@@ -1411,9 +2509,11 @@ void HttpResponder::Diagnostics(MessageType mt) const noexcept
 {
 	MutexLocker lock(gcodeReplyMutex);
 
-	clientsServed = 0;
 	numSessions = 0;
-	gcodeReply.ReleaseAll();
+	while (numGCodeReplies != 0)
+	{
+		ReleaseOldestGCodeReply();
+	}
 }
 
 // This is called from the GCodes task to store a response, which is picked up by the Network task
@@ -1423,24 +2523,26 @@ void HttpResponder::Diagnostics(MessageType mt) const noexcept
 	{
 		MutexLocker lock(gcodeReplyMutex);
 
-		OutputBuffer *buffer = gcodeReply.GetLastItem();
-		if (buffer == nullptr || buffer->IsReferenced())
+		// We can add to the newest reply if no client has been sent it yet
+		if (numGCodeReplies != 0)
 		{
-			if (!OutputBuffer::Allocate(buffer))
+			GCodeReply& lastReply = gcodeReplies[(firstGCodeReply + numGCodeReplies - 1) % MaxGCodeReplies];
+			if (!lastReply.buf->IsReferenced())
 			{
-				// No more space available, stop here
-				return;
-			}
-			if (!gcodeReply.Push(buffer))
-			{
-				// Can't push, so buffer was discarded. Don't append to it.
+				lastReply.buf->cat(reply);
+				lastReply.seq = ++seq;
 				return;
 			}
 		}
 
+		OutputBuffer *buffer;
+		if (!OutputBuffer::Allocate(buffer, OutputBufferConsumer::http))
+		{
+			// No more space available, stop here
+			return;
+		}
 		buffer->cat(reply);
-		clientsServed = 0;
-		seq++;
+		AddGCodeReply(buffer);
 	}
 }
 
@@ -1450,13 +2552,8 @@ void HttpResponder::Diagnostics(MessageType mt) const noexcept
 	{
 		if (numSessions > 0)
 		{
-			// FIXME: This might cause G-code responses to be sent twice to fast HTTP clients, but
-			// I (chrishamm) cannot think of a nicer way to deal with slow clients at the moment...
 			MutexLocker lock(gcodeReplyMutex);
-
-			gcodeReply.Push(reply);
-			clientsServed = 0;
-			seq++;
+			AddGCodeReply(reply);
 		}
 		else
 		{
@@ -1466,52 +2563,72 @@ void HttpResponder::Diagnostics(MessageType mt) const noexcept
 	}
 }
 
+// Add a reply to the ring, discarding the oldest one if the ring is full. The caller must own gcodeReplyMutex.
+/*static*/ void HttpResponder::AddGCodeReply(OutputBuffer *buf) noexcept
+{
+	if (numGCodeReplies == MaxGCodeReplies)
+	{
+		ReleaseOldestGCodeReply();
+	}
+	GCodeReply& newReply = gcodeReplies[(firstGCodeReply + numGCodeReplies) % MaxGCodeReplies];
+	newReply.buf = buf;
+	newReply.seq = ++seq;
+	++numGCodeReplies;
+}
+
+// Discard the oldest reply. The caller must own gcodeReplyMutex and there must be at least one reply.
+/*static*/ void HttpResponder::ReleaseOldestGCodeReply() noexcept
+{
+	OutputBuffer::ReleaseAll(gcodeReplies[firstGCodeReply].buf);
+	firstGCodeReply = (firstGCodeReply + 1) % MaxGCodeReplies;
+	--numGCodeReplies;
+}
+
+// Discard the replies that every client has been sent. The caller must own gcodeReplyMutex.
+/*static*/ void HttpResponder::ReleaseServedGCodeReplies() noexcept
+{
+	while (numGCodeReplies != 0)
+	{
+		const uint16_t oldestSeq = gcodeReplies[firstGCodeReply].seq;
+		for (size_t i = 0; i < numSessions; ++i)
+		{
+			if ((int16_t)(oldestSeq - sessions[i].replySeq) > 0)
+			{
+				return;
+			}
+		}
+		ReleaseOldestGCodeReply();
+	}
+}
+
 // Check for timed out sessions and old reply buffers
 /*static*/ void HttpResponder::CheckSessions() noexcept
 {
-	unsigned int clientsTimedOut = 0;
+#if SUPPORT_MODEL_RESPONSE_CACHE
+	ModelResponseCache::Expire();						// free the buffers used by object model responses that are too old to share
+#endif
+
 	const uint32_t now = millis();
 	for (size_t i = numSessions; i != 0; )
 	{
 		--i;
 		if (now - sessions[i].lastQueryTime > HttpSessionTimeout)
 		{
-			RemoveSession(i);
-			clientsTimedOut++;
+			RemoveSession(i);						// this releases any replies that only the timed out session was waiting for
 		}
 	}
 
-	// If we cannot send the G-Code reply to anyone, we may free up some run-time space by dumping it
-	if (clientsTimedOut != 0)
+	// Discard replies that are too old, because a client that hasn't fetched them by now probably isn't going to
+	if (numGCodeReplies != 0)
 	{
 		bool released = false;
 		{
 			MutexLocker lock(gcodeReplyMutex);
-
-			clientsServed += clientsTimedOut;			// assume the disconnected clients haven't fetched the G-Code reply yet
-			if (numSessions == 0 || clientsServed >= numSessions)
+			while (numGCodeReplies != 0 && now - gcodeReplies[firstGCodeReply].buf->WhenQueued() >= HttpSessionTimeout)
 			{
-				while (!gcodeReply.IsEmpty())
-				{
-					OutputBuffer *buf = gcodeReply.Pop();
-					OutputBuffer::ReleaseAll(buf);
-				}
+				ReleaseOldestGCodeReply();
 				released = true;
 			}
-			clientsServed = 0;
-		}
-		if (released && reprap.Debug(moduleWebserver))
-		{
-			debugPrintf("Released gcodeReply, free buffers=%u\n", OutputBuffer::GetFreeBuffers());
-		}
-	}
-	else if (!gcodeReply.IsEmpty())
-	{
-		// Check whether we can time out any GCode buffers
-		bool released;
-		{
-			MutexLocker lock(gcodeReplyMutex);
-			released = gcodeReply.ApplyTimeout(HttpSessionTimeout);
 		}
 		if (released && reprap.Debug(moduleWebserver))
 		{
@@ -1523,6 +2640,16 @@ void HttpResponder::Diagnostics(MessageType mt) const noexcept
 /*static*/ void HttpResponder::CommonDiagnostics(MessageType mtype) noexcept
 {
 	GetPlatform().MessageF(mtype, "HTTP sessions: %u of %u\n", numSessions, MaxHttpSessions);
+#if SUPPORT_WEB_FILE_CACHE
+	WebFileCache::Diagnostics(mtype);
+#endif
+#if SUPPORT_MODEL_RESPONSE_CACHE
+	ModelResponseCache::Diagnostics(mtype);
+#endif
+#if SUPPORT_WEBSOCKETS
+	GetPlatform().MessageF(mtype, "WebSockets: %u, updates generated %u, sent %u\n", numWebSockets, webSocketUpdatesGenerated, webSocketUpdatesSent);
+	webSocketUpdatesGenerated = webSocketUpdatesSent = 0;
+#endif
 }
 
 void HttpResponder::AddCorsHeader() noexcept
@@ -1537,10 +2664,23 @@ void HttpResponder::AddCorsHeader() noexcept
 
 HttpResponder::HttpSession HttpResponder::sessions[MaxHttpSessions];
 unsigned int HttpResponder::numSessions = 0;
-unsigned int HttpResponder::clientsServed = 0;
+unsigned int HttpResponder::numPersistentConnections = 0;
+
+#if SUPPORT_WEBSOCKETS
+OutputBuffer *HttpResponder::webSocketUpdate = nullptr;
+String<StringLength20> HttpResponder::webSocketUpdateFlags;
+uint32_t HttpResponder::webSocketUpdateBase = 0;
+uint32_t HttpResponder::webSocketUpdateChanges = 0;
+uint32_t HttpResponder::webSocketUpdateTime = 0;
+unsigned int HttpResponder::numWebSockets = 0;
+unsigned int HttpResponder::webSocketUpdatesGenerated = 0;
+unsigned int HttpResponder::webSocketUpdatesSent = 0;
+#endif
 
 volatile uint16_t HttpResponder::seq = 0;
-volatile OutputStack HttpResponder::gcodeReply;
+HttpResponder::GCodeReply HttpResponder::gcodeReplies[MaxGCodeReplies];
+size_t HttpResponder::firstGCodeReply = 0;
+size_t HttpResponder::numGCodeReplies = 0;
 Mutex HttpResponder::gcodeReplyMutex;
 
 #endif // SUPPORT_HTTP
@@ -30,6 +30,7 @@ public:
 protected:
 	void CancelUpload() noexcept override;
 	void SendData() noexcept override;
+	void ConnectionLost() noexcept override;
 
 private:
 #ifdef __LPC17xx__
@@ -74,22 +75,67 @@ private:
 		uint32_t lastQueryTime;
 		bool isPostUploading;
 		uint16_t postPort;
+		uint16_t replySeq;							// the sequence number of the last G-code reply that this client has been sent
+	};
+
+	// G-code replies waiting to be fetched. Each reply is stored once however many clients there are, and each session records how far it has read.
+	static constexpr size_t MaxGCodeReplies = OUTPUT_STACK_DEPTH;	// we send all the outstanding replies in one response, so they must fit in the output stack
+	struct GCodeReply
+	{
+		OutputBuffer *buf;
+		uint16_t seq;								// the value of 'seq' when this reply was last added to
 	};
 
 	bool Authenticate() noexcept;
 	bool CheckAuthenticated() noexcept;
 	bool RemoveAuthentication() noexcept;
 
+	void ResetParser() noexcept;
+	size_t CopyPlainChars(const uint8_t *_ecv_array data, size_t len) noexcept;
 	bool CharFromClient(char c) noexcept;
+	bool KeepConnectionOpen() noexcept;
+	void EndPersistence() noexcept;
 	void SendFile(const char *_ecv_array nameOfFileToSend, bool isWebFile) noexcept;
+#if HAS_MASS_STORAGE
+	void AppendValidators(FilePosition fileLength, time_t lastModified) noexcept;
+	bool ClientHasCurrentCopy(FilePosition fileLength, time_t lastModified) const noexcept;
+	void SendNotModified(FilePosition fileLength, time_t lastModified) noexcept;
+	static void MakeETag(const StringRef& etag, FilePosition fileLength, time_t lastModified) noexcept;
+	static void MakeHttpDate(const StringRef& date, time_t t) noexcept;
+#endif
 	void SendGCodeReply() noexcept;
 	void SendJsonResponse(const char *_ecv_array command) noexcept;
+#if SUPPORT_METRICS
+	void SendMetrics() noexcept;
+#endif
 	bool GetJsonResponse(const char *_ecv_array request, OutputBuffer *&response, bool& keepOpen) noexcept;
 	void ProcessMessage() noexcept;
 	void ProcessRequest() noexcept;
 	void RejectMessage(const char *_ecv_array s, unsigned int code = 500) noexcept;
 	bool SendFileInfo(bool quitEarly) noexcept;
 	void AddCorsHeader() noexcept;
+#if SUPPORT_OBJECT_MODEL
+	bool StreamNextModelBranch() noexcept;
+#endif
+#if HAS_MASS_STORAGE
+	bool StartThumbnailStream(const char *_ecv_array filename, FilePosition offset, OutputBuffer *response) noexcept;
+	bool StreamNextThumbnailChunk() noexcept;
+	void StopThumbnailStream() noexcept;
+#endif
+#if SUPPORT_WEBSOCKETS
+	bool IsWebSocketUpgrade() const noexcept;
+	void StartWebSocket() noexcept;
+	bool WebSocketSpin() noexcept;
+	bool WebSocketCharFromClient(char c) noexcept;
+	bool WebSocketFrameReceived() noexcept;
+	void SendWebSocketControlFrame(uint8_t opcode, const char *_ecv_array payload, size_t length, ResponderState nextState) noexcept;
+	void CloseWebSocket(uint16_t statusCode) noexcept;
+	bool SendSharedWebSocketUpdate() noexcept;
+	void StartWebSocketReport() noexcept;
+	void EndWebSocket() noexcept;
+	static void AppendWebSocketFrameHeader(OutputBuffer *buf, uint8_t opcode, bool fin, size_t payloadLength) noexcept;
+	static bool FrameWebSocketMessage(OutputBuffer *&buf, uint8_t opcode, bool fin) noexcept;
+#endif
 
 #if HAS_MASS_STORAGE
 	void DoUpload() noexcept;
@@ -98,6 +144,9 @@ private:
 	const char* GetKeyValue(const char *_ecv_array key) const noexcept;	// return the value of the specified key, or nullptr if not present
 
 	static void RemoveSession(size_t sessionToRemove) noexcept;
+	static void AddGCodeReply(OutputBuffer *buf) noexcept;
+	static void ReleaseServedGCodeReplies() noexcept;
+	static void ReleaseOldestGCodeReply() noexcept;
 
 	HttpParseState parseState;
 
@@ -122,15 +171,59 @@ private:
 	uint32_t postFileExpectedCrc;
 	time_t fileLastModified;
 	bool postFileGotCrc;
+	bool isPersistent;								// true if we are keeping the connection open after sending the response
+
+#if SUPPORT_OBJECT_MODEL
+	// rr_model requests for the whole object model are generated one top-level branch at a time as the socket accepts the data
+	String<StringLength20> modelStreamFlags;
+	size_t modelStreamIndex;						// the index of the next top-level branch to report
+	uint32_t modelStreamLastProgressTime;
+	bool modelStreamFirst;							// true if we haven't reported any branches yet
+	bool streamingModel;
+	bool binaryModelResponse;						// true if the response is an object model report in CBOR format
+#endif
+
+#if HAS_MASS_STORAGE
+	// rr_thumbnail requests with raw=1 get the whole thumbnail in binary in one response, decoded a chunk at a time as the socket accepts the data
+	FileStore *thumbnailFile;
+	FilePosition thumbnailOffset;					// the file position of the next thumbnail data to send
+	uint32_t thumbnailStreamLastProgressTime;
+	bool streamingThumbnail;
+#endif
+
+#if SUPPORT_WEBSOCKETS
+	// Object model subscriptions over a WebSocket
+	String<StringLength20> webSocketFlags;			// the report flags that the client asked for
+	uint32_t webSocketChanges;						// the value of the model change counter that the client's copy of the model reflects
+	uint32_t webSocketPayloadLeft;					// how many bytes of the payload of the current incoming frame we have still to read
+	uint8_t webSocketMask[4];						// the masking key of the current incoming frame
+	uint8_t webSocketOpcode;						// the opcode of the current incoming frame
+	uint8_t webSocketControlLength;					// how many bytes of the payload of an incoming control frame we have stored
+	bool isWebSocket;								// true if this connection has been upgraded to a WebSocket
+	bool webSocketSentFull;							// true if we have sent the client a full report, so that we can send it delta reports
+#endif
 
 	// Keeping track of HTTP sessions
 	static HttpSession sessions[MaxHttpSessions];
 	static unsigned int numSessions;
-	static unsigned int clientsServed;
+	static unsigned int numPersistentConnections;
+
+#if SUPPORT_WEBSOCKETS
+	// The most recent delta report, which we send to every WebSocket client that it is valid for so that we don't have to generate one for each client
+	static OutputBuffer *webSocketUpdate;
+	static String<StringLength20> webSocketUpdateFlags;
+	static uint32_t webSocketUpdateBase;			// the report includes everything that changed after the model change counter had this value
+	static uint32_t webSocketUpdateChanges;			// the value of the model change counter when we generated the report
+	static uint32_t webSocketUpdateTime;
+	static unsigned int numWebSockets;
+	static unsigned int webSocketUpdatesGenerated, webSocketUpdatesSent;
+#endif
 
 	// Responses from GCodes class
 	static volatile uint16_t seq;					// Sequence number for G-Code replies
-	static volatile OutputStack gcodeReply;
+	static GCodeReply gcodeReplies[MaxGCodeReplies];	// ring of replies, oldest first starting at firstGCodeReply
+	static size_t firstGCodeReply;
+	static size_t numGCodeReplies;
 	static Mutex gcodeReplyMutex;
 };
 
@@ -87,12 +87,31 @@
 /* Uncomment following line to use DHCP instead of fixed IP */
 #define DHCP_USED
 
+/*
+ * LWIP_HIGH_THROUGHPUT: use larger TCP windows and more heap so that file downloads are not limited by the send buffer,
+ * and let the GMAC generate the checksums of outgoing packets. This is the default on the SAME70, which has enough RAM for it.
+ * Define it as 0 or 1 on the compiler command line to override the default.
+ */
+#ifndef LWIP_HIGH_THROUGHPUT
+# if defined(__SAME70Q20B__) || defined(__SAME70Q21B__) || defined(__SAMV71Q20B__) || defined(__SAMV71Q21B__)
+#  define LWIP_HIGH_THROUGHPUT		1
+# else
+#  define LWIP_HIGH_THROUGHPUT		0
+# endif
+#endif
+
 #define LWIP_CHKSUM_ALGORITHM		3		// use fastest checksum algorithm (does 8 bytes at a time)
 
 #define CHECKSUM_CHECK_IP			0		// use hardware checking of incoming IP checksums
 #define CHECKSUM_CHECK_UDP			0		// use hardware checking of incoming UDP checksums
 #define CHECKSUM_CHECK_TCP			0		// use hardware checking of incoming TCP checksums
 
+#if LWIP_HIGH_THROUGHPUT
+# define CHECKSUM_GEN_IP			0		// the GMAC generates the checksums of outgoing IP, UDP and TCP packets
+# define CHECKSUM_GEN_UDP			0
+# define CHECKSUM_GEN_TCP			0
+#endif
+
 #define LWIP_DONT_PROVIDE_BYTEORDER_FUNCTIONS	1
 #define lwip_htons(_x)			__builtin_bswap16(_x)
 #define lwip_htonl(_x)			__builtin_bswap32(_x)
@@ -115,7 +134,11 @@
  * MEM_SIZE: the size of the heap memory. If the application will send
  * a lot of data that needs to be copied, this should be set high.
  */
-#define MEM_SIZE                		12288		// 8192 works too but then lwip reports mem errors. sadly "max" isn't working
+#if LWIP_HIGH_THROUGHPUT
+# define MEM_SIZE						32768		// outgoing TCP data is copied into the heap, so this must hold TCP_SND_BUF bytes for each active connection
+#else
+# define MEM_SIZE                		12288		// 8192 works too but then lwip reports mem errors. sadly "max" isn't working
+#endif
 
 /**
  * MEMP_NUM_UDP_PCB: the number of UDP protocol control blocks. One
@@ -148,7 +171,9 @@
  * MEMP_NUM_TCP_SEG: the number of simultaneously queued TCP segments.
  * (requires the LWIP_TCP option)
  */
-#if defined(__SAME70Q20B__) || defined(__SAME70Q21B__) || defined(__SAMV71Q20B__) || defined(__SAMV71Q21B__)
+#if LWIP_HIGH_THROUGHPUT
+# define MEMP_NUM_TCP_SEG				24			// must be at least TCP_SND_QUEUELEN
+#elif defined(__SAME70Q20B__) || defined(__SAME70Q21B__) || defined(__SAMV71Q20B__) || defined(__SAMV71Q21B__)
 # define MEMP_NUM_TCP_SEG				10
 #else
 # define MEMP_NUM_TCP_SEG				8
@@ -262,13 +287,21 @@ extern uint32_t random32(void) noexcept;
  * TCP_WND: The size of a TCP window.  This must be at least
  * (2 * TCP_MSS) for things to work well
  */
-#define TCP_WND                 (4 * TCP_MSS)
+#if LWIP_HIGH_THROUGHPUT
+# define TCP_WND				(8 * TCP_MSS)
+#else
+# define TCP_WND                 (4 * TCP_MSS)
+#endif
 
 /**
  * TCP_SND_BUF: TCP sender buffer space (bytes).
  * To achieve good performance, this should be at least 2 * TCP_MSS.
  */
-#define TCP_SND_BUF             (2 * TCP_MSS)
+#if LWIP_HIGH_THROUGHPUT
+# define TCP_SND_BUF			(4 * TCP_MSS)
+#else
+# define TCP_SND_BUF             (2 * TCP_MSS)
+#endif
 
 /**
  * TCP_SND_QUEUELEN: TCP sender buffer space (pbufs). This must be at least
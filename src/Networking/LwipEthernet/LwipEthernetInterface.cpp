@@ -126,6 +126,8 @@ constexpr ObjectModelTableEntry LwipEthernetInterface::objectModelTable[] =
 {
 	// These entries must be in alphabetical order
 	{ "actualIP",			OBJECT_MODEL_FUNC(self->ipAddress),			ObjectModelEntryFlags::none },
+	{ "bytesReceived",		OBJECT_MODEL_FUNC(self->GetBytesReceived()),	ObjectModelEntryFlags::live },
+	{ "bytesSent",			OBJECT_MODEL_FUNC(self->GetBytesSent()),		ObjectModelEntryFlags::live },
 	{ "gateway",			OBJECT_MODEL_FUNC(self->gateway),			ObjectModelEntryFlags::none },
 	{ "mac",				OBJECT_MODEL_FUNC(self->macAddress),		ObjectModelEntryFlags::none },
 	{ "state",				OBJECT_MODEL_FUNC(self->GetStateName()),	ObjectModelEntryFlags::none },
@@ -133,7 +135,7 @@ constexpr ObjectModelTableEntry LwipEthernetInterface::objectModelTable[] =
 	{ "type",				OBJECT_MODEL_FUNC_NOSELF("ethernet"),		ObjectModelEntryFlags::verbose },
 };
 
-constexpr uint8_t LwipEthernetInterface::objectModelTableDescriptor[] = { 1, 6 };
+constexpr uint8_t LwipEthernetInterface::objectModelTableDescriptor[] = { 1, 8 };
 
 DEFINE_GET_OBJECT_MODEL_TABLE(LwipEthernetInterface)
 
@@ -112,6 +112,7 @@ void LwipSocket::DataReceived(pbuf *data) noexcept
 	if (state != SocketState::closing)
 	{
 		// Store it for the NetworkResponder
+		interface->RecordBytesReceived(data->tot_len);
 		pbuf *const rdata = receivedData;
 		if (rdata == nullptr)
 		{
@@ -500,6 +501,7 @@ size_t LwipSocket::Send(const uint8_t *data, size_t length) noexcept
 		// We could successfully send some data
 		whenWritten = millis();
 		unAcked += bytesToSend;
+		interface->RecordBytesSent(bytesToSend);
 
 		return bytesToSend;
 	}
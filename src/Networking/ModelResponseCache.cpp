@@ -0,0 +1,104 @@
+/*
+ * ModelResponseCache.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "ModelResponseCache.h"
+
+#if SUPPORT_MODEL_RESPONSE_CACHE
+
+#include <Platform/RepRap.h>
+#include <Platform/Platform.h>
+
+// All the functions in this namespace are called only by the Network task, so no locking is needed
+namespace ModelResponseCache
+{
+	struct Entry
+	{
+		String<StringLength50> key;
+		String<StringLength20> flags;
+		OutputBuffer *null response = nullptr;			// we own one reference to this
+		uint32_t changes;								// the value of the model change counter when we generated the response
+		uint32_t whenGenerated;
+	};
+
+	static Entry entries[ModelResponseCacheEntries];
+	static unsigned int numHits = 0, numMisses = 0;
+
+	static bool IsCurrent(const Entry& e, uint32_t changes, uint32_t now) noexcept
+	{
+		return e.response != nullptr && e.changes == changes && now - e.whenGenerated < ModelResponseCacheLifetime;
+	}
+
+	// Return a response to an object model request, reusing a recent one if possible. The caller owns one reference to the response, so it must release it.
+	OutputBuffer *null GetResponse(const char *_ecv_array null key, const char *_ecv_array null flags) THROWS(GCodeException)
+	{
+		if (key == nullptr) { key = ""; }
+		if (flags == nullptr) { flags = ""; }
+
+		const uint32_t now = millis();
+		const uint32_t changes = reprap.GetModelChangeCounter();
+		Entry *oldest = &entries[0];
+		for (Entry& e : entries)
+		{
+			if (IsCurrent(e, changes, now))
+			{
+				if (e.key.Equals(key) && e.flags.Equals(flags))
+				{
+					++numHits;
+					e.response->IncreaseReferences(1);
+					return e.response;
+				}
+			}
+			else
+			{
+				OutputBuffer::ReleaseAll(e.response);	// free the buffers as soon as we can
+			}
+
+			if (e.response == nullptr || (oldest->response != nullptr && (int32_t)(e.whenGenerated - oldest->whenGenerated) < 0))
+			{
+				oldest = &e;
+			}
+		}
+
+		++numMisses;
+		OutputBuffer *const response = reprap.GetModelResponse(nullptr, key, flags);
+		if (response != nullptr && strlen(key) <= oldest->key.Capacity() && strlen(flags) <= oldest->flags.Capacity())
+		{
+			OutputBuffer::ReleaseAll(oldest->response);
+			oldest->key.copy(key);
+			oldest->flags.copy(flags);
+			oldest->changes = changes;					// we read this before generating the response, so if the model changed meanwhile we won't reuse it
+			oldest->whenGenerated = now;
+			response->IncreaseReferences(1);
+			oldest->response = response;
+		}
+		return response;
+	}
+
+	// Release the buffers used by responses that are too old to be reused. Called periodically.
+	void Expire() noexcept
+	{
+		const uint32_t now = millis();
+		const uint32_t changes = reprap.GetModelChangeCounter();
+		for (Entry& e : entries)
+		{
+			if (!IsCurrent(e, changes, now))
+			{
+				OutputBuffer::ReleaseAll(e.response);
+			}
+		}
+	}
+
+	void Diagnostics(MessageType mtype) noexcept
+	{
+		reprap.GetPlatform().MessageF(mtype, "Model response cache: hits %u, misses %u\n", numHits, numMisses);
+		numHits = numMisses = 0;
+	}
+}
+
+#endif
+
+// End
@@ -0,0 +1,28 @@
+/*
+ * ModelResponseCache.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  This holds recent object model responses for HTTP clients, so that when several clients ask for the same key with the same flags at about the same time
+ *  we generate the response once and send the same output buffers to all of them. A response is reused only if the model change counter hasn't changed since
+ *  we generated it and it is less than ModelResponseCacheLifetime old, so that the live fields in it are still current.
+ */
+
+#ifndef SRC_NETWORKING_MODELRESPONSECACHE_H_
+#define SRC_NETWORKING_MODELRESPONSECACHE_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_MODEL_RESPONSE_CACHE
+
+namespace ModelResponseCache
+{
+	OutputBuffer *null GetResponse(const char *_ecv_array null key, const char *_ecv_array null flags) THROWS(GCodeException);	// the caller owns one reference to the response
+	void Expire() noexcept;
+	void Diagnostics(MessageType mtype) noexcept;
+}
+
+#endif
+
+#endif /* SRC_NETWORKING_MODELRESPONSECACHE_H_ */
@@ -34,6 +34,7 @@ static volatile uint16_t receivedPort;
 static uint16_t lastMessageReceivedPort;
 static unsigned int messagesProcessed = 0;
 static unsigned int responsesSent = 0;
+static unsigned int queriesSuppressed = 0;
 static FGMCProtocol *fgmcHandler = nullptr;
 static uint32_t ticksToReboot = 0;
 static uint32_t whenRebootScheduled;
@@ -55,6 +56,55 @@ extern "C" void rcvFunc(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip
 	}
 }
 
+// Table of the sources that we have recently answered a broadcast discovery query from, so that a tool that repeats its query quickly doesn't make us repeat the reply
+constexpr size_t NumRecentQuerySources = 8;
+constexpr uint32_t MinQueryResponseInterval = 1000;				// minimum interval in milliseconds between replies to discovery queries from the same source
+
+struct RecentQuerySource
+{
+	uint32_t ipAddress;
+	uint32_t whenAnswered;
+};
+
+static RecentQuerySource recentQuerySources[NumRecentQuerySources] = { 0 };
+
+// Return true if the message is a broadcast discovery query from a source that we answered very recently.
+// If it isn't, record that we are about to answer the source, replacing the entry that was answered longest ago.
+static bool SuppressQuery(const uint8_t *data, size_t length, uint32_t sourceIpAddress) noexcept
+{
+	if (length < sizeof(FGMC_GenericHeader))
+	{
+		return false;
+	}
+	const FGMC_GenericHeader* const pHeader = reinterpret_cast<const FGMC_GenericHeader*>(data);
+	if (pHeader->fgmc_command_ != FGMCCommand::MCD_COMMAND_UNETINF || pHeader->fgmc_destination_id_[0] != '\0')
+	{
+		return false;
+	}
+
+	const uint32_t now = millis();
+	RecentQuerySource *oldest = &recentQuerySources[0];
+	for (RecentQuerySource& src : recentQuerySources)
+	{
+		if (src.ipAddress == sourceIpAddress)
+		{
+			if (now - src.whenAnswered < MinQueryResponseInterval)
+			{
+				return true;
+			}
+			oldest = &src;
+			break;
+		}
+		if (now - src.whenAnswered > now - oldest->whenAnswered)
+		{
+			oldest = &src;
+		}
+	}
+	oldest->ipAddress = sourceIpAddress;
+	oldest->whenAnswered = now;
+	return false;
+}
+
 void MulticastResponder::Init() noexcept
 {
 	// Nothing needed here yet
@@ -90,7 +140,14 @@ void MulticastResponder::Spin() noexcept
 			receivedPbuf = nullptr;
 			pbufToFree = rxPbuf;
 
-			fgmcHandler->handleStream(0, (const uint8_t *)rxPbuf->payload, rxPbuf->len);
+			if (SuppressQuery((const uint8_t *)rxPbuf->payload, rxPbuf->len, receivedIpAddr))
+			{
+				++queriesSuppressed;
+			}
+			else
+			{
+				fgmcHandler->handleStream(0, (const uint8_t *)rxPbuf->payload, rxPbuf->len);
+			}
 			++messagesProcessed;
 
 			// If processing the message didn't free the pbuf, free it now
@@ -106,8 +163,8 @@ void MulticastResponder::Spin() noexcept
 
 void MulticastResponder::Diagnostics(MessageType mtype) noexcept
 {
-	reprap.GetPlatform().MessageF(mtype, "=== Multicast handler ===\nResponder is %s, messages received %u, responses %u\n",
-									(active) ? "active" : "inactive", messagesProcessed, responsesSent);
+	reprap.GetPlatform().MessageF(mtype, "=== Multicast handler ===\nResponder is %s, messages received %u, responses %u, repeated queries ignored %u\n",
+									(active) ? "active" : "inactive", messagesProcessed, responsesSent, queriesSuppressed);
 }
 
 void MulticastResponder::Start(TcpPort port) noexcept
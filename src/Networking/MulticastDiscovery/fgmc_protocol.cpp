@@ -22,6 +22,7 @@ FGMCProtocol::FGMCProtocol() noexcept
     : iface_id_(0),
       fgmc_device_id_(FGMCHwTypeId::FGMC_DEVICE_ID_ZERO),
       fgmc_application_type_(0),
+      unetinfCacheValid_(false),
       tx_netbuf_{0}
 {
 }
@@ -161,9 +162,62 @@ void FGMCProtocol::sendGenericHeader(uint8_t* tx_netbuf, FGMCCommand cmd, uint32
 	MulticastResponder::SendResponse(tx_netbuf, length);
 }
 
+// Return true if the cached upload network information response still matches the network settings and the machine name
+bool FGMCProtocol::isUnetinfCacheValid() const noexcept
+{
+	if (!unetinfCacheValid_)
+	{
+		return false;
+	}
+
+	const FGMC_ResUploadNetInfoHeader* const pCache = reinterpret_cast<const FGMC_ResUploadNetInfoHeader*>(unetinfCache_);
+	const InterfaceData& ifData = ifaceData[iface_id_];
+	const uint32_t values[] =
+	{
+		ifData.configuredIpAddress.GetV4LittleEndian(),
+		ifData.configuredNetmask.GetV4LittleEndian(),
+		ifData.configuredGateway.GetV4LittleEndian(),
+		reprap.GetNetwork().GetIPAddress(iface_id_).GetV4LittleEndian(),
+		reprap.GetNetwork().GetNetmask(iface_id_).GetV4LittleEndian(),
+		reprap.GetNetwork().GetGateway(iface_id_).GetV4LittleEndian()
+	};
+	const uint8_t* const cachedValues[] =
+	{
+		pCache->fgmc_ip_v4_static_address_, pCache->fgmc_ip_v4_static_netmask_, pCache->fgmc_ip_v4_static_gateway_,
+		pCache->fgmc_ip_v4_address_, pCache->fgmc_ip_v4_netmask_, pCache->fgmc_ip_v4_gateway_
+	};
+	for (size_t i = 0; i < ARRAY_SIZE(values); ++i)
+	{
+		if (memcmp(cachedValues[i], &values[i], SIZE_IP_V4) != 0)
+		{
+			return false;
+		}
+	}
+
+	return pCache->fgmc_ip_address_type_ == ((reprap.GetNetwork().UsingDhcp(iface_id_)) ? 1u : 0u)
+		&& strncmp(pCache->fgmc_device_name_, reprap.GetName(), ARRAY_SIZE(pCache->fgmc_device_name_)) == 0;
+}
+
+// Upload network information is requested by every discovery tool on the network, often repeatedly, so we build the response once and keep it
+// until the network settings or the machine name change
 void FGMCProtocol::cmdUnetinf(uint32_t inPacketId) noexcept
 {
-	FGMC_ResUploadNetInfoHeader* pOutCmdHeader = reinterpret_cast<FGMC_ResUploadNetInfoHeader*>(tx_netbuf_);
+	if (!isUnetinfCacheValid())
+	{
+		buildUnetinf();
+	}
+	(void)memcpy(tx_netbuf_, unetinfCache_, sizeof(FGMC_ResUploadNetInfoHeader));
+
+	//-----------------------------------------------------------------------------------
+	// Generic Multicast Header
+	//-----------------------------------------------------------------------------------
+	sendGenericHeader(tx_netbuf_, FGMCCommand::MCD_COMMAND_UNETINF, sizeof(FGMC_ResUploadNetInfoHeader), inPacketId, 0, 1);
+}
+
+// Build the body of the upload network information response in the cache. The generic header is filled in when it is sent.
+void FGMCProtocol::buildUnetinf() noexcept
+{
+	FGMC_ResUploadNetInfoHeader* pOutCmdHeader = reinterpret_cast<FGMC_ResUploadNetInfoHeader*>(unetinfCache_);
 	(void)memset(pOutCmdHeader, 0x00, sizeof(FGMC_ResUploadNetInfoHeader));
 
 	//-----------------------------------------------------------------------------------
@@ -246,11 +300,7 @@ void FGMCProtocol::cmdUnetinf(uint32_t inPacketId) noexcept
 
 	// Device Name
 	strncpy(pOutCmdHeader->fgmc_device_name_, reprap.GetName(), ARRAY_SIZE(pOutCmdHeader->fgmc_device_name_));
-
-	//-----------------------------------------------------------------------------------
-	// Generic Multicast Header
-	//-----------------------------------------------------------------------------------
-	sendGenericHeader(tx_netbuf_, FGMCCommand::MCD_COMMAND_UNETINF, sizeof(FGMC_ResUploadNetInfoHeader), inPacketId, 0, 1);
+	unetinfCacheValid_ = true;
 }
 
 void FGMCProtocol::cmdDnetinf(FGMC_ReqDownloadNetInfoHeader* pInCmdHeader, uint32_t inPacketId) noexcept
@@ -52,6 +52,13 @@ private:
 	/// \param inPacketId packedId
 	void cmdUnetinf(uint32_t inPacketId) noexcept;
 
+	/// build the "upload network informations" response body in the cache
+	void buildUnetinf() noexcept;
+
+	/// check whether the cached "upload network informations" response is still correct
+	/// \return true if it can be sent as it is
+	bool isUnetinfCacheValid() const noexcept;
+
 	/// fgmc command "download network information"
 	/// \param pInCmdHeader request header network information header
 	/// \param inPacketId packedId
@@ -103,7 +110,9 @@ private:
 
 	char uniqueId[SIZE_FGMC_DEST_ID];
 	InterfaceData ifaceData[IP_MAX_IFACES];
+	bool unetinfCacheValid_;
 	uint8_t tx_netbuf_[SIZE_FGMC_RES_MAX];
+	uint8_t unetinfCache_[sizeof(FGMC_ResUploadNetInfoHeader)];
 };
 
 #endif	// SUPPORT_MULTICAST_DISCOVERY
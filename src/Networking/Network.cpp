@@ -15,6 +15,7 @@
 #include <Version.h>
 #include <Movement/StepTimer.h>
 #include <Platform/TaskPriorities.h>
+#include <Platform/Tasks.h>
 
 #if HAS_NETWORKING
 #include "NetworkBuffer.h"
@@ -36,6 +37,9 @@
 # include "RTOSPlusTCPEthernet/RTOSPlusTCPEthernetInterface.h"
 #endif
 
+#if HAS_RESPONDERS
+# include "UploadingNetworkResponder.h"
+#endif
 #if SUPPORT_HTTP
 # include "HttpResponder.h"
 #endif
@@ -118,12 +122,14 @@ constexpr ObjectModelArrayDescriptor Network::interfacesArrayDescriptor =
 };
 
 // Macro to build a standard lambda function that includes the necessary type conversions
-#define OBJECT_MODEL_FUNC(_ret) OBJECT_MODEL_FUNC_BODY(Network, _ret)
+#define OBJECT_MODEL_FUNC(...) OBJECT_MODEL_FUNC_BODY(Network, __VA_ARGS__)
 
 constexpr ObjectModelTableEntry Network::objectModelTable[] =
 {
-	// These entries must be in alphabetical order
+	// Within each group, these entries must be in alphabetical order
+	// 0. Network members
 #if HAS_NETWORKING
+	{ "buffers",	OBJECT_MODEL_FUNC(self, 1),								ObjectModelEntryFlags::live },
 # if SUPPORT_HTTP
 	{ "corsSite",	OBJECT_MODEL_FUNC(self->GetCorsSite()),					ObjectModelEntryFlags::none },
 # endif
@@ -131,17 +137,28 @@ constexpr ObjectModelTableEntry Network::objectModelTable[] =
 	{ "interfaces", OBJECT_MODEL_FUNC_NOSELF(&interfacesArrayDescriptor),	ObjectModelEntryFlags::none },
 #endif
 	{ "name",		OBJECT_MODEL_FUNC_NOSELF(reprap.GetName()), 			ObjectModelEntryFlags::none },
+
+#if HAS_NETWORKING
+	// 1. Network.buffers members
+	{ "failed",		OBJECT_MODEL_FUNC_NOSELF((int32_t)NetworkBuffer::GetAllocationFailures()),	ObjectModelEntryFlags::live },
+	{ "max",		OBJECT_MODEL_FUNC_NOSELF((int32_t)NetworkBuffer::GetMaxUsed()),			ObjectModelEntryFlags::live },
+	{ "total",		OBJECT_MODEL_FUNC_NOSELF((int32_t)NetworkBuffer::GetNumBuffers()),			ObjectModelEntryFlags::none },
+#endif
 };
 
-constexpr uint8_t Network::objectModelTableDescriptor[] = { 1,
+constexpr uint8_t Network::objectModelTableDescriptor[] =
+{
 #if HAS_NETWORKING
+	2,
 # if SUPPORT_HTTP
-		4
+	5,
 # else
-		3
+	4,
 # endif
+	3
 #else
-		1
+	1,
+	1
 #endif
 };
 
@@ -420,8 +437,18 @@ extern "C" [[noreturn]]void NetworkLoop(void *) noexcept
 void Network::Activate() noexcept
 {
 #if HAS_NETWORKING
-	// Allocate network buffers
-	NetworkBuffer::AllocateBuffers(NetworkBufferCount);
+	// Allocate network buffers. Unless config.g set the number, add as many to the default number as we can make from a fraction of the never-used RAM.
+	unsigned int numBuffers = numBuffersToAllocate;
+	if (numBuffers == 0)
+	{
+		numBuffers = NetworkBufferCount;
+		const ptrdiff_t extraBuffers = (Tasks::GetNeverUsedRam()/NetworkBufferRamFraction)/(ptrdiff_t)(sizeof(NetworkBuffer) + 8);
+		if (extraBuffers > 0)
+		{
+			numBuffers = min<unsigned int>(numBuffers + (unsigned int)extraBuffers, MaxNetworkBufferCount);
+		}
+	}
+	NetworkBuffer::AllocateBuffers(numBuffers);
 
 	// Activate the interfaces
 	for (NetworkInterface *iface : interfaces)
@@ -595,17 +622,22 @@ void Network::Diagnostics(MessageType mtype) noexcept
 		r->Diagnostics(mtype);
 	}
 	platform.Message(mtype, "\n");
+# if HAS_MASS_STORAGE
+	UploadingNetworkResponder::CommonDiagnostics(mtype);
+# endif
 #endif
 
 #if SUPPORT_HTTP
 	HttpResponder::CommonDiagnostics(mtype);
 #endif
+	NetworkBuffer::Diagnostics(mtype);
 
 	for (NetworkInterface *iface : interfaces)
 	{
 		if (iface != nullptr)
 		{
 			iface->Diagnostics(mtype);
+			iface->ReportTraffic(mtype);
 		}
 	}
 #endif
@@ -615,6 +647,28 @@ void Network::Diagnostics(MessageType mtype) noexcept
 #endif
 }
 
+// Set the number of network buffers to allocate when the network is activated at the end of config.g. Zero means size the pool from the free RAM.
+GCodeResult Network::SetNumBuffers(unsigned int numBuffers, const StringRef& reply) noexcept
+{
+#if HAS_NETWORKING
+	if (NetworkBuffer::GetNumBuffers() != 0)
+	{
+		reply.copy("the number of network buffers can only be set in config.g");
+		return GCodeResult::error;
+	}
+	if (numBuffers != 0 && (numBuffers < MinNetworkBufferCount || numBuffers > MaxNetworkBufferCount))
+	{
+		reply.printf("the number of network buffers must be 0 or between %u and %u", (unsigned int)MinNetworkBufferCount, (unsigned int)MaxNetworkBufferCount);
+		return GCodeResult::error;
+	}
+	numBuffersToAllocate = numBuffers;
+	return GCodeResult::ok;
+#else
+	reply.copy(notSupportedText);
+	return GCodeResult::error;
+#endif
+}
+
 int Network::EnableState(unsigned int interface) const noexcept
 {
 #if HAS_NETWORKING
@@ -793,6 +847,14 @@ void Network::HandleTelnetGCodeReply(OutputBuffer *buf) noexcept
 #endif
 }
 
+// Set how long Telnet G-code replies may be held back so that several can be sent in one TCP segment. Zero sends each one straight away.
+void Network::SetTelnetReplyBatchTime(uint32_t ms) noexcept
+{
+#if SUPPORT_TELNET
+	TelnetResponder::SetReplyBatchTime(ms);
+#endif
+}
+
 uint32_t Network::GetHttpReplySeq() noexcept
 {
 #if SUPPORT_HTTP
@@ -78,6 +78,7 @@ public:
 	GCodeResult EnableProtocol(unsigned int interface, NetworkProtocol protocol, int port, int secure, const StringRef& reply) noexcept;
 	GCodeResult DisableProtocol(unsigned int interface, NetworkProtocol protocol, const StringRef& reply) noexcept;
 	GCodeResult ReportProtocols(unsigned int interface, const StringRef& reply) const noexcept;
+	GCodeResult SetNumBuffers(unsigned int numBuffers, const StringRef& reply) noexcept;
 
 	// WiFi interfaces
 	GCodeResult HandleWiFiCode(int mcode, GCodeBuffer& gb, const StringRef& reply, OutputBuffer*& longReply);
@@ -110,6 +111,7 @@ public:
 	void HandleTelnetGCodeReply(const char *msg) noexcept;
 	void HandleHttpGCodeReply(OutputBuffer *buf) noexcept;
 	void HandleTelnetGCodeReply(OutputBuffer *buf) noexcept;
+	void SetTelnetReplyBatchTime(uint32_t ms) noexcept;
 	uint32_t GetHttpReplySeq() noexcept;
 
 protected:
@@ -124,6 +126,7 @@ private:
 
 #if HAS_NETWORKING
 	NetworkInterface *interfaces[MaxNetworkInterfaces];
+	unsigned int numBuffersToAllocate = 0;			// the number of network buffers requested by M586 B, or 0 to size the pool from the free RAM
 #endif
 
 #if HAS_RESPONDERS
@@ -7,8 +7,14 @@
 
 #include "NetworkBuffer.h"
 #include "Storage/FileStore.h"
+#include <Platform/RepRap.h>
+#include <Platform/Platform.h>
 
 NetworkBuffer *NetworkBuffer::freelist = nullptr;
+unsigned int NetworkBuffer::numBuffers = 0;
+unsigned int NetworkBuffer::numUsed = 0;
+unsigned int NetworkBuffer::maxUsed = 0;
+unsigned int NetworkBuffer::allocationFailures = 0;
 
 NetworkBuffer::NetworkBuffer(NetworkBuffer *n) noexcept : next(n), dataLength(0), readPointer(0)
 {
@@ -20,6 +26,7 @@ NetworkBuffer *NetworkBuffer::Release() noexcept
 	NetworkBuffer *ret = next;
 	next = freelist;
 	freelist = this;
+	--numUsed;
 	return ret;
 }
 
@@ -115,6 +122,15 @@ void NetworkBuffer::Empty() noexcept
 		freelist = ret->next;
 		ret->next = nullptr;
 		ret->dataLength = ret->readPointer = 0;
+		++numUsed;
+		if (numUsed > maxUsed)
+		{
+			maxUsed = numUsed;
+		}
+	}
+	else
+	{
+		++allocationFailures;
 	}
 	return ret;
 }
@@ -124,6 +140,7 @@ void NetworkBuffer::Empty() noexcept
 	while (number != 0)
 	{
 		freelist = new NetworkBuffer(freelist);
+		++numBuffers;
 		--number;
 	}
 }
@@ -139,4 +156,9 @@ void NetworkBuffer::Empty() noexcept
 	return ret;
 }
 
+/*static*/ void NetworkBuffer::Diagnostics(MessageType mtype) noexcept
+{
+	reprap.GetPlatform().MessageF(mtype, "Network buffers: %u of %u in use (%u max), %u allocation failures\n", numUsed, numBuffers, maxUsed, allocationFailures);
+}
+
 // End
@@ -79,6 +79,12 @@ public:
 	// Count how many buffers there are in a chain
 	static unsigned int Count(NetworkBuffer*& ptr) noexcept;
 
+	// Report on the buffer pool
+	static unsigned int GetNumBuffers() noexcept { return numBuffers; }
+	static unsigned int GetMaxUsed() noexcept { return maxUsed; }
+	static unsigned int GetAllocationFailures() noexcept { return allocationFailures; }
+	static void Diagnostics(MessageType mtype) noexcept;
+
 #if defined(__LPC17xx__)
 
 # if HAS_RTOSPLUSTCP_NETWORKING
@@ -104,6 +110,10 @@ private:
 	// When doing unaligned transfers on the WiFi interface, up to 3 extra bytes may be returned, hence the +1 in the following
 	uint32_t data32[bufferSize/sizeof(uint32_t) + 1];		// 32-bit aligned buffer so we can do direct DMA
 	static NetworkBuffer *freelist;
+	static unsigned int numBuffers;								// how many buffers we allocated
+	static unsigned int numUsed;								// how many of them are not in the free list
+	static unsigned int maxUsed;								// the highest value of numUsed since we allocated them
+	static unsigned int allocationFailures;						// how many times Allocate found the free list empty
 };
 
 #endif /* SRC_NETWORKING_NETWORKBUFFER_H_ */
@@ -74,11 +74,21 @@ constexpr TcpPort MdnsPort = 5353;
 
 #if defined(__LPC17xx__)
 constexpr size_t NetworkBufferCount = 2;			// number of MSS sized buffers
+constexpr size_t MaxNetworkBufferCount = 4;			// the most we allocate when sizing the pool from free RAM or when asked to by M586
 #elif SAME70 || SAME5x
 constexpr size_t NetworkBufferCount = 10;			// number of 2K network buffers
+constexpr size_t MaxNetworkBufferCount = 32;
 #else
 constexpr size_t NetworkBufferCount = 6;			// number of 2K network buffers
+constexpr size_t MaxNetworkBufferCount = 12;
 #endif
+#if SAME70
+constexpr unsigned int MaxFileBuffersPerSend = 4;	// how many buffers of a file a responder may pass to its socket in one go. The high-throughput lwIP settings can accept this many.
+#else
+constexpr unsigned int MaxFileBuffersPerSend = 1;
+#endif
+constexpr size_t MinNetworkBufferCount = 2;			// the fewest we allow M586 to ask for
+constexpr ptrdiff_t NetworkBufferRamFraction = 8;	// when adding buffers to the default number, use at most this fraction of the RAM that has never been used
 
 constexpr size_t SsidBufferLength = 32;				// maximum characters in an SSID
 
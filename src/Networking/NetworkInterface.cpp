@@ -7,6 +7,7 @@
 
 #include "NetworkInterface.h"
 #include <Platform/RepRap.h>
+#include <Platform/Platform.h>
 
 void NetworkInterface::SetState(NetworkState::RawType newState) noexcept
 {
@@ -14,4 +15,9 @@ void NetworkInterface::SetState(NetworkState::RawType newState) noexcept
 	reprap.NetworkUpdated();
 }
 
+void NetworkInterface::ReportTraffic(MessageType mtype) const noexcept
+{
+	reprap.GetPlatform().MessageF(mtype, "Bytes received %" PRIu64 ", sent %" PRIu64 "\n", bytesReceived, bytesSent);
+}
+
 // End
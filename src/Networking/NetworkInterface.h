@@ -44,6 +44,13 @@ public:
 
 	virtual void UpdateHostname(const char *hostname) noexcept = 0;
 
+	// Traffic counters, updated by the sockets
+	void RecordBytesReceived(size_t numBytes) noexcept { bytesReceived += numBytes; }
+	void RecordBytesSent(size_t numBytes) noexcept { bytesSent += numBytes; }
+	uint64_t GetBytesReceived() const noexcept { return bytesReceived; }
+	uint64_t GetBytesSent() const noexcept { return bytesSent; }
+	void ReportTraffic(MessageType mtype) const noexcept;
+
 	virtual void OpenDataPort(TcpPort port) noexcept = 0;
 	virtual void TerminateDataPort() noexcept = 0;
 
@@ -59,6 +66,8 @@ protected:
 
 private:
 	NetworkState state;
+	uint64_t bytesReceived = 0;
+	uint64_t bytesSent = 0;
 };
 
 #endif /* SRC_NETWORKING_NETWORKINTERFACE_H_ */
@@ -8,12 +8,13 @@
 #include "NetworkResponder.h"
 #include "Socket.h"
 #include <Platform/Platform.h>
+#include <Platform/EventTrace.h>
 
 // NetworkResponder members
 
 NetworkResponder::NetworkResponder(NetworkResponder *n) noexcept
 	: next(n), responderState(ResponderState::free), skt(nullptr),
-	  outBuf(nullptr),
+	  outBuf(nullptr), outBufBytesSent(0),
 #if HAS_MASS_STORAGE
 	  fileBeingSent(nullptr),
 #endif
@@ -36,11 +37,9 @@ void NetworkResponder::Commit(ResponderState nextState, bool report) noexcept
 	}
 }
 
-// Send our data.
-// We send outBuf first, then outStack, and finally fileBeingSent.
-void NetworkResponder::SendData() noexcept
+// Send outBuf and then outStack. Return true if we sent all of them, false if the socket can't take any more data at present or the connection was lost.
+bool NetworkResponder::SendOutputBuffers() noexcept
 {
-	// Send our output buffer and output stack
 	for(;;)
 	{
 		if (outBuf == nullptr)
@@ -48,17 +47,22 @@ void NetworkResponder::SendData() noexcept
 			outBuf = outStack.Pop();
 			if (outBuf == nullptr)
 			{
-				break;
+				return true;
 			}
 		}
-		const size_t bytesLeft = outBuf->BytesLeft();
+		// Don't use the read pointer in the buffer, because another responder may be sending the same buffer to a different client
+		const size_t bytesLeft = outBuf->DataLength() - outBufBytesSent;
 		if (bytesLeft == 0)
 		{
 			outBuf = OutputBuffer::Release(outBuf);
+			outBufBytesSent = 0;
 		}
 		else
 		{
-			const size_t sent = skt->Send(reinterpret_cast<const uint8_t *>(outBuf->UnreadData()), bytesLeft);
+			const size_t sent = skt->Send(reinterpret_cast<const uint8_t *>(outBuf->Data() + outBufBytesSent), bytesLeft);
+#if SUPPORT_EVENT_TRACE
+			EventTrace::Record(EventTrace::EventId::networkSend, bytesLeft, sent);
+#endif
 			if (sent == 0)
 			{
 				// Check whether the connection has been closed
@@ -71,17 +75,29 @@ void NetworkResponder::SendData() noexcept
 					}
 					ConnectionLost();
 				}
-				return;
+				return false;
 			}
 
-			outBuf->Taken(sent);				// tell the output buffer how much data we have taken
+			outBufBytesSent += sent;
 			if (sent < bytesLeft)
 			{
-				return;
+				return false;
 			}
 			outBuf = OutputBuffer::Release(outBuf);
+			outBufBytesSent = 0;
 		}
 	}
+}
+
+// Send our data.
+// We send outBuf first, then outStack, and finally fileBeingSent.
+void NetworkResponder::SendData() noexcept
+{
+	// Send our output buffer and output stack
+	if (!SendOutputBuffers())
+	{
+		return;
+	}
 
 	// If we get here then there are no output buffers left to send
 
@@ -96,7 +112,9 @@ void NetworkResponder::SendData() noexcept
 		}
 	}
 
-	// If we have a file buffer here, we must be in the process of sending a file
+	// If we have a file buffer here, we must be in the process of sending a file.
+	// When the socket can take several buffers of data, pass it up to MaxFileBuffersPerSend of them before we let other responders run.
+	unsigned int buffersSent = 0;
 	while (fileBuffer != nullptr)
 	{
 		if (fileBuffer->IsEmpty() && fileBeingSent != nullptr)
@@ -120,6 +138,9 @@ void NetworkResponder::SendData() noexcept
 		{
 			const size_t remaining = fileBuffer->Remaining();
 			const size_t sent = skt->Send(fileBuffer->UnreadData(), remaining);
+#if SUPPORT_EVENT_TRACE
+			EventTrace::Record(EventTrace::EventId::networkSend, remaining, sent);
+#endif
 			if (sent == 0)
 			{
 				// Check whether the connection has been closed
@@ -136,8 +157,8 @@ void NetworkResponder::SendData() noexcept
 
 			fileBuffer->Taken(sent);
 
-			if (   sent < remaining				// if we couldn't send it all...
-				|| fileBuffer->IsEmpty()		// ...or if we've sent the whole buffer, return to allow other sockets to be polled
+			if (   sent < remaining															// if we couldn't send it all...
+				|| (fileBuffer->IsEmpty() && ++buffersSent >= MaxFileBuffersPerSend)	// ...or if we've sent enough buffers, return to allow other sockets to be polled
 			   )
 			{
 				return;
@@ -162,6 +183,7 @@ void NetworkResponder::SendData() noexcept
 void NetworkResponder::ConnectionLost() noexcept
 {
 	OutputBuffer::ReleaseAll(outBuf);
+	outBufBytesSent = 0;
 	outStack.ReleaseAll();
 
 #if HAS_MASS_STORAGE
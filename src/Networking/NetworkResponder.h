@@ -44,6 +44,7 @@ protected:
 		// HTTP responder additional states
 		processingRequest,
 		gettingFileInfo,								// getting file info
+		webSocket,										// waiting for a WebSocket frame from the client or for the object model to change
 
 		// FTP responder additional states
 		waitingForPasvPort,
@@ -60,6 +61,7 @@ protected:
 
 	void Commit(ResponderState nextState = ResponderState::free, bool report = true) noexcept;
 	virtual void SendData() noexcept;
+	bool SendOutputBuffers() noexcept;
 	virtual void ConnectionLost() noexcept;
 
 	IPAddress GetRemoteIP() const noexcept;
@@ -77,6 +79,7 @@ protected:
 
 	// Buffers for sending responses
 	OutputBuffer *outBuf;
+	size_t outBufBytesSent;								// how much of outBuf we have sent. This is kept here because a buffer may be shared by several responders.
 	OutputStack outStack;								// not volatile because only one task accesses it
 #if HAS_MASS_STORAGE
 	FileStore *fileBeingSent;
@@ -24,7 +24,7 @@ bool TelnetResponder::Accept(Socket *s, NetworkProtocol protocol) noexcept
 	if (responderState == ResponderState::free && protocol == TelnetProtocol)
 	{
 		// Make sure we can get an output buffer before we accept the connection, or we won't be able to reply
-		if (outBuf != nullptr || OutputBuffer::Allocate(outBuf))
+		if (outBuf != nullptr || OutputBuffer::Allocate(outBuf, OutputBufferConsumer::telnet))
 		{
 			skt = s;
 			clientPointer = 0;
@@ -77,6 +77,15 @@ bool TelnetResponder::SendGCodeReply() noexcept
 
 	if (gcodeReply != nullptr)
 	{
+		// When batching replies, hold them back until there are enough to fill a decent TCP segment or the oldest one has waited long enough.
+		// Once one client has taken the reply, the others must take it too.
+		if (   replyBatchTime != 0 && clientsServed == 0
+			&& gcodeReply->Length() < TelnetReplyBatchSize && millis() - gcodeReplyStartTime < replyBatchTime
+		   )
+		{
+			return false;
+		}
+
 		bool clearReply = false;
 		clientsServed++;
 		if (clientsServed < numSessions)
@@ -161,7 +170,7 @@ bool TelnetResponder::Spin() noexcept
 				return true;
 			}
 
-			if (haveCompleteLine && (outBuf != nullptr || OutputBuffer::Allocate(outBuf)))
+			if (haveCompleteLine && (outBuf != nullptr || OutputBuffer::Allocate(outBuf, OutputBufferConsumer::telnet)))
 			{
 				haveCompleteLine = false;
 				clientPointer = 0;
@@ -190,23 +199,21 @@ bool TelnetResponder::Spin() noexcept
 		}
 		{
 			// See if we can read anything
-			bool readSomething = false;
-			char c;
-			while (!haveCompleteLine && skt->ReadChar(c))
+			if (haveCompleteLine)
 			{
-				CharFromClient(c);
-				readSomething = true;
+				ProcessLine();								// try again to store the line that we couldn't store last time
+				return true;
 			}
 
+			const bool readSomething = ReadLines();
 			if (!readSomething && !skt->CanRead())
 			{
 				ConnectionLost();
 				return true;
 			}
 
-			if (haveCompleteLine)
+			if (haveCompleteLine || responderState != ResponderState::reading)
 			{
-				ProcessLine();
 				return true;
 			}
 
@@ -225,6 +232,34 @@ bool TelnetResponder::Spin() noexcept
 	}
 }
 
+// Read as many lines as the Telnet G-code input can accept, so that a client that streams a block of G-code doesn't have to wait for one Spin per line.
+// We stop if we have a complete line that we couldn't store, or if a line changed our state. Return true if we read anything.
+bool TelnetResponder::ReadLines() noexcept
+{
+	bool readSomething = false;
+	const uint8_t *data;
+	size_t len;
+	while (!haveCompleteLine && responderState == ResponderState::reading && skt->ReadBuffer(data, len))
+	{
+		size_t i = 0;
+		while (i < len)
+		{
+			CharFromClient((char)data[i++]);
+			if (haveCompleteLine)
+			{
+				ProcessLine();
+				if (haveCompleteLine || responderState != ResponderState::reading)
+				{
+					break;
+				}
+			}
+		}
+		skt->Taken(i);
+		readSomething = true;
+	}
+	return readSomething;
+}
+
 // Process a character from the client, returning true if we have a complete line
 void TelnetResponder::CharFromClient(char c) noexcept
 {
@@ -272,7 +307,7 @@ void TelnetResponder::ProcessLine() noexcept
 	// Special commands for Telnet
 	if (StringEqualsIgnoreCase(clientMessage, "exit") || StringEqualsIgnoreCase(clientMessage, "quit"))
 	{
-		if (outBuf != nullptr || OutputBuffer::Allocate(outBuf))
+		if (outBuf != nullptr || OutputBuffer::Allocate(outBuf, OutputBufferConsumer::telnet))
 		{
 			haveCompleteLine = false;
 			clientPointer = 0;
@@ -314,10 +349,14 @@ void TelnetResponder::ProcessLine() noexcept
 		MutexLocker lock(gcodeReplyMutex);
 
 		// We need a valid OutputBuffer to start the conversion from NL to CRNL
-		if (gcodeReply == nullptr && !OutputBuffer::Allocate(gcodeReply))
+		if (gcodeReply == nullptr)
 		{
-			// No more space available to store this reply, stop here
-			return;
+			if (!OutputBuffer::Allocate(gcodeReply, OutputBufferConsumer::telnet))
+			{
+				// No more space available to store this reply, stop here
+				return;
+			}
+			gcodeReplyStartTime = millis();
 		}
 
 		// Write entire content to new output buffers, but this time with \r\n instead of \n
@@ -348,15 +387,19 @@ void TelnetResponder::ProcessLine() noexcept
 		MutexLocker lock(gcodeReplyMutex);
 
 		// We need a valid OutputBuffer to start the conversion from NL to CRNL
-		if (gcodeReply == nullptr && !OutputBuffer::Allocate(gcodeReply))
+		if (gcodeReply == nullptr)
 		{
-			OutputBuffer::Truncate(reply, OUTPUT_BUFFER_SIZE);
-			if (!OutputBuffer::Allocate(gcodeReply))
+			if (!OutputBuffer::Allocate(gcodeReply, OutputBufferConsumer::telnet))
 			{
-				// If we're really short on memory, release the G-Code reply instantly
-				OutputBuffer::ReleaseAll(reply);
-				return;
+				OutputBuffer::Truncate(reply, OUTPUT_BUFFER_SIZE);
+				if (!OutputBuffer::Allocate(gcodeReply, OutputBufferConsumer::telnet))
+				{
+					// If we're really short on memory, release the G-Code reply instantly
+					OutputBuffer::ReleaseAll(reply);
+					return;
+				}
 			}
+			gcodeReplyStartTime = millis();
 		}
 
 		// Write entire content to new output buffers, but this time with \r\n instead of \n
@@ -393,6 +436,8 @@ unsigned int TelnetResponder::numSessions = 0;
 unsigned int TelnetResponder::clientsServed = 0;
 OutputBuffer *TelnetResponder::gcodeReply = nullptr;
 Mutex TelnetResponder::gcodeReplyMutex;
+uint32_t TelnetResponder::gcodeReplyStartTime = 0;
+uint32_t TelnetResponder::replyBatchTime = 0;
 
 #endif
 
@@ -22,6 +22,7 @@ public:
 	static void Disable() noexcept;
 	static void HandleGCodeReply(const char *reply) noexcept;
 	static void HandleGCodeReply(OutputBuffer *reply) noexcept;
+	static void SetReplyBatchTime(uint32_t ms) noexcept { replyBatchTime = ms; }
 	void Diagnostics(MessageType mtype) const noexcept override;
 
 private:
@@ -30,6 +31,7 @@ private:
 	void ConnectionLost() noexcept override;
 
 	bool SendGCodeReply() noexcept;
+	bool ReadLines() noexcept;
 
 	bool haveCompleteLine;
 	char clientMessage[MaxGCodeLength];
@@ -40,8 +42,11 @@ private:
 	static unsigned int clientsServed;
 	static OutputBuffer *gcodeReply;
 	static Mutex gcodeReplyMutex;
+	static uint32_t gcodeReplyStartTime;				// when the first reply in gcodeReply was stored
+	static uint32_t replyBatchTime;						// how long we may hold replies back to send them together, or 0 to send them straight away
 
 	static const uint32_t TelnetSetupDuration = 4000;	// ignore the first Telnet request within this duration (in ms)
+	static const size_t TelnetReplyBatchSize = 1024;	// when batching replies, send them as soon as we have this many bytes
 };
 
 #endif /* SRC_NETWORKING_TELNETRESPONDER_H_ */
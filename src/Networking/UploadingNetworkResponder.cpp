@@ -9,6 +9,13 @@
 #include "Socket.h"
 #include <Platform/Platform.h>
 
+#if HAS_MASS_STORAGE
+unsigned int UploadingNetworkResponder::numUploadsFinished = 0;
+uint32_t UploadingNetworkResponder::totalUploadBytes = 0;
+uint32_t UploadingNetworkResponder::totalUploadMillis = 0;
+float UploadingNetworkResponder::slowestUploadRate = 0.0;
+#endif
+
 UploadingNetworkResponder::UploadingNetworkResponder(NetworkResponder *n) noexcept : NetworkResponder(n)
 #if HAS_MASS_STORAGE
 	, uploadError(false), dummyUpload(false)
@@ -69,9 +76,12 @@ bool UploadingNetworkResponder::StartUpload(const char* folder, const char *file
 		}
 		fileBeingUploaded.Set(file);
 		dummyUpload = false;
+		uploadPreAllocated = (preAllocSize != 0);
 	}
 	responderState = ResponderState::uploading;
 	uploadError = false;
+	uploadedBytes = 0;
+	uploadStartTime = millis();
 	return true;
 }
 
@@ -87,6 +97,13 @@ void UploadingNetworkResponder::FinishUpload(uint32_t fileLength, time_t fileLas
 			GetPlatform().Message(ErrorMessage, "Could not flush remaining data while finishing upload\n");
 		}
 
+		// If we pre-allocated space for the file then its length is the size we allocated, so truncate it to the data we received
+		else if (uploadPreAllocated && fileBeingUploaded.GetPosition() < fileBeingUploaded.Length() && !fileBeingUploaded.Truncate())
+		{
+			uploadError = true;
+			GetPlatform().Message(ErrorMessage, "Could not truncate file while finishing upload\n");
+		}
+
 		// Check the file length is as expected
 		if (fileLength != 0 && fileBeingUploaded.Length() != fileLength)
 		{
@@ -105,6 +122,20 @@ void UploadingNetworkResponder::FinishUpload(uint32_t fileLength, time_t fileLas
 			fileBeingUploaded.Close();
 		}
 
+		// Record the throughput. Uploads that run at the same time share the card, so each one is slower than the card's write rate.
+		if (!uploadError)
+		{
+			const uint32_t uploadMillis = millis() - uploadStartTime;
+			const float rate = GetUploadRate();
+			if (numUploadsFinished == 0 || rate < slowestUploadRate)
+			{
+				slowestUploadRate = rate;
+			}
+			++numUploadsFinished;
+			totalUploadBytes += uploadedBytes;
+			totalUploadMillis += uploadMillis;
+		}
+
 		// Delete the file again if an error has occurred
 		if (!filenameBeingProcessed.IsEmpty())
 		{
@@ -142,6 +173,24 @@ void UploadingNetworkResponder::FinishUpload(uint32_t fileLength, time_t fileLas
 	}
 }
 
+float UploadingNetworkResponder::GetUploadRate() const noexcept
+{
+	const uint32_t uploadMillis = millis() - uploadStartTime;
+	return (uploadMillis == 0) ? 0.0 : (float)uploadedBytes/(1.024 * (float)uploadMillis);
+}
+
+/*static*/ void UploadingNetworkResponder::CommonDiagnostics(MessageType mtype) noexcept
+{
+	if (numUploadsFinished != 0)
+	{
+		GetPlatform().MessageF(mtype, "Uploads finished %u, %" PRIu32 "Kbytes, average rate %.1fKbytes/sec, slowest %.1fKbytes/sec\n",
+								numUploadsFinished, totalUploadBytes/1024,
+								(double)((totalUploadMillis == 0) ? 0.0 : (float)totalUploadBytes/(1.024 * (float)totalUploadMillis)), (double)slowestUploadRate);
+		numUploadsFinished = 0;
+		totalUploadBytes = totalUploadMillis = 0;
+	}
+}
+
 #endif
 
 // End
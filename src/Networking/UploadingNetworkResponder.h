@@ -12,6 +12,11 @@
 
 class UploadingNetworkResponder : public NetworkResponder
 {
+public:
+#if HAS_MASS_STORAGE
+	static void CommonDiagnostics(MessageType mtype) noexcept;
+#endif
+
 protected:
 	UploadingNetworkResponder(NetworkResponder *n) noexcept;
 
@@ -21,15 +26,27 @@ protected:
 #if HAS_MASS_STORAGE
 	bool StartUpload(const char* folder, const char *fileName, const OpenMode mode, const uint32_t preAllocSize = 0) noexcept;
 	void FinishUpload(uint32_t fileLength, time_t fileLastModified, bool gotCrc, uint32_t expectedCrc) noexcept;
+	float GetUploadRate() const noexcept;				// Return the average rate of the current upload in Kbytes/sec
 
 	// File uploads
 	FileData fileBeingUploaded;
 	uint32_t uploadedBytes;								// how many bytes have already been written
+	uint32_t uploadStartTime;							// the time in milliseconds when the upload started
 	bool uploadError;
 	bool dummyUpload;
+	bool uploadPreAllocated;							// true if space was allocated for the file when we opened it, so we must truncate it when we finish
 #endif
 
 	String<MaxFilenameLength> filenameBeingProcessed;	// usually the name of the file being uploaded, but also used by HttpResponder and FtpResponder
+
+#if HAS_MASS_STORAGE
+private:
+	// Throughput of the uploads that have finished since the last diagnostics report
+	static unsigned int numUploadsFinished;
+	static uint32_t totalUploadBytes;
+	static uint32_t totalUploadMillis;
+	static float slowestUploadRate;
+#endif
 };
 
 #endif /* SRC_NETWORKING_UPLOADINGNETWORKRESPONDER_H_ */
@@ -23,7 +23,7 @@ constexpr size_t MinMdnsHeaderLength = DnsHeaderLength + 8;	// + extra space for
 
 constexpr uint16_t MdnsTtl = 120;		// in seconds
 
-MdnsResponder::MdnsResponder(W5500Socket *sock) noexcept : socket(sock), lastAnnouncement(0)
+MdnsResponder::MdnsResponder(W5500Socket *sock) noexcept : socket(sock), lastAnnouncement(0), whenLastSent(0), recordLength(0), recordIpAddress(0)
 {
 }
 
@@ -54,7 +54,7 @@ void MdnsResponder::Spin() noexcept
 	}
 }
 
-void MdnsResponder::ProcessPacket(const uint8_t *packet, size_t length) const noexcept
+void MdnsResponder::ProcessPacket(const uint8_t *packet, size_t length) noexcept
 {
 	size_t bytesProcessed = 0;
 
@@ -111,7 +111,11 @@ void MdnsResponder::ProcessPacket(const uint8_t *packet, size_t length) const no
 				bytesProcessed += sizeof(uint16_t);
 				if (flags == 1 && type == 1 && nameMatches)		// Class IN, A record
 				{
-					SendARecord(transaction);
+					// Our answer is multicast so every host that asked will see it. When many hosts query at once, answer at most once per second.
+					if (millis() - whenLastSent >= MinResponseInterval)
+					{
+						SendARecord(transaction);
+					}
 				}
 			}
 			else
@@ -219,16 +223,16 @@ bool MdnsResponder::CheckHostname(const uint8_t *ptr, size_t maxLength, size_t *
 	return nameMatches;
 }
 
-void MdnsResponder::SendARecord(uint16_t transaction) const noexcept
+// Build the A record in recordBuffer. The transaction ID is filled in when we send it.
+void MdnsResponder::BuildARecord() noexcept
 {
-	uint8_t buffer[256];
+	uint8_t * const buffer = recordBuffer;
 	size_t bytesWritten = 0;
 
-	memset(buffer, 0, ARRAY_SIZE(buffer));
+	memset(buffer, 0, MaxRecordLength);
 
 	// Write DNS header
-	*reinterpret_cast<uint16_t*>(buffer) = transaction;
-	bytesWritten += sizeof(uint16_t);
+	bytesWritten += sizeof(uint16_t);														// leave room for the transaction ID
 	*reinterpret_cast<uint16_t*>(buffer + bytesWritten) = __builtin_bswap16(0x8400);	// Standard response
 	bytesWritten += sizeof(uint16_t);
 	*reinterpret_cast<uint16_t*>(buffer + bytesWritten) = 0;							// No questions
@@ -244,12 +248,12 @@ void MdnsResponder::SendARecord(uint16_t transaction) const noexcept
 	const char * const hostname = reprap.GetNetwork().GetHostname();
 	const size_t hostnameLength = strlen(hostname);
 	buffer[bytesWritten++] = hostnameLength;
-	SafeStrncpy(reinterpret_cast<char *>(buffer + bytesWritten), hostname, ARRAY_SIZE(buffer) - bytesWritten);
+	SafeStrncpy(reinterpret_cast<char *>(buffer + bytesWritten), hostname, MaxRecordLength - bytesWritten);
 	bytesWritten += hostnameLength;
 
 	// Write domain
 	buffer[bytesWritten++] = 5;
-	SafeStrncpy(reinterpret_cast<char *>(buffer + bytesWritten), "local", ARRAY_SIZE(buffer) - bytesWritten);
+	SafeStrncpy(reinterpret_cast<char *>(buffer + bytesWritten), "local", MaxRecordLength - bytesWritten);
 	bytesWritten += 5;
 
 	// Write terminating zero
@@ -270,16 +274,32 @@ void MdnsResponder::SendARecord(uint16_t transaction) const noexcept
 	bytesWritten += sizeof(uint16_t);
 
 	// Write IPv4 address
-	socket->GetInterface()->GetIPAddress().UnpackV4(buffer + bytesWritten);
+	const IPAddress ipAddress = socket->GetInterface()->GetIPAddress();
+	recordIpAddress = ipAddress.GetV4LittleEndian();
+	ipAddress.UnpackV4(buffer + bytesWritten);
 	bytesWritten += 4;
 
-	// Send it to the mDNS address
-	socket->Send(buffer, bytesWritten);
+	recordLength = bytesWritten;
+}
+
+// Send our A record to the mDNS address, building it first if the hostname or IP address has changed
+void MdnsResponder::SendARecord(uint16_t transaction) noexcept
+{
+	if (recordLength == 0 || socket->GetInterface()->GetIPAddress().GetV4LittleEndian() != recordIpAddress)
+	{
+		BuildARecord();
+	}
+
+	*reinterpret_cast<uint16_t*>(recordBuffer) = transaction;
+	socket->Send(recordBuffer, recordLength);
 	socket->Send();
+	whenLastSent = millis();
 }
 
+// Announce this host. This is called when the hostname or IP address changes as well as periodically, so rebuild the A record first.
 void MdnsResponder::Announce() noexcept
 {
+	recordLength = 0;
 	if (!socket->CanSend())
 	{
 		return;
@@ -28,12 +28,20 @@ public:
 	void Announce() noexcept;
 
 private:
+	static constexpr size_t MaxRecordLength = 256;
+	static constexpr uint32_t MinResponseInterval = 1000;	// RFC 6762 says we must not multicast a record more often than once per second
+
 	W5500Socket *socket;
 	uint32_t lastAnnouncement;
+	uint32_t whenLastSent;								// when we last sent our A record
+	size_t recordLength;								// the length of the A record in recordBuffer, or 0 if it needs to be built
+	uint32_t recordIpAddress;							// the IP address that the A record was built with
+	uint8_t recordBuffer[MaxRecordLength];				// the A record, which we only need to rebuild when the hostname or IP address changes
 
-	void ProcessPacket(const uint8_t *data, size_t length) const noexcept;
+	void ProcessPacket(const uint8_t *data, size_t length) noexcept;
 	bool CheckHostname(const uint8_t *ptr, size_t maxLength, size_t *bytesProcessed) const noexcept;
-	void SendARecord(uint16_t transaction) const noexcept;
+	void BuildARecord() noexcept;
+	void SendARecord(uint16_t transaction) noexcept;
 };
 
 #endif /* SRC_NETWORKING_W5500ETHERNET_MDNSRESPONDER_H_ */
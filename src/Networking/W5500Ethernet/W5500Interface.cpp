@@ -50,6 +50,8 @@ constexpr ObjectModelTableEntry W5500Interface::objectModelTable[] =
 {
 	// These entries must be in alphabetical order
 	{ "actualIP",			OBJECT_MODEL_FUNC(self->ipAddress),			ObjectModelEntryFlags::none },
+	{ "bytesReceived",		OBJECT_MODEL_FUNC(self->GetBytesReceived()),	ObjectModelEntryFlags::live },
+	{ "bytesSent",			OBJECT_MODEL_FUNC(self->GetBytesSent()),		ObjectModelEntryFlags::live },
 	{ "gateway",			OBJECT_MODEL_FUNC(self->gateway),			ObjectModelEntryFlags::none },
 	{ "mac",				OBJECT_MODEL_FUNC(self->macAddress),		ObjectModelEntryFlags::none },
 	{ "state",				OBJECT_MODEL_FUNC(self->GetStateName()),	ObjectModelEntryFlags::none },
@@ -57,7 +59,7 @@ constexpr ObjectModelTableEntry W5500Interface::objectModelTable[] =
 	{ "type",				OBJECT_MODEL_FUNC_NOSELF("ethernet"),		ObjectModelEntryFlags::none },
 };
 
-constexpr uint8_t W5500Interface::objectModelTableDescriptor[] = { 1, 6 };
+constexpr uint8_t W5500Interface::objectModelTableDescriptor[] = { 1, 8 };
 
 DEFINE_GET_OBJECT_MODEL_TABLE(W5500Interface)
 
@@ -69,6 +71,7 @@ void W5500Interface::Init() noexcept
 
 	// Ensure that the W5500 chip is in the reset state
 	pinMode(W5500ResetPin, OUTPUT_LOW);
+	pinMode(W5500IntPin, INPUT_PULLUP);
 	lastTickMillis = millis();
 
 	SetIPAddress(DefaultIpAddress, DefaultNetMask, DefaultGateway);
@@ -345,19 +348,32 @@ void W5500Interface::Spin() noexcept
 					}
 				}
 
-				// Poll the next TCP socket
-				sockets[nextSocketToPoll]->Poll();
+				// Poll the TCP sockets that are busy or have events pending. Sockets that are listening or connected and idle only need to be polled
+				// when the W5500 reports an event for them in SIR. SIMR is set so that the INTn pin is asserted when any TCP socket has an event,
+				// so we only need to read SIR when it is. Poll every socket occasionally as well, in case we miss an event.
+				const uint32_t now = millis();
+				uint8_t socketsWithEvents;
+				if (now - lastFullPollMillis >= W5500FullPollInterval)
+				{
+					lastFullPollMillis = now;
+					socketsWithEvents = 0xFF;
+				}
+				else
+				{
+					socketsWithEvents = (digitalRead(W5500IntPin)) ? 0 : getSIR();
+				}
+
+				for (SocketNumber skt = 0; skt < NumW5500TcpSockets; ++skt)
+				{
+					if ((socketsWithEvents & (1u << skt)) != 0 || !sockets[skt]->IsWaitingForEvent())
+					{
+						sockets[skt]->Poll();
+					}
+				}
 
 				// Keep mDNS alive
 				mdnsSocket->Poll();
 				mdnsResponder->Spin();
-
-				// Move on to the next TCP socket for next time
-				++nextSocketToPoll;
-				if (nextSocketToPoll == NumW5500TcpSockets)
-				{
-					nextSocketToPoll = 0;
-				}
 			}
 			else
 			{
@@ -441,7 +457,8 @@ void W5500Interface::TerminateDataPort() noexcept
 void W5500Interface::InitSockets() noexcept
 {
 	ResetSockets();
-	nextSocketToPoll = 0;
+	lastFullPollMillis = millis();
+	setSIMR((1u << NumW5500TcpSockets) - 1);		// assert INTn when a TCP socket has an event, but not for the mDNS and DHCP sockets which we poll anyway
 
 	mdnsSocket->Init(MdnsSocketNumber, MdnsPort, MdnsProtocol);
 }
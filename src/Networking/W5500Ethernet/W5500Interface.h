@@ -25,6 +25,8 @@ const size_t NumW5500TcpSockets = 6;
 const SocketNumber MdnsSocketNumber = 6;
 const SocketNumber DhcpSocketNumber = 7;
 
+const uint32_t W5500FullPollInterval = 100;			// how often in milliseconds we poll TCP sockets that are waiting for an event, in case we missed one
+
 class Platform;
 
 // The main network class that drives the network.
@@ -80,7 +82,7 @@ private:
 
 	W5500Socket *sockets[NumW5500TcpSockets];
 	size_t ftpDataSocket;							// number of the port for FTP DATA connections
-	size_t nextSocketToPoll;						// next TCP socket number to poll for read/write operations
+	uint32_t lastFullPollMillis;					// when we last polled every TCP socket whether or not it was waiting for an event
 
 	W5500Socket *mdnsSocket;
 	MdnsResponder *mdnsResponder;
@@ -19,7 +19,7 @@
 const unsigned int MaxBuffersPerSocket = 4;
 
 W5500Socket::W5500Socket(NetworkInterface *iface) noexcept
-	: Socket(iface), receivedData(nullptr)
+	: Socket(iface), receivedData(nullptr), waitingForEvent(false)
 {
 }
 
@@ -57,6 +57,7 @@ void W5500Socket::ReInit() noexcept
 	persistConnection = true;
 	isTerminated = false;
 	isSending = false;
+	waitingForEvent = false;
 
 	// Re-initialise the socket on the W5500
 	if (protocol != MdnsProtocol)
@@ -91,6 +92,7 @@ void W5500Socket::Close() noexcept
 			ExecCommand(socketNum, Sn_CR_DISCON);
 		}
 		state = SocketState::closing;
+		waitingForEvent = false;
 		DiscardReceivedData();
 		if (protocol == FtpDataProtocol)
 		{
@@ -109,6 +111,7 @@ void W5500Socket::Terminate() noexcept
 		disconnectNoWait(socketNum);
 		isTerminated = true;
 		state = SocketState::inactive;
+		waitingForEvent = false;
 		DiscardReceivedData();
 	}
 }
@@ -171,14 +174,20 @@ void W5500Socket::Taken(size_t len) noexcept
 	}
 }
 
-// Poll a socket to see if it needs to be serviced
+// Poll a socket to see if it needs to be serviced.
+// If the socket has nothing to do until the W5500 sets an interrupt bit in Sn_IR, set waitingForEvent so that the interface only polls it again when it sees that interrupt.
 void W5500Socket::Poll() noexcept
 {
+	waitingForEvent = false;
 	if (state != SocketState::disabled)
 	{
 		MutexLocker lock(interface->interfaceMutex);
 
-		uint8_t socketStatus = getSn_SR(socketNum);
+		// Sn_IR and Sn_SR are adjacent, so read them both in one SPI transaction
+		uint8_t regs[2];
+		WIZCHIP_READ_BUF(Sn_IR(socketNum), regs, sizeof(regs));
+		const uint8_t socketInterrupts = regs[0];
+		uint8_t socketStatus = regs[1];
 		if (socketStatus == SOCK_CLOSE_WAIT && state == SocketState::listening)
 		{
 			// We get here when only very little data had been transferred before the connection was closed again.
@@ -201,10 +210,11 @@ void W5500Socket::Poll() noexcept
 			break;
 
 		case SOCK_LISTEN:				// Socket is listening but no client has connected to it yet
+			waitingForEvent = (state == SocketState::listening && protocol != MdnsProtocol);		// a connection sets Sn_IR_CON
 			break;
 
 		case SOCK_ESTABLISHED:			// A client is connected to this socket
-			if (getSn_IR(socketNum) & Sn_IR_CON)
+			if (socketInterrupts & Sn_IR_CON)
 			{
 				// New connection, so retrieve the sending IP address and port, and clear the interrupt
 				getSn_DIPR(socketNum, remoteIPAddress);
@@ -232,8 +242,16 @@ void W5500Socket::Poll() noexcept
 
 			if (state == SocketState::connected)
 			{
-				// See if the socket has received any data
-				ReceiveData();
+				// Clear the receive interrupt before we read the data length, so that data that arrives afterwards sets it again.
+				// Clear a send complete interrupt too if we are not waiting for one, otherwise it would keep INTn asserted.
+				const uint8_t interruptsToClear = socketInterrupts & ((isSending) ? Sn_IR_RECV : Sn_IR_RECV | Sn_IR_SENDOK);
+				if (interruptsToClear != 0)
+				{
+					setSn_IR(socketNum, interruptsToClear);
+				}
+
+				// See if the socket has received any data. If it has all been read then we can wait for the next receive or disconnect interrupt.
+				waitingForEvent = !ReceiveData() && protocol != MdnsProtocol;
 			}
 			break;
 
@@ -255,8 +273,8 @@ void W5500Socket::Poll() noexcept
 	}
 }
 
-// Try to receive more incoming data from the socket. The mutex is already owned.
-void W5500Socket::ReceiveData() noexcept
+// Try to receive more incoming data from the socket, returning true if there is data that we couldn't read because we had no buffer for it. The mutex is already owned.
+bool W5500Socket::ReceiveData() noexcept
 {
 	const uint16_t len = getSn_RX_RSR(socketNum);
 	if (len != 0 && len <= NetworkBuffer::bufferSize)
@@ -270,10 +288,12 @@ void W5500Socket::ReceiveData() noexcept
 			wiz_recv_data(socketNum, lastBuffer->UnwrittenData(), len);
 			ExecCommand(socketNum, Sn_CR_RECV);
 			lastBuffer->dataLength += len;
+			interface->RecordBytesReceived(len);
 			if (reprap.Debug(moduleNetwork))
 			{
 				debugPrintf("Appended %u bytes\n", (unsigned int)len);
 			}
+			return false;
 		}
 		else if (NetworkBuffer::Count(receivedData) < MaxBuffersPerSocket)
 		{
@@ -284,14 +304,18 @@ void W5500Socket::ReceiveData() noexcept
 				ExecCommand(socketNum, Sn_CR_RECV);
 				buf->dataLength = (size_t)len;
 				NetworkBuffer::AppendToList(&receivedData, buf);
+				interface->RecordBytesReceived(len);
 				if (reprap.Debug(moduleNetwork))
 				{
 					debugPrintf("Received %u bytes\n", (unsigned int)len);
 				}
+				return false;
 			}
 		}
 //		else debugPrintf("no buffer\n");
+		return true;
 	}
+	return false;
 }
 
 // Discard any received data for this transaction. The mutex is already owned.
@@ -351,6 +375,7 @@ size_t W5500Socket::Send(const uint8_t *data, size_t length) noexcept
 		wizTxBufferLeft -= length;
 		wizTxBufferPtr += length;
 		sendOutstanding = true;
+		interface->RecordBytesSent(length);
 		if (wizTxBufferLeft == 0)
 		{
 			Send();
@@ -31,9 +31,11 @@ public:
 	size_t Send(const uint8_t *data, size_t length) noexcept override;
 	void Send() noexcept override;
 
+	bool IsWaitingForEvent() const noexcept { return waitingForEvent; }
+
 private:
 	void ReInit() noexcept;
-	void ReceiveData() noexcept;
+	bool ReceiveData() noexcept;
 	void DiscardReceivedData() noexcept;
 
 	NetworkBuffer *receivedData;						// List of buffers holding received data
@@ -43,6 +45,7 @@ private:
 	SocketNumber socketNum;								// The W5500 socket number we are using
 	bool sendOutstanding;								// True if we have written data to the socket but not flushed it
 	bool isSending;										// True if we have written data to the W5500 to send and have not yet seen success or timeout
+	bool waitingForEvent;								// True if the last poll found nothing to do that the W5500 won't signal in Sn_IR
 	uint16_t wizTxBufferPtr;							// Current offset into the Wizchip send buffer, if sendOutstanding is true
 	uint16_t wizTxBufferLeft;							// Transmit buffer space left, if sendOutstanding is true
 };
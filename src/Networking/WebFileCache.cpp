@@ -0,0 +1,174 @@
+/*
+ * WebFileCache.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "WebFileCache.h"
+
+#if SUPPORT_WEB_FILE_CACHE
+
+#include "NetworkBuffer.h"
+#include <Platform/RepRap.h>
+#include <Platform/Platform.h>
+#include <Storage/MassStorage.h>
+#include <Storage/FileStore.h>
+
+static_assert(WebFileCacheSlotSize <= NetworkBuffer::bufferSize, "A cached web file must fit in a network buffer");
+static_assert(WebFileCacheDataSlots <= WebFileCacheEntries, "Too many data slots");
+
+// All the functions in this namespace are called only by the Network task, so no locking is needed
+namespace WebFileCache
+{
+	static Entry entries[WebFileCacheEntries];
+	static uint32_t dataSlots[WebFileCacheDataSlots][WebFileCacheSlotSize/sizeof(uint32_t)];
+	static uint32_t useCounter = 0;
+	static unsigned int numHits = 0, numMisses = 0, numNotModified = 0;
+
+	// Return the entry for a file if we have a valid one
+	const Entry *null Find(const char *_ecv_array name) noexcept
+	{
+		const uint16_t volumeSeq = MassStorage::GetVolumeSeq(0);
+		for (Entry& e : entries)
+		{
+			if (e.valid && e.volumeSeq == volumeSeq && e.name.EqualsIgnoreCase(name))
+			{
+				e.whenLastUsed = ++useCounter;
+				++numHits;
+				return &e;
+			}
+		}
+		++numMisses;
+		return nullptr;
+	}
+
+	// Store the details of a file that we have just opened, replacing the least recently used entry.
+	// If the file is small enough then we also store its contents, taking a data slot from the least recently used entry that has one if necessary.
+	const Entry *null Store(const char *_ecv_array name, bool zip, time_t lastModified, FileStore *f) noexcept
+	{
+		const uint16_t volumeSeq = MassStorage::GetVolumeSeq(0);
+		Entry *oldest = &entries[0];
+		for (Entry& e : entries)
+		{
+			if (!e.valid || e.volumeSeq != volumeSeq)
+			{
+				e.valid = false;							// an out-of-date entry is as good as an empty one
+				oldest = &e;
+				break;
+			}
+			if (e.whenLastUsed < oldest->whenLastUsed)
+			{
+				oldest = &e;
+			}
+		}
+
+		if (oldest->name.copy(name))
+		{
+			oldest->valid = false;
+			return nullptr;									// name too long, should not happen because the caller checks it
+		}
+
+		oldest->zip = zip;
+		oldest->size = f->Length();
+		oldest->lastModified = lastModified;
+		oldest->volumeSeq = volumeSeq;
+		oldest->whenLastUsed = ++useCounter;
+		oldest->valid = true;
+
+		if (oldest->size > WebFileCacheSlotSize)
+		{
+			oldest->dataSlot = -1;
+			return oldest;
+		}
+
+		// Find a data slot to hold the file contents. The entry we are replacing may already have one.
+		if (oldest->dataSlot < 0)
+		{
+			bool slotUsed[WebFileCacheDataSlots] = { false };
+			Entry *victim = nullptr;
+			for (Entry& e : entries)
+			{
+				if (e.dataSlot >= 0)
+				{
+					if (!e.valid || e.volumeSeq != volumeSeq)
+					{
+						e.dataSlot = -1;					// the slot held the contents of an out-of-date entry, so free it
+					}
+					else
+					{
+						slotUsed[e.dataSlot] = true;
+						if (victim == nullptr || e.whenLastUsed < victim->whenLastUsed)
+						{
+							victim = &e;
+						}
+					}
+				}
+			}
+
+			for (size_t i = 0; i < WebFileCacheDataSlots; ++i)
+			{
+				if (!slotUsed[i])
+				{
+					oldest->dataSlot = (int8_t)i;
+					break;
+				}
+			}
+
+			if (oldest->dataSlot < 0)
+			{
+				if (victim == nullptr)
+				{
+					return oldest;							// only possible if there are no data slots
+				}
+				oldest->dataSlot = victim->dataSlot;
+				victim->dataSlot = -1;
+			}
+		}
+
+		// Read the file into the slot and leave the file positioned at the start, so that the caller can send it from the file if it needs to
+		const int bytesRead = f->Read(reinterpret_cast<char *>(dataSlots[oldest->dataSlot]), oldest->size);
+		if (bytesRead != (int)oldest->size || !f->Seek(0))
+		{
+			oldest->dataSlot = -1;
+			oldest->valid = false;
+			return nullptr;
+		}
+		return oldest;
+	}
+
+	const uint8_t *_ecv_array GetData(const Entry& entry) noexcept
+	{
+		return reinterpret_cast<const uint8_t *>(dataSlots[entry.dataSlot]);
+	}
+
+	// Record that we were able to tell a client that its copy of a file is up to date
+	void RecordNotModified() noexcept
+	{
+		++numNotModified;
+	}
+
+	void Diagnostics(MessageType mtype) noexcept
+	{
+		unsigned int numValid = 0, numHeld = 0;
+		const uint16_t volumeSeq = MassStorage::GetVolumeSeq(0);
+		for (const Entry& e : entries)
+		{
+			if (e.valid && e.volumeSeq == volumeSeq)
+			{
+				++numValid;
+				if (e.dataSlot >= 0)
+				{
+					++numHeld;
+				}
+			}
+		}
+		reprap.GetPlatform().MessageF(mtype, "Web file cache: %u/%u files known, %u held in RAM, hits %u, misses %u, not modified %u\n",
+										numValid, (unsigned int)WebFileCacheEntries, numHeld, numHits, numMisses, numNotModified);
+		numHits = numMisses = numNotModified = 0;
+	}
+}
+
+#endif
+
+// End
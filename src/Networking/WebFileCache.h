@@ -0,0 +1,43 @@
+/*
+ * WebFileCache.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  This remembers the size and date of the web files that have been requested recently, and holds the contents of the smallest of them in RAM.
+ *  This lets HttpResponder answer conditional requests and return small files without accessing the SD card, which matters when several
+ *  clients reload the web interface during a print. Entries become invalid when the sequence number of volume 0 changes, which happens
+ *  whenever a file is created, deleted or renamed (including at the end of an upload) and when the card is mounted or unmounted.
+ */
+
+#ifndef SRC_NETWORKING_WEBFILECACHE_H_
+#define SRC_NETWORKING_WEBFILECACHE_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_WEB_FILE_CACHE
+
+namespace WebFileCache
+{
+	struct Entry
+	{
+		String<MaxExpectedWebDirFilenameLength> name;		// the name of the file that was requested, relative to the web directory
+		FilePosition size;									// the size of the file that we send, which is the compressed file if zip is true
+		time_t lastModified;
+		uint32_t whenLastUsed;
+		uint16_t volumeSeq;
+		int8_t dataSlot = -1;								// the slot that holds the contents of the file, or -1 if we don't hold them
+		bool zip = false;									// true if we send the .gz version of the file
+		bool valid = false;
+	};
+
+	const Entry *null Find(const char *_ecv_array name) noexcept;
+	const Entry *null Store(const char *_ecv_array name, bool zip, time_t lastModified, FileStore *f) noexcept;	// leaves the file positioned at the start
+	const uint8_t *_ecv_array GetData(const Entry& entry) noexcept pre(entry.dataSlot >= 0);
+	void RecordNotModified() noexcept;
+	void Diagnostics(MessageType mtype) noexcept;
+}
+
+#endif
+
+#endif /* SRC_NETWORKING_WEBFILECACHE_H_ */
@@ -0,0 +1,72 @@
+/*
+ * CborEncoder.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "CborEncoder.h"
+
+// Append the initial byte of a data item and its argument, using the shortest encoding
+void Cbor::AppendHead(OutputBuffer *buf, uint8_t majorType, uint64_t val) noexcept
+{
+	char bytes[9];
+	size_t numBytes;
+	if (val < 24)
+	{
+		bytes[0] = (char)((majorType << 5) | (uint8_t)val);
+		numBytes = 1;
+	}
+	else
+	{
+		const unsigned int argBytes = (val <= 0xFF) ? 1 : (val <= 0xFFFF) ? 2 : (val <= 0xFFFFFFFF) ? 4 : 8;
+		bytes[0] = (char)((majorType << 5) | ((argBytes == 1) ? 24 : (argBytes == 2) ? 25 : (argBytes == 4) ? 26 : 27));
+		for (unsigned int i = 0; i < argBytes; ++i)
+		{
+			bytes[argBytes - i] = (char)(val >> (8 * i));		// big-endian
+		}
+		numBytes = argBytes + 1;
+	}
+	buf->cat(bytes, numBytes);
+}
+
+void Cbor::AppendInt(OutputBuffer *buf, int64_t val) noexcept
+{
+	if (val >= 0)
+	{
+		AppendHead(buf, MajorUnsigned, (uint64_t)val);
+	}
+	else
+	{
+		AppendHead(buf, MajorNegative, (uint64_t)(-(val + 1)));
+	}
+}
+
+// Append a float. Whole numbers are sent as integers because they are shorter, in the same way that JSON reports 0 instead of 0.000.
+// NaNs and infinities are reported as null as they are in JSON.
+void Cbor::AppendFloat(OutputBuffer *buf, float f) noexcept
+{
+	if (std::isnan(f) || std::isinf(f))
+	{
+		AppendNull(buf);
+	}
+	else if (fabsf(f) < 2147483648.0f && f == (float)(int32_t)f)
+	{
+		AppendInt(buf, (int32_t)f);
+	}
+	else
+	{
+		uint32_t bits;
+		memcpy(&bits, &f, sizeof(bits));
+		const char bytes[5] = { (char)0xFA, (char)(bits >> 24), (char)(bits >> 16), (char)(bits >> 8), (char)bits };
+		buf->cat(bytes, sizeof(bytes));
+	}
+}
+
+void Cbor::AppendText(OutputBuffer *buf, const char *_ecv_array s, size_t len) noexcept
+{
+	AppendHead(buf, MajorText, len);
+	buf->cat(s, len);
+}
+
+// End
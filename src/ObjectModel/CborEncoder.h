@@ -0,0 +1,41 @@
+/*
+ * CborEncoder.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  Functions to append values to an OutputBuffer in CBOR format (RFC 8949). These are used when the object model is reported in binary form.
+ *  Maps and arrays whose length is not known in advance are written with indefinite length, so they can be generated in the same order as JSON.
+ */
+
+#ifndef SRC_OBJECTMODEL_CBORENCODER_H_
+#define SRC_OBJECTMODEL_CBORENCODER_H_
+
+#include <RepRapFirmware.h>
+#include <Platform/OutputMemory.h>
+
+namespace Cbor
+{
+	constexpr uint8_t MajorUnsigned = 0;
+	constexpr uint8_t MajorNegative = 1;
+	constexpr uint8_t MajorText = 3;
+	constexpr uint8_t MajorArray = 4;
+	constexpr uint8_t MajorMap = 5;
+
+	void AppendHead(OutputBuffer *buf, uint8_t majorType, uint64_t val) noexcept;
+	void AppendInt(OutputBuffer *buf, int64_t val) noexcept;
+	void AppendFloat(OutputBuffer *buf, float f) noexcept;
+	void AppendText(OutputBuffer *buf, const char *_ecv_array s, size_t len) noexcept;
+
+	inline void AppendUnsigned(OutputBuffer *buf, uint64_t val) noexcept { AppendHead(buf, MajorUnsigned, val); }
+	inline void AppendText(OutputBuffer *buf, const char *_ecv_array s) noexcept { AppendText(buf, s, strlen(s)); }
+	inline void AppendBool(OutputBuffer *buf, bool b) noexcept { buf->cat((char)((b) ? 0xF5 : 0xF4)); }
+	inline void AppendNull(OutputBuffer *buf) noexcept { buf->cat((char)0xF6); }
+	inline void StartArray(OutputBuffer *buf, size_t numElements) noexcept { AppendHead(buf, MajorArray, numElements); }
+	inline void StartIndefiniteArray(OutputBuffer *buf) noexcept { buf->cat((char)0x9F); }
+	inline void StartIndefiniteMap(OutputBuffer *buf) noexcept { buf->cat((char)0xBF); }
+	inline void AppendEmptyMap(OutputBuffer *buf) noexcept { buf->cat((char)0xA0); }
+	inline void AppendBreak(OutputBuffer *buf) noexcept { buf->cat((char)0xFF); }
+}
+
+#endif /* SRC_OBJECTMODEL_CBORENCODER_H_ */
@@ -6,6 +6,7 @@
  */
 
 #include "GlobalVariables.h"
+#include "CborEncoder.h"
 #include <Platform/OutputMemory.h>
 
 // This function is not used in this class
@@ -17,14 +18,29 @@ const ObjectModelClassDescriptor *GlobalVariables::GetObjectModelClassDescriptor
 void GlobalVariables::ReportAsJson(OutputBuffer *buf, ObjectExplorationContext& context, const ObjectModelClassDescriptor * null classDescriptor, uint8_t tableNumber, const char *filter) const noexcept
 		THROWS(GCodeException)
 {
-	buf->cat('{');
+	const bool binary = context.WantBinary();
+	if (binary)
+	{
+		Cbor::StartIndefiniteMap(buf);
+	}
+	else
+	{
+		buf->cat('{');
+	}
 	if (context.IncreaseDepth())
 	{
 		{
 			ReadLocker locker(lock);			// make sure that no other task modifies the list while we are traversing it
-			vars.IterateWhile([this, buf, &context, classDescriptor, filter](unsigned int index, const Variable& v) noexcept -> bool
+			vars.IterateWhile([this, buf, &context, classDescriptor, filter, binary](unsigned int index, const Variable& v) noexcept -> bool
 								{
-									buf->catf((index != 0) ? ",\"%s\":" : "\"%s\":", v.GetName().Ptr());
+									if (binary)
+									{
+										Cbor::AppendText(buf, v.GetName().Ptr());
+									}
+									else
+									{
+										buf->catf((index != 0) ? ",\"%s\":" : "\"%s\":", v.GetName().Ptr());
+									}
 									ReportItemAsJsonFull(buf, context, classDescriptor, v.GetValue(), filter);
 									return true;
 								}
@@ -32,7 +48,14 @@ void GlobalVariables::ReportAsJson(OutputBuffer *buf, ObjectExplorationContext&
 		}
 		context.DecreaseDepth();
 	}
-	buf->cat('}');
+	if (binary)
+	{
+		Cbor::AppendBreak(buf);
+	}
+	else
+	{
+		buf->cat('}');
+	}
 }
 
 ReadLockedPointer<const VariableSet> GlobalVariables::GetForReading() noexcept
@@ -17,6 +17,7 @@
 #include <General/IP4String.h>
 #include <Hardware/ExceptionHandlers.h>
 #include <Hardware/IoPorts.h>
+#include "CborEncoder.h"
 
 namespace StackUsage
 {
@@ -24,6 +25,79 @@ namespace StackUsage
 	constexpr uint32_t GetObjectValue_withTable = 48;
 }
 
+// Functions to write structural elements in either JSON or CBOR format
+static void ReportNull(OutputBuffer *buf, const ObjectExplorationContext& context) noexcept
+{
+	if (context.WantBinary())
+	{
+		Cbor::AppendNull(buf);
+	}
+	else
+	{
+		buf->cat("null");
+	}
+}
+
+static void ReportEmptyObject(OutputBuffer *buf, const ObjectExplorationContext& context) noexcept
+{
+	if (context.WantBinary())
+	{
+		Cbor::AppendEmptyMap(buf);
+	}
+	else
+	{
+		buf->cat("{}");
+	}
+}
+
+static void EndObject(OutputBuffer *buf, const ObjectExplorationContext& context) noexcept
+{
+	if (context.WantBinary())
+	{
+		Cbor::AppendBreak(buf);
+	}
+	else
+	{
+		buf->cat('}');
+	}
+}
+
+static void StartArray(OutputBuffer *buf, const ObjectExplorationContext& context) noexcept
+{
+	if (context.WantBinary())
+	{
+		Cbor::StartIndefiniteArray(buf);
+	}
+	else
+	{
+		buf->cat('[');
+	}
+}
+
+static void EndArray(OutputBuffer *buf, const ObjectExplorationContext& context) noexcept
+{
+	if (context.WantBinary())
+	{
+		Cbor::AppendBreak(buf);
+	}
+	else
+	{
+		buf->cat(']');
+	}
+}
+
+static void ReportUnsigned(OutputBuffer *buf, const ObjectExplorationContext& context, unsigned int val) noexcept
+{
+	if (context.WantBinary())
+	{
+		Cbor::AppendUnsigned(buf, val);
+	}
+	else
+	{
+		buf->catf("%u", val);
+	}
+}
+
 ExpressionValue::ExpressionValue(const MacAddress& mac) noexcept : type((uint32_t)TypeCode::MacAddress_tc), param(mac.HighWord()), uVal(mac.LowWord())
 {
 }
@@ -46,7 +120,17 @@ void ExpressionValue::AppendAsString(const StringRef& str) const noexcept
 		break;
 
 	case TypeCode::Float:
-		str.catf(GetFloatFormatString(), (double)fVal);
+		{
+			char temp[FloatFormatBufferSize];
+			if (FormatFloat(temp, fVal, param) != 0)
+			{
+				str.cat(temp);
+			}
+			else
+			{
+				str.catf(GetFloatFormatString(), (double)fVal);
+			}
+		}
 		break;
 
 	case TypeCode::Uint32:
@@ -324,11 +408,11 @@ ObjectModel::ObjectModel() noexcept
 // Constructor used when reporting the OM as JSON
 ObjectExplorationContext::ObjectExplorationContext(const GCodeBuffer *_ecv_null gbp, bool wal, const char *reportFlags, unsigned int initialMaxDepth, size_t initialBufferOffset) noexcept
 	: startMillis(millis()), initialBufOffset(initialBufferOffset), maxDepth(initialMaxDepth), currentDepth(0), startElement(0), nextElement(-1), numIndicesProvided(0), numIndicesCounted(0),
-	  line(-1), column(-1), gb(gbp),
+	  line(-1), column(-1), gb(gbp), cachePath(nullptr), cachePathHash(0), changedSince(0),
 	  shortForm(false), wantArrayLength(wal), wantExists(false),
 	  includeNonLive(true), includeImportant(false), includeNulls(false),
 	  excludeVerbose(true), excludeObsolete(true),
-	  obsoleteFieldQueried(false)
+	  obsoleteFieldQueried(false), deltaReport(false), binaryFormat(false)
 {
 	while (true)
 	{
@@ -362,6 +446,25 @@ ObjectExplorationContext::ObjectExplorationContext(const GCodeBuffer *_ecv_null
 				++reportFlags;
 			}
 			break;
+		case 'b':
+			binaryFormat = true;
+			break;
+		case 'u':
+			deltaReport = true;
+			changedSince = 0;
+			while (isdigit(*reportFlags))
+			{
+				changedSince = (10 * changedSince) + (*reportFlags - '0');
+				++reportFlags;
+			}
+			break;
+		case 'c':
+			// Only report if changed, handled by RepRap::GetModelResponse
+			while (isdigit(*reportFlags))
+			{
+				++reportFlags;
+			}
+			break;
 		case 'a':
 			startElement = 0;
 			while (isdigit(*reportFlags))
@@ -383,11 +486,11 @@ ObjectExplorationContext::ObjectExplorationContext(const GCodeBuffer *_ecv_null
 // Constructor when evaluating expressions
 ObjectExplorationContext::ObjectExplorationContext(const GCodeBuffer *_ecv_null gbp, bool wal, bool wex, int p_line, int p_col) noexcept
 	: startMillis(millis()), initialBufOffset(0), maxDepth(99), currentDepth(0), startElement(0), nextElement(-1), numIndicesProvided(0), numIndicesCounted(0),
-	  line(p_line), column(p_col), gb(gbp),
+	  line(p_line), column(p_col), gb(gbp), cachePath(nullptr), cachePathHash(0), changedSince(0),
 	  shortForm(false), wantArrayLength(wal), wantExists(wex),
 	  includeNonLive(true), includeImportant(false), includeNulls(false),
 	  excludeVerbose(false), excludeObsolete(false),
-	  obsoleteFieldQueried(false)
+	  obsoleteFieldQueried(false), deltaReport(false), binaryFormat(false)
 {
 }
 
@@ -466,24 +569,48 @@ void ObjectModel::ReportAsJson(OutputBuffer* buf, ObjectExplorationContext& cont
 			const uint8_t * const descriptor = classDescriptor->omd;
 			if (tableNumber < descriptor[0])
 			{
-				const ObjectModelTableEntry *tbl = classDescriptor->omt;
-				for (size_t i = 0; i < tableNumber; ++i)
+				const bool includeNonLive = context.ShouldIncludeNonLive();
+				const auto reportEntry = [this, buf, &context, classDescriptor, filter, includeNonLive, &added](const ObjectModelTableEntry *tbl) noexcept
+					{
+						// In a delta report, only report the live fields of a top-level branch that hasn't changed since the client last saw it
+						if (context.IsDeltaReport() && context.GetCurrentDepth() == 1 && !ChangedSince(tbl->name, context.GetChangedSince()))
+						{
+							context.SetIncludeNonLive(false);
+						}
+						if (tbl->Matches(filter, context))
+						{
+							if (tbl->ReportAsJson(buf, context, classDescriptor, this, filter, !added))
+							{
+								added = true;
+							}
+						}
+						context.SetIncludeNonLive(includeNonLive);
+					};
+
+				if (*filter != 0 && *filter != '*')
 				{
-					tbl += descriptor[i + 1];
+					// The filter names one entry, and the table is sorted, so we can find it by binary search instead of comparing the filter with every entry
+					const ObjectModelTableEntry * const e = FindObjectModelTableEntry(classDescriptor, tableNumber, filter);
+					if (e != nullptr)
+					{
+						reportEntry(e);
+					}
 				}
-
-				size_t numEntries = descriptor[tableNumber + 1];
-				while (numEntries != 0)
+				else
 				{
-					if (tbl->Matches(filter, context))
+					const ObjectModelTableEntry *tbl = classDescriptor->omt;
+					for (size_t i = 0; i < tableNumber; ++i)
 					{
-						if (tbl->ReportAsJson(buf, context, classDescriptor, this, filter, !added))
-						{
-							added = true;
-						}
+						tbl += descriptor[i + 1];
+					}
+
+					size_t numEntries = descriptor[tableNumber + 1];
+					while (numEntries != 0)
+					{
+						reportEntry(tbl);
+						--numEntries;
+						++tbl;
 					}
-					--numEntries;
-					++tbl;
 				}
 			}
 			if (tableNumber != 0)
@@ -497,18 +624,22 @@ void ObjectModel::ReportAsJson(OutputBuffer* buf, ObjectExplorationContext& cont
 		{
 			if (*filter == 0)
 			{
-				buf->cat('}');
+				EndObject(buf, context);
 			}
 		}
+		else if (*filter == 0)
+		{
+			ReportEmptyObject(buf, context);
+		}
 		else
 		{
-			buf->cat((*filter == 0) ? "{}" : "null");
+			ReportNull(buf, context);
 		}
 		context.DecreaseDepth();
 	}
 	else
 	{
-		buf->cat("{}");
+		ReportEmptyObject(buf, context);
 	}
 }
 
@@ -520,8 +651,48 @@ void ObjectModel::ReportAsJson(const GCodeBuffer *_ecv_null gb, OutputBuffer *bu
 	ReportAsJson(buf, context, nullptr, 0, filter);
 	if (context.GetNextElement() >= 0)
 	{
-		buf->catf(",\"next\":%d", context.GetNextElement());
+		if (context.WantBinary())
+		{
+			Cbor::AppendText(buf, "next");
+			Cbor::AppendInt(buf, context.GetNextElement());
+		}
+		else
+		{
+			buf->catf(",\"next\":%d", context.GetNextElement());
+		}
+	}
+}
+
+// Report the first entry of the root object table at or after 'index' that should be reported with the specified flags.
+// The output is the same as the corresponding part of ReportAsJson with an empty filter, so a sequence of calls starting with first = true
+// followed by appending '}' generates the same JSON as a single call to ReportAsJson. We only handle the first table of the root class.
+// On return, 'index' is the index of the next entry to try. Returns true if we reported an entry, false if there were no more entries to report.
+bool ObjectModel::ReportTopLevelEntryAsJson(const GCodeBuffer *_ecv_null gb, OutputBuffer *buf, const char *_ecv_array reportFlags, size_t& index, bool first) const THROWS(GCodeException)
+{
+	ObjectExplorationContext context(gb, false, reportFlags, 1, buf->Length());
+	if (!context.IncreaseDepth())
+	{
+		return false;
+	}
+
+	const ObjectModelClassDescriptor *const classDescriptor = GetObjectModelClassDescriptor();
+	const ObjectModelTableEntry *const tbl = classDescriptor->omt;
+	const size_t numEntries = classDescriptor->omd[1];
+	const bool includeNonLive = context.ShouldIncludeNonLive();
+	while (index < numEntries)
+	{
+		const ObjectModelTableEntry& entry = tbl[index++];
+		if (context.IsDeltaReport() && !ChangedSince(entry.name, context.GetChangedSince()))
+		{
+			context.SetIncludeNonLive(false);
+		}
+		if (entry.Matches("", context) && entry.ReportAsJson(buf, context, classDescriptor, this, "", first))
+		{
+			return true;
+		}
+		context.SetIncludeNonLive(includeNonLive);
 	}
+	return false;
 }
 
 // Function to report a value or object as JSON
@@ -541,7 +712,7 @@ inline void ObjectModel::ReportItemAsJson(OutputBuffer *buf, ObjectExplorationCo
 			|| val.omVal == nullptr					// OM arrays may contain null entries, so we need to handle them here
 		   )
 		{
-			buf->cat("null");
+			ReportNull(buf, context);
 		}
 		else
 		{
@@ -563,28 +734,28 @@ void ObjectModel::ReportArrayLengthAsJson(OutputBuffer *buf, ObjectExplorationCo
 	switch (val.GetType())
 	{
 	case TypeCode::Array:
-		buf->catf("%u", val.omadVal->GetNumElements(this, context));
+		ReportUnsigned(buf, context, val.omadVal->GetNumElements(this, context));
 		break;
 
 	case TypeCode::Bitmap16:
 	case TypeCode::Bitmap32:
-		buf->catf("%u", Bitmap<uint32_t>::MakeFromRaw(val.uVal).CountSetBits());
+		ReportUnsigned(buf, context, Bitmap<uint32_t>::MakeFromRaw(val.uVal).CountSetBits());
 		break;
 
 	case TypeCode::Bitmap64:
-		buf->catf("%u", Bitmap<uint64_t>::MakeFromRaw(val.Get56BitValue()).CountSetBits());
+		ReportUnsigned(buf, context, Bitmap<uint64_t>::MakeFromRaw(val.Get56BitValue()).CountSetBits());
 		break;
 
 	case TypeCode::CString:
-		buf->catf("%u", strlen(val.sVal));
+		ReportUnsigned(buf, context, strlen(val.sVal));
 		break;
 
 	case TypeCode::HeapString:
-		buf->catf("%u", val.shVal.GetLength());
+		ReportUnsigned(buf, context, val.shVal.GetLength());
 		break;
 
 	default:
-		buf->cat("null");
+		ReportNull(buf, context);
 		break;
 	}
 }
@@ -594,6 +765,12 @@ void ObjectModel::ReportArrayLengthAsJson(OutputBuffer *buf, ObjectExplorationCo
 void ObjectModel::ReportItemAsJsonFull(OutputBuffer *buf, ObjectExplorationContext& context, const ObjectModelClassDescriptor *null classDescriptor,
 										const ExpressionValue& val, const char *filter) const THROWS(GCodeException)
 {
+	if (context.WantBinary() && val.GetType() != TypeCode::Array)
+	{
+		ReportItemAsCbor(buf, context, val, filter);
+		return;
+	}
+
 	switch (val.GetType())
 	{
 	case TypeCode::Array:
@@ -610,12 +787,12 @@ void ObjectModel::ReportItemAsJsonFull(OutputBuffer *buf, ObjectExplorationConte
 				const int32_t index = StrToI32(filter, &endptr);
 				if (endptr == filter || *endptr != ']' || index < 0 || (size_t)index >= val.omadVal->GetNumElements(this, context))
 				{
-					buf->cat("null");					// avoid returning badly-formed JSON
+					ReportNull(buf, context);			// avoid returning badly-formed JSON
 					break;								// invalid syntax, or index out of range
 				}
 				if (*filter == 0)
 				{
-					buf->cat('[');
+					StartArray(buf, context);
 				}
 				context.AddIndex(index);
 				{
@@ -627,7 +804,7 @@ void ObjectModel::ReportItemAsJsonFull(OutputBuffer *buf, ObjectExplorationConte
 				context.RemoveIndex();
 				if (*filter == 0)
 				{
-					buf->cat(']');
+					EndArray(buf, context);
 				}
 			}
 		}
@@ -637,7 +814,7 @@ void ObjectModel::ReportItemAsJsonFull(OutputBuffer *buf, ObjectExplorationConte
 		}
 		else
 		{
-			buf->cat("null");
+			ReportNull(buf, context);
 		}
 		break;
 
@@ -831,6 +1008,152 @@ void ObjectModel::ReportPinNameAsJson(OutputBuffer *buf, const ExpressionValue&
 	buf->cat('"');
 }
 
+// Report a value that is not an array or object in CBOR format.
+// This is a separate function that is not recursive, so it may use string buffers on the stack.
+void ObjectModel::ReportItemAsCbor(OutputBuffer *buf, const ObjectExplorationContext& context, const ExpressionValue& val, const char *_ecv_array filter) const noexcept
+{
+	String<StringLength50> str;
+	switch (val.GetType())
+	{
+	case TypeCode::Float:
+		Cbor::AppendFloat(buf, val.fVal);
+		break;
+
+	case TypeCode::Uint32:
+	case TypeCode::Enum32:
+		Cbor::AppendUnsigned(buf, val.uVal);
+		break;
+
+	case TypeCode::Uint64:
+		Cbor::AppendUnsigned(buf, val.Get56BitValue());
+		break;
+
+	case TypeCode::Int32:
+		Cbor::AppendInt(buf, val.iVal);
+		break;
+
+	case TypeCode::CString:
+		Cbor::AppendText(buf, val.sVal);
+		break;
+
+	case TypeCode::HeapString:
+		Cbor::AppendText(buf, val.shVal.Get().Ptr(), val.shVal.GetLength());
+		break;
+
+#if SUPPORT_CAN_EXPANSION
+	case TypeCode::CanExpansionBoardDetails:
+		val.ExtractRequestedPart(str.GetRef());
+		Cbor::AppendText(buf, str.c_str());
+		break;
+#endif
+
+	case TypeCode::Bitmap16:
+	case TypeCode::Bitmap32:
+	case TypeCode::Bitmap64:
+		{
+			const auto bm = Bitmap<uint64_t>::MakeFromRaw((val.GetType() == TypeCode::Bitmap64) ? val.Get56BitValue() : val.uVal);
+			if (*filter == '[' && filter[1] != ']')
+			{
+				++filter;
+				const char *endptr;
+				const int32_t index = StrToI32(filter, &endptr);
+				int bitNumber;
+				if (endptr == filter || *endptr != ']' || index < 0 || (bitNumber = bm.GetSetBitNumber(index)) < 0)
+				{
+					Cbor::AppendNull(buf);
+				}
+				else
+				{
+					Cbor::AppendUnsigned(buf, bitNumber);
+				}
+			}
+			else if (*filter != '[' && context.ShortFormReport())
+			{
+				Cbor::AppendUnsigned(buf, bm.GetRaw());
+			}
+			else
+			{
+				Cbor::StartArray(buf, bm.CountSetBits());
+				bm.Iterate([buf](unsigned int bn, unsigned int) noexcept { Cbor::AppendUnsigned(buf, bn); });
+			}
+		}
+		break;
+
+	case TypeCode::Bool:
+		Cbor::AppendBool(buf, val.bVal);
+		break;
+
+	case TypeCode::Char:
+		Cbor::AppendText(buf, &val.cVal, 1);
+		break;
+
+	case TypeCode::IPAddress_tc:
+		{
+			const IPAddress ipVal(val.uVal);
+			str.printf("%u.%u.%u.%u", ipVal.GetQuad(0), ipVal.GetQuad(1), ipVal.GetQuad(2), ipVal.GetQuad(3));
+			Cbor::AppendText(buf, str.c_str());
+		}
+		break;
+
+	case TypeCode::DateTime_tc:
+		{
+			const time_t time = val.Get56BitValue();
+			tm timeInfo;
+			gmtime_r(&time, &timeInfo);
+			str.printf("%04u-%02u-%02uT%02u:%02u:%02u",
+						timeInfo.tm_year + 1900, timeInfo.tm_mon + 1, timeInfo.tm_mday, timeInfo.tm_hour, timeInfo.tm_min, timeInfo.tm_sec);
+			Cbor::AppendText(buf, str.c_str());
+		}
+		break;
+
+	case TypeCode::DriverId_tc:
+#if SUPPORT_CAN_EXPANSION
+		str.printf("%u.%u", (unsigned int)val.param, (unsigned int)val.uVal);
+#else
+		str.printf("%u", (unsigned int)val.uVal);
+#endif
+		Cbor::AppendText(buf, str.c_str());
+		break;
+
+	case TypeCode::MacAddress_tc:
+		str.printf("%02x:%02x:%02x:%02x:%02x:%02x",
+					(unsigned int)(val.uVal & 0xFF), (unsigned int)((val.uVal >> 8) & 0xFF), (unsigned int)((val.uVal >> 16) & 0xFF), (unsigned int)((val.uVal >> 24) & 0xFF),
+					(unsigned int)(val.param & 0xFF), (unsigned int)((val.param >> 8) & 0xFF));
+		Cbor::AppendText(buf, str.c_str());
+		break;
+
+	case TypeCode::Special:
+#if HAS_MASS_STORAGE || HAS_EMBEDDED_FILES || HAS_SBC_INTERFACE
+		switch ((ExpressionValue::SpecialType)val.param)
+		{
+		case ExpressionValue::SpecialType::sysDir:
+			Cbor::AppendText(buf, reprap.GetPlatform().GetSysDir().Ptr());
+			break;
+		}
+#else
+		Cbor::AppendNull(buf);
+#endif
+		break;
+
+	case TypeCode::Port:
+		val.iopVal->AppendPinName(str.GetRef());
+		Cbor::AppendText(buf, str.c_str());
+		break;
+
+	case TypeCode::UniqueId_tc:
+		val.uniqueIdVal->AppendCharsToString(str.GetRef());
+		Cbor::AppendText(buf, str.c_str());
+		break;
+
+	case TypeCode::None:
+	case TypeCode::Array:
+	case TypeCode::ObjectModel_tc:
+	default:
+		Cbor::AppendNull(buf);
+		break;
+	}
+}
+
 // Report an entire array as JSON
 void ObjectModel::ReportArrayAsJson(OutputBuffer *buf, ObjectExplorationContext& context, const ObjectModelClassDescriptor *null classDescriptor,
 										const ObjectModelArrayDescriptor *omad, const char *_ecv_array filter) const THROWS(GCodeException)
@@ -838,32 +1161,47 @@ void ObjectModel::ReportArrayAsJson(OutputBuffer *buf, ObjectExplorationContext&
 	const bool isRootArray = (buf->Length() == context.GetInitialBufferOffset());		// it's a root array if we haven't started writing to the buffer yet
 	ReadLocker lock(omad->lockPointer);
 
-	buf->cat('[');
+	StartArray(buf, context);
 	const size_t count = omad->GetNumElements(this, context);
 	const size_t startElement = (isRootArray) ? context.GetStartElement() : 0;
+	size_t maxElementLength = 0;
 	for (size_t i = startElement; i < count; ++i)
 	{
-		// Support retrieving just part of the array in case it is too large to write all of it to the buffer
+		// Support retrieving just part of the array in case it is too large to write all of it to the buffer.
+		// The client retrieves the rest by repeating the request with flag 'a' set to the 'next' value in the response.
+		// We stop when we have used half the buffer space, or when the buffers left might not hold two more elements as long as the longest one so far,
+		// so that a page of large elements doesn't overflow when other clients are holding buffers too.
 		if (i != startElement)
 		{
-			if (isRootArray && buf->Length() >= (OUTPUT_BUFFER_SIZE * (OUTPUT_BUFFER_COUNT - RESERVED_OUTPUT_BUFFERS))/2)
+			if (isRootArray
+				&& (   buf->Length() >= (OUTPUT_BUFFER_SIZE * (OUTPUT_BUFFER_COUNT - RESERVED_OUTPUT_BUFFERS))/2
+					|| OutputBuffer::GetBytesLeft(buf) < 2 * maxElementLength + ObjectModelPageReserveBytes
+				   )
+			   )
 			{
-				// We've used half the buffer space already, so stop reporting
 				context.SetNextElement(i);
 				break;
 			}
-			buf->cat(',');
+			if (!context.WantBinary())
+			{
+				buf->cat(',');
+			}
 		}
+		const size_t lengthBefore = (isRootArray) ? buf->Length() : 0;
 		context.AddIndex(i);
 		const ExpressionValue element = omad->GetElement(this, context);
 		ReportItemAsJson(buf, context, classDescriptor, element, filter);
 		context.RemoveIndex();
+		if (isRootArray)
+		{
+			maxElementLength = max<size_t>(maxElementLength, buf->Length() - lengthBefore);
+		}
 	}
 	if (isRootArray && context.GetNextElement() < 0)
 	{
 		context.SetNextElement(0);
 	}
-	buf->cat(']');
+	EndArray(buf, context);
 }
 
 // Find the requested entry
@@ -907,6 +1245,87 @@ const ObjectModelTableEntry* ObjectModel::FindObjectModelTableEntry(const Object
 	return nullptr;
 }
 
+// Cache of resolved table entries. Each slot records the table entry that was found for one element of a path, given the class descriptor and table number
+// that the search started from. Class descriptors and table entries are in flash memory and never change, and array indices are not part of the element,
+// so a slot never becomes stale. A hit is confirmed by comparing the element with the name of the entry, so a hash collision can only cause a miss.
+// Object model lookups are only done by the Main task, so the cache needs no lock.
+namespace ResolvedEntryCache
+{
+	struct Slot
+	{
+		const ObjectModelClassDescriptor *classDescriptor;	// the class descriptor that the search started from
+		const ObjectModelClassDescriptor *foundIn;			// the class descriptor whose table contains the entry
+		const ObjectModelTableEntry *entry;
+		uint32_t pathHash;
+		uint16_t offset;									// the offset of the element from the start of the path
+		uint8_t tableNumber;
+	};
+
+	static_assert((ObjectModelPathCacheEntries & (ObjectModelPathCacheEntries - 1)) == 0, "ObjectModelPathCacheEntries must be a power of 2");
+
+	static Slot slots[ObjectModelPathCacheEntries];
+	static unsigned int numHits = 0, numMisses = 0;
+
+	static inline Slot& GetSlot(const ObjectModelClassDescriptor *classDescriptor, uint8_t tableNumber, uint32_t pathHash, size_t offset) noexcept
+	{
+		const uint32_t h = (pathHash + (uint32_t)offset * 16777619u) ^ ((uint32_t)reinterpret_cast<uintptr_t>(classDescriptor) >> 2) ^ tableNumber;
+		return slots[(h ^ (h >> 16)) & (ObjectModelPathCacheEntries - 1)];
+	}
+}
+
+// Find the requested entry, searching the parent classes too if the table number is 0, and using the cache if the caller has identified the path.
+// On return, classDescriptor is set to the descriptor of the class whose table contains the entry.
+const ObjectModelTableEntry* ObjectModel::FindObjectModelTableEntryCached(ObjectExplorationContext& context, const ObjectModelClassDescriptor *& classDescriptor, uint8_t tableNumber, const char *_ecv_array idString) const noexcept
+{
+	using namespace ResolvedEntryCache;
+
+	const char *_ecv_array null const path = context.GetCachePath();
+	Slot *slot = nullptr;
+	if (path != nullptr && idString[0] != 0 && idString[0] != '*')
+	{
+		const size_t offset = idString - path;
+		slot = &GetSlot(classDescriptor, tableNumber, context.GetCachePathHash(), offset);
+		if (   slot->entry != nullptr && slot->classDescriptor == classDescriptor && slot->tableNumber == tableNumber
+			&& slot->pathHash == context.GetCachePathHash() && slot->offset == offset && slot->entry->IdCompare(idString) == 0
+		   )
+		{
+			++numHits;
+			classDescriptor = slot->foundIn;
+			return slot->entry;
+		}
+		++numMisses;
+	}
+
+	const ObjectModelClassDescriptor *cd = classDescriptor;
+	do
+	{
+		const ObjectModelTableEntry * const e = FindObjectModelTableEntry(cd, tableNumber, idString);
+		if (e != nullptr)
+		{
+			if (slot != nullptr)
+			{
+				slot->classDescriptor = classDescriptor;
+				slot->foundIn = cd;
+				slot->entry = e;
+				slot->pathHash = context.GetCachePathHash();
+				slot->offset = (uint16_t)(idString - path);
+				slot->tableNumber = tableNumber;
+			}
+			classDescriptor = cd;
+			return e;
+		}
+		cd = cd->parent;								// search parent class object model too
+	} while (cd != nullptr && tableNumber == 0);
+	return nullptr;
+}
+
+/*static*/ void ObjectModel::ResolvedEntryCacheDiagnostics(MessageType mtype) noexcept
+{
+	reprap.GetPlatform().MessageF(mtype, "Object model path cache: %u entries, hits %u, misses %u\n",
+									(unsigned int)ObjectModelPathCacheEntries, ResolvedEntryCache::numHits, ResolvedEntryCache::numMisses);
+	ResolvedEntryCache::numHits = ResolvedEntryCache::numMisses = 0;
+}
+
 /*static*/ const char* ObjectModel::GetNextElement(const char *id) noexcept
 {
 	while (*id != 0 && *id != '.' && *id != '[' && *id != '^')
@@ -930,7 +1349,19 @@ bool ObjectModelTableEntry::ReportAsJson(OutputBuffer* buf, ObjectExplorationCon
 	// The latter is so that field state.messageBox gets reported to PanelDue even if null when the "important" flag is set, so that PanelDue knows when a message has been cleared.
 	if (val.GetType() != TypeCode::None || context.ShouldIncludeNulls() || (context.ShouldIncludeImportant() && ((uint8_t)flags & (uint8_t)ObjectModelEntryFlags::important)))
 	{
-		if (*filter == 0)
+		if (*filter != 0)
+		{
+			// Nothing to do because we are only reporting the value
+		}
+		else if (context.WantBinary())
+		{
+			if (first)
+			{
+				Cbor::StartIndefiniteMap(buf);
+			}
+			Cbor::AppendText(buf, name);
+		}
+		else
 		{
 			buf->cat((first) ? "{\"" : ",\"");
 			buf->cat(name);
@@ -970,9 +1401,9 @@ decrease(strlen(idString))	// recursion variant
 		classDescriptor = GetObjectModelClassDescriptor();
 	}
 
-	while (classDescriptor != nullptr)
+	if (classDescriptor != nullptr)
 	{
-		const ObjectModelTableEntry * const e = FindObjectModelTableEntry(classDescriptor, tableNumber, idString);
+		const ObjectModelTableEntry * const e = FindObjectModelTableEntryCached(context, classDescriptor, tableNumber, idString);
 		if (e != nullptr)
 		{
 			if (e->IsObsolete())
@@ -984,11 +1415,6 @@ decrease(strlen(idString))	// recursion variant
 			context.CheckStack(StackUsage::GetObjectValue_noTable);
 			return GetObjectValue(context, classDescriptor, val, idString);
 		}
-		if (tableNumber != 0)
-		{
-			break;
-		}
-		classDescriptor = classDescriptor->parent;			// search parent class object model too
 	}
 
 	if (context.WantExists())
@@ -1223,7 +1649,16 @@ void ObjectModel::ReportFloat(OutputBuffer *buf, const ExpressionValue& val) noe
 	}
 	else
 	{
-		buf->catf(val.GetFloatFormatString(), (double)val.fVal);
+		char temp[FloatFormatBufferSize];
+		const size_t len = FormatFloat(temp, val.fVal, val.param);
+		if (len != 0)
+		{
+			buf->cat(temp, len);
+		}
+		else
+		{
+			buf->catf(val.GetFloatFormatString(), (double)val.fVal);
+		}
 	}
 }
 
@@ -237,12 +237,23 @@ public:
 	bool WantExists() const noexcept { return wantExists; }
 	bool ShouldIncludeNulls() const noexcept { return includeNulls; }
 	bool ShouldIncludeImportant() const noexcept { return includeImportant; }
+	bool ShouldIncludeNonLive() const noexcept { return includeNonLive; }
+	void SetIncludeNonLive(bool b) noexcept { includeNonLive = b; }
+	bool IsDeltaReport() const noexcept { return deltaReport; }
+	bool WantBinary() const noexcept { return binaryFormat; }
+	uint32_t GetChangedSince() const noexcept { return changedSince; }
+	unsigned int GetCurrentDepth() const noexcept { return currentDepth; }
 	uint64_t GetStartMillis() const { return startMillis; }
 	size_t GetInitialBufferOffset() const noexcept { return initialBufOffset; }
 
 	bool ObsoleteFieldQueried() const noexcept { return obsoleteFieldQueried; }
 	void SetObsoleteFieldQueried() noexcept { obsoleteFieldQueried = true; }
 
+	// Identify the full path being looked up so that the table entries found can be cached
+	void SetCachePath(const char *_ecv_array path, uint32_t hash) noexcept { cachePath = path; cachePathHash = hash; }
+	const char *_ecv_array null GetCachePath() const noexcept { return cachePath; }
+	uint32_t GetCachePathHash() const noexcept { return cachePathHash; }
+
 	GCodeException ConstructParseException(const char *msg) const noexcept;
 	GCodeException ConstructParseException(const char *msg, const char *sparam) const noexcept;
 	void CheckStack(uint32_t calledFunctionStackUsage) const THROWS(GCodeException);
@@ -262,6 +273,9 @@ private:
 	int line;
 	int column;
 	const GCodeBuffer *_ecv_null gb;
+	const char *_ecv_array null cachePath;			// the start of the path being looked up, or null if lookups should not be cached
+	uint32_t cachePathHash;
+	uint32_t changedSince;							// in a delta report, the value of the model change counter that the client last saw
 	unsigned int shortForm : 1,
 				wantArrayLength : 1,
 				wantExists : 1,
@@ -270,7 +284,9 @@ private:
 				includeNulls : 1,
 				excludeVerbose : 1,
 				excludeObsolete : 1,
-				obsoleteFieldQueried : 1;
+				obsoleteFieldQueried : 1,
+				deltaReport : 1,
+				binaryFormat : 1;						// report in CBOR format instead of JSON
 };
 
 // Entry to describe an array of objects or values. These must be brace-initializable into flash memory.
@@ -294,6 +310,9 @@ public:
 	// Construct a JSON representation of those parts of the object model requested by the user. This version is called only on the root of the tree.
 	void ReportAsJson(const GCodeBuffer *_ecv_null gb, OutputBuffer *buf, const char *_ecv_array filter, const char *_ecv_array reportFlags, bool wantArrayLength) const THROWS(GCodeException);
 
+	// Construct a JSON representation of the next top-level entry of the root object that should be reported, so that the whole object can be reported in parts
+	bool ReportTopLevelEntryAsJson(const GCodeBuffer *_ecv_null gb, OutputBuffer *buf, const char *_ecv_array reportFlags, size_t& index, bool first) const THROWS(GCodeException);
+
 	// Get the value of an object via the table
 	ExpressionValue GetObjectValueUsingTableNumber(ObjectExplorationContext& context, const ObjectModelClassDescriptor * null classDescriptor, const char *_ecv_array idString, uint8_t tableNumber) const THROWS(GCodeException);
 
@@ -304,6 +323,9 @@ public:
 	// Skip the current element in the ID or filter string
 	static const char* GetNextElement(const char *id) noexcept;
 
+	// Report the statistics of the cache of resolved table entries
+	static void ResolvedEntryCacheDiagnostics(MessageType mtype) noexcept;
+
 protected:
 	// Construct a JSON representation of those parts of the object model requested by the user
 	// Overridden in class GlobalVariables
@@ -318,8 +340,14 @@ protected:
 	// Get the object model table entry for the current level object in the query
 	const ObjectModelTableEntry *FindObjectModelTableEntry(const ObjectModelClassDescriptor *classDescriptor, uint8_t tableNumber, const char *_ecv_array idString) const noexcept;
 
+	// Get the table entry for the current level object in the query, searching parent classes too, using the cache of resolved entries if possible
+	const ObjectModelTableEntry *FindObjectModelTableEntryCached(ObjectExplorationContext& context, const ObjectModelClassDescriptor *& classDescriptor, uint8_t tableNumber, const char *_ecv_array idString) const noexcept;
+
 	virtual const ObjectModelClassDescriptor *GetObjectModelClassDescriptor() const noexcept = 0;
 
+	// Return true if a top-level branch may have changed since the specified value of the model change counter. Only the root object overrides this.
+	virtual bool ChangedSince(const char *_ecv_array key, uint32_t changeCount) const noexcept { return true; }
+
 	__attribute__ ((noinline)) void ReportItemAsJsonFull(OutputBuffer *buf, ObjectExplorationContext& context, const ObjectModelClassDescriptor *null classDescriptor,
 															const ExpressionValue& val, const char *filter) const THROWS(GCodeException);
 private:
@@ -330,6 +358,7 @@ private:
 	__attribute__ ((noinline)) static void ReportBitmap1632Long(OutputBuffer *buf, const ExpressionValue& val) noexcept;
 	__attribute__ ((noinline)) static void ReportBitmap64Long(OutputBuffer *buf, const ExpressionValue& val) noexcept;
 	__attribute__ ((noinline)) static void ReportPinNameAsJson(OutputBuffer *buf, const ExpressionValue& val) noexcept;
+	__attribute__ ((noinline)) void ReportItemAsCbor(OutputBuffer *buf, const ObjectExplorationContext& context, const ExpressionValue& val, const char *_ecv_array filter) const noexcept;
 
 #if SUPPORT_CAN_EXPANSION
 	__attribute__ ((noinline)) static void ReportExpansionBoardDetail(OutputBuffer *buf, const ExpressionValue& val) noexcept;
@@ -8,8 +8,9 @@
 #include "Variable.h"
 #include <Platform/OutputMemory.h>
 
-Variable::Variable(const char *str, ExpressionValue pVal, int8_t pScope) noexcept : name(str), val(pVal), scope(pScope)
+Variable::Variable(const char *str, ExpressionValue pVal, int8_t pScope) noexcept : val(pVal), scope(pScope)
 {
+	name.AssignInterned(str);				// macros often create variables with the same names as ones that already exist, so share the storage
 }
 
 Variable::~Variable()
@@ -18,38 +19,114 @@ Variable::~Variable()
 	val.Release();
 }
 
-Variable* VariableSet::Lookup(const char *str) noexcept
+// Return the FNV-1a hash of a variable name
+/*static*/ uint32_t VariableSet::HashName(const char *str) noexcept
 {
-	LinkedVariable *lv;
-	for (lv = root; lv != nullptr; lv = lv->next)
+	uint32_t hash = 2166136261u;
+	while (*str != 0)
 	{
-		auto vname = lv->v.GetName();
-		if (strcmp(vname.Ptr(), str) == 0)
-		{
-			return &(lv->v);
-		}
+		hash = (hash ^ (uint8_t)*str++) * 16777619u;
 	}
-	return nullptr;
+	return hash;
 }
 
-const Variable* VariableSet::Lookup(const char *str) const noexcept
+// Find a variable, returning null if it doesn't exist. If there are several with the same name, return the most recently created one.
+VariableSet::LinkedVariable *VariableSet::Find(const char *str) const noexcept
 {
-	const LinkedVariable *lv;
-	for (lv = root; lv != nullptr; lv = lv->next)
+	const uint32_t hash = HashName(str);
+	if (index != nullptr)
+	{
+		for (LinkedVariable *lv = index[hash & (NumIndexBuckets - 1)]; lv != nullptr; lv = lv->nextInBucket)
+		{
+			if (lv->hash == hash && strcmp(lv->v.GetName().Ptr(), str) == 0)
+			{
+				return lv;
+			}
+		}
+	}
+	else
 	{
-		auto vname = lv->v.GetName();
-		if (strcmp(vname.Ptr(), str) == 0)
+		for (LinkedVariable *lv = root; lv != nullptr; lv = lv->next)
 		{
-			return &(lv->v);
+			if (lv->hash == hash && strcmp(lv->v.GetName().Ptr(), str) == 0)
+			{
+				return lv;
+			}
 		}
 	}
 	return nullptr;
 }
 
+Variable* VariableSet::Lookup(const char *str) noexcept
+{
+	LinkedVariable * const lv = Find(str);
+	return (lv == nullptr) ? nullptr : &(lv->v);
+}
+
+const Variable* VariableSet::Lookup(const char *str) const noexcept
+{
+	const LinkedVariable * const lv = Find(str);
+	return (lv == nullptr) ? nullptr : &(lv->v);
+}
+
 void VariableSet::InsertNew(const char *str, ExpressionValue pVal, int8_t pScope) noexcept
 {
-	LinkedVariable * const toInsert = new LinkedVariable(str, pVal, pScope, root);
+	LinkedVariable * const toInsert = new LinkedVariable(str, HashName(str), pVal, pScope, root);
 	root = toInsert;
+	++numVariables;
+	if (index != nullptr)
+	{
+		// Add it to the head of its bucket, so that it is found before any older variable with the same name, as when we search the list
+		LinkedVariable *& bucket = index[toInsert->hash & (NumIndexBuckets - 1)];
+		toInsert->nextInBucket = bucket;
+		bucket = toInsert;
+	}
+	else if (numVariables > IndexThreshold)
+	{
+		BuildIndex();
+	}
+}
+
+// Create the index. Variables are added to the end of each bucket in list order, so buckets are also ordered most recent first.
+void VariableSet::BuildIndex() noexcept
+{
+	index = new LinkedVariable*[NumIndexBuckets];
+	for (size_t i = 0; i < NumIndexBuckets; ++i)
+	{
+		index[i] = nullptr;
+	}
+	for (LinkedVariable *lv = root; lv != nullptr; lv = lv->next)
+	{
+		AddToIndex(lv);
+	}
+}
+
+// Add a variable to the end of its bucket
+void VariableSet::AddToIndex(LinkedVariable *lv) noexcept
+{
+	LinkedVariable **pp = &index[lv->hash & (NumIndexBuckets - 1)];
+	while (*pp != nullptr)
+	{
+		pp = &((*pp)->nextInBucket);
+	}
+	lv->nextInBucket = nullptr;
+	*pp = lv;
+}
+
+// Remove a variable from the index, if we have one
+void VariableSet::RemoveFromIndex(const LinkedVariable *lv) noexcept
+{
+	if (index != nullptr)
+	{
+		for (LinkedVariable **pp = &index[lv->hash & (NumIndexBuckets - 1)]; *pp != nullptr; pp = &((*pp)->nextInBucket))
+		{
+			if (*pp == lv)
+			{
+				*pp = lv->nextInBucket;
+				break;
+			}
+		}
+	}
 }
 
 // Remove all variables with a scope greater than the parameter
@@ -70,6 +147,8 @@ void VariableSet::EndScope(uint8_t blockNesting) noexcept
 			{
 				prev->next = lv;
 			}
+			RemoveFromIndex(temp);
+			--numVariables;
 			delete temp;
 		}
 		else
@@ -82,24 +161,29 @@ void VariableSet::EndScope(uint8_t blockNesting) noexcept
 
 void VariableSet::Delete(const char *str) noexcept
 {
-	LinkedVariable *prev = nullptr;
-	for (LinkedVariable *lv = root; lv != nullptr; lv = lv->next)
+	LinkedVariable * const toDelete = Find(str);
+	if (toDelete != nullptr)
 	{
-		auto vname = lv->v.GetName();
-		if (strcmp(vname.Ptr(), str) == 0)
+		LinkedVariable *prev = nullptr;
+		for (LinkedVariable *lv = root; lv != nullptr; lv = lv->next)
 		{
-			if (prev == nullptr)
-			{
-				root = lv->next;
-			}
-			else
+			if (lv == toDelete)
 			{
-				prev->next = lv->next;
+				if (prev == nullptr)
+				{
+					root = lv->next;
+				}
+				else
+				{
+					prev->next = lv->next;
+				}
+				RemoveFromIndex(lv);
+				--numVariables;
+				delete lv;
+				break;
 			}
-			delete lv;
-			break;
+			prev = lv;
 		}
-		prev = lv;
 	}
 }
 
@@ -111,6 +195,9 @@ void VariableSet::Clear() noexcept
 		root = lv->next;
 		delete lv;
 	}
+	delete[] index;
+	index = nullptr;
+	numVariables = 0;
 }
 
 VariableSet::~VariableSet()
@@ -123,7 +210,11 @@ void VariableSet::AssignFrom(VariableSet& other) noexcept
 {
 	Clear();
 	root = other.root;
+	index = other.index;
+	numVariables = other.numVariables;
 	other.root = nullptr;
+	other.index = nullptr;
+	other.numVariables = 0;
 }
 
 void VariableSet::IterateWhile(function_ref<bool(unsigned int, const Variable&) /*noexcept*/ > func) const noexcept
@@ -33,11 +33,13 @@ private:
 };
 
 // Class to represent a collection of variables.
-// For now this is just a linked list, but it could be changed to a hash table for faster lookup and insertion.
+// The variables are kept in a linked list, most recently created first, which defines the order in which they are iterated.
+// Each variable stores a hash of its name so that lookups rarely need to compare names. When the set grows beyond IndexThreshold variables
+// we also allocate an index of hash buckets, so that lookups in large sets such as the global variables don't need to walk the whole list.
 class VariableSet
 {
 public:
-	VariableSet() noexcept : root(nullptr) { }
+	VariableSet() noexcept : root(nullptr), index(nullptr), numVariables(0) { }
 	~VariableSet();
 	VariableSet(const VariableSet&) = delete;
 	VariableSet& operator=(const VariableSet& other) = delete;
@@ -55,17 +57,31 @@ public:
 	void IterateWhile(function_ref<bool(unsigned int index, const Variable& v) /*noexcept*/ > func) const noexcept;
 
 private:
+	static constexpr size_t IndexThreshold = 8;				// we create an index when there are more than this number of variables
+	static constexpr size_t NumIndexBuckets = 32;			// must be a power of 2
+
 	struct LinkedVariable
 	{
 		DECLARE_FREELIST_NEW_DELETE(LinkedVariable)
 
-		LinkedVariable(const char *_ecv_array str, ExpressionValue pVal, int8_t pScope, LinkedVariable *p_next) : next(p_next), v(str, pVal, pScope) {}
+		LinkedVariable(const char *_ecv_array str, uint32_t p_hash, ExpressionValue pVal, int8_t pScope, LinkedVariable *p_next)
+			: next(p_next), nextInBucket(nullptr), hash(p_hash), v(str, pVal, pScope) {}
 
 		LinkedVariable * null next;
+		LinkedVariable * null nextInBucket;
+		uint32_t hash;
 		Variable v;
 	};
 
+	static uint32_t HashName(const char *_ecv_array str) noexcept;
+	LinkedVariable * null Find(const char *_ecv_array str) const noexcept;
+	void BuildIndex() noexcept;
+	void AddToIndex(LinkedVariable *lv) noexcept;
+	void RemoveFromIndex(const LinkedVariable *lv) noexcept;
+
 	LinkedVariable * null root;
+	LinkedVariable * null * null index;						// array of NumIndexBuckets bucket heads, or null if we haven't created the index
+	size_t numVariables;
 };
 
 #endif /* SRC_GCODES_VARIABLE_H_ */
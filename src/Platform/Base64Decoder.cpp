@@ -0,0 +1,59 @@
+/*
+ * Base64Decoder.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "Base64Decoder.h"
+#include "OutputMemory.h"
+
+void Base64Decoder::Add(char c) noexcept
+{
+	uint32_t val;
+	if (c >= 'A' && c <= 'Z')
+	{
+		val = c - 'A';
+	}
+	else if (c >= 'a' && c <= 'z')
+	{
+		val = c - 'a' + 26;
+	}
+	else if (c >= '0' && c <= '9')
+	{
+		val = c - '0' + 52;
+	}
+	else if (c == '+')
+	{
+		val = 62;
+	}
+	else if (c == '/')
+	{
+		val = 63;
+	}
+	else
+	{
+		return;
+	}
+
+	// Each character gives 6 bits, so we have a complete byte whenever we have accumulated 8 or more. Any bits left over at the end are padding.
+	pending = (pending << 6) | val;
+	numBits += 6;
+	if (numBits >= 8)
+	{
+		numBits -= 8;
+		buf->cat((char)(pending >> numBits));
+		pending &= (1u << numBits) - 1;
+	}
+}
+
+void Base64Decoder::Add(const char *_ecv_array s, size_t len) noexcept
+{
+	while (len != 0)
+	{
+		Add(*s++);
+		--len;
+	}
+}
+
+// End
@@ -0,0 +1,30 @@
+/*
+ * Base64Decoder.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  Class to decode base64 text into binary data in an output buffer. This is used to send thumbnails embedded in G-code files as binary image data.
+ *  Characters that are not part of the base64 alphabet, including the '=' padding, are ignored.
+ */
+
+#ifndef SRC_PLATFORM_BASE64DECODER_H_
+#define SRC_PLATFORM_BASE64DECODER_H_
+
+#include <RepRapFirmware.h>
+
+class Base64Decoder
+{
+public:
+	explicit Base64Decoder(OutputBuffer *p_buf) noexcept : buf(p_buf), pending(0), numBits(0) { }
+
+	void Add(char c) noexcept;
+	void Add(const char *_ecv_array s, size_t len) noexcept;
+
+private:
+	OutputBuffer *buf;
+	uint32_t pending;
+	unsigned int numBits;
+};
+
+#endif /* SRC_PLATFORM_BASE64DECODER_H_ */
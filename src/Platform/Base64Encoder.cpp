@@ -0,0 +1,40 @@
+/*
+ * Base64Encoder.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "Base64Encoder.h"
+#include "OutputMemory.h"
+
+void Base64Encoder::Add(uint8_t b) noexcept
+{
+	pending = (pending << 8) | b;
+	++numPending;
+	if (numPending == 3)
+	{
+		buf->cat(Chars[(pending >> 18) & 0x3F]);
+		buf->cat(Chars[(pending >> 12) & 0x3F]);
+		buf->cat(Chars[(pending >> 6) & 0x3F]);
+		buf->cat(Chars[pending & 0x3F]);
+		pending = 0;
+		numPending = 0;
+	}
+}
+
+void Base64Encoder::Flush() noexcept
+{
+	if (numPending != 0)
+	{
+		const uint32_t bits = pending << (8 * (3 - numPending));
+		buf->cat(Chars[(bits >> 18) & 0x3F]);
+		buf->cat(Chars[(bits >> 12) & 0x3F]);
+		buf->cat((numPending == 2) ? Chars[(bits >> 6) & 0x3F] : '=');
+		buf->cat('=');
+		pending = 0;
+		numPending = 0;
+	}
+}
+
+// End
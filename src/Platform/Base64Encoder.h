@@ -0,0 +1,33 @@
+/*
+ * Base64Encoder.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  Class to encode binary data as base64 into an output buffer. This is used to return binary data such as accelerometer samples and trace records in JSON responses.
+ */
+
+#ifndef SRC_PLATFORM_BASE64ENCODER_H_
+#define SRC_PLATFORM_BASE64ENCODER_H_
+
+#include <RepRapFirmware.h>
+
+class Base64Encoder
+{
+public:
+	explicit Base64Encoder(OutputBuffer *p_buf) noexcept : buf(p_buf), pending(0), numPending(0) { }
+
+	void Add(uint8_t b) noexcept;
+	void Add16(uint16_t val) noexcept { Add((uint8_t)val); Add((uint8_t)(val >> 8)); }
+	void Add32(uint32_t val) noexcept { Add16((uint16_t)val); Add16((uint16_t)(val >> 16)); }
+	void Flush() noexcept;
+
+private:
+	static constexpr char Chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	OutputBuffer *buf;
+	uint32_t pending;
+	unsigned int numPending;
+};
+
+#endif /* SRC_PLATFORM_BASE64ENCODER_H_ */
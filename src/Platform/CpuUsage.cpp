@@ -0,0 +1,199 @@
+/*
+ * CpuUsage.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "CpuUsage.h"
+
+#if SUPPORT_CPU_USAGE_STATS
+
+#include "RepRap.h"
+#include "Platform.h"
+#include <GCodes/GCodeBuffer/GCodeBuffer.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <freertos_task_additions.h>
+
+extern "C" uint32_t TaskResetRunTimeCounter() noexcept;		// in Tasks.cpp
+
+namespace CpuUsage
+{
+	volatile uint32_t isrTicks[NumIsrIds] = { 0 };
+
+	struct TaskEntry
+	{
+		const TaskBase *task;
+		uint32_t ticksThisWindow;
+		float lastPercent;									// the CPU % in the last complete window
+		uint16_t freeStack;									// the stack high water mark in words
+		bool seen;											// true if we have found this task in the task list during the current window
+	};
+
+	static TaskEntry entries[MaxCpuUsageTasks];
+	static size_t numEntries = 0;
+	static uint32_t windowSeconds = DefaultCpuUsageWindowSeconds;
+	static uint32_t whenWindowStarted = 0;					// in milliseconds
+	static uint32_t windowTicks = 0;						// the step clocks in the current window so far
+	static uint32_t isrTicksAtWindowStart[NumIsrIds] = { 0 };
+	static float lastIsrPercent[NumIsrIds] = { 0.0 };
+	static uint32_t lastWindowTicks = 0;					// the length of the last complete window, or 0 if there hasn't been one
+
+	static const char *_ecv_array const IsrNames[NumIsrIds] = { "step", "drivers", "network" };
+
+	// Add the run time of each task since this was last called to the current window.
+	// FreeRTOS restarts the run time counter of a task when we read it, and TaskResetRunTimeCounter tells us how long it has been since we last read them.
+	void Sample() noexcept
+	{
+		windowTicks += TaskResetRunTimeCounter();
+		for (const TaskBase *t = TaskBase::GetTaskList(); t != nullptr; t = t->GetNext())
+		{
+			ExtendedTaskStatus_t taskDetails;
+			vTaskGetExtendedInfo(t->GetFreeRTOSHandle(), &taskDetails);
+
+			TaskEntry *e = nullptr;
+			for (size_t i = 0; i < numEntries; ++i)
+			{
+				if (entries[i].task == t)
+				{
+					e = &entries[i];
+					break;
+				}
+			}
+			if (e == nullptr)
+			{
+				if (numEntries == MaxCpuUsageTasks)
+				{
+					continue;								// too many tasks, which should not happen
+				}
+				e = &entries[numEntries];
+				e->task = t;
+				e->ticksThisWindow = 0;
+				e->lastPercent = 0.0;
+				TaskCriticalSectionLocker lock;				// so that the object model doesn't see a partly set up entry
+				++numEntries;
+			}
+			e->ticksThisWindow += taskDetails.ulRunTimeCounter;
+			e->freeStack = taskDetails.usStackHighWaterMark;
+			e->seen = true;
+		}
+	}
+
+	// Calculate the CPU usage figures for the window that has just completed and start a new one
+	static void EndWindow() noexcept
+	{
+		TaskCriticalSectionLocker lock;
+		if (windowTicks != 0)
+		{
+			const float scale = 100.0/(float)windowTicks;
+			size_t numKept = 0;
+			for (size_t i = 0; i < numEntries; ++i)
+			{
+				TaskEntry& e = entries[i];
+				if (e.seen)									// discard tasks that have been deleted
+				{
+					e.lastPercent = (float)e.ticksThisWindow * scale;
+					e.ticksThisWindow = 0;
+					e.seen = false;
+					entries[numKept++] = e;
+				}
+			}
+			numEntries = numKept;
+
+			for (size_t i = 0; i < NumIsrIds; ++i)
+			{
+				const uint32_t now = isrTicks[i];
+				lastIsrPercent[i] = (float)(now - isrTicksAtWindowStart[i]) * scale;
+				isrTicksAtWindowStart[i] = now;
+			}
+			lastWindowTicks = windowTicks;
+		}
+		windowTicks = 0;
+	}
+
+	void Spin() noexcept
+	{
+		const uint32_t now = millis();
+		if (now - whenWindowStarted >= windowSeconds * 1000)
+		{
+			Sample();
+			EndWindow();
+			whenWindowStarted = now;
+		}
+	}
+
+	void Diagnostics(MessageType mtype) noexcept
+	{
+		Platform& p = reprap.GetPlatform();
+		if (lastWindowTicks == 0)
+		{
+			p.Message(mtype, "ISR CPU usage: not measured yet\n");
+			return;
+		}
+		p.MessageF(mtype, "ISR CPU usage over %.1fs:", (double)((float)lastWindowTicks * (1.0/(float)StepClockRate)));
+		for (size_t i = 0; i < NumIsrIds; ++i)
+		{
+			p.MessageF(mtype, " %s %.2f%%", IsrNames[i], (double)lastIsrPercent[i]);
+		}
+		p.Message(mtype, "\n");
+	}
+
+	// Handle M122 W: set the length of the window in seconds and start a new one
+	GCodeResult SetWindow(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
+	{
+		const uint32_t seconds = gb.GetLimitedUIValue('W', 1, MaxCpuUsageWindowSeconds + 1);
+		Sample();
+		EndWindow();
+		windowSeconds = seconds;
+		whenWindowStarted = millis();
+		return GCodeResult::ok;
+	}
+
+	uint32_t GetWindowSeconds() noexcept
+	{
+		return windowSeconds;
+	}
+
+	size_t GetNumTasks() noexcept
+	{
+		return (lastWindowTicks == 0) ? 0 : numEntries;
+	}
+
+	const char *_ecv_array GetTaskName(size_t index) noexcept
+	{
+		return pcTaskGetName(entries[index].task->GetFreeRTOSHandle());
+	}
+
+	float GetTaskPercent(size_t index) noexcept
+	{
+		return entries[index].lastPercent;
+	}
+
+	unsigned int GetTaskFreeStack(size_t index) noexcept
+	{
+		return entries[index].freeStack;
+	}
+
+	float GetTaskPercent(const TaskBase *t) noexcept
+	{
+		for (size_t i = 0; i < numEntries; ++i)
+		{
+			if (entries[i].task == t)
+			{
+				return entries[i].lastPercent;
+			}
+		}
+		return 0.0;
+	}
+
+	float GetIsrPercent(IsrId id) noexcept
+	{
+		return lastIsrPercent[(size_t)id];
+	}
+}
+
+#endif
+
+// End
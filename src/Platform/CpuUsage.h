@@ -0,0 +1,58 @@
+/*
+ * CpuUsage.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  This collects the FreeRTOS run time statistics, which use the step timer as the time base, over a fixed window so that M122 and the object model
+ *  can report how the CPU time was split between the tasks in the last complete window. The time taken by the interrupt service routines that do
+ *  the most work is measured separately. ISR time is also included in the time of whichever task was interrupted, because FreeRTOS doesn't know
+ *  about it, and the time of a high priority ISR that interrupts a lower priority one is included in both.
+ */
+
+#ifndef SRC_PLATFORM_CPUUSAGE_H_
+#define SRC_PLATFORM_CPUUSAGE_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_CPU_USAGE_STATS
+
+#include <Movement/StepTimer.h>
+
+namespace CpuUsage
+{
+	enum class IsrId : uint8_t { step = 0, drivers, network };
+	constexpr size_t NumIsrIds = 3;
+
+	extern volatile uint32_t isrTicks[NumIsrIds];		// the total step clocks spent in each ISR, only ever incremented
+
+	// Create one of these at the start of an ISR to add the time until it goes out of scope to the time of that ISR.
+	// The step clock is coarse compared to the length of a short ISR, but because ISRs are not synchronised to it the average is still correct.
+	class IsrTimer
+	{
+	public:
+		explicit IsrTimer(IsrId p_id) noexcept : startTicks(StepTimer::GetTimerTicks()), id(p_id) { }
+		~IsrTimer() noexcept { isrTicks[(size_t)id] += StepTimer::GetTimerTicks() - startTicks; }
+
+	private:
+		uint32_t startTicks;
+		IsrId id;
+	};
+
+	void Spin() noexcept;								// called by the main task
+	void Sample() noexcept;								// add the run time of each task since the last sample to the current window
+	void Diagnostics(MessageType mtype) noexcept;
+	GCodeResult SetWindow(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);
+
+	uint32_t GetWindowSeconds() noexcept;
+	size_t GetNumTasks() noexcept;
+	const char *_ecv_array GetTaskName(size_t index) noexcept pre(index < GetNumTasks());
+	float GetTaskPercent(size_t index) noexcept pre(index < GetNumTasks());
+	unsigned int GetTaskFreeStack(size_t index) noexcept pre(index < GetNumTasks());
+	float GetTaskPercent(const TaskBase *t) noexcept;	// return the CPU % of a task in the last window, or 0 if we don't know it
+	float GetIsrPercent(IsrId id) noexcept;
+}
+
+#endif
+
+#endif /* SRC_PLATFORM_CPUUSAGE_H_ */
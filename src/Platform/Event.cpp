@@ -12,8 +12,18 @@
 #include <ObjectModel/Variable.h>
 
 Event *_ecv_null Event::eventsPending = nullptr;
+unsigned int Event::numEventsPending = 0;
 unsigned int Event::eventsQueued = 0;
 unsigned int Event::eventsProcessed = 0;
+unsigned int Event::eventsCoalesced = 0;
+unsigned int Event::eventsDropped = 0;
+
+uint32_t Event::whenLastWarningFinished = 0;
+uint16_t Event::lastWarningParam = 0;
+EventType Event::lastWarningType(EventType::driver_warning);
+CanAddress Event::lastWarningBoardAddress = 0;
+uint8_t Event::lastWarningDeviceNumber = 0;
+bool Event::haveLastWarning = false;
 
 // Private constructor, inline because it is only called from one place
 inline Event::Event(Event *_ecv_null p_next, EventType et, uint16_t p_param, CanAddress p_ba, uint8_t devNum, const char *_ecv_array format, va_list vargs) noexcept
@@ -22,6 +32,32 @@ inline Event::Event(Event *_ecv_null p_next, EventType et, uint16_t p_param, Can
 	text.vprintf(format, vargs);
 }
 
+// Return true if this event is similar to the one described by the parameters.
+// An event is 'similar' if it has the same type, device number, CAN address and parameter even if the text is different.
+inline bool Event::IsSimilar(EventType et, uint16_t p_param, CanAddress p_ba, uint8_t devNum) const noexcept
+{
+	return et == type && devNum == deviceNumber && p_param == param
+#if SUPPORT_CAN_EXPANSION
+		&& p_ba == boardAddress
+#endif
+		;
+}
+
+// Return true if this type of event is only a warning, so that we may suppress repeats of it
+/*static*/ inline bool Event::IsWarning(EventType et) noexcept
+{
+	switch (et.RawValue())
+	{
+	case EventType::driver_warning:
+	case EventType::driver_stall:
+	case EventType::mcu_temperature_warning:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
 // Queue an event, or release it if we have a similar event pending already. Returns true if the event was added, false if it was released.
 /*static*/ bool Event::AddEvent(EventType et, uint16_t p_param, CanAddress p_ba, uint8_t devNum, const char *_ecv_array format, ...) noexcept
 {
@@ -36,26 +72,55 @@ inline Event::Event(Event *_ecv_null p_next, EventType et, uint16_t p_param, Can
 // The event list is held in priority order, lowest numbered (highest priority) events first.
 /*static*/ bool Event::AddEventV(EventType et, uint16_t p_param, CanAddress p_ba, uint8_t devNum, const char *_ecv_array format, va_list vargs) noexcept
 {
-	// Search for similar events already pending or being processed.
-	// An event is 'similar' if it has the same type, device number, CAN address and parameter even if the text is different.
 	TaskCriticalSectionLocker lock;
 
+	// Suppress a warning that repeats one that we finished processing recently
+	if (   haveLastWarning && IsWarning(et)
+		&& et == lastWarningType && devNum == lastWarningDeviceNumber && p_param == lastWarningParam
+#if SUPPORT_CAN_EXPANSION
+		&& p_ba == lastWarningBoardAddress
+#endif
+		&& millis() - whenLastWarningFinished < EventRepeatSuppressMillis
+	   )
+	{
+		++eventsCoalesced;
+		return false;
+	}
+
+	// Search for similar events already pending or being processed
 	Event** pe = &eventsPending;
 	while (*pe != nullptr && (et >= (*pe)->type || (*pe)->isBeingProcessed))		// while the next event in the list has same or higher priority than the new one
 	{
-		if (et == (*pe)->type && devNum == (*pe)->deviceNumber &&(*pe)->param == p_param
-#if SUPPORT_CAN_EXPANSION
-			 && p_ba == (*pe)->boardAddress
-#endif
-		   )
+		if ((*pe)->IsSimilar(et, p_param, p_ba, devNum))
 		{
+			++eventsCoalesced;
 			return false;						// there is a similar event already in the queue
 		}
 		pe = &((*pe)->next);
 	}
 
+	if (numEventsPending >= MaxQueuedEvents)
+	{
+		// The queue is full. If the new event would go at the end then drop it, otherwise drop the last event in the queue, which has lower priority.
+		if (*pe == nullptr)
+		{
+			++eventsDropped;
+			return false;
+		}
+		Event **pLast = pe;
+		while ((*pLast)->next != nullptr)
+		{
+			pLast = &((*pLast)->next);
+		}
+		delete *pLast;							// this can't be the event being processed, because that is ahead of where the new one will go
+		*pLast = nullptr;
+		--numEventsPending;
+		++eventsDropped;
+	}
+
 	// We didn't find a similar event, so add the new one
 	*pe = new Event(*pe, et, p_param, p_ba, devNum, format, vargs);
+	++numEventsPending;
 	++eventsQueued;
 	return true;
 }
@@ -143,8 +208,18 @@ inline Event::Event(Event *_ecv_null p_next, EventType et, uint16_t p_param, Can
 	const Event *ev = eventsPending;
 	if (ev != nullptr && ev->isBeingProcessed)
 	{
+		if (IsWarning(ev->type))
+		{
+			lastWarningType = ev->type;
+			lastWarningParam = ev->param;
+			lastWarningBoardAddress = ev->boardAddress;
+			lastWarningDeviceNumber = ev->deviceNumber;
+			whenLastWarningFinished = millis();
+			haveLastWarning = true;
+		}
 		eventsPending = ev->next;
 		delete ev;
+		--numEventsPending;
 		++eventsProcessed;
 	}
 }
@@ -216,7 +291,8 @@ inline Event::Event(Event *_ecv_null p_next, EventType et, uint16_t p_param, Can
 // Generate diagnostic data
 /*static*/ void Event::Diagnostics(MessageType mt, Platform& p) noexcept
 {
-	p.MessageF(mt, "Events: %u queued, %u completed\n", eventsQueued, eventsProcessed);
+	p.MessageF(mt, "Events: %u queued, %u completed, %u coalesced, %u dropped, %u pending\n",
+				eventsQueued, eventsProcessed, eventsCoalesced, eventsDropped, numEventsPending);
 }
 
 // End
@@ -16,6 +16,11 @@
  * and removes it from the queue.
  *
  * A main board power failure bypasses the event mechanism. Triggers do not use the event mechanism.
+ *
+ * The number of queued events is limited to MaxQueuedEvents, so that a misbehaving device can't use up memory. When the queue is full, a new event replaces
+ * the lowest priority event if that has lower priority than the new one, otherwise the new event is dropped. Similar events that arrive while one is queued
+ * are counted but not queued. A warning that is similar to one that finished processing within the last EventRepeatSuppressMillis is
+ * also counted but not queued, so that a driver that keeps reporting the same warning doesn't keep the AutoPause channel busy running macros.
  */
 
 #ifndef SRC_PLATFORM_EVENT_H_
@@ -74,6 +79,9 @@ public:
 private:
 	Event(Event *_ecv_null pnext, EventType et, uint16_t p_param, CanAddress p_ba, uint8_t devNum, const char *_ecv_array format, va_list vargs) noexcept;
 
+	bool IsSimilar(EventType et, uint16_t p_param, CanAddress p_ba, uint8_t devNum) const noexcept;
+	static bool IsWarning(EventType et) noexcept;
+
 	Event *_ecv_null next;					// next event in a linked list
 	uint16_t param;							// details about the event, e.g. for a heater fault it is the type of the fault
 	EventType type;							// what type of event it is
@@ -83,8 +91,19 @@ private:
 	String<50> text;						// additional info to display to the user
 
 	static Event * _ecv_null eventsPending;	// linked list of events waiting to be processed
+	static unsigned int numEventsPending;
 	static unsigned int eventsQueued;
 	static unsigned int eventsProcessed;
+	static unsigned int eventsCoalesced;	// similar events that were counted against a queued or recently finished event instead of being queued
+	static unsigned int eventsDropped;		// events discarded because the queue was full
+
+	// Details of the last warning that finished processing, so that we can suppress repeats of it
+	static uint32_t whenLastWarningFinished;
+	static uint16_t lastWarningParam;
+	static EventType lastWarningType;
+	static CanAddress lastWarningBoardAddress;
+	static uint8_t lastWarningDeviceNumber;
+	static bool haveLastWarning;
 };
 
 #endif /* SRC_PLATFORM_EVENT_H_ */
@@ -0,0 +1,105 @@
+/*
+ * EventTrace.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "EventTrace.h"
+
+#if SUPPORT_EVENT_TRACE
+
+#include "OutputMemory.h"
+#include "Base64Encoder.h"
+#include <Movement/StepTimer.h>
+#include <atomic>
+
+static_assert((EventTraceRecords & (EventTraceRecords - 1)) == 0, "EventTraceRecords must be a power of 2");
+static_assert(EventTraceRecords <= 65536, "EventTraceRecords too large for the 16-bit sequence number");
+
+namespace EventTrace
+{
+	static TraceRecord records[EventTraceRecords];
+	static std::atomic<uint32_t> putIndex = 0;
+	static uint32_t getIndex = 0;										// only used by the Network task
+	static uint32_t numDropped = 0;										// records that were overwritten before we could return them, since the last response
+
+	void Record(EventId id, uint32_t arg1, uint32_t arg2) noexcept
+	{
+		const uint32_t index = putIndex.fetch_add(1, std::memory_order_relaxed);
+		TraceRecord& r = records[index % EventTraceRecords];
+		r.timestamp = StepTimer::GetTimerTicks();
+		r.id = (uint8_t)id;
+		r.context = (uint8_t)__get_IPSR();
+		r.arg1 = arg1;
+		r.arg2 = arg2;
+		std::atomic_thread_fence(std::memory_order_release);
+		r.sequence = (uint16_t)index;
+	}
+
+	// Return a JSON object containing the records that have been made since the last call, up to a limit, base64-encoded
+	OutputBuffer *GetResponse() noexcept
+	{
+		OutputBuffer *response;
+		if (!OutputBuffer::Allocate(response))
+		{
+			return nullptr;
+		}
+
+		uint32_t put = putIndex.load();
+		if (put - getIndex > EventTraceRecords)
+		{
+			numDropped += put - getIndex - EventTraceRecords;
+			getIndex = put - EventTraceRecords;
+		}
+
+		response->catf("{\"err\":0,\"rate\":%" PRIu32 ",\"data\":\"", StepClockRate);
+		Base64Encoder encoder(response);
+		size_t numReturned = 0;
+		while (getIndex != put && numReturned < MaxEventTraceRecordsPerResponse)
+		{
+			const TraceRecord& slot = records[getIndex % EventTraceRecords];
+			const uint16_t expectedSequence = (uint16_t)getIndex;
+			bool complete = (slot.sequence == expectedSequence);
+			TraceRecord r;
+			if (complete)
+			{
+				std::atomic_thread_fence(std::memory_order_acquire);
+				r = slot;
+				std::atomic_thread_fence(std::memory_order_acquire);
+				complete = (slot.sequence == expectedSequence);				// check that it wasn't overwritten while we copied it
+			}
+
+			if (complete)
+			{
+				encoder.Add32(r.timestamp);
+				encoder.Add(r.id);
+				encoder.Add(r.context);
+				encoder.Add16(r.sequence);
+				encoder.Add32(r.arg1);
+				encoder.Add32(r.arg2);
+				++numReturned;
+			}
+			else
+			{
+				put = putIndex.load();
+				if (put - getIndex <= EventTraceRecords)
+				{
+					break;													// the writer hasn't finished this record, so leave it for the next call
+				}
+				++numDropped;												// the record has been overwritten
+			}
+			++getIndex;
+		}
+		encoder.Flush();
+
+		response->catf("\",\"dropped\":%" PRIu32, numDropped);
+		numDropped = 0;
+		response->cat('}');
+		return response;
+	}
+}
+
+#endif
+
+// End
@@ -0,0 +1,54 @@
+/*
+ * EventTrace.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  This records short fixed-size events, such as move preparation, late step timer callbacks, file reads, network sends and CAN traffic,
+ *  in a RAM ring buffer so that intermittent stutters can be correlated with what the other tasks and ISRs were doing at the time.
+ *  Events can be recorded from any task or ISR without locking: the writer claims a slot by incrementing the put index atomically, and the
+ *  sequence number in the record is written last so that the reader can tell whether the record is complete. The oldest records are overwritten
+ *  when the buffer is full. The rr_trace HTTP request drains the buffer. The record layout and the event IDs are described in
+ *  Developer-documentation/EventTraceFormat.md, and Tools/eventtrace converts the records to a file that a timeline viewer can load.
+ */
+
+#ifndef SRC_PLATFORM_EVENTTRACE_H_
+#define SRC_PLATFORM_EVENTTRACE_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_EVENT_TRACE
+
+namespace EventTrace
+{
+	// The event IDs. Don't change the existing values because the host tool depends on them.
+	// For events that have a duration, the record is made when the operation ends and arg1 is the duration in step clocks.
+	enum class EventId : uint8_t
+	{
+		movePrepare = 1,				// a move has been prepared: arg1 = duration, arg2 = the step clocks that the move will take
+		timerLate = 2,					// a step timer callback ran late: arg1 = how many step clocks late, arg2 = the address of the callback
+		fileRead = 3,					// a file has been read: arg1 = duration, arg2 = the number of bytes read
+		networkSend = 4,				// a responder has sent data: arg1 = the number of bytes offered, arg2 = the number of bytes the socket accepted
+		canSend = 5,					// a CAN message has been sent: arg1 = time waiting for a transmit buffer, arg2 = (message type << 16) | data length
+		canReceive = 6,					// a CAN request has been received: arg1 = message type, arg2 = (source address << 16) | data length
+	};
+
+	struct TraceRecord
+	{
+		uint32_t timestamp;				// the step clock when the event was recorded
+		uint8_t id;						// the EventId
+		uint8_t context;				// the exception number if the event was recorded by an ISR, 0 if it was recorded by a task
+		uint16_t sequence;				// the low 16 bits of the index of this record, written last
+		uint32_t arg1;
+		uint32_t arg2;
+	};
+
+	static_assert(sizeof(TraceRecord) == 16, "TraceRecord must be 16 bytes");
+
+	void Record(EventId id, uint32_t arg1, uint32_t arg2) noexcept;		// can be called from any task or ISR
+	OutputBuffer *GetResponse() noexcept;									// called by the Network task to return the next batch of records
+}
+
+#endif
+
+#endif /* SRC_PLATFORM_EVENTTRACE_H_ */
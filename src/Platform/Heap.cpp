@@ -14,12 +14,15 @@
 #include <Platform/Platform.h>
 #include <Platform/RepRap.h>
 #include <General/String.h>
+#include <Movement/StepTimer.h>
 #include <atomic>
 
 #define CHECK_HANDLES	(1)							// set nonzero to check that handles are valid before dereferencing them
 
 constexpr size_t IndexBlockSlots = 99;				// number of 4-byte handles per index block, plus one for link to next index block
 constexpr size_t HeapBlockSize = 2048;				// the size of each heap block
+constexpr size_t MaxHandleAdjustments = 8;			// the number of storage moves we record before we adjust the handles
+constexpr size_t NumInternSlots = 64;				// the number of entries in the table of interned strings, must be a power of 2
 
 struct StorageSpace
 {
@@ -61,6 +64,15 @@ struct HeapBlock
 	char data[HeapBlockSize];
 };
 
+// A record of some storage that has been moved down during garbage collection, so that the handles pointing to it need to be adjusted
+struct HandleAdjustment
+{
+	char *startAddr;
+	char *endAddr;
+	size_t moveDown;
+	unsigned int numHandles;
+};
+
 ReadWriteLock StringHandle::heapLock;
 IndexBlock *StringHandle::indexRoot = nullptr;
 HeapBlock *StringHandle::heapRoot = nullptr;
@@ -70,110 +82,169 @@ size_t StringHandle::heapAllocated = 0;
 size_t StringHandle::heapUsed = 0;
 std::atomic<size_t> StringHandle::heapToRecycle = 0;
 unsigned int StringHandle::gcCyclesDone = 0;
+unsigned int StringHandle::gcBlocksCompacted = 0;
+unsigned int StringHandle::gcPauseCounts[NumGcPauseBuckets] = { 0 };
+uint32_t StringHandle::maxGcPause = 0;
+uint32_t StringHandle::numAllocations = 0;
+IndexSlot *StringHandle::internTable[NumInternSlots] = { nullptr };
+unsigned int StringHandle::numInternHits = 0;
 
 /*static*/ void StringHandle::GarbageCollect() noexcept
 {
 	WriteLocker locker(heapLock);
+	const uint32_t startTicks = StepTimer::GetTimerTicks();
 	GarbageCollectInternal();
+	RecordGcPause(startTicks);
 }
 
+// Compact all the heap blocks. Must own the write lock when calling this.
 /*static*/ void StringHandle::GarbageCollectInternal() noexcept
 {
 #if CHECK_HANDLES
 	RRF_ASSERT(heapLock.GetWriteLockOwner() == TaskBase::GetCallerTaskHandle());
 #endif
 
-	heapUsed = 0;
-	for (HeapBlock *currentBlock = heapRoot; currentBlock != nullptr; )
+	for (HeapBlock *currentBlock = heapRoot; currentBlock != nullptr; currentBlock = currentBlock->next)
 	{
-		// Skip any used blocks at the start because they won't be moved
-		char *p = currentBlock->data;
-		while (p < currentBlock->data + currentBlock->allocated)
+		CompactBlock(currentBlock);
+	}
+
+	heapToRecycle = 0;
+	++gcCyclesDone;
+}
+
+// Compact a single heap block, moving the used storage down over the free storage and adjusting the handles. Must own the write lock when calling this.
+// The time taken is bounded by the size of a heap block and the number of index blocks, so the allocator can compact one block at a time until it has enough space.
+/*static*/ void StringHandle::CompactBlock(HeapBlock *currentBlock) noexcept
+{
+	const size_t oldAllocated = currentBlock->allocated;
+
+	// Skip any used blocks at the start because they won't be moved
+	char *p = currentBlock->data;
+	while (p < currentBlock->data + currentBlock->allocated)
+	{
+		const size_t len = reinterpret_cast<StorageSpace*>(p)->length;
+		if (len & 1u)					// if this slot has been marked as free
 		{
-			const size_t len = reinterpret_cast<StorageSpace*>(p)->length;
-			if (len & 1u)					// if this slot has been marked as free
-			{
-				break;
-			}
-			p += len + sizeof(StorageSpace::length);
+			break;
 		}
+		p += len + sizeof(StorageSpace::length);
+	}
 
-		if (p < currentBlock->data + currentBlock->allocated)					// if we found an unused block before we reached the end
+	if (p < currentBlock->data + currentBlock->allocated)					// if we found an unused block before we reached the end
+	{
+		char* startSkip = p;
+		HandleAdjustment adjustments[MaxHandleAdjustments];
+		size_t numAdjustments = 0;
+
+		for (;;)
 		{
-			char* startSkip = p;
+			// Find the end of the unused blocks
+			while (p < currentBlock->data + currentBlock->allocated)
+			{
+				const size_t len = reinterpret_cast<StorageSpace*>(p)->length;
+				if ((len & 1u) == 0)
+				{
+					break;
+				}
+				p += (len & ~1u) + sizeof(StorageSpace::length);
+			}
 
-			for (;;)
+			if (p >= currentBlock->data + currentBlock->allocated)
+			{
+				currentBlock->allocated = startSkip - currentBlock->data;	// the unused blocks were at the end so just change the allocated size
+				break;
+			}
+			else
 			{
-				// Find the end of the unused blocks
+				// Find all the contiguous blocks
+				char *startUsed = p;
+				unsigned int numHandlesToAdjust = 0;
 				while (p < currentBlock->data + currentBlock->allocated)
 				{
 					const size_t len = reinterpret_cast<StorageSpace*>(p)->length;
-					if ((len & 1u) == 0)
+					if (len & 1u)
 					{
 						break;
 					}
-					p += (len & ~1u) + sizeof(StorageSpace::length);
+					++numHandlesToAdjust;
+					p += len + sizeof(StorageSpace::length);
 				}
 
-				if (p >= currentBlock->data + currentBlock->allocated)
+				// Move the contiguous blocks down and record the handle adjustment needed. The handles still point to the old addresses until we adjust them.
+				memmove(startSkip, startUsed, p - startUsed);
+				if (numAdjustments == MaxHandleAdjustments)
 				{
-					currentBlock->allocated = startSkip - currentBlock->data;	// the unused blocks were at the end so just change the allocated size
-					break;
-				}
-				else
-				{
-					// Find all the contiguous blocks
-					char *startUsed = p;
-					unsigned int numHandlesToAdjust = 0;
-					while (p < currentBlock->data + currentBlock->allocated)
-					{
-						const size_t len = reinterpret_cast<StorageSpace*>(p)->length;
-						if (len & 1u)
-						{
-							break;
-						}
-						++numHandlesToAdjust;
-						p += len + sizeof(StorageSpace::length);
-					}
-
-					// Move the contiguous blocks down
-					memmove(startSkip, startUsed, p - startUsed);
-					//TODO make this more efficient by building up a small table of several adjustments, so we need to make fewer passes through the index
-					AdjustHandles(startUsed, p, startUsed - startSkip, numHandlesToAdjust);
-					startSkip += p - startUsed;
+					AdjustHandles(adjustments, numAdjustments);
+					numAdjustments = 0;
 				}
+				adjustments[numAdjustments++] = { startUsed, p, (size_t)(startUsed - startSkip), numHandlesToAdjust };
+				startSkip += p - startUsed;
 			}
 		}
 
-		heapUsed += currentBlock->allocated;
-		currentBlock = currentBlock->next;
+		if (numAdjustments != 0)
+		{
+			AdjustHandles(adjustments, numAdjustments);
+		}
 	}
 
-	heapToRecycle = 0;
-	++gcCyclesDone;
+	const size_t reclaimed = oldAllocated - currentBlock->allocated;
+	heapUsed -= reclaimed;
+	heapToRecycle -= min<size_t>(reclaimed, heapToRecycle);
 }
 
-// Find all handles pointing to storage between startAddr and endAddr and move the pointers down by amount moveDown
-/*static*/ void StringHandle::AdjustHandles(char *startAddr, char *endAddr, size_t moveDown, unsigned int numHandles) noexcept
+// Find all handles pointing to storage in the address ranges of the adjustments and move the pointers down by the corresponding amounts.
+// This makes a single pass through the index for several adjustments.
+/*static*/ void StringHandle::AdjustHandles(const HandleAdjustment *adjustments, size_t numAdjustments) noexcept
 {
+	unsigned int numHandles = 0;
+	for (size_t j = 0; j < numAdjustments; ++j)
+	{
+		numHandles += adjustments[j].numHandles;
+	}
+
 	for (IndexBlock *indexBlock = indexRoot; indexBlock != nullptr; indexBlock = indexBlock->next)
 	{
 		for (size_t i = 0; i < IndexBlockSlots; ++i)
 		{
 			char * const p = (char *)indexBlock->slots[i].storage;
-			if (p != nullptr && p >= startAddr && p < endAddr)
+			if (p != nullptr)
 			{
-				indexBlock->slots[i].storage = reinterpret_cast<StorageSpace*>(p - moveDown);
-				--numHandles;
-				if (numHandles == 0)
+				for (size_t j = 0; j < numAdjustments; ++j)
 				{
-					return;
+					if (p >= adjustments[j].startAddr && p < adjustments[j].endAddr)
+					{
+						indexBlock->slots[i].storage = reinterpret_cast<StorageSpace*>(p - adjustments[j].moveDown);
+						--numHandles;
+						if (numHandles == 0)
+						{
+							return;
+						}
+						break;
+					}
 				}
 			}
 		}
 	}
 }
 
+// Record how long the heap was locked for garbage collection
+/*static*/ void StringHandle::RecordGcPause(uint32_t startTicks) noexcept
+{
+	const uint32_t pause = (uint32_t)(((uint64_t)(StepTimer::GetTimerTicks() - startTicks) * 1000000u)/StepClockRate);
+	unsigned int bucket = 0;
+	while (bucket + 1 < NumGcPauseBuckets && pause >= GcPauseBucketMicroseconds << bucket)
+	{
+		++bucket;
+	}
+	++gcPauseCounts[bucket];
+	if (pause > maxGcPause)
+	{
+		maxGcPause = pause;
+	}
+}
+
 /*static*/ bool StringHandle::CheckIntegrity(const StringRef& errmsg) noexcept
 {
 	ReadLocker lock(heapLock);
@@ -300,30 +371,39 @@ unsigned int StringHandle::gcCyclesDone = 0;
 #endif
 
 	length = min<size_t>((length + 1) & (~1u), HeapBlockSize - sizeof(StorageSpace::length));	// round to an even length to keep things aligned and limit to max size
+	++numAllocations;
+
+	for (HeapBlock *currentBlock = heapRoot; currentBlock != nullptr; currentBlock = currentBlock->next)
+	{
+		StorageSpace * const ret = AllocateInBlock(currentBlock, length);
+		if (ret != nullptr)
+		{
+			return ret;
+		}
+	}
 
-	bool collected = false;
-	do
+	// There is no space in any existing heap block. Decide whether to garbage collect and try again, or allocate a new block.
+	// We compact one block at a time and stop as soon as one has enough space, so that we hold the write lock for as short a time as possible.
+	if (heapToRecycle >= length * 4)
 	{
+		const uint32_t startTicks = StepTimer::GetTimerTicks();
 		for (HeapBlock *currentBlock = heapRoot; currentBlock != nullptr; currentBlock = currentBlock->next)
 		{
-			if (HeapBlockSize - sizeof(StorageSpace::length) >= currentBlock->allocated + length)		// if the data will fit at the end of the current block
+			CompactBlock(currentBlock);
+			++gcBlocksCompacted;
+			StorageSpace * const ret = AllocateInBlock(currentBlock, length);
+			if (ret != nullptr)
 			{
-				StorageSpace * const ret = reinterpret_cast<StorageSpace*>(currentBlock->data + currentBlock->allocated);
-				ret->length = length;
-				currentBlock->allocated += length + sizeof(StorageSpace::length);
-				heapUsed += length + sizeof(StorageSpace::length);
+				RecordGcPause(startTicks);
 				return ret;
 			}
 		}
 
-		// There is no space in any existing heap block. Decide whether to garbage collect and try again, or allocate a new block.
-		if (collected || heapToRecycle < length * 4)
-		{
-			break;
-		}
-		GarbageCollectInternal();
-		collected = true;
-	} while (true);
+		// We compacted all the blocks
+		heapToRecycle = 0;
+		++gcCyclesDone;
+		RecordGcPause(startTicks);
+	}
 
 	// Create a new heap block
 	heapRoot = new HeapBlock(heapRoot);
@@ -335,6 +415,20 @@ unsigned int StringHandle::gcCyclesDone = 0;
 	return ret2;
 }
 
+// Allocate space of the specified rounded length at the end of a heap block if it will fit, else return nullptr
+/*static*/ StorageSpace *StringHandle::AllocateInBlock(HeapBlock *currentBlock, size_t length) noexcept
+{
+	if (HeapBlockSize - sizeof(StorageSpace::length) >= currentBlock->allocated + length)		// if the data will fit at the end of the current block
+	{
+		StorageSpace * const ret = reinterpret_cast<StorageSpace*>(currentBlock->data + currentBlock->allocated);
+		ret->length = length;
+		currentBlock->allocated += length + sizeof(StorageSpace::length);
+		heapUsed += length + sizeof(StorageSpace::length);
+		return ret;
+	}
+	return nullptr;
+}
+
 // StringHandle members
 // Build a handle from a single null-terminated string
 StringHandle::StringHandle(const char *s) noexcept : StringHandle(s, strlen(s)) { }
@@ -376,6 +470,38 @@ StringHandle::StringHandle(const char *s1, const char *s2) noexcept
 }
 #endif
 
+// Assign an immutable identifier such as a variable name or object label, sharing the storage of an existing string with the same value if we find one.
+// The intern table is a cache of recently interned strings indexed by hash, so a string that has been replaced in the table by another one with the same
+// hash index won't be shared; but a lookup only needs one hash calculation and one string comparison. Table entries whose handles have since been freed
+// or reused are detected by checking the storage, so the table doesn't need to be updated when strings are deleted.
+void StringHandle::AssignInterned(const char *s) noexcept
+{
+	Delete();
+	const size_t len = strlen(s);
+	if (len != 0)
+	{
+		uint32_t hash = 2166136261u;							// FNV-1a hash
+		for (size_t i = 0; i < len; ++i)
+		{
+			hash = (hash ^ (uint8_t)s[i]) * 16777619u;
+		}
+
+		WriteLocker locker(heapLock);							// prevent other tasks modifying the heap
+		IndexSlot *& entry = internTable[hash & (NumInternSlots - 1)];
+		if (entry != nullptr && entry->storage != nullptr && strcmp(entry->storage->data, s) == 0)
+		{
+			++entry->refCount;
+			++numInternHits;
+			slotPtr = entry;
+		}
+		else
+		{
+			InternalAssign(s, len);
+			entry = slotPtr;
+		}
+	}
+}
+
 void StringHandle::Assign(const char *s) noexcept
 {
 	Delete();
@@ -494,9 +620,21 @@ size_t StringHandle::GetLength() const noexcept
 	{
 		temp.copy("Heap OK");
 	}
-	temp.catf(", handles allocated/used %u/%u, heap memory allocated/used/recyclable %u/%u/%u, gc cycles %u\n",
-					handlesAllocated, (unsigned int)handlesUsed, heapAllocated, heapUsed, (unsigned int)heapToRecycle, gcCyclesDone);
+	temp.catf(", handles allocated/used %u/%u, heap memory allocated/used/recyclable %u/%u/%u, gc cycles %u, blocks compacted %u, interned strings shared %u\n",
+					handlesAllocated, (unsigned int)handlesUsed, heapAllocated, heapUsed, (unsigned int)heapToRecycle, gcCyclesDone, gcBlocksCompacted, numInternHits);
 	p.Message(mt, temp.c_str());
+
+	// Report the garbage collection pause histogram since the last report, then clear it
+	temp.Clear();
+	char sep = ' ';
+	for (unsigned int& count : gcPauseCounts)
+	{
+		temp.catf("%c%u", sep, count);
+		count = 0;
+		sep = ',';
+	}
+	p.MessageF(mt, "Heap gc pauses (<%" PRIu32 "us, doubling):%s, max %" PRIu32 "us\n", GcPauseBucketMicroseconds, temp.c_str(), maxGcPause);
+	maxGcPause = 0;
 }
 
 // AutoStringHandle members
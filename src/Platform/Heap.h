@@ -17,6 +17,7 @@ class IndexSlot;
 class StorageSpace;
 class HeapBlock;
 class IndexBlock;
+struct HandleAdjustment;
 
 // Note: StringHandle is a union member in ExpressionValue, therefore it cannot have a non-trivial destructor, copy constructor etc.
 // This means that when an object containing a StringHandle is copied or destroyed, that object must handle the reference count.
@@ -38,6 +39,8 @@ public:
 	const StringHandle& IncreaseRefCount() const noexcept;
 	bool IsNull() const noexcept { return slotPtr == nullptr; }
 	void Assign(const char *s) noexcept;
+	void AssignInterned(const char *s) noexcept;								// assign an immutable string, sharing storage with an identical one if possible
+	bool IsSameStorage(const StringHandle& other) const noexcept { return slotPtr == other.slotPtr; }
 
 	static void GarbageCollect() noexcept;
 //	static size_t GetWastedSpace() noexcept { return spaceToRecycle; }
@@ -45,6 +48,7 @@ public:
 //	static size_t GetHeapSpace() noexcept { return totalHeapSpace; }
 	static bool CheckIntegrity(const StringRef& errmsg) noexcept;
 	static void Diagnostics(MessageType mt, Platform& p) noexcept;
+	static uint32_t GetNumAllocations() noexcept { return numAllocations; }	// return how many times string storage has been allocated since startup
 
 protected:
 	void InternalAssign(const char *s, size_t len) noexcept;
@@ -52,8 +56,14 @@ protected:
 
 	static IndexSlot *AllocateHandle() noexcept;
 	static StorageSpace *AllocateSpace(size_t length) noexcept;
+	static StorageSpace *AllocateInBlock(HeapBlock *currentBlock, size_t length) noexcept;
 	static void GarbageCollectInternal() noexcept;
-	static void AdjustHandles(char *startAddr, char *endAddr, size_t moveDown, unsigned int numHandles) noexcept;
+	static void CompactBlock(HeapBlock *currentBlock) noexcept;
+	static void AdjustHandles(const HandleAdjustment *adjustments, size_t numAdjustments) noexcept;
+	static void RecordGcPause(uint32_t startTicks) noexcept;
+
+	static constexpr unsigned int NumGcPauseBuckets = 8;
+	static constexpr uint32_t GcPauseBucketMicroseconds = 50;			// the upper limit of the first bucket, doubled for each subsequent bucket
 
 	IndexSlot * null slotPtr;
 
@@ -66,6 +76,12 @@ protected:
 	static size_t heapUsed;
 	static std::atomic<size_t> heapToRecycle;
 	static unsigned int gcCyclesDone;
+	static unsigned int gcBlocksCompacted;
+	static unsigned int gcPauseCounts[NumGcPauseBuckets];				// histogram of how long the heap was locked for garbage collection
+	static uint32_t maxGcPause;											// the longest garbage collection pause in microseconds since the last diagnostics report
+	static uint32_t numAllocations;
+	static IndexSlot *internTable[];										// recently interned strings, indexed by hash
+	static unsigned int numInternHits;										// how many times we have shared the storage of an interned string
 };
 
 // Version of StringHandle that updates the reference counts automatically
@@ -14,6 +14,20 @@
 #include "Platform.h"
 #include "Version.h"
 
+#if SUPPORT_ASYNC_LOGGING
+
+# include "Tasks.h"
+
+constexpr size_t LoggerTaskStackWords = 400;			// task stack size in dwords, must be enough for file writes and error messages
+static Task<LoggerTaskStackWords> *loggerTask = nullptr;
+
+extern "C" [[noreturn]] void LoggerTask(void *pvParameters) noexcept
+{
+	static_cast<Logger *>(pvParameters)->TaskLoop();
+}
+
+#endif
+
 // Simple lock class that sets a variable true when it is created and makes sure it gets set false when it falls out of scope
 class Lock
 {
@@ -26,7 +40,13 @@ private:
 };
 
 Logger::Logger(LogLevel logLvl) noexcept : logFile(), lastFlushTime(0), lastFlushFileSize(0), dirty(false), inLogger(false), logLevel(logLvl)
+#if SUPPORT_ASYNC_LOGGING
+	, ringHead(0), ringTail(0), maxRingBytesUsed(0), droppedMessages(0), totalDroppedMessages(0)
+#endif
 {
+#if SUPPORT_ASYNC_LOGGING
+	fileMutex.Create("Logger");
+#endif
 }
 
 GCodeResult Logger::Start(time_t time, const StringRef& filename, const StringRef& reply) noexcept
@@ -34,6 +54,9 @@ GCodeResult Logger::Start(time_t time, const StringRef& filename, const StringRe
 	if (!inLogger && logLevel > LogLevel::off)
 	{
 		Lock loggerLock(inLogger);
+#if SUPPORT_ASYNC_LOGGING
+		MutexLocker lock(fileMutex);
+#endif
 		FileStore * const f = reprap.GetPlatform().OpenSysFile(filename.c_str(), OpenMode::append);
 		if (f == nullptr)
 		{
@@ -49,6 +72,13 @@ GCodeResult Logger::Start(time_t time, const StringRef& filename, const StringRe
 		startMessage.printf("Event logging started at level %s\n", logLevel.ToString());
 		InternalLogMessage(time, startMessage.c_str(), MessageLogLevel::info);
 		LogFirmwareInfo(time);
+#if SUPPORT_ASYNC_LOGGING
+		if (loggerTask == nullptr)
+		{
+			loggerTask = new Task<LoggerTaskStackWords>;
+			loggerTask->Create(LoggerTask, "LOGGER", this, TaskPriority::SpinPriority);
+		}
+#endif
 		reprap.StateUpdated();
 	}
 	return GCodeResult::ok;
@@ -82,6 +112,10 @@ void Logger::Stop(time_t time) noexcept
 	{
 		Lock loggerLock(inLogger);
 		InternalLogMessage(time, "Event logging stopped\n", MessageLogLevel::info);
+#if SUPPORT_ASYNC_LOGGING
+		MutexLocker lock(fileMutex);
+		WriteQueuedMessages();
+#endif
 		logFile.Close();
 		reprap.StateUpdated();
 	}
@@ -115,8 +149,12 @@ void Logger::LogMessage(time_t time, const char *message, MessageType type) noex
 		{
 			return;
 		}
+#if SUPPORT_ASYNC_LOGGING
+		QueueMessage(time, messageLogLevel, message, nullptr);
+#else
 		Lock loggerLock(inLogger);
 		InternalLogMessage(time, message, messageLogLevel);
+#endif
 	}
 }
 
@@ -129,6 +167,9 @@ void Logger::LogMessage(time_t time, OutputBuffer *buf, MessageType type) noexce
 		{
 			return;
 		}
+#if SUPPORT_ASYNC_LOGGING
+		QueueMessage(time, messageLogLevel, nullptr, buf);
+#else
 		Lock loggerLock(inLogger);
 		bool ok = WriteDateTimeAndLogLevelPrefix(time, messageLogLevel);
 		if (ok)
@@ -145,12 +186,16 @@ void Logger::LogMessage(time_t time, OutputBuffer *buf, MessageType type) noexce
 			logFile.Close();
 			reprap.StateUpdated();
 		}
+#endif
 	}
 }
 
 // Version of LogMessage for when we already know we want to proceed and we have already set inLogger
 void Logger::InternalLogMessage(time_t time, const char *message, const MessageLogLevel messageLogLevel) noexcept
 {
+#if SUPPORT_ASYNC_LOGGING
+	QueueMessage(time, messageLogLevel, message, nullptr);
+#else
 	bool ok = WriteDateTimeAndLogLevelPrefix(time, messageLogLevel);
 	if (ok)
 	{
@@ -174,12 +219,33 @@ void Logger::InternalLogMessage(time_t time, const char *message, const MessageL
 		logFile.Close();
 		reprap.StateUpdated();
 	}
+#endif
 }
 
 // This is called regularly by Platform to give the logger an opportunity to flush the file buffer
 void Logger::Flush(bool forced) noexcept
 {
-	if (logFile.IsLive() && dirty && !inLogger)
+#if SUPPORT_ASYNC_LOGGING
+	// The logger task normally writes and flushes the file, but if we are about to turn the power off then we must do it now
+	if (forced)
+	{
+		MutexLocker lock(fileMutex);
+		WriteQueuedMessages();
+		FlushIfDue(true);
+	}
+#else
+	if (!inLogger)
+	{
+		Lock loggerLock(inLogger);
+		FlushIfDue(forced);
+	}
+#endif
+}
+
+// Flush the file if it is dirty and it is time to do so. The caller must have set inLogger or be holding fileMutex.
+void Logger::FlushIfDue(bool forced) noexcept
+{
+	if (logFile.IsLive() && dirty)
 	{
 		// Log file is dirty and can be flushed.
 		// To avoid excessive disk write operations, flush it only if one of the following is true:
@@ -190,7 +256,6 @@ void Logger::Flush(bool forced) noexcept
 		const uint32_t now = millis();
 		if (forced || now - lastFlushTime >= LogFlushInterval || currentPos/512 != lastFlushFileSize/512)
 		{
-			Lock loggerLock(inLogger);
 			logFile.Flush();
 			lastFlushTime = millis();
 			lastFlushFileSize = currentPos;
@@ -199,12 +264,9 @@ void Logger::Flush(bool forced) noexcept
 	}
 }
 
-// Write the data, time and message log level to the file followed by a space.
-// Caller must already have checked and set inLogger.
-bool Logger::WriteDateTimeAndLogLevelPrefix(time_t time, MessageLogLevel messageLogLevel) noexcept
+// Format the date, time and message log level followed by a space
+void Logger::FormatDateTimeAndLogLevelPrefix(time_t time, MessageLogLevel messageLogLevel, const StringRef& buf) const noexcept
 {
-	String<StringLength50> bufferSpace;
-	const StringRef buf = bufferSpace.GetRef();
 	if (time == 0)
 	{
 		const uint32_t timeSincePowerUp = (uint32_t)(millis64()/1000u);
@@ -218,9 +280,174 @@ bool Logger::WriteDateTimeAndLogLevelPrefix(time_t time, MessageLogLevel message
 						timeInfo.tm_year + 1900, timeInfo.tm_mon + 1, timeInfo.tm_mday, timeInfo.tm_hour, timeInfo.tm_min, timeInfo.tm_sec);
 	}
 	buf.catf("[%s] ", messageLogLevel.ToString());
-	return logFile.Write(buf.c_str());
 }
 
+// Write the data, time and message log level to the file followed by a space.
+// Caller must already have checked and set inLogger.
+bool Logger::WriteDateTimeAndLogLevelPrefix(time_t time, MessageLogLevel messageLogLevel) noexcept
+{
+	String<StringLength50> bufferSpace;
+	FormatDateTimeAndLogLevelPrefix(time, messageLogLevel, bufferSpace.GetRef());
+	return logFile.Write(bufferSpace.c_str());
+}
+
+#if SUPPORT_ASYNC_LOGGING
+
+// Copy data into the ring buffer, advancing 'head'. The caller has already checked that there is room.
+void Logger::CopyToRing(size_t& head, const char *data, size_t length) noexcept
+{
+	while (length != 0)
+	{
+		const size_t chunk = min<size_t>(length, LogRingBufferSize - head);
+		memcpy(ring + head, data, chunk);
+		head = (head + chunk) % LogRingBufferSize;
+		data += chunk;
+		length -= chunk;
+	}
+}
+
+// Format a message and add it to the ring buffer, or count it as dropped if there isn't room for it. Either 'message' or 'buf' is non-null.
+// This never accesses the file, so it is quick and it doesn't matter which task calls it.
+void Logger::QueueMessage(time_t time, MessageLogLevel messageLogLevel, const char *message, const OutputBuffer *buf) noexcept
+{
+	String<StringLength50> prefix;
+	FormatDateTimeAndLogLevelPrefix(time, messageLogLevel, prefix.GetRef());
+
+	size_t length = prefix.strlen();
+	bool endsInNewline = false;
+	if (buf == nullptr)
+	{
+		const size_t len = strlen(message);
+		length += len;
+		endsInNewline = (len != 0 && message[len - 1] == '\n');
+	}
+	else
+	{
+		for (const OutputBuffer *b = buf; b != nullptr; b = b->Next())
+		{
+			if (b->DataLength() != 0)
+			{
+				length += b->DataLength();
+				endsInNewline = (b->Data()[b->DataLength() - 1] == '\n');
+			}
+		}
+	}
+	if (!endsInNewline)
+	{
+		++length;
+	}
+
+	size_t bytesUsed;
+	{
+		TaskCriticalSectionLocker lock;
+
+		bytesUsed = RingBytesUsed();
+		if (bytesUsed + length >= LogRingBufferSize)			// we always leave one byte free so that we can distinguish a full buffer from an empty one
+		{
+			++droppedMessages;
+			++totalDroppedMessages;
+			bytesUsed = LogWriteBatchSize;						// make sure the logger task gets woken up
+		}
+		else
+		{
+			size_t head = ringHead;
+			CopyToRing(head, prefix.c_str(), prefix.strlen());
+			if (buf == nullptr)
+			{
+				CopyToRing(head, message, strlen(message));
+			}
+			else
+			{
+				for (const OutputBuffer *b = buf; b != nullptr; b = b->Next())
+				{
+					CopyToRing(head, b->Data(), b->DataLength());
+				}
+			}
+			if (!endsInNewline)
+			{
+				CopyToRing(head, "\n", 1);
+			}
+			ringHead = head;
+			bytesUsed += length;
+			if (bytesUsed > maxRingBytesUsed)
+			{
+				maxRingBytesUsed = bytesUsed;
+			}
+		}
+	}
+
+	if (bytesUsed >= LogWriteBatchSize && loggerTask != nullptr)
+	{
+		loggerTask->Give();
+	}
+}
+
+// Write all the messages in the ring buffer to the file. The caller must be holding fileMutex.
+void Logger::WriteQueuedMessages() noexcept
+{
+	if (!logFile.IsLive())
+	{
+		ringTail = ringHead;
+		return;
+	}
+
+	bool ok = true;
+	size_t tail = ringTail;
+	const size_t head = ringHead;
+	while (ok && tail != head)
+	{
+		// Write as much as we can in one go. It is only split if it wraps round the end of the buffer.
+		const size_t chunk = (head > tail) ? head - tail : LogRingBufferSize - tail;
+		ok = logFile.Write(ring + tail, chunk);
+		tail = (tail + chunk) % LogRingBufferSize;
+		ringTail = tail;
+		dirty = true;
+	}
+
+	uint32_t numDropped;
+	{
+		TaskCriticalSectionLocker lock;
+		numDropped = droppedMessages;
+		droppedMessages = 0;
+	}
+
+	if (ok && numDropped != 0)
+	{
+		String<StringLength50> msg;
+		msg.printf("%" PRIu32 " log messages were dropped because the log buffer was full\n", numDropped);
+		ok = logFile.Write(msg.c_str());
+	}
+
+	if (!ok)
+	{
+		logFile.Close();
+		ringTail = ringHead;
+		reprap.StateUpdated();
+	}
+}
+
+// This is the logger task. It writes the queued messages to the file when enough data has accumulated that it is worth writing, or when it is time to flush the file.
+void Logger::TaskLoop() noexcept
+{
+	for (;;)
+	{
+		(void)TaskBase::Take(LogFlushInterval);
+		MutexLocker lock(fileMutex);
+		WriteQueuedMessages();
+		FlushIfDue(false);
+	}
+}
+
+void Logger::Diagnostics(MessageType mtype) noexcept
+{
+	reprap.GetPlatform().MessageF(mtype, "Log buffer max used %u of %u bytes, messages dropped %" PRIu32 "\n",
+									(unsigned int)maxRingBytesUsed, (unsigned int)LogRingBufferSize, totalDroppedMessages);
+	maxRingBytesUsed = RingBytesUsed();
+	totalDroppedMessages = 0;
+}
+
+#endif
+
 #endif
 
 // End
@@ -15,6 +15,10 @@
 #include <ctime>
 #include <Storage/FileData.h>
 
+#if SUPPORT_ASYNC_LOGGING
+# include <RTOSIface/RTOSIface.h>
+#endif
+
 class OutputBuffer;
 
 class Logger
@@ -31,6 +35,10 @@ public:
 	const char *GetFileName() const noexcept { return (IsActive()) ? logFileName.c_str() : nullptr; }
 	LogLevel GetLogLevel() const noexcept { return logLevel; }
 	void SetLogLevel(LogLevel newLogLevel) noexcept;
+#if SUPPORT_ASYNC_LOGGING
+	void Diagnostics(MessageType mtype) noexcept;
+	[[noreturn]] void TaskLoop() noexcept;
+#endif
 #if 0 // Currently not needed but might be useful in the future
 	bool IsLoggingEnabledFor(const MessageType mt) const noexcept;
 	bool IsWarnEnabled() const noexcept { return logLevel >= LogLevel::warn; }
@@ -44,11 +52,31 @@ private:
 
 	static const uint8_t LogEnabledThreshold = 3;
 
+	void FormatDateTimeAndLogLevelPrefix(time_t time, MessageLogLevel messageLogLevel, const StringRef& buf) const noexcept;
 	bool WriteDateTimeAndLogLevelPrefix(time_t time, MessageLogLevel messageLogLevel) noexcept;
 	void InternalLogMessage(time_t time, const char *message, const MessageLogLevel messageLogLevel) noexcept;
 	bool IsLoggingEnabledFor(const MessageLogLevel mll) const noexcept { return (mll < MessageLogLevel::off) && (mll.ToBaseType() + logLevel.ToBaseType() >= LogEnabledThreshold); }
 	void LogFirmwareInfo(time_t time) noexcept;
 	bool IsEmptyMessage(const char * message) const noexcept { return message[0] == '\0' || (message[0] == '\n' && message[1] == '\0'); }
+	void FlushIfDue(bool forced) noexcept;
+
+#if SUPPORT_ASYNC_LOGGING
+	size_t RingBytesUsed() const noexcept { return (ringHead + LogRingBufferSize - ringTail) % LogRingBufferSize; }
+	void CopyToRing(size_t& head, const char *data, size_t length) noexcept;
+	void QueueMessage(time_t time, MessageLogLevel messageLogLevel, const char *message, const OutputBuffer *buf) noexcept;
+	void WriteQueuedMessages() noexcept;
+
+	// The ring buffer has a single consumer (the logger task, or any task that holds fileMutex), so only ringTail is written by that task.
+	// Producers may be in different tasks, so they copy their messages into the ring buffer and advance ringHead with task switching disabled.
+	// The messages are formatted in the producer's task, so the order in the file is the order in which they were logged.
+	Mutex fileMutex;
+	volatile size_t ringHead;								// where the next message will be stored
+	volatile size_t ringTail;								// where the next byte to be written to the file is
+	size_t maxRingBytesUsed;
+	volatile uint32_t droppedMessages;						// messages dropped since we last wrote a report of them to the log
+	uint32_t totalDroppedMessages;
+	char ring[LogRingBufferSize];
+#endif
 
 	String<MaxFilenameLength> logFileName;
 	FileData logFile;
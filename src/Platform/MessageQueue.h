@@ -0,0 +1,86 @@
+/*
+ * MessageQueue.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  A fixed-size queue of preformatted messages, used by Platform so that tasks other than the main task can send messages without waiting for
+ *  the USB mutex or any of the other locks that the output channels need. Any task may add a message; only the main task removes them, when it
+ *  flushes the messages. Adding a message never blocks: a producer reserves a slot by advancing the reserve index with compare-and-swap, fills it,
+ *  then marks it full. If the queue is full the caller gets false back and should discard the message.
+ */
+
+#ifndef SRC_PLATFORM_MESSAGEQUEUE_H_
+#define SRC_PLATFORM_MESSAGEQUEUE_H_
+
+#include <RepRapFirmware.h>
+#include "MessageType.h"
+#include <atomic>
+
+class OutputBuffer;
+
+class MessageQueue
+{
+public:
+	MessageQueue() noexcept : reserveIndex(0), readIndex(0)
+	{
+		for (Slot& s : slots)
+		{
+			s.full.store(false, std::memory_order_relaxed);
+		}
+	}
+
+	// Add a message to the queue, returning true if successful. May be called by any task.
+	bool Enqueue(MessageType type, OutputBuffer *buf) noexcept
+	{
+		uint32_t index = reserveIndex.load(std::memory_order_relaxed);
+		do
+		{
+			if (index - readIndex.load(std::memory_order_acquire) >= DeferredMessageQueueLength)
+			{
+				return false;
+			}
+		} while (!reserveIndex.compare_exchange_weak(index, index + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+		Slot& s = slots[index & (DeferredMessageQueueLength - 1)];
+		s.type = type;
+		s.buffer = buf;
+		s.full.store(true, std::memory_order_release);
+		return true;
+	}
+
+	// Remove the oldest message, returning true if there was one. Only the main task calls this.
+	// If the producer of the oldest message has reserved its slot but not yet filled it, we return false and get it next time.
+	bool Dequeue(MessageType& type, OutputBuffer *&buf) noexcept
+	{
+		const uint32_t index = readIndex.load(std::memory_order_relaxed);
+		Slot& s = slots[index & (DeferredMessageQueueLength - 1)];
+		if (!s.full.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		type = s.type;
+		buf = s.buffer;
+		s.full.store(false, std::memory_order_relaxed);
+		readIndex.store(index + 1, std::memory_order_release);			// this releases the slot to the producers
+		return true;
+	}
+
+	bool IsEmpty() const noexcept { return readIndex.load(std::memory_order_relaxed) == reserveIndex.load(std::memory_order_relaxed); }
+
+private:
+	static_assert((DeferredMessageQueueLength & (DeferredMessageQueueLength - 1)) == 0, "DeferredMessageQueueLength must be a power of 2");
+
+	struct Slot
+	{
+		std::atomic<bool> full;												// set by the producer when it has filled the slot, cleared by the consumer
+		MessageType type;
+		OutputBuffer *buffer;
+	};
+
+	Slot slots[DeferredMessageQueueLength];
+	std::atomic<uint32_t> reserveIndex;										// the number of slots that have been reserved by producers, only ever incremented
+	std::atomic<uint32_t> readIndex;										// the number of messages that the consumer has removed
+};
+
+#endif /* SRC_PLATFORM_MESSAGEQUEUE_H_ */
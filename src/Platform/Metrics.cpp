@@ -0,0 +1,150 @@
+/*
+ * Metrics.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "Metrics.h"
+
+#if SUPPORT_METRICS
+
+#include "RepRap.h"
+#include "Platform.h"
+#include "Tasks.h"
+#include <Heating/Heat.h>
+#include <Heating/Heater.h>
+#include <Fans/FansManager.h>
+
+#if SUPPORT_CPU_USAGE_STATS
+# include "CpuUsage.h"
+#endif
+
+#if SUPPORT_CAN_EXPANSION
+# include <CAN/CanInterface.h>
+#endif
+
+namespace Metrics
+{
+	volatile uint32_t counters[NumCounters] = { 0 };
+
+	struct CounterName
+	{
+		Counter counter;
+		const char *_ecv_array name;
+	};
+
+	static constexpr CounterName CounterNames[] =
+	{
+		{ Counter::hiccups, "rrf_step_hiccups_total" },
+		{ Counter::stepErrors, "rrf_step_errors_total" },
+		{ Counter::lookaheadUnderruns, "rrf_lookahead_underruns_total" },
+		{ Counter::prepareUnderruns, "rrf_prepare_underruns_total" },
+		{ Counter::noMoveUnderruns, "rrf_no_move_underruns_total" },
+		{ Counter::outputBufferAllocationFailures, "rrf_output_buffer_starvation_total" },
+	};
+	static_assert(ARRAY_SIZE(CounterNames) == NumCounters);
+
+	static void AppendFloat(OutputBuffer *buf, float val, unsigned int numDigitsAfterPoint) noexcept
+	{
+		char temp[FloatFormatBufferSize];
+		const size_t len = FormatFloat(temp, val, numDigitsAfterPoint);
+		if (len != 0)
+		{
+			buf->cat(temp, len);
+		}
+		else
+		{
+			buf->catf(GetFloatFormatString(val, numDigitsAfterPoint), (double)val);
+		}
+		buf->cat('\n');
+	}
+
+	static void AppendType(OutputBuffer *buf, const char *_ecv_array name, bool isCounter) noexcept
+	{
+		buf->catf("# TYPE %s %s\n", name, (isCounter) ? "counter" : "gauge");
+	}
+
+	// Write the report. The total length is normally about 2K, so it fits in a few output buffers.
+	void Report(OutputBuffer *buf) noexcept
+	{
+		AppendType(buf, "rrf_uptime_seconds", true);
+		buf->catf("rrf_uptime_seconds %" PRIu32 "\n", (uint32_t)(millis64()/1000u));
+
+		for (const CounterName& cn : CounterNames)
+		{
+			AppendType(buf, cn.name, true);
+			buf->catf("%s %" PRIu32 "\n", cn.name, counters[(size_t)cn.counter]);
+		}
+
+		AppendType(buf, "rrf_free_ram_bytes", false);
+		buf->catf("rrf_free_ram_bytes %d\n", (int)Tasks::GetNeverUsedRam());
+
+#if HAS_CPU_TEMP_SENSOR
+		AppendType(buf, "rrf_mcu_temperature_celsius", false);
+		buf->cat("rrf_mcu_temperature_celsius ");
+		AppendFloat(buf, reprap.GetPlatform().GetMcuTemperatures().current, 1);
+#endif
+
+#if HAS_VOLTAGE_MONITOR
+		AppendType(buf, "rrf_vin_volts", false);
+		buf->cat("rrf_vin_volts ");
+		AppendFloat(buf, reprap.GetPlatform().GetCurrentPowerVoltage(), 1);
+#endif
+
+		// Heater temperatures. We skip heaters that don't exist.
+		const Heat& heat = reprap.GetHeat();
+		AppendType(buf, "rrf_heater_temperature_celsius", false);
+		for (size_t heater = 0; heater < heat.GetNumHeatersToReport(); ++heater)
+		{
+			const auto h = heat.FindHeater(heater);
+			if (h.IsNotNull())
+			{
+				buf->catf("rrf_heater_temperature_celsius{heater=\"%u\"} ", heater);
+				AppendFloat(buf, h->GetTemperature(), 1);
+			}
+		}
+
+		// Fan speeds. We skip fans that don't exist or have no tacho.
+		const FansManager& fans = reprap.GetFansManager();
+		AppendType(buf, "rrf_fan_rpm", false);
+		for (size_t fan = 0; fan < fans.GetNumFansToReport(); ++fan)
+		{
+			const int32_t rpm = fans.GetFanRPM(fan);
+			if (rpm >= 0)
+			{
+				buf->catf("rrf_fan_rpm{fan=\"%u\"} %" PRIi32 "\n", fan, rpm);
+			}
+		}
+
+#if SUPPORT_CPU_USAGE_STATS
+		AppendType(buf, "rrf_task_cpu_percent", false);
+		for (size_t i = 0; i < CpuUsage::GetNumTasks(); ++i)
+		{
+			buf->catf("rrf_task_cpu_percent{task=\"%s\"} ", CpuUsage::GetTaskName(i));
+			AppendFloat(buf, CpuUsage::GetTaskPercent(i), 1);
+		}
+		AppendType(buf, "rrf_isr_cpu_percent", false);
+		buf->cat("rrf_isr_cpu_percent{isr=\"step\"} ");
+		AppendFloat(buf, CpuUsage::GetIsrPercent(CpuUsage::IsrId::step), 2);
+		buf->cat("rrf_isr_cpu_percent{isr=\"drivers\"} ");
+		AppendFloat(buf, CpuUsage::GetIsrPercent(CpuUsage::IsrId::drivers), 2);
+		buf->cat("rrf_isr_cpu_percent{isr=\"network\"} ");
+		AppendFloat(buf, CpuUsage::GetIsrPercent(CpuUsage::IsrId::network), 2);
+#endif
+
+#if SUPPORT_CAN_EXPANSION
+		const CanInterface::Statistics stats = CanInterface::GetStatistics();
+		AppendType(buf, "rrf_can_messages_sent_total", true);
+		buf->catf("rrf_can_messages_sent_total %" PRIu32 "\n", stats.messagesSent);
+		AppendType(buf, "rrf_can_requests_sent_total", true);
+		buf->catf("rrf_can_requests_sent_total %" PRIu32 "\n", stats.requestsSent);
+		AppendType(buf, "rrf_can_reply_timeouts_total", true);
+		buf->catf("rrf_can_reply_timeouts_total %" PRIu32 "\n", stats.replyTimeouts);
+#endif
+	}
+}
+
+#endif
+
+// End
@@ -0,0 +1,43 @@
+/*
+ * Metrics.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  This provides the monotonic event counters and the plain text report for the HTTP /metrics request, which is in the Prometheus text format.
+ *  The report is written directly from the counters and from the getter functions of the modules concerned, without going through the object model,
+ *  so that a monitoring system can fetch a few dozen values cheaply. Unlike the counters reported by M122, the counters here are never reset,
+ *  as the Prometheus format requires, so the rate of an event can be found from two reports.
+ *  The movement counters are each incremented only by the step ISR or only by the Move task, so the increments don't need to be atomic. The output buffer counter can be incremented
+ *  by more than one task, so in rare cases a count may be lost, which doesn't matter for monitoring.
+ */
+
+#ifndef SRC_PLATFORM_METRICS_H_
+#define SRC_PLATFORM_METRICS_H_
+
+#include <RepRapFirmware.h>
+
+namespace Metrics
+{
+	enum class Counter : uint8_t
+	{
+		hiccups = 0,						// incremented by the step ISR
+		stepErrors,							// incremented by the Move task
+		lookaheadUnderruns,					// incremented by the Move task
+		prepareUnderruns,					// incremented by the step ISR
+		noMoveUnderruns,					// incremented by the step ISR
+		outputBufferAllocationFailures		// incremented by OutputBuffer::Allocate
+	};
+	constexpr size_t NumCounters = 6;
+
+#if SUPPORT_METRICS
+	extern volatile uint32_t counters[NumCounters];
+
+	inline void Increment(Counter c) noexcept { counters[(size_t)c] = counters[(size_t)c] + 1; }
+	void Report(OutputBuffer *buf) noexcept;
+#else
+	inline void Increment(Counter c) noexcept { }
+#endif
+}
+
+#endif /* SRC_PLATFORM_METRICS_H_ */
@@ -8,11 +8,20 @@
 #include "OutputMemory.h"
 #include "Platform.h"
 #include "RepRap.h"
+#include "Tasks.h"
+#include "Metrics.h"
 #include <cstdarg>
 
 /*static*/ OutputBuffer * volatile OutputBuffer::freeOutputBuffers = nullptr;		// Messages may also be sent by ISRs,
 /*static*/ volatile size_t OutputBuffer::usedOutputBuffers = 0;						// so make these volatile.
 /*static*/ volatile size_t OutputBuffer::maxUsedOutputBuffers = 0;
+/*static*/ volatile size_t OutputBuffer::totalOutputBuffers = 0;
+/*static*/ volatile size_t OutputBuffer::buffersHeld[(size_t)OutputBufferConsumer::numConsumers] = { 0 };
+/*static*/ unsigned int OutputBuffer::allocationFailures[(size_t)OutputBufferConsumer::numConsumers] = { 0 };
+/*static*/ unsigned int OutputBuffer::quotaRefusals[(size_t)OutputBufferConsumer::numConsumers] = { 0 };
+
+static const char *const OutputBufferConsumerNames[] = { "general", "HTTP", "Telnet", "FTP", "USB", "SBC" };
+static_assert(ARRAY_SIZE(OutputBufferConsumerNames) == (size_t)OutputBufferConsumer::numConsumers, "Wrong number of consumer names");
 
 //*************************************************************************************************
 // OutputBuffer class implementation
@@ -177,7 +186,7 @@ size_t OutputBuffer::cat(const char c) noexcept
 	{
 		// No - allocate a new item and copy the data
 		OutputBuffer *nextBuffer;
-		if (!Allocate(nextBuffer))
+		if (!Allocate(nextBuffer, consumer))
 		{
 			// We cannot store any more data
 			hadOverflow = true;
@@ -220,7 +229,7 @@ size_t OutputBuffer::cat(const char *_ecv_array src, size_t len) noexcept
 		{
 			// The last buffer is full
 			OutputBuffer *nextBuffer;
-			if (!Allocate(nextBuffer))
+			if (!Allocate(nextBuffer, consumer))
 			{
 				// We cannot store any more data, stop here
 				hadOverflow = true;
@@ -356,14 +365,42 @@ bool OutputBuffer::WriteToFile(FileData& f) const noexcept
 	{
 		freeOutputBuffers = new OutputBuffer(freeOutputBuffers);
 	}
+	totalOutputBuffers = OUTPUT_BUFFER_COUNT;
+}
+
+// Create an additional output buffer if we haven't reached the limit and enough never-used RAM would remain. Returns true if we created one.
+// This must not be called from within a critical section because it allocates memory from the heap.
+/*static*/ bool OutputBuffer::CreateBuffer() noexcept
+{
+	if (totalOutputBuffers >= MaxOutputBufferCount || Tasks::GetNeverUsedRam() < (ptrdiff_t)(MinFreeRamForPoolGrowth + sizeof(OutputBuffer)))
+	{
+		return false;
+	}
+
+	OutputBuffer * const newBuffer = new OutputBuffer(nullptr);
+	TaskCriticalSectionLocker lock;
+	newBuffer->next = freeOutputBuffers;
+	freeOutputBuffers = newBuffer;
+	++totalOutputBuffers;
+	return true;
 }
 
 // Allocates an output buffer instance which can be used for (large) string outputs. This must be thread safe. Not safe to call from interrupts!
-/*static*/ bool OutputBuffer::Allocate(OutputBuffer *&buf) noexcept
+// A consumer other than 'general' may only hold its quota of the buffers, so that a client that is slow to accept data can't prevent other clients getting replies.
+/*static*/ bool OutputBuffer::Allocate(OutputBuffer *&buf, OutputBufferConsumer consumer) noexcept
 {
+	const size_t consumerIndex = (size_t)consumer;
+	do
 	{
 		TaskCriticalSectionLocker lock;
 
+		if (consumer != OutputBufferConsumer::general && buffersHeld[consumerIndex] >= (totalOutputBuffers * OutputBufferQuotaPercent)/100)
+		{
+			++quotaRefusals[consumerIndex];
+			buf = nullptr;
+			return false;
+		}
+
 		buf = freeOutputBuffers;
 		if (buf != nullptr)
 		{
@@ -373,6 +410,7 @@ bool OutputBuffer::WriteToFile(FileData& f) const noexcept
 			{
 				maxUsedOutputBuffers = usedOutputBuffers;
 			}
+			buffersHeld[consumerIndex]++;
 
 			// Initialise the buffer before we release the lock in case another task uses it immediately
 			buf->next = nullptr;
@@ -381,12 +419,15 @@ bool OutputBuffer::WriteToFile(FileData& f) const noexcept
 			buf->references = 1;					// assume it's only used once by default
 			buf->isReferenced = false;
 			buf->hadOverflow = false;
+			buf->consumer = consumer;
 			buf->UpdateWhenQueued();				// use the time of allocation as the default when-used time
 
 			return true;
 		}
-	}
+	} while (CreateBuffer());						// if there were no free buffers, try to create another one
 
+	++allocationFailures[consumerIndex];
+	Metrics::Increment(Metrics::Counter::outputBufferAllocationFailures);
 	reprap.GetPlatform().LogError(ErrorCode::OutputStarvation);
 	return false;
 }
@@ -394,7 +435,7 @@ bool OutputBuffer::WriteToFile(FileData& f) const noexcept
 // Get the number of bytes left for continuous writing
 /*static*/ size_t OutputBuffer::GetBytesLeft(const OutputBuffer *writingBuffer) noexcept
 {
-	const size_t freeBuffers = OUTPUT_BUFFER_COUNT - usedOutputBuffers;
+	const size_t freeBuffers = totalOutputBuffers - usedOutputBuffers;
 	const size_t bytesLeft = OUTPUT_BUFFER_SIZE - writingBuffer->last->DataLength();
 
 	if (freeBuffers < RESERVED_OUTPUT_BUFFERS)
@@ -461,6 +502,7 @@ bool OutputBuffer::WriteToFile(FileData& f) const noexcept
 		buf->next = freeOutputBuffers;
 		freeOutputBuffers = buf;
 		usedOutputBuffers--;
+		buffersHeld[(size_t)buf->consumer]--;
 	}
 	return nextBuffer;
 }
@@ -475,8 +517,21 @@ bool OutputBuffer::WriteToFile(FileData& f) const noexcept
 
 /*static*/ void OutputBuffer::Diagnostics(MessageType mtype) noexcept
 {
-	reprap.GetPlatform().MessageF(mtype, "Used output buffers: %d of %d (%d max)\n",
-			usedOutputBuffers, OUTPUT_BUFFER_COUNT, maxUsedOutputBuffers);
+	reprap.GetPlatform().MessageF(mtype, "Used output buffers: %d of %d (%d max, limit %d)\n",
+			usedOutputBuffers, totalOutputBuffers, maxUsedOutputBuffers, MaxOutputBufferCount);
+
+	// Report the buffers held and the allocation failures of each consumer, then clear the failure counts
+	String<StringLength256> consumerStats;
+	for (size_t i = 0; i < (size_t)OutputBufferConsumer::numConsumers; ++i)
+	{
+		consumerStats.catf("%s%s %u", (i == 0) ? "" : ", ", OutputBufferConsumerNames[i], (unsigned int)buffersHeld[i]);
+		if (allocationFailures[i] != 0 || quotaRefusals[i] != 0)
+		{
+			consumerStats.catf(" (%u failed, %u over quota)", allocationFailures[i], quotaRefusals[i]);
+		}
+		allocationFailures[i] = quotaRefusals[i] = 0;
+	}
+	reprap.GetPlatform().MessageF(mtype, "Output buffers held: %s\n", consumerStats.c_str());
 }
 
 //*************************************************************************************************
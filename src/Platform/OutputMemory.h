@@ -17,6 +17,18 @@ const size_t OUTPUT_STACK_DEPTH = 64;	// Number of OutputBuffer chains that can
 const size_t OUTPUT_STACK_DEPTH = 4;	// Number of OutputBuffer chains that can be pushed onto one stack instance
 #endif
 
+// Consumers of output buffers. All except 'general' are limited to a share of the buffers, so that one slow consumer can't starve the others.
+enum class OutputBufferConsumer : uint8_t
+{
+	general = 0,
+	http,
+	telnet,
+	ftp,
+	usb,
+	sbc,
+	numConsumers
+};
+
 // This class is used to hold data for sending (either for Serial or Network destinations)
 class OutputBuffer
 {
@@ -73,7 +85,10 @@ public:
 	static void Init() noexcept;
 
 	// Allocate an unused OutputBuffer instance. Returns true on success or false if no instance could be allocated.
-	static bool Allocate(OutputBuffer *&buf) noexcept;
+	static bool Allocate(OutputBuffer *&buf) noexcept { return Allocate(buf, OutputBufferConsumer::general); }
+
+	// Allocate an unused OutputBuffer instance on behalf of a consumer that is subject to a quota
+	static bool Allocate(OutputBuffer *&buf, OutputBufferConsumer consumer) noexcept;
 
 	// Get the number of bytes left for allocation. If writingBuffer is not NULL, this returns the number of free bytes for
 	// continuous writes, i.e. for writes that need to allocate an extra OutputBuffer instance to finish the message.
@@ -90,10 +105,11 @@ public:
 
 	static void Diagnostics(MessageType mtype) noexcept;
 
-	static unsigned int GetFreeBuffers() noexcept { return OUTPUT_BUFFER_COUNT - usedOutputBuffers; }
+	static unsigned int GetFreeBuffers() noexcept { return totalOutputBuffers - usedOutputBuffers; }
 
 private:
 	void Clear() noexcept;
+	static bool CreateBuffer() noexcept;
 
 	OutputBuffer *null next;
 	OutputBuffer *last;
@@ -105,11 +121,16 @@ private:
 
 	bool isReferenced;
 	bool hadOverflow;
+	OutputBufferConsumer consumer;							// who allocated this buffer, which is also who extends the chain
 	volatile size_t references;
 
 	static OutputBuffer * volatile freeOutputBuffers;		// Messages may be sent by multiple tasks
 	static volatile size_t usedOutputBuffers;				// so make these volatile.
 	static volatile size_t maxUsedOutputBuffers;
+	static volatile size_t totalOutputBuffers;				// the number of buffers we have created, which grows on demand up to MaxOutputBufferCount
+	static volatile size_t buffersHeld[(size_t)OutputBufferConsumer::numConsumers];
+	static unsigned int allocationFailures[(size_t)OutputBufferConsumer::numConsumers];
+	static unsigned int quotaRefusals[(size_t)OutputBufferConsumer::numConsumers];
 };
 
 inline uint32_t OutputBuffer::GetAge() const noexcept
@@ -44,6 +44,8 @@
 #include <Hardware/NonVolatileMemory.h>
 #include <Storage/CRC32.h>
 #include <Accelerometers/Accelerometers.h>
+#include <Accelerometers/ResonanceAnalyser.h>
+#include <GCodes/ParserBenchmark.h>
 
 #if SAM4E || SAM4S || SAME70
 # include <AnalogIn.h>
@@ -220,6 +222,24 @@ constexpr ObjectModelArrayDescriptor Platform::workplaceOffsetsArrayDescriptor =
 			{ return ExpressionValue(reprap.GetGCodes().GetWorkplaceOffset(context.GetIndex(1), context.GetIndex(0)), 3); }
 };
 
+#if SUPPORT_REMOTE_COMMANDS
+
+constexpr ObjectModelArrayDescriptor Platform::timeSyncCorrectionsArrayDescriptor =
+{
+	nullptr,					// no lock needed
+	[] (const ObjectModel *self, const ObjectExplorationContext& context) noexcept -> size_t { return StepTimer::NumCorrectionBuckets; },
+	[] (const ObjectModel *self, ObjectExplorationContext& context) noexcept -> ExpressionValue
+			{ return ExpressionValue((int32_t)StepTimer::GetCorrectionCount(context.GetLastIndex())); }
+};
+
+// Convert a time sync statistic from step clocks to microseconds
+static inline float StepClocksToMicroseconds(int32_t ticks) noexcept
+{
+	return (float)ticks * (1.0e6/StepClockRate);
+}
+
+#endif
+
 static inline const char *_ecv_array GetFilamentName(size_t extruder) noexcept
 {
 	const Filament *fil = Filament::GetFilamentByExtruder(extruder);
@@ -233,6 +253,7 @@ constexpr ObjectModelTableEntry Platform::objectModelTable[] =
 	{ "accelerometer",		OBJECT_MODEL_FUNC_IF(Accelerometers::HasLocalAccelerometer(), self, 9),								ObjectModelEntryFlags::none },
 #endif
 #if SUPPORT_CAN_EXPANSION
+	{ "can",				OBJECT_MODEL_FUNC(self, 11),																		ObjectModelEntryFlags::live },
 	{ "canAddress",			OBJECT_MODEL_FUNC_NOSELF((int32_t)CanInterface::GetCanAddress()),									ObjectModelEntryFlags::none },
 #endif
 #if SUPPORT_12864_LCD
@@ -261,6 +282,9 @@ constexpr ObjectModelTableEntry Platform::objectModelTable[] =
 	{ "shortName",			OBJECT_MODEL_FUNC_NOSELF(BOARD_SHORT_NAME),															ObjectModelEntryFlags::none },
 #endif
 	{ "supportsDirectDisplay", OBJECT_MODEL_FUNC_NOSELF(SUPPORT_12864_LCD ? true : false),										ObjectModelEntryFlags::verbose },
+#if SUPPORT_REMOTE_COMMANDS
+	{ "timeSync",			OBJECT_MODEL_FUNC_IF(CanInterface::InExpansionMode(), self, 10),									ObjectModelEntryFlags::none },
+#endif
 #if MCU_HAS_UNIQUE_ID
 	{ "uniqueId",			OBJECT_MODEL_FUNC_IF(self->uniqueId.IsValid(), self->uniqueId),										ObjectModelEntryFlags::none },
 #endif
@@ -352,16 +376,41 @@ constexpr ObjectModelTableEntry Platform::objectModelTable[] =
 
 #if SUPPORT_ACCELEROMETERS
 	// 9. boards[0].accelerometer members
+	{ "analysis",			OBJECT_MODEL_FUNC_NOSELF(Accelerometers::GetLocalAnalysis(), 0),												ObjectModelEntryFlags::none },
 	{ "points",				OBJECT_MODEL_FUNC_NOSELF((int32_t)Accelerometers::GetLocalAccelerometerDataPoints()),						ObjectModelEntryFlags::none },
 	{ "runs",				OBJECT_MODEL_FUNC_NOSELF((int32_t)Accelerometers::GetLocalAccelerometerRuns()),								ObjectModelEntryFlags::none },
 #endif
+
+#if SUPPORT_REMOTE_COMMANDS
+	// 10. boards[0].timeSync members
+	{ "corrections",		OBJECT_MODEL_FUNC_NOSELF(&timeSyncCorrectionsArrayDescriptor),												ObjectModelEntryFlags::none },
+	{ "maxCorrection",		OBJECT_MODEL_FUNC_NOSELF(StepClocksToMicroseconds(StepTimer::GetPeakPosJitter()), 1),						ObjectModelEntryFlags::none },
+	{ "maxRxDelay",			OBJECT_MODEL_FUNC_NOSELF(StepClocksToMicroseconds(StepTimer::GetPeakReceiveDelay()), 1),					ObjectModelEntryFlags::none },
+	{ "maxTxDelay",			OBJECT_MODEL_FUNC_NOSELF(StepClocksToMicroseconds(StepTimer::GetPeakTransmitDelay()), 1),					ObjectModelEntryFlags::none },
+	{ "meanRxDelay",		OBJECT_MODEL_FUNC_NOSELF(StepClocksToMicroseconds(StepTimer::GetMeanReceiveDelay()), 1),					ObjectModelEntryFlags::none },
+	{ "meanTxDelay",		OBJECT_MODEL_FUNC_NOSELF(StepClocksToMicroseconds(StepTimer::GetMeanTransmitDelay()), 1),					ObjectModelEntryFlags::none },
+	{ "minCorrection",		OBJECT_MODEL_FUNC_NOSELF(StepClocksToMicroseconds(StepTimer::GetPeakNegJitter()), 1),						ObjectModelEntryFlags::none },
+	{ "synced",				OBJECT_MODEL_FUNC_NOSELF(StepTimer::IsSynced()),															ObjectModelEntryFlags::none },
+#endif
+
+#if SUPPORT_CAN_EXPANSION
+	// 11. boards[0].can members
+	{ "bytesSent",			OBJECT_MODEL_FUNC_NOSELF((int32_t)CanInterface::GetStatistics().bytesSent),								ObjectModelEntryFlags::live },
+	{ "maxReplyTime",		OBJECT_MODEL_FUNC_NOSELF((int32_t)CanInterface::GetStatistics().maxReplyTime),								ObjectModelEntryFlags::live },
+	{ "maxTxWait",			OBJECT_MODEL_FUNC_NOSELF((int32_t)CanInterface::GetStatistics().maxTxWait),									ObjectModelEntryFlags::live },
+	{ "meanReplyTime",		OBJECT_MODEL_FUNC_NOSELF(CanInterface::GetStatistics().meanReplyTime, 1),									ObjectModelEntryFlags::live },
+	{ "messagesSent",		OBJECT_MODEL_FUNC_NOSELF((int32_t)CanInterface::GetStatistics().messagesSent),								ObjectModelEntryFlags::live },
+	{ "motionMessagesSent",	OBJECT_MODEL_FUNC_NOSELF((int32_t)CanInterface::GetStatistics().motionMessagesSent),						ObjectModelEntryFlags::live },
+	{ "replyTimeouts",		OBJECT_MODEL_FUNC_NOSELF((int32_t)CanInterface::GetStatistics().replyTimeouts),								ObjectModelEntryFlags::live },
+	{ "requestsSent",		OBJECT_MODEL_FUNC_NOSELF((int32_t)CanInterface::GetStatistics().requestsSent),								ObjectModelEntryFlags::live },
+#endif
 };
 
 constexpr uint8_t Platform::objectModelTableDescriptor[] =
 {
-	10,																		// number of sections
+	12,																		// number of sections
 	9 + SUPPORT_ACCELEROMETERS + HAS_SBC_INTERFACE + HAS_MASS_STORAGE + HAS_VOLTAGE_MONITOR + HAS_12V_MONITOR + HAS_CPU_TEMP_SENSOR
-	  + SUPPORT_CAN_EXPANSION + SUPPORT_12864_LCD + MCU_HAS_UNIQUE_ID + HAS_WIFI_NETWORKING,		// section 0: boards[0]
+	  + 2 * SUPPORT_CAN_EXPANSION + SUPPORT_12864_LCD + MCU_HAS_UNIQUE_ID + HAS_WIFI_NETWORKING + SUPPORT_REMOTE_COMMANDS,		// section 0: boards[0]
 #if HAS_CPU_TEMP_SENSOR
 	3,																		// section 1: mcuTemp
 #else
@@ -388,7 +437,17 @@ constexpr uint8_t Platform::objectModelTableDescriptor[] =
 	2,																		// section 7: move.axes[].microstepping
 	2,																		// section 8: move.extruders[].microstepping
 #if SUPPORT_ACCELEROMETERS
-	2,																		// section 9: boards[0].accelerometer
+	3,																		// section 9: boards[0].accelerometer
+#else
+	0,
+#endif
+#if SUPPORT_REMOTE_COMMANDS
+	8,																		// section 10: boards[0].timeSync
+#else
+	0,
+#endif
+#if SUPPORT_CAN_EXPANSION
+	8,																		// section 11: boards[0].can
 #else
 	0,
 #endif
@@ -484,6 +543,7 @@ void Platform::Init() noexcept
 	baudRates[0] = MAIN_BAUD_RATE;
 	commsParams[0] = 0;
 	usbMutex.Create("USB");
+	messagesDeferred = deferredMessagesDropped = 0;
 #if SAME5x
     SERIAL_MAIN_DEVICE.Start();
 #elif defined(__LPC17xx__)
@@ -753,6 +813,7 @@ void Platform::Init() noexcept
 #if HAS_VOLTAGE_MONITOR
 	autoSaveEnabled = false;
 	autoSaveState = AutoSaveState::starting;
+	powerFailDetected = false;
 #endif
 
 #if HAS_SMART_DRIVERS && (HAS_VOLTAGE_MONITOR || HAS_12V_MONITOR)
@@ -939,6 +1000,8 @@ void Platform::SetNetMask(IPAddress nm) noexcept
 // Flush messages to USB and aux, returning true if there is more to send
 bool Platform::FlushMessages() noexcept
 {
+	SendDeferredMessages();
+
 	bool auxHasMore = false;
 #if HAS_AUX_DEVICES
 	for (AuxDevice& dev : auxDevices)
@@ -997,6 +1060,11 @@ void Platform::Spin() noexcept
 		return;
 	}
 
+#if HAS_VOLTAGE_MONITOR
+	// Do this first so that a power failure is acted on as soon as possible
+	CheckForPowerFail();
+#endif
+
 #if SUPPORT_REMOTE_COMMANDS
 	if (CanInterface::InExpansionMode())
 	{
@@ -1017,12 +1085,24 @@ void Platform::Spin() noexcept
 	{
 		digitalWrite(ActLedPin, !ActOnPolarity);
 	}
+
+	CanInterface::PollDeferredReplies();
 #endif
 
 #if HAS_MASS_STORAGE || HAS_SBC_INTERFACE || HAS_EMBEDDED_FILES
 	MassStorage::Spin();
 #endif
 
+	// Write any scheduled changes to nonvolatile memory when the machine is not moving, because erasing and writing the flash page stalls this task
+	// and may hold off the step interrupt
+	if (   NonVolatileMemory::HasPendingChanges()
+		&& millis() - NonVolatileMemory::WhenLastChangeScheduled() >= NonVolatileMemory::PendingChangesWriteDelay
+		&& reprap.GetMove().NoLiveMovement()
+	   )
+	{
+		NonVolatileMemory::WritePendingChanges();
+	}
+
 	// Try to flush messages to serial ports
 	(void)FlushMessages();
 
@@ -1338,46 +1418,6 @@ void Platform::Spin() noexcept
 		}
 	}
 
-#if HAS_VOLTAGE_MONITOR
-	// Check for auto-pause, shutdown or resume
-	if (autoSaveEnabled)
-	{
-		switch (autoSaveState)
-		{
-		case AutoSaveState::starting:
-			// Some users set the auto resume threshold high to disable auto resume, so prime auto save at the auto save threshold plus half a volt
-			if (currentVin >= autoResumeReading || currentVin > autoPauseReading + PowerVoltageToAdcReading(0.5))
-			{
-				autoSaveState = AutoSaveState::normal;
-			}
-			break;
-
-		case AutoSaveState::normal:
-			if (currentVin < autoPauseReading)
-			{
-				if (reprap.GetGCodes().LowVoltagePause())
-				{
-					autoSaveState = AutoSaveState::autoPaused;
-				}
-			}
-			break;
-
-		case AutoSaveState::autoPaused:
-			if (currentVin >= autoResumeReading)
-			{
-				if (reprap.GetGCodes().LowVoltageResume())
-				{
-					autoSaveState = AutoSaveState::normal;
-				}
-			}
-			break;
-
-		default:
-			break;
-		}
-	}
-#endif
-
 #if HAS_MASS_STORAGE
 	// Flush the log file if it is time. This may take some time, so do it last.
 	if (logger != nullptr)
@@ -1422,6 +1462,49 @@ bool Platform::HasVinPower() const noexcept
 
 #if HAS_VOLTAGE_MONITOR
 
+// Check for auto-pause, shutdown or resume
+void Platform::CheckForPowerFail() noexcept
+{
+	if (autoSaveEnabled)
+	{
+		switch (autoSaveState)
+		{
+		case AutoSaveState::starting:
+			// Some users set the auto resume threshold high to disable auto resume, so prime auto save at the auto save threshold plus half a volt
+			if (currentVin >= autoResumeReading || currentVin > autoPauseReading + PowerVoltageToAdcReading(0.5))
+			{
+				powerFailDetected = false;
+				autoSaveState = AutoSaveState::normal;
+			}
+			break;
+
+		case AutoSaveState::normal:
+			if (powerFailDetected || currentVin < autoPauseReading)
+			{
+				powerFailDetected = false;
+				if (reprap.GetGCodes().LowVoltagePause())
+				{
+					autoSaveState = AutoSaveState::autoPaused;
+				}
+			}
+			break;
+
+		case AutoSaveState::autoPaused:
+			if (currentVin >= autoResumeReading)
+			{
+				if (reprap.GetGCodes().LowVoltageResume())
+				{
+					autoSaveState = AutoSaveState::normal;
+				}
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
 void Platform::DisableAutoSave() noexcept
 {
 	autoSaveEnabled = false;
@@ -1663,6 +1746,7 @@ void Platform::Diagnostics(MessageType mtype) noexcept
 	// Show the up time and reason for the last reset
 	const uint32_t now = (uint32_t)(millis64()/1000u);		// get up time in seconds
 	MessageF(mtype, "Last reset %02d:%02d:%02d ago, cause: %s\n", (unsigned int)(now/3600), (unsigned int)((now % 3600)/60), (unsigned int)(now % 60), GetResetReasonText());
+	MessageF(mtype, "Messages from other tasks: queued %" PRIu32 ", dropped %" PRIu32 "\n", messagesDeferred.load(), deferredMessagesDropped.load());
 
 	// Show the reset code stored at the last software reset
 	{
@@ -1742,6 +1826,13 @@ void Platform::Diagnostics(MessageType mtype) noexcept
 	StringHandle::Diagnostics(mtype, *this);
 	Event::Diagnostics(mtype, *this);
 
+#if SUPPORT_ASYNC_LOGGING
+	if (logger != nullptr)
+	{
+		logger->Diagnostics(mtype);
+	}
+#endif
+
 	// Show the motor position and stall status
 	for (size_t drive = 0; drive < NumDirectDrivers; ++drive)
 	{
@@ -1786,7 +1877,7 @@ void Platform::Diagnostics(MessageType mtype) noexcept
 
 #if 0
 	// Debugging temperature readings
-	const uint32_t div = ThermistorAveragingFilter::NumAveraged() >> 2;		// 2 oversample bits
+	const uint32_t div = ThermistorAverageReadings >> 2;		// 2 oversample bits
 	MessageF(mtype, "Vssa %" PRIu32 " Vref %" PRIu32 " Temp0 %" PRIu32 " Temp1 %" PRIu32 "\n",
 			adcFilters[VssaFilterIndex].GetSum()/div, adcFilters[VrefFilterIndex].GetSum()/div, adcFilters[0].GetSum()/div, adcFilters[1].GetSum()/div);
 #endif
@@ -1797,10 +1888,14 @@ void Platform::Diagnostics(MessageType mtype) noexcept
 #endif
 
 #ifdef I2C_IFACE
-	const TwoWire::ErrorCounts errs = I2C_IFACE.GetErrorCounts(true);
-	MessageF(mtype, "I2C nak errors %" PRIu32 ", send timeouts %" PRIu32 ", receive timeouts %" PRIu32 ", finishTimeouts %" PRIu32 ", resets %" PRIu32 "\n",
-		errs.naks, errs.sendTimeouts, errs.recvTimeouts, errs.finishTimeouts, errs.resets);
+	I2C::Diagnostics(mtype);
 #endif
+
+	SharedSpiDevice * const sspi = SharedSpiDevice::GetMainSharedSpiDevicePointer();
+	if (sspi != nullptr)
+	{
+		sspi->Diagnostics(mtype);
+	}
 }
 
 // Execute a timed square root that takes less than one millisecond
@@ -2332,6 +2427,51 @@ GCodeResult Platform::DiagnosticTest(GCodeBuffer& gb, const StringRef& reply, Ou
 #endif
 		break;
 
+	case (unsigned int)DiagnosticTestType::TimeGCodeParsing:
+#if SUPPORT_PARSER_BENCHMARK && HAS_MASS_STORAGE
+		return ParserBenchmark::Run(gb, reply);
+#else
+		reply.copy("Parser benchmark not supported by this build");
+		return GCodeResult::errorNotSupported;
+#endif
+
+	case (unsigned int)DiagnosticTestType::TimeFloatFormatting:
+		{
+			// Use values spread over the range of temperatures, coordinates and speeds that we report, with the precisions that the object model uses
+			constexpr unsigned int NumValues = 1000;
+			char fastText[FloatFormatBufferSize];
+			char printfText[50];
+			uint32_t fastTicks = 0, printfTicks = 0;
+			unsigned int numFallbacks = 0, numMismatches = 0;
+			for (unsigned int i = 0; i < NumValues; ++i)
+			{
+				const float val = (float)((int)(i * 7919u % 20000u) - 10000) * (float)(1u << (i % 8)) * 0.0137;
+				const unsigned int numDigits = (i % 3) + 1;
+				const uint32_t startTicks = StepTimer::GetTimerTicks();
+				const size_t len = FormatFloat(fastText, val, numDigits);
+				const uint32_t midTicks = StepTimer::GetTimerTicks();
+				SafeSnprintf(printfText, sizeof(printfText), GetFloatFormatString(val, numDigits), (double)val);
+				printfTicks += StepTimer::GetTimerTicks() - midTicks;
+				fastTicks += midTicks - startTicks;
+				if (len == 0)
+				{
+					++numFallbacks;
+				}
+				else if (strcmp(fastText, printfText) != 0)
+				{
+					++numMismatches;
+				}
+			}
+			const float ticksToMicroseconds = 1'000'000.0/((float)StepClockRate * (float)NumValues);
+			reply.printf("Formatted %u floats: FormatFloat %.2fus each, printf %.2fus each, %u fallbacks, %u mismatches",
+							NumValues, (double)(fastTicks * ticksToMicroseconds), (double)(printfTicks * ticksToMicroseconds), numFallbacks, numMismatches);
+			if (numMismatches != 0)
+			{
+				return GCodeResult::error;
+			}
+		}
+		break;
+
 #if HAS_VOLTAGE_MONITOR
 	case (unsigned int)DiagnosticTestType::UndervoltageEvent:
 		reprap.GetGCodes().LowVoltagePause();
@@ -3247,6 +3387,21 @@ void Platform::AppendAuxReply(size_t auxNumber, OutputBuffer *reply, bool rawMes
 	}
 }
 
+// Send an unsolicited status report to an aux device, unless it is the same as the last one and that was sent recently
+void Platform::AppendAuxStatusReport(size_t auxNumber, OutputBuffer *buf) noexcept
+{
+#if HAS_AUX_DEVICES
+	if (auxNumber < ARRAY_SIZE(auxDevices) && !(auxNumber == 0 && reprap.GetGCodes().IsFlashingPanelDue()))
+	{
+		auxDevices[auxNumber].AppendStatusReport(buf);
+	}
+	else
+#endif
+	{
+		OutputBuffer::ReleaseAll(buf);
+	}
+}
+
 // Send the specified message to the specified destinations. The Error and Warning flags have already been handled.
 void Platform::RawMessage(MessageType type, const char *_ecv_array message) noexcept
 {
@@ -3309,7 +3464,7 @@ void Platform::RawMessage(MessageType type, const char *_ecv_array message) noex
 			OutputBuffer *usbOutputBuffer = usbOutput.GetLastItem();
 			if (usbOutputBuffer == nullptr || usbOutputBuffer->IsReferenced())
 			{
-				if (OutputBuffer::Allocate(usbOutputBuffer))
+				if (OutputBuffer::Allocate(usbOutputBuffer, OutputBufferConsumer::usb))
 				{
 					if (usbOutput.Push(usbOutputBuffer))
 					{
@@ -3326,11 +3481,63 @@ void Platform::RawMessage(MessageType type, const char *_ecv_array message) noex
 	}
 }
 
+// Return true if the message must be queued for the main task to send instead of being sent now.
+// Blocking messages are only used for debugging, so we send those immediately whichever task they come from.
+bool Platform::MustDeferMessage(MessageType type) const noexcept
+{
+	return (type & BlockingUsbMessage) == 0 && RTOSIface::GetCurrentTask() != Tasks::GetMainTask();
+}
+
+// Allocate a buffer for a message to be deferred and add the error or warning prefix, returning nullptr if we can't get a buffer
+OutputBuffer *Platform::StartDeferredMessage(MessageType type) noexcept
+{
+	OutputBuffer *buf;
+	if (!OutputBuffer::Allocate(buf))
+	{
+		++deferredMessagesDropped;
+		return nullptr;
+	}
+	buf->copy(((type & ErrorMessageFlag) != 0) ? "Error: " : ((type & WarningMessageFlag) != 0) ? "Warning: " : "");
+	return buf;
+}
+
+// Queue a message for the main task to send. This never waits, so it is safe to call from the Move and Heat tasks.
+// The buffer is released if the queue is full. The Error and Warning flags must already have been handled.
+void Platform::DeferMessage(MessageType type, OutputBuffer *buffer) noexcept
+{
+	if (deferredMessages.Enqueue(type, buffer))
+	{
+		++messagesDeferred;
+	}
+	else
+	{
+		OutputBuffer::ReleaseAll(buffer);
+		++deferredMessagesDropped;
+	}
+}
+
+// Send the messages that other tasks have queued. Called by the main task only.
+void Platform::SendDeferredMessages() noexcept
+{
+	MessageType type;
+	OutputBuffer *buffer;
+	while (deferredMessages.Dequeue(type, buffer))
+	{
+		Message(type, buffer);
+	}
+}
+
 // Note: this overload of Platform::Message does not process the special action flags in the MessageType.
 // Also it treats calls to send a blocking USB message the same as ordinary USB messages,
 // and calls to send an immediate LCD message the same as ordinary LCD messages
 void Platform::Message(const MessageType type, OutputBuffer *buffer) noexcept
 {
+	if (MustDeferMessage(type))
+	{
+		DeferMessage(type, buffer);
+		return;
+	}
+
 #if HAS_MASS_STORAGE
 	// First deal with logging because it doesn't hang on to the buffer
 	if (logger != nullptr)
@@ -3414,6 +3621,17 @@ void Platform::Message(const MessageType type, OutputBuffer *buffer) noexcept
 
 void Platform::MessageV(MessageType type, const char *_ecv_array fmt, va_list vargs) noexcept
 {
+	if (MustDeferMessage(type))
+	{
+		OutputBuffer * const buf = StartDeferredMessage(type);
+		if (buf != nullptr)
+		{
+			buf->vcatf(fmt, vargs);
+			DeferMessage((MessageType)(type & ~(ErrorMessageFlag | WarningMessageFlag)), buf);
+		}
+		return;
+	}
+
 	String<FormatStringLength> formatString;
 #if HAS_SBC_INTERFACE
 	if (reprap.UsingSbcInterface() && ((type & GenericMessage) == GenericMessage || (type & BinaryCodeReplyFlag) != 0))
@@ -3455,6 +3673,17 @@ void Platform::MessageF(MessageType type, const char *_ecv_array fmt, ...) noexc
 
 void Platform::Message(MessageType type, const char *_ecv_array message) noexcept
 {
+	if (MustDeferMessage(type))
+	{
+		OutputBuffer * const buf = StartDeferredMessage(type);
+		if (buf != nullptr)
+		{
+			buf->cat(message);
+			DeferMessage((MessageType)(type & ~(ErrorMessageFlag | WarningMessageFlag)), buf);
+		}
+		return;
+	}
+
 #if HAS_SBC_INTERFACE
 	if (reprap.UsingSbcInterface() &&
 		((type & BinaryCodeReplyFlag) != 0 || (type & GenericMessage) == GenericMessage || (type & LogOff) != LogOff))
@@ -4067,6 +4296,15 @@ FileStore* Platform::OpenSysFile(const char *_ecv_array filename, OpenMode mode)
 				: nullptr;
 }
 
+// Open a system file or a macro file for running as a macro
+FileStore* Platform::OpenSysMacroFile(const char *_ecv_array filename) const noexcept
+{
+	String<MaxFilenameLength> location;
+	return (MakeSysFileName(location.GetRef(), filename))
+			? MassStorage::OpenMacroFile(location.c_str())
+				: nullptr;
+}
+
 bool Platform::MakeSysFileName(const StringRef& result, const char *_ecv_array filename) const noexcept
 {
 	return MassStorage::CombineName(result, GetSysDir().Ptr(), filename);
@@ -5297,6 +5535,14 @@ void Platform::Tick() noexcept
 			lowestVin = currentVin;
 			reprap.BoardsUpdated();
 		}
+
+		// If VIN has just dropped below the auto save threshold, record it and suspend the local heaters now to save energy for the pause.
+		// Platform::Spin does the rest, but it may not run again for several milliseconds.
+		if (autoSaveEnabled && autoSaveState == AutoSaveState::normal && currentVin < autoPauseReading && !powerFailDetected)
+		{
+			powerFailDetected = true;
+			reprap.GetHeat().SuspendLocalHeatersFromISR();
+		}
 # endif
 
 # if HAS_12V_MONITOR
@@ -30,6 +30,7 @@ Licence: GPL
 #include <Fans/FansManager.h>
 #include <Heating/TemperatureError.h>
 #include "OutputMemory.h"
+#include "MessageQueue.h"
 #include "UniqueId.h"
 #include <Storage/FileStore.h>
 #include <Storage/FileData.h>
@@ -100,6 +101,13 @@ constexpr unsigned int ThermistorAverageReadings = 16;
 constexpr unsigned int ThermistorAverageReadings = 16;
 #endif
 
+// The maximum number of readings that M308 may configure a thermistor input to average. ThermistorAverageReadings is the default.
+#if SAME70 || SAME5x
+constexpr unsigned int MaxThermistorAverageReadings = 64;
+#else
+constexpr unsigned int MaxThermistorAverageReadings = ThermistorAverageReadings;
+#endif
+
 #if SAME5x
 constexpr unsigned int TempSenseAverageReadings = 16;
 #endif
@@ -173,6 +181,8 @@ enum class DiagnosticTestType : unsigned int
 	TimeCRC32 = 107,				// time how long it takes to calculate CRC32
 	TimeGetTimerTicks = 108,		// time now long it takes to read the step clock
 	UndervoltageEvent = 109,		// pretend an undervoltage condition has occurred
+	TimeGCodeParsing = 110,			// time how long it takes to parse the G-code and expressions in a file
+	TimeFloatFormatting = 111,		// time how long it takes to format floats using FormatFloat and using printf, and check that the results agree
 
 #ifdef __LPC17xx__
 	PrintBoardConfiguration = 200,	// Prints out all pin/values loaded from SDCard to configure board
@@ -194,11 +204,13 @@ enum class DiagnosticTestType : unsigned int
 /***************************************************************************************************************/
 
 // Class to perform averaging of values read from the ADC
-// numAveraged should be a power of 2 for best efficiency
-template<size_t numAveraged> class AveragingFilter
+// The number of readings averaged may be changed at run time up to maxAveraged. It should be a power of 2 for best efficiency.
+template<size_t maxAveraged, size_t defaultAveraged = maxAveraged> class AveragingFilter
 {
 public:
-	AveragingFilter() noexcept
+	static_assert(defaultAveraged <= maxAveraged, "Bad default number of readings");
+
+	AveragingFilter() noexcept : numAveraged(defaultAveraged)
 	{
 		Init(0);
 	}
@@ -216,6 +228,16 @@ public:
 		}
 	}
 
+	// Change the number of readings averaged, which must be between 1 and maxAveraged. The filter restarts from the current average.
+	void SetNumAveraged(size_t n) volatile noexcept pre(n != 0; n <= maxAveraged)
+	{
+		AtomicCriticalSectionLocker lock;
+
+		const uint16_t average = sum/numAveraged;
+		numAveraged = n;
+		Init(average);
+	}
+
 	// Call this to put a new reading into the filter
 	// This is called by the ISR and by the ADC callback function
 	void ProcessReading(uint16_t r) volatile noexcept
@@ -224,7 +246,7 @@ public:
 		sum = sum - readings[locIndex] + r;
 		readings[locIndex] = r;
 		++locIndex;
-		if (locIndex == numAveraged)
+		if (locIndex >= numAveraged)
 		{
 			locIndex = 0;
 			isValid = true;
@@ -244,26 +266,29 @@ public:
 		return isValid;
 	}
 
-	static constexpr size_t NumAveraged() noexcept { return numAveraged; }
+	size_t NumAveraged() const volatile noexcept { return numAveraged; }
+	static constexpr size_t MaxAveraged() noexcept { return maxAveraged; }
 
 	// Function used as an ADC callback to feed a result into an averaging filter
 	static void CallbackFeedIntoFilter(CallbackParameter cp, uint16_t val) noexcept;
 
 private:
-	uint16_t readings[numAveraged];
+	uint16_t readings[maxAveraged];
 	size_t index;
 	uint32_t sum;
+	uint16_t numAveraged;
 	bool isValid;
-	//invariant(sum == + over readings)
+	//invariant(sum == + over readings[0..numAveraged-1])
 	//invariant(index < numAveraged)
+	//invariant(numAveraged <= maxAveraged)
 };
 
-template<size_t numAveraged> void AveragingFilter<numAveraged>::CallbackFeedIntoFilter(CallbackParameter cp, uint16_t val) noexcept
+template<size_t maxAveraged, size_t defaultAveraged> void AveragingFilter<maxAveraged, defaultAveraged>::CallbackFeedIntoFilter(CallbackParameter cp, uint16_t val) noexcept
 {
-	static_cast<AveragingFilter<numAveraged>*>(cp.vp)->ProcessReading(val);
+	static_cast<AveragingFilter<maxAveraged, defaultAveraged>*>(cp.vp)->ProcessReading(val);
 }
 
-typedef AveragingFilter<ThermistorAverageReadings> ThermistorAveragingFilter;
+typedef AveragingFilter<MaxThermistorAverageReadings, ThermistorAverageReadings> ThermistorAveragingFilter;
 typedef AveragingFilter<ZProbeAverageReadings> ZProbeAveragingFilter;
 
 #if SAME5x
@@ -376,6 +401,7 @@ public:
 	void AppendUsbReply(OutputBuffer *buffer) noexcept;
 	void AppendAuxReply(size_t auxNumber, OutputBuffer *buf, bool rawMessage) noexcept;
 	void AppendAuxReply(size_t auxNumber, const char *_ecv_array msg, bool rawMessage) noexcept;
+	void AppendAuxStatusReport(size_t auxNumber, OutputBuffer *buf) noexcept;
 
 	void ResetChannel(size_t chan) noexcept;						// Re-initialise a serial channel
     bool IsAuxEnabled(size_t auxNumber) const noexcept;				// Any device on the AUX line?
@@ -419,6 +445,7 @@ public:
 	GCodeResult SetSysDir(const char *_ecv_array dir, const StringRef& reply) noexcept;				// Set the system files path
 	bool SysFileExists(const char *_ecv_array filename) const noexcept;
 	FileStore* OpenSysFile(const char *_ecv_array filename, OpenMode mode) const noexcept;
+	FileStore* OpenSysMacroFile(const char *_ecv_array filename) const noexcept;
 # if HAS_MASS_STORAGE || HAS_SBC_INTERFACE
 	bool DeleteSysFile(const char *_ecv_array filename) const noexcept;
 # endif
@@ -691,11 +718,18 @@ protected:
 	DECLARE_OBJECT_MODEL
 	OBJECT_MODEL_ARRAY(axisDrivers)
 	OBJECT_MODEL_ARRAY(workplaceOffsets)
+#if SUPPORT_REMOTE_COMMANDS
+	OBJECT_MODEL_ARRAY(timeSyncCorrections)
+#endif
 
 private:
 	const char *_ecv_array InternalGetSysDir() const noexcept;  				// where the system files are - not thread-safe!
 
 	void RawMessage(MessageType type, const char *_ecv_array message) noexcept;	// called by Message after handling error/warning flags
+	bool MustDeferMessage(MessageType type) const noexcept;
+	OutputBuffer *StartDeferredMessage(MessageType type) noexcept;
+	void DeferMessage(MessageType type, OutputBuffer *buffer) noexcept;
+	void SendDeferredMessages() noexcept;
 
 	float GetCpuTemperature() const noexcept;
 
@@ -870,6 +904,11 @@ private:
 	volatile OutputStack usbOutput;
 	Mutex usbMutex;
 
+	// Messages from tasks other than the main task are queued here and sent by the main task
+	MessageQueue deferredMessages;
+	std::atomic<uint32_t> messagesDeferred;
+	std::atomic<uint32_t> deferredMessagesDropped;
+
 #if HAS_AUX_DEVICES
 	AuxDevice auxDevices[NumSerialChannels - 1];
 #endif
@@ -920,6 +959,9 @@ private:
 		autoPaused
 	};
 	AutoSaveState autoSaveState;
+	volatile bool powerFailDetected;							// set by the tick ISR when VIN drops below the auto save threshold, so that a short drop is not missed
+
+	void CheckForPowerFail() noexcept;
 #endif
 
 #if HAS_12V_MONITOR
@@ -17,11 +17,15 @@
 #include "Tools/Filament.h"
 #include "Endstops/ZProbe.h"
 #include "Tasks.h"
+#include "CpuUsage.h"
 #include <Cache.h>
 #include "Fans/FansManager.h"
 #include <Hardware/SoftwareReset.h>
 #include <Hardware/ExceptionHandlers.h>
 #include <Accelerometers/Accelerometers.h>
+#include <ObjectModel/CborEncoder.h>
+#include "Base64Decoder.h"
+#include <Storage/CRC32.h>
 #include "Version.h"
 
 #ifdef DUET_NG
@@ -234,6 +238,15 @@ constexpr ObjectModelArrayDescriptor RepRap::volumesArrayDescriptor =
 #endif
 };
 
+#if SUPPORT_CPU_USAGE_STATS
+constexpr ObjectModelArrayDescriptor RepRap::cpuTasksArrayDescriptor =
+{
+	nullptr,
+	[] (const ObjectModel *self, const ObjectExplorationContext&) noexcept -> size_t { return CpuUsage::GetNumTasks(); },
+	[] (const ObjectModel *self, ObjectExplorationContext& context) noexcept -> ExpressionValue { return ExpressionValue(self, 9); }
+};
+#endif
+
 #if HAS_MASS_STORAGE
 constexpr ObjectModelArrayDescriptor RepRap::volChangesArrayDescriptor =
 {
@@ -326,6 +339,9 @@ constexpr ObjectModelTableEntry RepRap::objectModelTable[] =
 	{ "atxPower",				OBJECT_MODEL_FUNC_IF(self->platform->IsAtxPowerControlled(), self->platform->GetAtxPowerState()),	ObjectModelEntryFlags::none },
 	{ "atxPowerPort",			OBJECT_MODEL_FUNC_IF(self->platform->IsAtxPowerControlled(), self->platform->GetAtxPowerPort()),	ObjectModelEntryFlags::none },
 	{ "beep",					OBJECT_MODEL_FUNC_IF(self->beepDuration != 0, self, 4),					ObjectModelEntryFlags::none },
+#if SUPPORT_CPU_USAGE_STATS
+	{ "cpu",					OBJECT_MODEL_FUNC(self, 7),												ObjectModelEntryFlags::verbose },
+#endif
 	{ "currentTool",			OBJECT_MODEL_FUNC((int32_t)self->GetCurrentToolNumber()),				ObjectModelEntryFlags::live },
 	{ "deferredPowerDown",		OBJECT_MODEL_FUNC_IF(self->platform->IsAtxPowerControlled(), self->platform->IsDeferredPowerDown()),	ObjectModelEntryFlags::none },
 	{ "displayMessage",			OBJECT_MODEL_FUNC(self->message.c_str()),								ObjectModelEntryFlags::none },
@@ -395,11 +411,28 @@ constexpr ObjectModelTableEntry RepRap::objectModelTable[] =
 	{ "volChanges",				OBJECT_MODEL_FUNC_NOSELF(&volChangesArrayDescriptor),					ObjectModelEntryFlags::live },
 	{ "volumes",				OBJECT_MODEL_FUNC((int32_t)self->volumesSeq),							ObjectModelEntryFlags::live },
 #endif
+
+#if SUPPORT_CPU_USAGE_STATS
+	// 7. MachineModel.state.cpu
+	{ "isrs",					OBJECT_MODEL_FUNC(self, 8),												ObjectModelEntryFlags::verbose },
+	{ "tasks",					OBJECT_MODEL_FUNC_NOSELF(&cpuTasksArrayDescriptor),						ObjectModelEntryFlags::verbose },
+	{ "window",					OBJECT_MODEL_FUNC_NOSELF((int32_t)CpuUsage::GetWindowSeconds()),		ObjectModelEntryFlags::verbose },
+
+	// 8. MachineModel.state.cpu.isrs
+	{ "drivers",				OBJECT_MODEL_FUNC_NOSELF(CpuUsage::GetIsrPercent(CpuUsage::IsrId::drivers), 2),	ObjectModelEntryFlags::verbose },
+	{ "network",				OBJECT_MODEL_FUNC_NOSELF(CpuUsage::GetIsrPercent(CpuUsage::IsrId::network), 2),	ObjectModelEntryFlags::verbose },
+	{ "step",					OBJECT_MODEL_FUNC_NOSELF(CpuUsage::GetIsrPercent(CpuUsage::IsrId::step), 2),		ObjectModelEntryFlags::verbose },
+
+	// 9. MachineModel.state.cpu.tasks[]
+	{ "cpu",					OBJECT_MODEL_FUNC_NOSELF(CpuUsage::GetTaskPercent(context.GetLastIndex()), 1),		ObjectModelEntryFlags::verbose },
+	{ "freeStack",				OBJECT_MODEL_FUNC_NOSELF((int32_t)CpuUsage::GetTaskFreeStack(context.GetLastIndex())),	ObjectModelEntryFlags::verbose },
+	{ "name",					OBJECT_MODEL_FUNC_NOSELF(CpuUsage::GetTaskName(context.GetLastIndex())),				ObjectModelEntryFlags::verbose },
+#endif
 };
 
 constexpr uint8_t RepRap::objectModelTableDescriptor[] =
 {
-	7,																						// number of sub-tables
+	7 + 3 * SUPPORT_CPU_USAGE_STATS,																// number of sub-tables
 	15 + SUPPORT_SCANNER + (HAS_MASS_STORAGE | HAS_EMBEDDED_FILES | HAS_SBC_INTERFACE),		// root
 #if HAS_MASS_STORAGE || HAS_EMBEDDED_FILES || HAS_SBC_INTERFACE
 	8, 																						// directories
@@ -407,11 +440,16 @@ constexpr uint8_t RepRap::objectModelTableDescriptor[] =
 	0,																						// directories
 #endif
 	25,																						// limits
-	20 + HAS_VOLTAGE_MONITOR + SUPPORT_LASER,												// state
+	20 + HAS_VOLTAGE_MONITOR + SUPPORT_LASER + SUPPORT_CPU_USAGE_STATS,						// state
 	2,																						// state.beep
 	6,																						// state.messageBox
 	12 + HAS_NETWORKING + SUPPORT_SCANNER +
-	2 * HAS_MASS_STORAGE + (HAS_MASS_STORAGE | HAS_EMBEDDED_FILES | HAS_SBC_INTERFACE)		// seqs
+	2 * HAS_MASS_STORAGE + (HAS_MASS_STORAGE | HAS_EMBEDDED_FILES | HAS_SBC_INTERFACE),		// seqs
+#if SUPPORT_CPU_USAGE_STATS
+	3,																						// state.cpu
+	3,																						// state.cpu.isrs
+	3																						// state.cpu.tasks[]
+#endif
 };
 
 DEFINE_GET_OBJECT_MODEL_TABLE(RepRap)
@@ -427,6 +465,7 @@ ReadWriteLock RepRap::toolListLock;
 RepRap::RepRap() noexcept
 	: boardsSeq(0), directoriesSeq(0), fansSeq(0), heatSeq(0), inputsSeq(0), jobSeq(0), moveSeq(0), globalSeq(0),
 	  networkSeq(0), scannerSeq(0), sensorsSeq(0), spindlesSeq(0), stateSeq(0), toolsSeq(0), volumesSeq(0),
+	  modelChangeCounter(1),
 	  toolList(nullptr), currentTool(nullptr), lastWarningMillis(0),
 	  activeExtruders(0), activeToolHeaters(0), numToolsToReport(0),
 	  ticksInSpinState(0), heatTaskIdleTicks(0),
@@ -440,9 +479,47 @@ RepRap::RepRap() noexcept
 #endif
 {
 	ClearDebug();
+	for (uint32_t& c : branchChangedAt)
+	{
+		c = 1;															// so that a client that has seen nothing yet (change counter 0) gets everything
+	}
 	// Don't call constructors for other objects here
 }
 
+// Return true if a top-level branch of the object model may have changed since the model change counter had the specified value.
+// Branches with no sequence number (limits and seqs) only change when the firmware is restarted.
+bool RepRap::ChangedSince(const char *_ecv_array key, uint32_t changeCount) const noexcept
+{
+	static const char *_ecv_array const BranchNames[] =
+	{
+		"boards", "directories", "fans", "global", "heat", "inputs", "job", "move", "network", "scanner", "sensors", "spindles", "state", "tools", "volumes"
+	};
+	static_assert(ARRAY_SIZE(BranchNames) == (size_t)ModelBranch::numBranches, "Incorrect BranchNames array");
+
+	for (size_t i = 0; i < ARRAY_SIZE(BranchNames); ++i)
+	{
+		if (strcmp(key, BranchNames[i]) == 0)
+		{
+			return branchChangedAt[i] > changeCount;
+		}
+	}
+	return changeCount == 0;
+}
+
+// Return true if the non-live data that an object model key refers to may have changed since the model change counter had the specified value.
+// We track changes per top-level branch, so we look at the first element of the key. An empty key refers to the whole model.
+bool RepRap::KeyChangedSince(const char *_ecv_array key, uint32_t changeCount) const noexcept
+{
+	if (*key == '\0')
+	{
+		return modelChangeCounter > changeCount;
+	}
+
+	String<StringLength20> branchName;
+	branchName.GetRef().copy(key, strcspn(key, ".["));
+	return ChangedSince(branchName.c_str(), changeCount);
+}
+
 #if 0
 
 ///DEBUG to catch memory corruption
@@ -684,6 +761,14 @@ void RepRap::Init() noexcept
 
 	fastLoop = UINT32_MAX;
 	slowLoop = 0;
+#if SUPPORT_SPIN_TIMING_STATS
+	memset(spinTimeCounts, 0, sizeof(spinTimeCounts));
+	memset(maxSpinTicks, 0, sizeof(maxSpinTicks));
+	nextSlowLoop = numSlowLoops = 0;
+	slowestModuleTicks = 0;
+	slowestModule = noModule;
+	moduleSpinStartTicks = StepTimer::GetTimerTicks();
+#endif
 
 #if STEP_TIMER_DEBUG
 	(void)StepTimer::GetTimerTicks();
@@ -742,37 +827,32 @@ void RepRap::Spin() noexcept
 
 	const uint32_t lastTime = StepTimer::GetTimerTicks();
 
-	ticksInSpinState = 0;
-	spinningModule = modulePlatform;
+	SetSpinningModule(modulePlatform);
 	platform->Spin();
 
-	ticksInSpinState = 0;
-	spinningModule = moduleGcodes;
+	SetSpinningModule(moduleGcodes);
 	gCodes->Spin();
 
 #if SUPPORT_ROLAND
-	ticksInSpinState = 0;
-	spinningModule = moduleRoland;
+	SetSpinningModule(moduleRoland);
 	roland->Spin();
 #endif
 
 #if SUPPORT_SCANNER && !SCANNER_AS_SEPARATE_TASK
-	ticksInSpinState = 0;
-	spinningModule = moduleScanner;
+	SetSpinningModule(moduleScanner);
 	scanner->Spin();
 #endif
 
-	ticksInSpinState = 0;
-	spinningModule = modulePrintMonitor;
+	SetSpinningModule(modulePrintMonitor);
 	printMonitor->Spin();
 
-	ticksInSpinState = 0;
-	spinningModule = moduleFilamentSensors;
+#if !FILAMENT_MONITORS_AS_SEPARATE_TASK
+	SetSpinningModule(moduleFilamentSensors);
 	FilamentMonitor::Spin();
+#endif
 
 #if SUPPORT_12864_LCD
-	ticksInSpinState = 0;
-	spinningModule = moduleDisplay;
+	SetSpinningModule(moduleDisplay);
 	display->Spin();
 #endif
 
@@ -780,14 +860,16 @@ void RepRap::Spin() noexcept
 	// Keep the SBC task spinning from the main task in standalone mode to respond to a SBC if necessary
 	if (!UsingSbcInterface())
 	{
-		ticksInSpinState = 0;
-		spinningModule = moduleSbcInterface;
+		SetSpinningModule(moduleSbcInterface);
 		sbcInterface->Spin();
 	}
 #endif
 
-	ticksInSpinState = 0;
-	spinningModule = noModule;
+	SetSpinningModule(noModule);
+
+#if SUPPORT_CPU_USAGE_STATS
+	CpuUsage::Spin();
+#endif
 
 	// Check if we need to send diagnostics
 	if (diagnosticsDestination != MessageType::NoDestinationMessage)
@@ -874,18 +956,108 @@ void RepRap::Spin() noexcept
 		{
 			slowLoop = dt;
 		}
+#if SUPPORT_SPIN_TIMING_STATS
+		if (dt >= SlowLoopThresholdMillis * (StepClockRate/1000))
+		{
+			SlowLoopRecord& rec = slowLoops[nextSlowLoop];
+			rec.whenMillis = millis();
+			rec.loopTicks = dt;
+			rec.moduleTicks = slowestModuleTicks;
+			rec.module = slowestModule;
+			nextSlowLoop = (nextSlowLoop + 1) % SlowLoopTraceLength;
+			if (numSlowLoops < SlowLoopTraceLength)
+			{
+				++numSlowLoops;
+			}
+		}
+#endif
 	}
 
+#if SUPPORT_SPIN_TIMING_STATS
+	slowestModuleTicks = 0;
+	slowestModule = noModule;
+#endif
 	RTOSIface::Yield();
 }
 
+// Record that the main loop has finished spinning the previous module and is about to spin module m
+void RepRap::SetSpinningModule(Module m) noexcept
+{
+#if SUPPORT_SPIN_TIMING_STATS
+	const uint32_t now = StepTimer::GetTimerTicks();
+	if (spinningModule < Module::numModules && !justSentDiagnostics)		// M122 runs inside GCodes::Spin, so don't count the time it took
+	{
+		static constexpr uint32_t BucketLimits[NumSpinTimeBuckets - 1] =
+		{
+			1 * (StepClockRate/1000), 2 * (StepClockRate/1000), 5 * (StepClockRate/1000), 10 * (StepClockRate/1000),
+			20 * (StepClockRate/1000), 50 * (StepClockRate/1000), 100 * (StepClockRate/1000)
+		};
+
+		const uint32_t dt = now - moduleSpinStartTicks;
+		size_t bucket = 0;
+		while (bucket < NumSpinTimeBuckets - 1 && dt >= BucketLimits[bucket])
+		{
+			++bucket;
+		}
+		++spinTimeCounts[spinningModule][bucket];
+		if (dt > maxSpinTicks[spinningModule])
+		{
+			maxSpinTicks[spinningModule] = dt;
+		}
+		if (dt > slowestModuleTicks)
+		{
+			slowestModuleTicks = dt;
+			slowestModule = spinningModule;
+		}
+	}
+	moduleSpinStartTicks = now;
+#endif
+	ticksInSpinState = 0;
+	spinningModule = m;
+}
+
 void RepRap::Timing(MessageType mtype) noexcept
 {
 	platform->MessageF(mtype, "Slowest loop: %.2fms; fastest: %.2fms\n", (double)(slowLoop * StepClocksToMillis), (double)(fastLoop * StepClocksToMillis));
 	fastLoop = UINT32_MAX;
 	slowLoop = 0;
+#if SUPPORT_SPIN_TIMING_STATS
+	SpinTimingDiagnostics(mtype);
+#endif
 }
 
+#if SUPPORT_SPIN_TIMING_STATS
+
+// Report the spin time histogram of each module that has been spun since we last did this, then clear them. Also report the slow loop trace, which we keep.
+void RepRap::SpinTimingDiagnostics(MessageType mtype) noexcept
+{
+	platform->Message(mtype, "Module spin times <1/<2/<5/<10/<20/<50/<100/>=100ms:\n");
+	for (size_t m = 0; m < Module::numModules; ++m)
+	{
+		const uint32_t *const counts = spinTimeCounts[m];
+		if (maxSpinTicks[m] != 0 || counts[0] != 0)
+		{
+			platform->MessageF(mtype, " %s %" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 ", max %.2fms\n",
+								GetModuleName(m), counts[0], counts[1], counts[2], counts[3], counts[4], counts[5], counts[6], counts[7],
+								(double)(maxSpinTicks[m] * StepClocksToMillis));
+		}
+	}
+	memset(spinTimeCounts, 0, sizeof(spinTimeCounts));
+	memset(maxSpinTicks, 0, sizeof(maxSpinTicks));
+
+	platform->MessageF(mtype, "Loops >=%" PRIu32 "ms: %u", SlowLoopThresholdMillis, numSlowLoops);
+	const uint32_t now = millis();
+	for (size_t i = 0; i < numSlowLoops; ++i)
+	{
+		const SlowLoopRecord& rec = slowLoops[(nextSlowLoop + SlowLoopTraceLength - 1 - i) % SlowLoopTraceLength];
+		platform->MessageF(mtype, "%s %.1fs ago %.1fms, %s %.1fms", (i == 0) ? ":" : ",", (double)((now - rec.whenMillis) * 0.001),
+							(double)(rec.loopTicks * StepClocksToMillis), GetModuleName(rec.module), (double)(rec.moduleTicks * StepClocksToMillis));
+	}
+	platform->Message(mtype, "\n");
+}
+
+#endif
+
 void RepRap::Diagnostics(MessageType mtype) noexcept
 {
 	platform->Message(mtype, "=== Diagnostics ===\n");
@@ -2365,67 +2537,10 @@ OutputBuffer *RepRap::GetThumbnailResponse(const char *filename, FilePosition of
 		if (f->Seek(offset))
 		{
 			response->cat("\"data\":\"");
-
-			const unsigned int thumbnailMaxDataSize = (forM31point1) ? ThumbnailMaxDataSizeM31 : ThumbnailMaxDataSizeRr;
-			for (unsigned int charsWrittenThisCall = 0; charsWrittenThisCall < thumbnailMaxDataSize; )
+			if (!AppendThumbnailData(f, response, offset, (forM31point1) ? ThumbnailMaxDataSizeM31 : ThumbnailMaxDataSizeRr, false))
 			{
-				// Read a line
-				char lineBuffer[MaxGCodeLength];
-				const int charsRead = f->ReadLine(lineBuffer, sizeof(lineBuffer));
-				if (charsRead <= 0)
-				{
-					err = 1;
-					offset = 0;
-					break;
-				}
-
-				const FilePosition posOld = offset;
-				offset = f->Position();
-
-				const char *p = lineBuffer;
-
-				// Skip white spaces
-				while ((p - lineBuffer <= charsRead) && (*p == ';' || *p == ' ' || *p == '\t'))
-				{
-					++p;
-				}
-
-				// Skip empty lines (there shouldn't be any, but just in case there are)
-				if (*p == '\n' || *p == '\0')
-				{
-					continue;
-				}
-
-				// Check for end of thumbnail. We'd like to use a regex here but we can't afford the flash space of a regex parser in some build configurations.
-				if (   StringStartsWith(p, "thumbnail end") || StringStartsWith(p, "thumbnail_QOI end") || StringStartsWith(p, "thumbnail_JPG end")
-					// Also stop if the base64 data has ended, to avoid sending to the end of file if the end marker is missing. We don't want to take too long so just look for space.
-					|| strchr(p, ' ') != nullptr
-				   )
-				{
-					offset = 0;
-					break;
-				}
-
-				const unsigned int charsSkipped = p - lineBuffer;
-				const unsigned int charsAvailable = charsRead - charsSkipped;
-				unsigned int charsWrittenFromThisLine;
-				if (charsAvailable <= thumbnailMaxDataSize - charsWrittenThisCall)
-				{
-					// Write all the data in this line
-					charsWrittenFromThisLine = charsAvailable;
-				}
-				else
-				{
-					// Write just enough characters to fill the buffer
-					charsWrittenFromThisLine = thumbnailMaxDataSize - charsWrittenThisCall;
-					offset = posOld + charsSkipped + charsWrittenFromThisLine;
-				}
-
-				// Copy the data
-				response->cat(p, charsWrittenFromThisLine);
-				charsWrittenThisCall += charsWrittenFromThisLine;
+				err = 1;
 			}
-
 			response->catf("\",\"next\":%" PRIu32 ",", offset);
 		}
 		f->Close();
@@ -2439,6 +2554,79 @@ OutputBuffer *RepRap::GetThumbnailResponse(const char *filename, FilePosition of
 	return response;
 }
 
+// Append up to maxChars characters of base64 thumbnail data to 'buf', reading from file 'f' which must already be positioned at 'offset'.
+// If 'decode' is true then we append the decoded binary data instead. maxChars must be a multiple of 4 to keep each chunk aligned to whole base64 groups.
+// On return, 'offset' is the file position of the next data or 0 if we reached the end of the thumbnail. Return false if the file couldn't be read.
+/*static*/ bool RepRap::AppendThumbnailData(FileStore *f, OutputBuffer *buf, FilePosition& offset, unsigned int maxChars, bool decode) noexcept
+{
+	Base64Decoder decoder(buf);
+	for (unsigned int charsWrittenThisCall = 0; charsWrittenThisCall < maxChars; )
+	{
+		// Read a line
+		char lineBuffer[MaxGCodeLength];
+		const int charsRead = f->ReadLine(lineBuffer, sizeof(lineBuffer));
+		if (charsRead <= 0)
+		{
+			offset = 0;
+			return false;
+		}
+
+		const FilePosition posOld = offset;
+		offset = f->Position();
+
+		const char *p = lineBuffer;
+
+		// Skip white spaces
+		while ((p - lineBuffer <= charsRead) && (*p == ';' || *p == ' ' || *p == '\t'))
+		{
+			++p;
+		}
+
+		// Skip empty lines (there shouldn't be any, but just in case there are)
+		if (*p == '\n' || *p == '\0')
+		{
+			continue;
+		}
+
+		// Check for end of thumbnail. We'd like to use a regex here but we can't afford the flash space of a regex parser in some build configurations.
+		if (   StringStartsWith(p, "thumbnail end") || StringStartsWith(p, "thumbnail_QOI end") || StringStartsWith(p, "thumbnail_JPG end")
+			// Also stop if the base64 data has ended, to avoid sending to the end of file if the end marker is missing. We don't want to take too long so just look for space.
+			|| strchr(p, ' ') != nullptr
+		   )
+		{
+			offset = 0;
+			break;
+		}
+
+		const unsigned int charsSkipped = p - lineBuffer;
+		const unsigned int charsAvailable = charsRead - charsSkipped;
+		unsigned int charsWrittenFromThisLine;
+		if (charsAvailable <= maxChars - charsWrittenThisCall)
+		{
+			// Write all the data in this line
+			charsWrittenFromThisLine = charsAvailable;
+		}
+		else
+		{
+			// Write just enough characters to fill the buffer
+			charsWrittenFromThisLine = maxChars - charsWrittenThisCall;
+			offset = posOld + charsSkipped + charsWrittenFromThisLine;
+		}
+
+		// Copy the data
+		if (decode)
+		{
+			decoder.Add(p, charsWrittenFromThisLine);
+		}
+		else
+		{
+			buf->cat(p, charsWrittenFromThisLine);
+		}
+		charsWrittenThisCall += charsWrittenFromThisLine;
+	}
+	return true;
+}
+
 #endif
 
 // Get information for the specified file, or the currently printing file (if 'filename' is null or empty), in JSON format
@@ -2557,7 +2745,16 @@ void RepRap::AppendFloatArray(OutputBuffer *buf, const char *name, size_t numVal
 			buf->cat(',');
 		}
 		const float fVal = HideNan(func(i));
-		buf->catf(GetFloatFormatString(fVal, numDecimalDigits), (double)fVal);
+		char temp[FloatFormatBufferSize];
+		const size_t len = FormatFloat(temp, fVal, numDecimalDigits);
+		if (len != 0)
+		{
+			buf->cat(temp, len);
+		}
+		else
+		{
+			buf->catf(GetFloatFormatString(fVal, numDecimalDigits), (double)fVal);
+		}
 	}
 	buf->cat(']');
 }
@@ -2610,7 +2807,16 @@ OutputBuffer *RepRap::GetModelResponse(const GCodeBuffer *_ecv_null gb, const ch
 		if (key == nullptr) { key = ""; }
 		if (flags == nullptr) { flags = ""; }
 
-		outBuf->printf("{\"key\":\"%.s\",\"flags\":\"%.s\",\"result\":", key, flags);
+		// If the client only wants the data when it has changed since it last saw it, don't report anything if the branch that the key refers to hasn't changed
+		const char *_ecv_array null const changedFlag = strchr(flags, 'c');
+		if (changedFlag != nullptr && !KeyChangedSince((*key == '#') ? key + 1 : key, StrToU32(changedFlag + 1)))
+		{
+			StartModelResponse(outBuf, key, flags, true);
+			EndModelResponse(outBuf, flags);
+			return outBuf;
+		}
+
+		StartModelResponse(outBuf, key, flags);
 
 		const bool wantArrayLength = (*key == '#');
 		if (wantArrayLength)
@@ -2621,7 +2827,7 @@ OutputBuffer *RepRap::GetModelResponse(const GCodeBuffer *_ecv_null gb, const ch
 		try
 		{
 			reprap.ReportAsJson(gb, outBuf, key, flags, wantArrayLength);
-			outBuf->cat("}\n");
+			EndModelResponse(outBuf, flags);
 			if (outBuf->HadOverflow())
 			{
 				OutputBuffer::ReleaseAll(outBuf);
@@ -2637,6 +2843,105 @@ OutputBuffer *RepRap::GetModelResponse(const GCodeBuffer *_ecv_null gb, const ch
 	return outBuf;
 }
 
+// Write the part of an object model response that precedes the result. If 'unchanged' is true then we write a response that says the data has not changed instead.
+void RepRap::StartModelResponse(OutputBuffer *buf, const char *key, const char *flags, bool unchanged) const noexcept
+{
+	// Report the change counter before we report the model, so that if anything changes while we are reporting it the client will get it next time
+	const bool wantChanges = (strchr(flags, 'u') != nullptr || strchr(flags, 'c') != nullptr);
+	if (strchr(flags, 'b') != nullptr)
+	{
+		buf->copy((char)0xBF);						// start an indefinite-length CBOR map for the envelope
+		Cbor::AppendText(buf, "key");
+		Cbor::AppendText(buf, key);
+		Cbor::AppendText(buf, "flags");
+		Cbor::AppendText(buf, flags);
+		if (wantChanges)
+		{
+			Cbor::AppendText(buf, "changes");
+			Cbor::AppendUnsigned(buf, modelChangeCounter);
+		}
+		if (unchanged)
+		{
+			Cbor::AppendText(buf, "unchanged");
+			Cbor::AppendBool(buf, true);
+		}
+		else
+		{
+			Cbor::AppendText(buf, "result");
+		}
+	}
+	else
+	{
+		buf->printf("{\"key\":\"%.s\",\"flags\":\"%.s\",", key, flags);
+		if (wantChanges)
+		{
+			buf->catf("\"changes\":%" PRIu32 ",", modelChangeCounter);
+		}
+		buf->cat((unchanged) ? "\"unchanged\":true" : "\"result\":");
+	}
+}
+
+// Write the part of an object model response that follows the result. A binary response is a single CBOR data item, so it has no trailing newline.
+/*static*/ void RepRap::EndModelResponse(OutputBuffer *buf, const char *flags) noexcept
+{
+	if (strchr(flags, 'b') != nullptr)
+	{
+		Cbor::AppendBreak(buf);
+	}
+	else
+	{
+		buf->cat("}\n");
+	}
+}
+
+// Append the next top-level branch of the object model to a response that was started by calling StartModelResponse with an empty key.
+// This lets a network responder stream a complete object model report one branch at a time, generating each one when it has sent the previous one,
+// so that it never needs more output buffers than the largest branch needs. On return, 'index' identifies the next branch to report.
+// Returns false if there were no more branches to report, in which case we have finished the result and the response.
+bool RepRap::GetModelBranchResponse(OutputBuffer *buf, const char *flags, size_t& index, bool first) const noexcept
+{
+	const bool binary = (strchr(flags, 'b') != nullptr);
+	try
+	{
+		if (ReportTopLevelEntryAsJson(nullptr, buf, flags, index, first))
+		{
+			return true;
+		}
+	}
+	catch (const GCodeException&)
+	{
+		// The branch has already been started, so make sure the response is still well formed
+		if (binary)
+		{
+			Cbor::AppendNull(buf);
+		}
+		else
+		{
+			buf->cat("null");
+		}
+		return true;
+	}
+
+	// No more branches, so finish the result object and the response
+	if (binary)
+	{
+		if (first)
+		{
+			Cbor::AppendEmptyMap(buf);
+		}
+		else
+		{
+			Cbor::AppendBreak(buf);
+		}
+	}
+	else
+	{
+		buf->cat((first) ? "{}" : "}");
+	}
+	EndModelResponse(buf, flags);
+	return false;
+}
+
 #endif
 
 // Send a beep. We send it to both PanelDue and the web interface.
@@ -2934,6 +3239,65 @@ bool RepRap::WriteToolParameters(FileStore *f, const bool forceWriteOffsets) noe
     #include "LPC/FirmwareUpdate.hpp"
 #else
 
+#if HAS_MASS_STORAGE
+
+// Check that a firmware file is complete and undamaged, so that we don't shut down and start the IAP only to find that it can't program the file.
+// Binary files end with the CRC-32 of the rest of the file, stored little-endian by crc32appender.
+// In a UF2 file the last block is padded with zeros after the CRC, so for those we check the block headers and the file length instead.
+static bool CheckFirmwareFileIntegrity(FileStore *firmwareFile) noexcept
+{
+	const FilePosition length = firmwareFile->Length();
+#if SAME5x
+	constexpr uint32_t Uf2MagicStart0 = 0x0A324655;
+	constexpr uint32_t Uf2MagicStart1 = 0x9E5D5157;
+	constexpr FilePosition Uf2BlockSize = 512;
+
+	if (length == 0 || length % Uf2BlockSize != 0)
+	{
+		return false;
+	}
+
+	const uint32_t numBlocks = length/Uf2BlockSize;
+	for (uint32_t blockNumber = 0; blockNumber < numBlocks; ++blockNumber)
+	{
+		uint32_t header[8];								// magic 0, magic 1, flags, target address, payload size, block number, number of blocks, family ID
+		if (   !firmwareFile->Seek(blockNumber * Uf2BlockSize)
+			|| firmwareFile->Read(reinterpret_cast<char*>(header), sizeof(header)) != (int)sizeof(header)
+			|| header[0] != Uf2MagicStart0 || header[1] != Uf2MagicStart1
+			|| header[5] != blockNumber || header[6] != numBlocks
+		   )
+		{
+			return false;
+		}
+	}
+	return true;
+#else
+	if (length <= sizeof(uint32_t) || !firmwareFile->Seek(0))
+	{
+		return false;
+	}
+
+	CRC32 crc;
+	char buffer[256];
+	FilePosition bytesLeft = length - sizeof(uint32_t);
+	while (bytesLeft != 0)
+	{
+		const size_t bytesToRead = min<FilePosition>(bytesLeft, sizeof(buffer));
+		if (firmwareFile->Read(buffer, bytesToRead) != (int)bytesToRead)
+		{
+			return false;
+		}
+		crc.Update(buffer, bytesToRead);
+		bytesLeft -= bytesToRead;
+	}
+
+	uint32_t storedCrc;
+	return firmwareFile->Read(reinterpret_cast<char*>(&storedCrc), sizeof(storedCrc)) == (int)sizeof(storedCrc) && storedCrc == crc.Get();
+#endif
+}
+
+#endif
+
 // Check the prerequisites for updating the main firmware. Return True if satisfied, else print a message to 'reply' and return false.
 bool RepRap::CheckFirmwareUpdatePrerequisites(const StringRef& reply, const StringRef& filenameRef) noexcept
 {
@@ -2956,7 +3320,6 @@ bool RepRap::CheckFirmwareUpdatePrerequisites(const StringRef& reply, const Stri
 #endif
 
 	firmwareFile->Read(reinterpret_cast<char*>(&firstDword), sizeof(firstDword)) == (int)sizeof(firstDword);
-	firmwareFile->Close();
 	if (!ok || firstDword !=
 #if SAME5x
 						HSRAM_ADDR + HSRAM_SIZE
@@ -2965,10 +3328,20 @@ bool RepRap::CheckFirmwareUpdatePrerequisites(const StringRef& reply, const Stri
 #endif
 			)
 	{
+		firmwareFile->Close();
 		reply.printf("Firmware binary \"%s\" is not valid for this electronics", FIRMWARE_DIRECTORY IAP_FIRMWARE_FILE);
 		return false;
 	}
 
+	// Read the whole file now while the machine is still running, rather than finding out that it is damaged after we have shut down
+	ok = CheckFirmwareFileIntegrity(firmwareFile);
+	firmwareFile->Close();
+	if (!ok)
+	{
+		reply.printf("Firmware binary \"%s\" is incomplete or damaged, please upload it again", FIRMWARE_DIRECTORY IAP_FIRMWARE_FILE);
+		return false;
+	}
+
 	if (!platform->FileExists(FIRMWARE_DIRECTORY, IAP_UPDATE_FILE) && !platform->FileExists(DEFAULT_SYS_DIR, IAP_UPDATE_FILE))
 	{
 		reply.printf("In-application programming binary \"%s\" not found", FIRMWARE_DIRECTORY IAP_UPDATE_FILE);
@@ -154,12 +154,16 @@ public:
 	OutputBuffer *GetFilesResponse(const char* dir, unsigned int startAt, bool flagsDirs) noexcept;
 	OutputBuffer *GetFilelistResponse(const char* dir, unsigned int startAt) noexcept;
 	OutputBuffer *GetThumbnailResponse(const char *filename, FilePosition offset, bool forM31point1) noexcept;
+	static bool AppendThumbnailData(FileStore *f, OutputBuffer *buf, FilePosition& offset, unsigned int maxChars, bool decode) noexcept;
 #endif
 
 	GCodeResult GetFileInfoResponse(const char *filename, OutputBuffer *&response, bool quitEarly) noexcept;
 
 #if SUPPORT_OBJECT_MODEL
 	OutputBuffer *GetModelResponse(const GCodeBuffer *_ecv_null gb, const char *key, const char *flags) const THROWS(GCodeException);
+	void StartModelResponse(OutputBuffer *buf, const char *key, const char *flags, bool unchanged = false) const noexcept;
+	bool GetModelBranchResponse(OutputBuffer *buf, const char *flags, size_t& index, bool first) const noexcept;
+	static void EndModelResponse(OutputBuffer *buf, const char *flags) noexcept;
 #endif
 
 	void Beep(unsigned int freq, unsigned int ms) noexcept;
@@ -191,27 +195,30 @@ public:
 
 	void KickHeatTaskWatchdog() noexcept { heatTaskIdleTicks = 0; }
 
-	void BoardsUpdated() noexcept { ++boardsSeq; }
-	void DirectoriesUpdated() noexcept { ++directoriesSeq; }
-	void FansUpdated() noexcept { ++fansSeq; }
-	void GlobalUpdated() noexcept { ++globalSeq; }
-	void HeatUpdated() noexcept { ++heatSeq; }
-	void InputsUpdated() noexcept { ++inputsSeq; }
-	void JobUpdated() noexcept { ++jobSeq; }
-	void MoveUpdated() noexcept { ++moveSeq; }
-	void NetworkUpdated() noexcept { ++networkSeq; }
-	void ScannerUpdated() noexcept { ++scannerSeq; }
-	void SensorsUpdated() noexcept { ++sensorsSeq; }
-	void SpindlesUpdated() noexcept { ++spindlesSeq; }
-	void StateUpdated() noexcept { ++stateSeq; }
-	void ToolsUpdated() noexcept { ++toolsSeq; }
-	void VolumesUpdated() noexcept { ++volumesSeq; }
+	void BoardsUpdated() noexcept { ++boardsSeq; BranchChanged(ModelBranch::boards); }
+	void DirectoriesUpdated() noexcept { ++directoriesSeq; BranchChanged(ModelBranch::directories); }
+	void FansUpdated() noexcept { ++fansSeq; BranchChanged(ModelBranch::fans); }
+	void GlobalUpdated() noexcept { ++globalSeq; BranchChanged(ModelBranch::global); }
+	void HeatUpdated() noexcept { ++heatSeq; BranchChanged(ModelBranch::heat); }
+	void InputsUpdated() noexcept { ++inputsSeq; BranchChanged(ModelBranch::inputs); }
+	void JobUpdated() noexcept { ++jobSeq; BranchChanged(ModelBranch::job); }
+	void MoveUpdated() noexcept { ++moveSeq; BranchChanged(ModelBranch::move); }
+	void NetworkUpdated() noexcept { ++networkSeq; BranchChanged(ModelBranch::network); }
+	void ScannerUpdated() noexcept { ++scannerSeq; BranchChanged(ModelBranch::scanner); }
+	void SensorsUpdated() noexcept { ++sensorsSeq; BranchChanged(ModelBranch::sensors); }
+	void SpindlesUpdated() noexcept { ++spindlesSeq; BranchChanged(ModelBranch::spindles); }
+	void StateUpdated() noexcept { ++stateSeq; BranchChanged(ModelBranch::state); }
+	void ToolsUpdated() noexcept { ++toolsSeq; BranchChanged(ModelBranch::tools); }
+	void VolumesUpdated() noexcept { ++volumesSeq; BranchChanged(ModelBranch::volumes); }
+	uint32_t GetModelChangeCounter() const noexcept { return modelChangeCounter; }
 
 	ReadLockedPointer<const VariableSet> GetGlobalVariablesForReading() noexcept { return globalVariables.GetForReading(); }
 	WriteLockedPointer<VariableSet> GetGlobalVariablesForWriting() noexcept { return globalVariables.GetForWriting(); }
 
 protected:
 	DECLARE_OBJECT_MODEL
+	bool ChangedSince(const char *_ecv_array key, uint32_t changeCount) const noexcept override;
+	bool KeyChangedSince(const char *_ecv_array key, uint32_t changeCount) const noexcept;
 	OBJECT_MODEL_ARRAY(boards)
 	OBJECT_MODEL_ARRAY(fans)
 	OBJECT_MODEL_ARRAY(gpout)
@@ -221,6 +228,9 @@ protected:
 	OBJECT_MODEL_ARRAY(restorePoints)
 	OBJECT_MODEL_ARRAY(volumes)
 	OBJECT_MODEL_ARRAY(volChanges)
+#if SUPPORT_CPU_USAGE_STATS
+	OBJECT_MODEL_ARRAY(cpuTasks)
+#endif
 
 private:
 	static void EncodeString(StringRef& response, const char* src, size_t spaceToLeave, bool allowControlChars = false, char prefix = 0) noexcept;
@@ -233,6 +243,10 @@ private:
 	const char* GetStatusString() const noexcept;
 	void ReportToolTemperatures(const StringRef& reply, const Tool *tool, bool includeNumber) const noexcept;
 	bool RunStartupFile(const char *filename, bool isMainConfigFile) noexcept;
+	void SetSpinningModule(Module m) noexcept;
+#if SUPPORT_SPIN_TIMING_STATS
+	void SpinTimingDiagnostics(MessageType mtype) noexcept;
+#endif
 
 	static constexpr uint32_t MaxTicksInSpinState = 20000;	// timeout before we reset the processor
 	static constexpr uint32_t HighTicksInSpinState = 16000;	// how long before we warn that timeout is approaching
@@ -273,6 +287,14 @@ private:
 	uint16_t boardsSeq, directoriesSeq, fansSeq, heatSeq, inputsSeq, jobSeq, moveSeq, globalSeq;
 	uint16_t networkSeq, scannerSeq, sensorsSeq, spindlesSeq, stateSeq, toolsSeq, volumesSeq;
 
+	// Each time one of the sequence numbers above is incremented we also record the new value of a counter that is shared by all of them,
+	// so that a client can ask for just those branches of the object model that have changed since it last saw the counter
+	enum class ModelBranch : uint8_t { boards = 0, directories, fans, global, heat, inputs, job, move, network, scanner, sensors, spindles, state, tools, volumes, numBranches };
+	void BranchChanged(ModelBranch b) noexcept { branchChangedAt[(size_t)b] = ++modelChangeCounter; }
+
+	uint32_t modelChangeCounter;
+	uint32_t branchChangedAt[(size_t)ModelBranch::numBranches];
+
 	GlobalVariables globalVariables;
 
 	Tool* toolList;								// the tool list is sorted in order of increasing tool number
@@ -287,6 +309,28 @@ private:
 	uint16_t heatTaskIdleTicks;
 	uint32_t fastLoop, slowLoop;
 
+#if SUPPORT_SPIN_TIMING_STATS
+	// Spin times of the modules that the main loop calls, so that we can tell which one is responsible for long loop times
+	static constexpr size_t NumSpinTimeBuckets = 8;				// <1ms, <2ms, <5ms, <10ms, <20ms, <50ms, <100ms, >=100ms
+
+	struct SlowLoopRecord
+	{
+		uint32_t whenMillis;										// when the loop finished
+		uint32_t loopTicks;											// how long the whole loop took
+		uint32_t moduleTicks;										// how long the slowest module took during that loop
+		Module module;												// the slowest module
+	};
+
+	uint32_t spinTimeCounts[Module::numModules][NumSpinTimeBuckets];
+	uint32_t maxSpinTicks[Module::numModules];
+	SlowLoopRecord slowLoops[SlowLoopTraceLength];				// ring buffer of the most recent slow loops
+	size_t nextSlowLoop;
+	size_t numSlowLoops;
+	uint32_t moduleSpinStartTicks;								// when the current module started spinning
+	uint32_t slowestModuleTicks;								// the longest time that a module has spun for during the current loop
+	Module slowestModule;										// the module that took that time
+#endif
+
 #if SUPPORT_REMOTE_COMMANDS
 	enum class DeferredCommand : uint8_t { none, reboot, updateFirmware };
 	volatile uint32_t whenDeferredCommandScheduled;
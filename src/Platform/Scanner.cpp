@@ -360,7 +360,7 @@ void Scanner::ProcessCommand() noexcept
 		if (uploadFilename != nullptr)
 		{
 			uploadBytesLeft = uploadSize;
-			fileBeingUploaded = platform.OpenFile(SCANS_DIRECTORY, uploadFilename, OpenMode::write);
+			fileBeingUploaded = platform.OpenFile(SCANS_DIRECTORY, uploadFilename, OpenMode::write, uploadSize);
 			if (fileBeingUploaded != nullptr)
 			{
 				SetState(ScannerState::Uploading);
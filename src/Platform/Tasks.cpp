@@ -14,6 +14,7 @@
 #include <Hardware/NonVolatileMemory.h>
 #include <Storage/CRC32.h>
 #include <Movement/StepTimer.h>
+#include "CpuUsage.h"
 
 #if SAM4E || SAM4S || SAME70
 # include <efc/efc.h>		// for efc_enable_cloe()
@@ -333,9 +334,15 @@ void Tasks::Diagnostics(MessageType mtype) noexcept
 		//ENDDB
 	}	// end memory stats scope
 
+#if SUPPORT_CPU_USAGE_STATS
+	// Report the CPU usage in the last complete window, so that M122 doesn't disturb the figures reported in the object model
+	CpuUsage::Sample();
+	p.MessageF(mtype, "Tasks (CPU usage over last %" PRIu32 "s window):", CpuUsage::GetWindowSeconds());
+#else
 	const uint32_t timeSinceLastCall = TaskResetRunTimeCounter();
-	float totalCpuPercent = 0.0;
 	p.Message(mtype, "Tasks:");
+#endif
+	float totalCpuPercent = 0.0;
 	for (TaskBase *t = TaskBase::GetTaskList(); t != nullptr; t = t->GetNext())
 	{
 		ExtendedTaskStatus_t taskDetails;
@@ -385,7 +392,11 @@ void Tasks::Diagnostics(MessageType mtype) noexcept
 			}
 		}
 
+#if SUPPORT_CPU_USAGE_STATS
+		const float cpuPercent = CpuUsage::GetTaskPercent(t);
+#else
 		const float cpuPercent = (100 * (float)taskDetails.ulRunTimeCounter)/(float)timeSinceLastCall;
+#endif
 		totalCpuPercent += cpuPercent;
 		p.MessageF(mtype, " %s(%s%s,%.1f%%,%u)", taskDetails.pcTaskName, stateText, mutexName, (double)cpuPercent, (unsigned int)taskDetails.usStackHighWaterMark);
 	}
@@ -400,6 +411,9 @@ void Tasks::Diagnostics(MessageType mtype) noexcept
 		}
 	}
 	p.Message(mtype, "\n");
+#if SUPPORT_CPU_USAGE_STATS
+	CpuUsage::Diagnostics(mtype);
+#endif
 }
 
 TaskHandle Tasks::GetMainTask() noexcept
@@ -0,0 +1,293 @@
+/*
+ * JobAccounting.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "JobAccounting.h"
+
+#if SUPPORT_JOB_ACCOUNTING
+
+#include <Platform/RepRap.h>
+#include <Platform/Platform.h>
+#include <GCodes/GCodeBuffer/GCodeBuffer.h>
+#include <Storage/MassStorage.h>
+
+JobAccounting::JobAccounting() noexcept
+	: totalClocks(0), totalRequestedClocks(0), numObjects(0), nextRecentLayer(0), numRecentLayers(0), numLayersCompleted(0), numLayersLogged(0), printing(false)
+#if HAS_MASS_STORAGE
+	  , logFile(nullptr)
+#endif
+{
+	otherTotals.Clear();
+	currentLayerTotals.Clear();
+	currentLayerTotals.layer = 0;
+}
+
+// Clear the totals and start recording
+void JobAccounting::StartPrint() noexcept
+{
+	{
+		TaskCriticalSectionLocker lock;
+		for (Totals& t : objectTotals)
+		{
+			t.Clear();
+		}
+		otherTotals.Clear();
+		currentLayerTotals.Clear();
+		currentLayerTotals.layer = 0;
+		totalClocks = totalRequestedClocks = 0;
+		numObjects = nextRecentLayer = numRecentLayers = 0;
+		numLayersCompleted = numLayersLogged = 0;
+		printing = true;
+	}
+
+#if HAS_MASS_STORAGE
+	CloseLog();
+	OpenLog();
+#endif
+}
+
+// Stop recording. The totals are kept so that they can still be read after the print has finished.
+void JobAccounting::StopPrint() noexcept
+{
+	{
+		TaskCriticalSectionLocker lock;
+		if (!printing)
+		{
+			return;
+		}
+		FinishLayer();
+		printing = false;
+	}
+
+#if HAS_MASS_STORAGE
+	if (logFile != nullptr)
+	{
+		Spin();												// write any layer records that we haven't written yet
+		for (size_t i = 0; i < numObjects; ++i)
+		{
+			WriteRecord(JobAccountingRecord::ObjectRecord, i, objectTotals[i]);
+		}
+		WriteRecord(JobAccountingRecord::OtherRecord, 0, otherTotals);
+		CloseLog();
+	}
+#endif
+}
+
+// Add a completed move to the totals. The Move task calls this for each completed move that was read from the file being printed.
+// This is called for every move, so it only does additions.
+void JobAccounting::RecordMove(int objectNumber, unsigned int layer, uint32_t clocks, uint32_t requestedClocks, float filament) noexcept
+{
+	TaskCriticalSectionLocker lock;							// so that the main task doesn't reset the totals or read a layer while we are changing them
+	if (printing)
+	{
+		if (layer != currentLayerTotals.layer)
+		{
+			FinishLayer();
+			currentLayerTotals.layer = layer;
+		}
+		currentLayerTotals.clocks += clocks;
+		currentLayerTotals.filament += filament;
+		totalClocks += clocks;
+		totalRequestedClocks += requestedClocks;
+
+		Totals *t;
+		if (objectNumber >= 0 && (size_t)objectNumber < MaxTrackedObjects)
+		{
+			t = &objectTotals[objectNumber];
+			if ((size_t)objectNumber >= numObjects)
+			{
+				numObjects = (size_t)objectNumber + 1;
+			}
+		}
+		else
+		{
+			t = &otherTotals;
+		}
+		t->clocks += clocks;
+		t->filament += filament;
+	}
+}
+
+// Store the totals for the current layer in the history and clear them. Layer 0 is what we print before the file tells us the first layer number, so we don't keep it.
+// The caller must hold a TaskCriticalSectionLocker.
+void JobAccounting::FinishLayer() noexcept
+{
+	if (currentLayerTotals.layer != 0 && currentLayerTotals.clocks != 0)
+	{
+		recentLayers[nextRecentLayer] = currentLayerTotals;
+		nextRecentLayer = (nextRecentLayer + 1) % JobAccountingRecentLayers;
+		if (numRecentLayers < JobAccountingRecentLayers)
+		{
+			++numRecentLayers;
+		}
+		++numLayersCompleted;
+	}
+	currentLayerTotals.Clear();
+}
+
+const JobAccounting::LayerTotals& JobAccounting::GetRecentLayer(size_t n) const noexcept
+{
+	return recentLayers[(nextRecentLayer + JobAccountingRecentLayers - 1 - n) % JobAccountingRecentLayers];
+}
+
+float JobAccounting::GetAverageLayerTime() const noexcept
+{
+	TaskCriticalSectionLocker lock;
+	if (numRecentLayers == 0)
+	{
+		return 0.0;
+	}
+
+	uint64_t clocks = 0;
+	for (size_t i = 0; i < numRecentLayers; ++i)
+	{
+		clocks += recentLayers[i].clocks;
+	}
+	return (float)clocks * (1.0/(float)StepClockRate)/numRecentLayers;
+}
+
+// Return the ratio of the time that the moves took to the time they would have taken if they had all been done at their requested speeds.
+// This includes the effects of acceleration limits and of feed rate limits and M220. We don't return it until we have enough moves to make it meaningful.
+float JobAccounting::GetSpeedRatio() const noexcept
+{
+	uint64_t clocks, requestedClocks;
+	{
+		TaskCriticalSectionLocker lock;
+		clocks = totalClocks;
+		requestedClocks = totalRequestedClocks;
+	}
+	return (requestedClocks >= (uint64_t)MinSecondsForSpeedRatio * StepClockRate) ? (float)clocks/(float)requestedClocks : 0.0;
+}
+
+// Write the records for any layers that have been completed since we last did this
+void JobAccounting::Spin() noexcept
+{
+#if HAS_MASS_STORAGE
+	while (logFile != nullptr && numLayersLogged != numLayersCompleted)
+	{
+		LayerTotals layerTotals;
+		{
+			TaskCriticalSectionLocker lock;
+			const size_t layersBehind = numLayersCompleted - numLayersLogged;
+			if (layersBehind > numRecentLayers)
+			{
+				numLayersLogged = numLayersCompleted - numRecentLayers;		// the older layers have been overwritten in the history, which is only possible if the file is very slow
+				continue;
+			}
+			layerTotals = GetRecentLayer(layersBehind - 1);
+			++numLayersLogged;
+		}
+		if (!WriteRecord(JobAccountingRecord::LayerRecord, layerTotals.layer, layerTotals))
+		{
+			reprap.GetPlatform().MessageF(ErrorMessage, "Failed to write to job accounting file %s\n", logFileName.c_str());
+			CloseLog();
+			logFileName.Clear();
+		}
+	}
+#endif
+}
+
+#if HAS_MASS_STORAGE
+
+// Create the log file if we have a name for it, overwriting any existing file
+void JobAccounting::OpenLog() noexcept
+{
+	if (!logFileName.IsEmpty())
+	{
+		logFile = MassStorage::OpenFile(logFileName.c_str(), OpenMode::write, 0);
+		if (logFile != nullptr)
+		{
+			JobAccountingFileHeader hdr;
+			hdr.magic = JobAccountingFileHeader::MagicValue;
+			hdr.version = JobAccountingFileHeader::CurrentVersion;
+			hdr.recordSize = sizeof(JobAccountingRecord);
+			hdr.reserved = 0;
+			if (logFile->Write(reinterpret_cast<const char *>(&hdr), sizeof(hdr)))
+			{
+				return;
+			}
+			logFile->Close();
+			logFile = nullptr;
+		}
+		reprap.GetPlatform().MessageF(ErrorMessage, "Failed to create job accounting file %s\n", logFileName.c_str());
+	}
+}
+
+void JobAccounting::CloseLog() noexcept
+{
+	if (logFile != nullptr)
+	{
+		logFile->Close();
+		logFile = nullptr;
+	}
+}
+
+bool JobAccounting::WriteRecord(uint16_t recordType, uint32_t number, const Totals& t) noexcept
+{
+	JobAccountingRecord r;
+	r.recordType = recordType;
+	r.reserved = 0;
+	r.number = number;
+	r.printTime = t.GetPrintTime();
+	r.filament = t.filament;
+	return logFile != nullptr && logFile->Write(reinterpret_cast<const char *>(&r), sizeof(r));
+}
+
+#endif
+
+// Handle M73.1. F"filename" sets the file that the accounting records are written to during prints, F"" stops logging. With no parameters, report the totals.
+GCodeResult JobAccounting::HandleM73Point1(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
+{
+	String<MaxFilenameLength> fileName;
+	bool dummy = false;
+	if (gb.TryGetQuotedString('F', fileName.GetRef(), dummy, true))
+	{
+#if HAS_MASS_STORAGE
+		CloseLog();
+		if (fileName.IsEmpty())
+		{
+			logFileName.Clear();
+		}
+		else
+		{
+			reprap.GetPlatform().MakeSysFileName(logFileName.GetRef(), fileName.c_str());
+			if (printing)
+			{
+				OpenLog();									// the log will only contain the layers that are completed from now on
+				if (logFile == nullptr)
+				{
+					reply.printf("Failed to create file %s", logFileName.c_str());
+					logFileName.Clear();
+					return GCodeResult::error;
+				}
+			}
+		}
+		return GCodeResult::ok;
+#else
+		reply.copy("Job accounting log files are not supported by this build");
+		return GCodeResult::error;
+#endif
+	}
+
+	reply.printf("Job accounting: %u objects", numObjects);
+	for (size_t i = 0; i < numObjects; ++i)
+	{
+		reply.catf(", %u: %.1fs %.1fmm", i, (double)objectTotals[i].GetPrintTime(), (double)objectTotals[i].filament);
+	}
+	reply.catf(", other: %.1fs %.1fmm, average layer time %.1fs, speed ratio %.2f",
+				(double)otherTotals.GetPrintTime(), (double)otherTotals.filament, (double)GetAverageLayerTime(), (double)GetSpeedRatio());
+#if HAS_MASS_STORAGE
+	if (!logFileName.IsEmpty())
+	{
+		reply.catf(", logging to %s", logFileName.c_str());
+	}
+#endif
+	return GCodeResult::ok;
+}
+
+#endif
+
+// End
@@ -0,0 +1,116 @@
+/*
+ * JobAccounting.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  This adds up the print time and forward extrusion of every move that has been completed, per build plate object and per layer, so that
+ *  the cost of each object in a job can be worked out and so that PrintMonitor can estimate the time left from the measured layer times.
+ *  The object number and layer number are those that were current when the move was read from the file; they are carried to Move in RawMove.
+ *  We also compare the time that the moves took with the time they would have taken at their requested speeds, so that PrintMonitor can scale
+ *  the slicer's estimate of the time left to the speed that this machine actually achieves.
+ *  Completed layers are kept in a short history. M73.1 can also write each completed layer and the final object totals to a binary file,
+ *  whose layout is described in Developer-documentation/JobAccountingFileFormat.md.
+ */
+
+#ifndef SRC_PRINTMONITOR_JOBACCOUNTING_H_
+#define SRC_PRINTMONITOR_JOBACCOUNTING_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_JOB_ACCOUNTING
+
+#include <Movement/StepTimer.h>
+
+// The header at the start of a log file. It is followed by records of type JobAccountingRecord until the end of the file.
+struct JobAccountingFileHeader
+{
+	static constexpr uint32_t MagicValue = 0x41465252;		// "RRFA" when stored little-endian
+	static constexpr uint8_t CurrentVersion = 1;
+
+	uint32_t magic;
+	uint8_t version;
+	uint8_t recordSize;
+	uint16_t reserved;
+};
+
+struct JobAccountingRecord
+{
+	static constexpr uint16_t LayerRecord = 0;				// the totals for one layer, written when the first move of a following layer completes
+	static constexpr uint16_t ObjectRecord = 1;				// the totals for one object, written at the end of the print
+	static constexpr uint16_t OtherRecord = 2;				// the totals for moves that were not part of any tracked object, written at the end of the print
+
+	uint16_t recordType;
+	uint16_t reserved;
+	uint32_t number;										// the layer or object number
+	float printTime;										// the time in seconds taken by the moves
+	float filament;											// the forward extrusion in mm, summed over all extruders
+};
+
+static_assert(sizeof(JobAccountingFileHeader) == 8, "Header must be 8 bytes");
+static_assert(sizeof(JobAccountingRecord) == 16, "Record must be 16 bytes");
+
+class JobAccounting
+{
+public:
+	struct Totals
+	{
+		uint64_t clocks;									// step clocks, so that adding up millions of short moves doesn't lose precision
+		float filament;										// mm
+
+		void Clear() noexcept { clocks = 0; filament = 0.0; }
+		float GetPrintTime() const noexcept { return (float)clocks * (1.0/(float)StepClockRate); }		// return the print time in seconds
+	};
+
+	struct LayerTotals : public Totals
+	{
+		uint32_t layer;
+	};
+
+	JobAccounting() noexcept;
+
+	void StartPrint() noexcept;																// called by PrintMonitor when a print starts
+	void StopPrint() noexcept;																// called by PrintMonitor when a print stops
+	void RecordMove(int objectNumber, unsigned int layer, uint32_t clocks, uint32_t requestedClocks, float filament) noexcept;	// called by the Move task when a move has been completed
+	void Spin() noexcept;																	// called by PrintMonitor in the main task
+
+	size_t GetNumObjects() const noexcept { return numObjects; }
+	const Totals& GetObjectTotals(size_t objectNumber) const noexcept pre(objectNumber < GetNumObjects()) { return objectTotals[objectNumber]; }
+	const Totals& GetOtherTotals() const noexcept { return otherTotals; }
+	size_t GetNumRecentLayers() const noexcept { return numRecentLayers; }
+	const LayerTotals& GetRecentLayer(size_t n) const noexcept pre(n < GetNumRecentLayers());	// n = 0 is the most recently completed layer
+	float GetAverageLayerTime() const noexcept;												// return the average print time of the recent layers, or 0 if there are none
+	float GetSpeedRatio() const noexcept;													// return how much longer the moves took than at their requested speeds, or 0 if not known yet
+
+	GCodeResult HandleM73Point1(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);
+
+private:
+	static constexpr uint32_t MinSecondsForSpeedRatio = 60;	// how many seconds of moves at their requested speeds we need before we report the speed ratio
+
+	void FinishLayer() noexcept;
+	void OpenLog() noexcept;
+	void CloseLog() noexcept;
+	bool WriteRecord(uint16_t recordType, uint32_t number, const Totals& t) noexcept;
+
+	Totals objectTotals[MaxTrackedObjects];
+	Totals otherTotals;										// moves that were not part of a tracked object
+	LayerTotals recentLayers[JobAccountingRecentLayers];	// ring buffer of the most recently completed layers
+	LayerTotals currentLayerTotals;							// the layer that the most recently completed move belonged to
+	uint64_t totalClocks;									// how long the moves of this print have taken
+	uint64_t totalRequestedClocks;							// how long they would have taken at their requested speeds
+	size_t numObjects;										// one more than the highest object number we have recorded a move for
+	size_t nextRecentLayer;									// where the next completed layer will be stored in recentLayers
+	size_t numRecentLayers;
+	volatile size_t numLayersCompleted;						// incremented by the Move task, used to tell when there are layer records to write to the log
+	size_t numLayersLogged;
+	bool printing;
+
+#if HAS_MASS_STORAGE
+	String<MaxFilenameLength> logFileName;					// the full name of the log file, or empty if we are not logging
+	FileStore *logFile;
+#endif
+};
+
+#endif
+
+#endif /* SRC_PRINTMONITOR_JOBACCOUNTING_H_ */
@@ -62,10 +62,33 @@ const ObjectModelArrayDescriptor PrintMonitor::thumbnailArrayDescriptor =
 	[] (const ObjectModel *self, ObjectExplorationContext& context) noexcept -> ExpressionValue { return ExpressionValue(self, 2); }
 };
 
+#if SUPPORT_JOB_ACCOUNTING
+
+const ObjectModelArrayDescriptor PrintMonitor::accountingLayersArrayDescriptor =
+{
+	&printMonitorLock,
+	[] (const ObjectModel *self, const ObjectExplorationContext&) noexcept -> size_t
+			{ return ((const PrintMonitor*)self)->jobAccounting.GetNumRecentLayers(); },
+	[] (const ObjectModel *self, ObjectExplorationContext& context) noexcept -> ExpressionValue { return ExpressionValue(self, 5); }
+};
+
+const ObjectModelArrayDescriptor PrintMonitor::accountingObjectsArrayDescriptor =
+{
+	&printMonitorLock,
+	[] (const ObjectModel *self, const ObjectExplorationContext&) noexcept -> size_t
+			{ return ((const PrintMonitor*)self)->jobAccounting.GetNumObjects(); },
+	[] (const ObjectModel *self, ObjectExplorationContext& context) noexcept -> ExpressionValue { return ExpressionValue(self, 6); }
+};
+
+#endif
+
 constexpr ObjectModelTableEntry PrintMonitor::objectModelTable[] =
 {
 	// Within each group, these entries must be in alphabetical order
 	// 0. Job members
+#if SUPPORT_JOB_ACCOUNTING
+	{ "accounting",			OBJECT_MODEL_FUNC(self, 4),																			ObjectModelEntryFlags::live },
+#endif
 #if TRACK_OBJECT_NAMES
 	{ "build",				OBJECT_MODEL_FUNC_IF(self->IsPrinting(), self->gCodes.GetBuildObjects(), 0), 										ObjectModelEntryFlags::live },
 #endif
@@ -106,11 +129,47 @@ constexpr ObjectModelTableEntry PrintMonitor::objectModelTable[] =
 	// 3. TimesLeft members
 	{ "filament",			OBJECT_MODEL_FUNC(self->EstimateTimeLeftAsExpression(filamentBased)),												ObjectModelEntryFlags::live },
 	{ "file",				OBJECT_MODEL_FUNC(self->EstimateTimeLeftAsExpression(fileBased)),													ObjectModelEntryFlags::live },
+#if SUPPORT_JOB_ACCOUNTING
+	{ "layer",				OBJECT_MODEL_FUNC(self->EstimateTimeLeftAsExpression(layerBased)),													ObjectModelEntryFlags::live },
+#else
 	{ "layer", 				OBJECT_MODEL_FUNC_NOSELF(nullptr), 																					ObjectModelEntryFlags::obsolete },
+#endif
 	{ "slicer",				OBJECT_MODEL_FUNC(self->EstimateTimeLeftAsExpression(slicerBased)),													ObjectModelEntryFlags::live },
+#if SUPPORT_JOB_ACCOUNTING
+	{ "slicerAdjusted",		OBJECT_MODEL_FUNC(self->EstimateTimeLeftAsExpression(slicerAdjusted)),												ObjectModelEntryFlags::live },
+#endif
+
+#if SUPPORT_JOB_ACCOUNTING
+	// 4. Accounting members
+	{ "layers",				OBJECT_MODEL_FUNC_NOSELF(&accountingLayersArrayDescriptor),														ObjectModelEntryFlags::live },
+	{ "objects",			OBJECT_MODEL_FUNC_NOSELF(&accountingObjectsArrayDescriptor),														ObjectModelEntryFlags::live },
+
+	// 5. Accounting.layers[] members
+	{ "filament",			OBJECT_MODEL_FUNC(self->jobAccounting.GetRecentLayer(context.GetLastIndex()).filament, 1),							ObjectModelEntryFlags::none },
+	{ "layer",				OBJECT_MODEL_FUNC((int32_t)self->jobAccounting.GetRecentLayer(context.GetLastIndex()).layer),						ObjectModelEntryFlags::none },
+	{ "time",				OBJECT_MODEL_FUNC(self->jobAccounting.GetRecentLayer(context.GetLastIndex()).GetPrintTime(), 1),					ObjectModelEntryFlags::none },
+
+	// 6. Accounting.objects[] members
+	{ "filament",			OBJECT_MODEL_FUNC(self->jobAccounting.GetObjectTotals(context.GetLastIndex()).filament, 1),							ObjectModelEntryFlags::live },
+	{ "time",				OBJECT_MODEL_FUNC(self->jobAccounting.GetObjectTotals(context.GetLastIndex()).GetPrintTime(), 1),					ObjectModelEntryFlags::live },
+#endif
 };
 
-constexpr uint8_t PrintMonitor::objectModelTableDescriptor[] = { 4, 12 + TRACK_OBJECT_NAMES, 11, 5, 4 };
+constexpr uint8_t PrintMonitor::objectModelTableDescriptor[] =
+{
+	7,																		// number of sections
+	12 + TRACK_OBJECT_NAMES + SUPPORT_JOB_ACCOUNTING,						// job
+	11,																		// job.file
+	5,																		// job.file.thumbnails[]
+	4 + SUPPORT_JOB_ACCOUNTING,												// job.timesLeft
+#if SUPPORT_JOB_ACCOUNTING
+	2,																		// job.accounting
+	3,																		// job.accounting.layers[]
+	2																		// job.accounting.objects[]
+#else
+	0, 0, 0
+#endif
+};
 
 DEFINE_GET_OBJECT_MODEL_TABLE(PrintMonitor)
 
@@ -186,6 +245,13 @@ void PrintMonitor::SetPrintingFileInfo(const char *filename, GCodeFileInfo &info
 
 GCodeResult PrintMonitor::ProcessM73(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
 {
+#if SUPPORT_JOB_ACCOUNTING
+	if (gb.GetCommandFraction() == 1)
+	{
+		return jobAccounting.HandleM73Point1(gb, reply);
+	}
+#endif
+
 	if (gb.Seen('R'))
 	{
 		SetSlicerTimeLeft(gb.GetFValue() * MinutesToSeconds);
@@ -202,6 +268,10 @@ void PrintMonitor::SetSlicerTimeLeft(float seconds) noexcept
 
 void PrintMonitor::Spin() noexcept
 {
+#if SUPPORT_JOB_ACCOUNTING
+	jobAccounting.Spin();
+#endif
+
 #if HAS_SBC_INTERFACE
 	if (reprap.UsingSbcInterface())
 	{
@@ -340,12 +410,21 @@ void PrintMonitor::StartedPrint() noexcept
 	isPrinting = true;
 	SetLayerNumber(0);
 	Reset();
+#if SUPPORT_JOB_ACCOUNTING
+	jobAccounting.StartPrint();
+#endif
+#if SUPPORT_PREPARE_PROFILING
+	reprap.GetMove().GetPrepareProfiler().Reset();
+#endif
 }
 
 void PrintMonitor::StoppedPrint() noexcept
 {
 	isPrinting = printingFileParsed = false;
 	Reset();
+#if SUPPORT_JOB_ACCOUNTING
+	jobAccounting.StopPrint();
+#endif
 }
 
 // Set the current layer number as given in a comment
@@ -428,26 +507,62 @@ float PrintMonitor::EstimateTimeLeft(PrintEstimationMethod method) const noexcep
 			break;
 
 		case slicerBased:
-			if (slicerTimeLeft > 0.0 && !gCodes.IsSimulating())				// don't report slicer time if we are simulating
+			return GetSlicerTimeLeft();
+
+		case slicerAdjusted:
+#if SUPPORT_JOB_ACCOUNTING
+			// Scale the slicer's estimate by how much longer the moves have actually taken than they would have at their requested speeds.
+			// The slicer time left has been counting down in real time since it was last set, so we only scale the time left.
 			{
-				const int64_t now = millis64();
-				int64_t adjustment = (int64_t)(now - whenSlicerTimeLeftSet);			// add the time since we stored the slicer time left
-				if (heatingUp)
+				const float slicerTime = GetSlicerTimeLeft();
+				const float speedRatio = jobAccounting.GetSpeedRatio();
+				if (slicerTime > 0.0 && speedRatio > 0.0)
 				{
-					adjustment -= (int64_t)(now - heatingStartedTime);					// subtract any recent heating time
+					return max<float>(1.0, slicerTime * speedRatio);
 				}
-				if (paused)
+			}
+#endif
+			break;
+
+		case layerBased:
+#if SUPPORT_JOB_ACCOUNTING
+			// Use the measured print time of the recent layers, which doesn't include heating, pauses or dwells
+			if (printingFileInfo.numLayers != 0 && currentLayer != 0 && currentLayer <= printingFileInfo.numLayers)
+			{
+				const float averageLayerTime = jobAccounting.GetAverageLayerTime();
+				if (averageLayerTime > 0.0)
 				{
-					adjustment -= (int64_t)(now - pauseStartTime);						// subtract any current pause time
+					const float layersLeft = (float)(printingFileInfo.numLayers - currentLayer);
+					return max<float>(1.0, layersLeft * averageLayerTime + max<float>(averageLayerTime - GetCurrentLayerTime(), 0.0));
 				}
-				return max<float>(1.0, slicerTimeLeft - adjustment * MillisToSeconds);
 			}
+#endif
 			break;
 	}
 
 	return 0.0;
 }
 
+// Return the slicer's estimate of the time left, adjusted for the time that has elapsed since it was set, or 0 if we don't have it
+float PrintMonitor::GetSlicerTimeLeft() const noexcept
+{
+	if (slicerTimeLeft > 0.0 && !gCodes.IsSimulating())				// don't report slicer time if we are simulating
+	{
+		const int64_t now = millis64();
+		int64_t adjustment = (int64_t)(now - whenSlicerTimeLeftSet);			// add the time since we stored the slicer time left
+		if (heatingUp)
+		{
+			adjustment -= (int64_t)(now - heatingStartedTime);					// subtract any recent heating time
+		}
+		if (paused)
+		{
+			adjustment -= (int64_t)(now - pauseStartTime);						// subtract any current pause time
+		}
+		return max<float>(1.0, slicerTimeLeft - adjustment * MillisToSeconds);
+	}
+	return 0.0;
+}
+
 #if SUPPORT_OBJECT_MODEL
 
 // Return the estimated time remaining if we have it, else null
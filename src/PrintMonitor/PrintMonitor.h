@@ -23,12 +23,15 @@ Licence: GPL
 #include <RepRapFirmware.h>
 #include <GCodes/GCodeFileInfo.h>
 #include <ObjectModel/ObjectModel.h>
+#include "JobAccounting.h"
 
 enum PrintEstimationMethod
 {
 	filamentBased,
 	fileBased,
-	slicerBased
+	slicerBased,
+	layerBased,
+	slicerAdjusted
 };
 
 class PrintMonitor INHERIT_OBJECT_MODEL
@@ -64,10 +67,18 @@ public:
 	GCodeResult ProcessM73(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);
 	void SetSlicerTimeLeft(float seconds) noexcept;
 
+#if SUPPORT_JOB_ACCOUNTING
+	JobAccounting& GetJobAccounting() noexcept { return jobAccounting; }
+#endif
+
 protected:
 	DECLARE_OBJECT_MODEL
 	OBJECT_MODEL_ARRAY(filament)
 	OBJECT_MODEL_ARRAY(thumbnail)
+#if SUPPORT_JOB_ACCOUNTING
+	OBJECT_MODEL_ARRAY(accountingLayers)
+	OBJECT_MODEL_ARRAY(accountingObjects)
+#endif
 
 private:
 	static constexpr float MinFilamentUsageForEstimation = 0.01;		// Minimum per cent of filament to be printed before the filament-based estimation returns values
@@ -77,6 +88,7 @@ private:
 
 	void Reset() noexcept;
 	void PrintingFileInfoUpdated() noexcept;
+	float GetSlicerTimeLeft() const noexcept;
 
 #if SUPPORT_OBJECT_MODEL
 	ExpressionValue EstimateTimeLeftAsExpression(PrintEstimationMethod method) const noexcept;
@@ -117,6 +129,10 @@ private:
 	bool printingFileParsed;
 	GCodeFileInfo printingFileInfo;
 	String<MaxFilenameLength> filenameBeingPrinted;
+
+#if SUPPORT_JOB_ACCOUNTING
+	JobAccounting jobAccounting;
+#endif
 };
 
 inline bool PrintMonitor::IsPrinting() const noexcept { return isPrinting; }
@@ -171,12 +171,9 @@ Licence: GPL
 
 RepRap reprap;
 
-// Get the format string to use for printing a floating point number to the specified number of decimal digits. Zero means the maximum sensible number.
-const char *_ecv_array GetFloatFormatString(float val, unsigned int numDigitsAfterPoint) noexcept
+// Get the number of decimal digits to use when printing a floating point number to the specified number of decimal digits. Zero means the maximum sensible number.
+unsigned int GetFloatDigitsAfterPoint(float val, unsigned int numDigitsAfterPoint) noexcept
 {
-	static constexpr const char *_ecv_array FormatStrings[] = { "%.7f", "%.1f", "%.2f", "%.3f", "%.4f", "%.5f", "%.6f", "%.7f" };
-	static_assert(ARRAY_SIZE(FormatStrings) == MaxFloatDigitsDisplayedAfterPoint + 1);
-
 	float f = 1.0;
 	unsigned int maxDigitsAfterPoint = MaxFloatDigitsDisplayedAfterPoint;
 	while (maxDigitsAfterPoint > 1 && val >= f)
@@ -185,7 +182,93 @@ const char *_ecv_array GetFloatFormatString(float val, unsigned int numDigitsAft
 		--maxDigitsAfterPoint;
 	}
 
-	return FormatStrings[min<unsigned int>(numDigitsAfterPoint, maxDigitsAfterPoint)];
+	const unsigned int numDigits = min<unsigned int>(numDigitsAfterPoint, maxDigitsAfterPoint);
+	return (numDigits == 0) ? MaxFloatDigitsDisplayedAfterPoint : numDigits;
+}
+
+// Get the format string to use for printing a floating point number to the specified number of decimal digits. Zero means the maximum sensible number.
+const char *_ecv_array GetFloatFormatString(float val, unsigned int numDigitsAfterPoint) noexcept
+{
+	static constexpr const char *_ecv_array FormatStrings[] = { "%.7f", "%.1f", "%.2f", "%.3f", "%.4f", "%.5f", "%.6f", "%.7f" };
+	static_assert(ARRAY_SIZE(FormatStrings) == MaxFloatDigitsDisplayedAfterPoint + 1);
+
+	return FormatStrings[GetFloatDigitsAfterPoint(val, numDigitsAfterPoint)];
+}
+
+// Format a floating point number in the same way as the format string returned by GetFloatFormatString would, without going through printf.
+// The float is split into its 24-bit mantissa and binary exponent, and the mantissa is multiplied by a power of 10 and shifted using integer arithmetic,
+// so the result is rounded correctly (ties to even) just as printf rounds the exact value. This covers all values whose scaled digits fit in 32 bits,
+// which includes nearly everything we report. Return the number of characters stored in the buffer, or zero if the caller must use printf instead.
+size_t FormatFloat(char *_ecv_array buf, float val, unsigned int numDigitsAfterPoint) noexcept
+{
+	static constexpr uint32_t PowersOfTen[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000 };
+	static_assert(ARRAY_SIZE(PowersOfTen) == MaxFloatDigitsDisplayedAfterPoint + 1);
+
+	uint32_t bits;
+	memcpy(&bits, &val, sizeof(bits));
+	const uint32_t biasedExponent = (bits >> 23) & 0xFF;
+	if (biasedExponent == 0xFF)
+	{
+		return 0;											// NaN or infinity
+	}
+
+	// The value is mantissa * 2^shift and the result we want is round(value * 10^numDigits)
+	const unsigned int numDigits = GetFloatDigitsAfterPoint(val, numDigitsAfterPoint);
+	const uint64_t mantissa = (biasedExponent == 0) ? (bits & 0x007FFFFF) : (bits & 0x007FFFFF) | 0x00800000;
+	const int shift = (int)((biasedExponent == 0) ? 1 : biasedExponent) - 150;
+	uint64_t scaled = mantissa * PowersOfTen[numDigits];	// less than 2^48
+	if (shift >= 0)
+	{
+		if (shift >= 32 || scaled > (0xFFFFFFFFu >> shift))
+		{
+			return 0;
+		}
+		scaled <<= shift;
+	}
+	else if (shift > -49)
+	{
+		const uint64_t half = (uint64_t)1 << (-shift - 1);
+		const uint64_t remainder = scaled & ((half << 1) - 1);
+		scaled >>= -shift;
+		if (remainder > half || (remainder == half && (scaled & 1) != 0))
+		{
+			++scaled;
+		}
+		if (scaled > 0xFFFFFFFFu)
+		{
+			return 0;
+		}
+	}
+	else
+	{
+		scaled = 0;											// the value is less than 2^-25 so it rounds to zero
+	}
+
+	// Generate the digits backwards, including a zero before the decimal point if there are no others
+	char digits[12];
+	size_t numGenerated = 0;
+	uint32_t n = (uint32_t)scaled;
+	do
+	{
+		digits[numGenerated++] = (char)('0' + n % 10);
+		n /= 10;
+	} while (n != 0 || numGenerated <= numDigits);
+
+	size_t len = 0;
+	if ((bits & 0x80000000) != 0)
+	{
+		buf[len++] = '-';									// printf prints the sign even if the value rounds to zero
+	}
+	while (numGenerated != 0)
+	{
+		if (numGenerated == numDigits)
+		{
+			buf[len++] = '.';
+		}
+		buf[len++] = digits[--numGenerated];
+	}
+	buf[len] = 0;
+	return len;
 }
 
 static const char *_ecv_array const moduleName[] =
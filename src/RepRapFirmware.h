@@ -554,7 +554,10 @@ static inline constexpr float InverseConvertAcceleration(float accel) noexcept
 }
 
 constexpr unsigned int MaxFloatDigitsDisplayedAfterPoint = 7;
+constexpr size_t FloatFormatBufferSize = 14;						// enough for a sign, 10 digits, the decimal point, a leading zero and the null terminator
+unsigned int GetFloatDigitsAfterPoint(float val, unsigned int numDigitsAfterPoint) noexcept;
 const char *_ecv_array GetFloatFormatString(float val, unsigned int numDigitsAfterPoint) noexcept;
+size_t FormatFloat(char *_ecv_array buf, float val, unsigned int numDigitsAfterPoint) noexcept;
 
 #if SUPPORT_WORKPLACE_COORDINATES
 constexpr size_t NumCoordinateSystems = 9;							// G54 up to G59.3
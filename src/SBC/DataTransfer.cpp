@@ -12,6 +12,7 @@
 #include "SbcInterface.h"
 
 #include <Storage/CRC32.h>
+#include <Movement/StepTimer.h>
 #include <algorithm>
 
 #if defined(DUET_NG) && defined(USE_SBC)
@@ -230,7 +231,7 @@ pre(bytesToTransfer <= inBuffer.limit)
 		XDMAC_CC_DAM_INCREMENTED_AM |
 		XDMAC_CC_PERID(SBC_SPI_RX_PERID);
 	xdmac_rx_cfg.mbr_bc = 0;
-	xdmac_tx_cfg.mbr_ds = 0;
+	xdmac_rx_cfg.mbr_ds = 0;
 	xdmac_rx_cfg.mbr_sus = 0;
 	xdmac_rx_cfg.mbr_dus = 0;
 	xdmac_configure_transfer(XDMAC, DmacChanSbcRx, &xdmac_rx_cfg);
@@ -400,15 +401,21 @@ __nocache TransferHeader DataTransfer::rxHeader;
 __nocache TransferHeader DataTransfer::txHeader;
 __nocache uint32_t DataTransfer::rxResponse;
 __nocache uint32_t DataTransfer::txResponse;
-alignas(4) __nocache char DataTransfer::rxBuffer[SbcTransferBufferSize];
-alignas(4) __nocache char DataTransfer::txBuffer[SbcTransferBufferSize];
+alignas(4) __nocache char DataTransfer::rxBuffer[MaxSbcTransferBufferSize];
+alignas(4) __nocache char DataTransfer::txBuffer[MaxSbcTransferBufferSize];
 #endif
 
 DataTransfer::DataTransfer() noexcept : state(InternalTransferState::ExchangingData), lastTransferNumber(0), failedTransfers(0), checksumErrors(0),
+	transferStartTicks(0), transferEndTicks(0), statsStartMillis(0), numTransfers(0), numIdleGaps(0), bytesTransferred(0),
+	totalLatencyTicks(0), totalIdleTicks(0), maxLatencyTicks(0), maxIdleTicks(0), transferCompleted(false),
 #if SAME5x
 	rxBuffer(nullptr), txBuffer(nullptr),
 #endif
-	rxPointer(0), txPointer(0), packetId(0)
+#if USE_SAME5x_HARDWARE_CRC
+	rxCrcByDma(false),
+#endif
+	rxPointer(0), txPointer(0), transferBufferSize(SbcTransferBufferSize), pendingTransferBufferSize(SbcTransferBufferSize),
+	protocolVersion(MinSbcProtocolVersion), packetId(0)
 {
 	rxResponse = TransferResponse::Success;
 	txResponse = TransferResponse::Success;
@@ -418,7 +425,7 @@ DataTransfer::DataTransfer() noexcept : state(InternalTransferState::ExchangingD
 
 	// Prepare TX header
 	txHeader.formatCode = SbcFormatCode;
-	txHeader.protocolVersion = SbcProtocolVersion;
+	txHeader.protocolVersion = MinSbcProtocolVersion;				// until we know that the SBC supports a later version
 	txHeader.numPackets = 0;
 	txHeader.sequenceNumber = 0;
 }
@@ -432,8 +439,8 @@ void DataTransfer::Init() noexcept
 	if (reprap.UsingSbcInterface())
 	{
 		// Allocate buffers in SBC mode
-		rxBuffer = (char *)new uint32_t[(SbcTransferBufferSize + 3)/4];
-		txBuffer = (char *)new uint32_t[(SbcTransferBufferSize + 3)/4];
+		rxBuffer = (char *)new uint32_t[(MaxSbcTransferBufferSize + 3)/4];
+		txBuffer = (char *)new uint32_t[(MaxSbcTransferBufferSize + 3)/4];
 	}
 	else
 	{
@@ -513,8 +520,29 @@ void DataTransfer::InitFromTask() noexcept
 void DataTransfer::Diagnostics(MessageType mtype) noexcept
 {
 	reprap.GetPlatform().MessageF(mtype, "Transfer state: %d, failed transfers: %u, checksum errors: %u\n", (int)state, failedTransfers, checksumErrors);
-	reprap.GetPlatform().MessageF(mtype, "RX/TX seq numbers: %d/%d\n", (int)rxHeader.sequenceNumber, (int)txHeader.sequenceNumber);
+	reprap.GetPlatform().MessageF(mtype, "RX/TX seq numbers: %d/%d, protocol version %u, transfer size %u\n",
+									(int)rxHeader.sequenceNumber, (int)txHeader.sequenceNumber, (unsigned int)protocolVersion, (unsigned int)transferBufferSize);
 	reprap.GetPlatform().MessageF(mtype, "SPI underruns %u, overruns %u\n", spiTxUnderruns, spiRxOverruns);
+
+	// Report the transfer rate and timings since the last time we were called
+	const uint32_t now = millis();
+	const float seconds = (float)(now - statsStartMillis) * 0.001;
+	const float ticksPerMs = (float)StepClockRate * 0.001;
+	if (numTransfers != 0 && seconds > 0.0)
+	{
+		reprap.GetPlatform().MessageF(mtype, "Transfers %.1f/s, %.1fKb/s, latency avg %.2fms max %.2fms, idle avg %.2fms max %.2fms\n",
+										(double)((float)numTransfers/seconds), (double)((float)bytesTransferred/(seconds * 1024.0)),
+										(double)((float)totalLatencyTicks/((float)numTransfers * ticksPerMs)), (double)((float)maxLatencyTicks/ticksPerMs),
+										(double)((numIdleGaps == 0) ? 0.0 : (float)totalIdleTicks/((float)numIdleGaps * ticksPerMs)), (double)((float)maxIdleTicks/ticksPerMs));
+	}
+	else
+	{
+		reprap.GetPlatform().Message(mtype, "No transfers completed\n");
+	}
+	statsStartMillis = now;
+	numTransfers = numIdleGaps = bytesTransferred = 0;
+	totalLatencyTicks = totalIdleTicks = 0;
+	maxLatencyTicks = maxIdleTicks = 0;
 }
 
 const PacketHeader *DataTransfer::ReadPacket() noexcept
@@ -676,6 +704,12 @@ GCodeChannel DataTransfer::ReadDeleteLocalVariable(const StringRef& varName) noe
 	return GCodeChannel(header->channel);
 }
 
+size_t DataTransfer::ReadTransferBufferSize() noexcept
+{
+	const TransferBufferSizeHeader *header = ReadDataHeader<TransferBufferSizeHeader>();
+	return header->bufferSize;
+}
+
 FileHandle DataTransfer::ReadOpenFileResult(FilePosition& fileLength) noexcept
 {
 	// Read header
@@ -721,6 +755,14 @@ void DataTransfer::ExchangeData() noexcept
 	Cache::FlushBeforeDMASend(txBuffer, txHeader.dataLength);
 	size_t bytesToExchange = max<size_t>(rxHeader.dataLength, txHeader.dataLength);
 	state = InternalTransferState::ExchangingData;
+#if USE_SAME5x_HARDWARE_CRC
+	// Let the DMA controller compute the CRC of the received data as it arrives, unless we will receive more than the SBC sends
+	rxCrcByDma = (bytesToExchange == rxHeader.dataLength && rxHeader.dataLength % sizeof(uint32_t) == 0);
+	if (rxCrcByDma)
+	{
+		CRC32::StartDmaCrc(DmacChanSbcRx);
+	}
+#endif
 	setup_spi(rxBuffer, txBuffer, bytesToExchange);
 }
 
@@ -820,17 +862,25 @@ TransferState DataTransfer::DoTransfer() noexcept
 				ExchangeResponse(TransferResponse::BadFormat);
 				break;
 			}
-			if (rxHeader.protocolVersion != SbcProtocolVersion)
+			if (rxHeader.protocolVersion < MinSbcProtocolVersion || rxHeader.protocolVersion > SbcProtocolVersion)
 			{
 				ExchangeResponse(TransferResponse::BadProtocolVersion);
 				break;
 			}
-			if (rxHeader.dataLength > SbcTransferBufferSize)
+			if (rxHeader.dataLength > MaxSbcTransferBufferSize)
 			{
 				ExchangeResponse(TransferResponse::BadDataLength);
 				break;
 			}
 
+			// Report the same protocol version as the SBC from the next transfer on. If the SBC has gone back to an earlier version then it has
+			// been restarted, so it no longer knows about any transfer size we negotiated with it.
+			if (rxHeader.protocolVersion != protocolVersion)
+			{
+				protocolVersion = rxHeader.protocolVersion;
+				transferBufferSize = pendingTransferBufferSize = SbcTransferBufferSize;
+			}
+
 			ExchangeResponse(TransferResponse::Success);
 			break;
 		}
@@ -848,10 +898,7 @@ TransferState DataTransfer::DoTransfer() noexcept
 				else
 				{
 					// Everything OK
-					rxPointer = txPointer = 0;
-					packetId = 0;
-					state = InternalTransferState::ProcessingData;
-					return IsConnectionReset() ? TransferState::connectionReset : TransferState::finished;
+					return TransferFinished();
 				}
 			}
 			else if (rxResponse == TransferResponse::BadHeaderChecksum || txResponse == TransferResponse::BadHeaderChecksum)
@@ -871,13 +918,17 @@ TransferState DataTransfer::DoTransfer() noexcept
 		{
 			// (3) Exchanged data
 			Cache::InvalidateAfterDMAReceive(rxBuffer, rxHeader.dataLength);
+#if USE_SAME5x_HARDWARE_CRC
+			const uint32_t checksum = (rxCrcByDma) ? FinishDmaCrc() : CalcCRC32(rxBuffer, rxHeader.dataLength);
+#else
+			const uint32_t checksum = CalcCRC32(rxBuffer, rxHeader.dataLength);
+#endif
 			if (*reinterpret_cast<uint32_t*>(rxBuffer) == TransferResponse::BadResponse)
 			{
 				RestartTransfer(false);
 				break;
 			}
 
-			const uint32_t checksum = CalcCRC32(rxBuffer, rxHeader.dataLength);
 			if (rxHeader.crcData != checksum)
 			{
 				if (reprap.Debug(moduleSbcInterface))
@@ -898,10 +949,7 @@ TransferState DataTransfer::DoTransfer() noexcept
 			if (rxResponse == TransferResponse::Success && txResponse == TransferResponse::Success)
 			{
 				// Everything OK
-				rxPointer = txPointer = 0;
-				packetId = 0;
-				state = InternalTransferState::ProcessingData;
-				return IsConnectionReset() ? TransferState::connectionReset : TransferState::finished;
+				return TransferFinished();
 			}
 
 			if (rxResponse == TransferResponse::BadDataChecksum || txResponse == TransferResponse::BadDataChecksum)
@@ -962,8 +1010,44 @@ TransferState DataTransfer::DoTransfer() noexcept
 	return (state == InternalTransferState::ExchangingHeader) ? TransferState::doingFullTransfer : TransferState::doingPartialTransfer;
 }
 
+// Record the statistics for a transfer that has completed and prepare to process the received data
+TransferState DataTransfer::TransferFinished() noexcept
+{
+	transferEndTicks = StepTimer::GetTimerTicks();
+	const uint32_t latency = transferEndTicks - transferStartTicks;
+	totalLatencyTicks += latency;
+	if (latency > maxLatencyTicks)
+	{
+		maxLatencyTicks = latency;
+	}
+	++numTransfers;
+	transferCompleted = true;
+	bytesTransferred += rxHeader.dataLength + txHeader.dataLength;
+
+	// If we sent the SBC a new transfer size in this transfer then we can use it from now on
+	transferBufferSize = pendingTransferBufferSize;
+
+	rxPointer = txPointer = 0;
+	packetId = 0;
+	state = InternalTransferState::ProcessingData;
+	return IsConnectionReset() ? TransferState::connectionReset : TransferState::finished;
+}
+
 void DataTransfer::StartNextTransfer() noexcept
 {
+	// Record how long the SPI link was idle between the end of the last transfer and the start of this one
+	transferStartTicks = StepTimer::GetTimerTicks();
+	if (transferCompleted)
+	{
+		const uint32_t idle = transferStartTicks - transferEndTicks;
+		++numIdleGaps;
+		totalIdleTicks += idle;
+		if (idle > maxIdleTicks)
+		{
+			maxIdleTicks = idle;
+		}
+	}
+
 	lastTransferNumber = rxHeader.sequenceNumber;
 
 	// Reset RX transfer header
@@ -975,6 +1059,7 @@ void DataTransfer::StartNextTransfer() noexcept
 	rxHeader.crcHeader = 0;
 
 	// Set up TX transfer header
+	txHeader.protocolVersion = protocolVersion;
 	txHeader.numPackets = packetId;
 	txHeader.sequenceNumber++;
 	txHeader.dataLength = txPointer;
@@ -989,6 +1074,12 @@ void DataTransfer::ResetConnection(bool fullReset) noexcept
 {
 	// Clear the remaining data to send
 	disable_spi();
+#if USE_SAME5x_HARDWARE_CRC
+	if (rxCrcByDma)
+	{
+		(void)FinishDmaCrc();
+	}
+#endif
 	dataReceived = false;
 	rxPointer = txPointer = 0;
 	packetId = 0;
@@ -998,6 +1089,8 @@ void DataTransfer::ResetConnection(bool fullReset) noexcept
 	{
 		transferReadyHigh = false;
 		lastTransferNumber = rxHeader.sequenceNumber = txHeader.sequenceNumber = 0;
+		transferBufferSize = pendingTransferBufferSize = SbcTransferBufferSize;
+		protocolVersion = MinSbcProtocolVersion;
 	}
 
 	// Kick off a new transfer
@@ -1622,7 +1715,7 @@ bool DataTransfer::WriteReadFile(FileHandle handle, size_t bufferSize) noexcept
 	// Write data header
 	ReadFileHeader *header = WriteDataHeader<ReadFileHeader>();
 	header->handle = handle;
-	header->maxLength = min<uint32_t>(bufferSize, SbcTransferBufferSize - sizeof(FileDataHeader));
+	header->maxLength = min<uint32_t>(bufferSize, transferBufferSize - sizeof(FileDataHeader));
 	return true;
 }
 
@@ -1702,6 +1795,26 @@ bool DataTransfer::WriteCloseFile(FileHandle handle) noexcept
 	return true;
 }
 
+// Tell the SBC which transfer buffer size we will use, which is the requested size limited to what we support.
+// Both sides switch to the new size when the transfer that carries this packet has completed.
+bool DataTransfer::WriteTransferBufferSize(size_t requestedSize) noexcept
+{
+	// Check if it fits
+	if (!CanWritePacket(sizeof(TransferBufferSizeHeader)))
+	{
+		return false;
+	}
+
+	// Write packet header
+	(void)WritePacketHeader(FirmwareRequest::TransferBufferSize, sizeof(TransferBufferSizeHeader));
+
+	// Write data header
+	pendingTransferBufferSize = constrain<size_t>(requestedSize & ~(sizeof(uint32_t) - 1), SbcTransferBufferSize, MaxSbcTransferBufferSize);
+	TransferBufferSizeHeader *header = WriteDataHeader<TransferBufferSizeHeader>();
+	header->bufferSize = pendingTransferBufferSize;
+	return true;
+}
+
 PacketHeader *DataTransfer::WritePacketHeader(FirmwareRequest request, size_t dataLength, uint16_t resendPacketId) noexcept
 {
 	// Make sure to stay aligned if the last packet ended with a string
@@ -1738,4 +1851,15 @@ uint32_t DataTransfer::CalcCRC32(const char *buffer, size_t length) const noexce
 	return crc.Get();
 }
 
+#if USE_SAME5x_HARDWARE_CRC
+
+// Get the CRC of the data that the receive DMA channel transferred and release the CRC unit
+uint32_t DataTransfer::FinishDmaCrc() noexcept
+{
+	rxCrcByDma = false;
+	return CRC32::FinishDmaCrc();
+}
+
+#endif
+
 #endif
@@ -15,6 +15,7 @@
 #include <GCodes/GCodeFileInfo.h>
 #include <GCodes/GCodeChannel.h>
 #include "SbcMessageFormats.h"
+#include <Storage/CRC32.h>
 #include <RTOSIface/RTOSIface.h>
 
 class BinaryGCodeBuffer;
@@ -61,6 +62,7 @@ public:
 	bool ReadMessage(MessageType& type, OutputBuffer *buf) noexcept;						// Read a request to output a message
 	GCodeChannel ReadSetVariable(bool& createVariable, const StringRef& varName, const StringRef& expression) noexcept;	// Read a variable set request
 	GCodeChannel ReadDeleteLocalVariable(const StringRef& varName) noexcept;				// Read a variable deletion request
+	size_t ReadTransferBufferSize() noexcept;												// Read the transfer buffer size requested by the SBC
 	FileHandle ReadOpenFileResult(FilePosition& fileLength) noexcept;						// Read the result of a file open request
 	int ReadFileData(char *buffer, size_t length) noexcept;									// Read file data from the SBC
 
@@ -89,6 +91,7 @@ public:
 	bool WriteSeekFile(FileHandle handle, FilePosition offset) noexcept;
 	bool WriteTruncateFile(FileHandle handle) noexcept;
 	bool WriteCloseFile(FileHandle handle) noexcept;
+	bool WriteTransferBufferSize(size_t requestedSize) noexcept;
 
 private:
 	enum class InternalTransferState
@@ -107,6 +110,14 @@ private:
 	uint16_t lastTransferNumber;
 	unsigned int failedTransfers, checksumErrors;
 
+	// Transfer statistics, reset when they are reported
+	uint32_t transferStartTicks, transferEndTicks;		// step clock when the current transfer started and when the last one finished
+	uint32_t statsStartMillis;
+	uint32_t numTransfers, numIdleGaps, bytesTransferred;
+	uint64_t totalLatencyTicks, totalIdleTicks;
+	uint32_t maxLatencyTicks, maxIdleTicks;
+	bool transferCompleted;								// true if a transfer has finished since the connection was started
+
 	// Transfer buffers
 #if SAME70
 	// SAME70 has a write-back cache, so these must be in non-cached memory because we DMA to/from them.
@@ -116,8 +127,8 @@ private:
 	static __nocache TransferHeader txHeader;
 	static __nocache uint32_t rxResponse;
 	static __nocache uint32_t txResponse;
-	alignas(4) static __nocache char rxBuffer[SbcTransferBufferSize];
-	alignas(4) static __nocache char txBuffer[SbcTransferBufferSize];
+	alignas(4) static __nocache char rxBuffer[MaxSbcTransferBufferSize];
+	alignas(4) static __nocache char txBuffer[MaxSbcTransferBufferSize];
 #else
 	// The other processors we support have write-through cache
 	// Allocate the buffers in the object so that we can delete the object and recycle the memory if the SBC interface is not being used
@@ -128,8 +139,13 @@ private:
 	uint32_t txResponse;
 	char *rxBuffer;				// not allocated until we know we need it
 	char *txBuffer;				// not allocated until we know we need it
+#endif
+#if USE_SAME5x_HARDWARE_CRC
+	bool rxCrcByDma;										// true if the DMA controller is computing the CRC of the data we are receiving
 #endif
 	size_t rxPointer, txPointer;
+	size_t transferBufferSize, pendingTransferBufferSize;	// the negotiated size of a data transfer, and the size to use once the SBC has been told about it
+	uint16_t protocolVersion;								// the protocol version we report to the SBC
 
 	// Packet properties
 	uint16_t packetId;
@@ -140,12 +156,16 @@ private:
 	void ExchangeResponse(uint32_t response) noexcept;
 	void ExchangeData() noexcept;
 	void RestartTransfer(bool ownRequest) noexcept;
+	TransferState TransferFinished() noexcept;
 	uint32_t CalcCRC32(const char *buffer, size_t length) const noexcept;
+#if USE_SAME5x_HARDWARE_CRC
+	uint32_t FinishDmaCrc() noexcept;
+#endif
 
 	template<typename T> const T *ReadDataHeader() noexcept;
 
 	// Always keep enough tx space to allow resend requests in case RRF runs out of resources and cannot process an incoming request right away
-	size_t FreeTxSpace() const noexcept { return SbcTransferBufferSize - AddPadding(txPointer) - rxHeader.numPackets * sizeof(PacketHeader); }
+	size_t FreeTxSpace() const noexcept { return transferBufferSize - AddPadding(txPointer) - rxHeader.numPackets * sizeof(PacketHeader); }
 
 	bool CanWritePacket(size_t dataLength = 0) const noexcept;
 	PacketHeader *WritePacketHeader(FirmwareRequest request, size_t dataLength = 0, uint16_t resendPacktId = 0) noexcept;
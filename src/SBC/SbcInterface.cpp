@@ -52,12 +52,14 @@ extern "C" [[noreturn]] void SBCTaskStart(void * pvParameters) noexcept
 SbcInterface::SbcInterface() noexcept : isConnected(false), numDisconnects(0), numTimeouts(0), numSbcTimeouts(0), lastTransferTime(0),
 	maxDelayBetweenTransfers(SpiTransferDelay), maxFileOpenDelay(SpiFileOpenDelay), numMaxEvents(SpiEventsRequired),
 	delaying(false), numEvents(0), reportPause(false), reportPauseWritten(false), printAborted(false),
-	codeBuffer(nullptr), rxPointer(0), txPointer(0), txEnd(0), sendBufferUpdate(true), waitingForFileChunk(false),
+	codeBuffer(nullptr), sendBufferUpdate(true), waitingForFileChunk(false),
+	fileChunkCache(nullptr), cachedFileOffset(0), cachedFileDataLength(0), cachedFileLength(0), numFileChunkRequests(0), numFileChunksFromCache(0),
 	fileMutex(), numOpenFiles(0), fileSemaphore(), fileOperation(FileOperation::none), fileOperationPending(false)
 #ifdef TRACK_FILE_CODES
 	, fileCodesRead(0), fileCodesHandled(0), fileMacrosRunning(0), fileMacrosClosing(0)
 #endif
 {
+	ResetCodeBuffer();
 }
 
 void SbcInterface::Init() noexcept
@@ -265,39 +267,61 @@ void SbcInterface::ExchangeData() noexcept
 				break;
 			}
 
-			TaskCriticalSectionLocker locker;
-
-			// Make sure no existing codes are overwritten
-			uint16_t bufferedCodeSize = sizeof(BufferedCodeHeader) + packet->length;
-			if ((txEnd == 0 && bufferedCodeSize > max<uint16_t>(rxPointer, SpiCodeBufferSize - txPointer)) ||
-				(txEnd != 0 && bufferedCodeSize > rxPointer - txPointer))
+			// Codes that are too long to store would stall the channel, so discard them
+			const size_t bufferedCodeSize = sizeof(BufferedCodeHeader) + packet->length;
+			if (bufferedCodeSize > SpiCodeSegmentSize)
 			{
-#if false
-				// This isn't enabled because the debug call plus critical section would lead to software resets
-				debugPrintf("Failed to store code, RX/TX %d/%d-%d\n", rxPointer, txPointer, txEnd);
-#endif
-				packetAcknowledged = codeBufferAvailable = false;
+				reprap.GetPlatform().MessageF(WarningMessage, "Received binary code of %u bytes on channel %s, discarding\n", (unsigned int)packet->length, channel.ToString());
 				break;
 			}
 
-			// Overlap if necessary
-			if (txPointer + bufferedCodeSize > SpiCodeBufferSize)
+			TaskCriticalSectionLocker locker;
+
+			// Use the last segment of this channel if the code fits, else start a new segment
+			ChannelCodeQueue& queue = codeQueues[channel.ToBaseType()];
+			if (queue.tail < 0 || codeSegments[queue.tail].writeOffset + bufferedCodeSize > SpiCodeSegmentSize)
 			{
-				txEnd = txPointer;
-				txPointer = 0;
+				const int8_t segmentNumber = freeCodeSegments;
+				if (segmentNumber < 0)
+				{
+					packetAcknowledged = codeBufferAvailable = false;
+					break;
+				}
+
+				CodeSegment& segment = codeSegments[segmentNumber];
+				freeCodeSegments = segment.next;
+				--numFreeCodeSegments;
+				segment.readOffset = segment.writeOffset = 0;
+				segment.next = -1;
+				if (queue.tail < 0)
+				{
+					queue.head = segmentNumber;
+				}
+				else
+				{
+					codeSegments[queue.tail].next = segmentNumber;
+				}
+				queue.tail = segmentNumber;
 				sendBufferUpdate = true;
 			}
 
 			// Store the buffer header
-			BufferedCodeHeader *bufHeader = reinterpret_cast<BufferedCodeHeader *>(codeBuffer + txPointer);
+			CodeSegment& segment = codeSegments[queue.tail];
+			char *const codeStart = codeBuffer + queue.tail * SpiCodeSegmentSize + segment.writeOffset;
+			BufferedCodeHeader *bufHeader = reinterpret_cast<BufferedCodeHeader *>(codeStart);
 			bufHeader->isPending = true;
 			bufHeader->length = packet->length;
 
 			// Store the corresponding code. Binary codes are always aligned on a 4-byte boundary
-			uint32_t *dst = reinterpret_cast<uint32_t *>(codeBuffer + txPointer + sizeof(BufferedCodeHeader));
+			uint32_t *dst = reinterpret_cast<uint32_t *>(codeStart + sizeof(BufferedCodeHeader));
 			const uint32_t *src = reinterpret_cast<const uint32_t *>(code);
 			memcpyu32(dst, src, packet->length / sizeof(uint32_t));
-			txPointer += bufferedCodeSize;
+			segment.writeOffset += bufferedCodeSize;
+			queue.bytesBuffered += bufferedCodeSize;
+			if (queue.bytesBuffered > queue.maxBytesBuffered)
+			{
+				queue.maxBytesBuffered = queue.bytesBuffered;
+			}
 			break;
 		}
 
@@ -322,7 +346,7 @@ void SbcInterface::ExchangeData() noexcept
 			{
 				// Get the error message and send it back to DSF
 				OutputBuffer *buf;
-				if (OutputBuffer::Allocate(buf))
+				if (OutputBuffer::Allocate(buf, OutputBufferConsumer::sbc))
 				{
 					String<StringLength100> errorMessage;
 					e.GetMessage(errorMessage.GetRef(), nullptr);
@@ -566,7 +590,7 @@ void SbcInterface::ExchangeData() noexcept
 		case SbcRequest::Message:
 		{
 			OutputBuffer *buf;
-			if (OutputBuffer::Allocate(buf))
+			if (OutputBuffer::Allocate(buf, OutputBufferConsumer::sbc))
 			{
 				MessageType type;
 				if (transfer.ReadMessage(type, buf))
@@ -842,6 +866,11 @@ void SbcInterface::ExchangeData() noexcept
 			}
 			break;
 
+		// Request to change the size of the data transfers
+		case SbcRequest::SetTransferBufferSize:
+			packetAcknowledged = transfer.WriteTransferBufferSize(transfer.ReadTransferBufferSize());
+			break;
+
 		// Invalid request
 		default:
 #ifdef DEBUG
@@ -860,7 +889,7 @@ void SbcInterface::ExchangeData() noexcept
 
 	// Check if we can wait a short moment to reduce CPU load on the SBC
 	if (!skipNextDelay && numEvents < numMaxEvents && !waitingForFileChunk &&
-		!fileOperationPending && fileOperation == FileOperation::none)
+		!fileOperationPending && fileOperation == FileOperation::none && !IsCodeBufferLow())
 	{
 		delaying = true;
 		if (!TaskBase::Take((numOpenFiles != 0) ? maxFileOpenDelay : maxDelayBetweenTransfers))
@@ -887,13 +916,10 @@ void SbcInterface::ExchangeData() noexcept
 		}
 	}
 
-	// Notify DSF about the available buffer space
-	DefragmentBufferedCodes();
+	// Notify DSF about the available buffer space. We only count the free segments, so there may be more space for the channels that are partway through a segment.
 	if (!codeBufferAvailable || sendBufferUpdate)
 	{
-		TaskCriticalSectionLocker locker;
-
-		const uint16_t bufferSpace = (txEnd == 0) ? max<uint16_t>(rxPointer, SpiCodeBufferSize - txPointer) : rxPointer - txPointer;
+		const uint16_t bufferSpace = numFreeCodeSegments * SpiCodeSegmentSize;
 		sendBufferUpdate = !transfer.WriteCodeBufferUpdate(bufferSpace);
 	}
 
@@ -1143,9 +1169,13 @@ void SbcInterface::ExchangeData() noexcept
 
 void SbcInterface::InvalidateResources() noexcept
 {
-	rxPointer = txPointer = txEnd = 0;
+	{
+		TaskCriticalSectionLocker locker;
+		ResetCodeBuffer();
+	}
 	sendBufferUpdate = true;
 
+	cachedFileDataLength = 0;										// the files on the SBC may have changed
 	if (!requestedFileName.IsEmpty())
 	{
 		requestedFileDataLength = -1;
@@ -1197,7 +1227,25 @@ void SbcInterface::Diagnostics(MessageType mtype) noexcept
 	reprap.GetPlatform().Message(mtype, "=== SBC interface ===\n");
 	transfer.Diagnostics(mtype);
 	reprap.GetPlatform().MessageF(mtype, "State: %d, disconnects: %" PRIu32 ", timeouts: %" PRIu32 " total, %" PRIu32 " by SBC, IAP RAM available 0x%05" PRIx32 "\n", (int)state, numDisconnects, numTimeouts, numSbcTimeouts, iapRamAvailable);
-	reprap.GetPlatform().MessageF(mtype, "Buffer RX/TX: %d/%d-%d, open files: %u\n", (int)rxPointer, (int)txPointer, (int)txEnd, numOpenFiles);
+	reprap.GetPlatform().MessageF(mtype, "Code buffer segments free: %u/%u, open files: %u\n", (unsigned int)numFreeCodeSegments, (unsigned int)NumSpiCodeSegments, numOpenFiles);
+
+	// Report how many bytes of codes each channel has buffered now and at most since the last report
+	String<StringLength256> occupancy;
+	for (size_t i = 0; i < NumGCodeChannels; ++i)
+	{
+		ChannelCodeQueue& queue = codeQueues[i];
+		if (queue.maxBytesBuffered != 0)
+		{
+			occupancy.catf(" %s %u/%u", GCodeChannel((uint8_t)i).ToString(), (unsigned int)queue.bytesBuffered, (unsigned int)queue.maxBytesBuffered);
+			queue.maxBytesBuffered = queue.bytesBuffered;
+		}
+	}
+	reprap.GetPlatform().MessageF(mtype, "Buffered code bytes now/max:%s\n", (occupancy.IsEmpty()) ? " none" : occupancy.c_str());
+	if (numFileChunkRequests != 0)
+	{
+		reprap.GetPlatform().MessageF(mtype, "File chunks requested: %u, read ahead: %u\n", numFileChunkRequests, numFileChunksFromCache);
+		numFileChunkRequests = numFileChunksFromCache = 0;
+	}
 #ifdef TRACK_FILE_CODES
 	reprap.GetPlatform().MessageF(mtype, "File codes read/handled: %d/%d, file macros open/closing: %d %d\n", (int)fileCodesRead, (int)fileCodesHandled, (int)fileMacrosRunning, (int)fileMacrosClosing);
 #endif
@@ -1256,102 +1304,85 @@ bool SbcInterface::FillBuffer(GCodeBuffer &gb) noexcept
 
 	bool gotCommand = false;
 	{
-		//TODO can we take the lock inside the loop body instead, if we re-read readPointer and writePointer after taking it?
 		TaskCriticalSectionLocker locker;
-		if (rxPointer != txPointer || txEnd != 0)
+		ChannelCodeQueue& queue = codeQueues[gb.GetChannel().ToBaseType()];
+		if (queue.head >= 0)
 		{
-			bool updateRxPointer = true;
-			uint16_t readPointer = rxPointer;
-			do
-			{
-				BufferedCodeHeader *bufHeader = reinterpret_cast<BufferedCodeHeader*>(codeBuffer + readPointer);
-				readPointer += sizeof(BufferedCodeHeader);
-				const CodeHeader *codeHeader = reinterpret_cast<const CodeHeader*>(codeBuffer + readPointer);
-				readPointer += bufHeader->length;
-
-				RRF_ASSERT(bufHeader->length > 0);
-				RRF_ASSERT(readPointer <= SpiCodeBufferSize);
+			// The first segment of a channel always holds at least one code, because we free segments as soon as they have been read
+			CodeSegment& segment = codeSegments[queue.head];
+			const char *const codeStart = codeBuffer + queue.head * SpiCodeSegmentSize + segment.readOffset;
+			const BufferedCodeHeader *bufHeader = reinterpret_cast<const BufferedCodeHeader*>(codeStart);
+			const size_t bufferedCodeSize = sizeof(BufferedCodeHeader) + bufHeader->length;
+			RRF_ASSERT(bufHeader->length > 0);
+			RRF_ASSERT(segment.readOffset + bufferedCodeSize <= segment.writeOffset);
 
-				if (bufHeader->isPending)
+#ifdef TRACK_FILE_CODES
+			if (gb.GetChannel() == GCodeChannel::File && gb.GetCommandLetter() != 'Q')
+			{
+				fileMacrosRunning -= fileMacrosClosing;
+				fileMacrosClosing = 0;
+				if (fileCodesRead > fileCodesHandled + fileMacrosRunning)
 				{
-					if (gb.GetChannel().RawValue() == codeHeader->channel)
+					// Note that we cannot use MessageF here because the task scheduler is suspended
+					OutputBuffer *buf;
+					if (OutputBuffer::Allocate(buf, OutputBufferConsumer::sbc))
 					{
-#ifdef TRACK_FILE_CODES
-						if (gb.GetChannel() == GCodeChannel::File && gb.GetCommandLetter() != 'Q')
-						{
-							fileMacrosRunning -= fileMacrosClosing;
-							fileMacrosClosing = 0;
-							if (fileCodesRead > fileCodesHandled + fileMacrosRunning)
-							{
-								// Note that we cannot use MessageF here because the task scheduler is suspended
-								OutputBuffer *buf;
-								if (OutputBuffer::Allocate(buf))
-								{
-									String<SHORT_GCODE_LENGTH> codeString;
-									gb.PrintCommand(codeString.GetRef());
-									buf->printf("Code %s did not return a code result, delta %d, running macros %d\n", codeString.c_str(), fileCodesRead - fileCodesHandled - fileMacrosRunning, fileMacrosRunning);
-									gcodeReply.Push(buf, WarningMessage);
-								}
-								fileCodesRead = fileCodesHandled - fileMacrosRunning;
-							}
-							fileCodesRead++;
-						}
-#endif
-
-						// Process the next binary G-code
-						gb.PutBinary(reinterpret_cast<const uint32_t *>(codeHeader), bufHeader->length / sizeof(uint32_t));
-						bufHeader->isPending = false;
-
-						// Check if we can reset the ring buffer pointers
-						if (updateRxPointer)
-						{
-							sendBufferUpdate = true;
-							if (readPointer == txPointer && txEnd == 0)
-							{
-								// Buffer completely read, reset RX/TX pointers
-								rxPointer = txPointer = 0;
-							}
-							else if (readPointer == txEnd)
-							{
-								// Read last code before overlapping, restart from the beginning
-								rxPointer = txEnd = 0;
-							}
-							else
-							{
-								// Code has been read, move on to the next one
-								rxPointer = readPointer;
-							}
-						}
-
-						gotCommand = true;
-						break;
+						String<SHORT_GCODE_LENGTH> codeString;
+						gb.PrintCommand(codeString.GetRef());
+						buf->printf("Code %s did not return a code result, delta %d, running macros %d\n", codeString.c_str(), fileCodesRead - fileCodesHandled - fileMacrosRunning, fileMacrosRunning);
+						gcodeReply.Push(buf, WarningMessage);
 					}
-					updateRxPointer = false;
+					fileCodesRead = fileCodesHandled - fileMacrosRunning;
 				}
+				fileCodesRead++;
+			}
+#endif
 
-				if (readPointer == txEnd)
-				{
-					if (updateRxPointer)
-					{
-						// Skipped non-pending codes, restart from the beginning
-						rxPointer = txEnd = 0;
-					}
+			// Process the next binary G-code
+			gb.PutBinary(reinterpret_cast<const uint32_t *>(codeStart + sizeof(BufferedCodeHeader)), bufHeader->length / sizeof(uint32_t));
+			segment.readOffset += bufferedCodeSize;
+			queue.bytesBuffered -= bufferedCodeSize;
 
-					// About to overlap, continue from the start
-					readPointer = 0;
+			// Return the segment to the free list if we have read everything in it
+			if (segment.readOffset == segment.writeOffset)
+			{
+				const int8_t segmentNumber = queue.head;
+				queue.head = segment.next;
+				if (queue.head < 0)
+				{
+					queue.tail = -1;
 				}
-			} while (readPointer != txPointer);
+				FreeCodeSegment(segmentNumber);
+			}
+			gotCommand = true;
 		}
 	}
 
 	if (gotCommand)
 	{
+		// Fetch more codes straight away if the print is about to run out of them
+		if (delaying && gb.GetChannel() == GCodeChannel::File && IsCodeBufferLow())
+		{
+			delaying = false;
+			sbcTask->Give();
+		}
+
 		gb.DecodeCommand();
 		return true;
 	}
 	return false;
 }
 
+// Check if a file is being printed (and not paused) and the number of bytes of buffered codes has fallen below the low-water mark
+bool SbcInterface::IsCodeBufferLow() const noexcept
+{
+	if (!reprap.GetGCodes().IsReallyPrinting())
+	{
+		return false;
+	}
+	return codeQueues[GCodeChannel::ToBaseType(GCodeChannel::File)].bytesBuffered < SpiCodeBufferLowWater;
+}
+
 bool SbcInterface::FileExists(const char *filename) noexcept
 {
 	// Don't do anything if the SBC is not connected
@@ -1668,7 +1699,7 @@ void SbcInterface::HandleGCodeReply(MessageType mt, const char *reply) noexcept
 		// Try to save some space by combining segments that have the Push flag set
 		buffer->cat(reply);
 	}
-	else if (reply[0] != 0 && OutputBuffer::Allocate(buffer))
+	else if (reply[0] != 0 && OutputBuffer::Allocate(buffer, OutputBufferConsumer::sbc))
 	{
 		// Attempt to allocate one G-code buffer per non-empty output message
 		buffer->cat(reply);
@@ -1705,6 +1736,8 @@ void SbcInterface::HandleGCodeReply(MessageType mt, OutputBuffer *buffer) noexce
 // Read a file chunk from the SBC. When a response has been received, the current task is woken up again.
 // It changes bufferLength to the number of received bytes
 // This method returns true on success and false if an error occurred (e.g. file not found)
+// Expansion boards fetch their firmware in small sequential chunks, so we ask the SBC for SbcFileChunkCacheSize bytes at a time and serve the following
+// requests from the read-ahead buffer. This saves one SBC round trip per chunk.
 bool SbcInterface::GetFileChunk(const char *filename, uint32_t offset, char *buffer, uint32_t& bufferLength, uint32_t& fileLength) noexcept
 {
 	// Don't do anything if the SBC is not connected
@@ -1713,6 +1746,55 @@ bool SbcInterface::GetFileChunk(const char *filename, uint32_t offset, char *buf
 		return false;
 	}
 
+	++numFileChunkRequests;
+
+	// Serve the request from the read-ahead buffer if we can. A new firmware update starts at offset 0, so always fetch that from the SBC in case the file has changed.
+	if (   offset != 0 && cachedFileDataLength != 0
+		&& offset >= cachedFileOffset && offset < cachedFileOffset + cachedFileDataLength
+		&& (offset + bufferLength <= cachedFileOffset + cachedFileDataLength || cachedFileOffset + cachedFileDataLength >= cachedFileLength)
+		&& cachedFileName.Equals(filename)
+	   )
+	{
+		bufferLength = min<uint32_t>(bufferLength, cachedFileOffset + cachedFileDataLength - offset);
+		memcpy(buffer, fileChunkCache + (offset - cachedFileOffset), bufferLength);
+		fileLength = cachedFileLength;
+		++numFileChunksFromCache;
+		return true;
+	}
+
+	cachedFileDataLength = 0;
+	if (bufferLength < SbcFileChunkCacheSize)
+	{
+		if (fileChunkCache == nullptr)
+		{
+			fileChunkCache = new char[SbcFileChunkCacheSize];
+		}
+
+		if (fileChunkCache != nullptr)
+		{
+			uint32_t bytesRead = SbcFileChunkCacheSize;
+			if (!RequestFileChunk(filename, offset, fileChunkCache, bytesRead, fileLength))
+			{
+				bufferLength = 0;
+				return false;
+			}
+
+			cachedFileName.copy(filename);
+			cachedFileOffset = offset;
+			cachedFileDataLength = bytesRead;
+			cachedFileLength = fileLength;
+			bufferLength = min<uint32_t>(bufferLength, bytesRead);
+			memcpy(buffer, fileChunkCache, bufferLength);
+			return true;
+		}
+	}
+
+	return RequestFileChunk(filename, offset, buffer, bufferLength, fileLength);
+}
+
+// Ask the SBC for a file chunk and wait for the response
+bool SbcInterface::RequestFileChunk(const char *filename, uint32_t offset, char *buffer, uint32_t& bufferLength, uint32_t& fileLength) noexcept
+{
 	if (waitingForFileChunk)
 	{
 		reprap.GetPlatform().Message(ErrorMessage, "Trying to request a file chunk from two independent tasks\n");
@@ -1771,139 +1853,46 @@ void SbcInterface::EventOccurred(bool timeCritical) noexcept
 	}
 }
 
-void SbcInterface::DefragmentBufferedCodes() noexcept
+// Put all the code segments on the free list. The caller must suspend task switching or make sure that the other tasks are not using the buffer.
+void SbcInterface::ResetCodeBuffer() noexcept
 {
-	TaskCriticalSectionLocker locker;
-	if (rxPointer != txPointer || txEnd != 0)
+	for (size_t i = 0; i < NumSpiCodeSegments; ++i)
 	{
-		const uint16_t bufferSpace = (txEnd == 0) ? max<uint16_t>(rxPointer, SpiCodeBufferSize - txPointer) : rxPointer - txPointer;
-		if (bufferSpace > MaxCodeBufferSize)
-		{
-			// There is still enough space left for at least one more code, don't worry about fragmentation yet
-			return;
-		}
-
-		if (txEnd == 0)
-		{
-			// Ring buffer data is sequential (rxPointer..txPointer, txEnd=0)
-			(void)DefragmentCodeBlock(rxPointer, txPointer);
-		}
-		else
-		{
-			// Ring buffer overlapped (rxPointer..txEnd, 0..txPointer)
-			if (!DefragmentCodeBlock(rxPointer, txEnd) &&
-				!DefragmentCodeBlock(0, txPointer) &&
-				SpiCodeBufferSize - (size_t)txEnd > MaxCodeBufferSize)
-			{
-				size_t endBufferSize = txEnd - rxPointer;
-				memmoveu32(reinterpret_cast<uint32_t*>(codeBuffer + SpiCodeBufferSize - endBufferSize), reinterpret_cast<uint32_t*>(codeBuffer + rxPointer), endBufferSize / sizeof(uint32_t));
-				rxPointer = SpiCodeBufferSize - endBufferSize;
-				txEnd = SpiCodeBufferSize;
-			}
-		}
+		codeSegments[i].next = (i + 1 < NumSpiCodeSegments) ? (int8_t)(i + 1) : -1;
+		codeSegments[i].readOffset = codeSegments[i].writeOffset = 0;
 	}
-}
+	freeCodeSegments = 0;
+	numFreeCodeSegments = NumSpiCodeSegments;
 
-// Defragment a specific block of the code buffer and update the end of it
-bool SbcInterface::DefragmentCodeBlock(uint16_t start, volatile uint16_t &end) noexcept
-{
-	char *gapStart = nullptr;
-	for (uint16_t readPointer = start; readPointer != end;)
+	for (ChannelCodeQueue& queue : codeQueues)
 	{
-		BufferedCodeHeader *bufHeader = reinterpret_cast<BufferedCodeHeader *>(codeBuffer + readPointer);
-		size_t bufSize = sizeof(BufferedCodeHeader) + bufHeader->length;
-		readPointer += bufSize;
-
-		if (bufHeader->isPending)
-		{
-			if (gapStart != nullptr)
-			{
-				size_t gapSize = reinterpret_cast<const char *>(bufHeader) - gapStart;
-				if (gapSize >= bufSize)
-				{
-					// Gap size is big enough to accommodate the next code
-					memcpyu32(reinterpret_cast<uint32_t*>(gapStart), reinterpret_cast<uint32_t *>(bufHeader), bufSize / sizeof(uint32_t));		// requires incrementing copy order
-					gapStart += bufSize;
-				}
-				else
-				{
-					// Gap size is too small. Move the remaining buffer but only once per run
-					memcpyu32(reinterpret_cast<uint32_t*>(gapStart), reinterpret_cast<uint32_t *>(bufHeader), (codeBuffer + end - gapStart) / sizeof(uint32_t));
-					readPointer = (uint16_t)(gapStart - codeBuffer + bufSize);
-					gapStart = nullptr;
-					end -= gapSize;
-					sendBufferUpdate = true;
-					return true;
-				}
-			}
-		}
-		else if (gapStart == nullptr)
-		{
-			gapStart = reinterpret_cast<char *>(bufHeader);
-		}
+		queue.head = queue.tail = -1;
+		queue.bytesBuffered = 0;
 	}
+}
 
-	if (gapStart != nullptr)
-	{
-		end = (uint16_t)(gapStart - codeBuffer);
-		sendBufferUpdate = true;
-		return true;
-	}
-	return false;
+// Return a segment to the free list. Called with task switching suspended.
+void SbcInterface::FreeCodeSegment(int8_t segmentNumber) noexcept
+{
+	codeSegments[segmentNumber].next = freeCodeSegments;
+	freeCodeSegments = segmentNumber;
+	++numFreeCodeSegments;
+	sendBufferUpdate = true;
 }
 
+// Discard every buffered code of the corresponding channel
 void SbcInterface::InvalidateBufferedCodes(GCodeChannel channel) noexcept
 {
 	TaskCriticalSectionLocker locker;
-	if (rxPointer != txPointer || txEnd != 0)
+	ChannelCodeQueue& queue = codeQueues[channel.ToBaseType()];
+	while (queue.head >= 0)
 	{
-		bool updateRxPointer = true;
-		uint16_t readPointer = rxPointer;
-		do
-		{
-			BufferedCodeHeader *bufHeader = reinterpret_cast<BufferedCodeHeader *>(codeBuffer + readPointer);
-			if (bufHeader->isPending)
-			{
-				const CodeHeader *codeHeader = reinterpret_cast<const CodeHeader*>(codeBuffer + readPointer + sizeof(BufferedCodeHeader));
-				if (codeHeader->channel == channel.RawValue())
-				{
-					bufHeader->isPending = false;
-					sendBufferUpdate = true;
-				}
-				else
-				{
-					updateRxPointer = false;
-				}
-			}
-			readPointer += sizeof(BufferedCodeHeader) + bufHeader->length;
-
-			if (updateRxPointer)
-			{
-				if (readPointer == txPointer && txEnd == 0)
-				{
-					// Buffer is empty again, reset the pointers
-					rxPointer = txPointer = 0;
-					break;
-				}
-				else if (readPointer == txEnd)
-				{
-					// Invalidated last code before overlapping, continue from the beginning
-					readPointer = 0;
-					rxPointer = txEnd = 0;
-				}
-				else
-				{
-					// Invalidated next code
-					rxPointer = readPointer;
-				}
-			}
-			else if (readPointer == txEnd)
-			{
-				// About to overlap, continue from the start
-				readPointer = 0;
-			}
-		} while (readPointer != txPointer);
+		const int8_t segmentNumber = queue.head;
+		queue.head = codeSegments[segmentNumber].next;
+		FreeCodeSegment(segmentNumber);
 	}
+	queue.tail = -1;
+	queue.bytesBuffered = 0;
 }
 
 #endif
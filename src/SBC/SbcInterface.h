@@ -84,8 +84,27 @@ private:
 	PrintPausedReason pauseReason;
 	bool reportPause, reportPauseWritten, printAborted;
 
+	// Buffered codes. The code buffer is divided into segments and each segment holds codes for just one channel, in the order they arrived.
+	// Each channel owns a chain of segments and each segment goes back on the free list as soon as all its codes have been read,
+	// so codes never have to be moved to make space for longer ones. Access to these is protected by suspending task switching.
+	struct CodeSegment
+	{
+		uint16_t readOffset;											// offset of the next code to read
+		uint16_t writeOffset;											// offset at which to store the next code
+		int8_t next;													// the next segment of the same channel or on the free list, or -1
+	};
+
+	struct ChannelCodeQueue
+	{
+		int8_t head, tail;												// the first and last segments holding codes for this channel, or -1
+		uint16_t bytesBuffered, maxBytesBuffered;						// bytes of codes stored now and at most since the last diagnostics report
+	};
+
 	char *codeBuffer;
-	volatile uint16_t rxPointer, txPointer, txEnd;
+	CodeSegment codeSegments[NumSpiCodeSegments];
+	ChannelCodeQueue codeQueues[NumGCodeChannels];
+	int8_t freeCodeSegments;											// the first segment on the free list, or -1
+	uint8_t numFreeCodeSegments;
 	volatile bool sendBufferUpdate;
 
 	uint32_t iapRamAvailable;											// must be at least 32Kb otherwise the SPI IAP can't work
@@ -99,6 +118,14 @@ private:
 	char *requestedFileBuffer;
 	int32_t requestedFileDataLength;
 
+	// Read-ahead buffer for file chunks, allocated when it is first needed
+	char *fileChunkCache;
+	String<MaxFilenameLength> cachedFileName;
+	uint32_t cachedFileOffset, cachedFileDataLength, cachedFileLength;
+	unsigned int numFileChunkRequests, numFileChunksFromCache;
+
+	bool RequestFileChunk(const char *filename, uint32_t offset, char *buffer, uint32_t& bufferLength, uint32_t& fileLength) noexcept;
+
 	// File I/O
 	Mutex fileMutex;													// locked while a file operation is performed
 	unsigned int numOpenFiles;
@@ -139,9 +166,10 @@ private:
 	void ExchangeData() noexcept;											// Exchange data between RRF and the SBC
 	[[noreturn]] void ReceiveAndStartIap(const char *iapChunk, size_t length) noexcept;	// Receive and start the IAP binary
 	void InvalidateResources() noexcept;									// Invalidate local resources on connection errors
-	void DefragmentBufferedCodes() noexcept;								// Attempt to defragment the code buffer ring to avoid stalls
-	bool DefragmentCodeBlock(uint16_t start, volatile uint16_t &end) noexcept;	// Defragment a specific code buffer region returning true if anything was defragmented
-	void InvalidateBufferedCodes(GCodeChannel channel) noexcept;           	// Invalidate every buffered G-code of the corresponding channel from the buffer ring
+	void ResetCodeBuffer() noexcept;										// Discard all buffered codes
+	void FreeCodeSegment(int8_t segmentNumber) noexcept;					// Return a code segment to the free list
+	bool IsCodeBufferLow() const noexcept;										// Check if we are printing a file and running short of buffered codes
+	void InvalidateBufferedCodes(GCodeChannel channel) noexcept;           	// Invalidate every buffered G-code of the corresponding channel
 };
 
 inline void SbcInterface::SetPauseReason(FilePosition position, PrintPausedReason reason) noexcept
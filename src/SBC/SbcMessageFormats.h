@@ -8,7 +8,7 @@
 #ifndef SRC_SBC_MESSAGEFORMATS_H_
 #define SRC_SBC_MESSAGEFORMATS_H_
 
-#if HAS_SBC_INTERFACE
+#if HAS_BINARY_PARSER			// the code formats are also used by binary G-code files
 
 #include <cstddef>
 #include <cstdint>
@@ -21,23 +21,42 @@ constexpr uint8_t SbcFormatCode = 0x5F;				// standard format code for RRF SPI p
 constexpr uint8_t SbcFormatCodeStandalone = 0x60;	// used to indicate that RRF is running in stand-alone mode
 constexpr uint8_t InvalidFormatCode = 0xC9;			// must be different from any other format code
 
-constexpr uint16_t SbcProtocolVersion = 6;
+constexpr uint16_t SbcProtocolVersion = 7;			// highest protocol version we support
+constexpr uint16_t MinSbcProtocolVersion = 6;		// lowest protocol version we support. Version 7 adds negotiation of the transfer buffer size.
 
-constexpr size_t SbcTransferBufferSize = 8192;		// maximum length of a data transfer. Must be a multiple of 4 and kept in sync with Duet Control Server!
+constexpr size_t SbcTransferBufferSize = 8192;		// maximum length of a data transfer until a larger size is negotiated. Must be a multiple of 4 and kept in sync with Duet Control Server!
 static_assert(SbcTransferBufferSize % sizeof(uint32_t) == 0, "SbcTransferBufferSize must be a whole number of dwords");
 
+#if SAME70
+constexpr size_t MaxSbcTransferBufferSize = 16384;	// largest transfer buffer size we can negotiate, limited by the amount of non-cached RAM
+#else
+constexpr size_t MaxSbcTransferBufferSize = SbcTransferBufferSize;
+#endif
+static_assert(MaxSbcTransferBufferSize % sizeof(uint32_t) == 0 && MaxSbcTransferBufferSize >= SbcTransferBufferSize && MaxSbcTransferBufferSize <= 65532, "Bad MaxSbcTransferBufferSize");
+
 constexpr size_t MaxCodeBufferSize = 256;			// maximum length of a G/M/T-code in binary encoding
 static_assert(MaxCodeBufferSize % sizeof(uint32_t) == 0, "MaxCodeBufferSize must be a whole number of dwords");
 
 constexpr uint32_t SpiTransferDelay = 25;			// default time to wait after a transfer before another one is started (in ms)
 constexpr uint32_t SpiFileOpenDelay = 5;			// same as above but when a file is open
 constexpr uint32_t SpiEventsRequired = 4;			// number of events required to happen in RRF before the delay is skipped
+constexpr uint16_t SpiCodeBufferLowWater = 1024;	// skip the delay while a file is being printed and fewer than this number of bytes of codes are buffered
 
 constexpr uint32_t SpiMaxRequestTime = 3000;		// maximum time to wait a blocking request (like macros or file requests, in ms)
 constexpr uint32_t SpiTransferTimeout = 500;		// maximum allowed delay between data exchanges during a full transfer (in ms)
 constexpr uint32_t SpiMaxTransferTime = 50;			// maximum allowed time for a single SPI transfer
 constexpr uint32_t SpiConnectionTimeout = 4000;		// maximum time to wait for the next transfer (in ms)
+#if SAME70
+constexpr uint16_t SpiCodeBufferSize = 8192;		// number of bytes available for G-code caching
+#else
 constexpr uint16_t SpiCodeBufferSize = 4096;		// number of bytes available for G-code caching
+#endif
+constexpr uint16_t SpiCodeSegmentSize = 512;		// the code buffer is divided into segments of this size, each of which must be able to hold the longest code
+constexpr size_t NumSpiCodeSegments = SpiCodeBufferSize/SpiCodeSegmentSize;
+static_assert(SpiCodeSegmentSize >= MaxCodeBufferSize + sizeof(uint32_t) && SpiCodeSegmentSize % sizeof(uint32_t) == 0, "Bad SpiCodeSegmentSize");
+static_assert(NumSpiCodeSegments <= 127, "Too many code segments");
+constexpr uint32_t SbcFileChunkCacheSize = 4096;	// how much of a file we request from the SBC at a time when a CAN expansion board fetches its firmware
+static_assert(SbcFileChunkCacheSize + 256 <= SbcTransferBufferSize, "SbcFileChunkCacheSize too large for a transfer");
 
 // Shared structures
 enum class DataType : uint8_t
@@ -142,6 +161,11 @@ struct CodeBufferUpdateHeader
 	uint16_t padding;
 };
 
+struct TransferBufferSizeHeader
+{
+	uint32_t bufferSize;
+};
+
 struct DoCodeHeader
 {
 	uint8_t channel;
@@ -224,7 +248,8 @@ enum class FirmwareRequest : uint16_t
 	WriteFile = 21,						// Write to a file
 	SeekFile = 22,						// Seek in a file
 	TruncateFile = 23,					// Truncate a file
-	CloseFile = 24						// Close a file again
+	CloseFile = 24,						// Close a file again
+	TransferBufferSize = 25				// Response to a request to change the transfer buffer size (protocol version 7 and later)
 };
 
 struct PrintPausedHeader
@@ -267,8 +292,9 @@ enum class SbcRequest : uint16_t
 	FileWriteResult = 26,						// Result of a file write request
 	FileSeekResult = 27,						// Result of a file seek request
 	FileTruncateResult = 28,					// Result of a file truncate request
+	SetTransferBufferSize = 29,					// Request a different transfer buffer size (protocol version 7 and later)
 
-	InvalidRequest = 29
+	InvalidRequest = 30
 };
 
 struct BooleanHeader
@@ -23,6 +23,15 @@ public:
 		__attribute__((optimize("no-unroll-loops")));	// we already optimised the loops, and on the SAME5x unrolling them could make us feed data to the CRC unit too fast
 	void Reset(uint32_t initialValue = 0xFFFFFFFF) noexcept;
 	uint32_t Get() const noexcept;
+
+#if USE_SAME5x_HARDWARE_CRC
+	// Let a DMA channel use the CRC unit to compute the CRC of the data that it transfers. Update uses the software algorithm until FinishDmaCrc is called.
+	static void StartDmaCrc(unsigned int dmaChannel) noexcept;
+	static uint32_t FinishDmaCrc() noexcept;			// returns the CRC of the data that the DMA channel transferred, in the same form as Get()
+
+private:
+	static bool crcUnitUsedByDma;
+#endif
 };
 
 inline uint32_t CRC32::Get() const noexcept
@@ -0,0 +1,95 @@
+/*
+ * CaptureFileWriter.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "CaptureFileWriter.h"
+
+#if SUPPORT_ACCELEROMETERS || SUPPORT_CAN_EXPANSION
+
+#include <Platform/RepRap.h>
+#include <Platform/Platform.h>
+
+CaptureFileHeader::CaptureFileHeader(Source p_source, ValueType p_valueType, unsigned int p_numValues, uint32_t p_channels, unsigned int p_requestedRate,
+										unsigned int p_boardAddress, unsigned int p_resolution, uint32_t p_numSamplesRequested) noexcept
+	: magic(MagicValue), version(CurrentVersion), source(p_source), valueType(p_valueType), numValues((uint8_t)p_numValues), channels(p_channels),
+	  requestedRate((uint16_t)p_requestedRate), boardAddress((uint8_t)p_boardAddress), resolution((uint8_t)p_resolution), numSamplesRequested(p_numSamplesRequested),
+	  startTime((uint32_t)reprap.GetPlatform().GetDateTime())
+{
+	reserved[0] = reserved[1] = 0;
+}
+
+// Start a capture. The header goes into the buffer so that all the writes to the file except the last one are whole buffers.
+void CaptureFileWriter::Start(FileStore *p_f, const CaptureFileHeader& header) noexcept
+{
+	f = p_f;
+	bytesInBuffer = 0;
+	numRecords = 0;
+	numValues = header.numValues;
+	Put(&header, sizeof(header));
+}
+
+void CaptureFileWriter::AddRecord(uint32_t sampleNumber, const int16_t *values) noexcept
+{
+	Put(&sampleNumber, sizeof(sampleNumber));
+	Put(values, numValues * sizeof(int16_t));
+	++numRecords;
+}
+
+void CaptureFileWriter::AddRecord(uint32_t sampleNumber, const float *values) noexcept
+{
+	Put(&sampleNumber, sizeof(sampleNumber));
+	Put(values, numValues * sizeof(float));
+	++numRecords;
+}
+
+// Write the trailer and flush the buffer. The caller must close the file.
+void CaptureFileWriter::Finish(CaptureFileTrailer::Status status, unsigned int actualRate, unsigned int numOverflows, unsigned int resolution) noexcept
+{
+	if (f != nullptr)
+	{
+		CaptureFileTrailer trailer;
+		trailer.magic = CaptureFileTrailer::MagicValue;
+		trailer.numRecords = numRecords;
+		trailer.actualRate = (uint16_t)actualRate;
+		trailer.numOverflows = (uint16_t)min<unsigned int>(numOverflows, UINT16_MAX);
+		trailer.status = status;
+		trailer.resolution = (uint8_t)resolution;
+		trailer.reserved = 0;
+		Put(&trailer, sizeof(trailer));
+		Flush();
+		f = nullptr;
+	}
+}
+
+void CaptureFileWriter::Put(const void *data, size_t length) noexcept
+{
+	const uint8_t *src = (const uint8_t *)data;
+	while (length != 0)
+	{
+		const size_t bytesToCopy = min<size_t>(length, BufferSize - bytesInBuffer);
+		memcpy(buffer + bytesInBuffer, src, bytesToCopy);
+		bytesInBuffer += bytesToCopy;
+		src += bytesToCopy;
+		length -= bytesToCopy;
+		if (bytesInBuffer == BufferSize)
+		{
+			Flush();
+		}
+	}
+}
+
+void CaptureFileWriter::Flush() noexcept
+{
+	if (bytesInBuffer != 0 && f != nullptr)
+	{
+		(void)f->Write(buffer, bytesInBuffer);
+	}
+	bytesInBuffer = 0;
+}
+
+#endif
+
+// End
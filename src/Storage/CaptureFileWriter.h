@@ -0,0 +1,92 @@
+/*
+ * CaptureFileWriter.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  This class writes accelerometer and closed loop data captures in a compact binary format, as an alternative to CSV.
+ *  Data is accumulated in a buffer and written to the file in blocks of BufferSize bytes, so every write except the last is the same size
+ *  and starts at a file offset that is a multiple of that size. The file layout is described in Developer-documentation/CaptureFileFormat.md.
+ */
+
+#ifndef SRC_STORAGE_CAPTUREFILEWRITER_H_
+#define SRC_STORAGE_CAPTUREFILEWRITER_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_ACCELEROMETERS || SUPPORT_CAN_EXPANSION
+
+#include "FileStore.h"
+
+// The header at the start of the file
+struct __attribute__((packed)) CaptureFileHeader
+{
+	enum class Source : uint8_t { accelerometer = 0, closedLoop = 1 };
+	enum class ValueType : uint8_t { int16 = 0, float32 = 1 };
+
+	static constexpr uint32_t MagicValue = 0x42465252;		// "RRFB" when stored little-endian
+	static constexpr uint8_t CurrentVersion = 1;
+
+	uint32_t magic;
+	uint8_t version;
+	Source source;
+	ValueType valueType;
+	uint8_t numValues;										// the number of values in each record, not counting the sample number
+	uint32_t channels;										// accelerometer: bitmap of axes X=1, Y=2, Z=4; closed loop: the M569.5 D parameter
+	uint16_t requestedRate;									// the requested sampling rate, or 0 if the default was used
+	uint8_t boardAddress;
+	uint8_t resolution;										// accelerometer: the number of bits per value if known, else 0; closed loop: 0
+	uint32_t numSamplesRequested;
+	uint32_t startTime;										// seconds since 1970 UTC if the date and time are known, else 0
+	uint32_t reserved[2];
+
+	CaptureFileHeader(Source p_source, ValueType p_valueType, unsigned int p_numValues, uint32_t p_channels, unsigned int p_requestedRate,
+						unsigned int p_boardAddress, unsigned int p_resolution, uint32_t p_numSamplesRequested) noexcept;
+};
+
+static_assert(sizeof(CaptureFileHeader) == 32, "Header must be 32 bytes");
+
+// The trailer at the end of the file
+struct __attribute__((packed)) CaptureFileTrailer
+{
+	enum class Status : uint8_t { ok = 0, failedToStart, collectionFailed, badData, dataLost, overflowed, timedOut };
+
+	static constexpr uint32_t MagicValue = 0x45465252;		// "RRFE" when stored little-endian
+
+	uint32_t magic;
+	uint32_t numRecords;
+	uint16_t actualRate;									// the measured sampling rate, or 0 if not known
+	uint16_t numOverflows;
+	Status status;
+	uint8_t resolution;										// accelerometer: the number of bits per value if known, else 0; closed loop: 0
+	uint16_t reserved;
+};
+
+static_assert(sizeof(CaptureFileTrailer) == 16, "Trailer must be 16 bytes");
+
+class CaptureFileWriter
+{
+public:
+	static constexpr size_t BufferSize = 2048;
+
+	CaptureFileWriter() noexcept : f(nullptr), bytesInBuffer(0), numRecords(0), numValues(0) { }
+
+	void Start(FileStore *p_f, const CaptureFileHeader& header) noexcept;
+	void AddRecord(uint32_t sampleNumber, const int16_t *values) noexcept;
+	void AddRecord(uint32_t sampleNumber, const float *values) noexcept;
+	void Finish(CaptureFileTrailer::Status status, unsigned int actualRate, unsigned int numOverflows, unsigned int resolution) noexcept;
+
+private:
+	void Put(const void *data, size_t length) noexcept;
+	void Flush() noexcept;
+
+	FileStore *f;
+	size_t bytesInBuffer;
+	uint32_t numRecords;
+	uint8_t numValues;
+	alignas(4) uint8_t buffer[BufferSize];
+};
+
+#endif
+
+#endif /* SRC_STORAGE_CAPTUREFILEWRITER_H_ */
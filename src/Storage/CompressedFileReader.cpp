@@ -0,0 +1,219 @@
+/*
+ * CompressedFileReader.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "CompressedFileReader.h"
+
+#if SUPPORT_COMPRESSED_GCODE_FILES
+
+#include <Platform/RepRap.h>
+#include <Platform/Platform.h>
+
+// Check whether the file is compressed. If it is then create a reader for it, positioned at the start of the uncompressed data.
+// If it isn't then leave the file positioned at the start.
+/*static*/ CompressedFileReader::OpenResult CompressedFileReader::Create(FIL& file, CompressedFileReader *& reader) noexcept
+{
+	reader = nullptr;
+	CompressedFileHeader hdr;
+	UINT bytesRead;
+	if (f_size(&file) < sizeof(hdr) || f_read(&file, &hdr, sizeof(hdr), &bytesRead) != FR_OK || bytesRead != sizeof(hdr) || hdr.magic != CompressedFileHeader::MagicValue)
+	{
+		return (f_lseek(&file, 0) == FR_OK) ? OpenResult::notCompressed : OpenResult::badHeader;
+	}
+
+	if (   hdr.version != CompressedFileHeader::CurrentVersion
+		|| hdr.windowBits < 4 || hdr.windowBits > MaxCompressedWindowBits
+		|| hdr.lookaheadBits < 3 || hdr.lookaheadBits >= hdr.windowBits
+		|| hdr.blockSize == 0
+		|| hdr.numBlocks != (hdr.uncompressedSize + (hdr.blockSize - 1))/hdr.blockSize
+		|| hdr.indexOffset < sizeof(hdr)
+		|| (uint64_t)hdr.indexOffset + (uint64_t)hdr.numBlocks * sizeof(uint32_t) > f_size(&file)
+	   )
+	{
+		return OpenResult::badHeader;
+	}
+
+	reader = new CompressedFileReader(hdr);
+	if (reader == nullptr)
+	{
+		return OpenResult::noMemory;
+	}
+
+	if (!reader->Seek(file, 0))
+	{
+		delete reader;
+		reader = nullptr;
+		return OpenResult::badHeader;
+	}
+	return OpenResult::ok;
+}
+
+void CompressedFileReader::ResetDecoder() noexcept
+{
+	bitBuffer = 0;
+	bitCount = 0;
+	windowHead = 0;
+	backrefOffset = backrefBytesLeft = 0;
+	memset(window, 0, 1u << header.windowBits);
+}
+
+// Position the file at the start of the specified block and reset the decoder. The caller has already checked that the block number is valid.
+bool CompressedFileReader::StartBlock(FIL& file, uint32_t blockNumber) noexcept
+{
+	uint32_t blockOffset;
+	UINT bytesRead;
+	if (   f_lseek(&file, header.indexOffset + blockNumber * sizeof(uint32_t)) != FR_OK
+		|| f_read(&file, &blockOffset, sizeof(blockOffset), &bytesRead) != FR_OK
+		|| bytesRead != sizeof(blockOffset)
+		|| blockOffset < sizeof(header) || blockOffset >= header.indexOffset
+		|| f_lseek(&file, blockOffset) != FR_OK
+	   )
+	{
+		return false;
+	}
+
+	ResetDecoder();
+	inputIndex = inputBytes = 0;
+	currentBlock = blockNumber;
+	position = blockNumber * header.blockSize;
+	blockBytesLeft = min<uint32_t>(header.blockSize, header.uncompressedSize - position);
+	return true;
+}
+
+// Get the next numBits bits of compressed data, where numBits is between 1 and 24
+bool CompressedFileReader::GetBits(FIL& file, unsigned int numBits, uint32_t& val) noexcept
+{
+	while (bitCount < numBits)
+	{
+		if (inputIndex == inputBytes)
+		{
+			UINT bytesRead;
+			if (f_read(&file, input, sizeof(input), &bytesRead) != FR_OK || bytesRead == 0)
+			{
+				return false;
+			}
+			inputIndex = 0;
+			inputBytes = bytesRead;
+		}
+		bitBuffer |= (uint32_t)input[inputIndex++] << (24 - bitCount);
+		bitCount += 8;
+	}
+
+	val = bitBuffer >> (32 - numBits);
+	bitBuffer <<= numBits;
+	bitCount -= numBits;
+	return true;
+}
+
+// Read and decompress up to nBytes of data. Returns the number of bytes read or -1 if the read process failed.
+int CompressedFileReader::Read(FIL& file, char *_ecv_array buf, size_t nBytes) noexcept
+{
+	const uint32_t windowMask = (1u << header.windowBits) - 1;
+	size_t bytesDone = 0;
+	while (bytesDone < nBytes && position < header.uncompressedSize)
+	{
+		if (blockBytesLeft == 0)
+		{
+			// The next block follows on directly from this one, starting at the next byte boundary
+			bitBuffer <<= bitCount % 8;
+			bitCount -= bitCount % 8;
+			const uint32_t savedBitBuffer = bitBuffer;
+			const unsigned int savedBitCount = bitCount;
+			ResetDecoder();
+			bitBuffer = savedBitBuffer;
+			bitCount = savedBitCount;
+			++currentBlock;
+			blockBytesLeft = min<uint32_t>(header.blockSize, header.uncompressedSize - position);
+		}
+
+		uint8_t c;
+		if (backrefBytesLeft != 0)
+		{
+			c = window[(windowHead - backrefOffset) & windowMask];
+			--backrefBytesLeft;
+		}
+		else
+		{
+			uint32_t tag, val;
+			if (!GetBits(file, 1, tag))
+			{
+				break;
+			}
+			if (tag != 0)
+			{
+				if (!GetBits(file, 8, val))
+				{
+					break;
+				}
+				c = (uint8_t)val;
+			}
+			else
+			{
+				uint32_t count;
+				if (!GetBits(file, header.windowBits, val) || !GetBits(file, header.lookaheadBits, count))
+				{
+					break;
+				}
+				backrefOffset = val + 1;
+				c = window[(windowHead - backrefOffset) & windowMask];
+				backrefBytesLeft = count;						// the count is stored as the number of bytes minus one, and we have just used one of them
+			}
+		}
+
+		window[windowHead & windowMask] = c;
+		++windowHead;
+		buf[bytesDone++] = (char)c;
+		++position;
+		--blockBytesLeft;
+	}
+
+	if (bytesDone < nBytes && position < header.uncompressedSize)
+	{
+		reprap.GetPlatform().MessageF(ErrorMessage, "Compressed file is corrupt or could not be read\n");
+		return -1;
+	}
+	return (int)bytesDone;
+}
+
+// Seek to a position in the uncompressed data. A forward seek within the current block is done by decompressing and discarding the data in between.
+// Otherwise we decompress from the start of the block that contains the new position.
+bool CompressedFileReader::Seek(FIL& file, FilePosition pos) noexcept
+{
+	if (pos > header.uncompressedSize)
+	{
+		pos = header.uncompressedSize;
+	}
+
+	const uint32_t targetBlock = pos/header.blockSize;
+	if (targetBlock >= header.numBlocks)
+	{
+		// Seeking to the end of a file whose length is a multiple of the block size
+		position = header.uncompressedSize;
+		currentBlock = header.numBlocks;
+		blockBytesLeft = 0;
+		backrefBytesLeft = 0;
+		return true;
+	}
+
+	if ((targetBlock != currentBlock || pos < position) && !StartBlock(file, targetBlock))
+	{
+		return false;
+	}
+
+	while (position < pos)
+	{
+		char scratch[64];
+		if (Read(file, scratch, min<size_t>(sizeof(scratch), pos - position)) <= 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+#endif
+
+// End
@@ -0,0 +1,80 @@
+/*
+ * CompressedFileReader.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  This class decompresses a G-code file that was compressed with the heatshrink LZSS algorithm as it is read, so that FileStore can present the
+ *  uncompressed data to its callers. The file is divided into blocks that are compressed independently, so that we can seek to a position in the
+ *  uncompressed data by decompressing from the start of the block that contains it. The file layout is described in
+ *  Developer-documentation/CompressedGCodeFileFormat.md.
+ */
+
+#ifndef SRC_STORAGE_COMPRESSEDFILEREADER_H_
+#define SRC_STORAGE_COMPRESSEDFILEREADER_H_
+
+#include <RepRapFirmware.h>
+
+// The header at the start of the file. This is also used by compressed files in the embedded file system.
+struct CompressedFileHeader
+{
+	static constexpr uint32_t MagicValue = 0x5A465252;		// "RRFZ" when stored little-endian
+	static constexpr uint8_t CurrentVersion = 1;
+
+	uint32_t magic;
+	uint8_t version;
+	uint8_t windowBits;										// log2 of the size of the sliding window
+	uint8_t lookaheadBits;									// the number of bits used to store the length of a back reference
+	uint8_t reserved;
+	uint32_t uncompressedSize;
+	uint32_t blockSize;										// the number of bytes of uncompressed data in each block except the last
+	uint32_t indexOffset;									// the file offset of the block index
+	uint32_t numBlocks;
+};
+
+static_assert(sizeof(CompressedFileHeader) == 24, "Header must be 24 bytes");
+
+#if SUPPORT_COMPRESSED_GCODE_FILES
+
+#include "Libraries/Fatfs/ff.h"
+
+class CompressedFileReader
+{
+public:
+	enum class OpenResult : uint8_t { notCompressed, ok, badHeader, noMemory };
+
+	static OpenResult Create(FIL& file, CompressedFileReader *& reader) noexcept;
+
+	int Read(FIL& file, char *_ecv_array buf, size_t nBytes) noexcept;		// returns the number of bytes read or -1 if the read process failed
+	bool Seek(FIL& file, FilePosition pos) noexcept;
+	FilePosition Position() const noexcept { return position; }
+	FilePosition Length() const noexcept { return header.uncompressedSize; }
+
+private:
+	static constexpr size_t InputBufferSize = 512;
+	static constexpr uint32_t NoBlock = 0xFFFFFFFF;
+
+	explicit CompressedFileReader(const CompressedFileHeader& p_header) noexcept : header(p_header), position(0), currentBlock(NoBlock), blockBytesLeft(0) { }
+
+	bool StartBlock(FIL& file, uint32_t blockNumber) noexcept;
+	void ResetDecoder() noexcept;
+	bool GetBits(FIL& file, unsigned int numBits, uint32_t& val) noexcept;
+
+	CompressedFileHeader header;
+	FilePosition position;									// the position in the uncompressed data of the next byte we will return
+	uint32_t currentBlock;
+	uint32_t blockBytesLeft;								// how many more uncompressed bytes there are in the current block
+	uint32_t bitBuffer;										// bits not yet used, MSB-aligned
+	unsigned int bitCount;									// how many valid bits there are in bitBuffer
+	uint16_t windowHead;									// where the next byte will be written in the window
+	uint16_t backrefOffset;
+	uint16_t backrefBytesLeft;
+	uint16_t inputIndex;
+	uint16_t inputBytes;
+	uint8_t input[InputBufferSize];
+	uint8_t window[1u << MaxCompressedWindowBits];
+};
+
+#endif
+
+#endif /* SRC_STORAGE_COMPRESSEDFILEREADER_H_ */
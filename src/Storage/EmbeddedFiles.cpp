@@ -14,17 +14,23 @@
 #include <Platform/RepRap.h>
 #include <ObjectModel/ObjectModel.h>
 #include "FileStore.h"
+#include "CompressedFileReader.h"
 
 extern const uint32_t _firmware_end;
 
+// The layout of the embedded file system is described in Developer-documentation/EmbeddedFilesFormat.md
 struct EmbeddedFileDescriptor
 {
+	static constexpr uint32_t CompressedFlag = 0x80000000;	// in an indexed file system, this bit of contentLength is set if the content is compressed
+
 	uint32_t nameOffset;
 	uint32_t contentOffset;
-	uint32_t contentLength;
+	uint32_t contentLength;									// the number of bytes stored, plus CompressedFlag if the content is compressed
 
 	const char* GetName() const noexcept { return reinterpret_cast<const char*>(&_firmware_end) + nameOffset; }
 	const char* GetContent() const noexcept { return reinterpret_cast<const char*>(&_firmware_end) + contentOffset; }
+	uint32_t GetStoredLength() const noexcept;
+	bool IsCompressed() const noexcept;
 };
 
 struct EmbeddedFilesHeader
@@ -34,46 +40,340 @@ struct EmbeddedFilesHeader
 	uint32_t numFiles;
 	const EmbeddedFileDescriptor files[999];				// the array length is actually 'numFiles'
 
-	static constexpr uint32_t MagicValue = 0x543C2BEF;
+	static constexpr uint32_t MagicValue = 0x543C2BEF;		// files are in no particular order and are not compressed
+	static constexpr uint32_t MagicValueIndexed = 0x543C2BF0;	// files are sorted by name ignoring case, and may be compressed
+
+	bool IsValid() const noexcept { return magic == MagicValue || magic == MagicValueIndexed; }
+	bool IsIndexed() const noexcept { return magic == MagicValueIndexed; }
 	const char* GetDirectories() const noexcept { return reinterpret_cast<const char*>(&_firmware_end) + directoriesOffset; }
 };
 
 static const EmbeddedFilesHeader& fileSystem = *reinterpret_cast<const EmbeddedFilesHeader*>(&_firmware_end);
 
+inline uint32_t EmbeddedFileDescriptor::GetStoredLength() const noexcept
+{
+	return (fileSystem.IsIndexed()) ? contentLength & ~CompressedFlag : contentLength;
+}
+
+inline bool EmbeddedFileDescriptor::IsCompressed() const noexcept
+{
+	return fileSystem.IsIndexed() && (contentLength & CompressedFlag) != 0;
+}
+
 static const char *fileSearchDirectory;
 static uint32_t fileSearchNextNumber;
 
-// Skip any leading "0:" in a path. We don't worry about "1:", "2:" etc. because ":" is not a valid filename character, so the path won't match anything.
-static const char *SkipDriveNumber(const char *path) noexcept
+// Compare two paths ignoring case, returning <0, 0 or >0 like strcmp. The files in an indexed file system are sorted in this order.
+static int ComparePaths(const char *p, const char *q) noexcept
 {
-	return (path[0] == '0' && path[1] == ':') ? path + 2 : path;
+	for (;;)
+	{
+		const int c1 = tolower((unsigned char)*p++);
+		const int c2 = tolower((unsigned char)*q++);
+		if (c1 != c2 || c1 == 0)
+		{
+			return c1 - c2;
+		}
+	}
 }
 
-// Members of MassStorage that are replaced
-bool MassStorage::FileExists(const char *filePath) noexcept
+// Find the first file whose path compares greater than or equal to the specified one. Only used when the file system is indexed.
+static uint32_t LowerBound(const char *path) noexcept
+{
+	uint32_t low = 0, high = fileSystem.numFiles;
+	while (low < high)
+	{
+		const uint32_t mid = (low + high)/2;
+		if (ComparePaths(fileSystem.files[mid].GetName(), path) < 0)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	return low;
+}
+
+// Find a file, returning its index or -1 if not found. The drive number has already been skipped.
+static FileIndex FindFile(const char *filePath) noexcept
+{
+	if (fileSystem.IsIndexed())
+	{
+		const uint32_t fi = LowerBound(filePath);
+		return (fi < fileSystem.numFiles && ComparePaths(filePath, fileSystem.files[fi].GetName()) == 0) ? (FileIndex)fi : (FileIndex)-1;
+	}
+
+	for (FileIndex fi = 0; fi < (FileIndex)fileSystem.numFiles; ++fi)
+	{
+		if (StringEqualsIgnoreCase(filePath, fileSystem.files[fi].GetName()))
+		{
+			return fi;
+		}
+	}
+	return (FileIndex)-1;
+}
+
+// Return the uncompressed length of a file
+static FilePosition GetFileLength(const EmbeddedFileDescriptor& fd) noexcept
+{
+	if (fd.IsCompressed())
+	{
+		CompressedFileHeader hdr;
+		if (fd.GetStoredLength() < sizeof(hdr))
+		{
+			return 0;
+		}
+		memcpy(&hdr, fd.GetContent(), sizeof(hdr));			// the content may not be word-aligned
+		return hdr.uncompressedSize;
+	}
+	return fd.GetStoredLength();
+}
+
+// Class to decompress a compressed embedded file. The content is in the format described in Developer-documentation/CompressedGCodeFileFormat.md.
+// There is only one instance, which remembers the file and position that it has got to. Normally only one file is read at a time, so reading forward
+// continues where the last read left off. A read that doesn't follow on from the last one restarts from the beginning of the block that contains it.
+class EmbeddedFileDecoder
+{
+public:
+	EmbeddedFileDecoder() noexcept : window(nullptr), fileIndex(-1) { }
+
+	int Read(FileIndex fi, FilePosition pos, char *buf, size_t nBytes) noexcept;
+
+private:
+	bool Start(FileIndex fi) noexcept;
+	bool StartBlock(uint32_t blockNumber) noexcept;
+	void ResetDecoder() noexcept;
+	bool GetBits(unsigned int numBits, uint32_t& val) noexcept;
+	size_t Decompress(char *buf, size_t nBytes) noexcept;
+
+	CompressedFileHeader header;
+	const uint8_t *content;
+	const uint8_t *inputPtr;
+	const uint8_t *inputEnd;
+	uint8_t *window;										// allocated when we first read a compressed file
+	FileIndex fileIndex;									// the file we are positioned in, or -1 if none
+	FilePosition position;									// the position in the uncompressed data of the next byte we will return
+	uint32_t currentBlock;
+	uint32_t blockBytesLeft;
+	uint32_t bitBuffer;										// bits not yet used, MSB-aligned
+	unsigned int bitCount;
+	uint16_t windowHead;
+	uint16_t backrefOffset;
+	uint16_t backrefBytesLeft;
+};
+
+static EmbeddedFileDecoder decoder;
+
+// Check the header of a compressed file and get ready to decompress it
+bool EmbeddedFileDecoder::Start(FileIndex fi) noexcept
+{
+	fileIndex = -1;
+	const EmbeddedFileDescriptor& fd = fileSystem.files[fi];
+	const uint32_t storedLength = fd.GetStoredLength();
+	if (storedLength < sizeof(header))
+	{
+		return false;
+	}
+	content = reinterpret_cast<const uint8_t*>(fd.GetContent());
+	memcpy(&header, content, sizeof(header));
+	if (   header.magic != CompressedFileHeader::MagicValue
+		|| header.version != CompressedFileHeader::CurrentVersion
+		|| header.windowBits < 4 || header.windowBits > MaxCompressedWindowBits
+		|| header.lookaheadBits < 3 || header.lookaheadBits >= header.windowBits
+		|| header.blockSize == 0
+		|| header.numBlocks != (header.uncompressedSize + (header.blockSize - 1))/header.blockSize
+		|| header.indexOffset < sizeof(header)
+		|| (uint64_t)header.indexOffset + (uint64_t)header.numBlocks * sizeof(uint32_t) > storedLength
+	   )
+	{
+		return false;
+	}
+
+	if (window == nullptr)
+	{
+		window = new uint8_t[1u << MaxCompressedWindowBits];
+	}
+	fileIndex = fi;
+	currentBlock = header.numBlocks;						// force StartBlock to be called on the first read
+	position = header.uncompressedSize;
+	return true;
+}
+
+void EmbeddedFileDecoder::ResetDecoder() noexcept
+{
+	bitBuffer = 0;
+	bitCount = 0;
+	windowHead = 0;
+	backrefOffset = backrefBytesLeft = 0;
+	memset(window, 0, 1u << header.windowBits);
+}
+
+// Start decompressing the specified block. The caller has already checked that the block number is valid.
+bool EmbeddedFileDecoder::StartBlock(uint32_t blockNumber) noexcept
+{
+	uint32_t blockOffset;
+	memcpy(&blockOffset, content + header.indexOffset + blockNumber * sizeof(uint32_t), sizeof(blockOffset));
+	if (blockOffset < sizeof(header) || blockOffset >= header.indexOffset)
+	{
+		return false;
+	}
+
+	ResetDecoder();
+	inputPtr = content + blockOffset;
+	inputEnd = content + header.indexOffset;
+	currentBlock = blockNumber;
+	position = blockNumber * header.blockSize;
+	blockBytesLeft = min<uint32_t>(header.blockSize, header.uncompressedSize - position);
+	return true;
+}
+
+// Get the next numBits bits of compressed data, where numBits is between 1 and 24
+bool EmbeddedFileDecoder::GetBits(unsigned int numBits, uint32_t& val) noexcept
+{
+	while (bitCount < numBits)
+	{
+		if (inputPtr == inputEnd)
+		{
+			return false;
+		}
+		bitBuffer |= (uint32_t)*inputPtr++ << (24 - bitCount);
+		bitCount += 8;
+	}
+
+	val = bitBuffer >> (32 - numBits);
+	bitBuffer <<= numBits;
+	bitCount -= numBits;
+	return true;
+}
+
+// Decompress up to nBytes of data from the current position, returning the number of bytes decompressed.
+// This is the same algorithm as CompressedFileReader::Read except that the input comes from flash memory.
+size_t EmbeddedFileDecoder::Decompress(char *buf, size_t nBytes) noexcept
 {
-	if (fileSystem.magic == EmbeddedFilesHeader::MagicValue)
+	const uint32_t windowMask = (1u << header.windowBits) - 1;
+	size_t bytesDone = 0;
+	while (bytesDone < nBytes && position < header.uncompressedSize)
 	{
-		filePath = SkipDriveNumber(filePath);
-		uint32_t numFiles = fileSystem.numFiles;
-		const EmbeddedFileDescriptor *filePtr = fileSystem.files;
-		while (numFiles != 0)
+		if (blockBytesLeft == 0)
 		{
-			if (StringEqualsIgnoreCase(filePath, filePtr->GetName()))
+			// The next block follows on directly from this one, starting at the next byte boundary
+			bitBuffer <<= bitCount % 8;
+			bitCount -= bitCount % 8;
+			const uint32_t savedBitBuffer = bitBuffer;
+			const unsigned int savedBitCount = bitCount;
+			ResetDecoder();
+			bitBuffer = savedBitBuffer;
+			bitCount = savedBitCount;
+			++currentBlock;
+			blockBytesLeft = min<uint32_t>(header.blockSize, header.uncompressedSize - position);
+		}
+
+		uint8_t c;
+		if (backrefBytesLeft != 0)
+		{
+			c = window[(windowHead - backrefOffset) & windowMask];
+			--backrefBytesLeft;
+		}
+		else
+		{
+			uint32_t tag, val;
+			if (!GetBits(1, tag))
 			{
-				return true;
+				break;
+			}
+			if (tag != 0)
+			{
+				if (!GetBits(8, val))
+				{
+					break;
+				}
+				c = (uint8_t)val;
+			}
+			else
+			{
+				uint32_t count;
+				if (!GetBits(header.windowBits, val) || !GetBits(header.lookaheadBits, count))
+				{
+					break;
+				}
+				backrefOffset = val + 1;
+				c = window[(windowHead - backrefOffset) & windowMask];
+				backrefBytesLeft = count;
 			}
-			++filePtr;
-			--numFiles;
 		}
+
+		window[windowHead & windowMask] = c;
+		++windowHead;
+		buf[bytesDone++] = (char)c;
+		++position;
+		--blockBytesLeft;
 	}
-	return false;
+	return bytesDone;
+}
+
+// Read from a compressed file. Returns the number of bytes read, or -1 if the file is corrupt.
+int EmbeddedFileDecoder::Read(FileIndex fi, FilePosition pos, char *buf, size_t nBytes) noexcept
+{
+	if (fi != fileIndex && !Start(fi))
+	{
+		return -1;
+	}
+
+	if (pos >= header.uncompressedSize)
+	{
+		return 0;
+	}
+	if (nBytes > header.uncompressedSize - pos)
+	{
+		nBytes = header.uncompressedSize - pos;
+	}
+
+	// If we can't get to the requested position by decompressing forwards in the current block, restart from the start of the block that contains it
+	const uint32_t targetBlock = pos/header.blockSize;
+	if ((targetBlock != currentBlock || pos < position) && !StartBlock(targetBlock))
+	{
+		fileIndex = -1;
+		return -1;
+	}
+
+	while (position < pos)
+	{
+		char scratch[64];
+		if (Decompress(scratch, min<size_t>(sizeof(scratch), pos - position)) == 0)
+		{
+			fileIndex = -1;
+			return -1;
+		}
+	}
+
+	const size_t bytesDone = Decompress(buf, nBytes);
+	if (bytesDone < nBytes)
+	{
+		fileIndex = -1;
+		reprap.GetPlatform().MessageF(ErrorMessage, "Embedded file %s is corrupt\n", fileSystem.files[fi].GetName());
+		return -1;
+	}
+	return (int)bytesDone;
+}
+
+// Skip any leading "0:" in a path. We don't worry about "1:", "2:" etc. because ":" is not a valid filename character, so the path won't match anything.
+static const char *SkipDriveNumber(const char *path) noexcept
+{
+	return (path[0] == '0' && path[1] == ':') ? path + 2 : path;
+}
+
+// Members of MassStorage that are replaced
+bool MassStorage::FileExists(const char *filePath) noexcept
+{
+	return fileSystem.IsValid() && FindFile(SkipDriveNumber(filePath)) >= 0;
 }
 
 // Test whether a directory exists. Any trailing '/' has already been removed.
 bool EmbeddedFiles::DirectoryExists(const StringRef& dirPath) noexcept
 {
-	if (fileSystem.magic == EmbeddedFilesHeader::MagicValue)
+	if (fileSystem.IsValid())
 	{
 		const char * const path = SkipDriveNumber(dirPath.c_str());
 		if (path[0] == 0)
@@ -102,7 +402,16 @@ static bool FindNextFile(FileInfo& info) noexcept
 		const EmbeddedFileDescriptor& fd = fileSystem.files[fileSearchNextNumber];
 		++fileSearchNextNumber;								// don't look at the same file again, whether we find a match or not
 		const char *fname = fd.GetName();
-		if (StringStartsWithIgnoreCase(fname, fileSearchDirectory))
+		if (!StringStartsWithIgnoreCase(fname, fileSearchDirectory))
+		{
+			if (fileSystem.IsIndexed())
+			{
+				// The files are sorted, so all the files in the directory and its subdirectories are together and we have passed them
+				fileSearchNextNumber = fileSystem.numFiles;
+				break;
+			}
+		}
+		else
 		{
 			// The file path starts with the correct directory, but it could be in a subdirectory
 			const char *p = fname + strlen(fileSearchDirectory);
@@ -120,7 +429,7 @@ static bool FindNextFile(FileInfo& info) noexcept
 					info.fileName.copy(p);
 					info.isDirectory = false;
 					info.lastModified = 0;
-					info.size = fd.contentLength;
+					info.size = GetFileLength(fd);
 					return true;
 				}
 			}
@@ -132,7 +441,7 @@ static bool FindNextFile(FileInfo& info) noexcept
 // Find the first file. Any trailing "/" in the directory has been removed.
 bool EmbeddedFiles::FindFirst(const char *directory, FileInfo &info) noexcept
 {
-	if (fileSystem.magic == EmbeddedFilesHeader::MagicValue)
+	if (fileSystem.IsValid())
 	{
 		directory = SkipDriveNumber(directory);
 
@@ -160,7 +469,17 @@ bool EmbeddedFiles::FindFirst(const char *directory, FileInfo &info) noexcept
 		}
 
 		// fileSearchDirectory now points to the directory string - we need to save it for the FindNext call
-		fileSearchNextNumber = 0;
+		if (fileSystem.IsIndexed() && fileSearchDirectory[0] != 0)
+		{
+			// Start at the first file whose path begins with the directory name followed by '/'
+			String<MaxFilenameLength> prefix;
+			prefix.printf("%s/", fileSearchDirectory);
+			fileSearchNextNumber = LowerBound(prefix.c_str());
+		}
+		else
+		{
+			fileSearchNextNumber = 0;
+		}
 		return FindNextFile(info);
 	}
 	return false;
@@ -168,7 +487,7 @@ bool EmbeddedFiles::FindFirst(const char *directory, FileInfo &info) noexcept
 
 bool EmbeddedFiles::FindNext(FileInfo &info) noexcept
 {
-	if (fileSystem.magic == EmbeddedFilesHeader::MagicValue)
+	if (fileSystem.IsValid())
 	{
 		return FindNextFile(info);
 	}
@@ -179,24 +498,17 @@ bool EmbeddedFiles::FindNext(FileInfo &info) noexcept
 // Return the file size in bytes, or 0 if the file index is invalid
 FilePosition EmbeddedFiles::Length(int32_t fileIndex) noexcept
 {
-	return (fileSystem.magic == EmbeddedFilesHeader::MagicValue && fileIndex >= 0 && fileIndex < (int32_t)fileSystem.numFiles)
-			? fileSystem.files[fileIndex].contentLength
+	return (fileSystem.IsValid() && fileIndex >= 0 && fileIndex < (int32_t)fileSystem.numFiles)
+			? GetFileLength(fileSystem.files[fileIndex])
 				: 0;
 }
 
 // Open a file
 FileIndex EmbeddedFiles::OpenFile(const char *filePath) noexcept
 {
-	if (fileSystem.magic == EmbeddedFilesHeader::MagicValue)
+	if (fileSystem.IsValid())
 	{
-		filePath = SkipDriveNumber(filePath);
-		for (FileIndex fi = 0; fi < (FileIndex)fileSystem.numFiles; ++fi)
-		{
-			if (StringEqualsIgnoreCase(filePath, fileSystem.files[fi].GetName()))
-			{
-				return fi;
-			}
-		}
+		return FindFile(SkipDriveNumber(filePath));
 	}
 	return (FileIndex)-1;
 }
@@ -204,16 +516,22 @@ FileIndex EmbeddedFiles::OpenFile(const char *filePath) noexcept
 // Read from a file
 int EmbeddedFiles::Read(FileIndex fileIndex, FilePosition pos, char* extBuf, size_t nBytes) noexcept
 {
-	if (fileSystem.magic == EmbeddedFilesHeader::MagicValue && fileIndex >= 0 && fileIndex < (int32_t)fileSystem.numFiles)
+	if (fileSystem.IsValid() && fileIndex >= 0 && fileIndex < (int32_t)fileSystem.numFiles)
 	{
-		const FilePosition fileLength = fileSystem.files[fileIndex].contentLength;
+		const EmbeddedFileDescriptor& fd = fileSystem.files[fileIndex];
+		if (fd.IsCompressed())
+		{
+			return decoder.Read(fileIndex, pos, extBuf, nBytes);
+		}
+
+		const FilePosition fileLength = fd.GetStoredLength();
 		if (pos < fileLength)
 		{
 			if (nBytes > fileLength - pos)
 			{
 				nBytes = fileLength - pos;
 			}
-			memcpy(extBuf, fileSystem.files[fileIndex].GetContent() + pos, nBytes);
+			memcpy(extBuf, fd.GetContent() + pos, nBytes);
 			return nBytes;
 		}
 		return 0;
@@ -120,6 +120,12 @@ public:
 	{
 		return not_null(f)->Flush();
 	}
+
+	bool Truncate() noexcept
+	pre(IsLive())
+	{
+		return not_null(f)->Truncate();
+	}
 # endif
 
 	FilePosition GetPosition() const noexcept
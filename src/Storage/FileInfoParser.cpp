@@ -14,8 +14,29 @@
 
 #if HAS_MASS_STORAGE || HAS_EMBEDDED_FILES
 
+#if SUPPORT_FILE_INFO_INDEX
+
+// Each record in the file info index holds the information we parsed from one file. The record used for a file is determined by a hash of its path.
+// A record is only used if the hash, the file size and the last modified time all match.
+struct FileInfoIndexRecord
+{
+	static constexpr uint32_t MagicValue = 0x49465252;		// "RRFI" when stored little-endian
+	static constexpr uint16_t CurrentVersion = 1;				// increase this when the layout of GCodeFileInfo changes without changing its size
+
+	uint32_t magic;
+	uint16_t version;
+	uint16_t infoSize;											// sizeof(GCodeFileInfo) in the firmware that wrote the record
+	uint32_t pathHash;
+	GCodeFileInfo info;
+
+	static constexpr FilePosition Offset(uint32_t pathHash) noexcept { return (pathHash % FileInfoIndexEntries) * sizeof(FileInfoIndexRecord); }
+};
+
+#endif
+
 FileInfoParser::FileInfoParser() noexcept
-	: parseState(notParsing), fileBeingParsed(nullptr), accumulatedParseTime(0), accumulatedReadTime(0), accumulatedSeekTime(0), fileOverlapLength(0)
+	: parseState(notParsing), fileBeingParsed(nullptr), accumulatedParseTime(0), accumulatedReadTime(0), accumulatedSeekTime(0), fileOverlapLength(0),
+	  numQueuedRequests(0), lastSliceTime(0)
 {
 	parsedFileInfo.Init();
 	parserMutex.Create("FileInfoParser");
@@ -30,11 +51,18 @@ GCodeResult FileInfoParser::GetFileInfo(const char *filePath, GCodeFileInfo& inf
 		return GCodeResult::notFinished;
 	}
 
+	const uint32_t pathHash = HashPath(filePath);
 	if (parseState != notParsing && !StringEqualsIgnoreCase(filePath, filenameBeingParsed.c_str()))
 	{
 		// We are already parsing a different file
 		if (millis() - lastFileParseTime < MaxFileParseInterval)
 		{
+			(void)MustWaitInQueue(pathHash);
+			if (quitEarly)
+			{
+				RemoveFromQueue(pathHash);
+				return GetBasicFileInfo(filePath, info);	// the client can't wait any longer so give it what we can without parsing the file
+			}
 			return GCodeResult::notFinished;				// try again later
 		}
 
@@ -53,6 +81,18 @@ GCodeResult FileInfoParser::GetFileInfo(const char *filePath, GCodeFileInfo& inf
 			return GCodeResult::ok;
 		}
 
+		// If other clients asked for information about other files before this one, let them go first
+		if (MustWaitInQueue(pathHash))
+		{
+			if (quitEarly)
+			{
+				RemoveFromQueue(pathHash);
+				return GetBasicFileInfo(filePath, info);
+			}
+			return GCodeResult::notFinished;
+		}
+		RemoveFromQueue(pathHash);
+
 		fileBeingParsed = MassStorage::OpenFile(filePath, OpenMode::read, 0);
 		if (fileBeingParsed == nullptr)
 		{
@@ -61,6 +101,19 @@ GCodeResult FileInfoParser::GetFileInfo(const char *filePath, GCodeFileInfo& inf
 			return GCodeResult::error;
 		}
 
+#if HAS_MASS_STORAGE
+		(void)fileBeingParsed->EnableFastSeek();			// we seek backwards through the footer, which without a cluster map means following the FAT chain from the start every time
+#endif
+#if SUPPORT_COMPRESSED_GCODE_FILES
+		if (!fileBeingParsed->EnableDecompression())
+		{
+			fileBeingParsed->Close();
+			fileBeingParsed = nullptr;
+			info.isValid = false;
+			return GCodeResult::error;
+		}
+#endif
+
 		// File has been opened, let's start now
 		filenameBeingParsed.copy(filePath);
 		fileOverlapLength = 0;
@@ -99,13 +152,38 @@ GCodeResult FileInfoParser::GetFileInfo(const char *filePath, GCodeFileInfo& inf
 			info = parsedFileInfo;
 			return GCodeResult::ok;
 		}
+
+#if SUPPORT_FILE_INFO_INDEX
+		// If we parsed this file before and it hasn't changed since then, use the results we saved
+		if (LookupFileInfo(filePath))
+		{
+			fileBeingParsed->Close();
+			if (reprap.Debug(modulePrintMonitor))
+			{
+				reprap.GetPlatform().MessageF(UsbMessage, "File info found in index\n");
+			}
+			info = parsedFileInfo;
+			return GCodeResult::ok;
+		}
+#endif
 		parseState = parsingHeader;
 	}
 
 	// Getting file information take a few runs. Speed it up when we are not printing by calling it several times.
+	// When we are printing, read at most one chunk in each call and give way to reads from the print file.
 	const uint32_t loopStartTime = millis();
 	do
 	{
+		if (reprap.GetPrintMonitor().IsPrinting())
+		{
+			if (loopStartTime - lastSliceTime < FileInfoSliceIntervalWhilePrinting || reprap.GetGCodes().IsPrintFileInputLow())
+			{
+				lastFileParseTime = millis();
+				break;
+			}
+			lastSliceTime = loopStartTime;
+		}
+
 		size_t sizeToRead, sizeToScan;										// number of bytes we want to read and scan in this go
 
 		switch (parseState)
@@ -343,6 +421,9 @@ GCodeResult FileInfoParser::GetFileInfo(const char *filePath, GCodeFileInfo& inf
 						parsedFileInfo.numLayers = lrintf(parsedFileInfo.objectHeight / parsedFileInfo.layerHeight);
 					}
 					parsedFileInfo.incomplete = false;
+#if SUPPORT_FILE_INFO_INDEX
+					StoreFileInfo();
+#endif
 					info = parsedFileInfo;
 					return GCodeResult::ok;
 				}
@@ -374,6 +455,166 @@ GCodeResult FileInfoParser::GetFileInfo(const char *filePath, GCodeFileInfo& inf
 	return GCodeResult::notFinished;
 }
 
+// Return a case-insensitive FNV-1a hash of a file path
+/*static*/ uint32_t FileInfoParser::HashPath(const char *_ecv_array filePath) noexcept
+{
+	uint32_t hash = 2166136261u;
+	while (*filePath != 0)
+	{
+		hash = (hash ^ (uint8_t)tolower(*filePath++)) * 16777619u;
+	}
+	return hash;
+}
+
+// Add a request to the queue if it is not already there and record when it was made.
+// Return true if there are other requests ahead of it, or the queue is full so that we couldn't add it.
+bool FileInfoParser::MustWaitInQueue(uint32_t pathHash) noexcept
+{
+	// Remove requests that have not been repeated recently, because the clients have probably gone away
+	const uint32_t now = millis();
+	size_t numKept = 0;
+	for (size_t i = 0; i < numQueuedRequests; ++i)
+	{
+		if (now - queuedRequests[i].whenLastRequested < MaxFileParseInterval)
+		{
+			queuedRequests[numKept++] = queuedRequests[i];
+		}
+	}
+	numQueuedRequests = numKept;
+
+	for (size_t i = 0; i < numQueuedRequests; ++i)
+	{
+		if (queuedRequests[i].pathHash == pathHash)
+		{
+			queuedRequests[i].whenLastRequested = now;
+			return i != 0;
+		}
+	}
+
+	if (numQueuedRequests == MaxQueuedFileInfoRequests)
+	{
+		return true;
+	}
+	queuedRequests[numQueuedRequests].pathHash = pathHash;
+	queuedRequests[numQueuedRequests].whenLastRequested = now;
+	++numQueuedRequests;
+	return numQueuedRequests != 1;
+}
+
+void FileInfoParser::RemoveFromQueue(uint32_t pathHash) noexcept
+{
+	for (size_t i = 0; i < numQueuedRequests; ++i)
+	{
+		if (queuedRequests[i].pathHash == pathHash)
+		{
+			--numQueuedRequests;
+			memmove(&queuedRequests[i], &queuedRequests[i + 1], (numQueuedRequests - i) * sizeof(QueuedRequest));
+			break;
+		}
+	}
+}
+
+// Return the information about a file that we can get without parsing it, flagged as incomplete
+GCodeResult FileInfoParser::GetBasicFileInfo(const char *_ecv_array filePath, GCodeFileInfo& info) noexcept
+{
+	info.Init();
+	FileStore * const f = MassStorage::OpenFile(filePath, OpenMode::read, 0);
+	if (f == nullptr)
+	{
+		info.isValid = false;
+		return GCodeResult::error;
+	}
+
+#if SUPPORT_COMPRESSED_GCODE_FILES
+	info.isValid = f->EnableDecompression();
+#else
+	info.isValid = true;
+#endif
+	info.fileSize = f->Length();
+	f->Close();
+#if HAS_MASS_STORAGE
+	info.lastModifiedTime = MassStorage::GetLastModifiedTime(filePath);
+#endif
+	info.incomplete = true;
+	return (info.isValid) ? GCodeResult::ok : GCodeResult::error;
+}
+
+#if SUPPORT_FILE_INFO_INDEX
+
+// Look for the file in the index. If we find an up-to-date record then copy it to parsedFileInfo and return true.
+// The file size and last modified time must already have been set up in parsedFileInfo. We use 'buf' to hold the record, so this must not be called during parsing.
+bool FileInfoParser::LookupFileInfo(const char *_ecv_array filePath) noexcept
+{
+	FileStore * const f = reprap.GetPlatform().OpenSysFile(FILE_INFO_INDEX_FILE, OpenMode::read);
+	if (f == nullptr)
+	{
+		return false;
+	}
+
+	static_assert(sizeof(FileInfoIndexRecord) <= sizeof(buf));
+	const FileInfoIndexRecord& rec = *reinterpret_cast<const FileInfoIndexRecord *>(buf);
+	const uint32_t pathHash = HashPath(filePath);
+	const bool found = f->Seek(FileInfoIndexRecord::Offset(pathHash))
+						&& f->Read(buf, sizeof(FileInfoIndexRecord)) == (int)sizeof(FileInfoIndexRecord)
+						&& rec.magic == FileInfoIndexRecord::MagicValue
+						&& rec.version == FileInfoIndexRecord::CurrentVersion
+						&& rec.infoSize == sizeof(GCodeFileInfo)
+						&& rec.pathHash == pathHash
+						&& rec.info.isValid
+						&& rec.info.fileSize == parsedFileInfo.fileSize
+						&& rec.info.lastModifiedTime == parsedFileInfo.lastModifiedTime;
+	f->Close();
+	if (found)
+	{
+		parsedFileInfo = rec.info;
+		parsedFileInfo.incomplete = false;
+	}
+	return found;
+}
+
+// Save the information we have just parsed in the index, replacing any record for another file that has the same hash
+void FileInfoParser::StoreFileInfo() noexcept
+{
+	FileStore * const f = reprap.GetPlatform().OpenSysFile(FILE_INFO_INDEX_FILE, OpenMode::append);
+	if (f == nullptr)
+	{
+		return;
+	}
+
+	FileInfoIndexRecord& rec = *reinterpret_cast<FileInfoIndexRecord *>(buf);
+	rec.magic = FileInfoIndexRecord::MagicValue;
+	rec.version = FileInfoIndexRecord::CurrentVersion;
+	rec.infoSize = sizeof(GCodeFileInfo);
+	rec.pathHash = HashPath(filenameBeingParsed.c_str());
+	rec.info = parsedFileInfo;
+	const bool ok = f->Seek(FileInfoIndexRecord::Offset(rec.pathHash)) && f->Write(buf, sizeof(FileInfoIndexRecord));
+	if (!f->Close() || !ok)
+	{
+		if (reprap.Debug(modulePrintMonitor))
+		{
+			reprap.GetPlatform().MessageF(UsbMessage, "Failed to update file info index\n");
+		}
+	}
+}
+
+// Remove the record for a file from the index. We don't check that the record belongs to this file; at worst we remove the record for another file.
+void FileInfoParser::ForgetFileInfo(const char *_ecv_array filePath) noexcept
+{
+	MutexLocker lock(parserMutex);
+	FileStore * const f = reprap.GetPlatform().OpenSysFile(FILE_INFO_INDEX_FILE, OpenMode::append);
+	if (f != nullptr)
+	{
+		const uint32_t zero = 0;
+		if (f->Seek(FileInfoIndexRecord::Offset(HashPath(filePath))))
+		{
+			(void)f->Write(reinterpret_cast<const char *>(&zero), sizeof(zero));
+		}
+		f->Close();
+	}
+}
+
+#endif
+
 // Scan the buffer for a G1 Zxxx command. The buffer is null-terminated.
 // This parsing algorithm needs to be fast. The old one sometimes took 5 seconds or more to parse about 120K of data.
 // To speed up parsing, we now parse forwards from the start of the buffer. This means we can't stop when we have found a G1 Z command,
@@ -31,6 +31,13 @@ const size_t GCODE_OVERLAP_SIZE = 100;				// Size of the overlapping buffer for
 const uint32_t MAX_FILEINFO_PROCESS_TIME = 200;		// Maximum time to spend polling for file info in each call
 const uint32_t MaxFileParseInterval = 4000;			// Maximum interval between repeat requests to parse a file
 
+const size_t MaxQueuedFileInfoRequests = 4;			// Maximum number of clients that can be waiting for us to parse a file while we parse another one
+const uint32_t FileInfoSliceIntervalWhilePrinting = 20;	// Minimum interval in milliseconds between reading chunks of a file to parse it while printing
+
+#if SUPPORT_FILE_INFO_INDEX
+const size_t FileInfoIndexEntries = 256;			// How many records there are in the file info index. The index file uses about 300 bytes of SD card space per record but no RAM.
+#endif
+
 enum FileParseState
 {
 	notParsing,
@@ -47,6 +54,10 @@ public:
 	// The following method needs to be called repeatedly until it doesn't return GCodeResult::notFinished - this may take a few runs
 	GCodeResult GetFileInfo(const char *filePath, GCodeFileInfo& info, bool quitEarly) noexcept;
 
+#if SUPPORT_FILE_INFO_INDEX
+	void ForgetFileInfo(const char *_ecv_array filePath) noexcept;	// Remove a file from the index because it has been changed without changing its size and date
+#endif
+
 	static constexpr const char *_ecv_array SimulatedTimeString = "\n; Simulated print time";	// used by FileInfoParser and MassStorage
 
 private:
@@ -62,6 +73,18 @@ private:
 	void FindFilamentUsedEmbedded(const char *_ecv_array p, const char *_ecv_array s1, const char *_ecv_array s2, unsigned int &filamentsFound) noexcept;
 	bool FindThumbnails(const char *_ecv_array bufp, FilePosition bufferStartFilePosition) noexcept;
 
+	// Request queue methods
+	static uint32_t HashPath(const char *_ecv_array filePath) noexcept;
+	bool MustWaitInQueue(uint32_t pathHash) noexcept;
+	void RemoveFromQueue(uint32_t pathHash) noexcept;
+	GCodeResult GetBasicFileInfo(const char *_ecv_array filePath, GCodeFileInfo& info) noexcept;
+
+#if SUPPORT_FILE_INFO_INDEX
+	// File info index methods
+	bool LookupFileInfo(const char *_ecv_array filePath) noexcept;
+	void StoreFileInfo() noexcept;
+#endif
+
 	// We parse G-Code files in multiple stages. These variables hold the required information
 	Mutex parserMutex;
 
@@ -74,6 +97,16 @@ private:
 	uint32_t accumulatedParseTime, accumulatedReadTime, accumulatedSeekTime;
 	size_t fileOverlapLength;
 
+	// Requests for other files that arrived while we were busy, in the order that they arrived
+	struct QueuedRequest
+	{
+		uint32_t pathHash;
+		uint32_t whenLastRequested;
+	};
+	QueuedRequest queuedRequests[MaxQueuedFileInfoRequests];
+	size_t numQueuedRequests;
+	uint32_t lastSliceTime;
+
 	// We used to allocate the following buffer on the stack; but now that this is called by more than one task
 	// it is more economical to allocate it permanently because that lets us use smaller stacks.
 	// Alternatively, we could allocate a FileBuffer temporarily.
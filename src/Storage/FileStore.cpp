@@ -16,15 +16,30 @@
 #if HAS_MASS_STORAGE
 # include <Libraries/Fatfs/diskio.h>
 # include <Movement/StepTimer.h>
+# include <Platform/Tasks.h>
+# include <Platform/EventTrace.h>
+#endif
+
+#if SUPPORT_COMPRESSED_GCODE_FILES
+# include "CompressedFileReader.h"
+#endif
+
+#if SUPPORT_MACRO_CACHE
+# include "MacroCache.h"
 #endif
 
 #if HAS_SBC_INTERFACE
 # include <SBC/SbcInterface.h>
 #endif
 
+#if HAS_MASS_STORAGE
+uint32_t FileStore::bytesWrittenToCard = 0;
+uint64_t FileStore::cardWriteTicks = 0;
+#endif
+
 FileStore::FileStore() noexcept
 #if HAS_MASS_STORAGE || HAS_SBC_INTERFACE
-	: writeBuffer(nullptr)
+	: writeBuffer(nullptr), writeBufferWaitSeq(0)
 #endif
 {
 	Init();
@@ -47,6 +62,23 @@ void FileStore::Init() noexcept
 #if HAS_EMBEDDED_FILES || HAS_SBC_INTERFACE
 	offset = 0;
 #endif
+#if HAS_MASS_STORAGE
+	clusterMap = nullptr;
+#endif
+#if SUPPORT_COMPRESSED_GCODE_FILES
+	decompressor = nullptr;
+#endif
+#if SUPPORT_MACRO_CACHE
+	cacheSlot = -1;
+#endif
+}
+
+void FileStore::Reserve() noexcept
+{
+	usageMode = FileUseMode::reserved;
+#if HAS_MASS_STORAGE
+	file.obj.fs = nullptr;				// so that IsSameFile, IsOpenOn and Invalidate don't match the file that was last open in this object
+#endif
 }
 
 // Open a local file (for example on an SD card).
@@ -83,6 +115,7 @@ bool FileStore::Open(const char *_ecv_array filePath, OpenMode mode, uint32_t pr
 
 #if HAS_MASS_STORAGE || HAS_SBC_INTERFACE
 	writeBuffer = nullptr;
+	writeBufferWaitSeq = 0;
 
 	// Try to allocate a write buffer
 	if (writing)
@@ -158,7 +191,11 @@ bool FileStore::Open(const char *_ecv_array filePath, OpenMode mode, uint32_t pr
 		return false;
 	}
 
-	// File open, carry on
+	// File open, carry on. If we wanted a write buffer but didn't get one, wait for one.
+	if (writeBuffer == nullptr && (mode == OpenMode::write || mode == OpenMode::writeWithCrc))
+	{
+		writeBufferWaitSeq = MassStorage::QueueForWriteBuffer();
+	}
 	crc.Reset();
 	calcCrc = (mode == OpenMode::writeWithCrc);
 	usageMode = (writing) ? FileUseMode::readWrite : FileUseMode::readOnly;
@@ -257,6 +294,19 @@ bool FileStore::Seek(FilePosition pos) noexcept
 		}
 #endif
 #if HAS_MASS_STORAGE
+# if SUPPORT_MACRO_CACHE
+		if (cacheSlot >= 0)
+		{
+			cacheOffset = min<FilePosition>(pos, MacroCache::Length(cacheSlot));
+			return true;
+		}
+# endif
+# if SUPPORT_COMPRESSED_GCODE_FILES
+		if (decompressor != nullptr)
+		{
+			return decompressor->Seek(file, pos);
+		}
+# endif
 		return f_lseek(&file, pos) == FR_OK;
 #elif HAS_EMBEDDED_FILES
 		offset = min<FilePosition>(pos, EmbeddedFiles::Length(fileIndex));
@@ -280,6 +330,18 @@ FilePosition FileStore::Position() const noexcept
 	}
 #endif
 #if HAS_MASS_STORAGE
+# if SUPPORT_MACRO_CACHE
+	if (cacheSlot >= 0 && usageMode == FileUseMode::readOnly)
+	{
+		return cacheOffset;
+	}
+# endif
+# if SUPPORT_COMPRESSED_GCODE_FILES
+	if (decompressor != nullptr && usageMode == FileUseMode::readOnly)
+	{
+		return decompressor->Position();
+	}
+# endif
 	return (usageMode == FileUseMode::readOnly || usageMode == FileUseMode::readWrite) ? file.fptr : 0;
 #elif HAS_EMBEDDED_FILES
 	return offset;
@@ -304,6 +366,18 @@ FilePosition FileStore::Length() const noexcept
 		}
 #endif
 #if HAS_MASS_STORAGE
+# if SUPPORT_MACRO_CACHE
+		if (cacheSlot >= 0)
+		{
+			return MacroCache::Length(cacheSlot);
+		}
+# endif
+# if SUPPORT_COMPRESSED_GCODE_FILES
+		if (decompressor != nullptr)
+		{
+			return decompressor->Length();
+		}
+# endif
 		return f_size(&file);
 #elif HAS_EMBEDDED_FILES
 		return EmbeddedFiles::Length(fileIndex);
@@ -315,11 +389,11 @@ FilePosition FileStore::Length() const noexcept
 #if HAS_SBC_INTERFACE
 		if (reprap.UsingSbcInterface())
 		{
-			return (writeBuffer != nullptr) ? length + writeBuffer->BytesStored() : length;
+			return (writeBuffer != nullptr) ? length + writeBuffer->ChainBytesStored() : length;
 		}
 #endif
 #if HAS_MASS_STORAGE
-		return (writeBuffer != nullptr) ? f_size(&file) + writeBuffer->BytesStored() : f_size(&file);
+		return (writeBuffer != nullptr) ? f_size(&file) + writeBuffer->ChainBytesStored() : f_size(&file);
 #else
 		return 0;
 #endif
@@ -396,8 +470,26 @@ int FileStore::Read(char *_ecv_array extBuf, size_t nBytes) noexcept
 #endif
 #if HAS_MASS_STORAGE
 		{
+# if SUPPORT_MACRO_CACHE
+			if (cacheSlot >= 0)
+			{
+				return MacroCache::Read(cacheSlot, cacheOffset, extBuf, nBytes);
+			}
+# endif
+# if SUPPORT_COMPRESSED_GCODE_FILES
+			if (decompressor != nullptr)
+			{
+				return decompressor->Read(file, extBuf, nBytes);
+			}
+# endif
 			UINT bytes_read;
+# if SUPPORT_EVENT_TRACE
+			const uint32_t startTicks = StepTimer::GetTimerTicks();
+# endif
 			const FRESULT readStatus = f_read(&file, extBuf, nBytes, &bytes_read);
+# if SUPPORT_EVENT_TRACE
+			EventTrace::Record(EventTrace::EventId::fileRead, StepTimer::GetTimerTicks() - startTicks, bytes_read);
+# endif
 			if (readStatus != FR_OK)
 			{
 				reprap.GetPlatform().MessageF(ErrorMessage, "Cannot read file, error code %d\n", (int)readStatus);
@@ -468,6 +560,7 @@ bool FileStore::ForceClose() noexcept
 		ok = Flush();
 	}
 
+	writeBufferWaitSeq = 0;
 	if (writeBuffer != nullptr)
 	{
 		MassStorage::ReleaseWriteBuffer(writeBuffer);
@@ -487,7 +580,28 @@ bool FileStore::ForceClose() noexcept
 #endif
 
 #if HAS_MASS_STORAGE
+# if SUPPORT_MACRO_CACHE
+	if (cacheSlot >= 0)
+	{
+		MacroCache::Release(cacheSlot);
+		cacheSlot = -1;
+		usageMode = FileUseMode::free;
+		closeRequested = false;
+		openCount = 0;
+		return ok;
+	}
+# endif
+# if SUPPORT_COMPRESSED_GCODE_FILES
+	delete decompressor;
+	decompressor = nullptr;
+# endif
+	if (usageMode == FileUseMode::readWrite)
+	{
+		MassStorage::FileContentsChanged(file.obj.fs);		// the size and date of the file have probably changed
+	}
 	const FRESULT fr = f_close(&file);
+	delete[] clusterMap;
+	clusterMap = nullptr;
 	usageMode = FileUseMode::free;
 	closeRequested = false;
 	openCount = 0;
@@ -554,7 +668,10 @@ bool FileStore::Store(const char *_ecv_array s, size_t len, size_t *bytesWritten
 #endif
 
 #if HAS_MASS_STORAGE
+	const uint32_t startTicks = StepTimer::GetTimerTicks();
 	const FRESULT writeStatus = f_write(&file, s, len, bytesWritten);
+	cardWriteTicks += StepTimer::GetTimerTicks() - startTicks;
+	bytesWrittenToCard += *bytesWritten;
 	if (writeStatus != FR_OK)
 	{
 		reprap.GetPlatform().MessageF(ErrorMessage, "Failed to write to file, error code %d. Card may be full.\n", (int)writeStatus);
@@ -567,6 +684,80 @@ bool FileStore::Store(const char *_ecv_array s, size_t len, size_t *bytesWritten
 #endif
 }
 
+FileWriteBuffer *FileStore::GetWriteBuffer() const noexcept
+{
+	return (writeBuffer != nullptr) ? writeBuffer->Tail() : nullptr;
+}
+
+// When the last buffer in the chain is full, try to add another one so that we can write both to the card in a single multi-block transfer.
+// We only do this when the new buffer follows on directly in memory from the full one, otherwise there is no advantage in waiting.
+// Return true if we added a buffer.
+bool FileStore::ChainWriteBuffer(FileWriteBuffer *tail) noexcept
+{
+#if HAS_SBC_INTERFACE
+	if (reprap.UsingSbcInterface())
+	{
+		return false;
+	}
+#endif
+
+	FileWriteBuffer * const extra = MassStorage::AllocateWriteBuffer();
+	if (extra != nullptr)
+	{
+		if (extra->Data() == tail->Data() + tail->BytesStored())
+		{
+			tail->SetNext(extra);
+			return true;
+		}
+		MassStorage::ReleaseWriteBuffer(extra);
+	}
+	return false;
+}
+
+// Write the data in the write buffer chain to storage. Adjacent buffers are written in one call so that the card receives longer multi-block writes.
+// Any buffers chained to the first one are released. Return true if all the data was written.
+bool FileStore::FlushWriteBuffers() noexcept
+{
+	bool ok = true;
+	for (FileWriteBuffer *wb = writeBuffer; wb != nullptr && ok; )
+	{
+		const char *_ecv_array const start = wb->Data();
+		size_t bytesToWrite = wb->BytesStored();
+		while (wb->Next() != nullptr && wb->Data() + wb->BytesStored() == wb->Next()->Data())
+		{
+			wb = wb->Next();
+			bytesToWrite += wb->BytesStored();
+		}
+
+		if (bytesToWrite != 0)
+		{
+			size_t bytesWritten;
+			ok = Store(start, bytesToWrite, &bytesWritten) && bytesWritten == bytesToWrite;
+		}
+		wb = wb->Next();
+	}
+
+	if (writeBuffer->Next() != nullptr)
+	{
+		MassStorage::ReleaseWriteBuffer(writeBuffer->Next());
+		writeBuffer->SetNext(nullptr);
+	}
+	writeBuffer->DataTaken();
+	return ok;
+}
+
+// Called after we have flushed our write buffer. If another file is waiting for a write buffer, give ours up and wait for another one.
+// This shares the buffers fairly between files that are being written at the same time, such as concurrent uploads.
+void FileStore::YieldWriteBuffer() noexcept
+{
+	if (MassStorage::AnyFileWaitingForWriteBuffer())
+	{
+		MassStorage::ReleaseWriteBuffer(writeBuffer);
+		writeBuffer = nullptr;
+		writeBufferWaitSeq = MassStorage::QueueForWriteBuffer();
+	}
+}
+
 bool FileStore::Write(char b) noexcept
 {
 	return Write(&b, sizeof(char));
@@ -588,33 +779,45 @@ bool FileStore::Write(const char *_ecv_array s, size_t len) noexcept
 	case FileUseMode::readOnly:
 	case FileUseMode::readWrite:
 		{
-			size_t totalBytesWritten = 0;
-			bool writeOk = true;
-			if (writeBuffer == nullptr)
+			// If we are waiting for a write buffer, see if it is our turn to have one
+			if (writeBuffer == nullptr && writeBufferWaitSeq != 0)
 			{
-				writeOk = Store(s, len, &totalBytesWritten);
+				writeBuffer = MassStorage::AllocateWriteBuffer(writeBufferWaitSeq);
+				if (writeBuffer != nullptr)
+				{
+					writeBufferWaitSeq = 0;
+				}
 			}
-			else
+
+			size_t totalBytesWritten = 0;
+			bool writeOk = true;
+			if (writeBuffer != nullptr)
 			{
 				do
 				{
-					const size_t bytesStored = writeBuffer->Store(s + totalBytesWritten, len - totalBytesWritten);
-					if (writeBuffer->BytesLeft() == 0)
+					FileWriteBuffer * const tail = writeBuffer->Tail();
+					const size_t bytesStored = tail->Store(s + totalBytesWritten, len - totalBytesWritten);
+					if (tail->BytesLeft() == 0 && !ChainWriteBuffer(tail))
 					{
-						const size_t bytesToWrite = writeBuffer->BytesStored();
-						size_t bytesWritten;
-						writeOk = Store(writeBuffer->Data(), bytesToWrite, &bytesWritten);
-						writeBuffer->DataTaken();
-
-						if (bytesToWrite != bytesWritten)
+						writeOk = FlushWriteBuffers();
+						if (!writeOk)
 						{
 							// Something went wrong
 							break;
 						}
+						YieldWriteBuffer();
 					}
 					totalBytesWritten += bytesStored;
 				}
-				while (writeOk && totalBytesWritten != len);
+				while (writeOk && totalBytesWritten != len && writeBuffer != nullptr);
+			}
+
+			// If we have no write buffer or we have just given it up, write the rest directly
+			if (writeBuffer == nullptr && writeOk && totalBytesWritten != len)
+			{
+				size_t bytesWritten;
+				writeOk = Store(s + totalBytesWritten, len - totalBytesWritten, &bytesWritten);
+				totalBytesWritten += bytesWritten;
 			}
 
 			if (totalBytesWritten != len)
@@ -642,21 +845,14 @@ bool FileStore::Flush() noexcept
 		return true;
 
 	case FileUseMode::readWrite:
-		if (writeBuffer != nullptr)
+		if (writeBuffer != nullptr && writeBuffer->ChainBytesStored() != 0)
 		{
-			const size_t bytesToWrite = writeBuffer->BytesStored();
-			if (bytesToWrite != 0)
+			const bool writeOk = FlushWriteBuffers();
+			if (!writeOk)
 			{
-				size_t bytesWritten;
-				bool writeOk = Store(writeBuffer->Data(), bytesToWrite, &bytesWritten);
-				writeBuffer->DataTaken();
-
-				if (writeOk && (bytesToWrite != bytesWritten))
-				{
-					reprap.GetPlatform().MessageF(ErrorMessage, "Failed to flush data to file. Card may be full.\n");
-				}
-				return writeOk && (bytesToWrite == bytesWritten);
+				reprap.GetPlatform().MessageF(ErrorMessage, "Failed to flush data to file. Card may be full.\n");
 			}
+			return writeOk;
 		}
 #if HAS_SBC_INTERFACE
 		if (reprap.UsingSbcInterface())
@@ -665,6 +861,7 @@ bool FileStore::Flush() noexcept
 		}
 #endif
 #if HAS_MASS_STORAGE
+		MassStorage::FileContentsChanged(file.obj.fs);
 		return f_sync(&file) == FR_OK;
 #endif
 
@@ -679,6 +876,7 @@ bool FileStore::Flush() noexcept
 // Invalidate the file
 void FileStore::Invalidate() noexcept
 {
+	writeBufferWaitSeq = 0;
 	if (writeBuffer != nullptr)
 	{
 		MassStorage::ReleaseWriteBuffer(writeBuffer);
@@ -705,11 +903,18 @@ bool FileStore::Invalidate(const FATFS *fs, bool doClose) noexcept
 		else
 		{
 			file.obj.fs = nullptr;
+			writeBufferWaitSeq = 0;
 			if (writeBuffer != nullptr)
 			{
 				MassStorage::ReleaseWriteBuffer(writeBuffer);
 				writeBuffer = nullptr;
 			}
+# if SUPPORT_COMPRESSED_GCODE_FILES
+			delete decompressor;
+			decompressor = nullptr;
+# endif
+			delete[] clusterMap;
+			clusterMap = nullptr;
 		}
 		usageMode = FileUseMode::invalidated;
 		return true;
@@ -726,48 +931,135 @@ bool FileStore::IsOpenOn(const FATFS *fs) const noexcept
 // Return true if the passed file is the same as ours
 bool FileStore::IsSameFile(const FIL& otherFile) const noexcept
 {
-	return file.obj.fs == otherFile.obj.fs && file.dir_sect == otherFile.dir_sect && file.dir_ptr == otherFile.dir_ptr;
+	return usageMode != FileUseMode::free && file.obj.fs == otherFile.obj.fs && file.dir_sect == otherFile.dir_sect && file.dir_ptr == otherFile.dir_ptr;
 }
 
-uint32_t FileStore::ClusterSize() const noexcept
+#if SUPPORT_COMPRESSED_GCODE_FILES
+
+// If the file is compressed then arrange for it to be decompressed as it is read, so that Read, Seek, Position and Length refer to the uncompressed data.
+// A file that is not compressed is left positioned at the start. Return false if the file is compressed but we can't read it.
+bool FileStore::EnableDecompression() noexcept
 {
-	return (usageMode == FileUseMode::readOnly || usageMode == FileUseMode::readWrite) ? file.obj.fs->csize * 512u : 1;	// we divide by the cluster size so return 1 not 0 if there is an error
-}
+# if HAS_SBC_INTERFACE
+	if (reprap.UsingSbcInterface())
+	{
+		return true;
+	}
+# endif
+	if (usageMode != FileUseMode::readOnly || decompressor != nullptr)
+	{
+		return usageMode == FileUseMode::readOnly;
+	}
 
-#endif	// HAS_MASS_STORAGE
+	switch (CompressedFileReader::Create(file, decompressor))
+	{
+	case CompressedFileReader::OpenResult::notCompressed:
+	case CompressedFileReader::OpenResult::ok:
+		return true;
 
-#if 0	// these are not currently used
+	case CompressedFileReader::OpenResult::noMemory:
+		reprap.GetPlatform().Message(ErrorMessage, "Not enough memory to decompress file\n");
+		return false;
 
-bool FileStore::GoToEnd()
-{
-	return Seek(Length());
+	case CompressedFileReader::OpenResult::badHeader:
+	default:
+		reprap.GetPlatform().Message(ErrorMessage, "Compressed file has an invalid header or unsupported parameters\n");
+		return false;
+	}
 }
 
-// Provide a cluster map for fast seeking. Needs _USE_FASTSEEK defined as 1 in conf_fatfs to make any difference.
-// The first element of the table must be set to the total number of 32-bit entries in the table before calling this.
-bool FileStore::SetClusterMap(uint32_t tbl[]) noexcept
+#endif
+
+// Try to build a cluster map for a file that is open for reading only, so that seeks and reads use the map instead of following the cluster chain in the FAT.
+// The map needs 2 words for each contiguous fragment of the file plus 2 more. We first try a map big enough for a few fragments, which is sufficient for files
+// that were uploaded with pre-allocation. If that is not big enough then FatFS tells us the size needed, and we allocate that if it is within our limits.
+// Return true if successful. If we return false then the file is still usable but seeks are slower.
+bool FileStore::EnableFastSeek() noexcept
 {
-	switch (usageMode)
+# if HAS_SBC_INTERFACE
+	if (reprap.UsingSbcInterface())
 	{
-	case FileUseMode::free:
-		INTERNAL_ERROR;
 		return false;
+	}
+# endif
+	if (usageMode != FileUseMode::readOnly || clusterMap != nullptr)
+	{
+		return clusterMap != nullptr;
+	}
 
-	case FileUseMode::readOnly:
-	case FileUseMode::readWrite:
+	constexpr size_t InitialClusterMapWords = 10;
+	size_t numWords = InitialClusterMapWords;
+	for (;;)
+	{
+		clusterMap = new DWORD[numWords];
+		clusterMap[0] = numWords;
+		file.cltbl = clusterMap;
+		const FRESULT ret = f_lseek(&file, CREATE_LINKMAP);
+		if (ret == FR_OK)
 		{
-			file.cltbl = tbl;
-			const FRESULT ret = f_lseek(&file, CREATE_LINKMAP);
-//			debugPrintf("ret %d need %u\n", (int)ret, tbl[0]);
-			return ret == FR_OK;
+			return true;
 		}
 
-	case FileUseMode::invalidated:
-	default:
-		return false;
+		const size_t numWordsNeeded = clusterMap[0];
+		file.cltbl = nullptr;
+		delete[] clusterMap;
+		clusterMap = nullptr;
+		if (   ret != FR_NOT_ENOUGH_CORE || numWordsNeeded <= numWords || numWordsNeeded > MaxClusterMapWords
+			|| Tasks::GetNeverUsedRam() < (ptrdiff_t)(MinFreeRamForPoolGrowth + numWordsNeeded * sizeof(DWORD))
+		   )
+		{
+			if (reprap.Debug(moduleStorage))
+			{
+				debugPrintf("Cluster map not created, result %d, words needed %u\n", (int)ret, (unsigned int)numWordsNeeded);
+			}
+			return false;
+		}
+		numWords = numWordsNeeded;
 	}
 }
 
+// Report the rate at which data has been written to files on local storage since the last call, counting only the time spent writing
+/*static*/ void FileStore::WriteDiagnostics(MessageType mtype) noexcept
+{
+	const float seconds = (float)cardWriteTicks/(float)StepClockRate;
+	reprap.GetPlatform().MessageF(mtype, "SD card write throughput %.1fKbytes/sec over %" PRIu32 "Kbytes\n",
+									(seconds > 0.0) ? (double)((float)bytesWrittenToCard/(1024.0 * seconds)) : 0.0, bytesWrittenToCard/1024);
+	bytesWrittenToCard = 0;
+	cardWriteTicks = 0;
+}
+
+#if SUPPORT_MACRO_CACHE
+
+// Open the file to read from a macro cache slot. The caller has already marked the slot as in use.
+// We clear the file system pointer so that the file is not invalidated or closed when a card is unmounted, because it doesn't use the card.
+void FileStore::OpenCached(unsigned int slot) noexcept
+{
+	writeBuffer = nullptr;
+	calcCrc = false;
+	file.obj.fs = nullptr;
+	cacheSlot = (int8_t)slot;
+	cacheOffset = 0;
+	closeRequested = false;
+	usageMode = FileUseMode::readOnly;
+	openCount = 1;
+}
+
+#endif
+
+uint32_t FileStore::ClusterSize() const noexcept
+{
+	return (usageMode == FileUseMode::readOnly || usageMode == FileUseMode::readWrite) ? file.obj.fs->csize * 512u : 1;	// we divide by the cluster size so return 1 not 0 if there is an error
+}
+
+#endif	// HAS_MASS_STORAGE
+
+#if 0	// these are not currently used
+
+bool FileStore::GoToEnd()
+{
+	return Seek(Length());
+}
+
 #endif
 
 #endif	// HAS_MASS_STORAGE || HAS_SBC_INTERFACE
@@ -13,6 +13,9 @@
 
 class Platform;
 class FileWriteBuffer;
+#if SUPPORT_COMPRESSED_GCODE_FILES
+class CompressedFileReader;
+#endif
 
 #if HAS_EMBEDDED_FILES
 typedef int32_t FileIndex;
@@ -33,7 +36,8 @@ enum class FileUseMode : uint8_t
 	free,			// file object is free
 	readOnly,		// file object is in use for reading only
 	readWrite,		// file object is in use for reading and writing
-	invalidated		// file object is in use but file system has been invalidated
+	invalidated,	// file object is in use but file system has been invalidated
+	reserved		// file object has been claimed by a task that is opening a file in it
 };
 
 class FileStore
@@ -56,11 +60,15 @@ public:
 	FilePosition Length() const noexcept;						// File size in bytes
 	bool IsCloseRequested() const noexcept { return closeRequested; }
 	bool IsFree() const noexcept { return usageMode == FileUseMode::free; }
+	bool IsReserved() const noexcept { return usageMode == FileUseMode::reserved; }
+	void Reserve() noexcept;									// Claim this free file object so that no other task can use it. Call this while holding the file table lock.
+	void CancelReservation() noexcept { usageMode = FileUseMode::free; }	// Free a reserved file object that we failed to open a file in
 	FilePosition Position() const noexcept;						// Return the current position in the file, assuming we are reading the file
 	void Duplicate() noexcept;									// Create a second reference to this file
 
 #if HAS_MASS_STORAGE || HAS_SBC_INTERFACE
 	FileWriteBuffer *GetWriteBuffer() const noexcept;			// Return a pointer to the remaining space for writing
+	uint32_t GetWriteBufferWaitSeq() const noexcept { return writeBufferWaitSeq; }	// Return nonzero if we are waiting for a write buffer
 	bool Write(char b) noexcept;								// Write 1 byte
 	bool Write(const char *_ecv_array s, size_t len) noexcept;				// Write a block of len bytes
 	bool Write(const uint8_t *_ecv_array s, size_t len) noexcept;			// Write a block of len bytes
@@ -79,9 +87,15 @@ public:
 	bool Invalidate(const FATFS *fs, bool doClose) noexcept;	// Invalidate the file if it uses the specified FATFS object
 	bool IsOpenOn(const FATFS *fs) const noexcept;				// Return true if the file is open on the specified file system
 	bool IsSameFile(const FIL& otherFile) const noexcept;		// Return true if the passed file is the same as ours
-# if 0	// not currently used
-	bool SetClusterMap(uint32_t[]) noexcept;					// Provide a cluster map for fast seeking
+	static void WriteDiagnostics(MessageType mtype) noexcept;	// Report the write throughput since the last call
+# if SUPPORT_COMPRESSED_GCODE_FILES
+	bool EnableDecompression() noexcept;						// If the file is compressed then decompress it as it is read. Return false if it is compressed but can't be read.
 # endif
+	bool EnableFastSeek() noexcept;								// Try to build a cluster map so that seeks don't need to follow the FAT chain
+#endif
+
+#if SUPPORT_MACRO_CACHE
+	void OpenCached(unsigned int slot) noexcept;				// Open the file to read from a slot in the macro cache instead of from the card
 #endif
 
 #if 0	// not currently used
@@ -91,17 +105,28 @@ public:
 private:
 	void Init() noexcept;
 	bool Store(const char *_ecv_array s, size_t len, size_t *bytesWritten) noexcept;	// Write data to the non-volatile storage
+#if HAS_MASS_STORAGE || HAS_SBC_INTERFACE
+	bool FlushWriteBuffers() noexcept;							// Write the data in the write buffer chain to storage and release any chained buffers
+	bool ChainWriteBuffer(FileWriteBuffer *tail) noexcept;		// Try to add another write buffer to the chain
+	void YieldWriteBuffer() noexcept;							// Give up our empty write buffer if another file is waiting for one
+#endif
 
 	volatile unsigned int openCount;
 
 #if HAS_MASS_STORAGE || HAS_SBC_INTERFACE
 	FileWriteBuffer *writeBuffer;
+	volatile uint32_t writeBufferWaitSeq;						// nonzero if we were opened for writing and are waiting for a write buffer
 	CRC32 crc;
 #endif
 
 #if HAS_MASS_STORAGE
     FIL file;
-	static uint32_t longestWriteTime;
+	static uint32_t bytesWrittenToCard;
+	static uint64_t cardWriteTicks;
+	DWORD *clusterMap;
+# if SUPPORT_COMPRESSED_GCODE_FILES
+	CompressedFileReader *decompressor;
+# endif
 #endif
 
 #if HAS_SBC_INTERFACE
@@ -117,6 +142,11 @@ private:
 	FilePosition offset;
 #endif
 
+#if SUPPORT_MACRO_CACHE
+	FilePosition cacheOffset;
+	int8_t cacheSlot;											// the macro cache slot we are reading from, or -1 if we are not reading from the cache
+#endif
+
 	volatile bool closeRequested;
 	FileUseMode usageMode;
 
@@ -127,8 +157,6 @@ private:
 
 #if HAS_MASS_STORAGE || HAS_SBC_INTERFACE
 
-inline FileWriteBuffer *FileStore::GetWriteBuffer() const noexcept { return writeBuffer; }
-
 inline bool FileStore::Write(const uint8_t *_ecv_array s, size_t len) noexcept { return Write(reinterpret_cast<const char *_ecv_array>(s), len); }
 
 inline uint32_t FileStore::GetCRC32() const noexcept
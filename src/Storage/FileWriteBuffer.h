@@ -52,6 +52,9 @@ public:
 	const size_t BytesStored() const noexcept { return index; }
 	const size_t BytesLeft() const noexcept { return fileWriteBufLen - index; }
 
+	size_t ChainBytesStored() const noexcept;							// Return the number of bytes stored in this buffer and those chained to it
+	FileWriteBuffer *Tail() noexcept;									// Return the last buffer in the chain that starts with this one
+
 	size_t Store(const char *data, size_t length) noexcept;				// Stores some data and returns how much could be stored
 	void DataTaken() noexcept { index = 0; }							// Called to indicate that the buffer has been written to the SD card
 	void DataStored(size_t numBytes) noexcept { index += numBytes; }	// Called when more data has been stored directly in the buffer
@@ -68,6 +71,26 @@ private:
 #endif
 };
 
+inline size_t FileWriteBuffer::ChainBytesStored() const noexcept
+{
+	size_t total = 0;
+	for (const FileWriteBuffer *b = this; b != nullptr; b = b->next)
+	{
+		total += b->index;
+	}
+	return total;
+}
+
+inline FileWriteBuffer *FileWriteBuffer::Tail() noexcept
+{
+	FileWriteBuffer *b = this;
+	while (b->next != nullptr)
+	{
+		b = b->next;
+	}
+	return b;
+}
+
 inline size_t FileWriteBuffer::Store(const char *data, size_t length) noexcept
 {
 	size_t bytesToStore = min<size_t>(BytesLeft(), length);
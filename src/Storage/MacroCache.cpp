@@ -0,0 +1,160 @@
+/*
+ * MacroCache.cpp
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ */
+
+#include "MacroCache.h"
+
+#if SUPPORT_MACRO_CACHE
+
+#include "MassStorage.h"
+#include "FileStore.h"
+#include <Platform/RepRap.h>
+#include <Platform/Platform.h>
+
+namespace MacroCache
+{
+	struct Slot
+	{
+		String<MaxFilenameLength> path;
+		FilePosition length;
+		uint32_t whenLastUsed;
+		uint32_t appendSeq;
+		uint16_t volumeSeq;
+		uint8_t volume;
+		uint8_t numReaders;										// how many open FileStores are reading from this slot
+		bool valid;
+		alignas(4) char data[MacroCacheSlotSize];
+	};
+
+	static Slot slots[MacroCacheSlots];
+	static volatile uint32_t appendSeq = 0;						// incremented by FileAppended, which may be called by any task
+	static uint32_t useCounter = 0;
+	static unsigned int numHits = 0, numMisses = 0;
+
+	static unsigned int GetVolume(const char *_ecv_array path) noexcept
+	{
+		return (isdigit(path[0]) && path[1] == ':') ? path[0] - '0' : 0;
+	}
+
+	static bool IsCurrent(const Slot& slot) noexcept
+	{
+		return slot.valid && slot.volumeSeq == MassStorage::GetVolumeSeq(slot.volume) && slot.appendSeq == appendSeq && MassStorage::IsDriveMounted(slot.volume);
+	}
+
+	int Find(const char *_ecv_array filePath) noexcept
+	{
+		for (Slot& slot : slots)
+		{
+			if (IsCurrent(slot) && StringEqualsIgnoreCase(slot.path.c_str(), filePath))
+			{
+				slot.whenLastUsed = ++useCounter;
+				++slot.numReaders;
+				++numHits;
+				return &slot - slots;
+			}
+		}
+		++numMisses;
+		return -1;
+	}
+
+	// Store the contents of a macro file that we have just opened from the card, replacing an out-of-date slot or else the least recently used one
+	void Store(const char *_ecv_array filePath, FileStore *f) noexcept
+	{
+		const unsigned int volume = GetVolume(filePath);
+		const FilePosition length = f->Length();
+		if (volume >= MassStorage::GetNumVolumes() || length > MacroCacheSlotSize)
+		{
+			return;
+		}
+
+		Slot *victim = nullptr;
+		for (Slot& slot : slots)
+		{
+			if (slot.numReaders == 0)
+			{
+				if (!IsCurrent(slot))
+				{
+					victim = &slot;								// an out-of-date slot is as good as an empty one
+					break;
+				}
+				if (victim == nullptr || slot.whenLastUsed < victim->whenLastUsed)
+				{
+					victim = &slot;
+				}
+			}
+		}
+
+		if (victim == nullptr)
+		{
+			return;												// all slots are being read from by nested macros
+		}
+
+		// Record the sequence numbers before we read the file, so that if it changes while we are reading it the slot is out of date
+		victim->valid = false;
+		victim->volume = (uint8_t)volume;
+		victim->volumeSeq = MassStorage::GetVolumeSeq(volume);
+		victim->appendSeq = appendSeq;
+		if (victim->path.copy(filePath))
+		{
+			return;												// path too long
+		}
+
+		// Read the file into the slot and leave the file positioned at the start, so that the caller can run it from the file this time
+		const int bytesRead = f->Read(victim->data, length);
+		if (!f->Seek(0) || bytesRead != (int)length)
+		{
+			return;
+		}
+		victim->length = length;
+		victim->whenLastUsed = ++useCounter;
+		victim->valid = true;
+	}
+
+	int Read(unsigned int slot, FilePosition& offset, char *_ecv_array buf, size_t nBytes) noexcept
+	{
+		const Slot& s = slots[slot];
+		const size_t bytesToCopy = (offset >= s.length) ? 0 : min<size_t>(nBytes, s.length - offset);
+		memcpy(buf, s.data + offset, bytesToCopy);
+		offset += bytesToCopy;
+		return (int)bytesToCopy;
+	}
+
+	FilePosition Length(unsigned int slot) noexcept
+	{
+		return slots[slot].length;
+	}
+
+	void Release(unsigned int slot) noexcept
+	{
+		if (slots[slot].numReaders != 0)
+		{
+			--slots[slot].numReaders;
+		}
+	}
+
+	void FileAppended() noexcept
+	{
+		appendSeq = appendSeq + 1;
+	}
+
+	void Diagnostics(MessageType mtype) noexcept
+	{
+		unsigned int numValid = 0;
+		for (const Slot& slot : slots)
+		{
+			if (IsCurrent(slot))
+			{
+				++numValid;
+			}
+		}
+		reprap.GetPlatform().MessageF(mtype, "Macro cache: %u/%u files held, hits %u, misses %u\n", numValid, (unsigned int)MacroCacheSlots, numHits, numMisses);
+		numHits = numMisses = 0;
+	}
+}
+
+#endif
+
+// End
@@ -0,0 +1,37 @@
+/*
+ * MacroCache.h
+ *
+ *  Created on: 14 Oct 2026
+ *      Author: David
+ *
+ *  This holds the contents of recently used small macro files in RAM, so that tool change files, pause.g and other macros that are run
+ *  repeatedly don't have to be opened and read from the SD card each time. The first time a macro is run it is read from the card as usual and
+ *  a copy is kept in the least recently used slot. Later runs get a FileStore that reads from the slot instead of from the card.
+ *  Entries become invalid when the sequence number of their volume changes, which happens whenever a file is created, deleted or renamed and when
+ *  the card is mounted or unmounted, and when any file is opened in append mode, because echo >> can add commands to a macro file in place.
+ *  They are not used while the card is not mounted.
+ *  A slot that is being read from is never reused, so a macro that is stored in the cache can be nested inside another one.
+ *  All the functions except FileAppended are called by the Main task only, so no locking is needed.
+ */
+
+#ifndef SRC_STORAGE_MACROCACHE_H_
+#define SRC_STORAGE_MACROCACHE_H_
+
+#include <RepRapFirmware.h>
+
+#if SUPPORT_MACRO_CACHE
+
+namespace MacroCache
+{
+	int Find(const char *_ecv_array filePath) noexcept;					// return the slot holding the file and mark it in use, or -1 if it isn't held
+	void Store(const char *_ecv_array filePath, FileStore *f) noexcept;	// store the file if it fits, leaving it positioned at the start
+	int Read(unsigned int slot, FilePosition& offset, char *_ecv_array buf, size_t nBytes) noexcept;
+	FilePosition Length(unsigned int slot) noexcept;
+	void Release(unsigned int slot) noexcept;							// called when a FileStore that was reading from the slot is closed
+	void FileAppended() noexcept;										// called when any file is opened in append mode
+	void Diagnostics(MessageType mtype) noexcept;
+}
+
+#endif
+
+#endif /* SRC_STORAGE_MACROCACHE_H_ */
@@ -23,6 +23,10 @@ static_assert(SD_MMC_MEM_CNT == NumSdCards);
 # include <GCodes/GCodeBuffer/GCodeBuffer.h>
 #endif
 
+#if SUPPORT_MACRO_CACHE
+# include "MacroCache.h"
+#endif
+
 // A note on using mutexes:
 // Each SD card volume has its own mutex. There is also one for the file table, and one for the find first/find next buffer.
 // The FatFS subsystem locks and releases the appropriate volume mutex when it is called.
@@ -55,6 +59,7 @@ struct SdCardInfo INHERIT_OBJECT_MODEL
 	uint32_t mountStartTime;
 	Mutex volMutex;
 	uint16_t seq;
+	uint16_t contentSeq;									// incremented whenever anything changes that could change a directory listing
 	Pin cdPin;
 	bool mounting;
 	bool isMounted;
@@ -134,6 +139,151 @@ DEFINE_GET_OBJECT_MODEL_TABLE(SdCardInfo)
 
 static SdCardInfo info[NumSdCards];
 static DIR findDir;
+
+# if SUPPORT_DIRECTORY_CACHE
+
+// Cache of directory listings. When FindFirst and FindNext enumerate a complete directory from the card, they record the entries in a cache slot if they fit.
+// If the same directory is enumerated again before anything changes on that volume, the entries are returned from the cache instead of from the card.
+// All access is done while holding dirMutex.
+namespace DirectoryCache
+{
+	struct EntryHeader
+	{
+		uint32_t size;
+		uint32_t lastModified;
+		uint8_t isDirectory;
+		uint8_t nameLength;
+		uint16_t padding;
+	};
+
+	struct Slot
+	{
+		String<MaxFilenameLength> path;
+		uint32_t whenLastUsed;
+		size_t bytesUsed;
+		uint16_t contentSeq;
+		uint8_t volume;
+		bool valid;
+		alignas(4) char data[DirectoryCacheSlotSize];
+	};
+
+	static Slot slots[DirectoryCacheSlots];
+	static Slot *readingSlot = nullptr;						// the slot that FindNext is reading from, or nullptr
+	static Slot *recordingSlot = nullptr;					// the slot that FindFirst and FindNext are recording into, or nullptr
+	static size_t readingOffset;
+	static uint32_t useCounter = 0;
+	static unsigned int hits = 0, misses = 0;
+
+	static unsigned int GetVolume(const char *_ecv_array path) noexcept
+	{
+		return (isdigit(path[0]) && path[1] == ':') ? path[0] - '0' : 0;
+	}
+
+	// Look for a valid cached listing of a directory and start reading it if we find one, else choose a slot to record it into
+	static bool StartReading(const char *_ecv_array path) noexcept
+	{
+		const unsigned int volume = GetVolume(path);
+		if (volume >= ARRAY_SIZE(info))
+		{
+			readingSlot = recordingSlot = nullptr;
+			return false;
+		}
+
+		const uint16_t contentSeq = info[volume].contentSeq;
+		Slot *oldest = &slots[0];
+		for (Slot& slot : slots)
+		{
+			if (slot.valid && slot.volume == volume && slot.contentSeq == contentSeq && StringEqualsIgnoreCase(slot.path.c_str(), path))
+			{
+				slot.whenLastUsed = ++useCounter;
+				readingSlot = &slot;
+				readingOffset = 0;
+				recordingSlot = nullptr;
+				++hits;
+				return true;
+			}
+			if (slot.whenLastUsed < oldest->whenLastUsed)
+			{
+				oldest = &slot;
+			}
+		}
+
+		++misses;
+		readingSlot = nullptr;
+		recordingSlot = oldest;
+		oldest->valid = false;
+		oldest->path.copy(path);
+		oldest->volume = volume;
+		oldest->contentSeq = contentSeq;				// if anything changes while we are recording, the listing will not be used
+		oldest->bytesUsed = 0;
+		oldest->whenLastUsed = ++useCounter;
+		return false;
+	}
+
+	// Get the next entry from the slot we are reading. Return false if there are no more.
+	static bool ReadNext(FileInfo& file_info) noexcept
+	{
+		if (readingOffset >= readingSlot->bytesUsed)
+		{
+			readingSlot = nullptr;
+			return false;
+		}
+
+		EntryHeader hdr;
+		memcpy(&hdr, readingSlot->data + readingOffset, sizeof(hdr));
+		file_info.size = hdr.size;
+		file_info.lastModified = hdr.lastModified;
+		file_info.isDirectory = (hdr.isDirectory != 0);
+		file_info.fileName.copy(readingSlot->data + readingOffset + sizeof(hdr), hdr.nameLength);
+		readingOffset += sizeof(hdr) + ((hdr.nameLength + 3u) & ~3u);
+		return true;
+	}
+
+	// Record an entry that we read from the card, or give up recording if it doesn't fit
+	static void Record(const FileInfo& file_info) noexcept
+	{
+		if (recordingSlot != nullptr)
+		{
+			const size_t nameLength = file_info.fileName.strlen();
+			const size_t bytesNeeded = sizeof(EntryHeader) + ((nameLength + 3u) & ~3u);
+			if (nameLength > UINT8_MAX || recordingSlot->bytesUsed + bytesNeeded > DirectoryCacheSlotSize)
+			{
+				recordingSlot = nullptr;
+				return;
+			}
+
+			EntryHeader hdr;
+			hdr.size = file_info.size;
+			hdr.lastModified = (uint32_t)file_info.lastModified;
+			hdr.isDirectory = (file_info.isDirectory) ? 1 : 0;
+			hdr.nameLength = (uint8_t)nameLength;
+			hdr.padding = 0;
+			memcpy(recordingSlot->data + recordingSlot->bytesUsed, &hdr, sizeof(hdr));
+			memcpy(recordingSlot->data + recordingSlot->bytesUsed + sizeof(hdr), file_info.fileName.c_str(), nameLength);
+			recordingSlot->bytesUsed += bytesNeeded;
+		}
+	}
+
+	// Called when we reach the end of a directory. If we recorded all of it then the slot becomes valid.
+	static void Finished(bool ok) noexcept
+	{
+		if (recordingSlot != nullptr)
+		{
+			recordingSlot->valid = ok;
+			recordingSlot = nullptr;
+		}
+		readingSlot = nullptr;
+	}
+
+	static void Diagnostics(MessageType mtype) noexcept
+	{
+		reprap.GetPlatform().MessageF(mtype, "Directory cache hits %u, misses %u\n", hits, misses);
+		hits = misses = 0;
+	}
+}
+
+# endif
+
 #endif
 
 #if HAS_MASS_STORAGE || HAS_EMBEDDED_FILES
@@ -143,6 +293,8 @@ static FileInfoParser infoParser;
 
 #if HAS_MASS_STORAGE || HAS_SBC_INTERFACE
 static FileWriteBuffer *freeWriteBuffers;
+static uint32_t lastWriteBufferWaitSeq = 0;					// the sequence number given to the file that most recently started waiting for a write buffer
+static unsigned int writeBufferHandovers = 0;				// how many times a file has given up its write buffer to a waiting file
 #endif
 
 #if HAS_MASS_STORAGE || HAS_SBC_INTERFACE || HAS_EMBEDDED_FILES
@@ -233,17 +385,54 @@ uint16_t MassStorage::GetVolumeSeq(unsigned int volume) noexcept
 	return info[volume].seq;
 }
 
+// Record that the size or date of a file may have changed, which changes the directory listing
+void MassStorage::FileContentsChanged(const FATFS *fs) noexcept
+{
+	for (SdCardInfo& inf : info)
+	{
+		if (&inf.fileSystem == fs)
+		{
+			++inf.contentSeq;
+			break;
+		}
+	}
+}
+
+// Return the volume number that a path refers to
+static unsigned int GetVolumeNumber(const char *path) noexcept
+{
+	return (isdigit(path[0]) && path[1] == ':') ? path[0] - '0' : 0;
+}
+
+// Return the mutex that FatFS uses to lock the volume that a path refers to, or nullptr if the path is not on a local volume
+static Mutex *GetPathVolumeMutex(const char *path) noexcept
+{
+#if HAS_SBC_INTERFACE
+	if (reprap.UsingSbcInterface())
+	{
+		return nullptr;
+	}
+#endif
+	const unsigned int volume = GetVolumeNumber(path);
+	return (volume < ARRAY_SIZE(info)) ? &info[volume].volMutex : nullptr;
+}
+
 // If 'path' is not the name of a temporary file, update the sequence number of its volume
 // Return true if we did update the sequence number
 static bool VolumeUpdated(const char *path) noexcept
 {
+	const unsigned int volume = GetVolumeNumber(path);
+	if (volume < ARRAY_SIZE(info))
+	{
+		++info[volume].contentSeq;							// temporary files appear in directory listings too
+	}
+
 	if (!StringEndsWithIgnoreCase(path, ".part")
 #if HAS_SBC_INTERFACE
 		&& !reprap.UsingSbcInterface()
 #endif
 	   )
 	{
-		const unsigned int volume = (isdigit(path[0]) && path[1] == ':') ? path[0] - '0' : 0;
 		if (volume < ARRAY_SIZE(info))
 		{
 			++info[volume].seq;
@@ -265,6 +454,7 @@ static unsigned int InternalUnmount(size_t card, bool doClose) noexcept
 	inf.Clear(card);
 	sd_mmc_unmount(card);
 	inf.isMounted = false;
+	++inf.contentSeq;
 	reprap.VolumesUpdated();
 	return invalidated;
 }
@@ -341,8 +531,9 @@ void MassStorage::Init() noexcept
 
 # if HAS_MASS_STORAGE || HAS_SBC_INTERFACE
 	freeWriteBuffers = nullptr;
-	for (size_t i = 0; i < NumFileWriteBuffers; ++i)
+	for (size_t i = NumFileWriteBuffers; i != 0; )				// build the list backwards so that buffers adjacent in memory are allocated in ascending order
 	{
+		--i;
 #  if SAME70
 		freeWriteBuffers = new FileWriteBuffer(freeWriteBuffers, writeBufferStorage[i]);
 #  else
@@ -451,25 +642,89 @@ void MassStorage::Spin() noexcept
 
 FileStore* MassStorage::OpenFile(const char* filePath, OpenMode mode, uint32_t preAllocSize) noexcept
 {
+	// Claim a free file object while holding fsMutex, but don't hold fsMutex while we open the file.
+	// FatFS locks each volume separately, so opening a file on one volume doesn't hold up files being opened, closed or deleted on other volumes.
+	FileStore *fil = nullptr;
 	{
 		MutexLocker lock(fsMutex);
-		for (size_t i = 0; i < MAX_FILES; i++)
+		for (FileStore& f : files)
 		{
-			if (files[i].IsFree())
+			if (f.IsFree())
 			{
-				FileStore * const ret = (files[i].Open(filePath, mode, preAllocSize)) ? &files[i]: nullptr;
+				f.Reserve();
+				fil = &f;
+				break;
+			}
+		}
+	}
+
+	if (fil == nullptr)
+	{
+		reprap.GetPlatform().Message(ErrorMessage, "Max open file count exceeded.\n");
+		return nullptr;
+	}
+
 # if HAS_MASS_STORAGE
-				if (ret != nullptr && (mode == OpenMode::write || mode == OpenMode::writeWithCrc))
+	// Hold the volume lock until the file object has been set up, so that Delete and Unmount see either no file or a file that is open
+	MutexLocker lock(GetPathVolumeMutex(filePath));
+# endif
+	if (!fil->Open(filePath, mode, preAllocSize))
+	{
+		fil->CancelReservation();
+		return nullptr;
+	}
+
+# if HAS_MASS_STORAGE
+	if (mode == OpenMode::write || mode == OpenMode::writeWithCrc)
+	{
+		(void)VolumeUpdated(filePath);
+	}
+# endif
+# if SUPPORT_MACRO_CACHE
+	if (mode == OpenMode::append)
+	{
+		MacroCache::FileAppended();
+	}
+# endif
+	return fil;
+}
+
+// Open a macro file for reading, from the macro cache if we hold a copy of it
+FileStore* MassStorage::OpenMacroFile(const char* filePath) noexcept
+{
+# if SUPPORT_MACRO_CACHE
+#  if HAS_SBC_INTERFACE
+	if (!reprap.UsingSbcInterface())
+#  endif
+	{
+		const int slot = MacroCache::Find(filePath);
+		if (slot >= 0)
+		{
+			{
+				MutexLocker lock(fsMutex);
+				for (FileStore& fil : files)
 				{
-					(void)VolumeUpdated(filePath);
+					if (fil.IsFree())
+					{
+						fil.OpenCached(slot);
+						return &fil;
+					}
 				}
-# endif
-				return ret;
 			}
+			MacroCache::Release(slot);
+			reprap.GetPlatform().Message(ErrorMessage, "Max open file count exceeded.\n");
+			return nullptr;
+		}
+
+		FileStore * const f = OpenFile(filePath, OpenMode::read, 0);
+		if (f != nullptr)
+		{
+			MacroCache::Store(filePath, f);
 		}
+		return f;
 	}
-	reprap.GetPlatform().Message(ErrorMessage, "Max open file count exceeded.\n");
-	return nullptr;
+# endif
+	return OpenFile(filePath, OpenMode::read, 0);
 }
 
 // Close all files
@@ -478,7 +733,7 @@ void MassStorage::CloseAllFiles() noexcept
 	MutexLocker lock(fsMutex);
 	for (FileStore& f : files)
 	{
-		while (!f.IsFree())
+		while (!f.IsFree() && !f.IsReserved())
 		{
 			f.Close();
 		}
@@ -529,24 +784,65 @@ bool MassStorage::DirectoryExists(const StringRef& path) noexcept
 // Static helper functions
 size_t FileWriteBuffer::fileWriteBufLen = FileWriteBufLen;
 
-FileWriteBuffer *MassStorage::AllocateWriteBuffer() noexcept
+// These are called by FileStore::Open while it holds a volume lock, so they must not take fsMutex.
+// There are fewer write buffers than files that may be written at the same time, for example when several files are being uploaded.
+// A file that can't get a write buffer when it is opened waits for one, writing directly to the card until it gets one.
+// Files that are waiting get buffers in the order in which they started waiting, and a file that has a buffer gives it up after flushing it if any file is waiting.
+FileWriteBuffer *MassStorage::AllocateWriteBuffer(uint32_t waitSeq) noexcept
 {
-	MutexLocker lock(fsMutex);
+	TaskCriticalSectionLocker lock;
 
 	FileWriteBuffer * const buffer = freeWriteBuffers;
 	if (buffer != nullptr)
 	{
+		// Don't take the buffer if another file has been waiting for one longer than we have
+		for (const FileStore& fil : files)
+		{
+			const uint32_t otherSeq = fil.GetWriteBufferWaitSeq();
+			if (otherSeq != 0 && otherSeq != waitSeq && (waitSeq == 0 || (int32_t)(otherSeq - waitSeq) < 0))
+			{
+				return nullptr;
+			}
+		}
+
 		freeWriteBuffers = buffer->Next();
 		buffer->SetNext(nullptr);
 		buffer->DataTaken();				// make sure that the write pointer is clear
+		if (waitSeq != 0)
+		{
+			++writeBufferHandovers;
+		}
 	}
 	return buffer;
 }
 
+uint32_t MassStorage::QueueForWriteBuffer() noexcept
+{
+	TaskCriticalSectionLocker lock;
+	++lastWriteBufferWaitSeq;
+	if (lastWriteBufferWaitSeq == 0)
+	{
+		++lastWriteBufferWaitSeq;			// zero means not waiting
+	}
+	return lastWriteBufferWaitSeq;
+}
+
+bool MassStorage::AnyFileWaitingForWriteBuffer() noexcept
+{
+	for (const FileStore& fil : files)
+	{
+		if (fil.GetWriteBufferWaitSeq() != 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 void MassStorage::ReleaseWriteBuffer(FileWriteBuffer *buffer) noexcept
 {
-	MutexLocker lock(fsMutex);
-	buffer->SetNext(freeWriteBuffers);
+	TaskCriticalSectionLocker lock;
+	buffer->Tail()->SetNext(freeWriteBuffers);					// the buffer may have other buffers chained to it
 	freeWriteBuffers = buffer;
 }
 
@@ -572,7 +868,7 @@ void MassStorage::InvalidateAllFiles() noexcept
 	MutexLocker lock(fsMutex);
 	for (FileStore& f : files)
 	{
-		while (!f.IsFree())
+		while (!f.IsFree() && !f.IsReserved())
 		{
 			f.Invalidate();
 		}
@@ -589,9 +885,10 @@ static bool InternalDelete(const char* filePath, bool messageIfFailed) noexcept
 	FRESULT unlinkReturn;
 	bool isOpen = false;
 
-	// Start new scope to lock the filesystem for the minimum time
+	// Start new scope to lock the volume for the minimum time.
+	// We lock only the volume that the file is on, not fsMutex. OpenFile holds the same lock while it opens a file, so a file on this volume can't be opened while we check the table.
 	{
-		MutexLocker lock(fsMutex);
+		MutexLocker lock(GetPathVolumeMutex(filePath));
 
 		// First check whether the file is open - don't allow it to be deleted if it is, because that may corrupt the file system
 		FIL file;
@@ -693,6 +990,18 @@ bool MassStorage::FindFirst(const char *directory, FileInfo &file_info) noexcept
 	}
 
 #if HAS_MASS_STORAGE
+# if SUPPORT_DIRECTORY_CACHE
+	if (DirectoryCache::StartReading(loc.c_str()))
+	{
+		if (DirectoryCache::ReadNext(file_info))
+		{
+			return true;
+		}
+		dirMutex.Release();
+		return false;
+	}
+# endif
+
 	FRESULT res = f_opendir(&findDir, loc.c_str());
 	if (res == FR_OK)
 	{
@@ -708,11 +1017,17 @@ bool MassStorage::FindFirst(const char *directory, FileInfo &file_info) noexcept
 				file_info.fileName.copy(entry.fname);
 				file_info.size = entry.fsize;
 				file_info.lastModified = ConvertTimeStamp(entry.fdate, entry.ftime);
+# if SUPPORT_DIRECTORY_CACHE
+				DirectoryCache::Record(file_info);
+# endif
 				return true;
 			}
 		}
 		f_closedir(&findDir);
 	}
+# if SUPPORT_DIRECTORY_CACHE
+	DirectoryCache::Finished(res == FR_OK);
+# endif
 #elif HAS_EMBEDDED_FILES
 	if (EmbeddedFiles::FindFirst(directory, file_info))
 	{
@@ -734,18 +1049,36 @@ bool MassStorage::FindNext(FileInfo &file_info) noexcept
 	}
 
 #if HAS_MASS_STORAGE
-	FILINFO entry;
+# if SUPPORT_DIRECTORY_CACHE
+	if (DirectoryCache::readingSlot != nullptr)
+	{
+		if (DirectoryCache::ReadNext(file_info))
+		{
+			return true;
+		}
+		dirMutex.Release();
+		return false;
+	}
+# endif
 
-	if (f_readdir(&findDir, &entry) == FR_OK && entry.fname[0] != 0)
+	FILINFO entry;
+	const FRESULT res = f_readdir(&findDir, &entry);
+	if (res == FR_OK && entry.fname[0] != 0)
 	{
 		file_info.isDirectory = (entry.fattrib & AM_DIR);
 		file_info.size = entry.fsize;
 		file_info.fileName.copy(entry.fname);
 		file_info.lastModified = ConvertTimeStamp(entry.fdate, entry.ftime);
+# if SUPPORT_DIRECTORY_CACHE
+		DirectoryCache::Record(file_info);
+# endif
 		return true;
 	}
 
 	f_closedir(&findDir);
+# if SUPPORT_DIRECTORY_CACHE
+	DirectoryCache::Finished(res == FR_OK);
+# endif
 #elif HAS_EMBEDDED_FILES
 	if (EmbeddedFiles::FindNext(file_info))
 	{
@@ -763,6 +1096,9 @@ void MassStorage::AbandonFindNext() noexcept
 {
 	if (dirMutex.GetHolder() == RTOSIface::GetCurrentTask())
 	{
+#if SUPPORT_DIRECTORY_CACHE
+		DirectoryCache::Finished(false);
+#endif
 		dirMutex.Release();
 	}
 }
@@ -935,6 +1271,7 @@ bool MassStorage::SetLastModifiedTime(const char *filePath, time_t time) noexcep
     fno.fdate = (WORD)(((timeInfo.tm_year - 80) * 512U) | (timeInfo.tm_mon + 1) * 32U | timeInfo.tm_mday);
     fno.ftime = (WORD)(timeInfo.tm_hour * 2048U | timeInfo.tm_min * 32U | timeInfo.tm_sec / 2U);
     const bool ok = (f_utime(filePath, &fno) == FR_OK);
+    (void)VolumeUpdated(filePath);
     if (!ok)
 	{
 		reprap.GetPlatform().MessageF(ErrorMessage, "Failed to set last modified time for file '%s'\n", filePath);
@@ -1064,6 +1401,7 @@ GCodeResult MassStorage::Mount(size_t card, const StringRef& reply, bool reportS
 	}
 
 	inf.isMounted = true;
+	++inf.contentSeq;
 	reprap.VolumesUpdated();
 	if (reportSuccess)
 	{
@@ -1157,6 +1495,15 @@ void MassStorage::Diagnostics(MessageType mtype) noexcept
 	// Show the longest SD card write time
 	platform.MessageF(mtype, "SD card longest read time %.1fms, write time %.1fms, max retries %u\n",
 								(double)DiskioGetAndClearLongestReadTime(), (double)DiskioGetAndClearLongestWriteTime(), DiskioGetAndClearMaxRetryCount());
+	FileStore::WriteDiagnostics(mtype);
+	platform.MessageF(mtype, "Write buffers handed over %u\n", writeBufferHandovers);
+	writeBufferHandovers = 0;
+#  if SUPPORT_DIRECTORY_CACHE
+	DirectoryCache::Diagnostics(mtype);
+#  endif
+#  if SUPPORT_MACRO_CACHE
+	MacroCache::Diagnostics(mtype);
+#  endif
 # endif
 }
 
@@ -1215,6 +1562,10 @@ void MassStorage::RecordSimulationTime(const char *printingFilePath, uint32_t si
 	{
 		reprap.GetPlatform().MessageF(ErrorMessage, "Failed to append simulated print time to file %s\n", printingFilePath);
 	}
+
+# if SUPPORT_FILE_INFO_INDEX
+	infoParser.ForgetFileInfo(printingFilePath);						// we restored the last modified time and the size may not have changed, so the index entry may be out of date
+# endif
 }
 
 // Get information about the SD card and interface speed
@@ -44,6 +44,7 @@ namespace MassStorage
 #if HAS_MASS_STORAGE || HAS_SBC_INTERFACE || HAS_EMBEDDED_FILES
 	void Init() noexcept;
 	FileStore* OpenFile(const char* filePath, OpenMode mode, uint32_t preAllocSize) noexcept;
+	FileStore* OpenMacroFile(const char* filePath) noexcept;								// Open a macro file for reading, using the macro cache if it is supported
 	bool FileExists(const char *filePath) noexcept;
 	void CloseAllFiles() noexcept;
 	void Spin() noexcept;
@@ -56,7 +57,9 @@ namespace MassStorage
 #endif
 
 #if HAS_MASS_STORAGE || HAS_SBC_INTERFACE
-	FileWriteBuffer *AllocateWriteBuffer() noexcept;
+	FileWriteBuffer *AllocateWriteBuffer(uint32_t waitSeq = 0) noexcept;					// Allocate a write buffer unless a file that has waited longer is waiting for one
+	uint32_t QueueForWriteBuffer() noexcept;												// Return the sequence number that a file waiting for a write buffer should hold
+	bool AnyFileWaitingForWriteBuffer() noexcept;
 	size_t GetFileWriteBufferLength() noexcept;
 	void ReleaseWriteBuffer(FileWriteBuffer *buffer) noexcept;
 	bool Delete(const char* filePath, bool messageIfFailed) noexcept;
@@ -94,6 +97,7 @@ namespace MassStorage
 	Mutex& GetVolumeMutex(size_t vol) noexcept;
 	void RecordSimulationTime(const char *_ecv_array printingFilePath, uint32_t simSeconds) noexcept;	// Append the simulated printing time to the end of the file
 	uint16_t GetVolumeSeq(unsigned int volume) noexcept;
+	void FileContentsChanged(const FATFS *fs) noexcept;										// Called when a file that was written has been flushed or closed
 
 	enum class InfoResult : uint8_t
 	{
@@ -106,6 +106,7 @@ constexpr ObjectModelTableEntry Tool::objectModelTable[] =
 	{ "extruders",			OBJECT_MODEL_FUNC_NOSELF(&extrudersArrayDescriptor), 						ObjectModelEntryFlags::none },
 	{ "fans",				OBJECT_MODEL_FUNC(self->fanMapping), 										ObjectModelEntryFlags::none },
 	{ "feedForward",		OBJECT_MODEL_FUNC_NOSELF(&feedForwardArrayDescriptor), 						ObjectModelEntryFlags::none },
+	{ "feedForwardLeadTime", OBJECT_MODEL_FUNC((int32_t)self->feedForwardLeadTime),						ObjectModelEntryFlags::none },
 	{ "filamentExtruder",	OBJECT_MODEL_FUNC((int32_t)self->filamentExtruder),							ObjectModelEntryFlags::none },
 	{ "heaters",			OBJECT_MODEL_FUNC_NOSELF(&heatersArrayDescriptor), 							ObjectModelEntryFlags::none },
 	{ "isRetracted",		OBJECT_MODEL_FUNC(self->IsRetracted()), 									ObjectModelEntryFlags::live },
@@ -128,7 +129,7 @@ constexpr ObjectModelTableEntry Tool::objectModelTable[] =
 	{ "zHop",				OBJECT_MODEL_FUNC(self->retractHop, 2),										ObjectModelEntryFlags::none },
 };
 
-constexpr uint8_t Tool::objectModelTableDescriptor[] = { 2, 18, 5 };
+constexpr uint8_t Tool::objectModelTableDescriptor[] = { 2, 19, 5 };
 
 DEFINE_GET_OBJECT_MODEL_TABLE(Tool)
 
@@ -228,6 +229,7 @@ DEFINE_GET_OBJECT_MODEL_TABLE(Tool)
 	t->retractSpeed = t->unRetractSpeed = ConvertSpeedFromMmPerMin(DefaultRetractSpeed);
 	t->isRetracted = false;
 	t->spindleNumber = spindleNo;
+	t->feedForwardLeadTime = 0;
 	t->spindleRpm = 0;
 
 	for (size_t axis = 0; axis < MaxAxes; axis++)
@@ -707,6 +709,18 @@ bool Tool::UsesHeater(int8_t heater) const noexcept
 	return false;
 }
 
+float Tool::GetHeaterFeedForward(int heater) const noexcept
+{
+	for (size_t i = 0; i < heaterCount; ++i)
+	{
+		if (heaters[i] == heater)
+		{
+			return heaterFeedForward[i];
+		}
+	}
+	return 0.0;
+}
+
 const char *Tool::GetFilamentName() const noexcept
 {
 	return (filament == nullptr) ? "" : filament->GetName();
@@ -758,12 +772,24 @@ GCodeResult Tool::SetFirmwareRetraction(GCodeBuffer &gb, const StringRef &reply,
 	return GCodeResult::ok;
 }
 
+// Process M309. The L parameter is the lead time in milliseconds. If it is nonzero, heaters in PID mode use the average feedforward needed by the moves
+// in the queue over that time instead of the feedforward for the move that is executing, so that they start to heat up before the flow increases.
 GCodeResult Tool::GetSetFeedForward(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
 {
+	bool seen = false;
 	if (gb.Seen('S'))
 	{
 		size_t numValues = heaterCount;
 		gb.GetFloatArray(heaterFeedForward, numValues, false);
+		seen = true;
+	}
+
+	uint32_t leadTime = feedForwardLeadTime;
+	gb.TryGetLimitedUIValue('L', leadTime, seen, MaxFeedForwardLeadTime + 1);
+	feedForwardLeadTime = (uint16_t)leadTime;
+
+	if (seen)
+	{
 		ToolUpdated();
 	}
 	else
@@ -773,6 +799,7 @@ GCodeResult Tool::GetSetFeedForward(GCodeBuffer& gb, const StringRef& reply) THR
 		{
 			reply.catf(" %.3f", (double)heaterFeedForward[i]);
 		}
+		reply.catf(", lead time %ums", feedForwardLeadTime);
 	}
 
 	return GCodeResult::ok;
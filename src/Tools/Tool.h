@@ -114,6 +114,10 @@ public:
 	void IterateExtruders(function_ref<void(unsigned int)> f) const noexcept;
 	void IterateHeaters(function_ref<void(int)> f) const noexcept;
 	bool UsesHeater(int8_t heater) const noexcept;
+	float GetHeaterFeedForward(int heater) const noexcept;		// Return the extrusion feedforward factor for a heater, or zero if this tool doesn't use it
+	static constexpr uint32_t MaxFeedForwardLeadTime = 5000;	// milliseconds
+
+	uint32_t GetFeedForwardLeadTime() const noexcept { return feedForwardLeadTime; }	// Return how far ahead in milliseconds to look for extrusion feedforward, or 0 to apply it when each move starts
 
 	void SetFansPwm(float f) const noexcept;
 
@@ -179,6 +183,7 @@ private:
 	int8_t heaters[MaxHeatersPerTool];
 
 	int8_t spindleNumber;
+	uint16_t feedForwardLeadTime;				// in milliseconds
 	uint32_t spindleRpm;
 
 	ToolState state;